@@ -211,6 +211,34 @@ extern "C" {
 	#define configUSE_MUTEXES 0
 #endif
 
+#ifndef configUSE_MUTEX_CEILING
+	#define configUSE_MUTEX_CEILING 0
+#endif
+
+#ifndef configUSE_QUEUE_PEAK
+	#define configUSE_QUEUE_PEAK 0
+#endif
+
+#ifndef configUSE_LOCK_PROFILE
+	#define configUSE_LOCK_PROFILE 0
+#endif
+
+#ifndef configUSE_QUEUE_COUNTERS
+	#define configUSE_QUEUE_COUNTERS 0
+#endif
+
+#if ( ( configUSE_LOCK_PROFILE == 1 ) && ( ( configUSE_MUTEXES == 0 ) || ( configGENERATE_RUN_TIME_STATS == 0 ) ) )
+	#error configUSE_LOCK_PROFILE needs configUSE_MUTEXES and configGENERATE_RUN_TIME_STATS, it times on the run time counter
+#endif
+
+#ifndef configUSE_EDF_SCHEDULING
+	#define configUSE_EDF_SCHEDULING 0
+#endif
+
+#if ( configUSE_EDF_SCHEDULING == 1 ) && !defined( configEDF_PRIORITY )
+	#error configEDF_PRIORITY must be defined when configUSE_EDF_SCHEDULING is 1.
+#endif
+
 #ifndef configUSE_TIMERS
 	#define configUSE_TIMERS 0
 #endif
@@ -273,6 +301,26 @@ extern "C" {
 		#error If configUSE_TIMERS is set to 1 then configTIMER_TASK_STACK_DEPTH must also be defined.
 	#endif /* configTIMER_TASK_STACK_DEPTH */
 
+	#ifndef configUSE_TIMER_WHEEL
+		#define configUSE_TIMER_WHEEL 0
+	#endif
+
+	#if ( configUSE_TIMER_WHEEL == 1 )
+		#if !defined( configTIMER_WHEEL_SLOTS ) || ( configTIMER_WHEEL_SLOTS > 32 ) || ( ( configTIMER_WHEEL_SLOTS & ( configTIMER_WHEEL_SLOTS - 1 ) ) != 0 )
+			#error configTIMER_WHEEL_SLOTS must be a power of 2 up to 32 when configUSE_TIMER_WHEEL is 1.
+		#endif
+	#endif
+
+	#ifndef configUSE_TIMER_BACKGROUND
+		#define configUSE_TIMER_BACKGROUND 0
+	#endif
+
+	#if ( configUSE_TIMER_BACKGROUND == 1 )
+		#if !defined( configTIMER_BACKGROUND_PRIORITY ) || !defined( configTIMER_BACKGROUND_STACK_DEPTH )
+			#error configTIMER_BACKGROUND_PRIORITY and configTIMER_BACKGROUND_STACK_DEPTH must be defined when configUSE_TIMER_BACKGROUND is 1.
+		#endif
+	#endif
+
 #endif /* configUSE_TIMERS */
 
 #ifndef INCLUDE_xTaskGetSchedulerState
@@ -549,6 +597,34 @@ extern "C" {
 	#define traceTIMER_COMMAND_RECEIVED( pxTimer, xMessageID, xMessageValue )
 #endif
 
+#ifndef traceTASK_NOTIFY_TAKE_BLOCK
+	#define traceTASK_NOTIFY_TAKE_BLOCK()
+#endif
+
+#ifndef traceTASK_NOTIFY_TAKE
+	#define traceTASK_NOTIFY_TAKE()
+#endif
+
+#ifndef traceTASK_NOTIFY_WAIT_BLOCK
+	#define traceTASK_NOTIFY_WAIT_BLOCK()
+#endif
+
+#ifndef traceTASK_NOTIFY_WAIT
+	#define traceTASK_NOTIFY_WAIT()
+#endif
+
+#ifndef traceTASK_NOTIFY
+	#define traceTASK_NOTIFY()
+#endif
+
+#ifndef traceTASK_NOTIFY_FROM_ISR
+	#define traceTASK_NOTIFY_FROM_ISR()
+#endif
+
+#ifndef traceTASK_NOTIFY_GIVE_FROM_ISR
+	#define traceTASK_NOTIFY_GIVE_FROM_ISR()
+#endif
+
 #ifndef traceMALLOC
     #define traceMALLOC( pvAddress, uiSize )
 #endif
@@ -557,6 +633,12 @@ extern "C" {
     #define traceFREE( pvAddress, uiSize )
 #endif
 
+/* traceMALLOC() with the return address of the allocator entry point called,
+from allocators that know it (heap_tlsf.c). */
+#ifndef traceMALLOC_CALLER
+    #define traceMALLOC_CALLER( pvCaller, pvAddress, uiSize ) traceMALLOC( pvAddress, uiSize )
+#endif
+
 #ifndef traceEVENT_GROUP_CREATE
 	#define traceEVENT_GROUP_CREATE( xEventGroup )
 #endif
@@ -699,6 +781,12 @@ extern "C" {
 	#define configUSE_NEWLIB_REENTRANT 0
 #endif
 
+/* 1: every TCB holds a newlib _reent.  2: a TCB points at one the
+application gives it with vTaskSetNewlibReent(), or at newlib's global one. */
+#if ( configUSE_NEWLIB_REENTRANT != 0 )
+	#include <reent.h>
+#endif
+
 #ifndef configUSE_STATS_FORMATTING_FUNCTIONS
 	#define configUSE_STATS_FORMATTING_FUNCTIONS 0
 #endif
@@ -88,43 +88,279 @@
  *----------------------------------------------------------*/
 
 #define configUSE_PREEMPTION			1   
-#define configUSE_IDLE_HOOK				0
-#define configUSE_TICK_HOOK				0
+/* The idle hook runs the background jobs (see idle_jobs.h).  Builds with
+FREQ_UI_COROUTINES run the UI as co-routines from one of them, on the idle
+task's stack. */
+#ifndef FREQ_UI_COROUTINES
+#define FREQ_UI_COROUTINES				0
+#endif
+#define configUSE_IDLE_HOOK				1
+#define configUSE_TICK_HOOK				1
+/* Stop the tick while every task is blocked (see port.c). The application
+decides how long it may sleep in vApplicationPreSleepProcessing(), called
+before the timer is reprogrammed; setting the idle time below 2 vetoes the
+sleep.
+Profiling builds ("make profile") sample the PC from the tick instead, see
+profile.h; the tick keeps running there so the idle task is sampled too. */
+#ifndef FREQ_RELAY_PROFILE
+#define FREQ_RELAY_PROFILE				0
+#endif
+#if FREQ_RELAY_PROFILE
+#define configUSE_TICKLESS_IDLE			0
+extern void vProfileTickSample( uint32_t ulPc, void *pvTask );
+#define portTICK_PC_SAMPLE( ulPc, pvTask )	vProfileTickSample( ( ulPc ), ( pvTask ) )
+#else
+#define configUSE_TICKLESS_IDLE			1
+#endif
+#define configPRE_SLEEP_PROCESSING( x )	vApplicationPreSleepProcessing( &( x ) )
 #define	configUSE_TIMERS				1
-#define configTIMER_TASK_PRIORITY		3
+/* The daemon runs the shortest periods in the system (actuator settle, switch
+debounce) and its callbacks only post notifications, so it ranks first under
+the application's rate monotonic priority map. */
+#define configTIMER_TASK_PRIORITY		( configMAX_PRIORITIES - 1 )
 #define configTIMER_QUEUE_LENGTH		10
-#define	configTIMER_TASK_STACK_DEPTH	2048
+#define	configTIMER_TASK_STACK_DEPTH	1024
+/* Active timers hash by expiry tick into configTIMER_WHEEL_SLOTS unsorted
+lists, so that starting, stopping or expiring one costs the same however
+many are running (see timers.c).  0 for the kernel's sorted lists. */
+#ifndef configUSE_TIMER_WHEEL
+#define configUSE_TIMER_WHEEL			1
+#endif
+#define configTIMER_WHEEL_SLOTS			32
+/* A second, low priority daemon for the timers made by xTimerCreateBackground()
+and the calls pended with xTimerPendFunctionCallBackground(): the telemetry
+drain and whatever prints.  None of it can then hold up a control timer or
+deferred interrupt work waiting in the daemon above.  0 runs everything in
+the one daemon. */
+#ifndef configUSE_TIMER_BACKGROUND
+#define configUSE_TIMER_BACKGROUND		1
+#endif
+#define configTIMER_BACKGROUND_PRIORITY	( 3 )
+#define configTIMER_BACKGROUND_STACK_DEPTH	1024	/* printf from the stack overflow report */
 #define configTICK_RATE_HZ				( ( portTickType ) 1000 )
 #define configCPU_CLOCK_HZ				( ( unsigned long ) ALT_SYS_CLK ) 
-#define configMAX_PRIORITIES			( ( unsigned portBASE_TYPE ) 12 )
-#define configMINIMAL_STACK_SIZE		( 4096 )
-#define configISR_STACK_SIZE			configMINIMAL_STACK_SIZE
+/* Plain number so the application can check its priority map with #if */
+#define configMAX_PRIORITIES			12
+/* Constant time ready list selection from a priority bitmap (see portmacro.h),
+limits configMAX_PRIORITIES to 32. */
+#define configUSE_PORT_OPTIMISED_TASK_SELECTION	1
+/* Critical sections inline on the status register rather than calls into
+tasks.c (see portmacro.h).  0 gives the kernel's own version, for comparing
+with "make bench". */
+#ifndef configUSE_PORT_INLINE_CRITICAL
+#define configUSE_PORT_INLINE_CRITICAL	1
+#endif
+/* Idle task stack.  Interrupts have their own stack, so this only covers the
+idle loop and the tickless sleep. */
+#if FREQ_UI_COROUTINES
+#define configMINIMAL_STACK_SIZE		( 2048 )	/* The display co-routine draws on it */
+#else
+#define configMINIMAL_STACK_SIZE		( 256 )
+#endif
+/* Interrupt stack (words), see port_asm.S.  Holds the nested handlers and the
+context switch made when they return, which may print from the stack
+overflow hook.  Check uxPortGetIsrStackHighWaterMark() before trimming.  In
+the data TCM in "make tcm", see fast_mem.h. */
+#define configISR_STACK_SIZE			( 768 )
+#define configISR_STACK_SECTION			"onchip_memory.isr_stack"
+/* Application task stacks in static arrays rather than on the heap. The heap
+then only holds the TCBs, the idle and timer task stacks, the timer queue
+and the software timers (about 7 KB, and the background daemon's stack and
+queue), so it is trimmed to match and moved to on-chip RAM with the other
+stacks. */
+#ifndef configAPP_STATIC_STACKS
+#define configAPP_STATIC_STACKS			1
+#endif
+/* Bounded time two level segregated fit allocator (heap_tlsf.c) instead of
+the first fit one in heap.c.  newlib's malloc() is routed to it as well, into
+the bulk region below, so the C library's stdio buffers stay off the on-chip
+heap. */
+#ifndef configUSE_TLSF_HEAP
+#define configUSE_TLSF_HEAP				1
+#endif
+#if configUSE_TIMER_BACKGROUND
+#define configTIMER_BACKGROUND_HEAP		( configTIMER_BACKGROUND_STACK_DEPTH * 4 + 512 )
+#else
+#define configTIMER_BACKGROUND_HEAP		0
+#endif
+#if configAPP_STATIC_STACKS
+#define configTOTAL_HEAP_SIZE			( ( size_t ) ( 13312 + configTIMER_BACKGROUND_HEAP ) )
+#define configHEAP_SECTION				"onchip_memory.fast_stack"
+#else
 #define configTOTAL_HEAP_SIZE			( ( size_t ) 512000 )
+#endif
+/* Further TLSF heap regions, see heapREGION_* in portable.h.  The SRAM holds
+the VGA frame and, above it, the kernel trace ring, so there is SRAM heap only
+in builds without the trace, in the ring's 128 KB.  The bulk region is in
+.bss, in the SDRAM; newlib's allocations go there first. */
+#ifndef configHEAP_SRAM_BYTES
+#define configHEAP_SRAM_BYTES			( configUSE_KERNEL_TRACE ? 0 : ( 128 * 1024 ) )
+#endif
+#define configHEAP_SRAM_BASE			( SRAM_BASE + SRAM_SPAN - ( 128 * 1024 ) )
+#ifndef configHEAP_BULK_BYTES
+#define configHEAP_BULK_BYTES			( 64 * 1024 )
+#endif
+/* Allocation tracer, see heap_trace.h: every allocation's call site, size
+and time, and per call site totals, to find what still allocates once the
+scheduler runs.  Needs the TLSF heap, which passes the call site. */
+#ifndef configUSE_HEAP_TRACE
+#define configUSE_HEAP_TRACE			configUSE_TLSF_HEAP
+#endif
+#if configUSE_HEAP_TRACE
+#include "../heap_trace.h"			/* From the application directory */
+#define traceMALLOC_CALLER( pvCaller, pvAddress, uiSize )	vHeapTraceMalloc( ( pvCaller ), ( pvAddress ), ( uiSize ) )
+#define traceFREE( pvAddress, uiSize )	vHeapTraceFree( ( uiSize ) )
+#endif
 #define configMAX_TASK_NAME_LEN			( 8 )
-#define configUSE_TRACE_FACILITY		0
+#define configUSE_TRACE_FACILITY		1
+/* Run time stats count CPU cycles on the timestamp timer, which vLatencyInit()
+starts before the scheduler, and context switches in the switch-in hook.  See
+run_stats.h. */
+#define configGENERATE_RUN_TIME_STATS	1
+extern uint32_t ulRunStatsCounter( void );
+extern void vRunStatsSwitchedIn( unsigned long uxTaskNumber );
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()
+#define portGET_RUN_TIME_COUNTER_VALUE()	ulRunStatsCounter()
+/* CPU budget server for the low priority tasks, see budget_server.h.  Its
+members are the tasks given a task number (vTaskSetTaskNumber). */
+#ifndef configUSE_BUDGET_SERVER
+#define configUSE_BUDGET_SERVER			1
+#endif
+#if configUSE_BUDGET_SERVER
+extern void vBudgetServerSwitchedIn( unsigned long uxTaskNumber );
+#define budgetTASK_SWITCHED_IN()		vBudgetServerSwitchedIn( pxCurrentTCB->uxTaskNumber );
+#else
+#define budgetTASK_SWITCHED_IN()
+#endif
+/* Kernel event recorder, see kernel_trace.h.  The queue numbers it hands out
+replace vQueueSetQueueNumber(), which nothing else uses. */
+#ifndef configUSE_KERNEL_TRACE
+#define configUSE_KERNEL_TRACE			1
+#endif
+#if configUSE_KERNEL_TRACE
+#include "../kernel_trace.h"		/* Event types, from the application directory */
+#define traceTASK_SWITCHED_IN()			{ vRunStatsSwitchedIn( pxCurrentTCB->uxTCBNumber ); budgetTASK_SWITCHED_IN() vKernelTraceSwitchedIn( pxCurrentTCB->uxTCBNumber, pxCurrentTCB->uxPriority ); }
+#define traceMOVED_TASK_TO_READY_STATE( pxTCB )		vKernelTraceEvent( KTRACE_READY, ( pxTCB )->uxTCBNumber );
+#define traceTASK_DELAY()				vKernelTraceEvent( KTRACE_DELAY, 0 )
+#define traceTASK_DELAY_UNTIL()			vKernelTraceEvent( KTRACE_DELAY_UNTIL, 0 )
+#define traceQUEUE_CREATE( pxNewQueue )	( pxNewQueue )->uxQueueNumber = ulKernelTraceQueueCreated( ( pxNewQueue )->ucQueueType )
+#define traceCREATE_MUTEX( pxNewQueue )	( pxNewQueue )->uxQueueNumber = ulKernelTraceQueueCreated( ( pxNewQueue )->ucQueueType )
+#define traceQUEUE_SEND( pxQueue )		vKernelTraceEvent( KTRACE_QUEUE_SEND, ( pxQueue )->uxQueueNumber )
+#define traceQUEUE_SEND_FAILED( pxQueue )	vKernelTraceEvent( KTRACE_QUEUE_SEND_FAILED, ( pxQueue )->uxQueueNumber )
+#define traceQUEUE_RECEIVE( pxQueue )	vKernelTraceEvent( KTRACE_QUEUE_RECEIVE, ( pxQueue )->uxQueueNumber )
+#define traceQUEUE_RECEIVE_FAILED( pxQueue )	vKernelTraceEvent( KTRACE_QUEUE_RECEIVE_FAILED, ( pxQueue )->uxQueueNumber )
+#define traceBLOCKING_ON_QUEUE_SEND( pxQueue )		vKernelTraceEvent( KTRACE_QUEUE_BLOCK_SEND, ( pxQueue )->uxQueueNumber )
+#define traceBLOCKING_ON_QUEUE_RECEIVE( pxQueue )	vKernelTraceEvent( KTRACE_QUEUE_BLOCK_RECEIVE, ( pxQueue )->uxQueueNumber )
+#define traceQUEUE_SEND_FROM_ISR( pxQueue )			vKernelTraceEvent( KTRACE_QUEUE_SEND_ISR, ( pxQueue )->uxQueueNumber )
+#define traceQUEUE_SEND_FROM_ISR_FAILED( pxQueue )	vKernelTraceEvent( KTRACE_QUEUE_SEND_FAILED, ( pxQueue )->uxQueueNumber )
+#define traceQUEUE_RECEIVE_FROM_ISR( pxQueue )		vKernelTraceEvent( KTRACE_QUEUE_RECEIVE_ISR, ( pxQueue )->uxQueueNumber )
+#define traceTASK_NOTIFY_TAKE_BLOCK()	vKernelTraceEvent( KTRACE_NOTIFY_TAKE_BLOCK, 0 )
+#define traceTASK_NOTIFY_TAKE()			vKernelTraceEvent( KTRACE_NOTIFY_TAKE, pxCurrentTCB->ulNotifiedValue )
+#define traceTASK_NOTIFY_WAIT_BLOCK()	vKernelTraceEvent( KTRACE_NOTIFY_WAIT_BLOCK, 0 )
+#define traceTASK_NOTIFY_WAIT()			vKernelTraceEvent( KTRACE_NOTIFY_WAIT, pxCurrentTCB->ulNotifiedValue )
+#define traceTASK_NOTIFY()				vKernelTraceEvent( KTRACE_NOTIFY, pxTCB->uxTCBNumber )
+#define traceTASK_NOTIFY_FROM_ISR()		vKernelTraceEvent( KTRACE_NOTIFY_ISR, pxTCB->uxTCBNumber )
+#define traceTASK_NOTIFY_GIVE_FROM_ISR()	vKernelTraceEvent( KTRACE_NOTIFY_ISR, pxTCB->uxTCBNumber )
+#define traceTIMER_CREATE( pxNewTimer )	( void ) ulKernelTraceTimer( pxNewTimer )
+#define traceTIMER_EXPIRED( pxTimer )	vKernelTraceEvent( KTRACE_TIMER_EXPIRED, ulKernelTraceTimer( pxTimer ) )
+#else
+#define traceTASK_SWITCHED_IN()			{ vRunStatsSwitchedIn( pxCurrentTCB->uxTCBNumber ); budgetTASK_SWITCHED_IN() }
+#endif
+/* Mutex priority inheritance, raised when a task blocks on a mutex held by a
+lower priority task and dropped when the holder gives it back. */
+extern void vRunStatsPriorityInherit( unsigned long uxTaskNumber, unsigned long uxPriority );
+extern void vRunStatsPriorityDisinherit( unsigned long uxTaskNumber, unsigned long uxPriority );
+#define traceTASK_PRIORITY_INHERIT( pxTCB, uxPriority )		vRunStatsPriorityInherit( ( pxTCB )->uxTCBNumber, ( uxPriority ) )
+#define traceTASK_PRIORITY_DISINHERIT( pxTCB, uxPriority )	vRunStatsPriorityDisinherit( ( pxTCB )->uxTCBNumber, ( uxPriority ) )
 #define configUSE_16_BIT_TICKS			0
 #define configIDLE_SHOULD_YIELD			0
 #define configUSE_MUTEXES				1
+/* Mutexes with an immediate priority ceiling, xSemaphoreCreateMutexCeiling()
+in semphr.h. */
+#define configUSE_MUTEX_CEILING			1
+/* Queues keep the most items they ever held, uxQueueMessagesPeak() in
+queue.h, for the memory census. */
+#define configUSE_QUEUE_PEAK			1
+/* Mutexes count their takes, the takes that had to wait, the longest and the
+total wait and the longest hold with its holder, on the run time counter:
+xQueueGetLockProfile() in queue.h. */
+#ifndef configUSE_LOCK_PROFILE
+#define configUSE_LOCK_PROFILE			1
+#endif
+/* Queues, semaphores and mutexes count their sends, receives, the times a
+task blocked on them and the blocks that timed out: xQueueGetCounters() in
+queue.h, read by name through the registry below. */
+#ifndef configUSE_QUEUE_COUNTERS
+#define configUSE_QUEUE_COUNTERS		1
+#endif
+/* The tasks at configEDF_PRIORITY run earliest deadline first (a deadline a
+period after each vTaskDelayUntil() release, see vTaskSetDeadline()), every
+other priority stays fixed.  The band is the background, where the run
+statistics and the flash task would otherwise share the CPU round robin;
+the application gives each task there its period as its deadline.  0 for
+round robin. */
+#ifndef configUSE_EDF_SCHEDULING
+#define configUSE_EDF_SCHEDULING		1
+#endif
+#define configEDF_PRIORITY				1
+/* 2: the tasks that use the C library's state (stdio, errno) get a newlib
+context of their own from the application, vTaskSetNewlibReent() in task.h,
+and the rest share newlib's global one rather than each carrying a _reent in
+its TCB.  newlib's malloc() is the kernel heap (see heap.c), so the BSP's
+empty __malloc_lock() is never relied on. */
+#ifndef configUSE_NEWLIB_REENTRANT
+#define configUSE_NEWLIB_REENTRANT		2
+#endif
 #define configUSE_RECURSIVE_MUTEXES		1
 #define configUSE_COUNTING_SEMAPHORES	1
-#define configCHECK_FOR_STACK_OVERFLOW	2 
-#define configQUEUE_REGISTRY_SIZE		0
+/* 3: the saved stack pointer is checked at each switch and the fill pattern
+at the end of each stack in the background, by the run statistics task (see
+StackMacros.h). 2 compares the pattern at every switch instead. */
+#define configCHECK_FOR_STACK_OVERFLOW	3
+/* Names for the kernel objects the shell's queues command and the
+TELEMETRY_QUEUE records report: the timer services' command queues, the
+JTAG UART's space semaphore, the UART and cursor mutexes and the benchmark's
+queue and mutex. */
+#define configQUEUE_REGISTRY_SIZE		8
+/* No queue sets: no task waits on more than one input.  Keys reach the
+threshold editor as a task notification from the PS/2 ring, the buttons are
+handled in their ISR, the switches (a PIO without an interrupt) are sampled
+by the tick hook and debounced by a timer, and the analyser rings notify the
+analyzer.  A set would mean moving those notifications back onto queues and
+semaphores, which cost more per event. */
+#define configUSE_QUEUE_SETS			0
+/* Task level send and receive of items up to a word with nobody waiting skip
+the general path in queue.c, and items of a word or less are copied without
+memcpy().  0 for the kernel's own paths, to compare with "make bench". */
+#ifndef configUSE_QUEUE_FAST_PATH
+#define configUSE_QUEUE_FAST_PATH		1
+#endif
 
 /* Co-routine definitions. */
-#define configUSE_CO_ROUTINES 			0
+#define configUSE_CO_ROUTINES 			FREQ_UI_COROUTINES
 #define configMAX_CO_ROUTINE_PRIORITIES ( 2 )
 
 /* Set the following definitions to 1 to include the API function, or zero
 to exclude the API function. */
 
-#define INCLUDE_vTaskPrioritySet			0
+/* Fault injection builds ("make faults", see fault_inject.h) move their hog
+task between priorities. */
+#ifndef FREQ_FAULT_INJECT
+#define FREQ_FAULT_INJECT				0
+#endif
+#define INCLUDE_vTaskPrioritySet			FREQ_FAULT_INJECT
 #define INCLUDE_uxTaskPriorityGet			0
 #define INCLUDE_vTaskDelete					1
 #define INCLUDE_vTaskCleanUpResources		1
-#define INCLUDE_vTaskSuspend				0
+#define INCLUDE_vTaskSuspend				1	/* Required by tickless idle */
 #define INCLUDE_vTaskDelayUntil				1
 #define INCLUDE_vTaskDelay					1
 #define INCLUDE_uxTaskGetStackHighWaterMark	1
+#define INCLUDE_xTimerPendFunctionCall		1	/* Deferred interrupt work, see irq_defer.h */
+#define INCLUDE_eTaskGetState				1	/* Benchmark start, see hello_freqRelay.c */
+#define INCLUDE_xTaskGetIdleTaskHandle		1	/* Memory census, display frame governor */
+#define INCLUDE_xTimerGetTimerDaemonTaskHandle	1
+#define INCLUDE_pcTaskGetTaskName			configUSE_LOCK_PROFILE	/* Mutex holders, the shell's locks command */
 
 /* The priority at which the tick interrupt runs.  This should probably be
 kept at 1. */
@@ -135,4 +371,20 @@ be called.  Only API functions that end in ...FromISR() can be used within
 interrupts. */
 #define configMAX_SYSCALL_INTERRUPT_PRIORITY	0x03
 
+/* Nested interrupts, see vPortIrqDispatch() in port.c.  IRQs start at
+configKERNEL_INTERRUPT_PRIORITY and are raised with vPortSetIrqPriority(); a
+handler is only preempted by IRQs of a strictly higher priority. */
+#define configUSE_INTERRUPT_NESTING				1
+
+/* Systems with an altera_vic (port.c): the free VIC input the port raises
+in software to make a context switch a shadow IRQ asked for, the shadow
+register set those IRQs run in, and their stack (words). */
+#define configVIC_YIELD_IRQ						31
+#define configSHADOW_REGISTER_SET				1
+#define configSHADOW_STACK_SIZE					( 256 )
+
+/* IRQs that are never serviced nested: they do not preempt other handlers
+and their own handlers run with interrupts disabled. */
+#define configUNSERVABLE_IRQ_MASK				0x00000000
+
 #endif /* FREERTOS_CONFIG_H */
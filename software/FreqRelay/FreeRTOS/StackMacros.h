@@ -82,6 +82,10 @@
  * to which the bytes were set when the task was created have not been
  * overwritten.  Note this second test does not guarantee that an overflowed
  * stack will always be recognised.
+ *
+ * Setting configCHECK_FOR_STACK_OVERFLOW to 3 keeps only the first check at
+ * the switch and leaves the pattern to a background scan by the application
+ * (vRunStatsSample() in this port), which reports through the same hook.
  */
 
 /*-----------------------------------------------------------*/
@@ -95,10 +99,10 @@
 #endif /* configCHECK_FOR_STACK_OVERFLOW == 0 */
 /*-----------------------------------------------------------*/
 
-#if( configCHECK_FOR_STACK_OVERFLOW == 1 )
+#if( ( configCHECK_FOR_STACK_OVERFLOW == 1 ) || ( configCHECK_FOR_STACK_OVERFLOW == 3 ) )
 
 	/* FreeRTOSConfig.h is only set to use the first method of
-	overflow checking. */
+	overflow checking at the switch. */
 	#define taskSECOND_CHECK_FOR_STACK_OVERFLOW()
 
 #endif
@@ -135,7 +139,7 @@
 #endif /* configCHECK_FOR_STACK_OVERFLOW == 1 */
 /*-----------------------------------------------------------*/
 
-#if( ( configCHECK_FOR_STACK_OVERFLOW > 1 ) && ( portSTACK_GROWTH < 0 ) )
+#if( ( configCHECK_FOR_STACK_OVERFLOW == 2 ) && ( portSTACK_GROWTH < 0 ) )
 
 	#define taskSECOND_CHECK_FOR_STACK_OVERFLOW()																						\
 	{																																	\
@@ -153,10 +157,10 @@
 		}																																\
 	}
 
-#endif /* #if( configCHECK_FOR_STACK_OVERFLOW > 1 ) */
+#endif /* #if( configCHECK_FOR_STACK_OVERFLOW == 2 ) */
 /*-----------------------------------------------------------*/
 
-#if( ( configCHECK_FOR_STACK_OVERFLOW > 1 ) && ( portSTACK_GROWTH > 0 ) )
+#if( ( configCHECK_FOR_STACK_OVERFLOW == 2 ) && ( portSTACK_GROWTH > 0 ) )
 
 	#define taskSECOND_CHECK_FOR_STACK_OVERFLOW()																						\
 	{																																	\
@@ -177,7 +181,7 @@
 		}																																\
 	}
 
-#endif /* #if( configCHECK_FOR_STACK_OVERFLOW > 1 ) */
+#endif /* #if( configCHECK_FOR_STACK_OVERFLOW == 2 ) */
 /*-----------------------------------------------------------*/
 
 #endif /* STACK_MACROS_H */
@@ -84,10 +84,21 @@ task.h is included from an application file. */
 #include "FreeRTOSConfig.h"
 
 #undef MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+/* heap_tlsf.c provides the allocator instead, see configUSE_TLSF_HEAP. */
+#if configUSE_TLSF_HEAP == 0
+
 #define size_t long unsigned int
 /* Block sizes must not get too small. */
 #define heapMINIMUM_BLOCK_SIZE  ( ( size_t ) ( heapSTRUCT_SIZE * 2 ) )
 
+/* Optional linker section for the heap, see FreeRTOSConfig.h. */
+#ifdef configHEAP_SECTION
+        #define heapSECTION __attribute__(( section( configHEAP_SECTION ) ))
+#else
+        #define heapSECTION
+#endif
+
 /* Allocate the memory for the heap.  The struct is used to force byte
 alignment without using any non-portable code. */
 static union xRTOS_HEAP
@@ -98,7 +109,7 @@ static union xRTOS_HEAP
                 volatile unsigned long ulDummy;
         #endif
         unsigned char ucHeap[ configTOTAL_HEAP_SIZE ];
-} xHeap;
+} xHeap heapSECTION;
 
 /* Define the linked list structure.  This is used to link free blocks in order
 of their memory address. */
@@ -355,3 +366,41 @@ unsigned char *puc;
                 pxIterator->pxNextFreeBlock = pxBlockToInsert;
         }
 }
+
+/*-----------------------------------------------------------*/
+
+/*
+ * The Makefile always links with -Wl,--wrap for newlib's reentrant allocator
+ * entry points so heap_tlsf.c can take them over.  With this allocator newlib
+ * keeps its own heap, so the wrappers just pass through.
+ */
+#include <reent.h>
+
+#undef size_t
+
+extern void *__real__malloc_r( struct _reent *pxReent, size_t xSize );
+extern void __real__free_r( struct _reent *pxReent, void *pv );
+extern void *__real__calloc_r( struct _reent *pxReent, size_t xCount, size_t xSize );
+extern void *__real__realloc_r( struct _reent *pxReent, void *pv, size_t xSize );
+
+void *__wrap__malloc_r( struct _reent *pxReent, size_t xSize )
+{
+        return __real__malloc_r( pxReent, xSize );
+}
+
+void __wrap__free_r( struct _reent *pxReent, void *pv )
+{
+        __real__free_r( pxReent, pv );
+}
+
+void *__wrap__calloc_r( struct _reent *pxReent, size_t xCount, size_t xSize )
+{
+        return __real__calloc_r( pxReent, xCount, xSize );
+}
+
+void *__wrap__realloc_r( struct _reent *pxReent, void *pv, size_t xSize )
+{
+        return __real__realloc_r( pxReent, pv, xSize );
+}
+
+#endif /* configUSE_TLSF_HEAP */
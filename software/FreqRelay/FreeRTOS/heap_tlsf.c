@@ -0,0 +1,718 @@
+/*
+ * Two level segregated fit (TLSF) implementation of pvPortMalloc() and
+ * vPortFree(), selected with configUSE_TLSF_HEAP in FreeRTOSConfig.h in place
+ * of the first fit allocator in heap.c.
+ *
+ * Free blocks are kept in one list per size class.  The first level splits
+ * sizes by power of two, the second level splits each power of two into
+ * tlsfSL_COUNT linear steps, and a bitmap at each level records which lists
+ * hold blocks.  Finding a block is two bit scans and freeing one merges it
+ * with its physical neighbours through boundary tags, so both take the same
+ * time whatever the fragmentation, and the scheduler is only suspended for
+ * that fixed time.
+ *
+ * With the TLSF heap, newlib's reentrant allocator entry points are routed
+ * here too (the Makefile links with --wrap for them, see the end of this
+ * file), so printf() and the HAL share the one bounded time heap.
+ *
+ * The heap spans up to three memory regions, each its own TLSF pool (see
+ * heapREGION_* in portable.h): the fast region, configTOTAL_HEAP_SIZE bytes
+ * in configHEAP_SECTION, a normal one of configHEAP_SRAM_BYTES in the SRAM
+ * and a bulk one of configHEAP_BULK_BYTES in .bss.  pvPortMallocRegion()
+ * takes the region as a placement hint and falls back to the slower regions
+ * and then the faster ones when it is full; vPortFree() finds the region
+ * from the address.  The kernel's own allocations are fast and newlib's are
+ * bulk, so stdio buffers stay out of on-chip RAM.
+ *
+ * Once the application has made everything it needs, vPortHeapFreeze()
+ * turns every later allocation away at once: it returns NULL without
+ * touching the pools, so nothing after that point pays the allocator's time
+ * or can fragment the heap, and the refusal reaches traceMALLOC_CALLER()
+ * like any failure.  Frees still work.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <reent.h>
+
+/* Defining MPU_WRAPPERS_INCLUDED_FROM_API_FILE prevents task.h from redefining
+all the API functions to use the MPU wrappers.  That should only be done when
+task.h is included from an application file. */
+#define MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#undef MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#if configUSE_TLSF_HEAP == 1
+
+/* Blocks and user pointers are 8 byte aligned, like newlib's own malloc. */
+#define tlsfALIGN_LOG2			3
+#define tlsfALIGN				( ( size_t ) 1 << tlsfALIGN_LOG2 )
+
+/* Second level: each power of two is split into 16 lists. */
+#define tlsfSL_LOG2				4
+#define tlsfSL_COUNT			( 1 << tlsfSL_LOG2 )
+
+/* Below this size the first level is linear, one list per alignment step. */
+#define tlsfFL_SHIFT			( tlsfSL_LOG2 + tlsfALIGN_LOG2 )
+#define tlsfSMALL_BLOCK			( ( size_t ) 1 << tlsfFL_SHIFT )
+
+/* Largest block is just under 2^tlsfFL_INDEX_MAX bytes (1 MB). */
+#define tlsfFL_INDEX_MAX		20
+#define tlsfFL_COUNT			( tlsfFL_INDEX_MAX - tlsfFL_SHIFT + 1 )
+
+/* Flags kept in the low bits of the block size. */
+#define tlsfBLOCK_FREE			( ( size_t ) 1 )
+#define tlsfPREV_FREE			( ( size_t ) 2 )
+#define tlsfFLAGS				( tlsfBLOCK_FREE | tlsfPREV_FREE )
+
+/* Optional linker section for the heap, see FreeRTOSConfig.h. */
+#ifdef configHEAP_SECTION
+	#define heapSECTION __attribute__(( section( configHEAP_SECTION ) ))
+#else
+	#define heapSECTION
+#endif
+
+/* Block header.  pxPrevPhys is only valid while the previous block is free
+(tlsfPREV_FREE set), and the free list links only exist in free blocks:
+an allocated block carries the first two words only. */
+typedef struct TLSF_BLOCK
+{
+	struct TLSF_BLOCK *pxPrevPhys;	/*<< Block physically before this one. */
+	size_t xSize;					/*<< Whole block size including the header, and the flags. */
+	struct TLSF_BLOCK *pxNextFree;	/*<< Next block in the same size class. */
+	struct TLSF_BLOCK *pxPrevFree;	/*<< Previous block in the same size class. */
+} TlsfBlock_t;
+
+#define tlsfHEADER_SIZE			( ( size_t ) offsetof( TlsfBlock_t, pxNextFree ) )
+#define tlsfMIN_BLOCK			( ( size_t ) sizeof( TlsfBlock_t ) )
+
+/* The fast region, 8 byte aligned. */
+static union xRTOS_HEAP
+{
+	volatile portDOUBLE dDummy;
+	unsigned char ucHeap[ configTOTAL_HEAP_SIZE ];
+} xHeap heapSECTION;
+
+/* The bulk region, in .bss. */
+#if configHEAP_BULK_BYTES > 0
+	static union xRTOS_BULK_HEAP
+	{
+		volatile portDOUBLE dDummy;
+		unsigned char ucHeap[ configHEAP_BULK_BYTES ];
+	} xBulkHeap;
+#endif
+
+/* One allocator per region.  The size class bitmaps and list heads of all of
+them are kept next to the fast region, so the bookkeeping is fast whichever
+memory the blocks are in. */
+typedef struct TLSF_POOL
+{
+	unsigned char *pucHeap;
+	size_t xConfiguredBytes;
+	uint32_t ulFLBitmap;
+	uint32_t ulSLBitmap[ tlsfFL_COUNT ];
+	TlsfBlock_t *pxFreeLists[ tlsfFL_COUNT ][ tlsfSL_COUNT ];
+
+	/* Statistics, see vPortGetHeapRegionStats(). */
+	size_t xTotalBytes;
+	size_t xFreeBytesRemaining;
+	size_t xMinimumEverFreeBytesRemaining;
+	size_t xFreeBlocks;
+	size_t xAllocations;
+	size_t xFrees;
+	size_t xFailedAllocations;
+	BaseType_t xInitialised;
+} TlsfPool_t;
+
+static TlsfPool_t xPools[ heapREGIONS ] heapSECTION;
+
+/* Set by vPortHeapFreeze(), and the allocations refused since. */
+static volatile BaseType_t xHeapFrozen = pdFALSE;
+static size_t xRefusedAllocations = 0;
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Index of the highest set bit of a non-zero word.  The Nios II has no count
+ * leading zeros instruction, so as in portmacro.h the bit is smeared down and
+ * identified with a de Bruijn multiply.
+ */
+static inline uint32_t prvHighestBit( uint32_t ulBits );
+
+/* Index of the lowest set bit of a non-zero word. */
+static inline uint32_t prvLowestBit( uint32_t ulBits );
+
+/* Size class of a block of xSize bytes. */
+static void prvMapping( size_t xSize, uint32_t *pulFL, uint32_t *pulSL );
+
+/* Add a free block to, or take it off, the list of its size class. */
+static void prvInsertFreeBlock( TlsfPool_t *pxPool, TlsfBlock_t *pxBlock );
+static void prvRemoveFreeBlock( TlsfPool_t *pxPool, TlsfBlock_t *pxBlock );
+
+/* Set up every region, each as a single free block and the end marker, on
+the first allocation. */
+static void prvHeapInit( void );
+static void prvPoolInit( TlsfPool_t *pxPool );
+
+/* An allocation from one region, NULL if it has no block large enough.
+With the scheduler suspended. */
+static void *prvPoolMalloc( TlsfPool_t *pxPool, size_t xWantedSize );
+
+/* Region of a block allocated from the heap. */
+static TlsfPool_t *prvPoolOf( const void *pv );
+
+/*-----------------------------------------------------------*/
+
+static inline size_t prvBlockSize( const TlsfBlock_t *pxBlock )
+{
+	return pxBlock->xSize & ~tlsfFLAGS;
+}
+
+static inline TlsfBlock_t *prvNextPhys( const TlsfBlock_t *pxBlock )
+{
+	return ( TlsfBlock_t * ) ( ( ( unsigned char * ) pxBlock ) + prvBlockSize( pxBlock ) );
+}
+/*-----------------------------------------------------------*/
+
+static inline uint32_t prvHighestBit( uint32_t ulBits )
+{
+static const uint8_t ucDeBruijnBit[ 32 ] =
+{
+	0, 9, 1, 10, 13, 21, 2, 29, 11, 14, 16, 18, 22, 25, 3, 30,
+	8, 12, 20, 28, 15, 17, 24, 7, 19, 27, 23, 6, 26, 5, 4, 31
+};
+
+	ulBits |= ulBits >> 1;
+	ulBits |= ulBits >> 2;
+	ulBits |= ulBits >> 4;
+	ulBits |= ulBits >> 8;
+	ulBits |= ulBits >> 16;
+	return ucDeBruijnBit[ ( uint32_t ) ( ulBits * 0x07C4ACDDUL ) >> 27 ];
+}
+/*-----------------------------------------------------------*/
+
+static inline uint32_t prvLowestBit( uint32_t ulBits )
+{
+	return prvHighestBit( ulBits & ( 0UL - ulBits ) );
+}
+/*-----------------------------------------------------------*/
+
+static void prvMapping( size_t xSize, uint32_t *pulFL, uint32_t *pulSL )
+{
+uint32_t ulTop;
+
+	if( xSize < tlsfSMALL_BLOCK )
+	{
+		*pulFL = 0;
+		*pulSL = ( uint32_t ) ( xSize >> tlsfALIGN_LOG2 );
+	}
+	else
+	{
+		ulTop = prvHighestBit( ( uint32_t ) xSize );
+		*pulSL = ( uint32_t ) ( xSize >> ( ulTop - tlsfSL_LOG2 ) ) ^ ( 1UL << tlsfSL_LOG2 );
+		*pulFL = ulTop - ( tlsfFL_SHIFT - 1 );
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvInsertFreeBlock( TlsfPool_t *pxPool, TlsfBlock_t *pxBlock )
+{
+uint32_t ulFL, ulSL;
+TlsfBlock_t *pxHead;
+
+	prvMapping( prvBlockSize( pxBlock ), &ulFL, &ulSL );
+	pxHead = pxPool->pxFreeLists[ ulFL ][ ulSL ];
+
+	pxBlock->pxNextFree = pxHead;
+	pxBlock->pxPrevFree = NULL;
+	if( pxHead != NULL )
+	{
+		pxHead->pxPrevFree = pxBlock;
+	}
+	pxPool->pxFreeLists[ ulFL ][ ulSL ] = pxBlock;
+
+	pxPool->ulFLBitmap |= 1UL << ulFL;
+	pxPool->ulSLBitmap[ ulFL ] |= 1UL << ulSL;
+	pxPool->xFreeBlocks++;
+}
+/*-----------------------------------------------------------*/
+
+static void prvRemoveFreeBlock( TlsfPool_t *pxPool, TlsfBlock_t *pxBlock )
+{
+uint32_t ulFL, ulSL;
+
+	prvMapping( prvBlockSize( pxBlock ), &ulFL, &ulSL );
+
+	if( pxBlock->pxNextFree != NULL )
+	{
+		pxBlock->pxNextFree->pxPrevFree = pxBlock->pxPrevFree;
+	}
+	if( pxBlock->pxPrevFree != NULL )
+	{
+		pxBlock->pxPrevFree->pxNextFree = pxBlock->pxNextFree;
+	}
+	else
+	{
+		/* Was the head, the list may now be empty. */
+		pxPool->pxFreeLists[ ulFL ][ ulSL ] = pxBlock->pxNextFree;
+		if( pxBlock->pxNextFree == NULL )
+		{
+			pxPool->ulSLBitmap[ ulFL ] &= ~( 1UL << ulSL );
+			if( pxPool->ulSLBitmap[ ulFL ] == 0 )
+			{
+				pxPool->ulFLBitmap &= ~( 1UL << ulFL );
+			}
+		}
+	}
+	pxPool->xFreeBlocks--;
+}
+/*-----------------------------------------------------------*/
+
+static void prvHeapInit( void )
+{
+UBaseType_t ux;
+
+	memset( xPools, 0, sizeof( xPools ) );
+	xPools[ heapREGION_FAST ].pucHeap = xHeap.ucHeap;
+	xPools[ heapREGION_FAST ].xConfiguredBytes = configTOTAL_HEAP_SIZE;
+	#if configHEAP_SRAM_BYTES > 0
+		xPools[ heapREGION_NORMAL ].pucHeap = ( unsigned char * ) configHEAP_SRAM_BASE;
+		xPools[ heapREGION_NORMAL ].xConfiguredBytes = configHEAP_SRAM_BYTES;
+	#endif
+	#if configHEAP_BULK_BYTES > 0
+		xPools[ heapREGION_BULK ].pucHeap = xBulkHeap.ucHeap;
+		xPools[ heapREGION_BULK ].xConfiguredBytes = configHEAP_BULK_BYTES;
+	#endif
+
+	for( ux = 0; ux < heapREGIONS; ux++ )
+	{
+		prvPoolInit( &xPools[ ux ] );
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvPoolInit( TlsfPool_t *pxPool )
+{
+TlsfBlock_t *pxFirstFreeBlock, *pxEnd;
+
+	pxPool->xInitialised = pdTRUE;
+
+	/* Both the region and every block size are multiples of the alignment.
+	A region too small for a block and the end marker is left empty. */
+	pxPool->xTotalBytes = pxPool->xConfiguredBytes & ~( tlsfALIGN - 1 );
+	if( pxPool->xTotalBytes < 2 * tlsfMIN_BLOCK )
+	{
+		pxPool->xTotalBytes = 0;
+		return;
+	}
+	configASSERT( ( ( ( unsigned long ) pxPool->pucHeap ) & ( tlsfALIGN - 1 ) ) == 0UL );
+	configASSERT( pxPool->xTotalBytes < ( ( size_t ) 1 << tlsfFL_INDEX_MAX ) );
+
+	/* A zero sized allocated block at the end stops merging beyond the
+	region.  It is given a whole minimum block so the full header fits. */
+	pxEnd = ( TlsfBlock_t * ) ( pxPool->pucHeap + pxPool->xTotalBytes - tlsfMIN_BLOCK );
+	pxEnd->xSize = tlsfPREV_FREE;
+
+	/* Everything else is one free block.  Nothing precedes it, so it is never
+	merged backwards. */
+	pxFirstFreeBlock = ( TlsfBlock_t * ) pxPool->pucHeap;
+	pxFirstFreeBlock->pxPrevPhys = NULL;
+	pxFirstFreeBlock->xSize = ( pxPool->xTotalBytes - tlsfMIN_BLOCK ) | tlsfBLOCK_FREE;
+	pxEnd->pxPrevPhys = pxFirstFreeBlock;
+	prvInsertFreeBlock( pxPool, pxFirstFreeBlock );
+
+	pxPool->xFreeBytesRemaining = pxPool->xTotalBytes - tlsfMIN_BLOCK;
+	pxPool->xMinimumEverFreeBytesRemaining = pxPool->xFreeBytesRemaining;
+}
+/*-----------------------------------------------------------*/
+
+static TlsfPool_t *prvPoolOf( const void *pv )
+{
+const unsigned char *puc = ( const unsigned char * ) pv;
+UBaseType_t ux;
+
+	for( ux = 0; ux < heapREGIONS; ux++ )
+	{
+		if( ( puc >= xPools[ ux ].pucHeap ) && ( puc < xPools[ ux ].pucHeap + xPools[ ux ].xTotalBytes ) )
+		{
+			return &xPools[ ux ];
+		}
+	}
+	return NULL;
+}
+/*-----------------------------------------------------------*/
+
+static void *prvPoolMalloc( TlsfPool_t *pxPool, size_t xWantedSize )
+{
+TlsfBlock_t *pxBlock, *pxRemainder;
+size_t xBlockSize, xSearchSize;
+uint32_t ulFL, ulSL, ulMap;
+
+	if( xWantedSize >= pxPool->xTotalBytes )
+	{
+		return NULL;
+	}
+
+	/* Room for the header, rounded up to the alignment and at least large
+	enough to hold the free list links once it is freed again. */
+	xBlockSize = ( xWantedSize + tlsfHEADER_SIZE + tlsfALIGN - 1 ) & ~( tlsfALIGN - 1 );
+	if( xBlockSize < tlsfMIN_BLOCK )
+	{
+		xBlockSize = tlsfMIN_BLOCK;
+	}
+
+	/* Round the search up to the next size class, so that any block in
+	the class found is large enough and no list has to be walked. */
+	xSearchSize = xBlockSize;
+	if( xSearchSize >= tlsfSMALL_BLOCK )
+	{
+		xSearchSize += ( ( size_t ) 1 << ( prvHighestBit( ( uint32_t ) xSearchSize ) - tlsfSL_LOG2 ) ) - 1;
+	}
+	prvMapping( xSearchSize, &ulFL, &ulSL );
+
+	pxBlock = NULL;
+	if( ulFL < tlsfFL_COUNT )
+	{
+		/* A list in this first level class at or above the second level
+		class, or failing that the smallest list of a larger class. */
+		ulMap = pxPool->ulSLBitmap[ ulFL ] & ( ~0UL << ulSL );
+		if( ulMap == 0 )
+		{
+			ulMap = ( ulFL + 1 < tlsfFL_COUNT ) ? ( pxPool->ulFLBitmap & ( ~0UL << ( ulFL + 1 ) ) ) : 0;
+			if( ulMap != 0 )
+			{
+				ulFL = prvLowestBit( ulMap );
+				ulMap = pxPool->ulSLBitmap[ ulFL ];
+			}
+		}
+		if( ulMap != 0 )
+		{
+			ulSL = prvLowestBit( ulMap );
+			pxBlock = pxPool->pxFreeLists[ ulFL ][ ulSL ];
+		}
+	}
+
+	if( pxBlock == NULL )
+	{
+		return NULL;
+	}
+
+	prvRemoveFreeBlock( pxPool, pxBlock );
+
+	if( prvBlockSize( pxBlock ) - xBlockSize >= tlsfMIN_BLOCK )
+	{
+		/* Split, the tail stays free and its successor keeps its
+		tlsfPREV_FREE flag. */
+		pxRemainder = ( TlsfBlock_t * ) ( ( ( unsigned char * ) pxBlock ) + xBlockSize );
+		pxRemainder->pxPrevPhys = pxBlock;
+		pxRemainder->xSize = ( prvBlockSize( pxBlock ) - xBlockSize ) | tlsfBLOCK_FREE;
+		prvNextPhys( pxRemainder )->pxPrevPhys = pxRemainder;
+		prvInsertFreeBlock( pxPool, pxRemainder );
+
+		pxBlock->xSize = xBlockSize | ( pxBlock->xSize & tlsfPREV_FREE );
+	}
+	else
+	{
+		pxBlock->xSize &= ~tlsfBLOCK_FREE;
+		prvNextPhys( pxBlock )->xSize &= ~tlsfPREV_FREE;
+	}
+
+	pxPool->xFreeBytesRemaining -= prvBlockSize( pxBlock );
+	if( pxPool->xFreeBytesRemaining < pxPool->xMinimumEverFreeBytesRemaining )
+	{
+		pxPool->xMinimumEverFreeBytesRemaining = pxPool->xFreeBytesRemaining;
+	}
+	pxPool->xAllocations++;
+	return ( void * ) ( ( ( unsigned char * ) pxBlock ) + tlsfHEADER_SIZE );
+}
+/*-----------------------------------------------------------*/
+
+/* pvCaller: the return address of the entry point called, for
+traceMALLOC_CALLER(). */
+static void *prvMallocRegion( size_t xWantedSize, UBaseType_t uxRegion, void *pvCaller )
+{
+void *pvReturn = NULL;
+UBaseType_t ux;
+
+	configASSERT( uxRegion < heapREGIONS );
+
+	vTaskSuspendAll();
+	{
+		if( xPools[ heapREGION_FAST ].xInitialised == pdFALSE )
+		{
+			prvHeapInit();
+		}
+
+		if( xHeapFrozen != pdFALSE )
+		{
+			/* Refused without looking, see vPortHeapFreeze(). */
+			xRefusedAllocations++;
+		}
+		else if( xWantedSize > 0 )
+		{
+			/* The region asked for, then the slower ones, then the faster. */
+			for( ux = uxRegion; ( ux < heapREGIONS ) && ( pvReturn == NULL ); ux++ )
+			{
+				pvReturn = prvPoolMalloc( &xPools[ ux ], xWantedSize );
+			}
+			for( ux = uxRegion; ( ux-- > 0 ) && ( pvReturn == NULL ); )
+			{
+				pvReturn = prvPoolMalloc( &xPools[ ux ], xWantedSize );
+			}
+			if( pvReturn == NULL )
+			{
+				xPools[ uxRegion ].xFailedAllocations++;
+			}
+		}
+	}
+	( void ) xTaskResumeAll();
+
+	traceMALLOC_CALLER( pvCaller, pvReturn, xWantedSize );
+
+	#if( configUSE_MALLOC_FAILED_HOOK == 1 )
+	{
+		if( ( pvReturn == NULL ) && ( xWantedSize > 0 ) )
+		{
+			extern void vApplicationMallocFailedHook( void );
+			vApplicationMallocFailedHook();
+		}
+	}
+	#endif
+
+	return pvReturn;
+}
+/*-----------------------------------------------------------*/
+
+void *pvPortMallocRegion( size_t xWantedSize, UBaseType_t uxRegion )
+{
+	return prvMallocRegion( xWantedSize, uxRegion, __builtin_return_address( 0 ) );
+}
+/*-----------------------------------------------------------*/
+
+void *pvPortMalloc( size_t xWantedSize )
+{
+	/* The kernel's objects: TCBs, stacks, queues and timers. */
+	return prvMallocRegion( xWantedSize, heapREGION_FAST, __builtin_return_address( 0 ) );
+}
+/*-----------------------------------------------------------*/
+
+void vPortFree( void *pv )
+{
+TlsfBlock_t *pxBlock, *pxNeighbour;
+TlsfPool_t *pxPool;
+
+	if( pv == NULL )
+	{
+		return;
+	}
+
+	pxBlock = ( TlsfBlock_t * ) ( ( ( unsigned char * ) pv ) - tlsfHEADER_SIZE );
+	configASSERT( ( pxBlock->xSize & tlsfBLOCK_FREE ) == 0 );
+	pxPool = prvPoolOf( pxBlock );
+	configASSERT( pxPool != NULL );
+
+	traceFREE( pv, prvBlockSize( pxBlock ) );
+
+	vTaskSuspendAll();
+	{
+		pxPool->xFreeBytesRemaining += prvBlockSize( pxBlock );
+		pxPool->xFrees++;
+
+		/* Merge with the block before, if it is free. */
+		if( ( pxBlock->xSize & tlsfPREV_FREE ) != 0 )
+		{
+			pxNeighbour = pxBlock->pxPrevPhys;
+			prvRemoveFreeBlock( pxPool, pxNeighbour );
+			pxNeighbour->xSize += prvBlockSize( pxBlock );
+			pxBlock = pxNeighbour;
+		}
+		else
+		{
+			pxBlock->xSize |= tlsfBLOCK_FREE;
+		}
+
+		/* And with the block after.  The end marker is never free. */
+		pxNeighbour = prvNextPhys( pxBlock );
+		if( ( pxNeighbour->xSize & tlsfBLOCK_FREE ) != 0 )
+		{
+			prvRemoveFreeBlock( pxPool, pxNeighbour );
+			pxBlock->xSize += prvBlockSize( pxNeighbour );
+			pxNeighbour = prvNextPhys( pxBlock );
+		}
+
+		pxNeighbour->pxPrevPhys = pxBlock;
+		pxNeighbour->xSize |= tlsfPREV_FREE;
+		prvInsertFreeBlock( pxPool, pxBlock );
+	}
+	( void ) xTaskResumeAll();
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetFreeHeapSize( void )
+{
+	return ( xPools[ heapREGION_FAST ].xInitialised != pdFALSE ) ?
+		xPools[ heapREGION_FAST ].xFreeBytesRemaining : ( ( size_t ) configTOTAL_HEAP_SIZE );
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetMinimumEverFreeHeapSize( void )
+{
+	return ( xPools[ heapREGION_FAST ].xInitialised != pdFALSE ) ?
+		xPools[ heapREGION_FAST ].xMinimumEverFreeBytesRemaining : ( ( size_t ) configTOTAL_HEAP_SIZE );
+}
+/*-----------------------------------------------------------*/
+
+void vPortGetHeapRegionStats( UBaseType_t uxRegion, HeapStats_t *pxHeapStats )
+{
+TlsfPool_t *pxPool;
+TlsfBlock_t *pxBlock;
+uint32_t ulFL, ulSL;
+size_t xLargest = 0;
+
+	configASSERT( uxRegion < heapREGIONS );
+	pxPool = &xPools[ uxRegion ];
+
+	vTaskSuspendAll();
+	{
+		if( xPools[ heapREGION_FAST ].xInitialised == pdFALSE )
+		{
+			prvHeapInit();
+		}
+
+		/* The largest free block is in the highest non-empty list.  That list
+		is walked, so this is for diagnostics only. */
+		if( pxPool->ulFLBitmap != 0 )
+		{
+			ulFL = prvHighestBit( pxPool->ulFLBitmap );
+			ulSL = prvHighestBit( pxPool->ulSLBitmap[ ulFL ] );
+			for( pxBlock = pxPool->pxFreeLists[ ulFL ][ ulSL ]; pxBlock != NULL; pxBlock = pxBlock->pxNextFree )
+			{
+				if( prvBlockSize( pxBlock ) > xLargest )
+				{
+					xLargest = prvBlockSize( pxBlock );
+				}
+			}
+		}
+
+		pxHeapStats->xTotalBytes = pxPool->xTotalBytes;
+		pxHeapStats->xFreeBytes = pxPool->xFreeBytesRemaining;
+		pxHeapStats->xMinimumEverFreeBytes = pxPool->xMinimumEverFreeBytesRemaining;
+		pxHeapStats->xLargestFreeBlock = ( xLargest > tlsfHEADER_SIZE ) ? xLargest - tlsfHEADER_SIZE : 0;
+		pxHeapStats->xFreeBlocks = pxPool->xFreeBlocks;
+		pxHeapStats->xAllocations = pxPool->xAllocations;
+		pxHeapStats->xFrees = pxPool->xFrees;
+		pxHeapStats->xFailedAllocations = pxPool->xFailedAllocations;
+	}
+	( void ) xTaskResumeAll();
+
+	/* Share of the free space that cannot be had in one piece. */
+	pxHeapStats->ulFragmentationPermille = ( pxHeapStats->xFreeBytes > 0 ) ?
+		( uint32_t ) ( 1000 - ( ( ( uint64_t ) xLargest * 1000 ) / pxHeapStats->xFreeBytes ) ) : 0;
+}
+/*-----------------------------------------------------------*/
+
+void vPortGetHeapStats( HeapStats_t *pxHeapStats )
+{
+	vPortGetHeapRegionStats( heapREGION_FAST, pxHeapStats );
+}
+/*-----------------------------------------------------------*/
+
+void vPortHeapFreeze( void )
+{
+	xHeapFrozen = pdTRUE;
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t xPortHeapFrozen( void )
+{
+	return xHeapFrozen;
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetRefusedAllocations( void )
+{
+	return xRefusedAllocations;
+}
+/*-----------------------------------------------------------*/
+
+void vPortInitialiseBlocks( void )
+{
+	/* This just exists to keep the linker quiet. */
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * newlib allocator entry points, linked in place of newlib's own with
+ * -Wl,--wrap (see the Makefile).  newlib's malloc(), free() and friends, and
+ * everything inside the C library that allocates, such as stdio buffers, go
+ * through these reentrant forms.
+ */
+void *__wrap__malloc_r( struct _reent *pxReent, size_t xSize )
+{
+	( void ) pxReent;
+	return prvMallocRegion( xSize, heapREGION_BULK, __builtin_return_address( 0 ) );
+}
+
+void __wrap__free_r( struct _reent *pxReent, void *pv )
+{
+	( void ) pxReent;
+	vPortFree( pv );
+}
+
+void *__wrap__calloc_r( struct _reent *pxReent, size_t xCount, size_t xSize )
+{
+void *pv;
+
+	( void ) pxReent;
+	if( ( xSize != 0 ) && ( xCount > ( ( size_t ) -1 ) / xSize ) )
+	{
+		return NULL;
+	}
+	pv = prvMallocRegion( xCount * xSize, heapREGION_BULK, __builtin_return_address( 0 ) );
+	if( pv != NULL )
+	{
+		memset( pv, 0, xCount * xSize );
+	}
+	return pv;
+}
+
+void *__wrap__realloc_r( struct _reent *pxReent, void *pv, size_t xSize )
+{
+TlsfBlock_t *pxBlock;
+TlsfPool_t *pxPool;
+size_t xHave;
+void *pvNew;
+
+	( void ) pxReent;
+	if( pv == NULL )
+	{
+		return prvMallocRegion( xSize, heapREGION_BULK, __builtin_return_address( 0 ) );
+	}
+	if( xSize == 0 )
+	{
+		vPortFree( pv );
+		return NULL;
+	}
+
+	/* Keep the block if it is already large enough. */
+	pxBlock = ( TlsfBlock_t * ) ( ( ( unsigned char * ) pv ) - tlsfHEADER_SIZE );
+	xHave = prvBlockSize( pxBlock ) - tlsfHEADER_SIZE;
+	if( xSize <= xHave )
+	{
+		return pv;
+	}
+
+	/* Where the block is now, a block from the kernel staying fast. */
+	pxPool = prvPoolOf( pxBlock );
+	pvNew = prvMallocRegion( xSize, ( UBaseType_t ) ( pxPool - xPools ), __builtin_return_address( 0 ) );
+	if( pvNew != NULL )
+	{
+		memcpy( pvNew, pv, xHave );
+		vPortFree( pv );
+	}
+	return pvNew;
+}
+
+#endif /* configUSE_TLSF_HEAP */
@@ -76,6 +76,7 @@
 #include <errno.h>
 
 /* Altera includes. */
+#include "nios2.h"
 #include "sys/alt_irq.h"
 #include "altera_avalon_timer_regs.h"
 #include "priv/alt_irq_table.h"
@@ -84,12 +85,71 @@
 #include "FreeRTOS.h"
 #include "task.h"
 
-/* Interrupts are enabled. */
-#define portINITIAL_ESTATUS     ( StackType_t ) 0x01 
+#if portUSE_VIC == 1
+	#include "io.h"
+
+	#ifndef VIC_BASE
+		#error "An EIC system needs an altera_vic named vic, VIC in system.h"
+	#endif
+	#if NIOS2_NUM_OF_SHADOW_REG_SETS < 1
+		#error "The port's shadow IRQs need a CPU with shadow register sets"
+	#endif
+
+	/* altera_vic registers, in words from VIC_BASE. */
+	#define portVIC_INT_CONFIG( irq )		( irq )
+	#define portVIC_INT_ENABLE_SET			( 33 )
+	#define portVIC_INT_ENABLE_CLR			( 34 )
+	#define portVIC_INT_PENDING				( 35 )	/* Asserted and enabled */
+	#define portVIC_SW_INT_SET				( 38 )
+	#define portVIC_SW_INT_CLR				( 39 )
+	#define portVIC_CONFIG					( 40 )
+	#define portVIC_VEC_TBL_BASE			( 42 )
+	#define portVIC_INT_CONFIG_RRS_OFST		( 7 )	/* RIL in the low bits */
+	#define portVIC_CONFIG_VEC_32			( 3 )	/* 32 byte entries, as port_asm.S */
+	#define portVIC_IRQS					( 32 )
+
+	/* Interrupt levels the VIC presents: interrupt priority p at p + 1, the
+	yield request below them all at 1 and the shadow IRQs above them all.
+	The CPU takes an interrupt whose level is above status.IL, so a handler
+	run at its own level is only preempted by higher priorities, as the
+	internal controller's ienable masks do. */
+	#define portVIC_LEVEL( uxPriority )		( ( uint32_t ) ( uxPriority ) + 1UL )
+	#define portVIC_YIELD_LEVEL				( 1UL )
+	#define portVIC_SHADOW_LEVEL			portVIC_LEVEL( configMAX_SYSCALL_INTERRUPT_PRIORITY + 1 )
+
+	#ifndef configVIC_YIELD_IRQ
+		#define configVIC_YIELD_IRQ			( 31 )
+	#endif
+	#ifndef configSHADOW_REGISTER_SET
+		#define configSHADOW_REGISTER_SET	( 1 )
+	#endif
+	#ifndef configSHADOW_STACK_SIZE
+		#define configSHADOW_STACK_SIZE		( 256 )
+	#endif
+
+	#define portIRQS						portVIC_IRQS
+	#define portREAD_PENDING( ulPending )	( ulPending ) = IORD( VIC_BASE, portVIC_INT_PENDING )
+
+	/* Interrupts enabled, nested ones in register set 0 as well. */
+	#define portINITIAL_ESTATUS				( StackType_t ) ( NIOS2_STATUS_PIE_MSK | NIOS2_STATUS_RSIE_MSK )
+#else
+	#define portIRQS						ALT_NIRQ
+	#define portREAD_PENDING( ulPending )	NIOS2_READ_IPENDING( ulPending )
+
+	/* Interrupts are enabled. */
+	#define portINITIAL_ESTATUS     ( StackType_t ) 0x01 
+#endif
 #define SYS_CLK_BASE TIMER1MS_BASE
 #define configTICK_RATE_HZ 1000
 #define configCPU_CLOCK_HZ TIMER1MS_FREQ
 #define SYS_CLK_IRQ TIMER1MS_IRQ
+
+#ifndef configUSE_INTERRUPT_NESTING
+	#define configUSE_INTERRUPT_NESTING 0
+#endif
+#ifndef configUNSERVABLE_IRQ_MASK
+	#define configUNSERVABLE_IRQ_MASK 0
+#endif
 //stack overflow hook
 void vApplicationStackOverflowHook(TaskHandle_t *pxTask, signed char *pcTaskName )
 {
@@ -108,6 +168,119 @@ static void prvSetupTimerInterrupt( void );
  */
 void vPortSysTickHandler( void * context, alt_u32 id );
 
+/*
+ * Interrupt dispatcher, called from port_asm.S in place of the HAL's
+ * alt_irq_handler().
+ */
+void vPortIrqDispatch( void ) __attribute__ (( section( ".exceptions" ) ));
+
+#if portUSE_VIC == 1
+	/*
+	 * Handler of a shadow IRQ, called from the IRQ's vector in port_asm.S.
+	 */
+	void vPortShadowDispatch( uint32_t ulIrq ) __attribute__ (( section( ".exceptions" ) ));
+
+	/* Vector table in port_asm.S. */
+	extern const uint32_t xPortVicVectors[];
+
+	/* The HAL builds neither the legacy handler table nor the legacy API
+	for an EIC, so the port keeps its own. */
+	static struct
+	{
+		void ( *handler )( void *, alt_u32 );
+		void *context;
+	} xPortIrqTable[ portVIC_IRQS ];
+	#define portIRQ_TABLE			xPortIrqTable
+
+	/* IRQs moved to the shadow register set, and its stack. */
+	static uint32_t ulPortShadowIrqs = 0;
+	#ifdef configISR_STACK_SECTION
+		static StackType_t xPortShadowStack[ configSHADOW_STACK_SIZE ] __attribute__ (( section( configISR_STACK_SECTION ) ));
+	#else
+		static StackType_t xPortShadowStack[ configSHADOW_STACK_SIZE ];
+	#endif
+
+	static void prvVicInit( void );
+	static void prvVicConfigure( uint32_t ulIrq );
+	static void prvVicYieldHandler( void *pvContext, alt_u32 ulIrq );
+#else
+	#define portIRQ_TABLE			alt_irq
+#endif
+
+#ifdef portTICK_PC_SAMPLE
+	/* Word offset of the saved PC (ea) in the frame port_asm.S pushes. */
+	#define portFRAME_PC_WORD		( 18 )
+	extern void * volatile pxCurrentTCB;
+#endif
+
+/* Depth of interrupt handling: 0 in a task, 1 in a handler, more when
+nested.  Maintained by port_asm.S. */
+volatile uint32_t ulPortInterruptNesting = 0;
+
+/* Set by portEND_SWITCHING_ISR(), the context switch is made once the
+outermost handler returns. */
+volatile uint32_t ulPortYieldPending = 0;
+
+/* Critical nesting of the running task, see portENTER_CRITICAL().  Saved
+and restored with each context by port_asm.S, whichever critical section
+version is built; the first task's frame sets it to 0. */
+volatile uint32_t ulPortCriticalNesting = 0xaaaaaaaaUL;
+
+/* IRQs at each interrupt priority, and for each priority the IRQs allowed to
+preempt a handler running at it.  Everything starts at the kernel priority,
+which with nothing above it is the HAL's behaviour of one handler at a time
+in IRQ number order. */
+static uint32_t ulPortPriorityIrqs[ configMAX_SYSCALL_INTERRUPT_PRIORITY + 1 ] =
+{
+	[ configKERNEL_INTERRUPT_PRIORITY ] = 0xFFFFFFFFUL
+};
+static uint32_t ulPortPreemptIrqs[ configMAX_SYSCALL_INTERRUPT_PRIORITY + 1 ];
+
+/* Interrupt stack.  port_asm.S moves sp to the top of it on entry to the
+outermost handler, so only the 116 byte context frame of the interrupted task
+is pushed onto the task's own stack; nested frames, handler locals and the
+context switch made on the way out all use this one.  Filled with
+portISR_STACK_FILL_BYTE before the scheduler starts for the high-water mark. */
+#define portISR_STACK_FILL_BYTE		( 0xa5U )
+#ifdef configISR_STACK_SECTION
+	static StackType_t xPortIsrStack[ configISR_STACK_SIZE ] __attribute__ (( section( configISR_STACK_SECTION ) ));
+#else
+	static StackType_t xPortIsrStack[ configISR_STACK_SIZE ];
+#endif
+StackType_t * const pxPortIsrStackTop = &xPortIsrStack[ configISR_STACK_SIZE ];
+
+/*
+ * Stop the tick timer, load a new period (in timer counts) and restart it.
+ */
+static void prvSetTimerPeriod( uint32_t ulCounts );
+
+#if configUSE_TICKLESS_IDLE == 1
+
+	/* Timer counts in one tick, and the longest sleep the 32-bit period
+	register can express. */
+	#define portTIMER_COUNTS_PER_TICK		( ( uint32_t ) ( configCPU_CLOCK_HZ / configTICK_RATE_HZ ) )
+	#define portMAX_SUPPRESSED_TICKS		( 0xFFFFFFFFUL / portTIMER_COUNTS_PER_TICK )
+
+	/* Timer counts lost while the timer is stopped to be reprogrammed after
+	a sleep.  Measure on the target and set to keep the tick from drifting. */
+	#ifndef portSTOPPED_TIMER_COMPENSATION
+		#define portSTOPPED_TIMER_COMPENSATION	0
+	#endif
+
+	/* Application policy called before each sleep: may shorten the sleep, or
+	veto it by setting the idle time below 2.  See configPRE_SLEEP_PROCESSING
+	in FreeRTOSConfig.h. */
+	extern void vApplicationPreSleepProcessing( TickType_t *pxIdleTime );
+
+	/* Tick interrupts left before the normal tick period is restored after a
+	sleep.  Zero while the timer runs at the normal period. */
+	static volatile uint8_t ucRestorePeriodIn = 0;
+
+	/* Current count of the running timer, counting down to 0. */
+	static uint32_t prvReadTimerCount( void );
+
+#endif /* configUSE_TICKLESS_IDLE */
+
 /*-----------------------------------------------------------*/
 
 static void prvReadGp( uint32_t *ulValue )
@@ -148,8 +321,14 @@ StackType_t xGlobalPointer;
     
     *pxTopOfStack = ( StackType_t ) pvParameters; 
 
-    /* Space for R3 to R1, muldiv and RA. */
-    pxTopOfStack -= 5;
+    /* Space for R3 to R1. */
+    pxTopOfStack -= 4;
+
+    /* Critical nesting, in the muldiv word. */
+    *pxTopOfStack = 0;
+
+    /* Space for RA. */
+    pxTopOfStack--;
     
     return pxTopOfStack;
 }
@@ -160,6 +339,14 @@ StackType_t xGlobalPointer;
  */
 BaseType_t xPortStartScheduler( void )
 {
+	/* Nothing has run on the interrupt stack yet, and the section it is in
+	is not zeroed at start up. */
+	memset( xPortIsrStack, portISR_STACK_FILL_BYTE, sizeof( xPortIsrStack ) );
+
+	#if portUSE_VIC == 1
+		prvVicInit();
+	#endif
+
 	/* Start the timer that generates the tick ISR.  Interrupts are disabled
 	here already. */
 	prvSetupTimerInterrupt();
@@ -195,10 +382,7 @@ void prvSetupTimerInterrupt( void )
 	else
 	{
 		/* Configure SysTick to interrupt at the requested rate. */
-		IOWR_ALTERA_AVALON_TIMER_CONTROL( SYS_CLK_BASE, ALTERA_AVALON_TIMER_CONTROL_STOP_MSK );
-		IOWR_ALTERA_AVALON_TIMER_PERIODL( SYS_CLK_BASE, ( configCPU_CLOCK_HZ / configTICK_RATE_HZ ) & 0xFFFF );
-		IOWR_ALTERA_AVALON_TIMER_PERIODH( SYS_CLK_BASE, ( configCPU_CLOCK_HZ / configTICK_RATE_HZ ) >> 16 );
-		IOWR_ALTERA_AVALON_TIMER_CONTROL( SYS_CLK_BASE, ALTERA_AVALON_TIMER_CONTROL_CONT_MSK | ALTERA_AVALON_TIMER_CONTROL_START_MSK | ALTERA_AVALON_TIMER_CONTROL_ITO_MSK );	
+		prvSetTimerPeriod( configCPU_CLOCK_HZ / configTICK_RATE_HZ );
 	} 
 
 	/* Clear any already pending interrupts generated by the Timer. */
@@ -206,19 +390,156 @@ void prvSetupTimerInterrupt( void )
 }
 /*-----------------------------------------------------------*/
 
+static void prvSetTimerPeriod( uint32_t ulCounts )
+{
+	/* The timer counts from the period value down to 0 inclusive. Writing the
+	period stops the counter and reloads it; the TO status is left alone. */
+	IOWR_ALTERA_AVALON_TIMER_CONTROL( SYS_CLK_BASE, ALTERA_AVALON_TIMER_CONTROL_STOP_MSK );
+	IOWR_ALTERA_AVALON_TIMER_PERIODL( SYS_CLK_BASE, ( ulCounts - 1UL ) & 0xFFFF );
+	IOWR_ALTERA_AVALON_TIMER_PERIODH( SYS_CLK_BASE, ( ulCounts - 1UL ) >> 16 );
+	IOWR_ALTERA_AVALON_TIMER_CONTROL( SYS_CLK_BASE, ALTERA_AVALON_TIMER_CONTROL_CONT_MSK | ALTERA_AVALON_TIMER_CONTROL_START_MSK | ALTERA_AVALON_TIMER_CONTROL_ITO_MSK );
+}
+/*-----------------------------------------------------------*/
+
 void vPortSysTickHandler( void * context, alt_u32 id )
 {
-	/* Increment the kernel tick. */
-	if( xTaskIncrementTick() != pdFALSE )
+UBaseType_t uxSavedInterruptStatus;
+
+	#ifdef portTICK_PC_SAMPLE
 	{
-        vTaskSwitchContext();
+		/* Nothing runs below the tick's priority, so outside a nested handler
+		it interrupted a task, whose frame port_asm.S stored at the top of its
+		stack and in its TCB. */
+		if( ulPortInterruptNesting == 1 )
+		{
+			portTICK_PC_SAMPLE( ( *( uint32_t ** ) pxCurrentTCB )[ portFRAME_PC_WORD ], pxCurrentTCB );
+		}
 	}
+	#endif
+
+	/* Increment the kernel tick.  Other handlers may nest inside this one and
+	call the FromISR API, so the kernel lists are only touched with interrupts
+	masked. */
+	uxSavedInterruptStatus = portSET_INTERRUPT_MASK_FROM_ISR();
+	portEND_SWITCHING_ISR( xTaskIncrementTick() );
+	portCLEAR_INTERRUPT_MASK_FROM_ISR( uxSavedInterruptStatus );
 		
 	/* Clear the interrupt. */
 	IOWR_ALTERA_AVALON_TIMER_STATUS( SYS_CLK_BASE, ~ALTERA_AVALON_TIMER_STATUS_TO_MSK );
+
+	#if configUSE_TICKLESS_IDLE == 1
+	{
+		/* The first period after a sleep is shortened to realign the tick;
+		go back to whole ticks once it has expired. */
+		if( ucRestorePeriodIn != 0 )
+		{
+			if( --ucRestorePeriodIn == 0 )
+			{
+				prvSetTimerPeriod( portTIMER_COUNTS_PER_TICK );
+			}
+		}
+	}
+	#endif
 }
 /*-----------------------------------------------------------*/
 
+#if configUSE_TICKLESS_IDLE == 1
+
+	static uint32_t prvReadTimerCount( void )
+	{
+		/* Any write to a snap register latches the counter. */
+		IOWR_ALTERA_AVALON_TIMER_SNAPL( SYS_CLK_BASE, 0 );
+		return ( ( uint32_t ) IORD_ALTERA_AVALON_TIMER_SNAPH( SYS_CLK_BASE ) << 16 ) |
+			   ( IORD_ALTERA_AVALON_TIMER_SNAPL( SYS_CLK_BASE ) & 0xFFFF );
+	}
+	/*-----------------------------------------------------------*/
+
+	void vPortSuppressTicksAndSleep( TickType_t xExpectedIdleTime )
+	{
+	uint32_t ulCountsLeft, ulReload, ulElapsed, ulNext, ulIPending;
+	TickType_t xIdleTime, xCompletedTicks;
+	alt_irq_context xContext;
+
+		/* Let the application shorten or veto the sleep before the timer is
+		touched. */
+		xIdleTime = xExpectedIdleTime;
+		configPRE_SLEEP_PROCESSING( xIdleTime );
+		if( xIdleTime > portMAX_SUPPRESSED_TICKS )
+		{
+			xIdleTime = portMAX_SUPPRESSED_TICKS;
+		}
+		if( xIdleTime < 2 )
+		{
+			return;
+		}
+
+		xContext = alt_irq_disable_all();
+
+		/* Do not sleep if a task became ready since the idle task decided to,
+		a tick is already due, or the previous sleep's short period is still
+		running. */
+		if( ( eTaskConfirmSleepModeStatus() == eAbortSleep ) || ( ucRestorePeriodIn != 0 ) ||
+			( ( IORD_ALTERA_AVALON_TIMER_STATUS( SYS_CLK_BASE ) & ALTERA_AVALON_TIMER_STATUS_TO_MSK ) != 0 ) )
+		{
+			alt_irq_enable_all( xContext );
+			return;
+		}
+
+		/* Sleep for the rest of the current tick plus the further whole
+		ticks. */
+		ulCountsLeft = prvReadTimerCount();
+		ulReload = ulCountsLeft + ( portTIMER_COUNTS_PER_TICK * ( xIdleTime - 1UL ) );
+		prvSetTimerPeriod( ulReload );
+
+		/* Wait for any enabled interrupt with interrupts still masked, so the
+		tick count is corrected before any handler runs.  The Nios II has no
+		wait-for-interrupt instruction, so ipending is polled instead. */
+		do
+		{
+			portREAD_PENDING( ulIPending );
+		} while( ulIPending == 0 );
+
+		configPOST_SLEEP_PROCESSING( xIdleTime );
+
+		IOWR_ALTERA_AVALON_TIMER_CONTROL( SYS_CLK_BASE, ALTERA_AVALON_TIMER_CONTROL_STOP_MSK );
+		ulCountsLeft = prvReadTimerCount();
+
+		if( ( IORD_ALTERA_AVALON_TIMER_STATUS( SYS_CLK_BASE ) & ALTERA_AVALON_TIMER_STATUS_TO_MSK ) != 0 )
+		{
+			/* Slept the whole time.  The pending timeout is the last tick and
+			is left for vPortSysTickHandler, which unblocks the task that is
+			due.  The timer reloaded and kept counting after the timeout. */
+			xCompletedTicks = xIdleTime - 1UL;
+			ulElapsed = ulReload - ulCountsLeft;
+			ulNext = ( ulElapsed < portTIMER_COUNTS_PER_TICK ) ? ( portTIMER_COUNTS_PER_TICK - ulElapsed ) : portTIMER_COUNTS_PER_TICK;
+
+			/* The handler runs once for the pending timeout, then once more at
+			the end of the short period. */
+			ucRestorePeriodIn = 2;
+		}
+		else
+		{
+			/* Woken early by another interrupt.  Step the whole ticks that
+			passed, counted from the start of the tick the sleep began in. */
+			ulElapsed = ( portTIMER_COUNTS_PER_TICK * xIdleTime ) - ulCountsLeft;
+			xCompletedTicks = ulElapsed / portTIMER_COUNTS_PER_TICK;
+			ulNext = portTIMER_COUNTS_PER_TICK - ( ulElapsed % portTIMER_COUNTS_PER_TICK );
+			ucRestorePeriodIn = 1;
+		}
+
+		if( ulNext > portSTOPPED_TIMER_COMPENSATION )
+		{
+			ulNext -= portSTOPPED_TIMER_COMPENSATION;
+		}
+		prvSetTimerPeriod( ulNext );
+		vTaskStepTick( xCompletedTicks );
+
+		alt_irq_enable_all( xContext );
+	}
+	/*-----------------------------------------------------------*/
+
+#endif /* configUSE_TICKLESS_IDLE */
+
 /** This function is a re-implementation of the Altera provided function.
  * The function is re-implemented to prevent it from enabling an interrupt
  * when it is registered. Interrupts should only be enabled after the FreeRTOS.org
@@ -230,7 +551,7 @@ int alt_irq_register( alt_u32 id, void* context, void (*handler)(void*, alt_u32)
 	int rc = -EINVAL;  
 	alt_irq_context status;
 
-	if (id < ALT_NIRQ)
+	if (id < portIRQS)
 	{
 		/* 
 		 * interrupts are disabled while the handler tables are updated to ensure
@@ -240,10 +561,16 @@ int alt_irq_register( alt_u32 id, void* context, void (*handler)(void*, alt_u32)
 	
 		status = alt_irq_disable_all ();
 	
-		alt_irq[id].handler = handler;
-		alt_irq[id].context = context;
+		portIRQ_TABLE[id].handler = handler;
+		portIRQ_TABLE[id].context = context;
 	
+#if portUSE_VIC == 1
+		prvVicConfigure( id );
+		IOWR( VIC_BASE, handler ? portVIC_INT_ENABLE_SET : portVIC_INT_ENABLE_CLR, 1UL << id );
+		rc = 0;
+#else
 		rc = (handler) ? alt_irq_enable (id): alt_irq_disable (id);
+#endif
 	
 		/* alt_irq_enable_all(status); This line is removed to prevent the interrupt from being immediately enabled. */
 	}
@@ -252,3 +579,280 @@ int alt_irq_register( alt_u32 id, void* context, void (*handler)(void*, alt_u32)
 }
 /*-----------------------------------------------------------*/
 
+UBaseType_t uxPortGetIsrStackHighWaterMark( void )
+{
+const uint8_t *pucStackByte = ( const uint8_t * ) xPortIsrStack;
+uint32_t ulCount = 0U;
+
+	/* The stack grows down from the top, so untouched bytes are at the
+	bottom. */
+	while( ( ulCount < sizeof( xPortIsrStack ) ) && ( *pucStackByte == portISR_STACK_FILL_BYTE ) )
+	{
+		pucStackByte++;
+		ulCount++;
+	}
+
+	return ( UBaseType_t ) ( ulCount / sizeof( StackType_t ) );
+}
+/*-----------------------------------------------------------*/
+
+void vPortSetIrqPriority( uint32_t ulIrq, UBaseType_t uxPriority )
+{
+alt_irq_context xContext;
+uint32_t ulAbove;
+UBaseType_t ux;
+
+	configASSERT( ulIrq < portIRQS );
+	configASSERT( ( uxPriority >= configKERNEL_INTERRUPT_PRIORITY ) && ( uxPriority <= configMAX_SYSCALL_INTERRUPT_PRIORITY ) );
+
+	xContext = alt_irq_disable_all();
+
+	for( ux = 0; ux <= configMAX_SYSCALL_INTERRUPT_PRIORITY; ux++ )
+	{
+		ulPortPriorityIrqs[ ux ] &= ~( 1UL << ulIrq );
+	}
+	ulPortPriorityIrqs[ uxPriority ] |= ( 1UL << ulIrq );
+
+	/* Walk down from the top, each priority can be preempted by the union of
+	those above it. */
+	ulAbove = 0;
+	for( ux = configMAX_SYSCALL_INTERRUPT_PRIORITY + 1; ux-- > 0; )
+	{
+		ulPortPreemptIrqs[ ux ] = ulAbove & ~( uint32_t ) configUNSERVABLE_IRQ_MASK;
+		ulAbove |= ulPortPriorityIrqs[ ux ];
+	}
+
+	#if portUSE_VIC == 1
+		prvVicConfigure( ulIrq );
+	#endif
+
+	alt_irq_enable_all( xContext );
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Replaces alt_irq_handler(), which runs every pending handler in IRQ number
+ * order with interrupts disabled throughout.  Pending interrupts are taken
+ * highest priority first, and while a handler runs the IRQs of a strictly
+ * higher priority are left enabled so they can preempt it; the HAL's
+ * alt_priority_mask holds the IRQs allowed at the current nesting level.
+ *
+ * Each nested level pushes another context frame onto the interrupt stack.
+ * A handler that nothing can preempt (top priority, or listed in
+ * configUNSERVABLE_IRQ_MASK) runs with interrupts disabled as before, which
+ * also saves the status and ienable writes on the fast path.
+ *
+ * alt_irq_enable() and alt_irq_disable() write ienable from alt_irq_active
+ * alone, so calling them from a handler re-opens the lower priorities until
+ * that handler returns.
+ */
+#if portUSE_VIC == 0
+
+void vPortIrqDispatch( void )
+{
+extern volatile alt_u32 alt_irq_active;
+extern volatile alt_u32 alt_priority_mask;
+uint32_t ulActive, ulCandidates, ulIrq;
+UBaseType_t uxPriority;
+#if configUSE_INTERRUPT_NESTING == 1
+	uint32_t ulSavedMask, ulAllowed;
+#endif
+
+	/* ipending only shows the IRQs enabled at this level. */
+	NIOS2_READ_IPENDING( ulActive );
+
+	while( ulActive != 0 )
+	{
+		/* Every IRQ is at exactly one priority, so this stops. */
+		uxPriority = configMAX_SYSCALL_INTERRUPT_PRIORITY;
+		while( ( ulActive & ulPortPriorityIrqs[ uxPriority ] ) == 0 )
+		{
+			uxPriority--;
+		}
+		ulCandidates = ulActive & ulPortPriorityIrqs[ uxPriority ];
+		ulIrq = __builtin_ctz( ulCandidates );
+
+		#if configUSE_INTERRUPT_NESTING == 1
+		{
+			ulSavedMask = alt_priority_mask;
+			ulAllowed = ulSavedMask & ulPortPreemptIrqs[ uxPriority ];
+
+			if( ( ( ulAllowed & alt_irq_active ) != 0 ) && ( ( ( uint32_t ) configUNSERVABLE_IRQ_MASK & ( 1UL << ulIrq ) ) == 0 ) )
+			{
+				alt_priority_mask = ulAllowed;
+				NIOS2_WRITE_IENABLE( alt_irq_active & ulAllowed );
+				NIOS2_WRITE_STATUS( NIOS2_STATUS_PIE_MSK );
+
+				alt_irq[ ulIrq ].handler( alt_irq[ ulIrq ].context, ulIrq );
+
+				NIOS2_WRITE_STATUS( 0 );
+				alt_priority_mask = ulSavedMask;
+				NIOS2_WRITE_IENABLE( alt_irq_active & ulSavedMask );
+			}
+			else
+			{
+				alt_irq[ ulIrq ].handler( alt_irq[ ulIrq ].context, ulIrq );
+			}
+		}
+		#else
+		{
+			alt_irq[ ulIrq ].handler( alt_irq[ ulIrq ].context, ulIrq );
+		}
+		#endif /* configUSE_INTERRUPT_NESTING */
+
+		NIOS2_READ_IPENDING( ulActive );
+	}
+}
+/*-----------------------------------------------------------*/
+
+#endif /* portUSE_VIC */
+
+#if portUSE_VIC == 1
+
+/*
+ * The same dispatch behind the vectored interrupt controller.  Each VIC
+ * vector of register set 0 comes to the one entry in port_asm.S, so the
+ * pending IRQs are taken highest priority first from INT_PENDING, as from
+ * ipending.  The level that was interrupted, in estatus.IL, stands in for
+ * the ienable masks: only IRQs of a higher priority than the interrupted
+ * handler are taken, and while a handler runs status.IL is its own level,
+ * so the VIC only presents the IRQs that may preempt it.  The shadow IRQs
+ * are above every level and preempt any handler that has PIE set.
+ */
+void vPortIrqDispatch( void )
+{
+uint32_t ulStatus, ulLevel, ulAllowed, ulActive, ulIrq;
+UBaseType_t uxPriority;
+
+	NIOS2_READ_ESTATUS( ulStatus );
+	ulLevel = ( ulStatus & NIOS2_STATUS_IL_MSK ) >> NIOS2_STATUS_IL_OFST;
+	if( ulLevel < portVIC_LEVEL( configKERNEL_INTERRUPT_PRIORITY ) )
+	{
+		ulAllowed = ~ulPortShadowIrqs;
+	}
+	else
+	{
+		ulAllowed = ulPortPreemptIrqs[ ulLevel - 1UL ] & ~ulPortShadowIrqs;
+	}
+
+	ulActive = IORD( VIC_BASE, portVIC_INT_PENDING ) & ulAllowed;
+	while( ulActive != 0 )
+	{
+		uxPriority = configMAX_SYSCALL_INTERRUPT_PRIORITY;
+		while( ( ulActive & ulPortPriorityIrqs[ uxPriority ] ) == 0 )
+		{
+			uxPriority--;
+		}
+		ulIrq = __builtin_ctz( ulActive & ulPortPriorityIrqs[ uxPriority ] );
+
+		#if configUSE_INTERRUPT_NESTING == 1
+			if( ( ( uint32_t ) configUNSERVABLE_IRQ_MASK & ( 1UL << ulIrq ) ) == 0 )
+			{
+				NIOS2_READ_STATUS( ulStatus );
+				NIOS2_WRITE_STATUS( NIOS2_STATUS_PIE_MSK | NIOS2_STATUS_RSIE_MSK |
+									( portVIC_LEVEL( uxPriority ) << NIOS2_STATUS_IL_OFST ) );
+				xPortIrqTable[ ulIrq ].handler( xPortIrqTable[ ulIrq ].context, ulIrq );
+				NIOS2_WRITE_STATUS( ulStatus );
+			}
+			else
+		#endif /* configUSE_INTERRUPT_NESTING */
+			{
+				xPortIrqTable[ ulIrq ].handler( xPortIrqTable[ ulIrq ].context, ulIrq );
+			}
+
+		ulActive = IORD( VIC_BASE, portVIC_INT_PENDING ) & ulAllowed;
+	}
+}
+/*-----------------------------------------------------------*/
+
+void vPortShadowDispatch( uint32_t ulIrq )
+{
+	xPortIrqTable[ ulIrq ].handler( xPortIrqTable[ ulIrq ].context, ulIrq );
+
+	/* Straight from a task, nothing in register set 0 will return through
+	port_asm.S to make a switch the handler asked for, so the yield IRQ is
+	raised to do it.  Its level is the lowest, so it is taken once the
+	interrupted task runs again, before any instruction of it does. */
+	if( ( ulPortYieldPending != 0 ) && ( ulPortInterruptNesting == 1 ) )
+	{
+		IOWR( VIC_BASE, portVIC_SW_INT_SET, 1UL << configVIC_YIELD_IRQ );
+	}
+}
+/*-----------------------------------------------------------*/
+
+void vPortSetIrqShadow( uint32_t ulIrq )
+{
+alt_irq_context xContext;
+
+	configASSERT( ulIrq < portVIC_IRQS );
+	configASSERT( ulIrq != configVIC_YIELD_IRQ );
+
+	xContext = alt_irq_disable_all();
+	ulPortShadowIrqs |= 1UL << ulIrq;
+	prvVicConfigure( ulIrq );
+	alt_irq_enable_all( xContext );
+}
+/*-----------------------------------------------------------*/
+
+/* Level and register set of one IRQ. Interrupts masked. */
+static void prvVicConfigure( uint32_t ulIrq )
+{
+uint32_t ulConfig;
+UBaseType_t ux;
+
+	if( ulIrq == configVIC_YIELD_IRQ )
+	{
+		ulConfig = portVIC_YIELD_LEVEL;
+	}
+	else if( ( ulPortShadowIrqs & ( 1UL << ulIrq ) ) != 0 )
+	{
+		ulConfig = portVIC_SHADOW_LEVEL | ( ( uint32_t ) configSHADOW_REGISTER_SET << portVIC_INT_CONFIG_RRS_OFST );
+	}
+	else
+	{
+		ux = configMAX_SYSCALL_INTERRUPT_PRIORITY;
+		while( ( ux > configKERNEL_INTERRUPT_PRIORITY ) && ( ( ulPortPriorityIrqs[ ux ] & ( 1UL << ulIrq ) ) == 0 ) )
+		{
+			ux--;
+		}
+		ulConfig = portVIC_LEVEL( ux );
+	}
+	IOWR( VIC_BASE, portVIC_INT_CONFIG( ulIrq ), ulConfig );
+}
+/*-----------------------------------------------------------*/
+
+/* The yield request: the switch is made on the way out of the dispatch. */
+static void prvVicYieldHandler( void *pvContext, alt_u32 ulIrq )
+{
+	( void ) pvContext;
+	IOWR( VIC_BASE, portVIC_SW_INT_CLR, 1UL << ulIrq );
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Point the VIC at the port's vectors, in place of the HAL driver's, and
+ * give the shadow register set the stack and global pointer its handlers
+ * run on.  r0 of a shadow set is an ordinary register until it is zeroed.
+ * Before the scheduler starts, with interrupts disabled.
+ */
+static void prvVicInit( void )
+{
+uint32_t ulStatus;
+StackType_t *pxTop = &xPortShadowStack[ configSHADOW_STACK_SIZE ];
+
+	IOWR( VIC_BASE, portVIC_VEC_TBL_BASE, ( uint32_t ) xPortVicVectors );
+	IOWR( VIC_BASE, portVIC_CONFIG, portVIC_CONFIG_VEC_32 );
+
+	NIOS2_READ_STATUS( ulStatus );
+	NIOS2_WRITE_STATUS( ( ulStatus & ~NIOS2_STATUS_PRS_MSK ) |
+						( ( uint32_t ) configSHADOW_REGISTER_SET << NIOS2_STATUS_PRS_OFST ) );
+	__asm__ __volatile__( "wrprs r0, r0\n\t"
+						  "wrprs sp, %0\n\t"
+						  "wrprs gp, gp" :: "r"( pxTop ) );
+	NIOS2_WRITE_STATUS( ulStatus );
+
+	( void ) alt_irq_register( configVIC_YIELD_IRQ, NULL, prvVicYieldHandler );
+}
+/*-----------------------------------------------------------*/
+
+#endif /* portUSE_VIC */
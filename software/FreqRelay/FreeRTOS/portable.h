@@ -167,6 +167,43 @@ void vPortInitialiseBlocks( void ) PRIVILEGED_FUNCTION;
 size_t xPortGetFreeHeapSize( void ) PRIVILEGED_FUNCTION;
 size_t xPortGetMinimumEverFreeHeapSize( void ) PRIVILEGED_FUNCTION;
 
+#if( configUSE_TLSF_HEAP == 1 )
+	/* Allocator statistics, provided by heap_tlsf.c. */
+	typedef struct xHEAP_STATS
+	{
+		size_t xTotalBytes;				/* Size of the heap. */
+		size_t xFreeBytes;				/* Currently free, including block headers. */
+		size_t xMinimumEverFreeBytes;	/* Low water mark of xFreeBytes, total minus this is the peak usage. */
+		size_t xLargestFreeBlock;		/* Usable size of the largest free block. */
+		size_t xFreeBlocks;				/* Number of free fragments. */
+		size_t xAllocations;			/* Successful pvPortMalloc() calls since boot. */
+		size_t xFrees;					/* vPortFree() calls since boot. */
+		size_t xFailedAllocations;		/* pvPortMalloc() calls that returned NULL. */
+		uint32_t ulFragmentationPermille;	/* Share of the free bytes outside the largest block, 0-1000. */
+	} HeapStats_t;
+
+	void vPortGetHeapStats( HeapStats_t *pxHeapStats ) PRIVILEGED_FUNCTION;
+
+	/* Memory regions of the heap, fastest first.  An allocation from a full
+	region falls back to the slower regions and then the faster ones. */
+	#define heapREGION_FAST			0	/* On-chip RAM: kernel objects, pvPortMalloc(). */
+	#define heapREGION_NORMAL		1	/* SRAM: configHEAP_SRAM_BYTES, none with the kernel trace. */
+	#define heapREGION_BULK			2	/* SDRAM: large buffers, newlib's malloc(). */
+	#define heapREGIONS				3
+
+	void *pvPortMallocRegion( size_t xSize, UBaseType_t uxRegion ) PRIVILEGED_FUNCTION;
+
+	/* vPortGetHeapStats() for one region; that one is the fast region's. */
+	void vPortGetHeapRegionStats( UBaseType_t uxRegion, HeapStats_t *pxHeapStats ) PRIVILEGED_FUNCTION;
+
+	/* Refuse every allocation from now on, for a steady state that never
+	allocates.  Each one returns NULL at once and is counted; frees still
+	work.  There is no thaw. */
+	void vPortHeapFreeze( void ) PRIVILEGED_FUNCTION;
+	BaseType_t xPortHeapFrozen( void ) PRIVILEGED_FUNCTION;
+	size_t xPortGetRefusedAllocations( void ) PRIVILEGED_FUNCTION;
+#endif
+
 /*
  * Setup the hardware ready for the scheduler to take control.  This generally
  * sets up a tick interrupt and sets timers for the correct tick frequency.
@@ -117,13 +117,103 @@ typedef unsigned long UBaseType_t;
 #define portTICK_PERIOD_MS				( ( TickType_t ) 1000 / configTICK_RATE_HZ )
 #define portBYTE_ALIGNMENT				4
 #define portNOP()                   	asm volatile ( "NOP" )
-#define portCRITICAL_NESTING_IN_TCB		1
-#define portYIELD_FROM_ISR(x) if(x) taskYIELD()
+#if configUSE_PORT_INLINE_CRITICAL == 1
+	#define portCRITICAL_NESTING_IN_TCB	0
+#else
+	#define portCRITICAL_NESTING_IN_TCB	1
+#endif
 /*-----------------------------------------------------------*/
 
 extern void vTaskSwitchContext( void );
 #define portYIELD()									asm volatile ( "trap" );
-#define portEND_SWITCHING_ISR( xSwitchRequired ) 	if( xSwitchRequired ) 	vTaskSwitchContext()
+
+/* Handlers can nest, so a switch requested from one is only recorded here and
+made by port_asm.S when the outermost handler returns. */
+extern volatile uint32_t ulPortYieldPending;
+#define portEND_SWITCHING_ISR( xSwitchRequired ) 	if( xSwitchRequired ) 	ulPortYieldPending = 1
+#define portYIELD_FROM_ISR( x )						portEND_SWITCHING_ISR( x )
+
+/* The FromISR API masks every interrupt around kernel data, so handlers at
+any priority from configKERNEL_INTERRUPT_PRIORITY up to
+configMAX_SYSCALL_INTERRUPT_PRIORITY may use it. */
+#define portSET_INTERRUPT_MASK_FROM_ISR()			alt_irq_disable_all()
+#define portCLEAR_INTERRUPT_MASK_FROM_ISR( x )		alt_irq_enable_all( x )
+
+/* Interrupt priority of an IRQ, see vPortIrqDispatch() in port.c. */
+extern void vPortSetIrqPriority( uint32_t ulIrq, UBaseType_t uxPriority );
+
+/* A CPU generated with the external interrupt controller interface takes
+its interrupts from an altera_vic, see port_asm.S and port.c. */
+#ifdef NIOS2_EIC_PRESENT
+	#define portUSE_VIC		1
+#else
+	#define portUSE_VIC		0
+#endif
+
+#if portUSE_VIC == 1
+	/* Give an IRQ the shadow register set configSHADOW_REGISTER_SET and a
+	level above every interrupt priority: its vector calls its handler with
+	no context saved, and it preempts any handler not in a critical section.
+	It may use the FromISR API, which masks it. */
+	extern void vPortSetIrqShadow( uint32_t ulIrq );
+
+	/* The HAL has no legacy API with an EIC; the port provides this much. */
+	extern int alt_irq_register( alt_u32 id, void *context, void ( *handler )( void *, alt_u32 ) );
+#endif
+
+/* Words of the interrupt stack never used so far, in the manner of
+uxTaskGetStackHighWaterMark(). */
+extern UBaseType_t uxPortGetIsrStackHighWaterMark( void );
+
+/* One past the top of the configISR_STACK_SIZE word interrupt stack. */
+extern StackType_t * const pxPortIsrStackTop;
+
+/* Port optimised task selection: uxTopReadyPriority becomes a bitmap with one
+bit per priority that has ready tasks, and the highest one is found in
+constant time.  The Nios II has no count-leading-zeros instruction and
+__builtin_clz() falls back to a libgcc loop, so the top bit is isolated by
+smearing it downwards and then identified with a de Bruijn multiply on the
+hardware multiplier and a 32 entry table. */
+#if configUSE_PORT_OPTIMISED_TASK_SELECTION == 1
+
+	#if configMAX_PRIORITIES > 32
+		#error configUSE_PORT_OPTIMISED_TASK_SELECTION can only be set to 1 when configMAX_PRIORITIES is less than or equal to 32.
+	#endif
+
+	#define portRECORD_READY_PRIORITY( uxPriority, uxReadyPriorities ) ( uxReadyPriorities ) |= ( 1UL << ( uxPriority ) )
+	#define portRESET_READY_PRIORITY( uxPriority, uxReadyPriorities ) ( uxReadyPriorities ) &= ~( 1UL << ( uxPriority ) )
+
+	static inline UBaseType_t uxPortHighestSetBit( uint32_t ulBits )
+	{
+	static const uint8_t ucDeBruijnBit[ 32 ] =
+	{
+		0, 9, 1, 10, 13, 21, 2, 29, 11, 14, 16, 18, 22, 25, 3, 30,
+		8, 12, 20, 28, 15, 17, 24, 7, 19, 27, 23, 6, 26, 5, 4, 31
+	};
+
+		/* Set every bit below the top one, leaving 2^(n+1) - 1. */
+		ulBits |= ulBits >> 1;
+		ulBits |= ulBits >> 2;
+		ulBits |= ulBits >> 4;
+		#if configMAX_PRIORITIES > 8
+			ulBits |= ulBits >> 8;
+		#endif
+		#if configMAX_PRIORITIES > 16
+			ulBits |= ulBits >> 16;
+		#endif
+		return ucDeBruijnBit[ ( uint32_t ) ( ulBits * 0x07C4ACDDUL ) >> 27 ];
+	}
+
+	/* The idle task is always ready, so the bitmap is never empty. */
+	#define portGET_HIGHEST_PRIORITY( uxTopPriority, uxReadyPriorities ) uxTopPriority = uxPortHighestSetBit( uxReadyPriorities )
+
+#endif /* configUSE_PORT_OPTIMISED_TASK_SELECTION */
+
+/* Tickless idle, see vPortSuppressTicksAndSleep() in port.c. */
+#if configUSE_TICKLESS_IDLE == 1
+	extern void vPortSuppressTicksAndSleep( TickType_t xExpectedIdleTime );
+	#define portSUPPRESS_TICKS_AND_SLEEP( xExpectedIdleTime ) vPortSuppressTicksAndSleep( xExpectedIdleTime )
+#endif
 
 
 /* Include the port_asm.S file where the Context saving/restoring is defined. */
@@ -131,13 +221,56 @@ __asm__( "\n\t.globl	save_context" );
 
 /*-----------------------------------------------------------*/
 
-extern void vTaskEnterCritical( void );
-extern void vTaskExitCritical( void );
-
 #define portDISABLE_INTERRUPTS()	alt_irq_disable_all()
 #define portENABLE_INTERRUPTS()		alt_irq_enable_all( 0x01 );
-#define portENTER_CRITICAL()        vTaskEnterCritical()
-#define portEXIT_CRITICAL()         vTaskExitCritical()
+
+#if configUSE_PORT_INLINE_CRITICAL == 1
+
+	/* Critical sections clear status.PIE in line, with no call and no TCB
+	access.  The nesting count is a single word for whoever is running: each
+	task's count is saved in the spare muldiv word of its context frame and
+	restored with it (see port_asm.S), so a task that yields inside a
+	critical section gets its own count back.  Until the first task starts
+	the count is held high, so critical sections used before the scheduler
+	leave interrupts off, as the kernel expects. */
+	extern volatile uint32_t ulPortCriticalNesting;
+
+	#define portCOMPILER_BARRIER()	__asm__ __volatile__( "" ::: "memory" )
+
+	static inline void vPortEnterCritical( void )
+	{
+	uint32_t ulStatus;
+
+		NIOS2_READ_STATUS( ulStatus );
+		NIOS2_WRITE_STATUS( ulStatus & ~NIOS2_STATUS_PIE_MSK );
+		portCOMPILER_BARRIER();
+		ulPortCriticalNesting++;
+	}
+
+	static inline void vPortExitCritical( void )
+	{
+	uint32_t ulStatus;
+
+		portCOMPILER_BARRIER();
+		if( --ulPortCriticalNesting == 0 )
+		{
+			NIOS2_READ_STATUS( ulStatus );
+			NIOS2_WRITE_STATUS( ulStatus | NIOS2_STATUS_PIE_MSK );
+		}
+	}
+
+	#define portENTER_CRITICAL()	vPortEnterCritical()
+	#define portEXIT_CRITICAL()		vPortExitCritical()
+
+#else
+
+	extern void vTaskEnterCritical( void );
+	extern void vTaskExitCritical( void );
+
+	#define portENTER_CRITICAL()	vTaskEnterCritical()
+	#define portEXIT_CRITICAL()		vTaskExitCritical()
+
+#endif /* configUSE_PORT_INLINE_CRITICAL */
 /*-----------------------------------------------------------*/
 
 /* Task function macros as described on the FreeRTOS.org WEB site. */
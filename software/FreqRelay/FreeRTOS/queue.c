@@ -114,6 +114,16 @@ zero. */
 #define queueSEMAPHORE_QUEUE_ITEM_LENGTH ( ( UBaseType_t ) 0 )
 #define queueMUTEX_GIVE_BLOCK_TIME		 ( ( TickType_t ) 0U )
 
+/* Largest item xQueueGenericSend() and xQueueGenericReceive() move without
+the general path when nobody is waiting, see configUSE_QUEUE_FAST_PATH. */
+#define queueFAST_ITEM_SIZE				( ( UBaseType_t ) 4U )
+
+#if ( configUSE_QUEUE_SETS == 1 )
+	#define queueNOT_IN_SET( pxQueue )	( ( pxQueue )->pxQueueSetContainer == NULL )
+#else
+	#define queueNOT_IN_SET( pxQueue )	( pdTRUE )
+#endif
+
 #if( configUSE_PREEMPTION == 0 )
 	/* If the cooperative scheduler is being used then a yield should not be
 	performed just because a higher priority task has been woken. */
@@ -122,6 +132,25 @@ zero. */
 	#define queueYIELD_IF_USING_PREEMPTION() portYIELD_WITHIN_API()
 #endif
 
+#if ( configUSE_QUEUE_PEAK == 1 )
+	/* Called with uxMessagesWaiting just incremented. */
+	#define prvNotePeak( pxQueue )														\
+		if( ( pxQueue )->uxMessagesWaiting > ( pxQueue )->uxMessagesPeak )				\
+		{																				\
+			( pxQueue )->uxMessagesPeak = ( pxQueue )->uxMessagesWaiting;				\
+		}
+#else
+	#define prvNotePeak( pxQueue )
+#endif
+
+#if ( configUSE_QUEUE_COUNTERS == 1 )
+	/* Called next to the trace macro of the event counted, with interrupts
+	masked or the scheduler suspended. */
+	#define prvCount( pxQueue, ulCounter )	( ( pxQueue )->xCounters.ulCounter++ )
+#else
+	#define prvCount( pxQueue, ulCounter )
+#endif
+
 /*
  * Definition of the queue used by the scheduler.
  * Items are queued by copy, not reference.  See the following link for the
@@ -158,6 +187,23 @@ typedef struct QueueDefinition
 		struct QueueDefinition *pxQueueSetContainer;
 	#endif
 
+	#if ( configUSE_MUTEX_CEILING == 1 )
+		UBaseType_t uxCeilingPriority;	/*< Priority a task taking the mutex runs at until it gives it back, 0 for plain inheritance. */
+	#endif
+
+	#if ( configUSE_QUEUE_PEAK == 1 )
+		UBaseType_t uxMessagesPeak;		/*< The most items the queue has held at once. */
+	#endif
+
+	#if ( configUSE_LOCK_PROFILE == 1 )
+		LockProfile_t xLockProfile;		/*< Mutexes only, see xQueueGetLockProfile(). */
+		uint32_t ulTakenAt;				/*< Run time counter when the holder took the mutex. */
+	#endif
+
+	#if ( configUSE_QUEUE_COUNTERS == 1 )
+		QueueCounters_t xCounters;		/*< See vQueueGetCounters(). */
+	#endif
+
 } xQUEUE;
 
 /* The old xQUEUE name is maintained above then typedefed to the new Queue_t
@@ -228,6 +274,13 @@ static BaseType_t prvCopyDataToQueue( Queue_t * const pxQueue, const void *pvIte
  */
 static void prvCopyDataFromQueue( Queue_t * const pxQueue, void * const pvBuffer ) PRIVILEGED_FUNCTION;
 
+/*
+ * Copies one item.  The storage area follows the queue structure, so every
+ * slot is aligned to its item size; a word or half word goes as one load and
+ * store when the caller's buffer is aligned too, rather than through memcpy().
+ */
+static inline void prvCopyItem( void *pvTo, const void *pvFrom, UBaseType_t uxItemSize );
+
 #if ( configUSE_QUEUE_SETS == 1 )
 	/*
 	 * Checks to see if a queue is a member of a queue set, and if so, notifies
@@ -236,6 +289,19 @@ static void prvCopyDataFromQueue( Queue_t * const pxQueue, void * const pvBuffer
 	static BaseType_t prvNotifyQueueSetContainer( const Queue_t * const pxQueue, const BaseType_t xCopyPosition ) PRIVILEGED_FUNCTION;
 #endif
 
+#if ( configUSE_LOCK_PROFILE == 1 )
+	/*
+	 * A mutex has just been taken by the calling task, after blocking for it
+	 * from ulWaitStart if xWaited is set, or is about to be given back by its
+	 * holder.  Both in a critical section.
+	 */
+	static void prvLockTaken( Queue_t * const pxQueue, const BaseType_t xWaited, const uint32_t ulWaitStart ) PRIVILEGED_FUNCTION;
+	static void prvLockGiven( Queue_t * const pxQueue ) PRIVILEGED_FUNCTION;
+#else
+	#define prvLockTaken( pxQueue, xWaited, ulWaitStart )
+	#define prvLockGiven( pxQueue )
+#endif
+
 /*-----------------------------------------------------------*/
 
 /*
@@ -363,6 +429,18 @@ int8_t *pcAllocatedBuffer;
 		pxNewQueue->uxItemSize = uxItemSize;
 		( void ) xQueueGenericReset( pxNewQueue, pdTRUE );
 
+		#if ( configUSE_QUEUE_PEAK == 1 )
+		{
+			pxNewQueue->uxMessagesPeak = ( UBaseType_t ) 0U;
+		}
+		#endif
+
+		#if ( configUSE_QUEUE_COUNTERS == 1 )
+		{
+			( void ) memset( &( pxNewQueue->xCounters ), 0, sizeof( QueueCounters_t ) );
+		}
+		#endif
+
 		#if ( configUSE_TRACE_FACILITY == 1 )
 		{
 			pxNewQueue->ucQueueType = ucQueueType;
@@ -433,6 +511,25 @@ int8_t *pcAllocatedBuffer;
 			}
 			#endif
 
+			#if ( configUSE_MUTEX_CEILING == 1 )
+			{
+				pxNewQueue->uxCeilingPriority = ( UBaseType_t ) 0U;
+			}
+			#endif
+
+			#if ( configUSE_QUEUE_PEAK == 1 )
+			{
+				pxNewQueue->uxMessagesPeak = ( UBaseType_t ) 0U;
+			}
+			#endif
+
+			#if ( configUSE_LOCK_PROFILE == 1 )
+			{
+				( void ) memset( &( pxNewQueue->xLockProfile ), 0, sizeof( LockProfile_t ) );
+				pxNewQueue->ulTakenAt = 0U;
+			}
+			#endif
+
 			/* Ensure the event queues start with the correct state. */
 			vListInitialise( &( pxNewQueue->xTasksWaitingToSend ) );
 			vListInitialise( &( pxNewQueue->xTasksWaitingToReceive ) );
@@ -441,6 +538,13 @@ int8_t *pcAllocatedBuffer;
 
 			/* Start with the semaphore in the expected state. */
 			( void ) xQueueGenericSend( pxNewQueue, NULL, ( TickType_t ) 0U, queueSEND_TO_BACK );
+
+			#if ( configUSE_QUEUE_COUNTERS == 1 )
+			{
+				/* That give was not a send. */
+				( void ) memset( &( pxNewQueue->xCounters ), 0, sizeof( QueueCounters_t ) );
+			}
+			#endif
 		}
 		else
 		{
@@ -454,6 +558,27 @@ int8_t *pcAllocatedBuffer;
 #endif /* configUSE_MUTEXES */
 /*-----------------------------------------------------------*/
 
+#if ( ( configUSE_MUTEXES == 1 ) && ( configUSE_MUTEX_CEILING == 1 ) )
+
+	QueueHandle_t xQueueCreateMutexCeiling( const UBaseType_t uxCeilingPriority )
+	{
+	Queue_t *pxNewQueue;
+
+		configASSERT( uxCeilingPriority < ( UBaseType_t ) configMAX_PRIORITIES );
+
+		/* Set before any task can take it */
+		pxNewQueue = ( Queue_t * ) xQueueCreateMutex( queueQUEUE_TYPE_MUTEX );
+		if( pxNewQueue != NULL )
+		{
+			pxNewQueue->uxCeilingPriority = uxCeilingPriority;
+		}
+
+		return pxNewQueue;
+	}
+
+#endif /* configUSE_MUTEX_CEILING */
+/*-----------------------------------------------------------*/
+
 #if ( ( configUSE_MUTEXES == 1 ) && ( INCLUDE_xSemaphoreGetMutexHolder == 1 ) )
 
 	void* xQueueGetMutexHolder( QueueHandle_t xSemaphore )
@@ -596,6 +721,12 @@ int8_t *pcAllocatedBuffer;
 		{
 			( ( Queue_t * ) xHandle )->uxMessagesWaiting = uxInitialCount;
 
+			#if ( configUSE_QUEUE_PEAK == 1 )
+			{
+				( ( Queue_t * ) xHandle )->uxMessagesPeak = uxInitialCount;
+			}
+			#endif
+
 			traceCREATE_COUNTING_SEMAPHORE();
 		}
 		else
@@ -640,6 +771,33 @@ Queue_t * const pxQueue = ( Queue_t * ) xQueue;
 			if( ( pxQueue->uxMessagesWaiting < pxQueue->uxLength ) || ( xCopyPosition == queueOVERWRITE ) )
 			{
 				traceQUEUE_SEND( pxQueue );
+				prvCount( pxQueue, ulSends );
+
+				#if ( configUSE_QUEUE_FAST_PATH == 1 )
+				{
+					/* A small item to the back, nobody to wake and no mutex
+					to give back: store it and leave. */
+					if( ( xCopyPosition == queueSEND_TO_BACK ) && ( pxQueue->uxItemSize <= queueFAST_ITEM_SIZE ) &&
+						( pxQueue->uxQueueType != queueQUEUE_IS_MUTEX ) && ( queueNOT_IN_SET( pxQueue ) ) &&
+						( listLIST_IS_EMPTY( &( pxQueue->xTasksWaitingToReceive ) ) != pdFALSE ) )
+					{
+						if( pxQueue->uxItemSize != ( UBaseType_t ) 0 )
+						{
+							prvCopyItem( ( void * ) pxQueue->pcWriteTo, pvItemToQueue, pxQueue->uxItemSize );
+							pxQueue->pcWriteTo += pxQueue->uxItemSize;
+							if( pxQueue->pcWriteTo >= pxQueue->pcTail ) /*lint !e946 MISRA exception justified as comparison of pointers is the cleanest solution. */
+							{
+								pxQueue->pcWriteTo = pxQueue->pcHead;
+							}
+						}
+						++( pxQueue->uxMessagesWaiting );
+						prvNotePeak( pxQueue );
+						taskEXIT_CRITICAL();
+						return pdPASS;
+					}
+				}
+				#endif /* configUSE_QUEUE_FAST_PATH */
+
 				xYieldRequired = prvCopyDataToQueue( pxQueue, pvItemToQueue, xCopyPosition );
 
 				#if ( configUSE_QUEUE_SETS == 1 )
@@ -769,6 +927,7 @@ Queue_t * const pxQueue = ( Queue_t * ) xQueue;
 			if( prvIsQueueFull( pxQueue ) != pdFALSE )
 			{
 				traceBLOCKING_ON_QUEUE_SEND( pxQueue );
+				prvCount( pxQueue, ulBlocks );
 				vTaskPlaceOnEventList( &( pxQueue->xTasksWaitingToSend ), xTicksToWait );
 
 				/* Unlocking the queue means queue events can effect the
@@ -798,6 +957,7 @@ Queue_t * const pxQueue = ( Queue_t * ) xQueue;
 		else
 		{
 			/* The timeout has expired. */
+			prvCount( pxQueue, ulTimeouts );
 			prvUnlockQueue( pxQueue );
 			( void ) xTaskResumeAll();
 
@@ -1091,6 +1251,7 @@ Queue_t * const pxQueue = ( Queue_t * ) xQueue;
 		if( ( pxQueue->uxMessagesWaiting < pxQueue->uxLength ) || ( xCopyPosition == queueOVERWRITE ) )
 		{
 			traceQUEUE_SEND_FROM_ISR( pxQueue );
+			prvCount( pxQueue, ulSends );
 
 			/* A task can only have an inherited priority if it is a mutex
 			holder - and if there is a mutex holder then the mutex cannot be
@@ -1244,6 +1405,7 @@ Queue_t * const pxQueue = ( Queue_t * ) xQueue;
 		if( pxQueue->uxMessagesWaiting < pxQueue->uxLength )
 		{
 			traceQUEUE_SEND_FROM_ISR( pxQueue );
+			prvCount( pxQueue, ulSends );
 
 			/* A task can only have an inherited priority if it is a mutex
 			holder - and if there is a mutex holder then the mutex cannot be
@@ -1252,6 +1414,7 @@ Queue_t * const pxQueue = ( Queue_t * ) xQueue;
 			disinheritance here or to clear the mutex holder TCB member. */
 
 			++( pxQueue->uxMessagesWaiting );
+			prvNotePeak( pxQueue );
 
 			/* The event list is not altered if the queue is locked.  This will
 			be done when the queue is unlocked later. */
@@ -1364,6 +1527,10 @@ BaseType_t xEntryTimeSet = pdFALSE;
 TimeOut_t xTimeOut;
 int8_t *pcOriginalReadPosition;
 Queue_t * const pxQueue = ( Queue_t * ) xQueue;
+#if ( configUSE_LOCK_PROFILE == 1 )
+	BaseType_t xWaited = pdFALSE;
+	uint32_t ulWaitStart = 0U;
+#endif
 
 	configASSERT( pxQueue );
 	configASSERT( !( ( pvBuffer == NULL ) && ( pxQueue->uxItemSize != ( UBaseType_t ) 0U ) ) );
@@ -1385,6 +1552,24 @@ Queue_t * const pxQueue = ( Queue_t * ) xQueue;
 			must be	the highest priority task wanting to access the queue. */
 			if( pxQueue->uxMessagesWaiting > ( UBaseType_t ) 0 )
 			{
+				#if ( configUSE_QUEUE_FAST_PATH == 1 )
+				{
+					/* A small item taken, nobody waiting for the space and no
+					mutex holder to record: load it and leave. */
+					if( ( xJustPeeking == pdFALSE ) && ( pxQueue->uxItemSize <= queueFAST_ITEM_SIZE ) &&
+						( pxQueue->uxQueueType != queueQUEUE_IS_MUTEX ) &&
+						( listLIST_IS_EMPTY( &( pxQueue->xTasksWaitingToSend ) ) != pdFALSE ) )
+					{
+						prvCopyDataFromQueue( pxQueue, pvBuffer );
+						traceQUEUE_RECEIVE( pxQueue );
+						prvCount( pxQueue, ulReceives );
+						--( pxQueue->uxMessagesWaiting );
+						taskEXIT_CRITICAL();
+						return pdPASS;
+					}
+				}
+				#endif /* configUSE_QUEUE_FAST_PATH */
+
 				/* Remember the read position in case the queue is only being
 				peeked. */
 				pcOriginalReadPosition = pxQueue->u.pcReadFrom;
@@ -1394,6 +1579,7 @@ Queue_t * const pxQueue = ( Queue_t * ) xQueue;
 				if( xJustPeeking == pdFALSE )
 				{
 					traceQUEUE_RECEIVE( pxQueue );
+					prvCount( pxQueue, ulReceives );
 
 					/* Actually removing data, not just peeking. */
 					--( pxQueue->uxMessagesWaiting );
@@ -1405,6 +1591,19 @@ Queue_t * const pxQueue = ( Queue_t * ) xQueue;
 							/* Record the information required to implement
 							priority inheritance should it become necessary. */
 							pxQueue->pxMutexHolder = ( int8_t * ) pvTaskIncrementMutexHeldCount(); /*lint !e961 Cast is not redundant as TaskHandle_t is a typedef. */
+							prvLockTaken( pxQueue, xWaited, ulWaitStart );
+
+							#if ( configUSE_MUTEX_CEILING == 1 )
+							{
+								/* No other task that takes this mutex can
+								run until it is given back, which lowers the
+								priority again as for inheritance. */
+								if( pxQueue->uxCeilingPriority != ( UBaseType_t ) 0U )
+								{
+									vTaskPriorityRaise( pxQueue->uxCeilingPriority );
+								}
+							}
+							#endif /* configUSE_MUTEX_CEILING */
 						}
 						else
 						{
@@ -1500,11 +1699,24 @@ Queue_t * const pxQueue = ( Queue_t * ) xQueue;
 			if( prvIsQueueEmpty( pxQueue ) != pdFALSE )
 			{
 				traceBLOCKING_ON_QUEUE_RECEIVE( pxQueue );
+				prvCount( pxQueue, ulBlocks );
 
 				#if ( configUSE_MUTEXES == 1 )
 				{
 					if( pxQueue->uxQueueType == queueQUEUE_IS_MUTEX )
 					{
+						#if ( configUSE_LOCK_PROFILE == 1 )
+						{
+							/* The wait runs from the first time this call
+							blocks to the take, across any retries. */
+							if( xWaited == pdFALSE )
+							{
+								ulWaitStart = portGET_RUN_TIME_COUNTER_VALUE();
+								xWaited = pdTRUE;
+							}
+						}
+						#endif
+
 						taskENTER_CRITICAL();
 						{
 							vTaskPriorityInherit( ( void * ) pxQueue->pxMutexHolder );
@@ -1538,6 +1750,7 @@ Queue_t * const pxQueue = ( Queue_t * ) xQueue;
 		}
 		else
 		{
+			prvCount( pxQueue, ulTimeouts );
 			prvUnlockQueue( pxQueue );
 			( void ) xTaskResumeAll();
 			traceQUEUE_RECEIVE_FAILED( pxQueue );
@@ -1578,6 +1791,7 @@ Queue_t * const pxQueue = ( Queue_t * ) xQueue;
 		if( pxQueue->uxMessagesWaiting > ( UBaseType_t ) 0 )
 		{
 			traceQUEUE_RECEIVE_FROM_ISR( pxQueue );
+			prvCount( pxQueue, ulReceives );
 
 			prvCopyDataFromQueue( pxQueue, pvBuffer );
 			--( pxQueue->uxMessagesWaiting );
@@ -1704,6 +1918,123 @@ UBaseType_t uxReturn;
 } /*lint !e818 Pointer cannot be declared const as xQueue is a typedef not pointer. */
 /*-----------------------------------------------------------*/
 
+#if ( configUSE_QUEUE_PEAK == 1 )
+
+	UBaseType_t uxQueueMessagesPeak( const QueueHandle_t xQueue )
+	{
+	UBaseType_t uxReturn;
+
+		configASSERT( xQueue );
+
+		taskENTER_CRITICAL();
+		{
+			uxReturn = ( ( Queue_t * ) xQueue )->uxMessagesPeak;
+		}
+		taskEXIT_CRITICAL();
+
+		return uxReturn;
+	} /*lint !e818 Pointer cannot be declared const as xQueue is a typedef not pointer. */
+
+#endif /* configUSE_QUEUE_PEAK */
+/*-----------------------------------------------------------*/
+
+#if ( configUSE_QUEUE_COUNTERS == 1 )
+
+	void vQueueGetCounters( QueueHandle_t xQueue, QueueCounters_t *pxCounters )
+	{
+		configASSERT( xQueue );
+		configASSERT( pxCounters );
+
+		taskENTER_CRITICAL();
+		{
+			*pxCounters = ( ( Queue_t * ) xQueue )->xCounters;
+		}
+		taskEXIT_CRITICAL();
+	} /*lint !e818 Pointer cannot be declared const as xQueue is a typedef not pointer. */
+
+#endif /* configUSE_QUEUE_COUNTERS */
+/*-----------------------------------------------------------*/
+
+#if ( configUSE_LOCK_PROFILE == 1 )
+
+	BaseType_t xQueueGetLockProfile( QueueHandle_t xMutex, LockProfile_t *pxProfile )
+	{
+	Queue_t * const pxMutex = ( Queue_t * ) xMutex;
+	BaseType_t xReturn = pdFAIL;
+
+		configASSERT( pxMutex );
+		configASSERT( pxProfile );
+
+		taskENTER_CRITICAL();
+		{
+			if( pxMutex->uxQueueType == queueQUEUE_IS_MUTEX )
+			{
+				*pxProfile = pxMutex->xLockProfile;
+				xReturn = pdPASS;
+			}
+		}
+		taskEXIT_CRITICAL();
+
+		return xReturn;
+	}
+	/*-----------------------------------------------------------*/
+
+	void vQueueResetLockProfile( QueueHandle_t xMutex )
+	{
+	Queue_t * const pxMutex = ( Queue_t * ) xMutex;
+
+		configASSERT( pxMutex );
+
+		taskENTER_CRITICAL();
+		{
+			/* A holder inside its section keeps its start, its hold is
+			still measured when it gives the mutex back. */
+			( void ) memset( &( pxMutex->xLockProfile ), 0, sizeof( LockProfile_t ) );
+		}
+		taskEXIT_CRITICAL();
+	}
+	/*-----------------------------------------------------------*/
+
+	static void prvLockTaken( Queue_t * const pxQueue, const BaseType_t xWaited, const uint32_t ulWaitStart )
+	{
+	LockProfile_t * const pxProfile = &( pxQueue->xLockProfile );
+	uint32_t ulNow = portGET_RUN_TIME_COUNTER_VALUE(), ulWait;
+
+		pxQueue->ulTakenAt = ulNow;
+		pxProfile->ulTakes++;
+		if( xWaited != pdFALSE )
+		{
+			ulWait = ulNow - ulWaitStart;
+			pxProfile->ulContended++;
+			pxProfile->ullWaitTotal += ulWait;
+			if( ulWait > pxProfile->ulWaitMax )
+			{
+				pxProfile->ulWaitMax = ulWait;
+			}
+		}
+	}
+	/*-----------------------------------------------------------*/
+
+	static void prvLockGiven( Queue_t * const pxQueue )
+	{
+	LockProfile_t * const pxProfile = &( pxQueue->xLockProfile );
+	uint32_t ulHold;
+
+		/* Not the give that starts a new mutex off available */
+		if( pxQueue->pxMutexHolder != NULL )
+		{
+			ulHold = portGET_RUN_TIME_COUNTER_VALUE() - pxQueue->ulTakenAt;
+			if( ulHold > pxProfile->ulHoldMax )
+			{
+				pxProfile->ulHoldMax = ulHold;
+				pxProfile->pvHoldMaxHolder = ( void * ) pxQueue->pxMutexHolder;
+			}
+		}
+	}
+
+#endif /* configUSE_LOCK_PROFILE */
+/*-----------------------------------------------------------*/
+
 UBaseType_t uxQueueSpacesAvailable( const QueueHandle_t xQueue )
 {
 UBaseType_t uxReturn;
@@ -1780,6 +2111,31 @@ Queue_t * const pxQueue = ( Queue_t * ) xQueue;
 #endif /* configUSE_TRACE_FACILITY */
 /*-----------------------------------------------------------*/
 
+static inline void prvCopyItem( void *pvTo, const void *pvFrom, UBaseType_t uxItemSize )
+{
+#if ( configUSE_QUEUE_FAST_PATH == 1 )
+portPOINTER_SIZE_TYPE uxMisaligned = ( ( portPOINTER_SIZE_TYPE ) pvTo | ( portPOINTER_SIZE_TYPE ) pvFrom ) & ( portPOINTER_SIZE_TYPE ) ( uxItemSize - 1U ); /*lint !e923 MISRA exception.  Size differences accounted for using portPOINTER_SIZE_TYPE type. */
+
+	if( ( uxItemSize == sizeof( uint32_t ) ) && ( uxMisaligned == 0U ) )
+	{
+		*( uint32_t * ) pvTo = *( const uint32_t * ) pvFrom;
+	}
+	else if( ( uxItemSize == sizeof( uint16_t ) ) && ( uxMisaligned == 0U ) )
+	{
+		*( uint16_t * ) pvTo = *( const uint16_t * ) pvFrom;
+	}
+	else if( uxItemSize == sizeof( uint8_t ) )
+	{
+		*( uint8_t * ) pvTo = *( const uint8_t * ) pvFrom;
+	}
+	else
+#endif /* configUSE_QUEUE_FAST_PATH */
+	{
+		( void ) memcpy( pvTo, pvFrom, ( size_t ) uxItemSize ); /*lint !e961 !e418 MISRA exception as the casts are only redundant for some ports. */
+	}
+}
+/*-----------------------------------------------------------*/
+
 static BaseType_t prvCopyDataToQueue( Queue_t * const pxQueue, const void *pvItemToQueue, const BaseType_t xPosition )
 {
 BaseType_t xReturn = pdFALSE;
@@ -1791,6 +2147,7 @@ BaseType_t xReturn = pdFALSE;
 			if( pxQueue->uxQueueType == queueQUEUE_IS_MUTEX )
 			{
 				/* The mutex is no longer being held. */
+				prvLockGiven( pxQueue );
 				xReturn = xTaskPriorityDisinherit( ( void * ) pxQueue->pxMutexHolder );
 				pxQueue->pxMutexHolder = NULL;
 			}
@@ -1803,7 +2160,7 @@ BaseType_t xReturn = pdFALSE;
 	}
 	else if( xPosition == queueSEND_TO_BACK )
 	{
-		( void ) memcpy( ( void * ) pxQueue->pcWriteTo, pvItemToQueue, ( size_t ) pxQueue->uxItemSize ); /*lint !e961 !e418 MISRA exception as the casts are only redundant for some ports, plus previous logic ensures a null pointer can only be passed to memcpy() if the copy size is 0. */
+		prvCopyItem( ( void * ) pxQueue->pcWriteTo, pvItemToQueue, pxQueue->uxItemSize );
 		pxQueue->pcWriteTo += pxQueue->uxItemSize;
 		if( pxQueue->pcWriteTo >= pxQueue->pcTail ) /*lint !e946 MISRA exception justified as comparison of pointers is the cleanest solution. */
 		{
@@ -1816,7 +2173,7 @@ BaseType_t xReturn = pdFALSE;
 	}
 	else
 	{
-		( void ) memcpy( ( void * ) pxQueue->u.pcReadFrom, pvItemToQueue, ( size_t ) pxQueue->uxItemSize ); /*lint !e961 MISRA exception as the casts are only redundant for some ports. */
+		prvCopyItem( ( void * ) pxQueue->u.pcReadFrom, pvItemToQueue, pxQueue->uxItemSize );
 		pxQueue->u.pcReadFrom -= pxQueue->uxItemSize;
 		if( pxQueue->u.pcReadFrom < pxQueue->pcHead ) /*lint !e946 MISRA exception justified as comparison of pointers is the cleanest solution. */
 		{
@@ -1849,6 +2206,7 @@ BaseType_t xReturn = pdFALSE;
 	}
 
 	++( pxQueue->uxMessagesWaiting );
+	prvNotePeak( pxQueue );
 
 	return xReturn;
 }
@@ -1867,7 +2225,7 @@ static void prvCopyDataFromQueue( Queue_t * const pxQueue, void * const pvBuffer
 		{
 			mtCOVERAGE_TEST_MARKER();
 		}
-		( void ) memcpy( ( void * ) pvBuffer, ( void * ) pxQueue->u.pcReadFrom, ( size_t ) pxQueue->uxItemSize ); /*lint !e961 !e418 MISRA exception as the casts are only redundant for some ports.  Also previous logic ensures a null pointer can only be passed to memcpy() when the count is 0. */
+		prvCopyItem( pvBuffer, ( void * ) pxQueue->u.pcReadFrom, pxQueue->uxItemSize );
 	}
 }
 /*-----------------------------------------------------------*/
@@ -2396,6 +2754,42 @@ BaseType_t xReturn;
 #endif /* configQUEUE_REGISTRY_SIZE */
 /*-----------------------------------------------------------*/
 
+#if ( configQUEUE_REGISTRY_SIZE > 0 )
+
+	QueueHandle_t xQueueGetRegistryEntry( UBaseType_t uxIndex, const char **ppcName ) /*lint !e971 Unqualified char types are allowed for strings and single characters only. */
+	{
+	QueueHandle_t xReturn = NULL;
+	const char *pcName = NULL; /*lint !e971 Unqualified char types are allowed for strings and single characters only. */
+
+		if( uxIndex < ( UBaseType_t ) configQUEUE_REGISTRY_SIZE )
+		{
+			taskENTER_CRITICAL();
+			{
+				/* A NULL name is a vacant slot, whatever handle it kept. */
+				pcName = xQueueRegistry[ uxIndex ].pcQueueName;
+				if( pcName != NULL )
+				{
+					xReturn = xQueueRegistry[ uxIndex ].xHandle;
+				}
+			}
+			taskEXIT_CRITICAL();
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+
+		if( ppcName != NULL )
+		{
+			*ppcName = pcName;
+		}
+
+		return xReturn;
+	}
+
+#endif /* configQUEUE_REGISTRY_SIZE */
+/*-----------------------------------------------------------*/
+
 #if ( configUSE_TIMERS == 1 )
 
 	void vQueueWaitForMessageRestricted( QueueHandle_t xQueue, TickType_t xTicksToWait )
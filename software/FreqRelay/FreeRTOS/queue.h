@@ -944,6 +944,90 @@ UBaseType_t uxQueueMessagesWaiting( const QueueHandle_t xQueue ) PRIVILEGED_FUNC
  */
 UBaseType_t uxQueueSpacesAvailable( const QueueHandle_t xQueue ) PRIVILEGED_FUNCTION;
 
+/**
+ * queue. h
+ * <pre>UBaseType_t uxQueueMessagesPeak( const QueueHandle_t xQueue );</pre>
+ *
+ * Return the most items the queue has held at any one time since it was
+ * created.  Only available if configUSE_QUEUE_PEAK is set to 1 in
+ * FreeRTOSConfig.h.
+ *
+ * @param xQueue A handle to the queue being queried.
+ *
+ * @return The queue's high water mark, in items.
+ */
+UBaseType_t uxQueueMessagesPeak( const QueueHandle_t xQueue ) PRIVILEGED_FUNCTION;
+
+/*
+ * Contention profile of one mutex since it was created or last reset, taken
+ * in its take and give paths when configUSE_LOCK_PROFILE is 1.  Times are in
+ * run time counter counts (portGET_RUN_TIME_COUNTER_VALUE()).  A take is
+ * contended when the taker found the mutex held and blocked for it; its wait
+ * runs from that block to the take.  A hold runs from the take to the give,
+ * of the outermost take for a recursive mutex.
+ */
+typedef struct xLOCK_PROFILE
+{
+	uint32_t ulTakes;				/*< Takes that got the mutex. */
+	uint32_t ulContended;			/*< Of those, the ones that blocked first. */
+	uint32_t ulWaitMax;				/*< Longest wait of a contended take. */
+	uint64_t ullWaitTotal;			/*< All the contended takes' waits. */
+	uint32_t ulHoldMax;				/*< Longest hold. */
+	void *pvHoldMaxHolder;			/*< Task handle of the holder that held it longest. */
+} LockProfile_t;
+
+/**
+ * queue. h
+ * <pre>BaseType_t xQueueGetLockProfile( QueueHandle_t xMutex, LockProfile_t *pxProfile );</pre>
+ *
+ * Copy a mutex's contention profile.  Only available if
+ * configUSE_LOCK_PROFILE is set to 1 in FreeRTOSConfig.h.
+ *
+ * @param xMutex A handle to the mutex being queried.
+ *
+ * @param pxProfile Where the copy goes.
+ *
+ * @return pdPASS, or pdFAIL if xMutex is not a mutex.
+ */
+BaseType_t xQueueGetLockProfile( QueueHandle_t xMutex, LockProfile_t *pxProfile ) PRIVILEGED_FUNCTION;
+
+/**
+ * queue. h
+ * <pre>void vQueueResetLockProfile( QueueHandle_t xMutex );</pre>
+ *
+ * Start a mutex's contention profile again from zero.
+ */
+void vQueueResetLockProfile( QueueHandle_t xMutex ) PRIVILEGED_FUNCTION;
+
+/*
+ * Traffic through one queue, semaphore or mutex since it was created, counted
+ * in the send and receive paths when configUSE_QUEUE_COUNTERS is 1.  A give
+ * is a send and a take a receive; peeks are not counted.  A block is a task
+ * that found the queue full (or empty) and waited; a timeout is one of those
+ * whose block time ran out first.  Co-routine traffic (xQueueCRSend() and
+ * the rest) is not counted.  The counters wrap.
+ */
+typedef struct xQUEUE_COUNTERS
+{
+	uint32_t ulSends;				/*< Items sent, from tasks and interrupts. */
+	uint32_t ulReceives;			/*< Items received, from tasks and interrupts. */
+	uint32_t ulBlocks;				/*< Times a task blocked to send or receive. */
+	uint32_t ulTimeouts;			/*< Blocked sends and receives that gave up. */
+} QueueCounters_t;
+
+/**
+ * queue. h
+ * <pre>void vQueueGetCounters( QueueHandle_t xQueue, QueueCounters_t *pxCounters );</pre>
+ *
+ * Copy the traffic counters of a queue, semaphore or mutex.  Only available
+ * if configUSE_QUEUE_COUNTERS is set to 1 in FreeRTOSConfig.h.
+ *
+ * @param xQueue A handle to the queue being queried.
+ *
+ * @param pxCounters Where the copy goes.
+ */
+void vQueueGetCounters( QueueHandle_t xQueue, QueueCounters_t *pxCounters ) PRIVILEGED_FUNCTION;
+
 /**
  * queue. h
  * <pre>void vQueueDelete( QueueHandle_t xQueue );</pre>
@@ -1479,6 +1563,7 @@ BaseType_t xQueueCRReceive( QueueHandle_t xQueue, void *pvBuffer, TickType_t xTi
  * these functions directly.
  */
 QueueHandle_t xQueueCreateMutex( const uint8_t ucQueueType ) PRIVILEGED_FUNCTION;
+QueueHandle_t xQueueCreateMutexCeiling( const UBaseType_t uxCeilingPriority ) PRIVILEGED_FUNCTION;
 QueueHandle_t xQueueCreateCountingSemaphore( const UBaseType_t uxMaxCount, const UBaseType_t uxInitialCount ) PRIVILEGED_FUNCTION;
 void* xQueueGetMutexHolder( QueueHandle_t xSemaphore ) PRIVILEGED_FUNCTION;
 
@@ -1537,6 +1622,21 @@ BaseType_t xQueueGiveMutexRecursive( QueueHandle_t pxMutex ) PRIVILEGED_FUNCTION
 	void vQueueUnregisterQueue( QueueHandle_t xQueue ) PRIVILEGED_FUNCTION;
 #endif
 
+/*
+ * Walk the registry: the handle in registry slot uxIndex, and its name in
+ * *ppcName, or NULL for a vacant slot.  Slots run from 0 to
+ * configQUEUE_REGISTRY_SIZE - 1.
+ *
+ * @param uxIndex The registry slot.
+ *
+ * @param ppcName Where the name registered with the handle goes, may be NULL.
+ *
+ * @return The handle, or NULL if the slot is vacant or out of range.
+ */
+#if configQUEUE_REGISTRY_SIZE > 0
+	QueueHandle_t xQueueGetRegistryEntry( UBaseType_t uxIndex, const char **ppcName ) PRIVILEGED_FUNCTION; /*lint !e971 Unqualified char types are allowed for strings and single characters only. */
+#endif
+
 /*
  * Generic version of the queue creation function, which is in turn called by
  * any queue, semaphore or mutex creation function or macro.
@@ -693,6 +693,33 @@ typedef QueueHandle_t SemaphoreHandle_t;
 #define xSemaphoreCreateMutex() xQueueCreateMutex( queueQUEUE_TYPE_MUTEX )
 
 
+/**
+ * semphr. h
+ * <pre>SemaphoreHandle_t xSemaphoreCreateMutexCeiling( UBaseType_t uxCeilingPriority )</pre>
+ *
+ * <i>Macro</i> that creates a mutex with an immediate priority ceiling.
+ * A task that takes it runs at uxCeilingPriority (if it is below it) until it
+ * holds no mutex again, as a task that inherited a priority does.  With the
+ * ceiling at the priority of the highest task that takes the mutex, no other
+ * of them can run while it is held, so a task waits at most one section of a
+ * lower task and never for a chain of them.  Tasks above the ceiling are not
+ * held up at all.
+ *
+ * The ceiling must be at least the priority of every task that takes the
+ * mutex; one above it takes it as an ordinary mutex, with inheritance.  Only
+ * available when configUSE_MUTEX_CEILING is 1.
+ *
+ * @param uxCeilingPriority Priority the holder runs at, 0 for an ordinary
+ * mutex.
+ *
+ * @return Handle to the created mutex semaphore, or NULL.
+ *
+ * \defgroup xSemaphoreCreateMutexCeiling xSemaphoreCreateMutexCeiling
+ * \ingroup Semaphores
+ */
+#define xSemaphoreCreateMutexCeiling( uxCeilingPriority ) xQueueCreateMutexCeiling( ( uxCeilingPriority ) )
+
+
 /**
  * semphr. h
  * <pre>SemaphoreHandle_t xSemaphoreCreateRecursiveMutex( void )</pre>
@@ -612,6 +612,59 @@ void vTaskDelay( const TickType_t xTicksToDelay ) PRIVILEGED_FUNCTION;
  */
 void vTaskDelayUntil( TickType_t * const pxPreviousWakeTime, const TickType_t xTimeIncrement ) PRIVILEGED_FUNCTION;
 
+/**
+ * task. h
+ * <pre>void vTaskSetDeadline( TaskHandle_t xTask, TickType_t xRelativeDeadline );</pre>
+ *
+ * configUSE_EDF_SCHEDULING must be defined as 1 for this function to be
+ * available.
+ *
+ * Gives a task a deadline xRelativeDeadline ticks after each of its releases
+ * through vTaskDelayUntil(), the time it asks to wake at.  The ready tasks at
+ * configEDF_PRIORITY run earliest deadline first, and those without a
+ * deadline (the default, or xRelativeDeadline 0) only when none with one is
+ * ready.  At every other priority the deadline is ignored.
+ *
+ * A task with a deadline at configEDF_PRIORITY should be released only by
+ * vTaskDelayUntil(): after any other wait it still has the deadline of its
+ * last release.
+ *
+ * @param xTask Handle of the task, NULL for the calling task.
+ *
+ * @param xRelativeDeadline Ticks from each release, usually the period.
+ *
+ * \defgroup vTaskSetDeadline vTaskSetDeadline
+ * \ingroup TaskCtrl
+ */
+void vTaskSetDeadline( TaskHandle_t xTask, TickType_t xRelativeDeadline ) PRIVILEGED_FUNCTION;
+
+/**
+ * task. h
+ * <pre>void vTaskSetNewlibReent( TaskHandle_t xTask, struct _reent *pxReent );</pre>
+ *
+ * configUSE_NEWLIB_REENTRANT must be defined as 2 for this function to be
+ * available.
+ *
+ * Gives a task its own newlib context: errno, the stdio streams and their
+ * buffers, strtok() and the rest of the C library's per thread state.  The
+ * kernel points _impure_ptr at it whenever the task runs.  A task without one
+ * runs on newlib's global context, which every such task shares, so only a
+ * task that keeps no libc state can do without.
+ *
+ * The structure is initialised here and must last as long as the task.  The
+ * stdio buffers newlib allocates in it are freed when the task is deleted.
+ *
+ * @param xTask Handle of the task, NULL for the calling task.
+ *
+ * @param pxReent Context for the task, NULL for newlib's global one.
+ *
+ * \defgroup vTaskSetNewlibReent vTaskSetNewlibReent
+ * \ingroup TaskCtrl
+ */
+#if ( configUSE_NEWLIB_REENTRANT == 2 )
+	void vTaskSetNewlibReent( TaskHandle_t xTask, struct _reent *pxReent ) PRIVILEGED_FUNCTION;
+#endif
+
 /**
  * task. h
  * <pre>UBaseType_t uxTaskPriorityGet( TaskHandle_t xTask );</pre>
@@ -1180,6 +1233,19 @@ BaseType_t xTaskCallApplicationTaskHook( TaskHandle_t xTask, void *pvParameter )
  */
 TaskHandle_t xTaskGetIdleTaskHandle( void );
 
+/**
+ * ulTaskGetIdleRunTimeCounter() is only available if
+ * configGENERATE_RUN_TIME_STATS and INCLUDE_xTaskGetIdleTaskHandle are both
+ * set to 1 in FreeRTOSConfig.h.
+ *
+ * Returns the run time counter of the idle task, in the units of
+ * portGET_RUN_TIME_COUNTER_VALUE(), without the scheduler suspension of
+ * uxTaskGetSystemState(). It is up to date whenever the idle task is not
+ * running, so from any other task. Not valid before the scheduler has been
+ * started.
+ */
+uint32_t ulTaskGetIdleRunTimeCounter( void );
+
 /**
  * configUSE_TRACE_FACILITY must be defined as 1 in FreeRTOSConfig.h for
  * uxTaskGetSystemState() to be available.
@@ -1942,6 +2008,14 @@ void vTaskPriorityInherit( TaskHandle_t const pxMutexHolder ) PRIVILEGED_FUNCTIO
  */
 BaseType_t xTaskPriorityDisinherit( TaskHandle_t const pxMutexHolder ) PRIVILEGED_FUNCTION;
 
+/*
+ * Raises the calling task, which has just taken a ceiling mutex, to the
+ * mutex's ceiling priority should it be running below it.  Called from a
+ * critical section.  xTaskPriorityDisinherit() lowers it again once it holds
+ * no mutex.
+ */
+void vTaskPriorityRaise( UBaseType_t uxCeilingPriority ) PRIVILEGED_FUNCTION;
+
 /*
  * Generic version of the task creation function which is in turn called by the
  * xTaskCreate() and xTaskCreateRestricted() macros.
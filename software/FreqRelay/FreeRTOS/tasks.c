@@ -181,6 +181,10 @@ typedef struct tskTaskControlBlock
 		stubs. Be warned that (at the time of writing) the current newlib design
 		implements a system-wide malloc() that must be provided with locks. */
 		struct 	_reent xNewLib_reent;
+	#elif ( configUSE_NEWLIB_REENTRANT == 2 )
+		/* The application's libc context for the task, or newlib's global
+		one for a task that keeps no libc state of its own. */
+		struct	_reent *pxNewLib_reent;
 	#endif
 
 	#if ( configUSE_TASK_NOTIFICATIONS == 1 )
@@ -188,6 +192,11 @@ typedef struct tskTaskControlBlock
 		volatile eNotifyValue eNotifyState;
 	#endif
 
+	#if ( configUSE_EDF_SCHEDULING == 1 )
+		TickType_t		xRelativeDeadline;	/*< Ticks from each vTaskDelayUntil() release, 0 for no deadline. */
+		TickType_t		xAbsoluteDeadline;	/*< Deadline of the job in progress, orders the tasks at configEDF_PRIORITY. */
+	#endif
+
 } tskTCB;
 
 /* The old tskTCB name is maintained above then typedefed to the new TCB_t name
@@ -282,6 +291,46 @@ PRIVILEGED_DATA static volatile UBaseType_t uxSchedulerSuspended	= ( UBaseType_t
 
 /*-----------------------------------------------------------*/
 
+#if ( configUSE_EDF_SCHEDULING == 1 )
+
+	/* The tasks at configEDF_PRIORITY take turns by deadline rather than round
+	robin, every other priority as usual.  A task there preempts another one
+	there whose deadline is later.  Deadlines compare across the tick count
+	wrap, as long as they are less than half its range apart. */
+	#define taskSELECT_FROM_READY_LIST( uxPriority )													\
+	{																									\
+		if( ( uxPriority ) == ( UBaseType_t ) configEDF_PRIORITY )										\
+		{																								\
+			pxCurrentTCB = prvEarliestDeadline( &( pxReadyTasksLists[ configEDF_PRIORITY ] ) );			\
+		}																								\
+		else																							\
+		{																								\
+			listGET_OWNER_OF_NEXT_ENTRY( pxCurrentTCB, &( pxReadyTasksLists[ ( uxPriority ) ] ) );		\
+		}																								\
+	}
+
+	#define taskDEADLINE_BEFORE( pxA, pxB )																\
+		( ( ( pxA )->xRelativeDeadline != ( TickType_t ) 0U ) &&										\
+		  ( ( ( pxB )->xRelativeDeadline == ( TickType_t ) 0U ) ||										\
+			( ( TickType_t ) ( ( pxA )->xAbsoluteDeadline - ( pxB )->xAbsoluteDeadline ) > ( portMAX_DELAY >> 1 ) ) ) )
+
+	#define taskPREEMPTS_CURRENT( pxTCB )																\
+		( ( ( pxTCB )->uxPriority > pxCurrentTCB->uxPriority ) ||										\
+		  ( ( ( pxTCB )->uxPriority == ( UBaseType_t ) configEDF_PRIORITY ) &&							\
+			( pxCurrentTCB->uxPriority == ( UBaseType_t ) configEDF_PRIORITY ) &&						\
+			taskDEADLINE_BEFORE( ( pxTCB ), pxCurrentTCB ) ) )
+
+#else
+
+	#define taskSELECT_FROM_READY_LIST( uxPriority )													\
+		listGET_OWNER_OF_NEXT_ENTRY( pxCurrentTCB, &( pxReadyTasksLists[ ( uxPriority ) ] ) )
+
+	#define taskPREEMPTS_CURRENT( pxTCB ) ( ( pxTCB )->uxPriority > pxCurrentTCB->uxPriority )
+
+#endif /* configUSE_EDF_SCHEDULING */
+
+/*-----------------------------------------------------------*/
+
 #if ( configUSE_PORT_OPTIMISED_TASK_SELECTION == 0 )
 
 	/* If configUSE_PORT_OPTIMISED_TASK_SELECTION is 0 then task selection is
@@ -311,7 +360,7 @@ PRIVILEGED_DATA static volatile UBaseType_t uxSchedulerSuspended	= ( UBaseType_t
 																										\
 		/* listGET_OWNER_OF_NEXT_ENTRY indexes through the list, so the tasks of						\
 		the	same priority get an equal share of the processor time. */									\
-		listGET_OWNER_OF_NEXT_ENTRY( pxCurrentTCB, &( pxReadyTasksLists[ uxTopReadyPriority ] ) );		\
+		taskSELECT_FROM_READY_LIST( uxTopReadyPriority );												\
 	} /* taskSELECT_HIGHEST_PRIORITY_TASK */
 
 	/*-----------------------------------------------------------*/
@@ -340,7 +389,7 @@ PRIVILEGED_DATA static volatile UBaseType_t uxSchedulerSuspended	= ( UBaseType_t
 		/* Find the highest priority queue that contains ready tasks. */							\
 		portGET_HIGHEST_PRIORITY( uxTopPriority, uxTopReadyPriority );								\
 		configASSERT( listCURRENT_LIST_LENGTH( &( pxReadyTasksLists[ uxTopPriority ] ) ) > 0 );		\
-		listGET_OWNER_OF_NEXT_ENTRY( pxCurrentTCB, &( pxReadyTasksLists[ uxTopPriority ] ) );		\
+		taskSELECT_FROM_READY_LIST( uxTopPriority );												\
 	} /* taskSELECT_HIGHEST_PRIORITY_TASK() */
 
 	/*-----------------------------------------------------------*/
@@ -427,6 +476,17 @@ to its original value when it is released. */
  */
 static void prvInitialiseTCBVariables( TCB_t * const pxTCB, const char * const pcName, UBaseType_t uxPriority, const MemoryRegion_t * const xRegions, const uint16_t usStackDepth ) PRIVILEGED_FUNCTION; /*lint !e971 Unqualified char types are allowed for strings and single characters only. */
 
+#if ( configUSE_EDF_SCHEDULING == 1 )
+
+	/*
+	 * The ready task of pxList with the earliest deadline, tasks without a
+	 * deadline after every task with one.  The scan starts after the task
+	 * chosen last, so equal deadlines still take turns.
+	 */
+	static TCB_t *prvEarliestDeadline( List_t * const pxList ) PRIVILEGED_FUNCTION;
+
+#endif
+
 /**
  * Utility task that simply returns pdTRUE if the task referenced by xTask is
  * currently in the Suspended state, or pdFALSE if the task referenced by xTask
@@ -691,8 +751,10 @@ StackType_t *pxTopOfStack;
 
 			#if ( configUSE_TRACE_FACILITY == 1 )
 			{
-				/* Add a counter into the TCB for tracing only. */
+				/* Add a counter into the TCB for tracing only.  The task
+				number is the application's, and none until it sets one. */
 				pxNewTCB->uxTCBNumber = uxTaskNumber;
+				pxNewTCB->uxTaskNumber = 0U;
 			}
 			#endif /* configUSE_TRACE_FACILITY */
 			traceTASK_CREATE( pxNewTCB );
@@ -871,6 +933,13 @@ StackType_t *pxTopOfStack;
 			/* Update the wake time ready for the next call. */
 			*pxPreviousWakeTime = xTimeToWake;
 
+			#if ( configUSE_EDF_SCHEDULING == 1 )
+			{
+				/* The next job is released at the wake time */
+				pxCurrentTCB->xAbsoluteDeadline = xTimeToWake + pxCurrentTCB->xRelativeDeadline;
+			}
+			#endif /* configUSE_EDF_SCHEDULING */
+
 			if( xShouldDelay != pdFALSE )
 			{
 				traceTASK_DELAY_UNTIL();
@@ -1582,6 +1651,10 @@ BaseType_t xReturn;
 			structure specific to the task that will run first. */
 			_impure_ptr = &( pxCurrentTCB->xNewLib_reent );
 		}
+		#elif ( configUSE_NEWLIB_REENTRANT == 2 )
+		{
+			_impure_ptr = pxCurrentTCB->pxNewLib_reent;
+		}
 		#endif /* configUSE_NEWLIB_REENTRANT */
 
 		xSchedulerRunning = pdTRUE;
@@ -1912,6 +1985,19 @@ UBaseType_t uxTaskGetNumberOfTasks( void )
 #endif /* INCLUDE_xTaskGetIdleTaskHandle */
 /*----------------------------------------------------------*/
 
+#if ( configGENERATE_RUN_TIME_STATS == 1 ) && ( INCLUDE_xTaskGetIdleTaskHandle == 1 )
+
+	uint32_t ulTaskGetIdleRunTimeCounter( void )
+	{
+		/* A single word, and only brought up to date when the idle task is
+		switched out, which it is whenever another task is calling this. */
+		configASSERT( ( xIdleTaskHandle != NULL ) );
+		return ( ( TCB_t * ) xIdleTaskHandle )->ulRunTimeCounter;
+	}
+
+#endif /* configGENERATE_RUN_TIME_STATS && INCLUDE_xTaskGetIdleTaskHandle */
+/*----------------------------------------------------------*/
+
 /* This conditional compilation should use inequality to 0, not equality to 1.
 This is to ensure vTaskStepTick() is available when user defined low power mode
 implementations require configUSE_TICKLESS_IDLE to be set to a value other than
@@ -2250,6 +2336,10 @@ void vTaskSwitchContext( void )
 			structure specific to this task. */
 			_impure_ptr = &( pxCurrentTCB->xNewLib_reent );
 		}
+		#elif ( configUSE_NEWLIB_REENTRANT == 2 )
+		{
+			_impure_ptr = pxCurrentTCB->pxNewLib_reent;
+		}
 		#endif /* configUSE_NEWLIB_REENTRANT */
 	}
 }
@@ -2459,7 +2549,7 @@ BaseType_t xReturn;
 		vListInsertEnd( &( xPendingReadyList ), &( pxUnblockedTCB->xEventListItem ) );
 	}
 
-	if( pxUnblockedTCB->uxPriority > pxCurrentTCB->uxPriority )
+	if( taskPREEMPTS_CURRENT( pxUnblockedTCB ) )
 	{
 		/* Return true if the task removed from the event list has a higher
 		priority than the calling task.  This allows the calling task to know if
@@ -2517,7 +2607,7 @@ BaseType_t xReturn;
 	( void ) uxListRemove( &( pxUnblockedTCB->xGenericListItem ) );
 	prvAddTaskToReadyList( pxUnblockedTCB );
 
-	if( pxUnblockedTCB->uxPriority > pxCurrentTCB->uxPriority )
+	if( taskPREEMPTS_CURRENT( pxUnblockedTCB ) )
 	{
 		/* Return true if the task removed from the event list has
 		a higher priority than the calling task.  This allows
@@ -2842,6 +2932,13 @@ UBaseType_t x;
 	}
 	#endif /* configUSE_MUTEXES */
 
+	#if ( configUSE_EDF_SCHEDULING == 1 )
+	{
+		pxTCB->xRelativeDeadline = ( TickType_t ) 0U;
+		pxTCB->xAbsoluteDeadline = ( TickType_t ) 0U;
+	}
+	#endif /* configUSE_EDF_SCHEDULING */
+
 	vListInitialiseItem( &( pxTCB->xGenericListItem ) );
 	vListInitialiseItem( &( pxTCB->xEventListItem ) );
 
@@ -2894,6 +2991,10 @@ UBaseType_t x;
 		/* Initialise this task's Newlib reent structure. */
 		_REENT_INIT_PTR( ( &( pxTCB->xNewLib_reent ) ) );
 	}
+	#elif ( configUSE_NEWLIB_REENTRANT == 2 )
+	{
+		pxTCB->pxNewLib_reent = _GLOBAL_REENT;
+	}
 	#endif /* configUSE_NEWLIB_REENTRANT */
 }
 /*-----------------------------------------------------------*/
@@ -3239,6 +3340,14 @@ TCB_t *pxNewTCB;
 		{
 			_reclaim_reent( &( pxTCB->xNewLib_reent ) );
 		}
+		#elif ( configUSE_NEWLIB_REENTRANT == 2 )
+		{
+			/* The structure is the application's, its stdio buffers are not */
+			if( pxTCB->pxNewLib_reent != _GLOBAL_REENT )
+			{
+				_reclaim_reent( pxTCB->pxNewLib_reent );
+			}
+		}
 		#endif /* configUSE_NEWLIB_REENTRANT */
 
 		#if( portUSING_MPU_WRAPPERS == 1 )
@@ -3395,6 +3504,129 @@ TCB_t *pxTCB;
 #endif /* configUSE_MUTEXES */
 /*-----------------------------------------------------------*/
 
+#if ( configUSE_NEWLIB_REENTRANT == 2 )
+
+	void vTaskSetNewlibReent( TaskHandle_t xTask, struct _reent *pxReent )
+	{
+	TCB_t *pxTCB;
+
+		if( pxReent != NULL )
+		{
+			_REENT_INIT_PTR( pxReent );
+		}
+		else
+		{
+			pxReent = _GLOBAL_REENT;
+		}
+
+		taskENTER_CRITICAL();
+		{
+			pxTCB = prvGetTCBFromHandle( xTask );
+			pxTCB->pxNewLib_reent = pxReent;
+
+			if( ( pxTCB == pxCurrentTCB ) && ( xSchedulerRunning != pdFALSE ) )
+			{
+				_impure_ptr = pxReent;
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+		taskEXIT_CRITICAL();
+	}
+
+#endif /* configUSE_NEWLIB_REENTRANT */
+/*-----------------------------------------------------------*/
+
+#if ( configUSE_EDF_SCHEDULING == 1 )
+
+	void vTaskSetDeadline( TaskHandle_t xTask, TickType_t xRelativeDeadline )
+	{
+	TCB_t *pxTCB;
+
+		taskENTER_CRITICAL();
+		{
+			pxTCB = prvGetTCBFromHandle( xTask );
+			pxTCB->xRelativeDeadline = xRelativeDeadline;
+
+			/* Until its first vTaskDelayUntil(), as if released now */
+			pxTCB->xAbsoluteDeadline = xTickCount + xRelativeDeadline;
+		}
+		taskEXIT_CRITICAL();
+	}
+	/*-----------------------------------------------------------*/
+
+	static TCB_t *prvEarliestDeadline( List_t * const pxList )
+	{
+	ListItem_t *pxItem = pxList->pxIndex, *pxChosen = NULL;
+	TCB_t *pxTCB, *pxChosenTCB = NULL;
+	UBaseType_t uxLeft = listCURRENT_LIST_LENGTH( pxList );
+
+		while( uxLeft > ( UBaseType_t ) 0 )
+		{
+			pxItem = pxItem->pxNext;
+			if( ( void * ) pxItem == ( void * ) &( pxList->xListEnd ) )
+			{
+				continue;
+			}
+			uxLeft--;
+
+			pxTCB = ( TCB_t * ) listGET_LIST_ITEM_OWNER( pxItem );
+			if( ( pxChosenTCB == NULL ) || taskDEADLINE_BEFORE( pxTCB, pxChosenTCB ) )
+			{
+				pxChosenTCB = pxTCB;
+				pxChosen = pxItem;
+			}
+		}
+
+		/* As listGET_OWNER_OF_NEXT_ENTRY() leaves it */
+		pxList->pxIndex = pxChosen;
+		return pxChosenTCB;
+	}
+
+#endif /* configUSE_EDF_SCHEDULING */
+/*-----------------------------------------------------------*/
+
+#if ( ( configUSE_MUTEXES == 1 ) && ( configUSE_MUTEX_CEILING == 1 ) )
+
+	void vTaskPriorityRaise( UBaseType_t uxCeilingPriority )
+	{
+		if( pxCurrentTCB->uxPriority < uxCeilingPriority )
+		{
+			/* As for inheritance, but the task is the running one, so it is
+			in the ready list of its priority. */
+			if( ( listGET_LIST_ITEM_VALUE( &( pxCurrentTCB->xEventListItem ) ) & taskEVENT_LIST_ITEM_VALUE_IN_USE ) == 0UL )
+			{
+				listSET_LIST_ITEM_VALUE( &( pxCurrentTCB->xEventListItem ), ( TickType_t ) configMAX_PRIORITIES - ( TickType_t ) uxCeilingPriority ); /*lint !e961 MISRA exception as the casts are only redundant for some ports. */
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+
+			if( uxListRemove( &( pxCurrentTCB->xGenericListItem ) ) == ( UBaseType_t ) 0 )
+			{
+				taskRESET_READY_PRIORITY( pxCurrentTCB->uxPriority );
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+
+			traceTASK_PRIORITY_INHERIT( pxCurrentTCB, uxCeilingPriority );
+			pxCurrentTCB->uxPriority = uxCeilingPriority;
+			prvAddTaskToReadyList( pxCurrentTCB );
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+
+#endif /* configUSE_MUTEX_CEILING */
+/*-----------------------------------------------------------*/
+
 #if ( configUSE_MUTEXES == 1 )
 
 	BaseType_t xTaskPriorityDisinherit( TaskHandle_t const pxMutexHolder )
@@ -3822,6 +4054,8 @@ TickType_t uxReturn;
 
 				if( xTicksToWait > ( TickType_t ) 0 )
 				{
+					traceTASK_NOTIFY_TAKE_BLOCK();
+
 					/* The task is going to block.  First it must be removed
 					from the ready list. */
 					if( uxListRemove( &( pxCurrentTCB->xGenericListItem ) ) == ( UBaseType_t ) 0 )
@@ -3887,6 +4121,7 @@ TickType_t uxReturn;
 
 		taskENTER_CRITICAL();
 		{
+			traceTASK_NOTIFY_TAKE();
 			ulReturn = pxCurrentTCB->ulNotifiedValue;
 
 			if( ulReturn != 0UL )
@@ -3937,6 +4172,8 @@ TickType_t uxReturn;
 
 				if( xTicksToWait > ( TickType_t ) 0 )
 				{
+					traceTASK_NOTIFY_WAIT_BLOCK();
+
 					/* The task is going to block.  First it must be removed
 					from the	ready list. */
 					if( uxListRemove( &( pxCurrentTCB->xGenericListItem ) ) == ( UBaseType_t ) 0 )
@@ -4002,6 +4239,8 @@ TickType_t uxReturn;
 
 		taskENTER_CRITICAL();
 		{
+			traceTASK_NOTIFY_WAIT();
+
 			if( pulNotificationValue != NULL )
 			{
 				/* Output the current notification value, which may or may not
@@ -4085,6 +4324,7 @@ TickType_t uxReturn;
 					break;
 			}
 
+			traceTASK_NOTIFY();
 
 			/* If the task is in the blocked state specifically to wait for a
 			notification then unblock it now. */
@@ -4096,7 +4336,7 @@ TickType_t uxReturn;
 				/* The task should not have been on an event list. */
 				configASSERT( listLIST_ITEM_CONTAINER( &( pxTCB->xEventListItem ) ) == NULL );
 
-				if( pxTCB->uxPriority > pxCurrentTCB->uxPriority )
+				if( taskPREEMPTS_CURRENT( pxTCB ) )
 				{
 					/* The notified task has a priority above the currently
 					executing task so a yield is required. */
@@ -4189,6 +4429,7 @@ TickType_t uxReturn;
 					break;
 			}
 
+			traceTASK_NOTIFY_FROM_ISR();
 
 			/* If the task is in the blocked state specifically to wait for a
 			notification then unblock it now. */
@@ -4209,7 +4450,7 @@ TickType_t uxReturn;
 					vListInsertEnd( &( xPendingReadyList ), &( pxTCB->xEventListItem ) );
 				}
 
-				if( pxTCB->uxPriority > pxCurrentTCB->uxPriority )
+				if( taskPREEMPTS_CURRENT( pxTCB ) )
 				{
 					/* The notified task has a priority above the currently
 					executing task so a yield is required. */
@@ -4271,6 +4512,8 @@ TickType_t uxReturn;
 			semaphore. */
 			( pxTCB->ulNotifiedValue )++;
 
+			traceTASK_NOTIFY_GIVE_FROM_ISR();
+
 			/* If the task is in the blocked state specifically to wait for a
 			notification then unblock it now. */
 			if( eOriginalNotifyState == eWaitingNotification )
@@ -4290,7 +4533,7 @@ TickType_t uxReturn;
 					vListInsertEnd( &( xPendingReadyList ), &( pxTCB->xEventListItem ) );
 				}
 
-				if( pxTCB->uxPriority > pxCurrentTCB->uxPriority )
+				if( taskPREEMPTS_CURRENT( pxTCB ) )
 				{
 					/* The notified task has a priority above the currently
 					executing task so a yield is required. */
@@ -109,6 +109,7 @@ typedef struct tmrTimerControl
 	UBaseType_t				uxAutoReload;		/*<< Set to pdTRUE if the timer should be automatically restarted once expired.  Set to pdFALSE if the timer is, in effect, a one-shot timer. */
 	void 					*pvTimerID;			/*<< An ID to identify the timer.  This allows the timer to be identified when the same callback is used for multiple timers. */
 	TimerCallbackFunction_t	pxCallbackFunction;	/*<< The function that will be called when the timer expires. */
+	struct tmrTimerService	*pxService;			/*<< The daemon the timer was created for, which all its commands go to. */
 	#if( configUSE_TRACE_FACILITY == 1 )
 		UBaseType_t			uxTimerNumber;		/*<< An ID assigned by trace tools such as FreeRTOS+Trace */
 	#endif
@@ -157,29 +158,65 @@ typedef struct tmrTimerQueueMessage
 /*lint -e956 A manual analysis and inspection has been used to determine which
 static variables must be declared volatile. */
 
-/* The list in which active timers are stored.  Timers are referenced in expire
-time order, with the nearest expiry time at the front of the list.  Only the
-timer service task is allowed to access these lists. */
-PRIVILEGED_DATA static List_t xActiveTimerList1;
-PRIVILEGED_DATA static List_t xActiveTimerList2;
-PRIVILEGED_DATA static List_t *pxCurrentTimerList;
-PRIVILEGED_DATA static List_t *pxOverflowTimerList;
+#if ( configUSE_TIMER_WHEEL == 1 )
 
-/* A queue that is used to send commands to the timer service task. */
-PRIVILEGED_DATA static QueueHandle_t xTimerQueue = NULL;
+	/* Slot of an expiry tick, and a bit for every slot. */
+	#define tmrWHEEL_MASK			( ( TickType_t ) configTIMER_WHEEL_SLOTS - ( TickType_t ) 1U )
+	#define tmrWHEEL_ALL_SLOTS		( 0xFFFFFFFFUL >> ( 32 - configTIMER_WHEEL_SLOTS ) )
 
-#if ( INCLUDE_xTimerGetTimerDaemonTaskHandle == 1 )
+#endif /* configUSE_TIMER_WHEEL */
 
-	PRIVILEGED_DATA static TaskHandle_t xTimerTaskHandle = NULL;
+/* The timer service tasks: the daemon at configTIMER_TASK_PRIORITY, and with
+configUSE_TIMER_BACKGROUND set the background one at
+configTIMER_BACKGROUND_PRIORITY. */
+#define tmrCONTROL_SERVICE		0
+#define tmrBACKGROUND_SERVICE	1
+#define tmrSERVICES				( 1 + configUSE_TIMER_BACKGROUND )
 
-#endif
+/* What one timer service task works with.  Each has its own active timers and
+its own command queue, so the two never wait on each other. */
+typedef struct tmrTimerService
+{
+	#if ( configUSE_TIMER_WHEEL == 1 )
+
+		/* The wheel in which active timers are stored.  A timer is in the slot
+		of its expiry tick modulo configTIMER_WHEEL_SLOTS, in no particular
+		order, with the expiry tick as its item value, so it goes in and out in
+		constant time and the tick count overflowing needs no second list.  A
+		slot holds the timers due on this turn of the wheel and those due on
+		later ones.  ulWheelOccupied has a bit set for each slot that is not
+		empty, and every timer due before xWheelTime has been processed.  Only
+		the service's task is allowed to access these. */
+		List_t xTimerWheel[ configTIMER_WHEEL_SLOTS ];
+		uint32_t ulWheelOccupied;
+		TickType_t xWheelTime;
+
+	#else
+
+		/* The list in which active timers are stored.  Timers are referenced in
+		expire time order, with the nearest expiry time at the front of the
+		list.  Only the service's task is allowed to access these lists. */
+		List_t xActiveTimerList1;
+		List_t xActiveTimerList2;
+		List_t *pxCurrentTimerList;
+		List_t *pxOverflowTimerList;
+		TickType_t xLastTime;			/*<< The tick count prvSampleTimeNow() last saw. */
+
+	#endif /* configUSE_TIMER_WHEEL */
+
+	/* A queue that is used to send commands to the service's task. */
+	QueueHandle_t xTimerQueue;
+	TaskHandle_t xTimerTaskHandle;
+} TimerService_t;
+
+PRIVILEGED_DATA static TimerService_t xTimerServices[ tmrSERVICES ];
 
 /*lint +e956 */
 
 /*-----------------------------------------------------------*/
 
 /*
- * Initialise the infrastructure used by the timer service task if it has not
+ * Initialise the infrastructure used by the timer service tasks if it has not
  * been initialised already.
  */
 static void prvCheckForValidListAndQueue( void ) PRIVILEGED_FUNCTION;
@@ -187,7 +224,7 @@ static void prvCheckForValidListAndQueue( void ) PRIVILEGED_FUNCTION;
 /*
  * The timer service task (daemon).  Timer functionality is controlled by this
  * task.  Other tasks communicate with the timer service task using the
- * xTimerQueue queue.
+ * xTimerQueue queue of its TimerService_t, passed as pvParameters.
  */
 static void prvTimerTask( void *pvParameters ) PRIVILEGED_FUNCTION;
 
@@ -195,45 +232,100 @@ static void prvTimerTask( void *pvParameters ) PRIVILEGED_FUNCTION;
  * Called by the timer service task to interpret and process a command it
  * received on the timer queue.
  */
-static void	prvProcessReceivedCommands( void ) PRIVILEGED_FUNCTION;
+static void	prvProcessReceivedCommands( TimerService_t * const pxService ) PRIVILEGED_FUNCTION;
 
 /*
  * Insert the timer into either xActiveTimerList1, or xActiveTimerList2,
- * depending on if the expire time causes a timer counter overflow.
+ * depending on if the expire time causes a timer counter overflow, or into
+ * its slot of the wheel.
  */
 static BaseType_t prvInsertTimerInActiveList( Timer_t * const pxTimer, const TickType_t xNextExpiryTime, const TickType_t xTimeNow, const TickType_t xCommandTime ) PRIVILEGED_FUNCTION;
 
 /*
- * An active timer has reached its expire time.  Reload the timer if it is an
- * auto reload timer, then call its callback.
+ * Take an active timer out of the list or wheel slot it is in.
  */
-static void prvProcessExpiredTimer( const TickType_t xNextExpireTime, const TickType_t xTimeNow ) PRIVILEGED_FUNCTION;
+static void prvRemoveTimerFromActiveList( Timer_t * const pxTimer ) PRIVILEGED_FUNCTION;
 
 /*
- * The tick count has overflowed.  Switch the timer lists after ensuring the
- * current timer list does not still reference some timers.
+ * An active timer has reached its expire time.  Reload the timer if it is an
+ * auto reload timer, then call its callback.
  */
-static void prvSwitchTimerLists( void ) PRIVILEGED_FUNCTION;
+static void prvProcessExpiredTimer( Timer_t * const pxTimer, const TickType_t xNextExpireTime, const TickType_t xTimeNow ) PRIVILEGED_FUNCTION;
+
+#if ( configUSE_TIMER_WHEEL == 1 )
+
+	/*
+	 * Move xWheelTime on towards xTimeNow, skipping empty slots, and return
+	 * the first timer found due at xWheelTime, or NULL having reached
+	 * xTimeNow with nothing due.
+	 */
+	static Timer_t *prvWheelNextDue( TimerService_t * const pxService, const TickType_t xTimeNow ) PRIVILEGED_FUNCTION;
+
+	/*
+	 * Ticks from uxSlot to the next slot that is not empty, 1 to
+	 * configTIMER_WHEEL_SLOTS (uxSlot itself).  Some slot must be occupied.
+	 */
+	static TickType_t prvWheelTicksToNextSlot( const TimerService_t * const pxService, const UBaseType_t uxSlot ) PRIVILEGED_FUNCTION;
+
+	/*
+	 * Ticks from xTimeNow to the earliest expiry on the wheel, portMAX_DELAY
+	 * if it is empty.  Every timer due up to xTimeNow must have been processed.
+	 */
+	static TickType_t prvWheelTicksToExpiry( const TimerService_t * const pxService, const TickType_t xTimeNow ) PRIVILEGED_FUNCTION;
+
+	/*
+	 * If a timer has expired, process it.  Otherwise, block the timer service
+	 * task until the next one expires or a command is received.
+	 */
+	static void prvProcessWheelOrBlockTask( TimerService_t * const pxService ) PRIVILEGED_FUNCTION;
+
+#else
+
+	/*
+	 * The tick count has overflowed.  Switch the timer lists after ensuring the
+	 * current timer list does not still reference some timers.
+	 */
+	static void prvSwitchTimerLists( TimerService_t * const pxService ) PRIVILEGED_FUNCTION;
+
+#endif /* configUSE_TIMER_WHEEL */
 
 /*
  * Obtain the current tick count, setting *pxTimerListsWereSwitched to pdTRUE
  * if a tick count overflow occurred since prvSampleTimeNow() was last called.
  */
-static TickType_t prvSampleTimeNow( BaseType_t * const pxTimerListsWereSwitched ) PRIVILEGED_FUNCTION;
+static TickType_t prvSampleTimeNow( TimerService_t * const pxService, BaseType_t * const pxTimerListsWereSwitched ) PRIVILEGED_FUNCTION;
 
-/*
- * If the timer list contains any active timers then return the expire time of
- * the timer that will expire first and set *pxListWasEmpty to false.  If the
- * timer list does not contain any timers then return 0 and set *pxListWasEmpty
- * to pdTRUE.
- */
-static TickType_t prvGetNextExpireTime( BaseType_t * const pxListWasEmpty ) PRIVILEGED_FUNCTION;
+#if ( configUSE_TIMER_WHEEL == 0 )
+
+	/*
+	 * If the timer list contains any active timers then return the expire time of
+	 * the timer that will expire first and set *pxListWasEmpty to false.  If the
+	 * timer list does not contain any timers then return 0 and set *pxListWasEmpty
+	 * to pdTRUE.
+	 */
+	static TickType_t prvGetNextExpireTime( TimerService_t * const pxService, BaseType_t * const pxListWasEmpty ) PRIVILEGED_FUNCTION;
+
+	/*
+	 * If a timer has expired, process it.  Otherwise, block the timer service task
+	 * until either a timer does expire or a command is received.
+	 */
+	static void prvProcessTimerOrBlockTask( TimerService_t * const pxService, const TickType_t xNextExpireTime, const BaseType_t xListWasEmpty ) PRIVILEGED_FUNCTION;
+
+#endif /* configUSE_TIMER_WHEEL */
 
 /*
- * If a timer has expired, process it.  Otherwise, block the timer service task
- * until either a timer does expire or a command is received.
+ * Create a timer that belongs to pxService.
  */
-static void prvProcessTimerOrBlockTask( const TickType_t xNextExpireTime, const BaseType_t xListWasEmpty ) PRIVILEGED_FUNCTION;
+static TimerHandle_t prvTimerCreate( TimerService_t * const pxService, const char * const pcTimerName, const TickType_t xTimerPeriodInTicks, const UBaseType_t uxAutoReload, void * const pvTimerID, TimerCallbackFunction_t pxCallbackFunction ) PRIVILEGED_FUNCTION; /*lint !e971 Unqualified char types are allowed for strings and single characters only. */
+
+#if( INCLUDE_xTimerPendFunctionCall == 1 )
+
+	/*
+	 * Queue a function for pxService's task to call.
+	 */
+	static BaseType_t prvPendFunctionCall( TimerService_t * const pxService, PendedFunction_t xFunctionToPend, void *pvParameter1, uint32_t ulParameter2, TickType_t xTicksToWait ) PRIVILEGED_FUNCTION;
+
+#endif /* INCLUDE_xTimerPendFunctionCall */
 
 /*-----------------------------------------------------------*/
 
@@ -243,24 +335,28 @@ BaseType_t xReturn = pdFAIL;
 
 	/* This function is called when the scheduler is started if
 	configUSE_TIMERS is set to 1.  Check that the infrastructure used by the
-	timer service task has been created/initialised.  If timers have already
+	timer service tasks has been created/initialised.  If timers have already
 	been created then the initialisation will already have been performed. */
 	prvCheckForValidListAndQueue();
 
-	if( xTimerQueue != NULL )
+	if( xTimerServices[ tmrCONTROL_SERVICE ].xTimerQueue != NULL )
 	{
-		#if ( INCLUDE_xTimerGetTimerDaemonTaskHandle == 1 )
-		{
-			/* Create the timer task, storing its handle in xTimerTaskHandle so
-			it can be returned by the xTimerGetTimerDaemonTaskHandle() function. */
-			xReturn = xTaskCreate( prvTimerTask, "Tmr Svc", ( uint16_t ) configTIMER_TASK_STACK_DEPTH, NULL, ( ( UBaseType_t ) configTIMER_TASK_PRIORITY ) | portPRIVILEGE_BIT, &xTimerTaskHandle );
-		}
-		#else
+		/* Create the timer task, storing its handle so it can be returned by
+		the xTimerGetTimerDaemonTaskHandle() function. */
+		xReturn = xTaskCreate( prvTimerTask, "Tmr Svc", ( uint16_t ) configTIMER_TASK_STACK_DEPTH, &( xTimerServices[ tmrCONTROL_SERVICE ] ), ( ( UBaseType_t ) configTIMER_TASK_PRIORITY ) | portPRIVILEGE_BIT, &( xTimerServices[ tmrCONTROL_SERVICE ].xTimerTaskHandle ) );
+
+		#if ( configUSE_TIMER_BACKGROUND == 1 )
 		{
-			/* Create the timer task without storing its handle. */
-			xReturn = xTaskCreate( prvTimerTask, "Tmr Svc", ( uint16_t ) configTIMER_TASK_STACK_DEPTH, NULL, ( ( UBaseType_t ) configTIMER_TASK_PRIORITY ) | portPRIVILEGE_BIT, NULL);
+			if( ( xReturn == pdPASS ) && ( xTimerServices[ tmrBACKGROUND_SERVICE ].xTimerQueue != NULL ) )
+			{
+				xReturn = xTaskCreate( prvTimerTask, "Tmr Bg", ( uint16_t ) configTIMER_BACKGROUND_STACK_DEPTH, &( xTimerServices[ tmrBACKGROUND_SERVICE ] ), ( ( UBaseType_t ) configTIMER_BACKGROUND_PRIORITY ) | portPRIVILEGE_BIT, &( xTimerServices[ tmrBACKGROUND_SERVICE ].xTimerTaskHandle ) );
+			}
+			else
+			{
+				xReturn = pdFAIL;
+			}
 		}
-		#endif
+		#endif /* configUSE_TIMER_BACKGROUND */
 	}
 	else
 	{
@@ -273,6 +369,22 @@ BaseType_t xReturn = pdFAIL;
 /*-----------------------------------------------------------*/
 
 TimerHandle_t xTimerCreate( const char * const pcTimerName, const TickType_t xTimerPeriodInTicks, const UBaseType_t uxAutoReload, void * const pvTimerID, TimerCallbackFunction_t pxCallbackFunction ) /*lint !e971 Unqualified char types are allowed for strings and single characters only. */
+{
+	return prvTimerCreate( &( xTimerServices[ tmrCONTROL_SERVICE ] ), pcTimerName, xTimerPeriodInTicks, uxAutoReload, pvTimerID, pxCallbackFunction );
+}
+/*-----------------------------------------------------------*/
+
+#if ( configUSE_TIMER_BACKGROUND == 1 )
+
+	TimerHandle_t xTimerCreateBackground( const char * const pcTimerName, const TickType_t xTimerPeriodInTicks, const UBaseType_t uxAutoReload, void * const pvTimerID, TimerCallbackFunction_t pxCallbackFunction ) /*lint !e971 Unqualified char types are allowed for strings and single characters only. */
+	{
+		return prvTimerCreate( &( xTimerServices[ tmrBACKGROUND_SERVICE ] ), pcTimerName, xTimerPeriodInTicks, uxAutoReload, pvTimerID, pxCallbackFunction );
+	}
+
+#endif /* configUSE_TIMER_BACKGROUND */
+/*-----------------------------------------------------------*/
+
+static TimerHandle_t prvTimerCreate( TimerService_t * const pxService, const char * const pcTimerName, const TickType_t xTimerPeriodInTicks, const UBaseType_t uxAutoReload, void * const pvTimerID, TimerCallbackFunction_t pxCallbackFunction ) /*lint !e971 Unqualified char types are allowed for strings and single characters only. */
 {
 Timer_t *pxNewTimer;
 
@@ -296,6 +408,7 @@ Timer_t *pxNewTimer;
 			pxNewTimer->uxAutoReload = uxAutoReload;
 			pxNewTimer->pvTimerID = pvTimerID;
 			pxNewTimer->pxCallbackFunction = pxCallbackFunction;
+			pxNewTimer->pxService = pxService;
 			vListInitialiseItem( &( pxNewTimer->xTimerListItem ) );
 
 			traceTIMER_CREATE( pxNewTimer );
@@ -317,9 +430,11 @@ BaseType_t xTimerGenericCommand( TimerHandle_t xTimer, const BaseType_t xCommand
 {
 BaseType_t xReturn = pdFAIL;
 DaemonTaskMessage_t xMessage;
+QueueHandle_t xTimerQueue;
 
 	/* Send a message to the timer service task to perform a particular action
-	on a particular timer definition. */
+	on a particular timer definition.  The timer's own daemon does it. */
+	xTimerQueue = ( ( Timer_t * ) xTimer )->pxService->xTimerQueue;
 	if( xTimerQueue != NULL )
 	{
 		/* Send a command to the timer service task to start the xTimer timer. */
@@ -360,10 +475,40 @@ DaemonTaskMessage_t xMessage;
 	{
 		/* If xTimerGetTimerDaemonTaskHandle() is called before the scheduler has been
 		started, then xTimerTaskHandle will be NULL. */
-		configASSERT( ( xTimerTaskHandle != NULL ) );
-		return xTimerTaskHandle;
+		configASSERT( ( xTimerServices[ tmrCONTROL_SERVICE ].xTimerTaskHandle != NULL ) );
+		return xTimerServices[ tmrCONTROL_SERVICE ].xTimerTaskHandle;
 	}
 
+	#if ( configUSE_TIMER_BACKGROUND == 1 )
+
+		TaskHandle_t xTimerGetBackgroundDaemonTaskHandle( void )
+		{
+			configASSERT( ( xTimerServices[ tmrBACKGROUND_SERVICE ].xTimerTaskHandle != NULL ) );
+			return xTimerServices[ tmrBACKGROUND_SERVICE ].xTimerTaskHandle;
+		}
+
+	#endif /* configUSE_TIMER_BACKGROUND */
+
+#endif
+/*-----------------------------------------------------------*/
+
+#if ( configUSE_QUEUE_PEAK == 1 )
+
+	QueueHandle_t xTimerGetTimerQueue( void )
+	{
+		/* NULL until the first timer is created or the scheduler started. */
+		return xTimerServices[ tmrCONTROL_SERVICE ].xTimerQueue;
+	}
+
+	#if ( configUSE_TIMER_BACKGROUND == 1 )
+
+		QueueHandle_t xTimerGetBackgroundQueue( void )
+		{
+			return xTimerServices[ tmrBACKGROUND_SERVICE ].xTimerQueue;
+		}
+
+	#endif /* configUSE_TIMER_BACKGROUND */
+
 #endif
 /*-----------------------------------------------------------*/
 
@@ -375,14 +520,38 @@ Timer_t *pxTimer = ( Timer_t * ) xTimer;
 }
 /*-----------------------------------------------------------*/
 
-static void prvProcessExpiredTimer( const TickType_t xNextExpireTime, const TickType_t xTimeNow )
+static void prvRemoveTimerFromActiveList( Timer_t * const pxTimer )
+{
+	#if ( configUSE_TIMER_WHEEL == 1 )
+	{
+	TimerService_t * const pxService = pxTimer->pxService;
+	List_t * const pxSlot = ( List_t * ) listLIST_ITEM_CONTAINER( &( pxTimer->xTimerListItem ) );
+
+		/* The slot's bit goes with its last timer. */
+		if( uxListRemove( &( pxTimer->xTimerListItem ) ) == ( UBaseType_t ) 0 )
+		{
+			pxService->ulWheelOccupied &= ~( 1UL << ( pxSlot - pxService->xTimerWheel ) );
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+	#else
+	{
+		( void ) uxListRemove( &( pxTimer->xTimerListItem ) );
+	}
+	#endif /* configUSE_TIMER_WHEEL */
+}
+/*-----------------------------------------------------------*/
+
+static void prvProcessExpiredTimer( Timer_t * const pxTimer, const TickType_t xNextExpireTime, const TickType_t xTimeNow )
 {
 BaseType_t xResult;
-Timer_t * const pxTimer = ( Timer_t * ) listGET_OWNER_OF_HEAD_ENTRY( pxCurrentTimerList );
 
 	/* Remove the timer from the list of active timers.  A check has already
 	been performed to ensure the list is not empty. */
-	( void ) uxListRemove( &( pxTimer->xTimerListItem ) );
+	prvRemoveTimerFromActiveList( pxTimer );
 	traceTIMER_EXPIRED( pxTimer );
 
 	/* If the timer is an auto reload timer then calculate the next
@@ -417,58 +586,60 @@ Timer_t * const pxTimer = ( Timer_t * ) listGET_OWNER_OF_HEAD_ENTRY( pxCurrentTi
 
 static void prvTimerTask( void *pvParameters )
 {
+TimerService_t * const pxService = ( TimerService_t * ) pvParameters;
+#if ( configUSE_TIMER_WHEEL == 0 )
 TickType_t xNextExpireTime;
 BaseType_t xListWasEmpty;
-
-	/* Just to avoid compiler warnings. */
-	( void ) pvParameters;
+#endif
 
 	for( ;; )
 	{
-		/* Query the timers list to see if it contains any timers, and if so,
-		obtain the time at which the next timer will expire. */
-		xNextExpireTime = prvGetNextExpireTime( &xListWasEmpty );
+		#if ( configUSE_TIMER_WHEEL == 1 )
+		{
+			/* Process the next timer due if there is one.  Otherwise block
+			this task until one is due, or a command is received. */
+			prvProcessWheelOrBlockTask( pxService );
+		}
+		#else
+		{
+			/* Query the timers list to see if it contains any timers, and if so,
+			obtain the time at which the next timer will expire. */
+			xNextExpireTime = prvGetNextExpireTime( pxService, &xListWasEmpty );
 
-		/* If a timer has expired, process it.  Otherwise, block this task
-		until either a timer does expire, or a command is received. */
-		prvProcessTimerOrBlockTask( xNextExpireTime, xListWasEmpty );
+			/* If a timer has expired, process it.  Otherwise, block this task
+			until either a timer does expire, or a command is received. */
+			prvProcessTimerOrBlockTask( pxService, xNextExpireTime, xListWasEmpty );
+		}
+		#endif /* configUSE_TIMER_WHEEL */
 
 		/* Empty the command queue. */
-		prvProcessReceivedCommands();
+		prvProcessReceivedCommands( pxService );
 	}
 }
 /*-----------------------------------------------------------*/
 
-static void prvProcessTimerOrBlockTask( const TickType_t xNextExpireTime, const BaseType_t xListWasEmpty )
-{
-TickType_t xTimeNow;
-BaseType_t xTimerListsWereSwitched;
+#if ( configUSE_TIMER_WHEEL == 1 )
 
-	vTaskSuspendAll();
+	static void prvProcessWheelOrBlockTask( TimerService_t * const pxService )
 	{
-		/* Obtain the time now to make an assessment as to whether the timer
-		has expired or not.  If obtaining the time causes the lists to switch
-		then don't process this timer as any timers that remained in the list
-		when the lists were switched will have been processed within the
-		prvSampleTimeNow() function. */
-		xTimeNow = prvSampleTimeNow( &xTimerListsWereSwitched );
-		if( xTimerListsWereSwitched == pdFALSE )
+	TickType_t xTimeNow;
+	Timer_t *pxTimer;
+
+		vTaskSuspendAll();
 		{
-			/* The tick count has not overflowed, has the timer expired? */
-			if( ( xListWasEmpty == pdFALSE ) && ( xNextExpireTime <= xTimeNow ) )
+			xTimeNow = xTaskGetTickCount();
+			pxTimer = prvWheelNextDue( pxService, xTimeNow );
+			if( pxTimer != NULL )
 			{
 				( void ) xTaskResumeAll();
-				prvProcessExpiredTimer( xNextExpireTime, xTimeNow );
+				prvProcessExpiredTimer( pxTimer, pxService->xWheelTime, xTimeNow );
 			}
 			else
 			{
-				/* The tick count has not overflowed, and the next expire
-				time has not been reached yet.  This task should therefore
-				block to wait for the next expire time or a command to be
-				received - whichever comes first.  The following line cannot
-				be reached unless xNextExpireTime > xTimeNow, except in the
-				case when the current timer list is empty. */
-				vQueueWaitForMessageRestricted( xTimerQueue, ( xNextExpireTime - xTimeNow ) );
+				/* Nothing due up to now.  Block until the earliest expiry or
+				a command, whichever comes first; with no timer active that
+				is the longest wait there is. */
+				vQueueWaitForMessageRestricted( pxService->xTimerQueue, prvWheelTicksToExpiry( pxService, xTimeNow ) );
 
 				if( xTaskResumeAll() == pdFALSE )
 				{
@@ -484,58 +655,233 @@ BaseType_t xTimerListsWereSwitched;
 				}
 			}
 		}
-		else
+	}
+	/*-----------------------------------------------------------*/
+
+	static Timer_t *prvWheelNextDue( TimerService_t * const pxService, const TickType_t xTimeNow )
+	{
+	List_t *pxSlot;
+	ListItem_t *pxItem;
+	TickType_t xSkip;
+
+		for( ;; )
 		{
-			( void ) xTaskResumeAll();
+			/* A timer still here at its expiry time is due.  The others in
+			the slot come round again on a later turn. */
+			pxSlot = &( pxService->xTimerWheel[ pxService->xWheelTime & tmrWHEEL_MASK ] );
+			for( pxItem = listGET_HEAD_ENTRY( pxSlot ); pxItem != listGET_END_MARKER( pxSlot ); pxItem = listGET_NEXT( pxItem ) )
+			{
+				if( listGET_LIST_ITEM_VALUE( pxItem ) == pxService->xWheelTime )
+				{
+					return ( Timer_t * ) listGET_LIST_ITEM_OWNER( pxItem );
+				}
+			}
+
+			if( pxService->xWheelTime == xTimeNow )
+			{
+				return NULL;
+			}
+
+			/* On to the next occupied slot, as far as now.  The slot at now
+			is looked at again on the next call, in case a timer it expires
+			is restarted for exactly a turn later. */
+			if( pxService->ulWheelOccupied != 0UL )
+			{
+				xSkip = prvWheelTicksToNextSlot( pxService, ( UBaseType_t ) ( pxService->xWheelTime & tmrWHEEL_MASK ) );
+			}
+			else
+			{
+				xSkip = portMAX_DELAY;
+			}
+
+			if( xSkip > ( TickType_t ) ( xTimeNow - pxService->xWheelTime ) )
+			{
+				pxService->xWheelTime = xTimeNow;
+			}
+			else
+			{
+				pxService->xWheelTime += xSkip;
+			}
 		}
 	}
-}
-/*-----------------------------------------------------------*/
+	/*-----------------------------------------------------------*/
 
-static TickType_t prvGetNextExpireTime( BaseType_t * const pxListWasEmpty )
-{
-TickType_t xNextExpireTime;
+	static TickType_t prvWheelTicksToNextSlot( const TimerService_t * const pxService, const UBaseType_t uxSlot )
+	{
+	/* Index of an isolated bit from a de Bruijn multiply: the Nios II has no
+	count trailing zeros instruction (see portmacro.h). */
+	static const uint8_t ucDeBruijnBit[ 32 ] =
+	{
+		0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8,
+		31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9
+	};
+	const UBaseType_t uxNext = ( uxSlot + 1U ) & ( UBaseType_t ) tmrWHEEL_MASK;
+	uint32_t ulAhead;
+
+		/* The occupied slots rotated so that bit 0 is the one after uxSlot
+		and uxSlot itself is the top one. */
+		ulAhead = pxService->ulWheelOccupied >> uxNext;
+		if( uxNext != 0U )
+		{
+			ulAhead |= ( pxService->ulWheelOccupied << ( configTIMER_WHEEL_SLOTS - uxNext ) ) & tmrWHEEL_ALL_SLOTS;
+		}
 
-	/* Timers are listed in expiry time order, with the head of the list
-	referencing the task that will expire first.  Obtain the time at which
-	the timer with the nearest expiry time will expire.  If there are no
-	active timers then just set the next expire time to 0.  That will cause
-	this task to unblock when the tick count overflows, at which point the
-	timer lists will be switched and the next expiry time can be
-	re-assessed.  */
-	*pxListWasEmpty = listLIST_IS_EMPTY( pxCurrentTimerList );
-	if( *pxListWasEmpty == pdFALSE )
-	{
-		xNextExpireTime = listGET_ITEM_VALUE_OF_HEAD_ENTRY( pxCurrentTimerList );
+		ulAhead &= 0UL - ulAhead;
+		return ( TickType_t ) ucDeBruijnBit[ ( uint32_t ) ( ulAhead * 0x077CB531UL ) >> 27 ] + ( TickType_t ) 1U;
 	}
-	else
+	/*-----------------------------------------------------------*/
+
+	static TickType_t prvWheelTicksToExpiry( const TimerService_t * const pxService, const TickType_t xTimeNow )
 	{
-		/* Ensure the task unblocks when the tick count rolls over. */
-		xNextExpireTime = ( TickType_t ) 0U;
+	TickType_t xAhead, xEarliest = portMAX_DELAY, xTicks;
+	const List_t *pxSlot;
+	ListItem_t *pxItem;
+
+		if( pxService->ulWheelOccupied == 0UL )
+		{
+			return portMAX_DELAY;
+		}
+
+		/* Slot by occupied slot for one turn.  The first timer found due on
+		this turn is the earliest; otherwise the earliest of those due on
+		later turns.  Usually the first slot looked at ends it. */
+		xAhead = prvWheelTicksToNextSlot( pxService, ( UBaseType_t ) ( xTimeNow & tmrWHEEL_MASK ) );
+		while( xAhead <= ( TickType_t ) configTIMER_WHEEL_SLOTS )
+		{
+			pxSlot = &( pxService->xTimerWheel[ ( xTimeNow + xAhead ) & tmrWHEEL_MASK ] );
+			for( pxItem = listGET_HEAD_ENTRY( pxSlot ); pxItem != listGET_END_MARKER( pxSlot ); pxItem = listGET_NEXT( pxItem ) )
+			{
+				xTicks = listGET_LIST_ITEM_VALUE( pxItem ) - xTimeNow;
+				if( xTicks == xAhead )
+				{
+					return xTicks;
+				}
+				else if( xTicks < xEarliest )
+				{
+					xEarliest = xTicks;
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+			}
+			xAhead += prvWheelTicksToNextSlot( pxService, ( UBaseType_t ) ( ( xTimeNow + xAhead ) & tmrWHEEL_MASK ) );
+		}
+
+		return xEarliest;
 	}
+	/*-----------------------------------------------------------*/
 
-	return xNextExpireTime;
-}
+#else
+
+	static void prvProcessTimerOrBlockTask( TimerService_t * const pxService, const TickType_t xNextExpireTime, const BaseType_t xListWasEmpty )
+	{
+	TickType_t xTimeNow;
+	BaseType_t xTimerListsWereSwitched;
+
+		vTaskSuspendAll();
+		{
+			/* Obtain the time now to make an assessment as to whether the timer
+			has expired or not.  If obtaining the time causes the lists to switch
+			then don't process this timer as any timers that remained in the list
+			when the lists were switched will have been processed within the
+			prvSampleTimeNow() function. */
+			xTimeNow = prvSampleTimeNow( pxService, &xTimerListsWereSwitched );
+			if( xTimerListsWereSwitched == pdFALSE )
+			{
+				/* The tick count has not overflowed, has the timer expired? */
+				if( ( xListWasEmpty == pdFALSE ) && ( xNextExpireTime <= xTimeNow ) )
+				{
+					( void ) xTaskResumeAll();
+					prvProcessExpiredTimer( ( Timer_t * ) listGET_OWNER_OF_HEAD_ENTRY( pxService->pxCurrentTimerList ), xNextExpireTime, xTimeNow );
+				}
+				else
+				{
+					/* The tick count has not overflowed, and the next expire
+					time has not been reached yet.  This task should therefore
+					block to wait for the next expire time or a command to be
+					received - whichever comes first.  The following line cannot
+					be reached unless xNextExpireTime > xTimeNow, except in the
+					case when the current timer list is empty. */
+					vQueueWaitForMessageRestricted( pxService->xTimerQueue, ( xNextExpireTime - xTimeNow ) );
+
+					if( xTaskResumeAll() == pdFALSE )
+					{
+						/* Yield to wait for either a command to arrive, or the
+						block time to expire.  If a command arrived between the
+						critical section being exited and this yield then the yield
+						will not cause the task to block. */
+						portYIELD_WITHIN_API();
+					}
+					else
+					{
+						mtCOVERAGE_TEST_MARKER();
+					}
+				}
+			}
+			else
+			{
+				( void ) xTaskResumeAll();
+			}
+		}
+	}
+	/*-----------------------------------------------------------*/
+
+	static TickType_t prvGetNextExpireTime( TimerService_t * const pxService, BaseType_t * const pxListWasEmpty )
+	{
+	TickType_t xNextExpireTime;
+
+		/* Timers are listed in expiry time order, with the head of the list
+		referencing the task that will expire first.  Obtain the time at which
+		the timer with the nearest expiry time will expire.  If there are no
+		active timers then just set the next expire time to 0.  That will cause
+		this task to unblock when the tick count overflows, at which point the
+		timer lists will be switched and the next expiry time can be
+		re-assessed.  */
+		*pxListWasEmpty = listLIST_IS_EMPTY( pxService->pxCurrentTimerList );
+		if( *pxListWasEmpty == pdFALSE )
+		{
+			xNextExpireTime = listGET_ITEM_VALUE_OF_HEAD_ENTRY( pxService->pxCurrentTimerList );
+		}
+		else
+		{
+			/* Ensure the task unblocks when the tick count rolls over. */
+			xNextExpireTime = ( TickType_t ) 0U;
+		}
+
+		return xNextExpireTime;
+	}
+
+#endif /* configUSE_TIMER_WHEEL */
 /*-----------------------------------------------------------*/
 
-static TickType_t prvSampleTimeNow( BaseType_t * const pxTimerListsWereSwitched )
+static TickType_t prvSampleTimeNow( TimerService_t * const pxService, BaseType_t * const pxTimerListsWereSwitched )
 {
 TickType_t xTimeNow;
-PRIVILEGED_DATA static TickType_t xLastTime = ( TickType_t ) 0U; /*lint !e956 Variable is only accessible to one task. */
 
 	xTimeNow = xTaskGetTickCount();
 
-	if( xTimeNow < xLastTime )
-	{
-		prvSwitchTimerLists();
-		*pxTimerListsWereSwitched = pdTRUE;
-	}
-	else
+	#if ( configUSE_TIMER_WHEEL == 1 )
 	{
+		/* The wheel goes on round as the count overflows. */
+		( void ) pxService;
 		*pxTimerListsWereSwitched = pdFALSE;
 	}
+	#else
+	{
+		if( xTimeNow < pxService->xLastTime )
+		{
+			prvSwitchTimerLists( pxService );
+			*pxTimerListsWereSwitched = pdTRUE;
+		}
+		else
+		{
+			*pxTimerListsWereSwitched = pdFALSE;
+		}
 
-	xLastTime = xTimeNow;
+		pxService->xLastTime = xTimeNow;
+	}
+	#endif /* configUSE_TIMER_WHEEL */
 
 	return xTimeNow;
 }
@@ -548,48 +894,71 @@ BaseType_t xProcessTimerNow = pdFALSE;
 	listSET_LIST_ITEM_VALUE( &( pxTimer->xTimerListItem ), xNextExpiryTime );
 	listSET_LIST_ITEM_OWNER( &( pxTimer->xTimerListItem ), pxTimer );
 
-	if( xNextExpiryTime <= xTimeNow )
+	#if ( configUSE_TIMER_WHEEL == 1 )
 	{
-		/* Has the expiry time elapsed between the command to start/reset a
-		timer was issued, and the time the command was processed? */
-		if( ( xTimeNow - xCommandTime ) >= pxTimer->xTimerPeriodInTicks )
+	TimerService_t * const pxService = pxTimer->pxService;
+	UBaseType_t uxSlot;
+
+		/* Ticks are only ever compared by difference.  A period or more
+		since the command means the timer is already due, otherwise it
+		expires ahead of now, overflow or not. */
+		if( ( TickType_t ) ( xTimeNow - xCommandTime ) >= pxTimer->xTimerPeriodInTicks )
 		{
-			/* The time between a command being issued and the command being
-			processed actually exceeds the timers period.  */
 			xProcessTimerNow = pdTRUE;
 		}
 		else
 		{
-			vListInsert( pxOverflowTimerList, &( pxTimer->xTimerListItem ) );
+			uxSlot = ( UBaseType_t ) ( xNextExpiryTime & tmrWHEEL_MASK );
+			vListInsertEnd( &( pxService->xTimerWheel[ uxSlot ] ), &( pxTimer->xTimerListItem ) );
+			pxService->ulWheelOccupied |= 1UL << uxSlot;
 		}
 	}
-	else
+	#else
 	{
-		if( ( xTimeNow < xCommandTime ) && ( xNextExpiryTime >= xCommandTime ) )
+		if( xNextExpiryTime <= xTimeNow )
 		{
-			/* If, since the command was issued, the tick count has overflowed
-			but the expiry time has not, then the timer must have already passed
-			its expiry time and should be processed immediately. */
-			xProcessTimerNow = pdTRUE;
+			/* Has the expiry time elapsed between the command to start/reset a
+			timer was issued, and the time the command was processed? */
+			if( ( xTimeNow - xCommandTime ) >= pxTimer->xTimerPeriodInTicks )
+			{
+				/* The time between a command being issued and the command being
+				processed actually exceeds the timers period.  */
+				xProcessTimerNow = pdTRUE;
+			}
+			else
+			{
+				vListInsert( pxTimer->pxService->pxOverflowTimerList, &( pxTimer->xTimerListItem ) );
+			}
 		}
 		else
 		{
-			vListInsert( pxCurrentTimerList, &( pxTimer->xTimerListItem ) );
+			if( ( xTimeNow < xCommandTime ) && ( xNextExpiryTime >= xCommandTime ) )
+			{
+				/* If, since the command was issued, the tick count has overflowed
+				but the expiry time has not, then the timer must have already passed
+				its expiry time and should be processed immediately. */
+				xProcessTimerNow = pdTRUE;
+			}
+			else
+			{
+				vListInsert( pxTimer->pxService->pxCurrentTimerList, &( pxTimer->xTimerListItem ) );
+			}
 		}
 	}
+	#endif /* configUSE_TIMER_WHEEL */
 
 	return xProcessTimerNow;
 }
 /*-----------------------------------------------------------*/
 
-static void	prvProcessReceivedCommands( void )
+static void	prvProcessReceivedCommands( TimerService_t * const pxService )
 {
 DaemonTaskMessage_t xMessage;
 Timer_t *pxTimer;
 BaseType_t xTimerListsWereSwitched, xResult;
 TickType_t xTimeNow;
 
-	while( xQueueReceive( xTimerQueue, &xMessage, tmrNO_DELAY ) != pdFAIL ) /*lint !e603 xMessage does not have to be initialised as it is passed out, not in, and it is not used unless xQueueReceive() returns pdTRUE. */
+	while( xQueueReceive( pxService->xTimerQueue, &xMessage, tmrNO_DELAY ) != pdFAIL ) /*lint !e603 xMessage does not have to be initialised as it is passed out, not in, and it is not used unless xQueueReceive() returns pdTRUE. */
 	{
 		#if ( INCLUDE_xTimerPendFunctionCall == 1 )
 		{
@@ -624,7 +993,7 @@ TickType_t xTimeNow;
 			if( listIS_CONTAINED_WITHIN( NULL, &( pxTimer->xTimerListItem ) ) == pdFALSE )
 			{
 				/* The timer is in a list, remove it. */
-				( void ) uxListRemove( &( pxTimer->xTimerListItem ) );
+				prvRemoveTimerFromActiveList( pxTimer );
 			}
 			else
 			{
@@ -639,7 +1008,7 @@ TickType_t xTimeNow;
 			possibility of a higher priority task adding a message to the message
 			queue with a time that is ahead of the timer daemon task (because it
 			pre-empted the timer daemon task after the xTimeNow value was set). */
-			xTimeNow = prvSampleTimeNow( &xTimerListsWereSwitched );
+			xTimeNow = prvSampleTimeNow( pxService, &xTimerListsWereSwitched );
 
 			switch( xMessage.xMessageID )
 			{
@@ -708,93 +1077,125 @@ TickType_t xTimeNow;
 }
 /*-----------------------------------------------------------*/
 
-static void prvSwitchTimerLists( void )
-{
-TickType_t xNextExpireTime, xReloadTime;
-List_t *pxTemp;
-Timer_t *pxTimer;
-BaseType_t xResult;
+#if ( configUSE_TIMER_WHEEL == 0 )
 
-	/* The tick count has overflowed.  The timer lists must be switched.
-	If there are any timers still referenced from the current timer list
-	then they must have expired and should be processed before the lists
-	are switched. */
-	while( listLIST_IS_EMPTY( pxCurrentTimerList ) == pdFALSE )
+	static void prvSwitchTimerLists( TimerService_t * const pxService )
 	{
-		xNextExpireTime = listGET_ITEM_VALUE_OF_HEAD_ENTRY( pxCurrentTimerList );
+	TickType_t xNextExpireTime, xReloadTime;
+	List_t *pxTemp;
+	Timer_t *pxTimer;
+	BaseType_t xResult;
+
+		/* The tick count has overflowed.  The timer lists must be switched.
+		If there are any timers still referenced from the current timer list
+		then they must have expired and should be processed before the lists
+		are switched. */
+		while( listLIST_IS_EMPTY( pxService->pxCurrentTimerList ) == pdFALSE )
+		{
+			xNextExpireTime = listGET_ITEM_VALUE_OF_HEAD_ENTRY( pxService->pxCurrentTimerList );
 
-		/* Remove the timer from the list. */
-		pxTimer = ( Timer_t * ) listGET_OWNER_OF_HEAD_ENTRY( pxCurrentTimerList );
-		( void ) uxListRemove( &( pxTimer->xTimerListItem ) );
-		traceTIMER_EXPIRED( pxTimer );
-
-		/* Execute its callback, then send a command to restart the timer if
-		it is an auto-reload timer.  It cannot be restarted here as the lists
-		have not yet been switched. */
-		pxTimer->pxCallbackFunction( ( TimerHandle_t ) pxTimer );
-
-		if( pxTimer->uxAutoReload == ( UBaseType_t ) pdTRUE )
-		{
-			/* Calculate the reload value, and if the reload value results in
-			the timer going into the same timer list then it has already expired
-			and the timer should be re-inserted into the current list so it is
-			processed again within this loop.  Otherwise a command should be sent
-			to restart the timer to ensure it is only inserted into a list after
-			the lists have been swapped. */
-			xReloadTime = ( xNextExpireTime + pxTimer->xTimerPeriodInTicks );
-			if( xReloadTime > xNextExpireTime )
+			/* Remove the timer from the list. */
+			pxTimer = ( Timer_t * ) listGET_OWNER_OF_HEAD_ENTRY( pxService->pxCurrentTimerList );
+			( void ) uxListRemove( &( pxTimer->xTimerListItem ) );
+			traceTIMER_EXPIRED( pxTimer );
+
+			/* Execute its callback, then send a command to restart the timer if
+			it is an auto-reload timer.  It cannot be restarted here as the lists
+			have not yet been switched. */
+			pxTimer->pxCallbackFunction( ( TimerHandle_t ) pxTimer );
+
+			if( pxTimer->uxAutoReload == ( UBaseType_t ) pdTRUE )
 			{
-				listSET_LIST_ITEM_VALUE( &( pxTimer->xTimerListItem ), xReloadTime );
-				listSET_LIST_ITEM_OWNER( &( pxTimer->xTimerListItem ), pxTimer );
-				vListInsert( pxCurrentTimerList, &( pxTimer->xTimerListItem ) );
+				/* Calculate the reload value, and if the reload value results in
+				the timer going into the same timer list then it has already expired
+				and the timer should be re-inserted into the current list so it is
+				processed again within this loop.  Otherwise a command should be sent
+				to restart the timer to ensure it is only inserted into a list after
+				the lists have been swapped. */
+				xReloadTime = ( xNextExpireTime + pxTimer->xTimerPeriodInTicks );
+				if( xReloadTime > xNextExpireTime )
+				{
+					listSET_LIST_ITEM_VALUE( &( pxTimer->xTimerListItem ), xReloadTime );
+					listSET_LIST_ITEM_OWNER( &( pxTimer->xTimerListItem ), pxTimer );
+					vListInsert( pxService->pxCurrentTimerList, &( pxTimer->xTimerListItem ) );
+				}
+				else
+				{
+					xResult = xTimerGenericCommand( pxTimer, tmrCOMMAND_START_DONT_TRACE, xNextExpireTime, NULL, tmrNO_DELAY );
+					configASSERT( xResult );
+					( void ) xResult;
+				}
 			}
 			else
 			{
-				xResult = xTimerGenericCommand( pxTimer, tmrCOMMAND_START_DONT_TRACE, xNextExpireTime, NULL, tmrNO_DELAY );
-				configASSERT( xResult );
-				( void ) xResult;
+				mtCOVERAGE_TEST_MARKER();
 			}
 		}
-		else
-		{
-			mtCOVERAGE_TEST_MARKER();
-		}
+
+		pxTemp = pxService->pxCurrentTimerList;
+		pxService->pxCurrentTimerList = pxService->pxOverflowTimerList;
+		pxService->pxOverflowTimerList = pxTemp;
 	}
 
-	pxTemp = pxCurrentTimerList;
-	pxCurrentTimerList = pxOverflowTimerList;
-	pxOverflowTimerList = pxTemp;
-}
+#endif /* configUSE_TIMER_WHEEL */
 /*-----------------------------------------------------------*/
 
 static void prvCheckForValidListAndQueue( void )
 {
-	/* Check that the list from which active timers are referenced, and the
-	queue used to communicate with the timer service, have been
+#if ( configQUEUE_REGISTRY_SIZE > 0 )
+static const char * const pcQueueNames[ tmrSERVICES ] = { "TmrQ"
+	#if ( configUSE_TIMER_BACKGROUND == 1 )
+		, "TmrBgQ"
+	#endif
+	};
+#endif
+TimerService_t *pxService;
+UBaseType_t uxService;
+
+	/* Check that the lists from which active timers are referenced, and the
+	queues used to communicate with the timer services, have been
 	initialised. */
 	taskENTER_CRITICAL();
 	{
-		if( xTimerQueue == NULL )
+		if( xTimerServices[ tmrCONTROL_SERVICE ].xTimerQueue == NULL )
 		{
-			vListInitialise( &xActiveTimerList1 );
-			vListInitialise( &xActiveTimerList2 );
-			pxCurrentTimerList = &xActiveTimerList1;
-			pxOverflowTimerList = &xActiveTimerList2;
-			xTimerQueue = xQueueCreate( ( UBaseType_t ) configTIMER_QUEUE_LENGTH, sizeof( DaemonTaskMessage_t ) );
-			configASSERT( xTimerQueue );
-
-			#if ( configQUEUE_REGISTRY_SIZE > 0 )
+			for( uxService = ( UBaseType_t ) 0U; uxService < ( UBaseType_t ) tmrSERVICES; uxService++ )
 			{
-				if( xTimerQueue != NULL )
+				pxService = &( xTimerServices[ uxService ] );
+
+				#if ( configUSE_TIMER_WHEEL == 1 )
 				{
-					vQueueAddToRegistry( xTimerQueue, "TmrQ" );
+				UBaseType_t uxSlot;
+
+					for( uxSlot = ( UBaseType_t ) 0U; uxSlot < ( UBaseType_t ) configTIMER_WHEEL_SLOTS; uxSlot++ )
+					{
+						vListInitialise( &( pxService->xTimerWheel[ uxSlot ] ) );
+					}
 				}
-				else
+				#else
 				{
-					mtCOVERAGE_TEST_MARKER();
+					vListInitialise( &( pxService->xActiveTimerList1 ) );
+					vListInitialise( &( pxService->xActiveTimerList2 ) );
+					pxService->pxCurrentTimerList = &( pxService->xActiveTimerList1 );
+					pxService->pxOverflowTimerList = &( pxService->xActiveTimerList2 );
+				}
+				#endif /* configUSE_TIMER_WHEEL */
+				pxService->xTimerQueue = xQueueCreate( ( UBaseType_t ) configTIMER_QUEUE_LENGTH, sizeof( DaemonTaskMessage_t ) );
+				configASSERT( pxService->xTimerQueue );
+
+				#if ( configQUEUE_REGISTRY_SIZE > 0 )
+				{
+					if( pxService->xTimerQueue != NULL )
+					{
+						vQueueAddToRegistry( pxService->xTimerQueue, pcQueueNames[ uxService ] );
+					}
+					else
+					{
+						mtCOVERAGE_TEST_MARKER();
+					}
 				}
+				#endif /* configQUEUE_REGISTRY_SIZE */
 			}
-			#endif /* configQUEUE_REGISTRY_SIZE */
 		}
 		else
 		{
@@ -840,13 +1241,14 @@ Timer_t * const pxTimer = ( Timer_t * ) xTimer;
 	BaseType_t xReturn;
 
 		/* Complete the message with the function parameters and post it to the
-		daemon task. */
+		daemon task.  Interrupt work always goes to the daemon at
+		configTIMER_TASK_PRIORITY. */
 		xMessage.xMessageID = tmrCOMMAND_EXECUTE_CALLBACK_FROM_ISR;
 		xMessage.u.xCallbackParameters.pxCallbackFunction = xFunctionToPend;
 		xMessage.u.xCallbackParameters.pvParameter1 = pvParameter1;
 		xMessage.u.xCallbackParameters.ulParameter2 = ulParameter2;
 
-		xReturn = xQueueSendFromISR( xTimerQueue, &xMessage, pxHigherPriorityTaskWoken );
+		xReturn = xQueueSendFromISR( xTimerServices[ tmrCONTROL_SERVICE ].xTimerQueue, &xMessage, pxHigherPriorityTaskWoken );
 
 		tracePEND_FUNC_CALL_FROM_ISR( xFunctionToPend, pvParameter1, ulParameter2, xReturn );
 
@@ -858,7 +1260,7 @@ Timer_t * const pxTimer = ( Timer_t * ) xTimer;
 
 #if( INCLUDE_xTimerPendFunctionCall == 1 )
 
-	BaseType_t xTimerPendFunctionCall( PendedFunction_t xFunctionToPend, void *pvParameter1, uint32_t ulParameter2, TickType_t xTicksToWait )
+	static BaseType_t prvPendFunctionCall( TimerService_t * const pxService, PendedFunction_t xFunctionToPend, void *pvParameter1, uint32_t ulParameter2, TickType_t xTicksToWait )
 	{
 	DaemonTaskMessage_t xMessage;
 	BaseType_t xReturn;
@@ -866,7 +1268,7 @@ Timer_t * const pxTimer = ( Timer_t * ) xTimer;
 		/* This function can only be called after a timer has been created or
 		after the scheduler has been started because, until then, the timer
 		queue does not exist. */
-		configASSERT( xTimerQueue );
+		configASSERT( pxService->xTimerQueue );
 
 		/* Complete the message with the function parameters and post it to the
 		daemon task. */
@@ -875,12 +1277,28 @@ Timer_t * const pxTimer = ( Timer_t * ) xTimer;
 		xMessage.u.xCallbackParameters.pvParameter1 = pvParameter1;
 		xMessage.u.xCallbackParameters.ulParameter2 = ulParameter2;
 
-		xReturn = xQueueSendToBack( xTimerQueue, &xMessage, xTicksToWait );
+		xReturn = xQueueSendToBack( pxService->xTimerQueue, &xMessage, xTicksToWait );
 
 		tracePEND_FUNC_CALL( xFunctionToPend, pvParameter1, ulParameter2, xReturn );
 
 		return xReturn;
 	}
+	/*-----------------------------------------------------------*/
+
+	BaseType_t xTimerPendFunctionCall( PendedFunction_t xFunctionToPend, void *pvParameter1, uint32_t ulParameter2, TickType_t xTicksToWait )
+	{
+		return prvPendFunctionCall( &( xTimerServices[ tmrCONTROL_SERVICE ] ), xFunctionToPend, pvParameter1, ulParameter2, xTicksToWait );
+	}
+	/*-----------------------------------------------------------*/
+
+	#if ( configUSE_TIMER_BACKGROUND == 1 )
+
+		BaseType_t xTimerPendFunctionCallBackground( PendedFunction_t xFunctionToPend, void *pvParameter1, uint32_t ulParameter2, TickType_t xTicksToWait )
+		{
+			return prvPendFunctionCall( &( xTimerServices[ tmrBACKGROUND_SERVICE ] ), xFunctionToPend, pvParameter1, ulParameter2, xTicksToWait );
+		}
+
+	#endif /* configUSE_TIMER_BACKGROUND */
 
 #endif /* INCLUDE_xTimerPendFunctionCall */
 /*-----------------------------------------------------------*/
@@ -80,6 +80,9 @@ happens to also be including task.h. */
 #include "task.h"
 /*lint +e537 */
 
+/* QueueHandle_t, for xTimerGetTimerQueue(). */
+#include "queue.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -259,6 +262,28 @@ typedef void (*PendedFunction_t)( void *, uint32_t );
  */
 TimerHandle_t xTimerCreate( const char * const pcTimerName, const TickType_t xTimerPeriodInTicks, const UBaseType_t uxAutoReload, void * const pvTimerID, TimerCallbackFunction_t pxCallbackFunction ) PRIVILEGED_FUNCTION; /*lint !e971 Unqualified char types are allowed for strings and single characters only. */
 
+/**
+ * TimerHandle_t xTimerCreateBackground( const char * const pcTimerName,
+ * 										 TickType_t xTimerPeriodInTicks,
+ * 										 UBaseType_t uxAutoReload,
+ * 										 void * pvTimerID,
+ * 										 TimerCallbackFunction_t pxCallbackFunction );
+ *
+ * As xTimerCreate(), but the timer belongs to the background daemon: every
+ * command sent to it goes to that daemon's queue and its callback runs there,
+ * at configTIMER_BACKGROUND_PRIORITY.  For housekeeping that may take a while,
+ * so that it never delays the timers of the daemon at
+ * configTIMER_TASK_PRIORITY.  A timer stays with the daemon it was created
+ * for.
+ *
+ * With configUSE_TIMER_BACKGROUND set to 0 this is xTimerCreate().
+ */
+#if ( configUSE_TIMER_BACKGROUND == 1 )
+	TimerHandle_t xTimerCreateBackground( const char * const pcTimerName, const TickType_t xTimerPeriodInTicks, const UBaseType_t uxAutoReload, void * const pvTimerID, TimerCallbackFunction_t pxCallbackFunction ) PRIVILEGED_FUNCTION; /*lint !e971 Unqualified char types are allowed for strings and single characters only. */
+#else
+	#define xTimerCreateBackground xTimerCreate
+#endif
+
 /**
  * void *pvTimerGetTimerID( TimerHandle_t xTimer );
  *
@@ -329,6 +354,26 @@ BaseType_t xTimerIsTimerActive( TimerHandle_t xTimer ) PRIVILEGED_FUNCTION;
  */
 TaskHandle_t xTimerGetTimerDaemonTaskHandle( void );
 
+/**
+ * QueueHandle_t xTimerGetTimerQueue( void );
+ *
+ * xTimerGetTimerQueue() is only available if configUSE_QUEUE_PEAK is set to 1
+ * in FreeRTOSConfig.h.
+ *
+ * Returns the timer command queue, or NULL before it has been created, so its
+ * depth can be watched with uxQueueMessagesPeak().
+ */
+QueueHandle_t xTimerGetTimerQueue( void );
+
+/**
+ * TaskHandle_t xTimerGetBackgroundDaemonTaskHandle( void );
+ * QueueHandle_t xTimerGetBackgroundQueue( void );
+ *
+ * The same for the background daemon, when configUSE_TIMER_BACKGROUND is 1.
+ */
+TaskHandle_t xTimerGetBackgroundDaemonTaskHandle( void );
+QueueHandle_t xTimerGetBackgroundQueue( void );
+
 /**
  * BaseType_t xTimerStart( TimerHandle_t xTimer, TickType_t xTicksToWait );
  *
@@ -1098,6 +1143,22 @@ BaseType_t xTimerPendFunctionCallFromISR( PendedFunction_t xFunctionToPend, void
   */
 BaseType_t xTimerPendFunctionCall( PendedFunction_t xFunctionToPend, void *pvParameter1, uint32_t ulParameter2, TickType_t xTicksToWait );
 
+/**
+ * BaseType_t xTimerPendFunctionCallBackground( PendedFunction_t xFunctionToPend,
+ *                                              void *pvParameter1,
+ *                                              uint32_t ulParameter2,
+ *                                              TickType_t xTicksToWait );
+ *
+ * As xTimerPendFunctionCall(), but the function runs in the background daemon
+ * (see xTimerCreateBackground()).  With configUSE_TIMER_BACKGROUND set to 0
+ * this is xTimerPendFunctionCall().
+ */
+#if ( configUSE_TIMER_BACKGROUND == 1 )
+	BaseType_t xTimerPendFunctionCallBackground( PendedFunction_t xFunctionToPend, void *pvParameter1, uint32_t ulParameter2, TickType_t xTicksToWait );
+#else
+	#define xTimerPendFunctionCallBackground xTimerPendFunctionCall
+#endif
+
 /**
  * const char * const pcTimerGetTimerName( TimerHandle_t xTimer );
  *
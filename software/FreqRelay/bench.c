@@ -0,0 +1,102 @@
+/**
+ * On-target benchmark harness
+ *
+ * See bench.h.
+ */
+
+/* Standard includes */
+#include <stdio.h>
+
+/* Scheduler includes */
+#include "freertos/FreeRTOS.h"
+
+/* Application includes */
+#include "bench.h"
+#include "latency.h"
+#include "telemetry.h"
+
+#define BENCH_CALIBRATE                1000   // Timer read pairs for the overhead
+
+static uint32_t ulOverhead = 0;
+
+/* Only between vBenchBegin and vBenchEnd, which hold the UART */
+static void vBenchPrint(const char *pcLine) {
+    fputs(pcLine, stdout);
+    fflush(stdout);
+}
+
+void vBenchBegin(void) {
+    char line[64];
+    uint32_t i, start, end, best = 0xFFFFFFFFUL;
+
+    /* The telemetry drain shares the UART */
+    xTelemetryUartTake(portMAX_DELAY);
+
+    for (i = 0; i < BENCH_CALIBRATE; i++) {
+        start = ulLatencyNow();
+        end = ulLatencyNow();
+        if (end - start < best) {
+            best = end - start;
+        }
+    }
+    ulOverhead = best;
+
+    snprintf(line, sizeof(line), "#BENCH,%d,%lu,%lu\n", BENCH_VERSION,
+             (unsigned long)ulLatencyCountsPerUs(), (unsigned long)ulOverhead);
+    vBenchPrint(line);
+}
+
+void vBenchEnd(void) {
+    vBenchPrint("#BENCH,end\n");
+    vTelemetryUartGive();
+}
+
+void vBenchStatsInit(BenchStats_t *pxStats) {
+    pxStats->iterations = 0;
+    pxStats->min = 0xFFFFFFFFUL;
+    pxStats->max = 0;
+    pxStats->total = 0;
+}
+
+void vBenchStatsRecord(BenchStats_t *pxStats, uint32_t counts) {
+    if (counts < pxStats->min) {
+        pxStats->min = counts;
+    }
+    if (counts > pxStats->max) {
+        pxStats->max = counts;
+    }
+    pxStats->total += counts;
+    pxStats->iterations++;
+}
+
+void vBenchStatsAdd(BenchStats_t *pxStats, uint32_t start, uint32_t end) {
+    uint32_t elapsed = end - start;
+
+    vBenchStatsRecord(pxStats, (elapsed > ulOverhead) ? elapsed - ulOverhead : 0);
+}
+
+void vBenchReport(const char *pcName, const BenchStats_t *pxStats) {
+    char line[96];
+
+    if (pxStats->iterations == 0) {
+        snprintf(line, sizeof(line), "BENCH,%s,0,,,\n", pcName);
+    } else {
+        snprintf(line, sizeof(line), "BENCH,%s,%lu,%lu,%lu,%lu\n", pcName, (unsigned long)pxStats->iterations,
+                 (unsigned long)pxStats->min, (unsigned long)(pxStats->total / pxStats->iterations),
+                 (unsigned long)pxStats->max);
+    }
+    vBenchPrint(line);
+}
+
+void vBenchRun(const char *pcName, BenchFunction_t pxFunction, void *pvContext, uint32_t iterations) {
+    BenchStats_t stats;
+    uint32_t start;
+
+    vBenchStatsInit(&stats);
+    while (iterations--) {
+        start = ulLatencyNow();
+        pxFunction(pvContext);
+        vBenchStatsAdd(&stats, start, ulLatencyNow());
+    }
+    vBenchReport(pcName, &stats);
+}
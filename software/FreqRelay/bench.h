@@ -0,0 +1,52 @@
+/**
+ * On-target benchmark harness
+ *
+ * Times a function over many calls with the timestamp timer and reports one
+ * CSV line per benchmark on the JTAG UART:
+ *
+ *   #BENCH,<version>,<counts per us>,<timer read overhead>
+ *   BENCH,<name>,<iterations>,<min>,<mean>,<max>
+ *   #BENCH,end
+ *
+ * Times are timestamp counts (CPU clock cycles on this board) with the cost
+ * of reading the timer taken off. Interrupts stay enabled, so min is the
+ * cost of the code itself and max includes whatever preempted it.
+ * tools/bench_compare.py compares a run with a saved baseline.
+ *
+ * The benchmarks themselves are in hello_freqRelay.c (FREQ_RELAY_BENCH,
+ * built by "make bench").
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+
+#define BENCH_VERSION                  1
+
+typedef struct {
+    uint32_t iterations;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+} BenchStats_t;
+
+typedef void (*BenchFunction_t)(void *pvContext);
+
+/* Take the JTAG UART, measure the timer read overhead and print the
+ * header. The UART stays held until vBenchEnd, so call this before
+ * stopping any task that might be holding it. */
+void vBenchBegin(void);
+void vBenchEnd(void);
+
+/* For benchmarks that time part of each iteration themselves. Add takes
+ * the timer read overhead off, Record stores a count as it is. */
+void vBenchStatsInit(BenchStats_t *pxStats);
+void vBenchStatsAdd(BenchStats_t *pxStats, uint32_t start, uint32_t end);
+void vBenchStatsRecord(BenchStats_t *pxStats, uint32_t counts);
+void vBenchReport(const char *pcName, const BenchStats_t *pxStats);
+
+/* Time iterations calls of pxFunction and report them */
+void vBenchRun(const char *pcName, BenchFunction_t pxFunction, void *pvContext, uint32_t iterations);
+
+#endif /* BENCH_H */
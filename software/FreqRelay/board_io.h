@@ -0,0 +1,125 @@
+/**
+ * Board I/O used by the relay logic
+ *
+ * The board signals the application reads and drives - the load outputs,
+ * the slide switches, the push buttons, the frequency analysers, the status
+ * LEDs and the actuator feedback - as static inline functions over the
+ * Altera register macros, so each call compiles to the same load or store
+ * the macro did and nothing is bound at run time.
+ *
+ * The host build (sim/Makefile) defines BOARD_IO_HOST and gets the same
+ * functions from its board_io_host.h, over variables the simulation drives,
+ * so a module that touches the board only through here builds unchanged on
+ * the host.
+ */
+
+#ifndef BOARD_IO_H
+#define BOARD_IO_H
+
+#ifdef BOARD_IO_HOST
+#include "board_io_host.h"
+#else
+
+#include <stdint.h>
+#include "system.h"
+#include "io.h"
+#include "altera_avalon_pio_regs.h"
+#include "freq_analyser.h"
+#include "load_mask.h"
+
+#if LOAD_PORTS > 1 && !defined(LOAD_PORT_1_BASE)
+#error "LOAD_PORTS > 1 needs the load output PIOs, LOAD_PORT_1_BASE in system.h"
+#endif
+#if LOAD_PORTS > 2 && !defined(LOAD_PORT_2_BASE)
+#error "LOAD_PORTS > 2 needs LOAD_PORT_2_BASE in system.h"
+#endif
+#if LOAD_PORTS > 3 && !defined(LOAD_PORT_3_BASE)
+#error "LOAD_PORTS > 3 needs LOAD_PORT_3_BASE in system.h"
+#endif
+
+/* One output port's loads, lit is connected: port 0 is the green LEDs, one
+ * per load. The port is a constant wherever the output stage's loop over
+ * the ports is unrolled, and the choice folds away. */
+static inline void vBoardLoadPortOut(uint32_t port, uint16_t bits) {
+#if LOAD_PORTS > 1
+    if (port == 1) {
+        IOWR_ALTERA_AVALON_PIO_DATA(LOAD_PORT_1_BASE, bits);
+        return;
+    }
+#endif
+#if LOAD_PORTS > 2
+    if (port == 2) {
+        IOWR_ALTERA_AVALON_PIO_DATA(LOAD_PORT_2_BASE, bits);
+        return;
+    }
+#endif
+#if LOAD_PORTS > 3
+    if (port == 3) {
+        IOWR_ALTERA_AVALON_PIO_DATA(LOAD_PORT_3_BASE, bits);
+        return;
+    }
+#endif
+    (void)port;
+    IOWR_ALTERA_AVALON_PIO_DATA(GREEN_LEDS_BASE, bits);
+}
+
+/* What the actuators report back, the outputs themselves on a board
+ * without the feedback inputs. Only port 0 has them; the other ports
+ * read back as driven. */
+static inline LoadMask_t xBoardLoadFeedback(LoadMask_t driven) {
+#ifdef ACTUATOR_FEEDBACK_BASE
+    return (driven & (LoadMask_t)~(LoadMask_t)LOAD_PORT_MASK) |
+           (uint16_t)IORD_ALTERA_AVALON_PIO_DATA(ACTUATOR_FEEDBACK_BASE);
+#else
+    return driven;
+#endif
+}
+
+static inline uint32_t ulBoardSwitches(void) {
+    return IORD_ALTERA_AVALON_PIO_DATA(SLIDE_SWITCH_BASE);
+}
+
+/* Red LEDs */
+static inline void vBoardStatusLeds(uint32_t pattern) {
+    IOWR_ALTERA_AVALON_PIO_DATA(RED_LEDS_BASE, pattern);
+}
+
+/* Interrupt on the edges of the buttons in mask, none captured yet */
+static inline void vBoardButtonsInit(uint32_t mask) {
+    IOWR_ALTERA_AVALON_PIO_IRQ_MASK(PUSH_BUTTON_BASE, mask);
+    IOWR_ALTERA_AVALON_PIO_EDGE_CAP(PUSH_BUTTON_BASE, mask);
+}
+
+/* Captured edges of the buttons in mask, acknowledging only those read */
+static inline uint32_t ulBoardButtonEdges(uint32_t mask) {
+    uint32_t edges = IORD_ALTERA_AVALON_PIO_EDGE_CAP(PUSH_BUTTON_BASE) & mask;
+
+    IOWR_ALTERA_AVALON_PIO_EDGE_CAP(PUSH_BUTTON_BASE, edges);
+    return edges;
+}
+
+/* The analyser at base: its oldest period count, popped by the read */
+static inline uint32_t ulBoardFreqPeriod(uint32_t base) {
+    return IORD_FREQ_ANALYSER_DATA(base);
+}
+
+/* FIFO analysers only: counts held, and the level that interrupts */
+static inline uint32_t ulBoardFreqLevel(uint32_t base) {
+    return IORD_FREQ_ANALYSER_LEVEL(base);
+}
+
+static inline void vBoardFreqThreshold(uint32_t base, uint32_t level) {
+    IOWR_FREQ_ANALYSER_THRESHOLD(base, level);
+}
+
+/* FIFO analysers only: non-zero once if a count was lost to a full FIFO */
+static inline int xBoardFreqOverflow(uint32_t base) {
+    if (IORD_FREQ_ANALYSER_STATUS(base) & FREQ_ANALYSER_STATUS_OVERFLOW) {
+        IOWR_FREQ_ANALYSER_STATUS(base, FREQ_ANALYSER_STATUS_OVERFLOW);
+        return 1;
+    }
+    return 0;
+}
+
+#endif /* BOARD_IO_HOST */
+#endif /* BOARD_IO_H */
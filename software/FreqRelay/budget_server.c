@@ -0,0 +1,230 @@
+/**
+ * CPU budget server for the non-critical tasks
+ *
+ * See budget_server.h.
+ */
+
+/* Scheduler includes */
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/* Hardware includes */
+#include "sys/alt_irq.h"
+
+/* Application includes */
+#include "budget_server.h"
+#include "fast_mem.h"
+#include "irq_defer.h"
+#include "latency.h"
+
+typedef struct {
+    uint32_t at;                       // Server tick it comes due
+    uint32_t counts;
+} BudgetRefill_t;
+
+/* Touched on every context switch and tick, with interrupts disabled. Times
+ * are in run time counter counts, ticks counted from xBudgetServerInit. */
+static FAST_DATA volatile int xStarted = 0;
+static FAST_DATA volatile int xThrottled = 0;
+static FAST_DATA int32_t lRemaining = 0;
+static FAST_DATA uint32_t ulTick = 0;
+static FAST_DATA UBaseType_t uxCurrent = 0;  // Tag of the running task
+static FAST_DATA uint32_t ulLast = 0;        // Counter when it was last charged
+static FAST_DATA int xConsumed = 0;          // Member time since the last tick
+static FAST_DATA int xChunkOpen = 0;
+static FAST_DATA uint32_t ulChunkAt = 0;
+static FAST_DATA uint32_t ulChunkUsed = 0;
+static FAST_DATA BudgetRefill_t xRefill[BUDGET_REPLENISH_MAX];
+static FAST_DATA UBaseType_t uxRefillHead = 0;
+static FAST_DATA UBaseType_t uxRefills = 0;
+static FAST_DATA uint64_t ullUsed = 0;
+
+static uint32_t ulBudgetCounts = 0;
+static uint32_t ulPeriodTicks = 0;
+static uint32_t ulBudgetUs = 0;
+static uint32_t ulPeriodMs = 0;
+static volatile int xApplyPending = 0;
+static uint32_t ulThrottles = 0;
+static uint32_t ulThrottledTicks = 0;
+static uint32_t ulOverrunMax = 0;           // Counts
+
+/* Timer daemon only */
+static TaskHandle_t pxMembers[BUDGET_SERVER_MAX_MEMBERS];
+static volatile UBaseType_t uxMembers = 0;
+static uint32_t ulSuspended = 0;
+
+/* With interrupts disabled: the time since the last charge to the running
+ * task, if it is a member */
+static inline void vCharge(uint32_t now) {
+    uint32_t used = now - ulLast;
+
+    ulLast = now;
+    if (uxCurrent == 0) {
+        return;
+    }
+    lRemaining -= (int32_t)used;
+    ullUsed += used;
+    ulChunkUsed += used;
+    xConsumed = 1;
+    if (!xChunkOpen) {
+        /* Every cycle charged now ran after the last tick, so the next one
+         * is no earlier than the chunk's real start */
+        xChunkOpen = 1;
+        ulChunkAt = ulTick + 1;
+    }
+}
+
+/* With interrupts disabled: queue the chunk's time to come back a period
+ * after it opened */
+static void vCloseChunk(void) {
+    UBaseType_t slot;
+
+    if (uxRefills < BUDGET_REPLENISH_MAX) {
+        slot = (uxRefillHead + uxRefills) % BUDGET_REPLENISH_MAX;
+        xRefill[slot].at = ulChunkAt + ulPeriodTicks;
+        xRefill[slot].counts = ulChunkUsed;
+        uxRefills++;
+    } else {
+        /* Later than both, which only holds the earlier one back */
+        slot = (uxRefillHead + uxRefills - 1) % BUDGET_REPLENISH_MAX;
+        xRefill[slot].at = ulChunkAt + ulPeriodTicks;
+        xRefill[slot].counts += ulChunkUsed;
+    }
+    xChunkOpen = 0;
+    ulChunkUsed = 0;
+}
+
+void vBudgetServerSwitchedIn(UBaseType_t uxTaskNumber) {
+    if (uxTaskNumber != uxCurrent) {
+        vCharge(ulLatencyNow());
+        uxCurrent = uxTaskNumber;
+    }
+}
+
+/* Timer daemon: hold off the members that are ready while the budget is
+ * spent, let go of them when it is not. Idempotent, so a lost or repeated
+ * call only costs a tick. */
+static void vBudgetApply(void *pv, uint32_t ul) {
+    UBaseType_t i;
+
+    (void)pv;
+    (void)ul;
+    for (i = 0; i < uxMembers; i++) {
+        if (xThrottled) {
+            if (!(ulSuspended & (1UL << i)) && eTaskGetState(pxMembers[i]) == eReady) {
+                vTaskSuspend(pxMembers[i]);
+                ulSuspended |= 1UL << i;
+            }
+        } else if (ulSuspended & (1UL << i)) {
+            ulSuspended &= ~(1UL << i);
+            vTaskResume(pxMembers[i]);
+        }
+    }
+}
+
+void vBudgetServerTick(void) {
+    alt_irq_context context;
+
+    if (!xStarted) {
+        return;
+    }
+
+    context = alt_irq_disable_all();
+    vCharge(ulLatencyNow());
+    if (lRemaining < 0 && (uint32_t)-lRemaining > ulOverrunMax) {
+        ulOverrunMax = (uint32_t)-lRemaining;
+    }
+    ulTick++;
+    while (uxRefills != 0 && (int32_t)(ulTick - xRefill[uxRefillHead].at) >= 0) {
+        lRemaining += (int32_t)xRefill[uxRefillHead].counts;
+        uxRefillHead = (uxRefillHead + 1) % BUDGET_REPLENISH_MAX;
+        uxRefills--;
+    }
+    if (xChunkOpen && (!xConsumed || lRemaining <= 0)) {
+        vCloseChunk();
+    }
+    if (lRemaining <= 0) {
+        if (!xThrottled) {
+            xThrottled = 1;
+            ulThrottles++;
+            xApplyPending = 1;
+        } else if (xConsumed) {
+            xApplyPending = 1;         // A member woke while the budget was spent
+        }
+        ulThrottledTicks++;
+    } else if (xThrottled) {
+        xThrottled = 0;
+        xApplyPending = 1;
+    }
+    xConsumed = 0;
+    alt_irq_enable_all(context);
+
+    /* Retried every tick until the daemon's queue takes it */
+    if (xApplyPending && xIrqDefer(vBudgetApply, NULL, 0, NULL) == pdPASS) {
+        xApplyPending = 0;
+    }
+}
+
+int xBudgetServerInit(uint32_t budget_us, uint32_t period_ms) {
+    alt_irq_context context;
+    uint32_t counts_per_us = ulLatencyCountsPerUs();
+
+    if (budget_us == 0 || period_ms == 0 || budget_us >= period_ms * 1000UL ||
+        budget_us > (uint32_t)INT32_MAX / counts_per_us) {
+        return -1;
+    }
+
+    context = alt_irq_disable_all();
+    ulBudgetUs = budget_us;
+    ulPeriodMs = period_ms;
+    ulBudgetCounts = budget_us * counts_per_us;
+    ulPeriodTicks = pdMS_TO_TICKS(period_ms);
+    lRemaining = (int32_t)ulBudgetCounts;
+    ulTick = 0;
+    ulLast = ulLatencyNow();
+    xChunkOpen = 0;
+    ulChunkUsed = 0;
+    uxRefillHead = 0;
+    uxRefills = 0;
+    xThrottled = 0;
+    xStarted = 1;
+    alt_irq_enable_all(context);
+    return 0;
+}
+
+int xBudgetServerAdd(TaskHandle_t xTask) {
+    UBaseType_t n = uxMembers;
+
+    if (xTask == NULL || n >= BUDGET_SERVER_MAX_MEMBERS) {
+        return -1;
+    }
+    pxMembers[n] = xTask;
+    uxMembers = n + 1;
+    vTaskSetTaskNumber(xTask, n + 1);
+    return 0;
+}
+
+int xBudgetServerThrottled(void) {
+    return xThrottled;
+}
+
+void vBudgetServerGetStats(BudgetServerStats_t *pxStats) {
+    alt_irq_context context;
+    uint32_t counts_per_us = ulLatencyCountsPerUs();
+    int32_t remaining;
+    uint64_t used;
+
+    context = alt_irq_disable_all();
+    remaining = lRemaining;
+    used = ullUsed;
+    pxStats->throttles = ulThrottles;
+    pxStats->throttled_ms = ulThrottledTicks * portTICK_PERIOD_MS;
+    pxStats->overrun_max_us = ulOverrunMax / counts_per_us;
+    alt_irq_enable_all(context);
+
+    pxStats->budget_us = ulBudgetUs;
+    pxStats->period_ms = ulPeriodMs;
+    pxStats->members = uxMembers;
+    pxStats->remaining_us = remaining > 0 ? (uint32_t)remaining / counts_per_us : 0;
+    pxStats->used_us = used / counts_per_us;
+}
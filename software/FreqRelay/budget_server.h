@@ -0,0 +1,71 @@
+/**
+ * CPU budget server for the non-critical tasks
+ *
+ * The display, the threshold editor, the run stats, the flash task and the
+ * background timer daemon (the telemetry drain) run below every control
+ * task, so they never delay one by priority. They still cost it: a long
+ * frame or a flash page keeps the SDRAM and the pixel buffer's bus busy
+ * alongside the frequency ISR and the analyser, and a burst of them is
+ * what stretches the control path's worst case. The server puts a ceiling
+ * on that: together its members get at most budget_us of CPU in any
+ * period_ms.
+ *
+ * It is a sporadic server. Members' CPU time is charged in the kernel's
+ * switch-in hook, on the run time counter (the timestamp timer), so it is
+ * exact to the cycle and interrupts are charged to whoever they interrupt,
+ * as in the run stats. A run of member activity is a chunk, opened at the
+ * tick its first cycle was charged in and closed by a tick with no member
+ * time in it, or when the budget runs out. What a chunk used comes back
+ * period_ms after it opened. Closing early only delays the refill, so the
+ * ceiling holds whatever the members do.
+ *
+ * When the budget is spent the tick hook has the timer daemon suspend the
+ * members that are ready to run, and resume them when a refill comes due.
+ * A member blocked with a timeout is left blocked (suspending it would end
+ * its wait early); if it wakes while the server is spent it runs at most to
+ * the next tick before it is suspended too. So the overrun past the budget
+ * is under a tick, and is reported.
+ *
+ * Members are tagged through the kernel's task number (vTaskSetTaskNumber),
+ * which nothing else uses; 0 is every other task.
+ */
+
+#ifndef BUDGET_SERVER_H
+#define BUDGET_SERVER_H
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define BUDGET_SERVER_MAX_MEMBERS      8
+#define BUDGET_REPLENISH_MAX           8     // Refills pending, the last merged into when full
+
+typedef struct {
+    uint32_t budget_us;                // Configured ceiling
+    uint32_t period_ms;
+    uint32_t members;
+    uint32_t remaining_us;             // Budget left now
+    uint32_t throttles;                // Times the budget ran out
+    uint32_t throttled_ms;             // Ticks spent with the members held off
+    uint32_t overrun_max_us;           // Most used past the budget
+    uint64_t used_us;                  // Members' CPU time since the server started
+} BudgetServerStats_t;
+
+/* Start the server, before adding members. Task context. */
+int xBudgetServerInit(uint32_t budget_us, uint32_t period_ms);
+
+/* Put a task under the budget. Returns 0 on success, -1 if full. */
+int xBudgetServerAdd(TaskHandle_t xTask);
+
+/* Kernel hook, see FreeRTOSConfig.h: the tag of the task switched in */
+void vBudgetServerSwitchedIn(UBaseType_t uxTaskNumber);
+
+/* From the tick hook */
+void vBudgetServerTick(void);
+
+/* Non-zero while the members are held off */
+int xBudgetServerThrottled(void);
+
+void vBudgetServerGetStats(BudgetServerStats_t *pxStats);
+
+#endif /* BUDGET_SERVER_H */
@@ -0,0 +1,69 @@
+/**
+ * D-cache discipline for memory shared with a bus master
+ *
+ * The Nios II data cache is not coherent with the other Avalon masters (the
+ * pixel buffer DMA, the JTAG debug master reading the kernel trace ring).
+ * Memory one of them reads or writes is accessed in one of two ways:
+ *
+ *   Uncached      every access goes to memory. The IORD/IOWR_*DIRECT macros
+ *                 (ldwio/stwio) do this, and so does any pointer through an
+ *                 alias from pvCacheUncached() or a buffer from
+ *                 alt_uncached_malloc(). Use it for sparse or streaming
+ *                 accesses: nothing is allocated, so the control path keeps
+ *                 its lines. This is how the VGA frame and the trace ring
+ *                 are written.
+ *   Cached        normal loads and stores, with vCacheFlushRange() before
+ *                 the master reads the buffer and vCacheInvalidateRange()
+ *                 before the CPU reads what the master wrote. Only worth it
+ *                 for a buffer the CPU works over many times per transfer.
+ *
+ * Never mix the two on one buffer without a flush in between: a dirty line
+ * written back later overwrites whatever went past the cache. The range
+ * helpers work in whole lines, so a cached buffer shared with a master
+ * starts on a line and fills whole lines (CACHE_LINE in fast_mem.h);
+ * invalidating a partial line would throw away a neighbour's stores.
+ * configASSERT() checks both rules where it is defined.
+ *
+ * The core has no MMU, so bit 31 of a data address bypasses the cache;
+ * that is what alt_remap_uncached() sets and what xCacheIsUncached() tests.
+ */
+
+#ifndef CACHE_IO_H
+#define CACHE_IO_H
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "system.h"
+#include "sys/alt_cache.h"
+
+#define CACHE_BYPASS_BIT               0x80000000UL  // Data address bit 31
+#define CACHE_LINE_MASK                (ALT_CPU_DCACHE_LINE_SIZE - 1)
+
+static inline int xCacheIsUncached(const volatile void *pv) {
+    return ((uintptr_t)pv & CACHE_BYPASS_BIT) != 0;
+}
+
+static inline int xCacheLineAligned(const volatile void *pv, uint32_t len) {
+    return (((uintptr_t)pv | len) & CACHE_LINE_MASK) == 0;
+}
+
+/* Uncached alias of a cached buffer. Flushes it first, so nothing written
+ * through the cached address is lost or written back over the alias. */
+static inline volatile void *pvCacheUncached(void *pv, uint32_t len) {
+    return alt_remap_uncached(pv, len);
+}
+
+/* Cached buffer the CPU has written, before a master reads it */
+static inline void vCacheFlushRange(void *pv, uint32_t len) {
+    configASSERT(!xCacheIsUncached(pv));
+    alt_dcache_flush(pv, len);
+}
+
+/* Cached buffer a master has written, before the CPU reads it. Whole lines
+ * only, any dirty data in them is discarded. */
+static inline void vCacheInvalidateRange(void *pv, uint32_t len) {
+    configASSERT(!xCacheIsUncached(pv) && xCacheLineAligned(pv, len));
+    alt_dcache_flush_no_writeback(pv, len);
+}
+
+#endif /* CACHE_IO_H */
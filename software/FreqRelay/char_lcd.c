@@ -0,0 +1,139 @@
+/**
+ * Character LCD status display
+ *
+ * See char_lcd.h.
+ */
+
+/* Hardware includes */
+#include "system.h"
+#include "sys/alt_alarm.h"
+#include "priv/alt_file.h"
+#include "altera_avalon_lcd_16207.h"
+#include "altera_avalon_lcd_16207_fd.h"
+#include "altera_avalon_lcd_16207_regs.h"
+
+/* Application includes */
+#include "char_lcd.h"
+#include "idle_jobs.h"
+#include "latency.h"
+
+#define LCD_CMD_SET_ADDRESS            0x80   // DDRAM address, row 1 starts at 0x40
+#define LCD_ROW_ADDRESS(y)             ((y) * 0x40)
+#define LCD_CURSOR_UNKNOWN             0xFF
+
+/* Written by any task */
+static volatile char cShadow[LCD_ROWS][LCD_COLS];
+
+/* Idle job only */
+static char cShown[LCD_ROWS][LCD_COLS];  // What the panel holds
+static uint8_t ucCursor = LCD_CURSOR_UNKNOWN;
+static uint8_t ucNext = 0;               // Cell the scan starts from
+static uint32_t ulLastWrite;             // Timestamp count of the last command or character
+static uint32_t ulLastRefresh;
+static uint8_t xMissing = 1;
+static LcdRefresh_t pxLcdRefresh = NULL;
+
+/* One step: a command or a character, or nothing while the panel is busy */
+static int xLcdJob(void) {
+    uint32_t now = ulLatencyNow();
+    uint32_t i, cell, x, y;
+    char ch;
+
+    if (xMissing) {
+        return 0;
+    }
+
+    if (pxLcdRefresh != NULL && ulLatencyElapsedUs(ulLastRefresh, now) >= LCD_REFRESH_MS * 1000UL) {
+        ulLastRefresh = now;
+        pxLcdRefresh();
+    }
+
+    /* Next cell that differs, round from where the last one was sent */
+    for (i = 0; i < LCD_ROWS * LCD_COLS; i++) {
+        cell = (ucNext + i) % (LCD_ROWS * LCD_COLS);
+        if (cShadow[cell / LCD_COLS][cell % LCD_COLS] != cShown[cell / LCD_COLS][cell % LCD_COLS]) {
+            break;
+        }
+    }
+    if (i == LCD_ROWS * LCD_COLS) {
+        return 0;
+    }
+
+    if (ulLatencyElapsedUs(ulLastWrite, now) < LCD_SETTLE_US) {
+        return 1;
+    }
+    if (IORD_ALTERA_AVALON_LCD_16207_STATUS(CHARACTER_LCD_BASE) & ALTERA_AVALON_LCD_16207_STATUS_BUSY_MSK) {
+        if (ulLatencyElapsedUs(ulLastWrite, now) >= LCD_BUSY_TIMEOUT_US) {
+            xMissing = 1;
+            return 0;
+        }
+        return 1;
+    }
+
+    y = cell / LCD_COLS;
+    x = cell % LCD_COLS;
+    if (ucCursor != LCD_ROW_ADDRESS(y) + x) {
+        ucCursor = (uint8_t)(LCD_ROW_ADDRESS(y) + x);
+        IOWR_ALTERA_AVALON_LCD_16207_COMMAND(CHARACTER_LCD_BASE, LCD_CMD_SET_ADDRESS | ucCursor);
+    } else {
+        /* The panel moves its cursor on, past the row end it reaches
+         * cells nobody sees, so the next row starts with an address */
+        ch = cShadow[y][x];
+        IOWR_ALTERA_AVALON_LCD_16207_DATA(CHARACTER_LCD_BASE, (uint8_t)ch);
+        cShown[y][x] = ch;
+        ucCursor++;
+        ucNext = (uint8_t)((cell + 1) % (LCD_ROWS * LCD_COLS));
+    }
+    ulLastWrite = ulLatencyNow();
+    return 1;
+}
+
+int xLcdInit(LcdRefresh_t pxRefresh) {
+    altera_avalon_lcd_16207_dev *pxDev;
+    int x, y;
+
+    pxDev = (altera_avalon_lcd_16207_dev *)alt_find_dev(CHARACTER_LCD_NAME, &alt_dev_list);
+    if (pxDev == NULL || pxDev->state.broken) {
+        return -1;
+    }
+
+    /* Its scroll alarm (started only with a system clock) would write the
+     * panel too. Marked broken, anything still written through the BSP
+     * driver is dropped before the panel. */
+    if (pxDev->state.alarm.llist.next != NULL) {
+        alt_alarm_stop(&pxDev->state.alarm);
+    }
+    pxDev->state.broken = 1;
+
+    /* The BSP driver left the panel cleared */
+    for (y = 0; y < LCD_ROWS; y++) {
+        for (x = 0; x < LCD_COLS; x++) {
+            cShadow[y][x] = ' ';
+            cShown[y][x] = ' ';
+        }
+    }
+    pxLcdRefresh = pxRefresh;
+    ulLastWrite = ulLatencyNow();
+    ulLastRefresh = ulLastWrite;
+    xMissing = 0;
+
+    return xIdleJobRegister("LCD", xLcdJob);
+}
+
+void vLcdPut(int x, int y, const char *text, int width) {
+    int col;
+
+    if (y < 0 || y >= LCD_ROWS || x < 0) {
+        return;
+    }
+
+    for (col = x; col < LCD_COLS; col++) {
+        if (*text) {
+            cShadow[y][col] = *text++;
+        } else if (col - x < width) {
+            cShadow[y][col] = ' ';
+        } else {
+            break;
+        }
+    }
+}
@@ -0,0 +1,48 @@
+/**
+ * Character LCD status display
+ *
+ * The BSP's 16207 driver times every command with a BUSY poll and a
+ * usleep(100), and scrolls from an alarm, so a task writing through it
+ * spins for each character. Here the 2x16 panel is a shadow buffer: any
+ * task writes it with vLcdPut(), which only stores characters, and an idle
+ * job (see idle_jobs.h) sends the cells that differ from what the panel
+ * shows, one command or character per step. A step is taken only once the
+ * panel reports not busy and LCD_SETTLE_US have passed since the last one,
+ * checked against the timestamp timer, so nothing waits on the panel.
+ *
+ * Every LCD_REFRESH_MS the job calls the refresh function given to
+ * xLcdInit() to rewrite the shadow, so a status line costs the tasks
+ * nothing at all. The display only moves while the CPU has idle time; it
+ * is the status of last resort, shown with the VGA output absent.
+ *
+ * A panel that stays busy for LCD_BUSY_TIMEOUT_US is taken as missing
+ * and left alone, as is one the BSP driver found missing at boot. The
+ * BSP's initialisation sequence before main is kept, it is the only part
+ * that has to be timed blindly.
+ */
+
+#ifndef CHAR_LCD_H
+#define CHAR_LCD_H
+
+#include <stdint.h>
+
+#define LCD_COLS                       16
+#define LCD_ROWS                       2
+#define LCD_SETTLE_US                  100    // After BUSY clears, before the next write
+#define LCD_BUSY_TIMEOUT_US            25000  // Busy this long: no panel
+#define LCD_REFRESH_MS                 250    // Refresh function period
+
+/* Rewrites the shadow with vLcdPut(), called from the idle job */
+typedef void (*LcdRefresh_t)(void);
+
+/* Take the panel over from the BSP driver and register the idle job,
+ * before the scheduler starts. pxRefresh may be NULL. Returns 0 on
+ * success. */
+int xLcdInit(LcdRefresh_t pxRefresh);
+
+/* Write text at (x, y), padded with spaces to width characters (0 = no
+ * padding). Clipped at the right edge. Any task; another task writing the
+ * same cells at once leaves one or the other's characters. */
+void vLcdPut(int x, int y, const char *text, int width);
+
+#endif /* CHAR_LCD_H */
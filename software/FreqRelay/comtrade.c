@@ -0,0 +1,219 @@
+/**
+ * COMTRADE export of disturbance records
+ *
+ * See comtrade.h.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+/* Application includes */
+#include "comtrade.h"
+#include "disturbance.h"
+#include "latency.h"
+
+#define COMTRADE_MISSING               0x8000  // Binary .dat value for no sample
+
+static uint32_t ulChannels;
+static uint32_t ulLineHz;
+static uint32_t ulPeriodNs;            // Sample clock period, the channel scale
+
+/* The record being exported and how far it has got */
+static const DisturbRecord_t *pxRecord = NULL;
+static uint32_t ulFirst;               // Its oldest sample, as a record index
+static uint32_t ulSamples;
+static uint64_t ullStartUs;            // Time of the oldest sample, see vComtradeStart()
+static uint32_t ulPart;                // COMTRADE_PART_*
+static uint32_t ulOffset;              // Bytes of the part sent
+static uint32_t ulItem;                // Next .cfg line or .dat sample to build
+static uint8_t ucLine[COMTRADE_LINE_BYTES];
+static uint32_t ulLineBytes = 0;
+static uint32_t ulLineSent = 0;
+static uint32_t ulExported = 0;
+
+void vComtradeInit(uint32_t channels, uint32_t line_hz, uint32_t sample_hz) {
+    ulChannels = channels;
+    ulLineHz = line_hz;
+    ulPeriodNs = 1000000000UL / sample_hz;
+    (void)xTelemetryAddExport(xComtradeChunk);
+}
+
+/* dd/mm/yyyy,hh:mm:ss.ssssss, counting from 1 January 1970 */
+static int iComtradeTime(char *pcOut, uint32_t len, uint64_t us) {
+    static const uint8_t ucMonthDays[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    uint32_t seconds = (uint32_t)(us / 1000000), days = seconds / 86400;
+    uint32_t month = 0, year = 1970, year_days;
+
+    for (;;) {
+        year_days = (year % 4 == 0) ? 366 : 365;
+        if (days < year_days) {
+            break;
+        }
+        days -= year_days;
+        year++;
+    }
+    while (month < 11 && days >= ucMonthDays[month] + (month == 1 && year % 4 == 0)) {
+        days -= ucMonthDays[month] + (month == 1 && year % 4 == 0);
+        month++;
+    }
+    seconds %= 86400;
+    return snprintf(pcOut, len, "%02lu/%02lu/%04lu,%02lu:%02lu:%02lu.%06lu\r\n",
+                    (unsigned long)(days + 1), (unsigned long)(month + 1), (unsigned long)year,
+                    (unsigned long)(seconds / 3600), (unsigned long)(seconds / 60 % 60),
+                    (unsigned long)(seconds % 60), (unsigned long)(us % 1000000));
+}
+
+/* One .cfg line, by number */
+static int iComtradeCfgLine(char *pcOut, uint32_t len, uint32_t line) {
+    uint32_t trigger_us;
+
+    if (line == 0) {
+        return snprintf(pcOut, len, "FreqRelay,DE2-115,1999\r\n");
+    }
+    if (line == 1) {
+        return snprintf(pcOut, len, "%lu,%luA,0D\r\n", (unsigned long)ulChannels, (unsigned long)ulChannels);
+    }
+    line -= 2;
+    if (line < ulChannels) {
+        return snprintf(pcOut, len, "%lu,Feeder %lu period,,,us,%lu.%03lu,0,0,0,32767,1,1,P\r\n",
+                        (unsigned long)(line + 1), (unsigned long)line,
+                        (unsigned long)(ulPeriodNs / 1000), (unsigned long)(ulPeriodNs % 1000));
+    }
+    switch (line - ulChannels) {
+    case 0:
+        return snprintf(pcOut, len, "%lu\r\n", (unsigned long)ulLineHz);
+    case 1:
+        return snprintf(pcOut, len, "0\r\n");
+    case 2:
+        return snprintf(pcOut, len, "0,%lu\r\n", (unsigned long)ulSamples);
+    case 3:
+        return iComtradeTime(pcOut, len, ullStartUs);
+    case 4:
+        trigger_us = ulLatencyElapsedUs(pxRecord->ring[ulFirst & DISTURB_MASK].stamp,
+                                        pxRecord->ring[pxRecord->trigger & DISTURB_MASK].stamp);
+        return iComtradeTime(pcOut, len, ullStartUs + trigger_us);
+    case 5:
+        return snprintf(pcOut, len, "BINARY\r\n");
+    case 6:
+        return snprintf(pcOut, len, "1\r\n");
+    default:
+        return 0;
+    }
+}
+
+static uint8_t *pucPut(uint8_t *pucOut, uint32_t value, uint32_t bytes) {
+    while (bytes--) {
+        *pucOut++ = (uint8_t)value;
+        value >>= 8;
+    }
+    return pucOut;
+}
+
+/* One .dat row: sample number, time from the first in us, then a value per
+ * channel, little endian */
+static uint32_t ulComtradeDatRow(uint8_t *pucOut, uint32_t sample) {
+    const DisturbSample_t *pxSample = &pxRecord->ring[(ulFirst + sample) & DISTURB_MASK];
+    uint32_t feeder = pxSample->sample >> 24, count = pxSample->sample & 0xFFFFFF, i;
+    uint8_t *p = pucOut;
+
+    p = pucPut(p, sample + 1, 4);
+    p = pucPut(p, ulLatencyElapsedUs(pxRecord->ring[ulFirst & DISTURB_MASK].stamp, pxSample->stamp), 4);
+    for (i = 0; i < ulChannels; i++) {
+        p = pucPut(p, i != feeder ? COMTRADE_MISSING : (count > 32767 ? 32767 : count), 2);
+    }
+    return (uint32_t)(p - pucOut);
+}
+
+/* Build the next line of the part into ucLine. Returns 0 when the part has
+ * no more. */
+static int xComtradeNextLine(void) {
+    int len;
+
+    if (ulPart == COMTRADE_PART_CFG) {
+        len = iComtradeCfgLine((char *)ucLine, sizeof(ucLine), ulItem);
+        if (len <= 0) {
+            return 0;
+        }
+        ulLineBytes = (uint32_t)len < sizeof(ucLine) ? (uint32_t)len : sizeof(ucLine) - 1;
+    } else if (ulPart == COMTRADE_PART_DAT && ulItem < ulSamples) {
+        ulLineBytes = ulComtradeDatRow(ucLine, ulItem);
+    } else {
+        return 0;
+    }
+    ulItem++;
+    ulLineSent = 0;
+    return 1;
+}
+
+static void vComtradeStart(const DisturbRecord_t *pxNext) {
+    uint64_t trigger_us;
+    uint32_t lead_us;
+
+    pxRecord = pxNext;
+    ulSamples = pxRecord->head < DISTURB_SAMPLES ? pxRecord->head : DISTURB_SAMPLES;
+    ulFirst = pxRecord->head - ulSamples;
+
+    /* The record's time is the trigger sample's, on the common clock so
+     * the relays' records line up */
+    trigger_us = pxRecord->trigger_us;
+    lead_us = ulLatencyElapsedUs(pxRecord->ring[ulFirst & DISTURB_MASK].stamp,
+                                 pxRecord->ring[pxRecord->trigger & DISTURB_MASK].stamp);
+    ullStartUs = trigger_us > lead_us ? trigger_us - lead_us : 0;
+
+    ulPart = COMTRADE_PART_CFG;
+    ulOffset = 0;
+    ulItem = 0;
+    ulLineBytes = 0;
+    ulLineSent = 0;
+}
+
+int xComtradeChunk(TelemetryChunk_t *pxChunk) {
+    uint32_t n;
+
+    if (pxRecord == NULL) {
+        pxRecord = pxDisturbanceTake();
+        if (pxRecord == NULL) {
+            return 0;
+        }
+        vComtradeStart(pxRecord);
+    }
+
+    pxChunk->record = (uint16_t)pxRecord->number;
+    pxChunk->length = 0;
+    for (;;) {
+        pxChunk->part = (uint8_t)ulPart;
+        pxChunk->offset = ulOffset;
+        if (ulPart == COMTRADE_PART_END) {
+            vDisturbanceRelease(pxRecord);
+            pxRecord = NULL;
+            ulExported++;
+            return 1;
+        }
+
+        while (pxChunk->length < TELEMETRY_CHUNK_BYTES) {
+            if (ulLineSent == ulLineBytes && !xComtradeNextLine()) {
+                break;
+            }
+            n = ulLineBytes - ulLineSent;
+            if (n > TELEMETRY_CHUNK_BYTES - pxChunk->length) {
+                n = TELEMETRY_CHUNK_BYTES - pxChunk->length;
+            }
+            memcpy(&pxChunk->data[pxChunk->length], &ucLine[ulLineSent], n);
+            pxChunk->length += (uint8_t)n;
+            ulLineSent += n;
+        }
+        if (pxChunk->length != 0) {
+            ulOffset += pxChunk->length;
+            return 1;
+        }
+
+        /* Part finished on a chunk boundary: on to the next one */
+        ulPart++;
+        ulOffset = 0;
+        ulItem = 0;
+    }
+}
+
+uint32_t ulComtradeExported(void) {
+    return ulExported;
+}
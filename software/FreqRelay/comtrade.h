@@ -0,0 +1,50 @@
+/**
+ * COMTRADE export of disturbance records
+ *
+ * Each finished disturbance record (disturbance.h) goes out over the
+ * telemetry link as an IEEE C37.111-1999 configuration file and binary
+ * data file, in TELEMETRY_EXPORT chunks from the telemetry drain, then an
+ * empty COMTRADE_PART_END chunk, and the record is given back. Nothing is
+ * encoded ahead: the exporter keeps its place (file, line or sample, byte)
+ * and builds just the next line of the .cfg or sample of the .dat into a
+ * line buffer as the chunk being filled needs it, so a record costs the
+ * same few dozen bytes of state however long it is, and an export the
+ * UART cannot take picks up where it left off at the next drain.
+ *
+ * The files, for tools that read COMTRADE:
+ *
+ *   one analog channel per feeder, "Feeder n period" in us, the period
+ *   count times the sample clock period; a sample row is one count, the
+ *   other feeders' channels in it are missing (0x8000)
+ *   no sampling rate (nrates 0), every row timed in us from the first
+ *   start and trigger times from the coordination leader's boot (this
+ *   relay's without coordination, see time_sync.h), dated 1 January 1970
+ *   onward: the board has no calendar clock
+ *
+ * tools/telemetry_decode.py --comtrade writes record_<n>.cfg and .dat.
+ */
+
+#ifndef COMTRADE_H
+#define COMTRADE_H
+
+#include <stdint.h>
+#include "telemetry.h"
+
+#define COMTRADE_PART_CFG              0
+#define COMTRADE_PART_DAT              1
+#define COMTRADE_PART_END              2      // Empty, the record is complete
+#define COMTRADE_LINE_BYTES            64     // Longest .cfg line or .dat row
+
+/* Feeders in the records, the nominal line frequency and the analyser
+ * sample clock, and start exporting through the telemetry drain. After
+ * vDisturbanceInit(). */
+void vComtradeInit(uint32_t channels, uint32_t line_hz, uint32_t sample_hz);
+
+/* TelemetryExport_t: the next chunk of the record being exported, taking
+ * the next finished record when there is none */
+int xComtradeChunk(TelemetryChunk_t *pxChunk);
+
+/* Records fully exported */
+uint32_t ulComtradeExported(void);
+
+#endif /* COMTRADE_H */
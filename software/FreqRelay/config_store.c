@@ -0,0 +1,199 @@
+/**
+ * Persistent configuration in CFI flash
+ *
+ * See config_store.h.
+ */
+
+/* Standard includes */
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Scheduler includes */
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/* Hardware includes */
+#include "system.h"
+#include "sys/alt_irq.h"
+#include "sys/alt_flash.h"
+
+/* Application includes */
+#include "config_store.h"
+#include "crc32.h"
+
+#if CONFIG_SLOT_SIZE < 64 || (CONFIG_SLOT_SIZE & (CONFIG_SLOT_SIZE - 1))
+#error CONFIG_SLOT_SIZE must be a power of 2 that holds a ConfigBlock_t
+#endif
+
+static alt_flash_fd *pxFlash = NULL;
+
+/* Flash task only: where the next save goes */
+static uint32_t ulSector;
+static uint32_t ulNextSlot;            // CONFIG_SLOTS when the sector is full
+static uint32_t ulSequence = 0;
+static uint32_t ulSaves = 0;
+
+/* Queued save, written by the edit task and taken by the flash task */
+static ConfigParams_t xPending;
+static volatile uint8_t ucPending = 0;
+static volatile TickType_t xPendingSince;
+
+static int xSlotOffset(uint32_t sector, uint32_t slot) {
+    return CONFIG_FLASH_OFFSET + (int)(sector * CONFIG_SECTOR_SIZE + slot * CONFIG_SLOT_SIZE);
+}
+
+static int xBlockValid(const ConfigBlock_t *pxBlock) {
+    return pxBlock->magic == CONFIG_MAGIC && pxBlock->version == CONFIG_VERSION &&
+           pxBlock->length == sizeof(ConfigParams_t) &&
+           pxBlock->crc == ulCrc32((const uint8_t *)pxBlock, offsetof(ConfigBlock_t, crc));
+}
+
+/* Slots are programmed in order, magic first */
+static int xSlotUsed(uint32_t sector, uint32_t slot) {
+    uint32_t magic;
+
+    if (alt_read_flash(pxFlash, xSlotOffset(sector, slot), &magic, sizeof(magic)) != 0) {
+        return 1;
+    }
+    return magic != 0xFFFFFFFFUL;
+}
+
+int xConfigInit(ConfigParams_t *pxParams) {
+    ConfigBlock_t block, newest;
+    uint32_t sector, lo, hi, mid, slot;
+    int found = 0;
+
+    pxFlash = alt_flash_open_dev(FLASH_CONTROLLER_NAME);
+    if (pxFlash == NULL) {
+        printf("Config: flash not found, using compiled defaults\n");
+        return 0;
+    }
+
+    /* First save after a blank or corrupt store erases sector 0 */
+    ulSector = CONFIG_SECTORS - 1;
+    ulNextSlot = CONFIG_SLOTS;
+
+    for (sector = 0; sector < CONFIG_SECTORS; sector++) {
+        /* First erased slot, CONFIG_SLOTS if the sector is full */
+        lo = 0;
+        hi = CONFIG_SLOTS;
+        while (lo < hi) {
+            mid = (lo + hi) / 2;
+            if (xSlotUsed(sector, mid)) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+
+        /* The last slot is normally good, earlier ones cover a save cut short */
+        for (slot = lo; slot > 0; slot--) {
+            if (alt_read_flash(pxFlash, xSlotOffset(sector, slot - 1), &block, sizeof(block)) == 0 &&
+                xBlockValid(&block)) {
+                if (!found || (int32_t)(block.sequence - newest.sequence) > 0) {
+                    newest = block;
+                    ulSector = sector;
+                    ulNextSlot = lo;
+                    found = 1;
+                }
+                break;
+            }
+        }
+    }
+
+    if (!found) {
+        printf("Config: no valid block, using compiled defaults\n");
+        return 0;
+    }
+
+    ulSequence = newest.sequence;
+    memcpy(pxParams, &newest.params, sizeof(ConfigParams_t));
+    printf("Config: block %lu from sector %u\n", (unsigned long)ulSequence, (unsigned int)ulSector);
+    return 1;
+}
+
+void vConfigSave(const ConfigParams_t *pxParams) {
+    alt_irq_context context;
+
+    if (pxFlash == NULL) {
+        return;
+    }
+
+    /* Each edit restarts the quiet time, so a burst of key presses costs one save */
+    context = alt_irq_disable_all();
+    memcpy(&xPending, pxParams, sizeof(ConfigParams_t));
+    xPendingSince = xTaskGetTickCount();
+    ucPending = 1;
+    alt_irq_enable_all(context);
+}
+
+/* Program one block, erasing the other sector first if this one is full.
+ * Runs in the flash task, the store keeps the previous block until then. */
+static int xConfigWrite(const ConfigBlock_t *pxBlock) {
+    ConfigBlock_t check;
+    uint32_t sector = ulSector;
+    int offset;
+
+    if (ulNextSlot >= CONFIG_SLOTS) {
+        sector = (ulSector + 1) % CONFIG_SECTORS;
+        if (alt_erase_flash_block(pxFlash, xSlotOffset(sector, 0), CONFIG_SECTOR_SIZE) != 0) {
+            return -1;
+        }
+        ulSector = sector;
+        ulNextSlot = 0;
+    }
+
+    offset = xSlotOffset(sector, ulNextSlot);
+    ulNextSlot++;
+    if (alt_write_flash_block(pxFlash, xSlotOffset(sector, 0), offset, pxBlock,
+                              sizeof(ConfigBlock_t)) != 0) {
+        return -1;
+    }
+
+    /* A slot that was not clean fails here and the save moves on */
+    if (alt_read_flash(pxFlash, offset, &check, sizeof(check)) != 0 ||
+        memcmp(&check, pxBlock, sizeof(ConfigBlock_t)) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+void vConfigService(void) {
+    alt_irq_context context;
+    ConfigBlock_t block;
+
+    if (!ucPending || (xTaskGetTickCount() - xPendingSince) < pdMS_TO_TICKS(CONFIG_SAVE_DELAY_MS)) {
+        return;
+    }
+
+    context = alt_irq_disable_all();
+    memcpy(&block.params, &xPending, sizeof(ConfigParams_t));
+    ucPending = 0;
+    alt_irq_enable_all(context);
+
+    block.magic = CONFIG_MAGIC;
+    block.version = CONFIG_VERSION;
+    block.length = sizeof(ConfigParams_t);
+    block.sequence = ulSequence + 1;
+    block.crc = ulCrc32((const uint8_t *)&block, offsetof(ConfigBlock_t, crc));
+
+    if (xConfigWrite(&block) == 0) {
+        ulSequence = block.sequence;
+        ulSaves++;
+    } else {
+        /* Try again in the next slot after another quiet period, unless a
+         * newer edit has been queued meanwhile */
+        context = alt_irq_disable_all();
+        if (!ucPending) {
+            memcpy(&xPending, &block.params, sizeof(ConfigParams_t));
+            xPendingSince = xTaskGetTickCount();
+            ucPending = 1;
+        }
+        alt_irq_enable_all(context);
+    }
+}
+
+uint32_t ulConfigSaves(void) {
+    return ulSaves;
+}
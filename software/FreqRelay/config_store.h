@@ -0,0 +1,67 @@
+/**
+ * Persistent configuration in CFI flash
+ *
+ * The frequency limits, the RoC threshold and the shedding bands and masks
+ * are kept in a versioned, CRC-32 protected block in flash. It is read once
+ * at boot into RAM, the tasks only ever use the RAM copies (gThresholds and
+ * the active load policy), and a keyboard edit only queues a save: the flash
+ * task programs it once the edits have been quiet for CONFIG_SAVE_DELAY_MS.
+ *
+ * Two sectors are used in turn. Each save goes into the next erased slot of
+ * the current sector; when that is full the other sector is erased and the
+ * save goes there, so the previous block stays intact until its replacement
+ * is programmed. At boot the newest valid block of either sector wins. A
+ * block with the wrong magic, version, length or CRC is skipped, and if
+ * none is left the compiled defaults stay in use.
+ */
+
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+#include <stdint.h>
+#include "fix16.h"
+#include "load_policy.h"
+
+/* Flash region, just below the event log (EVENT_LOG_OFFSET) */
+#define CONFIG_FLASH_OFFSET            0x6E0000
+#define CONFIG_SECTORS                 2
+#define CONFIG_SECTOR_SIZE             0x10000  // Must match the flash erase block
+#define CONFIG_SLOT_SIZE               64       // One block per slot
+#define CONFIG_SLOTS                   (CONFIG_SECTOR_SIZE / CONFIG_SLOT_SIZE)
+
+#define CONFIG_MAGIC                   0x434E4647UL  // "CNFG"
+#define CONFIG_VERSION                 1
+#define CONFIG_SAVE_DELAY_MS           5000   // Quiet time after the last edit before a save
+
+/* Everything that can be retuned without a rebuild */
+typedef struct {
+    fix16_t upper_limit;                                      // Hz
+    fix16_t lower_limit;                                      // Hz
+    fix16_t max_roc;                                          // Hz/s, also the policy RoC boundary
+    fix16_t freq_thresholds[POLICY_FREQ_BANDS - 1];           // See LoadPolicy_t
+    LoadMask_t requested_status[POLICY_FREQ_BANDS][POLICY_ROC_BANDS];
+} ConfigParams_t;
+
+typedef struct {
+    uint32_t magic;                    // CONFIG_MAGIC
+    uint16_t version;                  // CONFIG_VERSION
+    uint16_t length;                   // sizeof(ConfigParams_t)
+    uint32_t sequence;                 // Save count, the highest is the newest
+    ConfigParams_t params;
+    uint32_t crc;                      // CRC-32 of everything above
+} ConfigBlock_t;
+
+/* Read the newest valid block into *pxParams, which holds the defaults on
+ * entry and is left alone if there is none. Call before the scheduler
+ * starts. Returns 1 if a stored block was loaded, 0 otherwise. */
+int xConfigInit(ConfigParams_t *pxParams);
+
+/* Queue a save of *pxParams, from a task. Never touches the flash. */
+void vConfigSave(const ConfigParams_t *pxParams);
+
+/* Flash task body: program the queued save once it is due */
+void vConfigService(void);
+
+uint32_t ulConfigSaves(void);
+
+#endif /* CONFIG_STORE_H */
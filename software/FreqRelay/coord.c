@@ -0,0 +1,683 @@
+/**
+ * Shed coordination between relays on one island grid
+ *
+ * See coord.h.
+ */
+
+/* Standard includes */
+#include <string.h>
+
+/* Scheduler includes */
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/* Hardware includes */
+#include "system.h"
+#include "altera_avalon_uart_regs.h"
+
+/* Application includes */
+#include "coord.h"
+#include "crc16.h"
+#include "irq_defer.h"
+#include "latency.h"
+#include "time_base.h"
+#include "time_sync.h"
+
+#define COORD_RX_MASK                  (COORD_RX_FRAMES - 1)
+#define COORD_TX_MASK                  (COORD_TX_FRAMES - 1)
+#define COORD_OWN_FRAMES               (3 + COORD_ASSIGN_FRAMES)  // Own frame buffers, reused in turn
+#define COORD_OWN_TIME                 COORD_OWN_FRAMES  // And the time frame's, its stamp wanted a period on
+#define COORD_STAGE_BITS               2
+#define COORD_STAGE_MASK               0x03
+#define COORD_COST_NONE                0xFFFFFFFFUL
+
+#if COORD_STAGES > COORD_STAGE_MASK
+#error COORD_STAGES must fit COORD_STAGE_BITS
+#endif
+#if COORD_AT_PAYLOAD + 5 + 2 * COORD_STAGES > COORD_AT_TRANSIT
+#error The status payload must fit before COORD_AT_TRANSIT
+#endif
+#if COORD_AT_PAYLOAD + 5 + (COORD_ASSIGN_NODES - 8) / 4 > COORD_AT_TRANSIT
+#error The assign payload must fit before COORD_AT_TRANSIT
+#endif
+
+/* Least total load over the stage choices: best[s] is the cheapest way the
+ * nodes so far reach s steps, one pass per node over its stages. The tables
+ * are static, the leader's task being the only caller. */
+uint32_t ulCoordAssign(const uint16_t (*pusKw)[COORD_STAGES], const uint8_t *pucLive, uint32_t nodes,
+                       uint32_t required_kw, uint8_t *pucStages) {
+    static uint32_t best[COORD_STEPS + 1], next[COORD_STEPS + 1];
+    static uint8_t choice[COORD_NODES][COORD_STEPS + 1];
+    uint32_t steps[COORD_STAGES + 1], kw[COORD_STAGES + 1];
+    uint32_t total = 0, unit, need, n, s, k, from, cost;
+
+    if (nodes > COORD_NODES) {
+        nodes = COORD_NODES;
+    }
+    memset(pucStages, 0, nodes);
+    for (n = 0; n < nodes; n++) {
+        for (k = 0; pucLive[n] && k < COORD_STAGES; k++) {
+            total += pusKw[n][k];
+        }
+    }
+    if (required_kw == 0) {
+        return 0;
+    }
+    if (required_kw >= total) {
+        for (n = 0; n < nodes; n++) {
+            pucStages[n] = pucLive[n] ? COORD_STAGES : 0;
+        }
+        return total;
+    }
+
+    /* Coverage is counted in whole steps rounded down, so a set reaching
+     * need steps sheds at least required_kw */
+    unit = (required_kw + COORD_STEPS - 1) / COORD_STEPS;
+    need = (required_kw + unit - 1) / unit;
+
+    best[0] = 0;
+    for (s = 1; s <= need; s++) {
+        best[s] = COORD_COST_NONE;
+    }
+    for (n = 0; n < nodes; n++) {
+        steps[0] = kw[0] = 0;
+        for (k = 1; k <= COORD_STAGES; k++) {
+            kw[k] = kw[k - 1] + (pucLive[n] ? pusKw[n][k - 1] : 0);
+            steps[k] = kw[k] / unit;
+        }
+        for (s = 0; s <= need; s++) {
+            next[s] = COORD_COST_NONE;
+            choice[n][s] = 0;
+            for (k = 0; k <= (pucLive[n] ? COORD_STAGES : 0); k++) {
+                from = s > steps[k] ? s - steps[k] : 0;
+                if (best[from] == COORD_COST_NONE) {
+                    continue;
+                }
+                cost = best[from] + kw[k];
+                if (cost < next[s]) {
+                    next[s] = cost;
+                    choice[n][s] = (uint8_t)k;
+                }
+            }
+        }
+        memcpy(best, next, (need + 1) * sizeof(best[0]));
+    }
+
+    if (best[need] == COORD_COST_NONE) {
+        /* Short only through the rounding: everything goes */
+        for (n = 0; n < nodes; n++) {
+            pucStages[n] = pucLive[n] ? COORD_STAGES : 0;
+        }
+        return total;
+    }
+    for (s = need, n = nodes; n-- > 0;) {
+        k = choice[n][s];
+        pucStages[n] = (uint8_t)k;
+        for (cost = 0; k > 0; k--) {
+            cost += pusKw[n][k - 1];
+        }
+        cost /= unit;
+        s = s > cost ? s - cost : 0;
+    }
+    return best[need];
+}
+
+#ifdef COORD_UART_BASE
+
+#define COORD_LINE_ERRORS              (ALTERA_AVALON_UART_STATUS_PE_MSK | ALTERA_AVALON_UART_STATUS_FE_MSK | \
+                                        ALTERA_AVALON_UART_STATUS_ROE_MSK)
+#define COORD_CONTROL_RX               (ALTERA_AVALON_UART_CONTROL_RRDY_MSK | ALTERA_AVALON_UART_CONTROL_E_MSK)
+#define COORD_CONTROL_TX               (ALTERA_AVALON_UART_CONTROL_TRDY_MSK | ALTERA_AVALON_UART_CONTROL_TMT_MSK)
+#define COORD_LINK_SHIFT               3     // Link delay average over 2^this round trips
+
+/* Frame slots, free-running indices: the interrupt writes head, the task
+ * tail. The slot at head is the one being assembled. */
+typedef struct {
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    uint32_t pos;                      // Bytes of the slot at head so far, interrupt only
+    uint32_t stamp;                    // Timestamp count of the last byte, interrupt only
+    volatile uint8_t hunt;             // Set by the task: drop the partial frame
+    uint8_t slot[COORD_RX_FRAMES][COORD_FRAME_SIZE];
+    uint32_t start[COORD_RX_FRAMES];   // Timestamp count of each slot's first byte
+    uint16_t transit[COORD_RX_FRAMES]; // Its transit as it arrived, before forwarding adds to it
+} CoordRx_t;
+
+/* Frames to send, forwarded slots and own frames alike. head is written by
+ * the interrupt and by the task in a critical section, tail and pos by the
+ * interrupt. */
+typedef struct {
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    uint32_t pos;                      // Bytes of the frame at tail sent
+    uint8_t *volatile frame[COORD_TX_FRAMES];
+    uint32_t held[COORD_TX_FRAMES];    // Forwarded: when its first byte arrived
+    uint8_t own[COORD_TX_FRAMES];      // Own buffer + 1, 0 forwarded
+} CoordTx_t;
+
+/* What the leader last heard from each node, task only */
+typedef struct {
+    fix16_t freq;
+    fix16_t roc;
+    uint16_t stage_kw[COORD_STAGES];
+    uint32_t heard_ms;
+    uint8_t heard;
+} CoordNode_t;
+
+static CoordRx_t xRx;
+static CoordTx_t xTx;
+static volatile uint32_t ulControl;    // Control register copy, changed in critical sections or the ISR
+static TaskHandle_t xCoordTask = NULL;
+static uint8_t ucNode;
+static uint32_t ulGapCounts;           // COORD_GAP_US in timestamp counts
+
+/* Own frames, task only, except that the interrupt stamps each as its
+ * first byte goes out */
+static uint8_t ucOwn[COORD_OWN_FRAMES + 1][COORD_FRAME_SIZE];
+static volatile uint32_t ulOwnSent[COORD_OWN_FRAMES + 1];
+static volatile uint8_t ucOwnSentSeq[COORD_OWN_FRAMES + 1];  // Of the frame stamped
+static uint32_t ulOwnNext;
+static uint8_t ucSeq;
+static uint8_t ucStatusSeq;            // Of the last status sent, and its buffer
+static uint32_t ulStatusOwn;
+static uint32_t ulLastSentMs;
+static uint8_t ucHaveSent;
+static CoordNode_t xNodes[COORD_NODES];
+
+/* Time transfer, task only: the link delay in timestamp counts (0 until a
+ * round trip), the leader's last time frame sent, a node's last received */
+static uint32_t ulLinkCounts;
+static uint32_t ulLastTimeMs;
+static uint8_t ucHaveTimeSent;
+static uint8_t ucTimeSeq;
+static uint32_t ulTimeOwn;
+static uint8_t ucHaveTime;
+static uint64_t ullTimeArrived;
+static uint32_t ulTimeTransitUs;
+
+/* Assignment, (ms << COORD_STAGE_BITS) | stage, one word so any task reads
+ * it whole */
+static volatile uint32_t ulAssigned;
+static volatile uint8_t ucHaveAssigned;
+
+static CoordStats_t xStats;
+
+static inline uint16_t usGetWord(const uint8_t *pucAt) {
+    return (uint16_t)(pucAt[0] | (pucAt[1] << 8));
+}
+
+static inline void vPutWord(uint8_t *pucAt, uint16_t word) {
+    pucAt[0] = (uint8_t)word;
+    pucAt[1] = (uint8_t)(word >> 8);
+}
+
+/* The assign payload byte holding the stage of an assign frame's node i:
+ * the first 8 ahead of the required kW and the first node, where a ring of
+ * up to 8 has had them, the rest after */
+static inline uint32_t ulAssignByte(uint32_t i) {
+    return (i < 8 ? 0 : 3) + i / 4;
+}
+
+/* Queue a frame to send, own buffer + 1 or 0 with the time a forwarded
+ * one arrived; caller in the interrupt or a critical section */
+static inline int xCoordQueue(uint8_t *pucFrame, uint32_t own, uint32_t held) {
+    uint32_t head = xTx.head, at = head & COORD_TX_MASK;
+
+    if (head - xTx.tail >= COORD_TX_FRAMES) {
+        xStats.dropped++;
+        return 0;
+    }
+    xTx.frame[at] = pucFrame;
+    xTx.own[at] = (uint8_t)own;
+    xTx.held[at] = held;
+    xTx.head = head + 1;
+    if (!(ulControl & COORD_CONTROL_TX)) {
+        ulControl = COORD_CONTROL_RX | ALTERA_AVALON_UART_CONTROL_TRDY_MSK;
+        IOWR_ALTERA_AVALON_UART_CONTROL(COORD_UART_BASE, ulControl);
+    }
+    return 1;
+}
+
+/* A frame's first byte has just gone, at now: stamp an own frame, add the
+ * time a forwarded one was held here to its transit */
+static inline void vCoordSent(uint32_t at, uint32_t now) {
+    uint8_t *pucFrame = xTx.frame[at];
+    uint32_t own = xTx.own[at], transit;
+
+    if (own != 0) {
+        ulOwnSent[own - 1] = now;
+        ucOwnSentSeq[own - 1] = pucFrame[COORD_AT_SEQ];
+    } else {
+        transit = usGetWord(&pucFrame[COORD_AT_TRANSIT]) + ulLatencyElapsedUs(xTx.held[at], now);
+        vPutWord(&pucFrame[COORD_AT_TRANSIT], (uint16_t)(transit > 0xFFFF ? 0xFFFF : transit));
+    }
+}
+
+static void vCoordISRHandler(void *context) {
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    uint32_t status, now, tail, at, slot;
+    uint8_t byte, *pucSlot;
+
+    status = IORD_ALTERA_AVALON_UART_STATUS(COORD_UART_BASE);
+
+    if (status & COORD_LINE_ERRORS) {
+        xRx.pos = 0;
+        xStats.line_errors++;
+        IOWR_ALTERA_AVALON_UART_STATUS(COORD_UART_BASE, 0);
+    }
+
+    if (status & ALTERA_AVALON_UART_STATUS_RRDY_MSK) {
+        byte = (uint8_t)IORD_ALTERA_AVALON_UART_RXDATA(COORD_UART_BASE);
+        now = ulLatencyNow();
+        if (xRx.pos != 0 && now - xRx.stamp > ulGapCounts) {
+            xRx.pos = 0;
+            xStats.line_errors++;
+        }
+        if (xRx.hunt) {
+            xRx.pos = 0;
+            xRx.hunt = 0;
+        }
+        xRx.stamp = now;
+
+        if (xRx.pos != 0 || byte == COORD_SYNC) {
+            slot = xRx.head & COORD_RX_MASK;
+            pucSlot = xRx.slot[slot];
+            if (xRx.pos == 0) {
+                xRx.start[slot] = now;
+            }
+            pucSlot[xRx.pos++] = byte;
+            if (xRx.pos == COORD_FRAME_SIZE) {
+                xRx.pos = 0;
+                xRx.transit[slot] = usGetWord(&pucSlot[COORD_AT_TRANSIT]);
+                xRx.head++;
+
+                /* Pass another node's frame on from where it lies */
+                if (pucSlot[COORD_AT_SOURCE] != ucNode && pucSlot[COORD_AT_HOPS] != 0) {
+                    pucSlot[COORD_AT_HOPS]--;
+                    if (xCoordQueue(pucSlot, 0, xRx.start[slot])) {
+                        xStats.forwarded++;
+                    }
+                }
+                vTaskNotifyGiveFromISR(xCoordTask, &xHigherPriorityTaskWoken);
+            }
+        }
+    }
+
+    if ((status & ALTERA_AVALON_UART_STATUS_TRDY_MSK) && (ulControl & COORD_CONTROL_TX)) {
+        tail = xTx.tail;
+        at = tail & COORD_TX_MASK;
+        if (tail == xTx.head) {
+            ulControl = COORD_CONTROL_RX;
+            IOWR_ALTERA_AVALON_UART_CONTROL(COORD_UART_BASE, ulControl);
+        } else if (xTx.pos == 0 && !(status & ALTERA_AVALON_UART_STATUS_TMT_MSK)) {
+            /* A frame starts on an empty transmitter, so its first byte
+             * goes on the line as it is stamped */
+            ulControl = COORD_CONTROL_RX | ALTERA_AVALON_UART_CONTROL_TMT_MSK;
+            IOWR_ALTERA_AVALON_UART_CONTROL(COORD_UART_BASE, ulControl);
+        } else if (xTx.pos == 0) {
+            now = ulLatencyNow();
+            IOWR_ALTERA_AVALON_UART_TXDATA(COORD_UART_BASE, xTx.frame[at][0]);
+            xTx.pos = 1;
+            vCoordSent(at, now);
+            ulControl = COORD_CONTROL_RX | ALTERA_AVALON_UART_CONTROL_TRDY_MSK;
+            IOWR_ALTERA_AVALON_UART_CONTROL(COORD_UART_BASE, ulControl);
+        } else {
+            IOWR_ALTERA_AVALON_UART_TXDATA(COORD_UART_BASE, xTx.frame[at][xTx.pos]);
+            if (++xTx.pos == COORD_FRAME_SIZE) {
+                xTx.pos = 0;
+                xTx.tail = tail + 1;
+            }
+        }
+    }
+
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
+static inline uint64_t ullGetLong(const uint8_t *pucAt) {
+    return usGetWord(pucAt) | ((uint64_t)usGetWord(pucAt + 2) << 16) | ((uint64_t)usGetWord(pucAt + 4) << 32) |
+           ((uint64_t)usGetWord(pucAt + 6) << 48);
+}
+
+static inline void vPutLong(uint8_t *pucAt, uint64_t value) {
+    uint32_t i;
+
+    for (i = 0; i < 8; i++) {
+        pucAt[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+static uint16_t usCoordCrc(const uint8_t *pucFrame) {
+    uint16_t crc = CRC16_INIT;
+    uint32_t i;
+
+    for (i = COORD_AT_TYPE; i < COORD_AT_TRANSIT; i++) {
+        crc = usCrc16Byte(crc, pucFrame[i]);
+    }
+    return crc;
+}
+
+/* Next own frame buffer with its header, to fill from COORD_AT_PAYLOAD. By
+ * the time the buffers come round again the frame has long gone, the queue
+ * being far shorter. A time frame has a buffer to itself: the next one
+ * carries its stamp, and the others come round many times in between. */
+static uint8_t *pucOwnBegin(uint8_t type) {
+    uint8_t *pucFrame = type == COORD_TYPE_TIME ? ucOwn[COORD_OWN_TIME] : ucOwn[ulOwnNext++ % COORD_OWN_FRAMES];
+
+    memset(pucFrame, 0, COORD_FRAME_SIZE);
+    pucFrame[0] = COORD_SYNC;
+    pucFrame[COORD_AT_HOPS] = COORD_NODES - 1;
+    pucFrame[COORD_AT_TYPE] = type;
+    pucFrame[COORD_AT_SOURCE] = ucNode;
+    pucFrame[COORD_AT_SEQ] = ++ucSeq;
+    return pucFrame;
+}
+
+/* Queue an own frame, returning its buffer for the stamp it gets sent at */
+static uint32_t ulOwnSend(uint8_t *pucFrame) {
+    uint32_t own = (uint32_t)(pucFrame - ucOwn[0]) / COORD_FRAME_SIZE;
+
+    vPutWord(&pucFrame[COORD_AT_CRC], usCoordCrc(pucFrame));
+    taskENTER_CRITICAL();
+    (void)xCoordQueue(pucFrame, own + 1, 0);
+    taskEXIT_CRITICAL();
+    return own;
+}
+
+/* The timestamp count an own frame went out at: 0 if it has not (yet) */
+static int xOwnSentAt(uint32_t own, uint8_t seq, uint32_t *pulStamp) {
+    taskENTER_CRITICAL();
+    *pulStamp = ulOwnSent[own];
+    seq = (uint8_t)(seq ^ ucOwnSentSeq[own]);
+    taskEXIT_CRITICAL();
+    return seq == 0;
+}
+
+static void vCoordSetAssigned(uint32_t stage, uint32_t now_ms) {
+    ulAssigned = (now_ms << COORD_STAGE_BITS) | stage;
+    ucHaveAssigned = 1;
+}
+
+/* mHz and 0.01 Hz/s, as the Modbus registers */
+static inline uint16_t usToMilliHertz(fix16_t freq) {
+    return freq <= 0 ? 0 : (uint16_t)(((int64_t)freq * 1000) >> FIX16_SHIFT);
+}
+
+static inline fix16_t xFromMilliHertz(uint16_t mhz) {
+    return (fix16_t)(((uint32_t)mhz << FIX16_SHIFT) / 1000);
+}
+
+/* Own status back round the ring: every link once and every other node's
+ * holding time, which it brings in transit_us */
+static void vCoordRoundTrip(uint32_t start, uint32_t transit_us) {
+    uint32_t sent, ring, link;
+
+    if (!xOwnSentAt(ulStatusOwn, ucStatusSeq, &sent)) {
+        return;
+    }
+    ring = start - sent;
+    xStats.round_trip_us = ring / ulLatencyCountsPerUs();
+    if (xStats.round_trip_us > xStats.round_trip_max_us) {
+        xStats.round_trip_max_us = xStats.round_trip_us;
+    }
+    if (xStats.round_trip_us <= transit_us) {
+        return;
+    }
+
+    link = (ring - transit_us * ulLatencyCountsPerUs()) / COORD_NODES;
+    if (ulLinkCounts == 0) {
+        ulLinkCounts = link;
+    } else {
+        ulLinkCounts = ulLinkCounts + (uint32_t)(((int32_t)(link - ulLinkCounts)) >> COORD_LINK_SHIFT);
+    }
+    xStats.link_us = ulLinkCounts / ulLatencyCountsPerUs();
+}
+
+/* Leader's time frame: the follow-up to the one before, which left the
+ * leader at the stamp it carries and got here ucNode links and its transit
+ * later */
+static void vCoordTime(const uint8_t *pucFrame, uint32_t start, uint32_t transit_us) {
+    const uint8_t *pucPay = &pucFrame[COORD_AT_PAYLOAD];
+    uint64_t master;
+
+    if (pucPay[0] && ucHaveTime && pucPay[1] == ucTimeSeq && ulLinkCounts != 0) {
+        master = ullGetLong(&pucPay[2]) + (uint64_t)ulTimeTransitUs * ulLatencyCountsPerUs() +
+                 (uint64_t)ucNode * ulLinkCounts;
+        vTimeSyncPost(ullTimeArrived, master);
+        xStats.time_samples++;
+    }
+    ucTimeSeq = pucFrame[COORD_AT_SEQ];
+    ullTimeArrived = ullTimeExtend(start);
+    ulTimeTransitUs = transit_us;
+    ucHaveTime = 1;
+}
+
+static void vCoordFrame(const uint8_t *pucFrame, uint32_t start, uint32_t transit_us, uint32_t now_ms) {
+    const uint8_t *pucPay = &pucFrame[COORD_AT_PAYLOAD];
+    uint8_t source = pucFrame[COORD_AT_SOURCE];
+    CoordNode_t *pxNode;
+    uint32_t k;
+
+    if (source == ucNode) {
+        if (pucFrame[COORD_AT_TYPE] == COORD_TYPE_STATUS && pucFrame[COORD_AT_SEQ] == ucStatusSeq) {
+            vCoordRoundTrip(start, transit_us);
+        }
+        return;
+    }
+    if (source >= COORD_NODES) {
+        return;
+    }
+
+    switch (pucFrame[COORD_AT_TYPE]) {
+    case COORD_TYPE_STATUS:
+        if (ucNode == COORD_LEADER) {
+            pxNode = &xNodes[source];
+            pxNode->freq = xFromMilliHertz(usGetWord(&pucPay[0]));
+            pxNode->roc = (fix16_t)(((int32_t)(int16_t)usGetWord(&pucPay[2]) << FIX16_SHIFT) / 100);
+            for (k = 0; k < COORD_STAGES; k++) {
+                pxNode->stage_kw[k] = usGetWord(&pucPay[5 + 2 * k]);
+            }
+            pxNode->heard_ms = now_ms;
+            pxNode->heard = 1;
+        }
+        break;
+    case COORD_TYPE_ASSIGN:
+        k = (uint32_t)ucNode - pucPay[4];
+        if (source == COORD_LEADER && ucNode >= pucPay[4] && k < COORD_ASSIGN_NODES) {
+            vCoordSetAssigned((pucPay[ulAssignByte(k)] >> (k % 4 * COORD_STAGE_BITS)) & COORD_STAGE_MASK, now_ms);
+        }
+        break;
+    case COORD_TYPE_TIME:
+        if (source == COORD_LEADER) {
+            vCoordTime(pucFrame, start, transit_us);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/* Leader: the island's requirement from the lowest frequency heard, the
+ * search, and the assignment out, COORD_ASSIGN_NODES nodes a frame */
+static void vCoordLead(const CoordStatus_t *pxLocal, uint32_t now_ms) {
+    uint16_t kw[COORD_NODES][COORD_STAGES];
+    uint8_t live[COORD_NODES], stages[COORD_NODES];
+    fix16_t freq = pxLocal->freq, roc = pxLocal->roc, deficit;
+    int64_t required;
+    uint32_t n, k, base;
+    uint8_t *pucFrame;
+
+    for (n = 0; n < COORD_NODES; n++) {
+        if (n == COORD_LEADER) {
+            live[n] = 1;
+            memcpy(kw[n], pxLocal->stage_kw, sizeof(kw[n]));
+            continue;
+        }
+        live[n] = xNodes[n].heard && now_ms - xNodes[n].heard_ms < COORD_STALE_MS;
+        for (k = 0; k < COORD_STAGES; k++) {
+            kw[n][k] = xNodes[n].stage_kw[k];
+        }
+        if (live[n] && xNodes[n].freq < freq) {
+            freq = xNodes[n].freq;
+            roc = xNodes[n].roc;
+        }
+    }
+
+    deficit = pxLocal->lower_limit - freq;
+    required = 0;
+    if (deficit > 0) {
+        required += (int64_t)deficit * COORD_KW_PER_HZ;
+    }
+    if (roc < 0) {
+        required -= (int64_t)roc * COORD_KW_PER_HZ_S;
+    }
+    required = (required + FIX16_ONE - 1) >> FIX16_SHIFT;
+
+    xStats.assigned_kw = (uint32_t)required;
+    (void)ulCoordAssign((const uint16_t (*)[COORD_STAGES])kw, live, COORD_NODES, (uint32_t)required, stages);
+    vCoordSetAssigned(stages[COORD_LEADER], now_ms);
+
+    for (base = 0; base < COORD_NODES; base += COORD_ASSIGN_NODES) {
+        pucFrame = pucOwnBegin(COORD_TYPE_ASSIGN);
+        for (n = base; n < COORD_NODES && n < base + COORD_ASSIGN_NODES; n++) {
+            k = n - base;
+            pucFrame[COORD_AT_PAYLOAD + ulAssignByte(k)] |= (uint8_t)(stages[n] << (k % 4 * COORD_STAGE_BITS));
+        }
+        vPutWord(&pucFrame[COORD_AT_PAYLOAD + 2], (uint16_t)(required > 0xFFFF ? 0xFFFF : required));
+        pucFrame[COORD_AT_PAYLOAD + 4] = (uint8_t)base;
+        (void)ulOwnSend(pucFrame);
+    }
+}
+
+/* Leader: a time frame, carrying when the one before went out */
+static void vCoordSendTime(void) {
+    uint8_t *pucFrame = pucOwnBegin(COORD_TYPE_TIME);
+    uint32_t sent;
+
+    if (ucHaveTimeSent && xOwnSentAt(ulTimeOwn, ucTimeSeq, &sent)) {
+        pucFrame[COORD_AT_PAYLOAD] = 1;
+        pucFrame[COORD_AT_PAYLOAD + 1] = ucTimeSeq;
+        vPutLong(&pucFrame[COORD_AT_PAYLOAD + 2], ullTimeExtend(sent));
+    }
+    ucTimeSeq = pucFrame[COORD_AT_SEQ];
+    ulTimeOwn = ulOwnSend(pucFrame);
+    ucHaveTimeSent = 1;
+}
+
+void vCoordService(const CoordStatus_t *pxLocal, uint32_t now_ms) {
+    const uint8_t *pucFrame;
+    uint8_t *pucOut;
+    uint32_t tail, k, start, transit_us;
+    int16_t roc;
+    int crc_ok;
+
+    /* Frames where they lie. The slot at head - COORD_RX_FRAMES is the one
+     * the interrupt is assembling into, so a frame that far behind, before
+     * or after its CRC is checked, has been started over. */
+    for (tail = xRx.tail; tail != xRx.head; tail++) {
+        pucFrame = xRx.slot[tail & COORD_RX_MASK];
+        start = xRx.start[tail & COORD_RX_MASK];
+        transit_us = xRx.transit[tail & COORD_RX_MASK];
+        crc_ok = xRx.head - tail < COORD_RX_FRAMES &&
+                 usGetWord(&pucFrame[COORD_AT_CRC]) == usCoordCrc(pucFrame);
+        if (xRx.head - tail >= COORD_RX_FRAMES) {
+            xStats.lost++;
+        } else if (!crc_ok) {
+            xStats.crc_errors++;
+            xRx.hunt = 1;
+        } else {
+            xStats.frames++;
+            vCoordFrame(pucFrame, start, transit_us, now_ms);
+        }
+    }
+    xRx.tail = tail;
+
+    if (ucNode == COORD_LEADER && (!ucHaveTimeSent || now_ms - ulLastTimeMs >= COORD_TIME_PERIOD_MS)) {
+        ulLastTimeMs = now_ms;
+        vCoordSendTime();
+    }
+
+    if (ucHaveSent && now_ms - ulLastSentMs < COORD_PERIOD_MS) {
+        return;
+    }
+    ulLastSentMs = now_ms;
+    ucHaveSent = 1;
+
+    pucOut = pucOwnBegin(COORD_TYPE_STATUS);
+    roc = (int16_t)(((int64_t)pxLocal->roc * 100) >> FIX16_SHIFT);
+    vPutWord(&pucOut[COORD_AT_PAYLOAD], usToMilliHertz(pxLocal->freq));
+    vPutWord(&pucOut[COORD_AT_PAYLOAD + 2], (uint16_t)roc);
+    pucOut[COORD_AT_PAYLOAD + 4] = (uint8_t)(pxLocal->flags | (pxLocal->stage << COORD_FLAG_STAGE_SHIFT));
+    for (k = 0; k < COORD_STAGES; k++) {
+        vPutWord(&pucOut[COORD_AT_PAYLOAD + 5 + 2 * k], pxLocal->stage_kw[k]);
+    }
+    ucStatusSeq = pucOut[COORD_AT_SEQ];
+    ulStatusOwn = ulOwnSend(pucOut);
+
+    if (ucNode == COORD_LEADER) {
+        vCoordLead(pxLocal, now_ms);
+    }
+}
+
+int xCoordStage(uint32_t now_ms) {
+    uint32_t assigned = ulAssigned;
+
+    if (!ucHaveAssigned ||
+        ((now_ms << COORD_STAGE_BITS) - (assigned & ~COORD_STAGE_MASK)) >> COORD_STAGE_BITS >= COORD_STALE_MS) {
+        return -1;
+    }
+    return (int)(assigned & COORD_STAGE_MASK);
+}
+
+int xCoordInit(uint8_t node, TaskHandle_t xTask) {
+    if (xTask == NULL || node >= COORD_NODES) {
+        return -1;
+    }
+
+    xCoordTask = xTask;
+    ucNode = node;
+    ulGapCounts = COORD_GAP_US * ulLatencyCountsPerUs();
+    memset(&xRx, 0, sizeof(xRx));
+    memset((void *)&xTx, 0, sizeof(xTx));
+    memset(xNodes, 0, sizeof(xNodes));
+
+    /* As Modbus does its UART: the core holds one received byte, so the
+     * interrupt is above the kernel's */
+    IOWR_ALTERA_AVALON_UART_CONTROL(COORD_UART_BASE, 0);
+    vPortSetIrqPriority(COORD_UART_IRQ, configMAX_SYSCALL_INTERRUPT_PRIORITY);
+    if (xIrqRegister(COORD_UART_IRQ, vCoordISRHandler, NULL) != 0) {
+        return -1;
+    }
+
+    (void)IORD_ALTERA_AVALON_UART_RXDATA(COORD_UART_BASE);
+    IOWR_ALTERA_AVALON_UART_STATUS(COORD_UART_BASE, 0);
+    ulControl = COORD_CONTROL_RX;
+    IOWR_ALTERA_AVALON_UART_CONTROL(COORD_UART_BASE, ulControl);
+    return 0;
+}
+
+#else /* !COORD_UART_BASE */
+
+/* No second UART in this system: nothing is coordinated */
+void vCoordService(const CoordStatus_t *pxLocal, uint32_t now_ms) {
+    (void)pxLocal;
+    (void)now_ms;
+}
+
+int xCoordStage(uint32_t now_ms) {
+    (void)now_ms;
+    return -1;
+}
+
+int xCoordInit(uint8_t node, TaskHandle_t xTask) {
+    (void)node;
+    (void)xTask;
+    return -1;
+}
+
+static CoordStats_t xStats;
+
+#endif /* COORD_UART_BASE */
+
+void vCoordGetStats(CoordStats_t *pxStats) {
+    *pxStats = xStats;
+}
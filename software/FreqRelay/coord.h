@@ -0,0 +1,165 @@
+/**
+ * Shed coordination between relays on one island grid
+ *
+ * Relays that each shed on their own frequency all shed the same stages at
+ * once, so an island loses several times the load the deficit needed. With
+ * coordination the relays are daisy-chained in a ring over a second
+ * altera_avalon_uart (COORD_UART in system.h, the first is Modbus's): each
+ * node's transmit line goes to the next node's receive line, the last back
+ * to node 0. Node 0 is the leader.
+ *
+ * Every node sends a status frame each COORD_PERIOD_MS with its lowest
+ * feeder frequency, that feeder's RoC and how much load each of its
+ * COORD_STAGES shed stages would take off. The leader works out the load the
+ * island has to lose,
+ *
+ *   required kW = COORD_KW_PER_HZ * deficit Hz + COORD_KW_PER_HZ_S * falling RoC Hz/s
+ *
+ * from the lowest frequency reported, and picks each node's stage so the
+ * stages together cover it with the least load shed: a search over the
+ * stage choices in COORD_STEPS steps of the requirement, one pass per node,
+ * which is never short and sheds at most a step per node more than the
+ * least possible (about 1% over it, on random islands of 2 to 8 nodes). The
+ * assignment goes round the ring, an assign frame for each
+ * COORD_ASSIGN_NODES nodes, and a node sheds its assigned stage instead of
+ * its own policy bands for as long as a fresh one keeps arriving. A node
+ * that hears nothing for COORD_STALE_MS falls back to shedding on its own,
+ * and the leader leaves out nodes it has not heard from (they shed on
+ * their own too), so losing a link only loses the saving.
+ *
+ * Frames are a fixed COORD_FRAME_SIZE bytes starting with COORD_SYNC, so
+ * the UART interrupt frames them itself, one store and a compare per byte,
+ * into a ring of frame slots. A completed frame from another node is
+ * passed on from the slot it arrived in: the interrupt decrements its hop
+ * count in place and queues the slot for sending, so forwarding costs no
+ * copy and no task wake-up, and a hop adds one frame time (1.7 ms at
+ * 115200) and a character to the latency, a frame starting only on an
+ * empty transmitter. The hop count is outside the CRC; at zero the frame
+ * is not passed on, so a frame whose sender has gone cannot circle for
+ * ever. So is the transit field, the microseconds the nodes on the way held
+ * the frame, which each adds to as the frame's first byte leaves. The
+ * coordination task parses frames where they lie in the ring.
+ *
+ * The leader's clock goes round too: a time frame every
+ * COORD_TIME_PERIOD_MS, which together with the transit fields and the
+ * round trip of each node's own status frames gives the other nodes the
+ * leader's time to a few microseconds (time_sync.h).
+ *
+ * Every frame crosses every link, so a link carries about COORD_NODES + 2
+ * frames each COORD_PERIOD_MS: some 55 nodes fill a 115200 baud ring at
+ * 100 ms. sim/coord_sim.c runs a ring of any size on the host to measure
+ * it.
+ *
+ * Resynchronisation: a gap of COORD_GAP_US inside a frame, a line error or a
+ * bad CRC drops the frame being assembled and the interrupt hunts for the
+ * next COORD_SYNC.
+ */
+
+#ifndef COORD_H
+#define COORD_H
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "fix16.h"
+
+#ifndef COORD_NODES
+#define COORD_NODES                    2     // Relays in the ring
+#endif
+#define COORD_NODES_MAX                128   // Source and hop bytes, the leader's search table
+#define COORD_LEADER                   0
+#define COORD_STAGES                   3     // Shed stages per node, 0 for none
+#ifndef COORD_PERIOD_MS
+#define COORD_PERIOD_MS                100   // Status (and, from the leader, assignment) interval
+#endif
+#define COORD_STALE_MS                 (3 * COORD_PERIOD_MS)
+#define COORD_TIME_PERIOD_MS           1000  // Leader's time frames
+#define COORD_GAP_US                   500   // Silence that ends a partial frame
+#define COORD_STEPS                    256   // Power steps of the leader's search
+
+/* Island shed requirement, see above */
+#ifndef COORD_KW_PER_HZ
+#define COORD_KW_PER_HZ                20
+#endif
+#ifndef COORD_KW_PER_HZ_S
+#define COORD_KW_PER_HZ_S              2
+#endif
+
+#if COORD_NODES < 2 || COORD_NODES > COORD_NODES_MAX
+#error COORD_NODES must be 2..COORD_NODES_MAX
+#endif
+
+/* Frame layout */
+#define COORD_FRAME_SIZE               20
+#define COORD_SYNC                     0xA5
+#define COORD_AT_HOPS                  1     // Hops left, outside the CRC
+#define COORD_AT_TYPE                  2
+#define COORD_AT_SOURCE                3
+#define COORD_AT_SEQ                   4
+#define COORD_AT_PAYLOAD               5
+#define COORD_AT_TRANSIT               16    // Held on the way (us), outside the CRC
+#define COORD_AT_CRC                   18    // Over COORD_AT_TYPE .. COORD_AT_TRANSIT, low byte first
+#define COORD_TYPE_STATUS              1     // freq mHz, roc 0.01 Hz/s, flags | stage << 4, stage kW
+#define COORD_TYPE_ASSIGN              2     // Stages of 8 nodes, required kW, first node, 24 more
+#define COORD_TYPE_TIME                3     // Follow-up valid, its seq, 64-bit stamp it went out at
+
+#define COORD_ASSIGN_NODES             32    // Two bits a node in an assign frame
+#define COORD_ASSIGN_FRAMES            ((COORD_NODES + COORD_ASSIGN_NODES - 1) / COORD_ASSIGN_NODES)
+
+#define COORD_RX_FRAMES                16    // Frame slots the interrupt assembles into, power of 2
+#define COORD_TX_FRAMES                8     // Frames queued to send, power of 2, < COORD_RX_FRAMES
+
+/* Status flags */
+#define COORD_FLAG_STABLE              0x01
+#define COORD_FLAG_FAILSAFE            0x02
+#define COORD_FLAG_STAGE_SHIFT         4     // The stage shares the flags byte
+
+/* What a node reports, refreshed by the application every period */
+typedef struct {
+    fix16_t freq;                      // Lowest feeder frequency (Hz)
+    fix16_t roc;                       // That feeder's RoC (Hz/s)
+    fix16_t lower_limit;               // Its lower limit, the leader's deficit reference
+    uint8_t flags;                     // COORD_FLAG_*
+    uint8_t stage;                     // Stage being shed now
+    uint16_t stage_kw[COORD_STAGES];   // Load stage n + 1 sheds beyond stage n (kW)
+} CoordStatus_t;
+
+typedef struct {
+    uint32_t frames;                   // Good frames received
+    uint32_t crc_errors;
+    uint32_t lost;                     // Overwritten in the ring before they were read
+    uint32_t line_errors;              // Line errors and gaps inside a frame, interrupt
+    uint32_t forwarded;                // Passed on by the interrupt
+    uint32_t dropped;                  // Not passed on or not sent, the transmit queue was full
+    uint32_t round_trip_us;            // Last own status back round the ring
+    uint32_t round_trip_max_us;
+    uint32_t link_us;                  // Average link delay, the round trip less transit over the nodes
+    uint32_t time_samples;             // Leader's time worked out and posted to time_sync
+    uint32_t assigned_kw;              // Leader: required kW of the last assignment
+} CoordStats_t;
+
+/* Take the coordination UART over as node (0 is the leader), before the
+ * scheduler starts. xTask is notified on every frame received and calls
+ * vCoordService() then and at least every COORD_PERIOD_MS. Returns 0 on
+ * success. */
+int xCoordInit(uint8_t node, TaskHandle_t xTask);
+
+/* Parse the frames received, then send the status (and on the leader the
+ * assignment) when due. Coordination task only. */
+void vCoordService(const CoordStatus_t *pxLocal, uint32_t now_ms);
+
+/* The stage assigned to this node, -1 with no fresh assignment. Any task. */
+int xCoordStage(uint32_t now_ms);
+
+/* Counters since boot, each word written by one side and read whole */
+void vCoordGetStats(CoordStats_t *pxStats);
+
+/* The leader's search: a stage 0..COORD_STAGES for each of nodes into
+ * pucStages, covering required_kw with the least total. pusKw[n][s] is
+ * what stage s + 1 of node n sheds beyond stage s, and a node with
+ * pucLive[n] 0 stays at 0, nodes at most COORD_NODES. Returns the kW shed,
+ * under required_kw only if every live stage together is. */
+uint32_t ulCoordAssign(const uint16_t (*pusKw)[COORD_STAGES], const uint8_t *pucLive, uint32_t nodes,
+                       uint32_t required_kw, uint8_t *pucStages);
+
+#endif /* COORD_H */
@@ -0,0 +1,26 @@
+/**
+ * CRC-16/MODBUS
+ *
+ * Reflected polynomial 0xA001, initial value 0xFFFF, computed a nibble at a
+ * time from a 16 entry table: the Modbus frames' check and the coordination
+ * link's. Run over a frame and its CRC (low byte first) it leaves 0.
+ */
+
+#ifndef CRC16_H
+#define CRC16_H
+
+#include <stdint.h>
+
+#define CRC16_INIT                     0xFFFF
+
+static const uint16_t usCrc16Nibble[16] = {
+    0x0000, 0xCC01, 0xD801, 0x1400, 0xF001, 0x3C00, 0x2800, 0xE401,
+    0xA001, 0x6C00, 0x7800, 0xB401, 0x5000, 0x9C01, 0x8801, 0x4400
+};
+
+static inline uint16_t usCrc16Byte(uint16_t crc, uint8_t byte) {
+    crc = (uint16_t)((crc >> 4) ^ usCrc16Nibble[(crc ^ byte) & 0x0F]);
+    return (uint16_t)((crc >> 4) ^ usCrc16Nibble[(crc ^ (byte >> 4)) & 0x0F]);
+}
+
+#endif /* CRC16_H */
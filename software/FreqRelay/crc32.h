@@ -0,0 +1,38 @@
+/**
+ * CRC-32
+ *
+ * The zlib and Ethernet CRC: reflected polynomial 0xEDB88320, initial value
+ * and final XOR 0xFFFFFFFF, computed a nibble at a time from a 16 entry
+ * table. The config store's block check and the firmware image's, which is
+ * run over the image in pieces with ulCrc32Update().
+ */
+
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stdint.h>
+
+#define CRC32_INIT                     0xFFFFFFFFUL
+
+static const uint32_t ulCrc32Nibble[16] = {
+    0x00000000UL, 0x1DB71064UL, 0x3B6E20C8UL, 0x26D930ACUL,
+    0x76DC4190UL, 0x6B6B51F4UL, 0x4DB26158UL, 0x5005713CUL,
+    0xEDB88320UL, 0xF00F9344UL, 0xD6D6A3E8UL, 0xCB61B38CUL,
+    0x9B64C2B0UL, 0x86D3D2D4UL, 0xA00AE278UL, 0xBDBDF21CUL
+};
+
+/* Carry crc, from CRC32_INIT, over len more bytes; ~ of the last is the CRC */
+static inline uint32_t ulCrc32Update(uint32_t crc, const uint8_t *pucData, uint32_t len) {
+    while (len--) {
+        crc ^= *pucData++;
+        crc = (crc >> 4) ^ ulCrc32Nibble[crc & 0x0F];
+        crc = (crc >> 4) ^ ulCrc32Nibble[crc & 0x0F];
+    }
+    return crc;
+}
+
+static inline uint32_t ulCrc32(const uint8_t *pucData, uint32_t len) {
+    return ~ulCrc32Update(CRC32_INIT, pucData, len);
+}
+
+#endif /* CRC32_H */
@@ -0,0 +1,196 @@
+/**
+ * One-shot hardware deadline queue
+ *
+ * See deadline.h.
+ */
+
+/* Scheduler includes */
+#include "freertos/FreeRTOS.h"
+
+/* Hardware includes */
+#include "system.h"
+#include "sys/alt_irq.h"
+#ifdef DEADLINE_TIMER_BASE
+#include "altera_avalon_timer_regs.h"
+#endif
+
+/* Application includes */
+#include "deadline.h"
+#include "fast_mem.h"
+#include "irq_defer.h"
+#include "latency.h"
+
+static FAST_DATA DeadlineStats_t xStats;
+
+#ifdef DEADLINE_TIMER_BASE
+
+#define DEADLINE_TICKS_PER_US          (DEADLINE_TIMER_FREQ / 1000000UL)
+#define DEADLINE_TICKS_MIN             2     // Shortest period programmed
+
+static FAST_DATA Deadline_t *pxHead = NULL;
+static FAST_DATA uint32_t ulCountsPerUs = 1;
+
+/* Program the head's remaining time as a one-shot period, or stop the
+ * timer if nothing is armed. Interrupts disabled. */
+static void vDeadlineProgram(uint32_t now) {
+    int32_t remaining;
+    uint32_t ticks;
+
+    IOWR_ALTERA_AVALON_TIMER_CONTROL(DEADLINE_TIMER_BASE, ALTERA_AVALON_TIMER_CONTROL_STOP_MSK);
+    IOWR_ALTERA_AVALON_TIMER_STATUS(DEADLINE_TIMER_BASE, 0);
+    if (pxHead == NULL) {
+        return;
+    }
+
+    /* Timestamp counts to timer ticks, whole microseconds then the rest */
+    remaining = (int32_t)(pxHead->due - now);
+    ticks = 0;
+    if (remaining > 0) {
+        ticks = (uint32_t)remaining / ulCountsPerUs * DEADLINE_TICKS_PER_US +
+                (uint32_t)remaining % ulCountsPerUs * DEADLINE_TICKS_PER_US / ulCountsPerUs;
+    }
+    if (ticks < DEADLINE_TICKS_MIN) {
+        ticks = DEADLINE_TICKS_MIN;
+    }
+
+    IOWR_ALTERA_AVALON_TIMER_PERIODL(DEADLINE_TIMER_BASE, (ticks - 1) & 0xFFFF);
+    IOWR_ALTERA_AVALON_TIMER_PERIODH(DEADLINE_TIMER_BASE, (ticks - 1) >> 16);
+    IOWR_ALTERA_AVALON_TIMER_CONTROL(DEADLINE_TIMER_BASE, ALTERA_AVALON_TIMER_CONTROL_ITO_MSK |
+                                                          ALTERA_AVALON_TIMER_CONTROL_START_MSK);
+}
+
+/* Take a deadline off the list, interrupts disabled. Returns 1 if it was
+ * the head. */
+static int xDeadlineUnlink(Deadline_t *pxDeadline) {
+    Deadline_t **ppxLink = &pxHead;
+
+    if (!pxDeadline->armed) {
+        return 0;
+    }
+    while (*ppxLink != pxDeadline) {
+        ppxLink = &(*ppxLink)->next;
+    }
+    *ppxLink = pxDeadline->next;
+    pxDeadline->armed = 0;
+    return ppxLink == &pxHead;
+}
+
+/* Runs every deadline that is due, each with interrupts enabled, then
+ * programs the timer for the next */
+static void vDeadlineISRHandler(void *context) {
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    Deadline_t *pxDeadline;
+    alt_irq_context irq;
+    uint32_t now, late_us;
+
+    (void)context;
+    irq = alt_irq_disable_all();
+    for (;;) {
+        now = ulLatencyNow();
+        pxDeadline = pxHead;
+        if (pxDeadline == NULL || (int32_t)(pxDeadline->due - now) > 0) {
+            break;
+        }
+        pxHead = pxDeadline->next;
+        pxDeadline->armed = 0;
+
+        late_us = (now - pxDeadline->due) / ulCountsPerUs;
+        xStats.fired++;
+        xStats.late_last_us = late_us;
+        if (late_us > xStats.late_max_us) {
+            xStats.late_max_us = late_us;
+        }
+
+        alt_irq_enable_all(irq);
+        pxDeadline->callback(pxDeadline->context, &xHigherPriorityTaskWoken);
+        irq = alt_irq_disable_all();
+    }
+    vDeadlineProgram(now);
+    alt_irq_enable_all(irq);
+
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
+int xDeadlineInit(void) {
+    alt_irq_context irq;
+
+    ulCountsPerUs = ulLatencyCountsPerUs();
+    irq = alt_irq_disable_all();
+    pxHead = NULL;
+    vDeadlineProgram(ulLatencyNow());
+    alt_irq_enable_all(irq);
+
+    vPortSetIrqPriority(DEADLINE_TIMER_IRQ, DEADLINE_IRQ_PRIORITY);
+    return xIrqRegister(DEADLINE_TIMER_IRQ, vDeadlineISRHandler, NULL);
+}
+
+void vDeadlineArm(Deadline_t *pxDeadline, uint32_t due) {
+    Deadline_t **ppxLink = &pxHead;
+    alt_irq_context irq;
+    uint32_t now;
+
+    irq = alt_irq_disable_all();
+    (void)xDeadlineUnlink(pxDeadline);
+    now = ulLatencyNow();
+    if ((int32_t)(due - now) <= 0) {
+        xStats.past++;
+    }
+
+    /* After any due at the same time, so equal deadlines run in arming order */
+    while (*ppxLink != NULL && (int32_t)((*ppxLink)->due - due) <= 0) {
+        ppxLink = &(*ppxLink)->next;
+    }
+    pxDeadline->due = due;
+    pxDeadline->next = *ppxLink;
+    pxDeadline->armed = 1;
+    *ppxLink = pxDeadline;
+
+    if (pxHead == pxDeadline) {
+        vDeadlineProgram(now);
+    }
+    alt_irq_enable_all(irq);
+}
+
+void vDeadlineCancel(Deadline_t *pxDeadline) {
+    alt_irq_context irq;
+
+    irq = alt_irq_disable_all();
+    if (xDeadlineUnlink(pxDeadline)) {
+        vDeadlineProgram(ulLatencyNow());
+    }
+    alt_irq_enable_all(irq);
+}
+
+#else /* !DEADLINE_TIMER_BASE */
+
+/* No spare timer in this system: nothing is ever armed */
+int xDeadlineInit(void) {
+    return -1;
+}
+
+void vDeadlineArm(Deadline_t *pxDeadline, uint32_t due) {
+    (void)pxDeadline;
+    (void)due;
+}
+
+void vDeadlineCancel(Deadline_t *pxDeadline) {
+    (void)pxDeadline;
+}
+
+#endif /* DEADLINE_TIMER_BASE */
+
+void vDeadlineCreate(Deadline_t *pxDeadline, DeadlineCallback_t callback, void *context) {
+    pxDeadline->next = NULL;
+    pxDeadline->due = 0;
+    pxDeadline->callback = callback;
+    pxDeadline->context = context;
+    pxDeadline->armed = 0;
+}
+
+void vDeadlineGetStats(DeadlineStats_t *pxStats) {
+    alt_irq_context irq;
+
+    irq = alt_irq_disable_all();
+    *pxStats = xStats;
+    alt_irq_enable_all(irq);
+}
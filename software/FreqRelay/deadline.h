@@ -0,0 +1,74 @@
+/**
+ * One-shot hardware deadline queue
+ *
+ * The tick is 1 ms and a task woken by it starts some jitter later, so
+ * anything timed by the kernel - a delay, a software timer, a sleep to the
+ * next sample - lands on a millisecond boundary at best. A stage trip due
+ * 300 us after one evaluation waits for the next sample instead.
+ *
+ * A deadline is a caller-owned Deadline_t with a due time on the timestamp
+ * counter (ulLatencyNow) and a callback. Armed deadlines are kept in one
+ * list in due order, and the head's remaining time is programmed into a
+ * spare altera_avalon_timer, DEADLINE_TIMER in system.h, as a one-shot
+ * period. Its interrupt takes every deadline that is due off the list, runs
+ * its callback at interrupt level and programs the timer for the next one,
+ * so a callback runs within the interrupt's own latency of its time, tens
+ * of microseconds, whatever the tick rate.
+ *
+ * Callbacks run at DEADLINE_IRQ_PRIORITY, which is that of the frequency
+ * analyser: they may use the FromISR API and nothing else, and should do
+ * as little as writing an output and notifying a task. A callback may arm
+ * its own deadline again, or any other.
+ *
+ * The list is only touched with interrupts disabled, so arming and
+ * cancelling are safe from tasks and handlers alike. Each is a walk of the
+ * armed deadlines, a handful at most. Due times are compared as signed
+ * differences, so a deadline must be under 21 s away (half the timestamp
+ * counter's period); one already past is run straight away.
+ */
+
+#ifndef DEADLINE_H
+#define DEADLINE_H
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+
+#define DEADLINE_IRQ_PRIORITY          configMAX_SYSCALL_INTERRUPT_PRIORITY
+
+/* Interrupt level callback, context is the deadline's. A task woken through
+ * the FromISR API sets *pxHigherPriorityTaskWoken as usual. */
+typedef void (*DeadlineCallback_t)(void *context, BaseType_t *pxHigherPriorityTaskWoken);
+
+typedef struct Deadline {
+    struct Deadline *next;             // Armed list, in due order
+    uint32_t due;                      // Timestamp count
+    DeadlineCallback_t callback;
+    void *context;
+    volatile uint8_t armed;
+} Deadline_t;
+
+typedef struct {
+    uint32_t fired;                    // Callbacks run
+    uint32_t late_max_us;              // Longest from due to the callback
+    uint32_t late_last_us;
+    uint32_t past;                     // Armed when already due
+} DeadlineStats_t;
+
+/* Stop the timer and register its interrupt, before the scheduler starts.
+ * Returns 0 on success. */
+int xDeadlineInit(void);
+
+/* Bind a deadline to its callback, once, before it is first armed */
+void vDeadlineCreate(Deadline_t *pxDeadline, DeadlineCallback_t callback, void *context);
+
+/* Arm for the timestamp count due, moving it if it is already armed. Any
+ * context. */
+void vDeadlineArm(Deadline_t *pxDeadline, uint32_t due);
+
+/* Disarm; nothing if it has fired or was never armed. Any context. */
+void vDeadlineCancel(Deadline_t *pxDeadline);
+
+/* Copy of the timing counts */
+void vDeadlineGetStats(DeadlineStats_t *pxStats);
+
+#endif /* DEADLINE_H */
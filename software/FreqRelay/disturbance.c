@@ -0,0 +1,163 @@
+/**
+ * Disturbance recorder
+ *
+ * See disturbance.h.
+ */
+
+#include <stdio.h>
+
+/* Scheduler includes */
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/* Hardware includes */
+#include "sys/alt_irq.h"
+
+/* Application includes */
+#include "disturbance.h"
+#include "latency.h"
+#include "pool.h"
+#include "telemetry.h"
+#include "time_base.h"
+#include "time_sync.h"
+
+POOL_STORAGE(xRecordSlots, DisturbRecord_t, DISTURB_RECORDS);
+static Pool_t xRecordPool;
+
+/* Analyzer only */
+static DisturbRecord_t *pxLive;
+static uint32_t ulTriggered;
+
+/* Triggers not yet seen by the analyzer, changed with interrupts masked */
+static volatile uint32_t ulPendingCauses = 0;
+static volatile uint32_t ulPendingDetail;
+
+/* Finished records, analyzer to the consumer: single producer, single
+ * consumer, indices running freely */
+static DisturbRecord_t *volatile pxDone[DISTURB_RECORDS];
+static volatile uint32_t ulDoneHead = 0;
+static volatile uint32_t ulDoneTail = 0;
+
+static volatile uint32_t ulRecorded = 0;
+static volatile uint32_t ulDropped = 0;
+
+static void vRecordStart(DisturbRecord_t *pxRecord) {
+    pxRecord->head = 0;
+    pxRecord->causes = 0;
+}
+
+void vDisturbanceInit(void) {
+    vPoolInit(&xRecordPool, xRecordSlots, sizeof(xRecordSlots[0]), DISTURB_RECORDS);
+    pxLive = (DisturbRecord_t *)pvPoolAlloc(&xRecordPool);
+    vRecordStart(pxLive);
+    ulTriggered = 0;
+}
+
+void vDisturbanceTrigger(uint32_t cause, uint32_t detail) {
+    alt_irq_context context;
+
+    context = alt_irq_disable_all();
+    if (ulPendingCauses == 0) {
+        ulPendingDetail = detail;
+    }
+    ulPendingCauses |= cause;
+    alt_irq_enable_all(context);
+}
+
+/* The live record has its post-trigger samples: queue it and record on in
+ * a free one */
+static void vRecordFinish(void) {
+    DisturbRecord_t *pxNext = (DisturbRecord_t *)pvPoolAlloc(&xRecordPool);
+
+    if (pxNext == NULL) {
+        ulDropped++;
+        pxLive->causes = 0;
+        return;
+    }
+    pxDone[ulDoneHead % DISTURB_RECORDS] = pxLive;
+    ulDoneHead++;
+    ulRecorded++;
+    pxLive = pxNext;
+    vRecordStart(pxLive);
+}
+
+void vDisturbanceSample(uint32_t channel, uint32_t count, uint32_t stamp) {
+    alt_irq_context context;
+    DisturbSample_t *pxSample;
+    uint32_t causes, detail;
+
+    if (ulPendingCauses != 0) {
+        context = alt_irq_disable_all();
+        causes = ulPendingCauses;
+        detail = ulPendingDetail;
+        ulPendingCauses = 0;
+        alt_irq_enable_all(context);
+
+        if (pxLive->causes == 0) {
+            pxLive->trigger = pxLive->head;
+            pxLive->detail = detail;
+            pxLive->uptime_ms = xTaskGetTickCount() * portTICK_PERIOD_MS;
+            pxLive->trigger_us = ullTimeToUs(ullTimeSyncedAt(ullTimeExtend(stamp)));
+            pxLive->number = ++ulTriggered;
+        }
+        pxLive->causes |= causes;
+    }
+
+    pxSample = &pxLive->ring[pxLive->head & DISTURB_MASK];
+    pxSample->stamp = stamp;
+    pxSample->sample = channel << 24 | (count & 0xFFFFFF);
+    pxLive->head++;
+
+    if (pxLive->causes != 0 && pxLive->head - pxLive->trigger >= DISTURB_POST_SAMPLES) {
+        vRecordFinish();
+    }
+}
+
+const DisturbRecord_t *pxDisturbanceTake(void) {
+    const DisturbRecord_t *pxRecord;
+
+    if (ulDoneTail == ulDoneHead) {
+        return NULL;
+    }
+    pxRecord = pxDone[ulDoneTail % DISTURB_RECORDS];
+    ulDoneTail++;
+    return pxRecord;
+}
+
+void vDisturbanceDump(const DisturbRecord_t *pxRecord) {
+    uint32_t n, first, i, sample;
+
+    n = pxRecord->head < DISTURB_SAMPLES ? pxRecord->head : DISTURB_SAMPLES;
+    first = pxRecord->head - n;
+
+    xTelemetryUartTake(portMAX_DELAY);
+    printf("#DREC,%d,%lu,%lu,%lu,%lu,%lu,%lu,%lu\n", DISTURB_VERSION,
+           (unsigned long)ulLatencyCountsPerUs(), (unsigned long)pxRecord->number,
+           (unsigned long)pxRecord->causes, (unsigned long)pxRecord->detail,
+           (unsigned long)pxRecord->uptime_ms, (unsigned long)n,
+           (unsigned long)(pxRecord->trigger - first));
+    for (i = first; i != pxRecord->head; i++) {
+        sample = pxRecord->ring[i & DISTURB_MASK].sample;
+        printf("S,%08lx,%lu,%lu\n", (unsigned long)pxRecord->ring[i & DISTURB_MASK].stamp,
+               (unsigned long)(sample >> 24), (unsigned long)(sample & 0xFFFFFF));
+    }
+    printf("#DREC,end\n");
+    fflush(stdout);
+    vTelemetryUartGive();
+}
+
+void vDisturbanceRelease(const DisturbRecord_t *pxRecord) {
+    vPoolFree(&xRecordPool, (void *)pxRecord);
+}
+
+uint32_t ulDisturbanceRecorded(void) {
+    return ulRecorded;
+}
+
+uint32_t ulDisturbanceDropped(void) {
+    return ulDropped;
+}
+
+const Pool_t *pxDisturbancePool(void) {
+    return &xRecordPool;
+}
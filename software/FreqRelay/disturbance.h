@@ -0,0 +1,95 @@
+/**
+ * Disturbance recorder
+ *
+ * Every period count the analyzer drains, from every feeder, goes into a
+ * live record: a ring of DISTURB_SAMPLES timestamped counts that always
+ * holds the last few seconds. A trigger (a shed, a RoC limit crossing,
+ * failsafe) marks the ring, and DISTURB_POST_SAMPLES counts later the
+ * record holds DISTURB_PRE_SAMPLES counts of lead-up and the aftermath.
+ * The record is then handed on whole by pointer, not copied: it joins the
+ * queue of finished records and a free one from the pool becomes the live
+ * ring. With no free record the finished one is dropped, counted, and
+ * recording carries on in it.
+ *
+ * The live ring starts empty after a hand-off, so a record that follows
+ * another closely has less lead-up; samples says how many it holds.
+ *
+ * Triggers during the post-trigger window join the record (causes). The
+ * records and rings are in SDRAM; only the analyzer writes a live ring, so
+ * recording takes no lock. vDisturbanceTrigger() may be called from any
+ * task or ISR.
+ *
+ * One consumer takes finished records and releases them once sent: the
+ * COMTRADE exporter (comtrade.h), or a background task writing them out
+ * with vDisturbanceDump() on the JTAG UART as text:
+ *
+ *   #DREC,<version>,<counts per us>,<record>,<causes>,<detail>,<uptime ms>,<samples>,<trigger>
+ *   S,<stamp>,<feeder>,<count>        oldest first, stamp in hex
+ *   #DREC,end
+ *
+ * where trigger is the number of samples before the trigger, and the
+ * counts are SAMPLING_FREQ periods as the analyser gives them.
+ */
+
+#ifndef DISTURBANCE_H
+#define DISTURBANCE_H
+
+#include <stdint.h>
+#include "pool.h"
+
+#define DISTURB_VERSION                1
+#define DISTURB_PRE_SAMPLES            256    // Kept from before the trigger
+#define DISTURB_POST_SAMPLES           256    // Recorded after it
+#define DISTURB_SAMPLES                (DISTURB_PRE_SAMPLES + DISTURB_POST_SAMPLES)  // Power of 2
+#define DISTURB_MASK                   (DISTURB_SAMPLES - 1)
+#define DISTURB_RECORDS                4      // One live, the rest finished and waiting
+
+/* Trigger causes, a bit each */
+#define DISTURB_CAUSE_SHED             0x01   // detail: loads shed
+#define DISTURB_CAUSE_ROC              0x02   // detail: feeder
+#define DISTURB_CAUSE_FAILSAFE         0x04   // detail: failsafe sources
+
+#if (DISTURB_SAMPLES & DISTURB_MASK) != 0
+#error "DISTURB_SAMPLES must be a power of 2"
+#endif
+
+typedef struct {
+    uint32_t stamp;                    // Timestamp count at capture
+    uint32_t sample;                   // feeder << 24 | period count
+} DisturbSample_t;
+
+typedef struct {
+    DisturbSample_t ring[DISTURB_SAMPLES];
+    uint32_t head;                     // Samples written, runs freely
+    uint32_t trigger;                  // head at the trigger
+    uint32_t causes;                   // DISTURB_CAUSE_* in the window, 0 while untriggered
+    uint32_t detail;                   // The first trigger's
+    uint32_t uptime_ms;                // At the first trigger
+    uint64_t trigger_us;               // Its sample's capture on the ring's common clock (time_sync.h)
+    uint32_t number;                   // Records triggered since boot
+} DisturbRecord_t;
+
+/* Pool and the first live ring, before the scheduler starts */
+void vDisturbanceInit(void);
+
+/* One drained count, analyzer only */
+void vDisturbanceSample(uint32_t channel, uint32_t count, uint32_t stamp);
+
+/* Start a record, or add the cause to the one recording. Task or ISR. */
+void vDisturbanceTrigger(uint32_t cause, uint32_t detail);
+
+/* Oldest finished record, or NULL. One consumer task. */
+const DisturbRecord_t *pxDisturbanceTake(void);
+
+/* Write a taken record out on the JTAG UART, then give it back */
+void vDisturbanceDump(const DisturbRecord_t *pxRecord);
+void vDisturbanceRelease(const DisturbRecord_t *pxRecord);
+
+/* Records finished, and finished ones dropped for want of a free record */
+uint32_t ulDisturbanceRecorded(void);
+uint32_t ulDisturbanceDropped(void);
+
+/* The record pool, for its high-water mark */
+const Pool_t *pxDisturbancePool(void);
+
+#endif /* DISTURBANCE_H */
@@ -0,0 +1,727 @@
+/**
+ * UDP over the Triple-Speed Ethernet MAC
+ *
+ * See eth.h.
+ */
+
+/* Standard includes */
+#include <stddef.h>
+#include <string.h>
+
+/* Scheduler includes */
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/* Hardware includes */
+#include "system.h"
+#include "io.h"
+
+/* Application includes */
+#include "eth.h"
+
+#ifdef TSE_MAC_BASE
+
+#include "cache_io.h"
+#include "fast_mem.h"
+#include "irq_defer.h"
+#include "pool.h"
+
+/* The cores' register maps, word offsets, from their data sheets: the BSP
+ * only generates headers for what the system has */
+#define ETH_SGDMA_STATUS               0
+#define ETH_SGDMA_CONTROL              4
+#define ETH_SGDMA_NEXT_DESC            8
+#define ETH_SGDMA_STATUS_ERROR         0x01
+#define ETH_SGDMA_STATUS_BUSY          0x10
+#define ETH_SGDMA_CONTROL_IE_CHAIN     0x08  // Interrupt at the end of the chain
+#define ETH_SGDMA_CONTROL_IE_GLOBAL    0x10
+#define ETH_SGDMA_CONTROL_RUN          0x20
+#define ETH_SGDMA_CONTROL_RESET        0x10000
+#define ETH_SGDMA_CONTROL_CLEAR_IRQ    0x80000000UL
+#define ETH_SGDMA_GO                   (ETH_SGDMA_CONTROL_RUN | ETH_SGDMA_CONTROL_IE_GLOBAL | \
+                                        ETH_SGDMA_CONTROL_IE_CHAIN)
+
+#define ETH_DESC_GENERATE_EOP          0x01
+#define ETH_DESC_OWNED_BY_HW           0x80
+#define ETH_DESC_STATUS_ERRORS         0x7F  // CRC, parity, overflow, sync, EOP/SOP misplaced
+
+#define ETH_TSE_COMMAND                0x02
+#define ETH_TSE_MAC_0                  0x03
+#define ETH_TSE_MAC_1                  0x04
+#define ETH_TSE_FRM_LENGTH             0x05
+#define ETH_TSE_RX_SECTION_EMPTY       0x07
+#define ETH_TSE_RX_SECTION_FULL        0x08
+#define ETH_TSE_TX_SECTION_EMPTY       0x09
+#define ETH_TSE_TX_SECTION_FULL        0x0A
+#define ETH_TSE_RX_ALMOST_EMPTY        0x0B
+#define ETH_TSE_RX_ALMOST_FULL         0x0C
+#define ETH_TSE_TX_ALMOST_EMPTY        0x0D
+#define ETH_TSE_TX_ALMOST_FULL         0x0E
+#define ETH_TSE_MDIO_ADDR0             0x0F
+#define ETH_TSE_TX_CMD_STAT            0x3A
+#define ETH_TSE_RX_CMD_STAT            0x3B
+#define ETH_TSE_MDIO0                  0x80  // PHY registers at MDIO_ADDR0, one word each
+#define ETH_TSE_TX_ENA                 0x00000001UL
+#define ETH_TSE_RX_ENA                 0x00000002UL
+#define ETH_TSE_PAD_EN                 0x00000020UL
+#define ETH_TSE_SW_RESET               0x00002000UL
+#define ETH_TSE_ENA_10                 0x02000000UL
+#define ETH_TSE_RX_ERR_DISC            0x04000000UL
+#define ETH_TSE_TX_SHIFT16             0x00040000UL
+#define ETH_TSE_RX_SHIFT16             0x02000000UL
+
+#ifdef TSE_MAC_RECEIVE_FIFO_DEPTH
+#define ETH_RX_FIFO_DEPTH              TSE_MAC_RECEIVE_FIFO_DEPTH
+#else
+#define ETH_RX_FIFO_DEPTH              2048
+#endif
+#ifdef TSE_MAC_TRANSMIT_FIFO_DEPTH
+#define ETH_TX_FIFO_DEPTH              TSE_MAC_TRANSMIT_FIFO_DEPTH
+#else
+#define ETH_TX_FIFO_DEPTH              2048
+#endif
+
+/* 88E1111 PHY registers */
+#define ETH_PHY_CONTROL                0
+#define ETH_PHY_GIGABIT_CONTROL        9
+#define ETH_PHY_STATUS                 17
+#define ETH_PHY_RESET                  0x8000
+#define ETH_PHY_AUTONEG                0x1000
+#define ETH_PHY_RESTART_AUTONEG        0x0200
+#define ETH_PHY_LINK                   0x0400
+#define ETH_PHY_SPEED_SHIFT            14
+
+/* Frame layout from the buffer start: the shift, Ethernet, IPv4, UDP */
+#define ETH_AT_DST                     2
+#define ETH_AT_SRC                     8
+#define ETH_AT_TYPE                    14
+#define ETH_AT_IP                      16
+#define ETH_AT_UDP                     36
+#define ETH_AT_PAYLOAD                 44
+#define ETH_HEADER_BYTES               (ETH_AT_IP - 2)
+#define ETH_FRAME_MIN                  60    // Without the CRC, the MAC appends it
+#define ETH_TYPE_IP                    0x0800
+#define ETH_TYPE_ARP                   0x0806
+#define ETH_IP_UDP                     17
+#define ETH_IP_ICMP                    1
+#define ETH_IP_TTL                     64
+#define ETH_IP_DONT_FRAGMENT           0x4000
+#define ETH_IP_FRAGMENTS               0x3FFF  // More fragments and the offset
+#define ETH_ICMP_ECHO_REQUEST          8
+#define ETH_ICMP_ECHO_REPLY            0
+#define ETH_ARP_REQUEST                1
+#define ETH_ARP_REPLY                  2
+#define ETH_ARP_BYTES                  28
+
+#define ETH_RX_MASK                    (ETH_RX_QUEUE - 1)
+#define ETH_TX_MASK                    (ETH_TX_QUEUE - 1)
+#define ETH_DESC_TX                    0     // And its chain end
+#define ETH_DESC_RX                    2
+
+/* The SGDMA's descriptor, 32 bytes */
+typedef struct {
+    uint32_t read_addr;
+    uint32_t read_pad;
+    uint32_t write_addr;
+    uint32_t write_pad;
+    uint32_t next;
+    uint32_t next_pad;
+    uint16_t bytes_to_transfer;
+    uint8_t read_burst;
+    uint8_t write_burst;
+    uint16_t actual_bytes;
+    uint8_t status;
+    uint8_t control;
+} EthDesc_t;
+
+/* A packet buffer. The datagram is first, so a handler's pointer is the
+ * buffer's; the frame starts on its own line. */
+typedef struct {
+    EthDatagram_t dg;
+    uint32_t len;                      // Frame bytes from frame[0], the shift included
+    uint8_t frame[ETH_FRAME_BYTES] CACHE_LINE;
+} EthBuffer_t;
+
+POOL_STORAGE(xEthSlots, EthBuffer_t, ETH_BUFFERS);  // Line aligned, as EthBuffer_t is
+static Pool_t xEthPool;
+
+static volatile EthDesc_t *pxDesc;     // Uncached, in the descriptor memory
+
+/* Received frames: the interrupt writes head, the task tail */
+typedef struct {
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    EthBuffer_t *volatile buffer[ETH_RX_QUEUE];
+} EthRxQueue_t;
+
+/* Frames to send: head is written in critical sections, tail by the
+ * interrupt; the one at tail is with the SGDMA while busy */
+typedef struct {
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    volatile uint8_t busy;
+    EthBuffer_t *volatile buffer[ETH_TX_QUEUE];
+} EthTxQueue_t;
+
+static EthRxQueue_t xRx;
+static EthTxQueue_t xTx;
+static EthBuffer_t *pxRxArmed;         // With the receive SGDMA, interrupt only after init
+static TaskHandle_t xEthTask = NULL;
+
+static const uint8_t ucMac[6] = ETH_MAC_ADDR;
+static const uint8_t ucBroadcast[6] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+
+/* The host's address, written by the task and read whole by any */
+static uint8_t ucHostMac[6];
+static volatile uint8_t ucHostKnown;
+static uint32_t ulArpSentMs;
+static uint8_t ucArpSent;
+static uint16_t usIpId;                // Written in the send's critical section
+
+static struct {
+    uint16_t port;
+    EthUdpHandler_t pxHandler;
+} xPorts[ETH_PORTS];
+
+static EthStats_t xStats;
+
+static inline uint32_t ulPhysical(const volatile void *pv) {
+    return (uint32_t)(uintptr_t)pv & ~CACHE_BYPASS_BIT;
+}
+
+static inline EthBuffer_t *pxFromPayload(uint8_t *pucPayload) {
+    return (EthBuffer_t *)(void *)(pucPayload - ETH_AT_PAYLOAD - offsetof(EthBuffer_t, frame));
+}
+
+static inline uint16_t usGet16(const uint8_t *p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static inline uint32_t ulGet32(const uint8_t *p) {
+    return ((uint32_t)usGet16(p) << 16) | usGet16(p + 2);
+}
+
+static inline void vPut16(uint8_t *p, uint32_t value) {
+    p[0] = (uint8_t)(value >> 8);
+    p[1] = (uint8_t)value;
+}
+
+static inline void vPut32(uint8_t *p, uint32_t value) {
+    vPut16(p, value >> 16);
+    vPut16(p + 2, value);
+}
+
+/* Internet checksum over len bytes, len even */
+static uint16_t usInetChecksum(const uint8_t *p, uint32_t len) {
+    uint32_t sum = 0;
+
+    for (; len > 1; len -= 2, p += 2) {
+        sum += usGet16(p);
+    }
+    if (len) {
+        sum += (uint32_t)p[0] << 8;
+    }
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    return (uint16_t)~sum;
+}
+
+static uint32_t ulPhyRead(uint32_t reg) {
+    return IORD(TSE_MAC_BASE, ETH_TSE_MDIO0 + reg) & 0xFFFF;
+}
+
+static void vPhyWrite(uint32_t reg, uint32_t value) {
+    IOWR(TSE_MAC_BASE, ETH_TSE_MDIO0 + reg, value);
+}
+
+/* Hand pxRxArmed to the receive SGDMA; its lines were invalidated when it
+ * was taken */
+static void vEthRxArm(void) {
+    volatile EthDesc_t *pxD = &pxDesc[ETH_DESC_RX], *pxEnd = &pxDesc[ETH_DESC_RX + 1];
+
+    pxEnd->control = 0;                // Not owned: the chain ends here
+    pxD->read_addr = 0;
+    pxD->write_addr = ulPhysical(pxRxArmed->frame);
+    pxD->next = ulPhysical(pxEnd);
+    pxD->bytes_to_transfer = 0;        // Up to the end of packet, the MAC caps the length
+    pxD->read_burst = 0;
+    pxD->write_burst = 0;
+    pxD->actual_bytes = 0;
+    pxD->status = 0;
+    pxD->control = ETH_DESC_OWNED_BY_HW;
+
+    IOWR(SGDMA_RX_BASE, ETH_SGDMA_STATUS, 0xFF);
+    IOWR(SGDMA_RX_BASE, ETH_SGDMA_NEXT_DESC, ulPhysical(pxD));
+    IOWR(SGDMA_RX_BASE, ETH_SGDMA_CONTROL, ETH_SGDMA_GO);
+}
+
+/* The buffer at the transmit queue's tail to the SGDMA; interrupts masked */
+static void vEthTxStart(void) {
+    volatile EthDesc_t *pxD = &pxDesc[ETH_DESC_TX], *pxEnd = &pxDesc[ETH_DESC_TX + 1];
+    EthBuffer_t *pxBuf = xTx.buffer[xTx.tail & ETH_TX_MASK];
+
+    pxEnd->control = 0;
+    pxD->read_addr = ulPhysical(pxBuf->frame);
+    pxD->write_addr = 0;
+    pxD->next = ulPhysical(pxEnd);
+    pxD->bytes_to_transfer = (uint16_t)pxBuf->len;
+    pxD->read_burst = 0;
+    pxD->write_burst = 0;
+    pxD->actual_bytes = 0;
+    pxD->status = 0;
+    pxD->control = ETH_DESC_OWNED_BY_HW | ETH_DESC_GENERATE_EOP;
+
+    xTx.busy = 1;
+    IOWR(SGDMA_TX_BASE, ETH_SGDMA_STATUS, 0xFF);
+    IOWR(SGDMA_TX_BASE, ETH_SGDMA_NEXT_DESC, ulPhysical(pxD));
+    IOWR(SGDMA_TX_BASE, ETH_SGDMA_CONTROL, ETH_SGDMA_GO);
+}
+
+static void vEthRxISRHandler(void *context) {
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    volatile EthDesc_t *pxD = &pxDesc[ETH_DESC_RX];
+    EthBuffer_t *pxNew;
+    uint32_t head = xRx.head;
+    uint8_t status;
+
+    IOWR(SGDMA_RX_BASE, ETH_SGDMA_CONTROL, ETH_SGDMA_CONTROL_CLEAR_IRQ);
+    if (pxD->control & ETH_DESC_OWNED_BY_HW) {
+        IOWR(SGDMA_RX_BASE, ETH_SGDMA_CONTROL, ETH_SGDMA_GO);
+        return;
+    }
+
+    /* A bad frame, no buffer to swap in or no room in the queue: the
+     * armed buffer goes round again */
+    status = pxD->status;
+    if ((status & ETH_DESC_STATUS_ERRORS) || pxD->actual_bytes < ETH_AT_IP) {
+        xStats.rx_errors++;
+    } else if (head - xRx.tail >= ETH_RX_QUEUE || (pxNew = pvPoolAlloc(&xEthPool)) == NULL) {
+        xStats.rx_dropped++;
+    } else {
+        pxRxArmed->len = pxD->actual_bytes;
+        xRx.buffer[head & ETH_RX_MASK] = pxRxArmed;
+        xRx.head = head + 1;
+        xStats.rx_frames++;
+        vCacheInvalidateRange(pxNew->frame, ETH_FRAME_BYTES);
+        pxRxArmed = pxNew;
+        vTaskNotifyGiveFromISR(xEthTask, &xHigherPriorityTaskWoken);
+    }
+    vEthRxArm();
+
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
+static void vEthTxISRHandler(void *context) {
+    uint32_t tail = xTx.tail;
+
+    IOWR(SGDMA_TX_BASE, ETH_SGDMA_CONTROL, ETH_SGDMA_CONTROL_CLEAR_IRQ);
+    if (!xTx.busy) {
+        return;
+    }
+    vPoolFree(&xEthPool, xTx.buffer[tail & ETH_TX_MASK]);
+    xTx.tail = tail + 1;
+    xTx.busy = 0;
+    if (xTx.tail != xTx.head) {
+        vEthTxStart();
+    }
+}
+
+/* Pad, flush and queue a frame of len bytes (the shift included) */
+static void vEthTransmit(EthBuffer_t *pxBuf, uint32_t len) {
+    uint32_t head;
+
+    if (len < 2 + ETH_FRAME_MIN) {
+        memset(&pxBuf->frame[len], 0, 2 + ETH_FRAME_MIN - len);
+        len = 2 + ETH_FRAME_MIN;
+    }
+    pxBuf->len = len;
+    vCacheFlushRange(pxBuf->frame, len);
+
+    taskENTER_CRITICAL();
+    head = xTx.head;
+    if (head - xTx.tail >= ETH_TX_QUEUE) {
+        xStats.tx_dropped++;
+        vPoolFree(&xEthPool, pxBuf);
+    } else {
+        xTx.buffer[head & ETH_TX_MASK] = pxBuf;
+        xTx.head = head + 1;
+        xStats.tx_frames++;
+        if (!xTx.busy) {
+            vEthTxStart();
+        }
+    }
+    taskEXIT_CRITICAL();
+}
+
+/* Ethernet and IPv4 headers to dst, the lengths left for vEthSend() */
+static void vEthHeaders(uint8_t *pucFrame, const uint8_t *pucDstMac, uint32_t dst_ip, uint8_t protocol) {
+    uint8_t *pucIp = &pucFrame[ETH_AT_IP];
+
+    memcpy(&pucFrame[ETH_AT_DST], pucDstMac, 6);
+    memcpy(&pucFrame[ETH_AT_SRC], ucMac, 6);
+    vPut16(&pucFrame[ETH_AT_TYPE], ETH_TYPE_IP);
+    pucIp[0] = 0x45;                   // IPv4, 20 byte header
+    pucIp[1] = 0;
+    vPut16(&pucIp[6], ETH_IP_DONT_FRAGMENT);
+    pucIp[8] = ETH_IP_TTL;
+    pucIp[9] = protocol;
+    vPut32(&pucIp[12], ETH_IP_ADDR);
+    vPut32(&pucIp[16], dst_ip);
+}
+
+/* Total length, identification and header checksum of an IPv4 packet of
+ * ip_len bytes */
+static void vEthIpFinish(uint8_t *pucFrame, uint32_t ip_len) {
+    uint8_t *pucIp = &pucFrame[ETH_AT_IP];
+
+    vPut16(&pucIp[2], ip_len);
+    taskENTER_CRITICAL();
+    vPut16(&pucIp[4], usIpId++);
+    taskEXIT_CRITICAL();
+    vPut16(&pucIp[10], 0);
+    vPut16(&pucIp[10], usInetChecksum(pucIp, 20));
+}
+
+static uint8_t *pucEthUdpBegin(const uint8_t *pucDstMac, uint32_t dst_ip, uint16_t dst_port, uint16_t src_port,
+                               uint32_t *pulCap) {
+    EthBuffer_t *pxBuf = pvPoolAlloc(&xEthPool);
+
+    if (pxBuf == NULL) {
+        xStats.no_buffer++;
+        return NULL;
+    }
+    vEthHeaders(pxBuf->frame, pucDstMac, dst_ip, ETH_IP_UDP);
+    vPut16(&pxBuf->frame[ETH_AT_UDP], src_port);
+    vPut16(&pxBuf->frame[ETH_AT_UDP + 2], dst_port);
+    *pulCap = ETH_UDP_PAYLOAD_MAX;
+    return &pxBuf->frame[ETH_AT_PAYLOAD];
+}
+
+uint8_t *pucEthHostBegin(uint16_t port, uint32_t *pulCap) {
+    uint8_t mac[6];
+
+    if (!ucHostKnown) {
+        return NULL;
+    }
+    taskENTER_CRITICAL();
+    memcpy(mac, ucHostMac, sizeof(mac));
+    taskEXIT_CRITICAL();
+    return pucEthUdpBegin(mac, ETH_HOST_IP_ADDR, port, port, pulCap);
+}
+
+uint8_t *pucEthReplyBegin(const EthDatagram_t *pxRequest, uint32_t *pulCap) {
+    const EthBuffer_t *pxReq = (const EthBuffer_t *)pxRequest;
+
+    return pucEthUdpBegin(&pxReq->frame[ETH_AT_SRC], pxRequest->src_ip, pxRequest->src_port,
+                          pxRequest->dst_port, pulCap);
+}
+
+void vEthSend(uint8_t *pucPayload, uint32_t len) {
+    EthBuffer_t *pxBuf = pxFromPayload(pucPayload);
+
+    if (len == 0 || len > ETH_UDP_PAYLOAD_MAX) {
+        vPoolFree(&xEthPool, pxBuf);
+        return;
+    }
+    vPut16(&pxBuf->frame[ETH_AT_UDP + 4], 8 + len);
+    vPut16(&pxBuf->frame[ETH_AT_UDP + 6], 0);  // No checksum
+    vEthIpFinish(pxBuf->frame, 20 + 8 + len);
+    vEthTransmit(pxBuf, ETH_AT_PAYLOAD + len);
+}
+
+void vEthRelease(EthDatagram_t *pxDatagram) {
+    vPoolFree(&xEthPool, pxDatagram);
+}
+
+static void vEthLearnHost(const uint8_t *pucMac) {
+    taskENTER_CRITICAL();
+    memcpy(ucHostMac, pucMac, 6);
+    taskEXIT_CRITICAL();
+    ucHostKnown = 1;
+    xStats.host_known = 1;
+}
+
+/* Who has the host's address? */
+static void vEthArpAsk(void) {
+    EthBuffer_t *pxBuf = pvPoolAlloc(&xEthPool);
+    uint8_t *pucArp;
+
+    if (pxBuf == NULL) {
+        xStats.no_buffer++;
+        return;
+    }
+    pucArp = &pxBuf->frame[ETH_AT_IP];
+    memcpy(&pxBuf->frame[ETH_AT_DST], ucBroadcast, 6);
+    memcpy(&pxBuf->frame[ETH_AT_SRC], ucMac, 6);
+    vPut16(&pxBuf->frame[ETH_AT_TYPE], ETH_TYPE_ARP);
+    vPut16(&pucArp[0], 1);             // Ethernet
+    vPut16(&pucArp[2], ETH_TYPE_IP);
+    pucArp[4] = 6;
+    pucArp[5] = 4;
+    vPut16(&pucArp[6], ETH_ARP_REQUEST);
+    memcpy(&pucArp[8], ucMac, 6);
+    vPut32(&pucArp[14], ETH_IP_ADDR);
+    memset(&pucArp[18], 0, 6);
+    vPut32(&pucArp[24], ETH_HOST_IP_ADDR);
+    vEthTransmit(pxBuf, ETH_AT_IP + ETH_ARP_BYTES);
+}
+
+/* ARP: learn the host, answer for this address in the same buffer */
+static void vEthArp(EthBuffer_t *pxBuf) {
+    uint8_t *pucFrame = pxBuf->frame, *pucArp = &pucFrame[ETH_AT_IP];
+
+    if (pxBuf->len < ETH_AT_IP + ETH_ARP_BYTES || usGet16(&pucArp[0]) != 1 ||
+        usGet16(&pucArp[2]) != ETH_TYPE_IP || pucArp[4] != 6 || pucArp[5] != 4) {
+        vPoolFree(&xEthPool, pxBuf);
+        return;
+    }
+    if (ulGet32(&pucArp[14]) == ETH_HOST_IP_ADDR) {
+        vEthLearnHost(&pucArp[8]);
+    }
+    if (usGet16(&pucArp[6]) != ETH_ARP_REQUEST || ulGet32(&pucArp[24]) != ETH_IP_ADDR) {
+        vPoolFree(&xEthPool, pxBuf);
+        return;
+    }
+
+    vPut16(&pucArp[6], ETH_ARP_REPLY);
+    memcpy(&pucArp[18], &pucArp[8], 10);   // Sender's MAC and IP become the target's
+    memcpy(&pucArp[8], ucMac, 6);
+    vPut32(&pucArp[14], ETH_IP_ADDR);
+    memcpy(&pucFrame[ETH_AT_DST], &pucArp[18], 6);
+    memcpy(&pucFrame[ETH_AT_SRC], ucMac, 6);
+    xStats.arp_replies++;
+    vEthTransmit(pxBuf, ETH_AT_IP + ETH_ARP_BYTES);
+}
+
+/* ICMP echo request of icmp_len bytes, answered in the same buffer */
+static void vEthEcho(EthBuffer_t *pxBuf, uint32_t icmp_len) {
+    uint8_t *pucFrame = pxBuf->frame, *pucIp = &pucFrame[ETH_AT_IP], *pucIcmp = &pucIp[20];
+    uint8_t mac[6];
+    uint32_t src_ip = ulGet32(&pucIp[12]);
+
+    if (icmp_len < 8 || pucIcmp[0] != ETH_ICMP_ECHO_REQUEST || usInetChecksum(pucIcmp, icmp_len) != 0) {
+        vPoolFree(&xEthPool, pxBuf);
+        return;
+    }
+    pucIcmp[0] = ETH_ICMP_ECHO_REPLY;
+    vPut16(&pucIcmp[2], 0);
+    vPut16(&pucIcmp[2], usInetChecksum(pucIcmp, icmp_len));
+
+    memcpy(mac, &pucFrame[ETH_AT_SRC], 6);
+    vEthHeaders(pucFrame, mac, src_ip, ETH_IP_ICMP);
+    vEthIpFinish(pucFrame, 20 + icmp_len);
+    xStats.echo_replies++;
+    vEthTransmit(pxBuf, ETH_AT_IP + 20 + icmp_len);
+}
+
+/* IPv4 to this address without options or fragments */
+static void vEthIp(EthBuffer_t *pxBuf) {
+    uint8_t *pucIp = &pxBuf->frame[ETH_AT_IP], *pucUdp = &pxBuf->frame[ETH_AT_UDP];
+    uint32_t ip_len = usGet16(&pucIp[2]), udp_len, i;
+    uint16_t port;
+
+    if (pucIp[0] != 0x45 || ip_len < 20 || ETH_AT_IP + ip_len > pxBuf->len ||
+        (usGet16(&pucIp[6]) & ETH_IP_FRAGMENTS) != 0 || ulGet32(&pucIp[16]) != ETH_IP_ADDR ||
+        usInetChecksum(pucIp, 20) != 0) {
+        vPoolFree(&xEthPool, pxBuf);
+        return;
+    }
+    if (ulGet32(&pucIp[12]) == ETH_HOST_IP_ADDR) {
+        vEthLearnHost(&pxBuf->frame[ETH_AT_SRC]);
+    }
+
+    if (pucIp[9] == ETH_IP_ICMP) {
+        vEthEcho(pxBuf, ip_len - 20);
+        return;
+    }
+    udp_len = usGet16(&pucUdp[4]);
+    if (pucIp[9] != ETH_IP_UDP || udp_len < 8 || udp_len > ip_len - 20) {
+        vPoolFree(&xEthPool, pxBuf);
+        return;
+    }
+
+    port = usGet16(&pucUdp[2]);
+    for (i = 0; i < ETH_PORTS; i++) {
+        if (xPorts[i].pxHandler != NULL && xPorts[i].port == port) {
+            pxBuf->dg.pucPayload = &pxBuf->frame[ETH_AT_PAYLOAD];
+            pxBuf->dg.len = udp_len - 8;
+            pxBuf->dg.src_ip = ulGet32(&pucIp[12]);
+            pxBuf->dg.src_port = usGet16(&pucUdp[0]);
+            pxBuf->dg.dst_port = port;
+            xStats.udp++;
+            xPorts[i].pxHandler(&pxBuf->dg);
+            return;
+        }
+    }
+    xStats.no_port++;
+    vPoolFree(&xEthPool, pxBuf);
+}
+
+/* Follow the PHY's link: the MAC's speed has to match it */
+static void vEthLink(void) {
+    uint32_t status = ulPhyRead(ETH_PHY_STATUS), command;
+    uint8_t mbps = 0;
+
+    if (status & ETH_PHY_LINK) {
+        mbps = ((status >> ETH_PHY_SPEED_SHIFT) & 0x3) == 0 ? 10 : 100;
+    }
+    if (mbps != xStats.link_mbps) {
+        command = IORD(TSE_MAC_BASE, ETH_TSE_COMMAND) & ~ETH_TSE_ENA_10;
+        IOWR(TSE_MAC_BASE, ETH_TSE_COMMAND, command | (mbps == 10 ? ETH_TSE_ENA_10 : 0));
+        xStats.link_mbps = mbps;
+    }
+}
+
+void vEthService(uint32_t now_ms) {
+    EthBuffer_t *pxBuf;
+    uint32_t tail;
+
+    for (tail = xRx.tail; tail != xRx.head; tail++) {
+        pxBuf = xRx.buffer[tail & ETH_RX_MASK];
+        xRx.tail = tail + 1;
+        if (memcmp(&pxBuf->frame[ETH_AT_DST], ucMac, 6) != 0 &&
+            memcmp(&pxBuf->frame[ETH_AT_DST], ucBroadcast, 6) != 0) {
+            vPoolFree(&xEthPool, pxBuf);
+            continue;
+        }
+        switch (usGet16(&pxBuf->frame[ETH_AT_TYPE])) {
+        case ETH_TYPE_ARP:
+            vEthArp(pxBuf);
+            break;
+        case ETH_TYPE_IP:
+            vEthIp(pxBuf);
+            break;
+        default:
+            vPoolFree(&xEthPool, pxBuf);
+            break;
+        }
+    }
+
+    if (!ucArpSent || now_ms - ulArpSentMs >= (ucHostKnown ? ETH_ARP_REFRESH_MS : ETH_ARP_RETRY_MS)) {
+        ulArpSentMs = now_ms;
+        ucArpSent = 1;
+        vEthLink();
+        if (xStats.link_mbps != 0) {
+            vEthArpAsk();
+        }
+    }
+}
+
+int xEthUdpBind(uint16_t port, EthUdpHandler_t pxHandler) {
+    uint32_t i;
+
+    for (i = 0; i < ETH_PORTS; i++) {
+        if (xPorts[i].pxHandler == NULL) {
+            xPorts[i].port = port;
+            xPorts[i].pxHandler = pxHandler;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int xEthInit(TaskHandle_t xTask) {
+    uint32_t i;
+
+    if (xTask == NULL) {
+        return -1;
+    }
+    xEthTask = xTask;
+    vPoolInit(&xEthPool, xEthSlots, sizeof(xEthSlots[0]), ETH_BUFFERS);
+    memset((void *)&xRx, 0, sizeof(xRx));
+    memset((void *)&xTx, 0, sizeof(xTx));
+    pxDesc = (volatile EthDesc_t *)(DESCRIPTOR_MEMORY_BASE | CACHE_BYPASS_BIT);
+
+    IOWR(SGDMA_TX_BASE, ETH_SGDMA_CONTROL, ETH_SGDMA_CONTROL_RESET);
+    IOWR(SGDMA_TX_BASE, ETH_SGDMA_CONTROL, ETH_SGDMA_CONTROL_RESET);  // Twice, as the core wants
+    IOWR(SGDMA_RX_BASE, ETH_SGDMA_CONTROL, ETH_SGDMA_CONTROL_RESET);
+    IOWR(SGDMA_RX_BASE, ETH_SGDMA_CONTROL, ETH_SGDMA_CONTROL_RESET);
+
+    /* PHY: no gigabit, autonegotiate the rest */
+    IOWR(TSE_MAC_BASE, ETH_TSE_MDIO_ADDR0, ETH_PHY_ADDR);
+    vPhyWrite(ETH_PHY_GIGABIT_CONTROL, 0);
+    vPhyWrite(ETH_PHY_CONTROL, ETH_PHY_RESET | ETH_PHY_AUTONEG);
+    for (i = 0; i < 100000 && (ulPhyRead(ETH_PHY_CONTROL) & ETH_PHY_RESET); i++) {
+    }
+    vPhyWrite(ETH_PHY_CONTROL, ETH_PHY_AUTONEG | ETH_PHY_RESTART_AUTONEG);
+
+    /* MAC: reset, FIFO thresholds as the core's user guide gives them,
+     * address, shift, then on */
+    IOWR(TSE_MAC_BASE, ETH_TSE_COMMAND, ETH_TSE_SW_RESET);
+    for (i = 0; i < 100000 && (IORD(TSE_MAC_BASE, ETH_TSE_COMMAND) & ETH_TSE_SW_RESET); i++) {
+    }
+    IOWR(TSE_MAC_BASE, ETH_TSE_RX_SECTION_EMPTY, ETH_RX_FIFO_DEPTH - 16);
+    IOWR(TSE_MAC_BASE, ETH_TSE_RX_SECTION_FULL, 0);
+    IOWR(TSE_MAC_BASE, ETH_TSE_TX_SECTION_EMPTY, ETH_TX_FIFO_DEPTH - 16);
+    IOWR(TSE_MAC_BASE, ETH_TSE_TX_SECTION_FULL, 0);
+    IOWR(TSE_MAC_BASE, ETH_TSE_RX_ALMOST_EMPTY, 8);
+    IOWR(TSE_MAC_BASE, ETH_TSE_RX_ALMOST_FULL, 8);
+    IOWR(TSE_MAC_BASE, ETH_TSE_TX_ALMOST_EMPTY, 8);
+    IOWR(TSE_MAC_BASE, ETH_TSE_TX_ALMOST_FULL, 3);
+    IOWR(TSE_MAC_BASE, ETH_TSE_MAC_0, ucMac[0] | (ucMac[1] << 8) | (ucMac[2] << 16) | ((uint32_t)ucMac[3] << 24));
+    IOWR(TSE_MAC_BASE, ETH_TSE_MAC_1, ucMac[4] | (ucMac[5] << 8));
+    IOWR(TSE_MAC_BASE, ETH_TSE_FRM_LENGTH, ETH_FRAME_MAX);
+    IOWR(TSE_MAC_BASE, ETH_TSE_TX_CMD_STAT, ETH_TSE_TX_SHIFT16);
+    IOWR(TSE_MAC_BASE, ETH_TSE_RX_CMD_STAT, ETH_TSE_RX_SHIFT16);
+    IOWR(TSE_MAC_BASE, ETH_TSE_COMMAND, ETH_TSE_TX_ENA | ETH_TSE_RX_ENA | ETH_TSE_PAD_EN | ETH_TSE_RX_ERR_DISC);
+
+    vPortSetIrqPriority(SGDMA_RX_IRQ, configKERNEL_INTERRUPT_PRIORITY);
+    vPortSetIrqPriority(SGDMA_TX_IRQ, configKERNEL_INTERRUPT_PRIORITY);
+    if (xIrqRegister(SGDMA_RX_IRQ, vEthRxISRHandler, NULL) != 0 ||
+        xIrqRegister(SGDMA_TX_IRQ, vEthTxISRHandler, NULL) != 0) {
+        return -1;
+    }
+
+    pxRxArmed = pvPoolAlloc(&xEthPool);
+    vCacheInvalidateRange(pxRxArmed->frame, ETH_FRAME_BYTES);
+    vEthRxArm();
+    return 0;
+}
+
+#else /* !TSE_MAC_BASE */
+
+/* No MAC in this system: nothing goes out, nothing comes in */
+int xEthInit(TaskHandle_t xTask) {
+    (void)xTask;
+    return -1;
+}
+
+int xEthUdpBind(uint16_t port, EthUdpHandler_t pxHandler) {
+    (void)port;
+    (void)pxHandler;
+    return -1;
+}
+
+void vEthService(uint32_t now_ms) {
+    (void)now_ms;
+}
+
+uint8_t *pucEthHostBegin(uint16_t port, uint32_t *pulCap) {
+    (void)port;
+    *pulCap = 0;
+    return NULL;
+}
+
+uint8_t *pucEthReplyBegin(const EthDatagram_t *pxRequest, uint32_t *pulCap) {
+    (void)pxRequest;
+    *pulCap = 0;
+    return NULL;
+}
+
+void vEthSend(uint8_t *pucPayload, uint32_t len) {
+    (void)pucPayload;
+    (void)len;
+}
+
+void vEthRelease(EthDatagram_t *pxDatagram) {
+    (void)pxDatagram;
+}
+
+static EthStats_t xStats;
+
+#endif /* TSE_MAC_BASE */
+
+void vEthGetStats(EthStats_t *pxStats) {
+    *pxStats = xStats;
+}
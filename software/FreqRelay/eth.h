@@ -0,0 +1,128 @@
+/**
+ * UDP over the Triple-Speed Ethernet MAC
+ *
+ * The JTAG UART carries a few tens of kB/s at best, and shares them with
+ * printf; the DE2-115's Ethernet port carries the telemetry stream and a
+ * Modbus command channel instead, when the system has a Triple-Speed
+ * Ethernet MAC with an SGDMA each way (TSE_MAC, SGDMA_TX, SGDMA_RX and
+ * their DESCRIPTOR_MEMORY in system.h). The MAC runs at 100 Mb/s: the PHY
+ * is told not to advertise gigabit, which also bounds the receive
+ * interrupt rate (RTA_ETH_MIN_US).
+ *
+ * The stack is the least that a host on the same segment needs: ARP
+ * (answering for ETH_IP_ADDR, asking for ETH_HOST_IP_ADDR), ICMP echo, and
+ * IPv4 UDP without options or fragments, with the UDP checksum left at 0
+ * (the telemetry frames carry their own CRC). There is no routing; the
+ * host is on the segment.
+ *
+ * Every frame lives in one of ETH_BUFFERS packet buffers from a pool,
+ * D-cache line aligned, and is never copied. The receive SGDMA writes
+ * straight into a free buffer, whose lines were invalidated when it was
+ * armed; the interrupt takes the next free buffer and re-arms, and queues
+ * the full one for the Ethernet task. A received datagram is handed, buffer
+ * and all, to its port's handler; ARP requests and echo requests are
+ * answered in the buffer they came in. Frames to send are built in place
+ * too: pucEthHostBegin() and pucEthReplyBegin() give a buffer with its
+ * headers written and a pointer to the payload, the caller writes the
+ * payload there (the telemetry drain encodes its frames straight into it)
+ * and vEthSend() fills in the lengths and checksum, flushes the lines and
+ * queues it to the transmit SGDMA, whose interrupt frees it once sent.
+ *
+ * The MAC's 16-bit shift is on both ways, so each frame starts 2 bytes
+ * into its buffer and the IP header is word aligned.
+ *
+ * Without the MAC in system.h the functions are stubs and nothing is sent.
+ */
+
+#ifndef ETH_H
+#define ETH_H
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define ETH_IPV4(a, b, c, d)           (((uint32_t)(a) << 24) | ((uint32_t)(b) << 16) | ((c) << 8) | (d))
+
+#ifndef ETH_IP_ADDR
+#define ETH_IP_ADDR                    ETH_IPV4(192, 168, 1, 50)
+#endif
+#ifndef ETH_HOST_IP_ADDR
+#define ETH_HOST_IP_ADDR               ETH_IPV4(192, 168, 1, 10)  // Receives the telemetry
+#endif
+#ifndef ETH_MAC_ADDR
+#define ETH_MAC_ADDR                   { 0x02, 0x46, 0x52, 0x45, 0x4C, 0x01 }  // Locally administered
+#endif
+#ifndef ETH_PHY_ADDR
+#define ETH_PHY_ADDR                   0x10  // The DE2-115's ENET0 PHY on the MDIO bus
+#endif
+
+#define ETH_BUFFERS                    16    // Packet buffers, receive and transmit
+#define ETH_FRAME_BYTES                1536  // Per buffer: 2 byte shift and a 1518 byte frame, whole lines
+#define ETH_FRAME_MAX                  1518
+#define ETH_RX_QUEUE                   8     // Received frames waiting for the task, power of 2
+#define ETH_TX_QUEUE                   8     // Frames waiting for the transmit SGDMA, power of 2
+#define ETH_PORTS                      4     // UDP ports bound
+#define ETH_ARP_RETRY_MS               1000  // Asking for the host while it has not answered
+#define ETH_ARP_REFRESH_MS             60000 // Asking again once it has
+#define ETH_UDP_PAYLOAD_MAX            1472
+
+/* A received UDP datagram, passed to its port's handler in the buffer it
+ * arrived in */
+typedef struct {
+    uint8_t *pucPayload;
+    uint32_t len;
+    uint32_t src_ip;
+    uint16_t src_port;
+    uint16_t dst_port;
+} EthDatagram_t;
+
+/* Called from the Ethernet task, owns the datagram until it goes back
+ * through vEthRelease() */
+typedef void (*EthUdpHandler_t)(EthDatagram_t *pxDatagram);
+
+typedef struct {
+    uint32_t rx_frames;                // Received whole and queued for the task
+    uint32_t rx_errors;                // CRC, overflow or runt, per the SGDMA
+    uint32_t rx_dropped;               // No free buffer or the task behind
+    uint32_t tx_frames;                // Handed to the transmit SGDMA
+    uint32_t tx_dropped;               // Transmit queue full
+    uint32_t no_buffer;                // Nothing free to build a frame in
+    uint32_t udp;                      // Datagrams for a bound port
+    uint32_t no_port;                  // Datagrams for any other
+    uint32_t arp_replies;
+    uint32_t echo_replies;
+    uint8_t host_known;                // The host's MAC address is resolved
+    uint8_t link_mbps;                 // 0 while the link is down
+} EthStats_t;
+
+/* Set the MAC and PHY up and start receiving, before the scheduler starts.
+ * xTask is notified on every frame received and calls vEthService() then
+ * and at least every ETH_ARP_RETRY_MS. Returns 0 on success. */
+int xEthInit(TaskHandle_t xTask);
+
+/* Datagrams to port go to pxHandler. Before the scheduler starts. Returns
+ * 0 on success. */
+int xEthUdpBind(uint16_t port, EthUdpHandler_t pxHandler);
+
+/* Answer or dispatch every frame received, and ask for the host's address
+ * when due. Ethernet task only. */
+void vEthService(uint32_t now_ms);
+
+/* A datagram to the host's port, or back to where pxRequest came from
+ * (before it is released): a buffer with the headers written, returning
+ * where the payload goes and in *pulCap how long it can be. NULL with no
+ * free buffer, or before the host has answered ARP. Any task. */
+uint8_t *pucEthHostBegin(uint16_t port, uint32_t *pulCap);
+uint8_t *pucEthReplyBegin(const EthDatagram_t *pxRequest, uint32_t *pulCap);
+
+/* Send len bytes of payload written at pucPayload (from one of the above),
+ * or give the buffer back with len 0. Any task. */
+void vEthSend(uint8_t *pucPayload, uint32_t len);
+
+/* Give a received datagram's buffer back. Any task. */
+void vEthRelease(EthDatagram_t *pxDatagram);
+
+/* Counters since boot, each word written by one side and read whole */
+void vEthGetStats(EthStats_t *pxStats);
+
+#endif /* ETH_H */
@@ -0,0 +1,362 @@
+/**
+ * Persistent event log in CFI flash
+ *
+ * See event_log.h.
+ */
+
+/* Standard includes */
+#include <stdio.h>
+#include <string.h>
+
+/* Scheduler includes */
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/* Hardware includes */
+#include "system.h"
+#include "sys/alt_irq.h"
+#include "sys/alt_flash.h"
+
+/* Application includes */
+#include "event_log.h"
+#include "seqlock.h"
+#include "time_base.h"
+
+/* First EventRecord_t-sized slot of each sector's header page */
+typedef struct {
+    uint32_t magic;                    // EVENT_LOG_MAGIC
+    uint32_t sequence;                 // Order of use, the highest is the newest
+    uint32_t erase_count;              // Times this sector has been erased
+    uint16_t boot;                     // Boot that started the sector
+    uint16_t check;                    // Low half of ~(magic ^ sequence ^ erase_count ^ boot)
+} EventSectorHeader_t;
+
+/* Same ring as the telemetry: any producer, head claimed with interrupts
+ * masked, the log task is the only consumer */
+typedef struct {
+    uint32_t head;
+    volatile uint32_t tail;
+    uint32_t dropped;
+    uint32_t high_water;               // Most records ever waiting
+    EventRecord_t record[EVENT_LOG_RING_SIZE];
+} EventRing_t;
+
+static EventRing_t xRing;
+static alt_flash_fd *pxFlash = NULL;
+static uint16_t usBoot = 1;
+static volatile int xPaused = 0;
+static volatile int xClosed = 0;       // No usable flash, posts are dropped
+
+/* Log task only: the page being filled and where it will go */
+static EventRecord_t xPage[EVENT_LOG_PAGE_RECORDS];
+static uint32_t ulPageFill = 0;
+static TickType_t xPageStarted;
+static uint32_t ulSector;
+static uint32_t ulPageIndex;           // Next page to program, EVENT_LOG_PAGES when full
+static uint32_t ulSequence;
+static uint32_t ulWritten = 0;
+static uint32_t ulFailed = 0;
+
+/* Newest records the log task has collected, a ring of EVENT_LOG_RECENT
+ * with ulRecentCount the records ever put in */
+static EventRecord_t xRecent[EVENT_LOG_RECENT];
+static uint32_t ulRecentCount = 0;
+static SeqLock_t xRecentSeq = SEQLOCK_INIT;
+
+static int xSectorOffset(uint32_t sector) {
+    return EVENT_LOG_OFFSET + (int)(sector * EVENT_LOG_SECTOR_SIZE);
+}
+
+static uint16_t usHeaderCheck(const EventSectorHeader_t *pxHeader) {
+    return (uint16_t)~(pxHeader->magic ^ pxHeader->sequence ^ pxHeader->erase_count ^ pxHeader->boot);
+}
+
+static int xReadHeader(uint32_t sector, EventSectorHeader_t *pxHeader) {
+    if (alt_read_flash(pxFlash, xSectorOffset(sector), pxHeader, sizeof(EventSectorHeader_t)) != 0) {
+        return 0;
+    }
+    return pxHeader->magic == EVENT_LOG_MAGIC && pxHeader->check == usHeaderCheck(pxHeader);
+}
+
+/* Pages are programmed in order and each starts with a record */
+static int xPageUsed(uint32_t sector, uint32_t page) {
+    EventRecord_t first;
+
+    if (alt_read_flash(pxFlash, xSectorOffset(sector) + (int)(page * EVENT_LOG_PAGE_SIZE),
+                       &first, sizeof(EventRecord_t)) != 0) {
+        return 1;
+    }
+    return first.type != 0xFF;
+}
+
+static int xRecordValid(const EventRecord_t *pxRecord) {
+    const uint8_t *pucByte = (const uint8_t *)pxRecord;
+    uint8_t sum = 0;
+    uint32_t i;
+
+    for (i = 0; i < sizeof(EventRecord_t); i++) {
+        sum += pucByte[i];
+    }
+    return pxRecord->type != 0xFF && sum == 0;
+}
+
+static void vRecordSeal(EventRecord_t *pxRecord) {
+    const uint8_t *pucByte = (const uint8_t *)pxRecord;
+    uint8_t sum = 0;
+    uint32_t i;
+
+    pxRecord->check = 0;
+    for (i = 0; i < sizeof(EventRecord_t); i++) {
+        sum += pucByte[i];
+    }
+    pxRecord->check = (uint8_t)-sum;
+}
+
+/* Erase a sector and make it the one being written. Its erase count carries
+ * over from the old header when that is still readable. */
+static int xStartSector(uint32_t sector) {
+    EventSectorHeader_t header;
+    uint32_t erases = 0;
+    int offset = xSectorOffset(sector);
+
+    if (xReadHeader(sector, &header)) {
+        erases = header.erase_count;
+    }
+    if (alt_erase_flash_block(pxFlash, offset, EVENT_LOG_SECTOR_SIZE) != 0) {
+        return -1;
+    }
+
+    header.magic = EVENT_LOG_MAGIC;
+    header.sequence = ulSequence + 1;
+    header.erase_count = erases + 1;
+    header.boot = usBoot;
+    header.check = usHeaderCheck(&header);
+    if (alt_write_flash_block(pxFlash, offset, offset, &header, sizeof(EventSectorHeader_t)) != 0) {
+        return -1;
+    }
+
+    ulSequence = header.sequence;
+    ulSector = sector;
+    ulPageIndex = 1;
+    return 0;
+}
+
+/* Boot number of the last record in a page */
+static int xLastBoot(uint32_t sector, uint32_t page, uint16_t *pusBoot) {
+    EventRecord_t records[EVENT_LOG_PAGE_RECORDS];
+    int i;
+
+    if (alt_read_flash(pxFlash, xSectorOffset(sector) + (int)(page * EVENT_LOG_PAGE_SIZE),
+                       records, sizeof(records)) != 0) {
+        return 0;
+    }
+    for (i = EVENT_LOG_PAGE_RECORDS - 1; i >= 0; i--) {
+        if (xRecordValid(&records[i])) {
+            *pusBoot = records[i].boot;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int xEventLogInit(void) {
+    flash_region *pxRegions;
+    EventSectorHeader_t header, newest;
+    uint32_t sector, lo, hi, mid, sectors = 0, pages = 0;
+    int regions, i, fits = 0;
+
+    pxFlash = alt_flash_open_dev(FLASH_CONTROLLER_NAME);
+    if (pxFlash == NULL) {
+        printf("Event log: flash not found, events not kept\n");
+        xClosed = 1;
+        return -1;
+    }
+
+    /* The ring relies on one erase block per sector */
+    if (alt_get_flash_info(pxFlash, &pxRegions, &regions) == 0) {
+        for (i = 0; i < regions; i++) {
+            if (pxRegions[i].offset <= EVENT_LOG_OFFSET &&
+                pxRegions[i].offset + pxRegions[i].region_size >= xSectorOffset(EVENT_LOG_SECTORS) &&
+                pxRegions[i].block_size == EVENT_LOG_SECTOR_SIZE) {
+                fits = 1;
+            }
+        }
+    }
+    if (!fits) {
+        printf("Event log: flash geometry does not match, events not kept\n");
+        alt_flash_close_dev(pxFlash);
+        pxFlash = NULL;
+        xClosed = 1;
+        return -1;
+    }
+
+    /* Only the headers are read to find the newest sector */
+    for (sector = 0; sector < EVENT_LOG_SECTORS; sector++) {
+        if (xReadHeader(sector, &header)) {
+            if (sectors == 0 || (int32_t)(header.sequence - newest.sequence) > 0) {
+                newest = header;
+                ulSector = sector;
+            }
+            sectors++;
+        }
+    }
+
+    if (sectors == 0) {
+        ulSequence = 0;
+        if (xStartSector(0) != 0) {
+            printf("Event log: cannot erase flash, events not kept\n");
+            pxFlash = NULL;
+            xClosed = 1;
+            return -1;
+        }
+    } else {
+        ulSequence = newest.sequence;
+
+        /* First erased page of the newest sector, EVENT_LOG_PAGES if full */
+        lo = 1;
+        hi = EVENT_LOG_PAGES;
+        while (lo < hi) {
+            mid = (lo + hi) / 2;
+            if (xPageUsed(ulSector, mid)) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        ulPageIndex = lo;
+        pages = (sectors - 1) * (EVENT_LOG_PAGES - 1) + (lo - 1);
+
+        /* The boot number carries on from the last record kept */
+        if (lo > 1 && xLastBoot(ulSector, lo - 1, &usBoot)) {
+            usBoot++;
+        } else {
+            usBoot = newest.boot + 1;
+        }
+    }
+
+    printf("Event log: boot %u, sector %lu page %lu, %lu pages kept\n", (unsigned int)usBoot,
+           (unsigned long)ulSector, (unsigned long)ulPageIndex, (unsigned long)pages);
+    vEventLogPost(EVENT_BOOT, pages, 0);
+    return 0;
+}
+
+void vEventLogPost(uint8_t type, uint32_t a, uint32_t b) {
+    alt_irq_context context;
+    EventRecord_t *pxRecord;
+    uint32_t uptime_ms;
+
+    if (xClosed || xPaused) {
+        return;
+    }
+
+    /* Same clock as the telemetry, the division kept outside the masked
+     * section */
+    uptime_ms = (uint32_t)(ullTimeToUs(ullTimeNow()) / 1000);
+    context = alt_irq_disable_all();
+    if ((xRing.head - xRing.tail) >= EVENT_LOG_RING_SIZE) {
+        xRing.dropped++;
+    } else {
+        pxRecord = &xRing.record[xRing.head & EVENT_LOG_RING_MASK];
+        pxRecord->type = type;
+        pxRecord->uptime_ms = uptime_ms;
+        pxRecord->a = a;
+        pxRecord->b = b;
+        xRing.head++;
+        if ((xRing.head - xRing.tail) > xRing.high_water) {
+            xRing.high_water = xRing.head - xRing.tail;
+        }
+    }
+    alt_irq_enable_all(context);
+}
+
+void vEventLogPause(int paused) {
+    xPaused = paused;
+}
+
+/* Program the page being filled, moving on to the next sector first if this
+ * one is full. Runs in the log task, so the erase only delays the log. */
+static void vEventLogFlush(void) {
+    int offset;
+
+    if (ulPageIndex >= EVENT_LOG_PAGES && xStartSector((ulSector + 1) % EVENT_LOG_SECTORS) != 0) {
+        ulFailed += ulPageFill;
+        ulPageFill = 0;
+        return;
+    }
+
+    /* Unused slots stay erased */
+    memset(&xPage[ulPageFill], 0xFF, (EVENT_LOG_PAGE_RECORDS - ulPageFill) * sizeof(EventRecord_t));
+
+    offset = xSectorOffset(ulSector);
+    if (alt_write_flash_block(pxFlash, offset, offset + (int)(ulPageIndex * EVENT_LOG_PAGE_SIZE),
+                              xPage, EVENT_LOG_PAGE_SIZE) != 0) {
+        ulFailed += ulPageFill;
+    } else {
+        ulWritten += ulPageFill;
+    }
+
+    /* A failed page is not retried, its slot may be partly programmed */
+    ulPageIndex++;
+    ulPageFill = 0;
+}
+
+void vEventLogService(void) {
+    uint32_t tail;
+
+    if (pxFlash == NULL) {
+        return;
+    }
+
+    tail = xRing.tail;
+    while (tail != xRing.head) {
+        if (ulPageFill == 0) {
+            xPageStarted = xTaskGetTickCount();
+        }
+        xPage[ulPageFill] = xRing.record[tail & EVENT_LOG_RING_MASK];
+        xPage[ulPageFill].boot = usBoot;  // Only known once the log is open
+        vRecordSeal(&xPage[ulPageFill]);
+        vSeqWriteBegin(&xRecentSeq);
+        xRecent[ulRecentCount % EVENT_LOG_RECENT] = xPage[ulPageFill];
+        ulRecentCount++;
+        vSeqWriteEnd(&xRecentSeq);
+        ulPageFill++;
+        xRing.tail = ++tail;
+
+        if (ulPageFill == EVENT_LOG_PAGE_RECORDS) {
+            vEventLogFlush();
+        }
+    }
+
+    if (ulPageFill != 0 && (xTaskGetTickCount() - xPageStarted) >= pdMS_TO_TICKS(EVENT_LOG_FLUSH_MS)) {
+        vEventLogFlush();
+    }
+}
+
+uint32_t ulEventLogWritten(void) {
+    return ulWritten;
+}
+
+uint32_t ulEventLogDropped(void) {
+    return xRing.dropped + ulFailed;
+}
+
+uint32_t ulEventLogHighWater(void) {
+    return xRing.high_water;
+}
+
+uint32_t ulEventLogRecent(EventRecord_t *pxRecords) {
+    EventRecord_t ring[EVENT_LOG_RECENT];
+    uint32_t seq, count, n, i;
+
+    do {
+        seq = ulSeqReadBegin(&xRecentSeq);
+        count = ulRecentCount;
+        memcpy(ring, xRecent, sizeof(ring));
+    } while (xSeqReadRetry(&xRecentSeq, seq));
+
+    n = count < EVENT_LOG_RECENT ? count : EVENT_LOG_RECENT;
+    for (i = 0; i < n; i++) {
+        pxRecords[i] = ring[(count - 1 - i) % EVENT_LOG_RECENT];
+    }
+    return n;
+}
@@ -0,0 +1,92 @@
+/**
+ * Persistent event log in CFI flash
+ *
+ * Shedding, reconnection, fault, failsafe and reset events are appended to a
+ * reserved flash region that survives resets. Posting an event only copies
+ * it into a RAM ring; a background task collects the records into 512 byte
+ * pages and programs each page once, so no control task ever waits on a
+ * program or erase.
+ *
+ * The region is a ring of sectors written in turn, which spreads erases
+ * evenly over all of them. Each sector starts with a header page holding a
+ * sequence number and the sector's erase count. At boot only the headers are
+ * read to find the newest sector, then a binary search over its pages finds
+ * the first erased one, so recovery takes a few dozen reads whatever the size
+ * of the log. When the newest sector is full the oldest is erased and reused.
+ *
+ * A page that was only partly filled when it was flushed keeps its erased
+ * tail; readers stop at the first record of type 0xFF in a page.
+ */
+
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include <stdint.h>
+
+/* Flash region, between the config store (CONFIG_FLASH_OFFSET) and the
+ * policy table (POLICY_FLASH_OFFSET) */
+#define EVENT_LOG_OFFSET               0x700000
+#define EVENT_LOG_SECTORS              15
+#define EVENT_LOG_SECTOR_SIZE          0x10000  // Must match the flash erase block
+#define EVENT_LOG_PAGE_SIZE            512
+#define EVENT_LOG_PAGES                (EVENT_LOG_SECTOR_SIZE / EVENT_LOG_PAGE_SIZE)  // Page 0 is the header
+#define EVENT_LOG_MAGIC                0x45564C47UL  // "EVLG"
+
+#define EVENT_LOG_RING_SIZE            32     // Records waiting for the task, power of 2
+#define EVENT_LOG_RING_MASK            (EVENT_LOG_RING_SIZE - 1)
+#define EVENT_LOG_FLUSH_MS             10000  // Longest a record waits in a part filled page
+#define EVENT_LOG_RECENT               16     // Newest records kept in RAM for the display
+
+/* Event types */
+#define EVENT_BOOT                     1      // a: log pages found at boot
+#define EVENT_SHED                     2      // a: loads shed, b: loads left connected
+#define EVENT_RECONNECT                3      // a: loads reconnected, b: loads connected
+#define EVENT_FAULT                    4      // a: faulty loads, b: actuator feedback
+#define EVENT_FAILSAFE                 5      // a: EVENT_SOURCE_*
+#define EVENT_RESET                    6      // System reset requested
+#define EVENT_DEADLINE                 7      // a: control tasks that missed (ulPeriodControlCheck), b: longest run
+#define EVENT_WARM_BOOT                8      // a: warm restarts since power-up, b: requested << 16 | driven restored
+
+#define EVENT_SOURCE_MONITOR           0      // Persistent feedback mismatch
+#define EVENT_SOURCE_ISR               1      // Failsafe interrupt
+#define EVENT_SOURCE_DEADLINE          2      // Control task missing its deadlines
+#define EVENT_SOURCE_WATCHDOG          3      // Heartbeat missing, b: the missing heartbeats
+#define EVENT_SOURCE_TRIP              4      // Instant under-frequency trip, b: feeder << 16 | period count
+#define EVENT_SOURCE_INTEGRITY         5      // Memory check mismatch, b: regions changed (integrity.h)
+
+typedef struct {
+    uint16_t boot;                     // Boot number, counts up across resets
+    uint8_t type;                      // EVENT_*, 0xFF in an erased slot
+    uint8_t check;                     // Makes the record bytes sum to 0
+    uint32_t uptime_ms;                // Since that boot
+    uint32_t a;
+    uint32_t b;
+} EventRecord_t;
+
+#define EVENT_LOG_PAGE_RECORDS         (EVENT_LOG_PAGE_SIZE / sizeof(EventRecord_t))
+
+/* Find the end of the log and queue the boot record, from the log task
+ * before its first vEventLogService(). Returns 0 if the log is usable.
+ * Events posted before then wait in the ring and go into the log ahead of
+ * the boot record, with the same boot number; if it fails they are
+ * dropped. */
+int xEventLogInit(void);
+
+/* Queue an event, from a task or an ISR. Never blocks. */
+void vEventLogPost(uint8_t type, uint32_t a, uint32_t b);
+
+/* Ignore posts while paused, so benchmark runs stay out of the log */
+void vEventLogPause(int paused);
+
+/* Log task body: collect queued events and program pages when due */
+void vEventLogService(void);
+
+uint32_t ulEventLogWritten(void);
+uint32_t ulEventLogDropped(void);
+uint32_t ulEventLogHighWater(void);    // Most records ever waiting in the ring
+
+/* Copy of up to EVENT_LOG_RECENT of the records collected by the log task,
+ * newest first, boot numbers filled in. Returns how many. Any task. */
+uint32_t ulEventLogRecent(EventRecord_t *pxRecords);
+
+#endif /* EVENT_LOG_H */
@@ -0,0 +1,180 @@
+/**
+ * Frequency excursion events and energy not served
+ *
+ * See excursion.h.
+ */
+
+/* Standard includes */
+#include <string.h>
+
+/* Application includes */
+#include "excursion.h"
+#include "latency.h"
+#include "load_policy.h"
+#include "log_msg.h"
+#include "seqlock.h"
+
+#define EXCURSION_NONE                 0
+#define EXCURSION_UNDER                1
+#define EXCURSION_OVER                 2
+
+typedef struct {
+    uint32_t stamp;                    // Capture of the last sample
+    uint8_t seen;                      // stamp is valid
+    uint8_t open;                      // EXCURSION_*
+    uint8_t deepest;                   // Band reached by the one open
+    uint64_t open_us;                  // Its time so far
+} ExcursionChannel_t;
+
+static const uint32_t ulSpanMs[STATS_LEVELS] = STATS_SPANS_MS;
+
+static SeqLock_t xLock;
+static ExcursionWindow_t xWindow[STATS_LEVELS][2];  // By window number parity
+static ExcursionWindow_t *pxCurrent[STATS_LEVELS];  // This pass's, analyzer only
+static ExcursionChannel_t xChannel[EXCURSION_CHANNELS];
+static TickType_t xLastTick;
+static uint8_t xTicked;                // xLastTick is valid
+static volatile uint32_t ulShed;       // loads << 16 | kW, one word so the analyzer reads it whole
+static uint32_t ulOpen;
+static uint32_t ulTotal;
+
+static void vExcursionEmpty(ExcursionWindow_t *pxWindow, uint32_t number) {
+    memset(pxWindow, 0, sizeof(*pxWindow));
+    pxWindow->number = number;
+}
+
+void vExcursionInit(void) {
+    int level;
+
+    memset(xWindow, 0, sizeof(xWindow));
+    memset(xChannel, 0, sizeof(xChannel));
+    for (level = 0; level < STATS_LEVELS; level++) {
+        xWindow[level][0].number = STATS_NO_WINDOW;
+        xWindow[level][1].number = STATS_NO_WINDOW;
+        pxCurrent[level] = &xWindow[level][0];
+    }
+    xTicked = 0;
+    ulShed = 0;
+    ulOpen = 0;
+    ulTotal = 0;
+}
+
+void vExcursionTick(TickType_t xNow) {
+    uint32_t shed = ulShed, elapsed_ms = xTicked ? (uint32_t)(xNow - xLastTick) : 0, number;
+    int level;
+
+    xLastTick = xNow;
+    xTicked = 1;
+    vSeqWriteBegin(&xLock);
+    for (level = 0; level < STATS_LEVELS; level++) {
+        number = (uint32_t)xNow / ulSpanMs[level];
+        pxCurrent[level] = &xWindow[level][number & 1];
+        if (pxCurrent[level]->number != number) {
+            vExcursionEmpty(pxCurrent[level], number);
+        }
+        pxCurrent[level]->shed_load_ms += (uint64_t)(shed >> 16) * elapsed_ms;
+        pxCurrent[level]->shed_kw_ms += (uint64_t)(shed & 0xFFFF) * elapsed_ms;
+    }
+    vSeqWriteEnd(&xLock);
+}
+
+/* Count the open excursion in the band it got deepest into */
+static void vExcursionClose(uint32_t channel, ExcursionChannel_t *pxChannel) {
+    uint32_t duration_ms = (uint32_t)(pxChannel->open_us / 1000);
+    int level;
+
+    vSeqWriteBegin(&xLock);
+    for (level = 0; level < STATS_LEVELS; level++) {
+        pxCurrent[level]->events[pxChannel->deepest]++;
+        if (duration_ms > pxCurrent[level]->longest_ms) {
+            pxCurrent[level]->longest_ms = duration_ms;
+        }
+    }
+    vSeqWriteEnd(&xLock);
+
+    pxChannel->open = EXCURSION_NONE;
+    ulOpen &= ~(1UL << channel);
+    ulTotal++;
+    vLogPost(LOG_EXCURSION, duration_ms, channel << 8 | pxChannel->deepest);
+}
+
+void vExcursionSample(uint32_t channel, fix16_t freq, fix16_t lower, fix16_t upper, uint32_t stamp) {
+    ExcursionChannel_t *pxChannel;
+    uint32_t elapsed_us = 0, band;
+    int level;
+
+    if (channel >= EXCURSION_CHANNELS) {
+        return;
+    }
+    pxChannel = &xChannel[channel];
+    if (pxChannel->seen) {
+        elapsed_us = ulLatencyElapsedUs(pxChannel->stamp, stamp);
+        if (elapsed_us > EXCURSION_GAP_US) {
+            elapsed_us = 0;
+        }
+    }
+    pxChannel->stamp = stamp;
+    pxChannel->seen = 1;
+
+    /* Close first, so a swing straight past the other limit opens the next */
+    if ((pxChannel->open == EXCURSION_UNDER && freq >= lower + EXCURSION_HYSTERESIS) ||
+        (pxChannel->open == EXCURSION_OVER && freq <= upper - EXCURSION_HYSTERESIS)) {
+        vExcursionClose(channel, pxChannel);
+    }
+
+    /* An excursion's time starts at the sample that opens it */
+    if (pxChannel->open == EXCURSION_NONE) {
+        if (freq < lower) {
+            pxChannel->open = EXCURSION_UNDER;
+            pxChannel->deepest = 0;
+        } else if (freq > upper) {
+            pxChannel->open = EXCURSION_OVER;
+            pxChannel->deepest = EXCURSION_BAND_OVER;
+        } else {
+            return;
+        }
+        pxChannel->open_us = 0;
+        ulOpen |= 1UL << channel;
+        elapsed_us = 0;
+    }
+
+    /* Back inside the limit but not past the hysteresis counts as band 0 */
+    if (pxChannel->open == EXCURSION_OVER) {
+        band = EXCURSION_BAND_OVER;
+    } else {
+        band = ulLoadPolicyCell(pxLoadPolicyGet(), lower - freq, 0) / POLICY_ROC_BANDS;
+        if (band > pxChannel->deepest) {
+            pxChannel->deepest = (uint8_t)band;
+        }
+    }
+    pxChannel->open_us += elapsed_us;
+
+    vSeqWriteBegin(&xLock);
+    for (level = 0; level < STATS_LEVELS; level++) {
+        pxCurrent[level]->band_us[band] += elapsed_us;
+    }
+    vSeqWriteEnd(&xLock);
+}
+
+void vExcursionShed(uint32_t loads, uint32_t kw) {
+    ulShed = (loads > 0xFFFF ? 0xFFFF : loads) << 16 | (kw > 0xFFFF ? 0xFFFF : kw);
+}
+
+int xExcursionGet(int level, int xPrevious, TickType_t xNow, ExcursionWindow_t *pxCopy) {
+    uint32_t number = (uint32_t)xNow / ulSpanMs[level] - (xPrevious ? 1 : 0);
+
+    vSeqRead(&xLock, pxCopy, &xWindow[level][number & 1], sizeof(*pxCopy));
+    if (pxCopy->number != number) {
+        vExcursionEmpty(pxCopy, number);
+        return 0;
+    }
+    return 1;
+}
+
+uint32_t ulExcursionOpen(void) {
+    return ulOpen;
+}
+
+uint32_t ulExcursionTotal(void) {
+    return ulTotal;
+}
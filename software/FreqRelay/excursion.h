@@ -0,0 +1,76 @@
+/**
+ * Frequency excursion events and energy not served
+ *
+ * The analyzer passes every new frequency of every feeder to
+ * vExcursionSample(). An excursion opens at the first sample below the
+ * feeder's lower limit, or above its upper limit, and closes at the first
+ * sample back EXCURSION_HYSTERESIS inside it, so a frequency hovering at
+ * a limit makes one event, not one per sample. While one is open its time
+ * is added to the band of each sample: under-frequency bands 0 to 3 as
+ * the policy table's (load_policy.h), by depth below the lower limit, and
+ * an over-frequency band. A closed excursion counts once, in the deepest
+ * band it reached.
+ *
+ * The time between samples comes from their capture stamps, so it is the
+ * signal's own; a gap longer than EXCURSION_GAP_US (no signal) adds
+ * nothing, and the excursion stays open across it.
+ *
+ * The actuator publishes the loads the decision holds off with
+ * vExcursionShed(), as a count and the registry's kW (load_registry.h, 0
+ * without a registry), and vExcursionTick() adds them times the ticks
+ * since the last pass, at the start of each analyzer pass: load-ms shed
+ * and kW-ms of energy not served. A shed is attributed to the pass after
+ * it, within one analyzer period.
+ *
+ * All of it goes straight into minute, hour and day windows, STATS_LEVELS
+ * and STATS_SPANS_MS as in stream_stats.h, two to a level by window
+ * number. A sample is a few compares and additions to each level; nothing
+ * is kept per sample. Single writer, the analyzer; readers copy a window
+ * under the sequence lock. Each closed excursion is also posted as
+ * LOG_EXCURSION (log_msg.h).
+ */
+
+#ifndef EXCURSION_H
+#define EXCURSION_H
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "fix16.h"
+#include "stream_stats.h"
+
+#define EXCURSION_CHANNELS             8      // Feeders tracked
+#define EXCURSION_BANDS                5      // Policy bands 0-3 below the lower limit, then over
+#define EXCURSION_BAND_OVER            4
+#define EXCURSION_HYSTERESIS           FIX16_CONST(0.05)  // Hz back inside the limit that closes one
+#define EXCURSION_GAP_US               200000UL  // Longer between samples is lost signal, not counted
+
+typedef struct {
+    uint32_t number;                   // tick / span, STATS_NO_WINDOW before the first pass
+    uint32_t events[EXCURSION_BANDS];  // Excursions closed, by the deepest band reached
+    uint64_t band_us[EXCURSION_BANDS]; // Time spent in each band during excursions
+    uint32_t longest_ms;               // Longest excursion closed
+    uint64_t shed_load_ms;             // Loads held off, times ms
+    uint64_t shed_kw_ms;               // Their registry kW, times ms
+} ExcursionWindow_t;
+
+/* Empty every window and feeder. Before the analyzer starts. */
+void vExcursionInit(void);
+
+/* Analyzer, at the start of each pass: the shed since the last one */
+void vExcursionTick(TickType_t xNow);
+
+/* Analyzer: a feeder's new frequency, limits and capture stamp */
+void vExcursionSample(uint32_t channel, fix16_t freq, fix16_t lower, fix16_t upper, uint32_t stamp);
+
+/* Actuator: the loads now held off by the decision and their kW */
+void vExcursionShed(uint32_t loads, uint32_t kw);
+
+/* Copy of the window of a level current at xNow, or with xPrevious the one
+ * before it. Returns 0, the copy emptied, if nothing was added to it. */
+int xExcursionGet(int level, int xPrevious, TickType_t xNow, ExcursionWindow_t *pxCopy);
+
+/* Feeders with an excursion open, a bit each; excursions closed since boot */
+uint32_t ulExcursionOpen(void);
+uint32_t ulExcursionTotal(void);
+
+#endif /* EXCURSION_H */
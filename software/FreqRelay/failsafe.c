@@ -0,0 +1,121 @@
+/**
+ * Failsafe latch
+ *
+ * See failsafe.h.
+ */
+
+/* Scheduler includes */
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/* Hardware includes */
+#include "sys/alt_irq.h"
+
+/* Application includes */
+#include "failsafe.h"
+#include "fast_mem.h"
+#include "journal.h"
+#include "kernel_trace.h"
+#include "load_output.h"
+
+/* Read anywhere, changed only with interrupts masked */
+static FAST_DATA volatile uint32_t ulLatch = 0;
+static FAST_DATA volatile uint32_t ulUnreported = 0;
+static uint32_t ulDetail[FAILSAFE_SOURCES];
+
+static FAST_DATA LoadMask_t xTripLoads;
+static TaskHandle_t xNotifyTask = NULL;
+static uint32_t ulNotifyBits;
+
+void vFailsafeInit(LoadMask_t xLoads, TaskHandle_t xMonitor, uint32_t ulBits) {
+    xTripLoads = xLoads;
+    xNotifyTask = xMonitor;
+    ulNotifyBits = ulBits;
+}
+
+/* The masked part of a trip. Returns the latch as it was. */
+static uint32_t ulFailsafeLatch(uint32_t source, uint32_t detail, int *pxNew) {
+    alt_irq_context context;
+    uint32_t bit = 1UL << source, before;
+
+    context = alt_irq_disable_all();
+    before = ulLatch;
+    vOutputTrip(xTripLoads);
+    *pxNew = (before & bit) == 0;
+    if (*pxNew) {
+        ulLatch = before | bit;
+        ulUnreported |= bit;
+        ulDetail[source] = detail;
+    }
+    alt_irq_enable_all(context);
+
+#if configUSE_KERNEL_TRACE
+    if (before == 0) {
+        vKernelTraceTrigger(source);
+    }
+#endif
+    /* Ignored unless the journal is recording */
+    if (before == 0) {
+        vJournalTrigger(source);
+    }
+    return before;
+}
+
+BaseType_t xFailsafeTrip(uint32_t source, uint32_t detail) {
+    uint32_t before;
+    int xNew;
+
+    if (source >= FAILSAFE_SOURCES) {
+        return pdFALSE;
+    }
+    before = ulFailsafeLatch(source, detail, &xNew);
+    if (xNew && xNotifyTask != NULL) {
+        xTaskNotify(xNotifyTask, ulNotifyBits, eSetBits);
+    }
+    return before == 0 ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xFailsafeTripFromISR(uint32_t source, uint32_t detail, BaseType_t *pxHigherPriorityTaskWoken) {
+    uint32_t before;
+    int xNew;
+
+    if (source >= FAILSAFE_SOURCES) {
+        return pdFALSE;
+    }
+    before = ulFailsafeLatch(source, detail, &xNew);
+    if (xNew && xNotifyTask != NULL) {
+        xTaskNotifyFromISR(xNotifyTask, ulNotifyBits, eSetBits, pxHigherPriorityTaskWoken);
+    }
+    return before == 0 ? pdTRUE : pdFALSE;
+}
+
+uint32_t ulFailsafeLatched(void) {
+    return ulLatch;
+}
+
+uint32_t ulFailsafeTakeUnreported(void) {
+    alt_irq_context context;
+    uint32_t sources;
+
+    if (ulUnreported == 0) {
+        return 0;
+    }
+    context = alt_irq_disable_all();
+    sources = ulUnreported;
+    ulUnreported = 0;
+    alt_irq_enable_all(context);
+    return sources;
+}
+
+uint32_t ulFailsafeDetail(uint32_t source) {
+    return source < FAILSAFE_SOURCES ? ulDetail[source] : 0;
+}
+
+void vFailsafeClear(void) {
+    alt_irq_context context;
+
+    context = alt_irq_disable_all();
+    ulLatch = 0;
+    ulUnreported = 0;
+    alt_irq_enable_all(context);
+}
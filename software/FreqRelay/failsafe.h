@@ -0,0 +1,52 @@
+/**
+ * Failsafe latch
+ *
+ * Every path into failsafe goes through here, from a task or from any ISR
+ * alike. A trip sets its source's bit in one latch word and drives the
+ * failsafe loads onto the output PIO in the same few instructions with
+ * interrupts masked: one IOWR, no lock, queue or kernel object in the way,
+ * so the loads are off microseconds after the trip whoever holds what.
+ *
+ * Everything else is the monitor's, in task context: the trip notifies it
+ * and it collects the sources not yet reported with
+ * ulFailsafeTakeUnreported() to set the state flag, log and display them.
+ * Each source is reported once per latch, by whichever task takes it first
+ * (the watchdog does when the monitor is the task that stopped).
+ *
+ * The latch holds until vFailsafeClear(), the system reset.
+ */
+
+#ifndef FAILSAFE_H
+#define FAILSAFE_H
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "load_mask.h"
+
+#define FAILSAFE_SOURCES               8      // Source numbers, EVENT_SOURCE_* in event_log.h
+
+/* Loads left on by a trip, and the task notified with ulNotifyBits (eSetBits)
+ * after each new source. xMonitor may be NULL for a monitor that polls.
+ * Before the scheduler starts. */
+void vFailsafeInit(LoadMask_t xLoads, TaskHandle_t xMonitor, uint32_t ulNotifyBits);
+
+/* Latch failsafe for source with a detail word for the report (mismatched
+ * loads, missing heartbeats...). Returns pdTRUE if nothing had latched it
+ * before. */
+BaseType_t xFailsafeTrip(uint32_t source, uint32_t detail);
+BaseType_t xFailsafeTripFromISR(uint32_t source, uint32_t detail, BaseType_t *pxHigherPriorityTaskWoken);
+
+/* Sources latched, bit per source, 0 when clear. One word read, any context. */
+uint32_t ulFailsafeLatched(void);
+
+/* Sources latched since the last call, cleared as they are taken */
+uint32_t ulFailsafeTakeUnreported(void);
+
+/* Detail word the source latched with */
+uint32_t ulFailsafeDetail(uint32_t source);
+
+/* Open the latch, from a task. The output command is the caller's. */
+void vFailsafeClear(void);
+
+#endif /* FAILSAFE_H */
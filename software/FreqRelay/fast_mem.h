@@ -0,0 +1,72 @@
+/**
+ * On-chip memory placement
+ *
+ * The BSP links .text into the 200 KB on-chip RAM and everything else into
+ * SDRAM, and with a 2 KB D-cache an ISR or analyzer access that misses pays
+ * the full SDRAM latency. Objects on the interrupt and control path are
+ * tagged with these attributes to move them into on-chip RAM instead.
+ *
+ * The generated linker.x already collects input sections named
+ * onchip_memory.* into its .onchip_memory output section, so these named
+ * sub-sections need no change to BSP-generated files (which would be lost on
+ * regeneration); the names keep the two groups apart in the link map.
+ *
+ * The section is loaded with the program image, not zeroed by crt0, so
+ * tagged objects are initialised explicitly before use.
+ *
+ * Boot: the BSP has alt_load() off and every section's load address is its
+ * run address, so nothing is copied at startup. The image is either
+ * downloaded over JTAG, or its on-chip part comes with the FPGA
+ * configuration (the memory is built with nios2_onchip_memory.hex, from
+ * make mem_init_generate). A stand-alone image that comes back after a
+ * brownout needs .rodata and .rwdata moved to onchip_memory in the BSP
+ * settings as well. Then the SDRAM holds only .bss, which crt0 clears,
+ * the heap and the warm restart snapshot (warm_state.h), and nothing is
+ * copied from the CFI flash or decompressed.
+ * A flash boot copier would copy every section from CFI flash, cold code
+ * included. From main to the first load decision is timed and shown with
+ * the run statistics. Time before main (FPGA configuration, crt0,
+ * alt_sys_init) runs before any timer, so it is measured on a scope:
+ * main turns the red LEDs on first thing.
+ *
+ * Tightly coupled memories: "make tcm" is for a CPU built with an
+ * instruction TCM named tcm_instruction, its exception vector in it, and
+ * a data TCM named tcm_data. The BSP then links .exceptions (the port's
+ * entry, IRQ test, handler and return, and vPortIrqDispatch) into the
+ * instruction TCM. tcm.ld, spliced into linker.x like hot_text.ld, adds
+ * the frequency ISR and the kernel and failsafe calls it makes, and puts
+ * the FAST_ISR_DATA objects and the interrupt stack in the data TCM.
+ * Neither memory goes through a cache, so the VGA task can evict nothing
+ * the frequency interrupt needs. In a normal build these sub-sections are
+ * more of onchip_memory. The instruction TCM's second port must be on the
+ * data master so that nios2-download can write it.
+ */
+
+#ifndef FAST_MEM_H
+#define FAST_MEM_H
+
+#include "system.h"
+
+/* Data touched by ISRs and the analyzer/decision/actuator path */
+#define FAST_DATA                      __attribute__((section("onchip_memory.fast_data")))
+
+/* Constant tables on the same path, kept apart from FAST_DATA as GCC will
+ * not put const and writable objects in one section */
+#define FAST_RODATA                    __attribute__((section("onchip_memory.fast_rodata")))
+
+/* Start on a D-cache line. The cache is direct mapped, so hot state packed
+ * into whole lines takes as few of them as it can and one streaming pass
+ * (the VGA frame) costs the control path a miss per line, not per field. */
+#define CACHE_LINE                     __attribute__((aligned(ALT_CPU_DCACHE_LINE_SIZE)))
+
+/* Task stacks and the interrupt stack. Every interrupt pushes the
+ * interrupted task's context onto its stack before moving to the interrupt
+ * stack. */
+#define FAST_STACK                     __attribute__((section("onchip_memory.fast_stack")))
+
+/* The frequency ISR's own data, the sample rings, and the interrupt stack
+ * (configISR_STACK_SECTION): the data TCM in "make tcm" */
+#define FAST_ISR_DATA                  __attribute__((section("onchip_memory.isr_data")))
+#define FAST_ISR_STACK_SECTION         "onchip_memory.isr_stack"
+
+#endif /* FAST_MEM_H */
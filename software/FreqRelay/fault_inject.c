@@ -0,0 +1,213 @@
+/**
+ * Runtime fault injection for stress runs
+ *
+ * See fault_inject.h.
+ */
+
+/* Scheduler includes */
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/* Hardware includes */
+#include "sys/alt_irq.h"
+
+/* Application includes */
+#include "fault_inject.h"
+#include "latency.h"
+#include "prng.h"
+#include "telemetry.h"
+
+typedef struct {
+    const char *pcName;
+    uint16_t usMax;
+    uint16_t usStep;                   // Keyboard step, 0: a load mask
+} FaultKind_t;
+
+static const FaultKind_t xKinds[FAULT_KINDS] = {
+    { "StuckLow",  0xFFFF,                   0  },
+    { "StuckHigh", 0xFFFF,                   0  },
+    { "FbDelay",   1000,                     5  },
+    { "SmpDrop",   1000,                     10 },
+    { "SmpDup",    1000,                     10 },
+    { "SpurIrq",   5000,                     50 },
+    { "CpuHog",    95,                       5  },
+    { "HogPrio",   configMAX_PRIORITIES - 1, 1  }
+};
+
+static volatile uint16_t usSetting[FAULT_KINDS];
+static uint32_t ulCount[FAULT_KINDS];  // Incremented with interrupts masked
+
+/* Sample faults, drawn from either frequency ISR or the trace replay in the
+ * tick, which the frequency interrupt can preempt: drawn masked */
+static Prng_t xSampleDraws;
+
+/* Tick hook only */
+static uint32_t ulSpuriousBudget;      // Per second interrupts owed, times the tick rate
+
+/* Monitor only: the last two driven values seen and when the last one was */
+static LoadMask_t xPrevDriven;
+static LoadMask_t xLastDriven;
+static TickType_t xDrivenChanged;
+
+static void vFaultOccurred(uint32_t kind, uint32_t times) {
+    alt_irq_context context;
+    uint32_t count;
+
+    context = alt_irq_disable_all();
+    ulCount[kind] += times;
+    count = ulCount[kind];
+    alt_irq_enable_all(context);
+
+    vTelemetryPost(TELEMETRY_INJECT, kind, usSetting[kind], count);
+}
+
+void vFaultInit(uint32_t seed, uint16_t usHogPriority) {
+    uint32_t i;
+
+    for (i = 0; i < FAULT_KINDS; i++) {
+        usSetting[i] = 0;
+        ulCount[i] = 0;
+    }
+    usSetting[FAULT_HOG_PRIORITY] = usHogPriority;
+    vPrngSeed(&xSampleDraws, seed);
+    ulSpuriousBudget = 0;
+}
+
+uint16_t usFaultSet(uint32_t kind, uint32_t value) {
+    if (kind >= FAULT_KINDS) {
+        return 0;
+    }
+    if (value > xKinds[kind].usMax) {
+        value = xKinds[kind].usMax;
+    }
+    if (kind == FAULT_HOG_PRIORITY && value == 0) {
+        value = 1;  // Never down with the idle task
+    }
+    usSetting[kind] = (uint16_t)value;
+    vTelemetryPost(TELEMETRY_INJECT, kind, value, ulCount[kind]);
+    return (uint16_t)value;
+}
+
+uint16_t usFaultStep(uint32_t kind, int step) {
+    int32_t value;
+
+    if (kind >= FAULT_KINDS) {
+        return 0;
+    }
+    value = usSetting[kind];
+    if (xKinds[kind].usStep == 0) {
+        value = step > 0 ? (value << 1) | 1 : value >> 1;
+    } else {
+        value += step * xKinds[kind].usStep;
+    }
+    return usFaultSet(kind, value < 0 ? 0 : (uint32_t)value);
+}
+
+uint16_t usFaultGet(uint32_t kind) {
+    return kind < FAULT_KINDS ? usSetting[kind] : 0;
+}
+
+const char *pcFaultName(uint32_t kind) {
+    return kind < FAULT_KINDS ? xKinds[kind].pcName : "?";
+}
+
+uint32_t ulFaultCount(uint32_t kind) {
+    return kind < FAULT_KINDS ? ulCount[kind] : 0;
+}
+
+LoadMask_t xFaultFeedback(LoadMask_t driven, LoadMask_t actual) {
+    TickType_t xNow = xTaskGetTickCount();
+    uint16_t delay = usSetting[FAULT_FEEDBACK_DELAY];
+    LoadMask_t shown = actual, moving;
+
+    if (driven != xLastDriven) {
+        xPrevDriven = xLastDriven;
+        xLastDriven = driven;
+        xDrivenChanged = xNow;
+    }
+
+    /* Loads still moving show where they were before the change */
+    if (delay != 0 && xNow - xDrivenChanged < pdMS_TO_TICKS(delay)) {
+        moving = xPrevDriven ^ driven;
+        shown = (shown & ~moving) | (xPrevDriven & moving);
+        if (shown != actual) {
+            vFaultOccurred(FAULT_FEEDBACK_DELAY, 1);
+        }
+    }
+
+    if (shown & usSetting[FAULT_STUCK_LOW]) {
+        shown &= (LoadMask_t)~(LoadMask_t)usSetting[FAULT_STUCK_LOW];
+        vFaultOccurred(FAULT_STUCK_LOW, 1);
+    }
+    if (~shown & usSetting[FAULT_STUCK_HIGH]) {
+        shown |= usSetting[FAULT_STUCK_HIGH];
+        vFaultOccurred(FAULT_STUCK_HIGH, 1);
+    }
+    return shown;
+}
+
+uint32_t ulFaultSampleCopies(void) {
+    alt_irq_context context;
+    uint32_t drop = usSetting[FAULT_SAMPLE_DROP];
+    uint32_t dup = usSetting[FAULT_SAMPLE_DUP];
+    uint32_t draw;
+
+    if (drop == 0 && dup == 0) {
+        return 1;
+    }
+    context = alt_irq_disable_all();
+    draw = ulPrngBelow(&xSampleDraws, 1000);
+    alt_irq_enable_all(context);
+
+    if (draw < drop) {
+        vFaultOccurred(FAULT_SAMPLE_DROP, 1);
+        return 0;
+    }
+    if (draw < drop + dup) {
+        vFaultOccurred(FAULT_SAMPLE_DUP, 1);
+        return 2;
+    }
+    return 1;
+}
+
+uint32_t ulFaultSpuriousDue(void) {
+    uint32_t rate = usSetting[FAULT_SPURIOUS_IRQ];
+    uint32_t due;
+
+    if (rate == 0) {
+        ulSpuriousBudget = 0;
+        return 0;
+    }
+    ulSpuriousBudget += rate;
+    due = ulSpuriousBudget / configTICK_RATE_HZ;
+    if (due != 0) {
+        ulSpuriousBudget -= due * configTICK_RATE_HZ;
+        vFaultOccurred(FAULT_SPURIOUS_IRQ, due);
+    }
+    return due;
+}
+
+void vFaultHogTask(void *pvParameters) {
+    TickType_t xLastRelease = xTaskGetTickCount();
+    UBaseType_t uxPriority = usSetting[FAULT_HOG_PRIORITY];
+    uint32_t start, busy;
+
+    (void)pvParameters;
+    for (;;) {
+        vTaskDelayUntil(&xLastRelease, pdMS_TO_TICKS(FAULT_HOG_PERIOD_MS));
+#if INCLUDE_vTaskPrioritySet
+        if (usSetting[FAULT_HOG_PRIORITY] != uxPriority) {
+            uxPriority = usSetting[FAULT_HOG_PRIORITY];
+            vTaskPrioritySet(NULL, uxPriority);
+        }
+#else
+        (void)uxPriority;
+#endif
+
+        /* percent of the period in microseconds is percent * period_ms * 10 */
+        busy = (uint32_t)usSetting[FAULT_CPU_HOG] * FAULT_HOG_PERIOD_MS * 10 * ulLatencyCountsPerUs();
+        start = ulLatencyNow();
+        while (ulLatencyNow() - start < busy) {
+        }
+    }
+}
@@ -0,0 +1,85 @@
+/**
+ * Runtime fault injection for stress runs
+ *
+ * Fault injection builds ("make faults", FREQ_FAULT_INJECT in
+ * hello_freqRelay.c) can disturb the relay while it runs, to see how much
+ * of the control path's latency headroom is left and whether every fault
+ * reaches the monitor. Each fault has one setting, 0 for off:
+ *
+ *   FAULT_STUCK_LOW       loads whose feedback always reads disconnected, mask
+ *   FAULT_STUCK_HIGH      loads whose feedback always reads connected, mask
+ *   FAULT_FEEDBACK_DELAY  ms the feedback of an output change lags, from the
+ *                         first read back after it (a settle time late)
+ *   FAULT_SAMPLE_DROP     frequency samples per thousand thrown away
+ *   FAULT_SAMPLE_DUP      frequency samples per thousand pushed twice
+ *   FAULT_SPURIOUS_IRQ    extra entries per second into feeder 0's frequency
+ *                         ISR, from the tick hook, with no new count behind them
+ *   FAULT_CPU_HOG         percent of each FAULT_HOG_PERIOD_MS the hog task spins
+ *   FAULT_HOG_PRIORITY    priority the hog task spins at
+ *
+ * Settings come from the keyboard (I picks a fault, +/- steps it) or from
+ * the Modbus holding registers at MB_HOLD_FAULT. A setting is one halfword,
+ * written and read whole, so the hooks read it without a lock. Each change
+ * and each occurrence of the sample, interrupt and feedback faults is posted
+ * to telemetry as a TELEMETRY_INJECT record, stamped like any other.
+ *
+ * Random faults draw from their own stream (prng.h) seeded by
+ * vFaultInit(), so the same settings give the same faults from boot.
+ */
+
+#ifndef FAULT_INJECT_H
+#define FAULT_INJECT_H
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "load_mask.h"
+
+#define FAULT_STUCK_LOW                0
+#define FAULT_STUCK_HIGH               1
+#define FAULT_FEEDBACK_DELAY           2
+#define FAULT_SAMPLE_DROP              3
+#define FAULT_SAMPLE_DUP               4
+#define FAULT_SPURIOUS_IRQ             5
+#define FAULT_CPU_HOG                  6
+#define FAULT_HOG_PRIORITY             7
+#define FAULT_KINDS                    8
+
+#define FAULT_HOG_PERIOD_MS            10     // Hog release period, one burst each
+#define FAULT_HOG_STACK                256
+
+/* Reset every setting, seed the random faults and give the hog task its
+ * first priority, before the scheduler starts */
+void vFaultInit(uint32_t seed, uint16_t usHogPriority);
+
+/* Change one setting, clamped to its range, from a task. Returns the value
+ * set. */
+uint16_t usFaultSet(uint32_t kind, uint32_t value);
+
+/* Keyboard step, +1 or -1: the masks gain or lose their top load, the
+ * others move by a step of their own */
+uint16_t usFaultStep(uint32_t kind, int step);
+
+uint16_t usFaultGet(uint32_t kind);
+const char *pcFaultName(uint32_t kind);
+
+/* Times the fault has acted since boot (sample, interrupt and feedback
+ * faults) */
+uint32_t ulFaultCount(uint32_t kind);
+
+/* Monitor hook: the feedback read back as the stuck and delayed loads would
+ * show it, the stuck settings being port 0's loads. Task context, one
+ * caller. */
+LoadMask_t xFaultFeedback(LoadMask_t driven, LoadMask_t actual);
+
+/* Frequency ISR hook: copies of the next sample to push, 0 to 2. Interrupt
+ * context only. */
+uint32_t ulFaultSampleCopies(void);
+
+/* Tick hook: spurious interrupts due this tick */
+uint32_t ulFaultSpuriousDue(void);
+
+/* Hog task, FAULT_HOG_STACK words. Idles at its priority while
+ * FAULT_CPU_HOG is 0. */
+void vFaultHogTask(void *pvParameters);
+
+#endif /* FAULT_INJECT_H */
@@ -0,0 +1,37 @@
+/**
+ * Q16.16 fixed-point helpers for the frequency relay
+ *
+ * The Nios II core has a hardware multiplier and divider but no FPU, so the
+ * control path keeps frequency and rate of change as signed 16.16 integers.
+ * Constants are converted at compile time; doubles are only produced for
+ * human-readable output.
+ */
+
+#ifndef FIX16_H
+#define FIX16_H
+
+#include <stdint.h>
+
+typedef int32_t fix16_t;
+
+#define FIX16_SHIFT                    16
+#define FIX16_ONE                      ((fix16_t)1 << FIX16_SHIFT)
+
+/* Compile-time conversion of a floating point constant (rounded to nearest) */
+#define FIX16_CONST(x)                 ((fix16_t)((x) * 65536.0 + ((x) >= 0 ? 0.5 : -0.5)))
+
+/* Integer conversions */
+#define FIX16_FROM_INT(x)              ((fix16_t)(x) << FIX16_SHIFT)
+#define FIX16_TO_INT(x)                ((x) >> FIX16_SHIFT)
+
+/* Display-only conversion, never use on the control path */
+#define FIX16_TO_DOUBLE(x)             ((double)(x) / 65536.0)
+
+#define FIX16_ABS(x)                   ((x) < 0 ? -(x) : (x))
+
+/* Product of two Q16.16 values, widened so the intermediate cannot overflow */
+static inline fix16_t fix16_mul(fix16_t a, fix16_t b) {
+    return (fix16_t)(((int64_t)a * b) >> FIX16_SHIFT);
+}
+
+#endif /* FIX16_H */
@@ -0,0 +1,46 @@
+/**
+ * Frequency analyser registers
+ *
+ * The analyser in the shipped hardware has a single register, the latest
+ * period count in sample clocks, and raises its interrupt once per period
+ * (FREQUENCY_ANALYSER_SPAN 4).
+ *
+ * A FIFO build of the core shows up as a span of FREQ_ANALYSER_FIFO_SPAN
+ * bytes or more. It queues up to FREQ_ANALYSER_FIFO_DEPTH counts and
+ * raises its interrupt while the queue holds at least THRESHOLD of them,
+ * so the ISR empties a whole batch at once. Word 0 keeps its meaning:
+ * reading it pops the oldest count, and with no FIFO it is the only
+ * counter. The choice is made at compile time, so the per-period build
+ * takes no extra register reads.
+ *
+ * Every feeder's analyser must be the same build.
+ */
+
+#ifndef FREQ_ANALYSER_H
+#define FREQ_ANALYSER_H
+
+#include "system.h"
+#include "io.h"
+
+#define FREQ_ANALYSER_FIFO_SPAN        16
+#define FREQ_ANALYSER_FIFO_DEPTH       16    // Counts the core can hold
+
+#ifndef FREQ_ANALYSER_FIFO
+#define FREQ_ANALYSER_FIFO             (FREQUENCY_ANALYSER_SPAN >= FREQ_ANALYSER_FIFO_SPAN)
+#endif
+
+/* Word offsets */
+#define FREQ_ANALYSER_DATA             0     // Oldest count, popped by the read
+#define FREQ_ANALYSER_LEVEL            1     // Counts held, FIFO build only
+#define FREQ_ANALYSER_THRESHOLD        2     // Interrupt while LEVEL >= this, 1..DEPTH
+#define FREQ_ANALYSER_STATUS           3     // Write 1s to clear
+
+#define FREQ_ANALYSER_STATUS_OVERFLOW  0x01  // A count arrived with the FIFO full
+
+#define IORD_FREQ_ANALYSER_DATA(base)           IORD(base, FREQ_ANALYSER_DATA)
+#define IORD_FREQ_ANALYSER_LEVEL(base)          IORD(base, FREQ_ANALYSER_LEVEL)
+#define IOWR_FREQ_ANALYSER_THRESHOLD(base, n)   IOWR(base, FREQ_ANALYSER_THRESHOLD, n)
+#define IORD_FREQ_ANALYSER_STATUS(base)         IORD(base, FREQ_ANALYSER_STATUS)
+#define IOWR_FREQ_ANALYSER_STATUS(base, mask)   IOWR(base, FREQ_ANALYSER_STATUS, mask)
+
+#endif /* FREQ_ANALYSER_H */
@@ -0,0 +1,173 @@
+/**
+ * Streaming frequency and RoC estimator
+ *
+ * See freq_estimate.h.
+ */
+
+/* Standard includes */
+#include <stddef.h>
+
+/* Application includes */
+#include "freq_estimate.h"
+#include "freq_math.h"
+
+static void vFreqEstReset(FreqEstimator_t *pxEst) {
+#if FREQ_EST_KALMAN
+    pxEst->freq = 0;
+    pxEst->roc = 0;
+#else
+    pxEst->first = 0;
+    pxEst->sum_freq = 0;
+    pxEst->sum_index_freq = 0;
+    pxEst->sum_count = 0;
+#endif
+    pxEst->n = 0;
+    pxEst->jumps = 0;
+}
+
+/* Frequency of one count */
+static inline fix16_t lFreqEstCount(const FreqEstimator_t *pxEst, uint32_t count) {
+    uint32_t index = count - pxEst->table_first;
+
+    if (pxEst->table != NULL && index < FREQ_EST_TABLE_SIZE) {
+        return pxEst->table[index];
+    }
+    if (pxEst->sampling_q16 <= UINT32_MAX) {
+        return (fix16_t)((uint32_t)pxEst->sampling_q16 / count);
+    }
+    return lFreqMathDiv((int64_t)pxEst->sampling_q16, (int32_t)count);
+}
+
+void vFreqEstInit(FreqEstimator_t *pxEst, uint32_t window, uint64_t sampling_q16,
+                  fix16_t min_freq, fix16_t max_freq) {
+    if (window < 2) {
+        window = 2;
+    } else if (window > FREQ_EST_WINDOW_MAX) {
+        window = FREQ_EST_WINDOW_MAX;
+    }
+
+    pxEst->window = window;
+    pxEst->sampling_q16 = sampling_q16;
+    pxEst->min_count = (uint32_t)(sampling_q16 / (uint32_t)max_freq);
+    pxEst->max_count = (uint32_t)(sampling_q16 / (uint32_t)min_freq);
+    pxEst->table = NULL;
+    pxEst->table_first = 0;
+    pxEst->rejected = 0;
+    vFreqEstReset(pxEst);
+}
+
+void vFreqEstTable(FreqEstimator_t *pxEst, const fix16_t *pxTable, uint32_t first) {
+    pxEst->table = pxTable;
+    pxEst->table_first = first;
+}
+
+#if FREQ_EST_KALMAN
+int xFreqEstAdd(FreqEstimator_t *pxEst, uint32_t count, fix16_t *pxFreq, fix16_t *pxRoc) {
+    int32_t fs = (int32_t)(pxEst->sampling_q16 >> FIX16_SHIFT);
+    fix16_t freq, predicted = 0, residual = 0;
+
+    if (count < pxEst->min_count || count > pxEst->max_count) {
+        pxEst->rejected++;
+        return 0;
+    }
+    freq = lFreqEstCount(pxEst, count);
+
+    /* Predict over this period, count / fs seconds long. A residual over
+     * predicted / FREQ_EST_JUMP_DIV is a glitch. */
+    if (pxEst->n != 0) {
+        predicted = pxEst->freq + lFreqMathDiv(llFreqMathMac(0, pxEst->roc, (int32_t)count), fs);
+        residual = freq - predicted;
+        if ((int64_t)FIX16_ABS(residual) * FREQ_EST_JUMP_DIV > predicted) {
+            if (++pxEst->jumps < FREQ_EST_JUMP_REJECTS) {
+                pxEst->rejected++;
+                return 0;
+            }
+            vFreqEstReset(pxEst);
+        }
+    }
+    pxEst->jumps = 0;
+
+    if (pxEst->n == 0) {
+        pxEst->freq = freq;
+        pxEst->roc = 0;
+        pxEst->n = 1;
+    } else if (pxEst->n == 1) {
+        /* The second count starts the RoC from the difference of two */
+        pxEst->roc = lFreqMathDiv(llFreqMathMac(0, freq - pxEst->freq, fs), (int32_t)count);
+        pxEst->freq = freq;
+        pxEst->n = 2;
+    } else {
+        pxEst->freq = predicted + fix16_mul(FREQ_EST_KALMAN_ALPHA, residual);
+        pxEst->roc += lFreqMathDiv(llFreqMathMac(0, fix16_mul(FREQ_EST_KALMAN_BETA, residual), fs),
+                                   (int32_t)count);
+    }
+    *pxFreq = pxEst->freq;
+    *pxRoc = pxEst->roc;
+    return 1;
+}
+#else
+int xFreqEstAdd(FreqEstimator_t *pxEst, uint32_t count, fix16_t *pxFreq, fix16_t *pxRoc) {
+    uint32_t n = pxEst->n;
+    uint32_t slot, deviation;
+    fix16_t freq, oldest;
+    int64_t num;
+
+    if (count < pxEst->min_count || count > pxEst->max_count) {
+        pxEst->rejected++;
+        return 0;
+    }
+
+    /* |count - mean| > mean / FREQ_EST_JUMP_DIV, without the division */
+    if (n >= 2) {
+        deviation = (count * n > pxEst->sum_count) ? count * n - pxEst->sum_count : pxEst->sum_count - count * n;
+        if (deviation * FREQ_EST_JUMP_DIV > pxEst->sum_count) {
+            if (++pxEst->jumps < FREQ_EST_JUMP_REJECTS) {
+                pxEst->rejected++;
+                return 0;
+            }
+            vFreqEstReset(pxEst);
+            n = 0;
+        }
+    }
+    pxEst->jumps = 0;
+
+    freq = lFreqEstCount(pxEst, count);
+
+    /* Slide: dropping the oldest moves every remaining sample one position
+     * closer to 0, which takes the sum of the rest off the index sum */
+    if (n == pxEst->window) {
+        oldest = pxEst->freq[pxEst->first];
+        pxEst->sum_freq -= oldest;
+        pxEst->sum_index_freq -= pxEst->sum_freq;
+        pxEst->sum_count -= pxEst->count[pxEst->first];
+        pxEst->first = (pxEst->first + 1) % pxEst->window;
+        n--;
+    }
+
+    slot = (pxEst->first + n) % pxEst->window;
+    pxEst->count[slot] = count;
+    pxEst->freq[slot] = freq;
+    pxEst->sum_freq += freq;
+    pxEst->sum_index_freq = llFreqMathMac(pxEst->sum_index_freq, (int32_t)n, freq);
+    pxEst->sum_count += count;
+    pxEst->n = ++n;
+
+    if (n < 2) {
+        *pxFreq = freq;
+        *pxRoc = 0;
+        return 1;
+    }
+
+    /* Least squares over positions 0..n-1, with num = 2 * n * covariance:
+     *   slope per period = 6 num / (n (n^2 - 1))
+     *   fitted newest    = mean + slope (n - 1) / 2 = (sum (n + 1) + 3 num) / (n (n + 1))
+     *   RoC (Hz/s)       = slope * n * fs / sum_count = 6 num fs / ((n^2 - 1) sum_count)
+     * sum_freq and both divisors fit 32 bits, see vFreqEstInit() */
+    num = llFreqMathMac(2 * pxEst->sum_index_freq, -(int32_t)(n - 1), (int32_t)pxEst->sum_freq);
+    *pxFreq = lFreqMathDiv(llFreqMathMac(3 * num, (int32_t)pxEst->sum_freq, (int32_t)(n + 1)),
+                           (int32_t)(n * (n + 1)));
+    *pxRoc = lFreqMathDiv(6 * num * (int64_t)(pxEst->sampling_q16 >> FIX16_SHIFT),
+                          (int32_t)((n * n - 1) * pxEst->sum_count));
+    return 1;
+}
+#endif
@@ -0,0 +1,116 @@
+/**
+ * Streaming frequency and RoC estimator
+ *
+ * Keeps the last few period counts from the frequency analyser and fits a
+ * least-squares line to the frequency of each of them against its position
+ * in the window. The frequency reported is the fitted value at the newest
+ * period and the RoC is the fitted slope, so neither lags on a ramp and the
+ * RoC is no longer the difference of two noisy readings.
+ *
+ * Periods are close to equal over a window, so the slope per period is
+ * converted to Hz/s with the mean period of the window. Every update adds
+ * and removes one sample from running sums, whatever the window length.
+ *
+ * Counts of zero or outside the valid range are rejected. A count that
+ * jumps more than 1/FREQ_EST_JUMP_DIV away from the window mean is taken as
+ * a glitch, unless FREQ_EST_JUMP_REJECTS of them arrive in a row, which
+ * restarts the window at the new level.
+ *
+ * FREQ_EST_KALMAN builds replace the fit with a two-state (frequency, RoC)
+ * Kalman filter at its steady-state gains, an alpha-beta filter: each count
+ * predicts the frequency one period on from the RoC, and the residual
+ * corrects the frequency by FREQ_EST_KALMAN_ALPHA and the RoC by
+ * FREQ_EST_KALMAN_BETA per period. It keeps no window and costs a few
+ * multiplies and two divides per count. On the replay's noise scenario its
+ * RoC noise is about a third of an 8 period fit's (1.0 against 2.7 Hz/s
+ * RMS, peaks 3.6 against 11.2). The glitch test is against the predicted
+ * frequency instead of the window mean. The host replay builds either
+ * (make -C sim CFLAGS="-O2 -DFREQ_EST_KALMAN=1") to compare them on a trace.
+ *
+ * One estimator per producer; no locking.
+ */
+
+#ifndef FREQ_ESTIMATE_H
+#define FREQ_ESTIMATE_H
+
+#include <stdint.h>
+#include "fix16.h"
+
+#define FREQ_EST_WINDOW_MAX            32     // Longest window, periods
+#define FREQ_EST_JUMP_DIV              8      // Glitch: more than 1/8 of the mean period away
+#define FREQ_EST_JUMP_REJECTS          2      // Glitches in a row accepted as a real step
+
+#ifndef FREQ_EST_KALMAN
+#define FREQ_EST_KALMAN                0
+#endif
+
+/* Steady-state gains (Q16.16). For the constant-RoC model with white RoC
+ * noise, beta = alpha^2 / (2 - alpha); alpha sets how much one count moves
+ * the estimate, smaller being quieter and slower to follow a step. */
+#define FREQ_EST_KALMAN_ALPHA          FIX16_CONST(0.25)
+#define FREQ_EST_KALMAN_BETA \
+    ((fix16_t)((int64_t)FREQ_EST_KALMAN_ALPHA * FREQ_EST_KALMAN_ALPHA / (2 * FIX16_ONE - FREQ_EST_KALMAN_ALPHA)))
+
+/* Frequencies of FREQ_EST_TABLE_SIZE counts from first, worked out by the
+ * compiler: FREQ_EST_TABLE(name, sampling_q16, first) is the initialiser
+ * of a const fix16_t name[FREQ_EST_TABLE_SIZE], each entry the quotient
+ * the estimator would divide out (sampling_q16 within 32 bits, first > 0).
+ * An estimator given one with vFreqEstTable() takes a count inside it with
+ * a load, and divides only for the counts outside. */
+#define FREQ_EST_TABLE_SIZE            256
+#define FREQ_EST_TABLE(sampling_q16, first) \
+    { FREQ_EST_T64(sampling_q16, first, 0)   FREQ_EST_T64(sampling_q16, first, 64) \
+      FREQ_EST_T64(sampling_q16, first, 128) FREQ_EST_T64(sampling_q16, first, 192) }
+#define FREQ_EST_T1(s, f, n)           (fix16_t)((uint32_t)(s) / ((uint32_t)(f) + (n))),
+#define FREQ_EST_T4(s, f, n) \
+    FREQ_EST_T1(s, f, n) FREQ_EST_T1(s, f, n + 1) FREQ_EST_T1(s, f, n + 2) FREQ_EST_T1(s, f, n + 3)
+#define FREQ_EST_T16(s, f, n) \
+    FREQ_EST_T4(s, f, n) FREQ_EST_T4(s, f, n + 4) FREQ_EST_T4(s, f, n + 8) FREQ_EST_T4(s, f, n + 12)
+#define FREQ_EST_T64(s, f, n) \
+    FREQ_EST_T16(s, f, n) FREQ_EST_T16(s, f, n + 16) FREQ_EST_T16(s, f, n + 32) FREQ_EST_T16(s, f, n + 48)
+
+typedef struct {
+#if FREQ_EST_KALMAN
+    fix16_t freq;                         // At the end of the newest period (Q16.16)
+    fix16_t roc;                          // Hz/s (Q16.16)
+#else
+    uint32_t count[FREQ_EST_WINDOW_MAX];  // Period counts in the window, oldest at first
+    fix16_t freq[FREQ_EST_WINDOW_MAX];    // Frequency of each period (Q16.16)
+    uint32_t first;                       // Slot of the oldest sample
+#endif
+    uint32_t n;                           // Samples in the window
+    uint32_t window;                      // Configured length, 2..FREQ_EST_WINDOW_MAX
+    uint64_t sampling_q16;                // Counts per second (Q16.16)
+    uint32_t min_count;                   // Valid range of counts
+    uint32_t max_count;
+    const fix16_t *table;                 // FREQ_EST_TABLE of counts from table_first, or NULL
+    uint32_t table_first;
+#if !FREQ_EST_KALMAN
+    int64_t sum_freq;                     // Sum of freq[]
+    int64_t sum_index_freq;               // Sum of position * freq[], oldest at 0
+    uint32_t sum_count;                   // Sum of count[]
+#endif
+    uint32_t jumps;                       // Consecutive glitches
+    uint32_t rejected;                    // Counts rejected so far
+} FreqEstimator_t;
+
+/* window is clamped to 2..FREQ_EST_WINDOW_MAX, and unused by the Kalman
+ * filter, which only needs the first two counts. Counts are accepted for
+ * frequencies from min_freq to max_freq. Counts of a clock above 65535 Hz
+ * (zero_cross.h) take a 64-bit divide per count instead of a 32-bit one.
+ * The fit works in 32-bit sums (freq_math.h): window * max_freq must stay
+ * below 32768 Hz, and (window^2 - 1) * window counts of min_freq below
+ * 2^31. */
+void vFreqEstInit(FreqEstimator_t *pxEst, uint32_t window, uint64_t sampling_q16,
+                  fix16_t min_freq, fix16_t max_freq);
+
+/* Look counts from first up in pxTable, a FREQ_EST_TABLE for this
+ * estimator's sampling_q16, instead of dividing. After vFreqEstInit(),
+ * which starts without one. */
+void vFreqEstTable(FreqEstimator_t *pxEst, const fix16_t *pxTable, uint32_t first);
+
+/* Add one period count. Returns 1 and updates *pxFreq and *pxRoc if the
+ * count was accepted; the RoC is 0 until the window holds two periods. */
+int xFreqEstAdd(FreqEstimator_t *pxEst, uint32_t count, fix16_t *pxFreq, fix16_t *pxRoc);
+
+#endif /* FREQ_ESTIMATE_H */
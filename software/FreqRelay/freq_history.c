@@ -0,0 +1,259 @@
+/**
+ * Multi-resolution frequency history
+ *
+ * See freq_history.h.
+ */
+
+/* Standard includes */
+#include <string.h>
+
+/* Application includes */
+#include "freq_history.h"
+#include "seqlock.h"
+
+#if HISTORY_COLUMNS > WINDOW_EXTREMA_SIZE
+#error "The extremes of a level have to span its columns (WINDOW_EXTREMA_SIZE)"
+#endif
+
+typedef struct {
+    fix16_t freq_min;
+    fix16_t freq_max;
+    int64_t freq_sum;
+    fix16_t roc_min;
+    fix16_t roc_max;
+    int64_t roc_sum;
+    uint32_t count;
+    uint16_t y_freq_min;
+    uint16_t y_freq_max;
+    uint16_t y_roc;
+    uint32_t generation;               // Of the axes the rows are on
+} HistoryBucket_t;
+
+typedef struct {
+    SeqLock_t lock;
+    TickType_t column_ticks;           // Time covered by one bucket
+    uint32_t column;                   // Absolute column number of the newest bucket
+    uint32_t head;                     // Ring index of the newest bucket
+    int started;
+    HistoryBucket_t buckets[HISTORY_COLUMNS];
+    WindowExtrema_t freq_window;       // Closed columns in view
+    WindowExtrema_t roc_window;
+} HistoryLevel_t;
+
+static const uint16_t usSpanSeconds[HISTORY_LEVELS] = HISTORY_SPANS_S;
+static HistoryLevel_t xLevels[HISTORY_LEVELS];
+static const HistoryPlot_t *volatile pxPlotAxes;
+
+uint16_t usHistoryAxisRow(const HistoryAxis_t *pxAxis, fix16_t value) {
+    int32_t y = pxAxis->y0 - FIX16_TO_INT(fix16_mul(pxAxis->scale, value - pxAxis->origin));
+
+    if (y < pxAxis->top) {
+        y = pxAxis->top;
+    } else if (y > pxAxis->bottom) {
+        y = pxAxis->bottom;
+    }
+    return (uint16_t)y;
+}
+
+/* The RoC extreme a column plots */
+static inline fix16_t xRocExtreme(fix16_t roc_min, fix16_t roc_max) {
+    return FIX16_ABS(roc_max) >= FIX16_ABS(roc_min) ? roc_max : roc_min;
+}
+
+/* Rows of a bucket's extremes placed again on new axes */
+static void vBucketRows(HistoryBucket_t *pxBucket, const HistoryPlot_t *pxPlot) {
+    pxBucket->y_freq_min = usHistoryAxisRow(&pxPlot->freq, pxBucket->freq_min);
+    pxBucket->y_freq_max = usHistoryAxisRow(&pxPlot->freq, pxBucket->freq_max);
+    pxBucket->y_roc = usHistoryAxisRow(&pxPlot->roc, xRocExtreme(pxBucket->roc_min, pxBucket->roc_max));
+    pxBucket->generation = pxPlot->generation;
+}
+
+static void vColumnRows(HistoryColumn_t *pxColumn, const HistoryPlot_t *pxPlot) {
+    pxColumn->y_freq_min = usHistoryAxisRow(&pxPlot->freq, pxColumn->freq_min);
+    pxColumn->y_freq_max = usHistoryAxisRow(&pxPlot->freq, pxColumn->freq_max);
+    pxColumn->y_roc = usHistoryAxisRow(&pxPlot->roc, xRocExtreme(pxColumn->roc_min, pxColumn->roc_max));
+}
+
+void vHistoryInit(const HistoryPlot_t *pxPlot) {
+    int i;
+
+    memset(xLevels, 0, sizeof(xLevels));
+    pxPlotAxes = pxPlot;
+    for (i = 0; i < HISTORY_LEVELS; i++) {
+        xLevels[i].column_ticks = pdMS_TO_TICKS(usSpanSeconds[i] * 1000UL) / HISTORY_COLUMNS;
+        vWindowExtremaInit(&xLevels[i].freq_window, HISTORY_COLUMNS);
+        vWindowExtremaInit(&xLevels[i].roc_window, HISTORY_COLUMNS);
+    }
+}
+
+void vHistorySetPlot(HistoryPlot_t *pxPlot) {
+    pxPlot->generation = pxPlotAxes->generation + 1;
+    pxPlotAxes = pxPlot;
+}
+
+void vHistoryAdd(fix16_t freq, fix16_t roc, TickType_t xTick) {
+    HistoryLevel_t *pxLevel;
+    HistoryBucket_t *pxBucket;
+    uint32_t column, steps;
+    const HistoryPlot_t *pxPlot = pxPlotAxes;
+    uint16_t y_freq = usHistoryAxisRow(&pxPlot->freq, freq);
+    uint16_t y_roc = usHistoryAxisRow(&pxPlot->roc, roc);
+    int i;
+
+    for (i = 0; i < HISTORY_LEVELS; i++) {
+        pxLevel = &xLevels[i];
+        column = xTick / pxLevel->column_ticks;
+
+        vSeqWriteBegin(&pxLevel->lock);
+        if (!pxLevel->started) {
+            pxLevel->started = 1;
+            pxLevel->column = column;
+        } else if (column != pxLevel->column) {
+            /* The column closing joins the extremes, and those that have
+             * left the plot with the step go */
+            pxBucket = &pxLevel->buckets[pxLevel->head];
+            if (pxBucket->count != 0) {
+                vWindowExtremaAdd(&pxLevel->freq_window, pxLevel->column, pxBucket->freq_min, pxBucket->freq_max);
+                vWindowExtremaAdd(&pxLevel->roc_window, pxLevel->column, pxBucket->roc_min, pxBucket->roc_max);
+            }
+            vWindowExtremaExpire(&pxLevel->freq_window, column);
+            vWindowExtremaExpire(&pxLevel->roc_window, column);
+
+            /* Step the ring forward, leaving empty buckets for any gap */
+            steps = column - pxLevel->column;
+            if (steps > HISTORY_COLUMNS) {
+                steps = HISTORY_COLUMNS;
+            }
+            while (steps--) {
+                pxLevel->head = (pxLevel->head + 1) % HISTORY_COLUMNS;
+                pxLevel->buckets[pxLevel->head].count = 0;
+            }
+            pxLevel->column = column;
+        }
+
+        pxBucket = &pxLevel->buckets[pxLevel->head];
+        if (pxBucket->count == 0) {
+            pxBucket->freq_min = pxBucket->freq_max = freq;
+            pxBucket->roc_min = pxBucket->roc_max = roc;
+            pxBucket->freq_sum = 0;
+            pxBucket->roc_sum = 0;
+            pxBucket->y_freq_min = pxBucket->y_freq_max = y_freq;
+            pxBucket->y_roc = y_roc;
+            pxBucket->generation = pxPlot->generation;
+        } else {
+            if (pxBucket->generation != pxPlot->generation) {
+                vBucketRows(pxBucket, pxPlot);
+            }
+            if (freq < pxBucket->freq_min) {
+                pxBucket->freq_min = freq;
+                pxBucket->y_freq_min = y_freq;
+            }
+            if (freq > pxBucket->freq_max) {
+                pxBucket->freq_max = freq;
+                pxBucket->y_freq_max = y_freq;
+            }
+            if (roc < pxBucket->roc_min || roc > pxBucket->roc_max) {
+                if (roc < pxBucket->roc_min) {
+                    pxBucket->roc_min = roc;
+                } else {
+                    pxBucket->roc_max = roc;
+                }
+                /* A new extreme only moves the plotted one if it is it */
+                if (xRocExtreme(pxBucket->roc_min, pxBucket->roc_max) == roc) {
+                    pxBucket->y_roc = y_roc;
+                }
+            }
+        }
+        pxBucket->freq_sum += freq;
+        pxBucket->roc_sum += roc;
+        pxBucket->count++;
+        vSeqWriteEnd(&pxLevel->lock);
+    }
+}
+
+void vHistorySnapshot(int level, HistoryColumn_t *pxColumns) {
+    const HistoryLevel_t *pxLevel = &xLevels[level];
+    const HistoryBucket_t *pxBucket;
+    const HistoryPlot_t *pxPlot = pxPlotAxes;
+    uint8_t stale[HISTORY_COLUMNS];    // Rows on older axes
+    uint32_t start, oldest;
+    int i;
+
+    do {
+        start = ulSeqReadBegin(&pxLevel->lock);
+        oldest = pxLevel->head + 1;
+        for (i = 0; i < HISTORY_COLUMNS; i++) {
+            pxBucket = &pxLevel->buckets[(oldest + i) % HISTORY_COLUMNS];
+            pxColumns[i].count = pxBucket->count;
+            stale[i] = 0;
+            if (pxBucket->count == 0) {
+                continue;
+            }
+            stale[i] = pxBucket->generation != pxPlot->generation;
+            pxColumns[i].freq_min = pxBucket->freq_min;
+            pxColumns[i].freq_max = pxBucket->freq_max;
+            pxColumns[i].freq_mean = (fix16_t)(pxBucket->freq_sum / (int32_t)pxBucket->count);
+            pxColumns[i].roc_min = pxBucket->roc_min;
+            pxColumns[i].roc_max = pxBucket->roc_max;
+            pxColumns[i].roc_mean = (fix16_t)(pxBucket->roc_sum / (int32_t)pxBucket->count);
+            pxColumns[i].y_freq_min = pxBucket->y_freq_min;
+            pxColumns[i].y_freq_max = pxBucket->y_freq_max;
+            pxColumns[i].y_roc = pxBucket->y_roc;
+        }
+    } while (xSeqReadRetry(&pxLevel->lock, start));
+
+    for (i = 0; i < HISTORY_COLUMNS; i++) {
+        if (stale[i]) {
+            vColumnRows(&pxColumns[i], pxPlot);
+        }
+    }
+}
+
+int xHistoryRange(int level, HistoryRange_t *pxRange) {
+    const HistoryLevel_t *pxLevel = &xLevels[level];
+    const HistoryBucket_t *pxBucket;
+    HistoryRange_t range;
+    uint32_t start;
+    int found;
+
+    do {
+        start = ulSeqReadBegin(&pxLevel->lock);
+        found = xWindowExtremaGet(&pxLevel->freq_window, &range.freq_min, &range.freq_max);
+        (void)xWindowExtremaGet(&pxLevel->roc_window, &range.roc_min, &range.roc_max);
+
+        /* The open column is not in the extremes until it closes */
+        pxBucket = &pxLevel->buckets[pxLevel->head];
+        if (pxBucket->count != 0) {
+            if (!found) {
+                range.freq_min = pxBucket->freq_min;
+                range.freq_max = pxBucket->freq_max;
+                range.roc_min = pxBucket->roc_min;
+                range.roc_max = pxBucket->roc_max;
+                found = 1;
+            } else {
+                range.freq_min = pxBucket->freq_min < range.freq_min ? pxBucket->freq_min : range.freq_min;
+                range.freq_max = pxBucket->freq_max > range.freq_max ? pxBucket->freq_max : range.freq_max;
+                range.roc_min = pxBucket->roc_min < range.roc_min ? pxBucket->roc_min : range.roc_min;
+                range.roc_max = pxBucket->roc_max > range.roc_max ? pxBucket->roc_max : range.roc_max;
+            }
+        }
+    } while (xSeqReadRetry(&pxLevel->lock, start));
+
+    if (found) {
+        *pxRange = range;
+    }
+    return found;
+}
+
+uint32_t ulHistorySpanSeconds(int level) {
+    return usSpanSeconds[level];
+}
+
+void vHistoryPlotRows(HistoryColumn_t *pxColumns, uint32_t count) {
+    const HistoryPlot_t *pxPlot = pxPlotAxes;
+    uint32_t i;
+
+    for (i = 0; i < count; i++) {
+        vColumnRows(&pxColumns[i], pxPlot);
+    }
+}
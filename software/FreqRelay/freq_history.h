@@ -0,0 +1,111 @@
+/**
+ * Multi-resolution frequency history
+ *
+ * Every analysed sample is folded into per-column min/max/mean buckets at
+ * several zoom levels, so the display can show any time span without
+ * recomputing and without aliasing away transients shorter than a frame.
+ * Each level is a ring of HISTORY_COLUMNS buckets covering a fixed span;
+ * the newest bucket is the one currently being filled.
+ *
+ * Each bucket also carries the plot rows of its frequency extremes and of
+ * its larger magnitude RoC extreme, clamped to the plot. A sample's rows
+ * are worked out once as it is added, and a bucket takes them only when
+ * the sample becomes one of its extremes, so drawing a frame does no
+ * arithmetic on the values at all.
+ *
+ * The plot axes can be changed while the history fills (the display scales
+ * them to what it shows). Each bucket notes the axes its rows were placed
+ * on, and one on older axes has its rows placed again from its values: by
+ * the writer, for good, if it is still filling, by the reader in its copy
+ * otherwise, until the column scrolls out. Axes change seldom, and that is
+ * three multiplies a column.
+ *
+ * Each level also keeps the lowest and highest frequency and RoC over the
+ * columns in view, two monotonic deques a side (window_extrema.h) fed as a
+ * column closes, so the range of a level's whole span is there in O(1)
+ * for the display to scale to.
+ *
+ * Single writer (vFrequencyAnalyzerTask), any number of readers; each level
+ * is guarded by its own sequence lock.
+ */
+
+#ifndef FREQ_HISTORY_H
+#define FREQ_HISTORY_H
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "fix16.h"
+#include "window_extrema.h"
+
+#define HISTORY_COLUMNS                100   // One bucket per plot column
+
+/* Zoom levels, shortest span first */
+#define HISTORY_LEVELS                 3
+#define HISTORY_SPANS_S                { 20, 300, 3600 }  // 20 s, 5 min, 1 h
+
+/* Pixel row of a value: y0 - scale * (value - origin), within top..bottom */
+typedef struct {
+    fix16_t origin;
+    fix16_t scale;                     // Pixels per unit
+    int16_t y0;
+    int16_t top;
+    int16_t bottom;
+} HistoryAxis_t;
+
+typedef struct {
+    HistoryAxis_t freq;
+    HistoryAxis_t roc;
+    uint32_t generation;               // Set by vHistorySetPlot
+} HistoryPlot_t;
+
+/* Extremes over a level's span */
+typedef struct {
+    fix16_t freq_min;
+    fix16_t freq_max;
+    fix16_t roc_min;
+    fix16_t roc_max;
+} HistoryRange_t;
+
+/* One plot column as seen by a reader */
+typedef struct {
+    fix16_t freq_min;
+    fix16_t freq_max;
+    fix16_t freq_mean;
+    fix16_t roc_min;
+    fix16_t roc_max;
+    fix16_t roc_mean;
+    uint32_t count;                    // Samples in the column, 0 if none arrived
+    uint16_t y_freq_min;               // Plot rows, see HistoryPlot_t
+    uint16_t y_freq_max;
+    uint16_t y_roc;                    // Of the larger magnitude RoC extreme
+} HistoryColumn_t;
+
+/* Reset all levels, call before the analyzer starts. pxPlot is kept. */
+void vHistoryInit(const HistoryPlot_t *pxPlot);
+
+/* Place the rows on new axes from now on. pxPlot must not be the plot in
+ * use. Display only: the writer runs above it, so the plot replaced is not
+ * read again once this returns and can be filled for the next change. */
+void vHistorySetPlot(HistoryPlot_t *pxPlot);
+
+/* Add one analysed sample taken at xTick */
+void vHistoryAdd(fix16_t freq, fix16_t roc, TickType_t xTick);
+
+/* Copy one level oldest column first into pxColumns[HISTORY_COLUMNS] */
+void vHistorySnapshot(int level, HistoryColumn_t *pxColumns);
+
+/* Extremes of one level over the columns in view. Returns 0 if it has no
+ * samples. */
+int xHistoryRange(int level, HistoryRange_t *pxRange);
+
+/* Time span of a level in seconds */
+uint32_t ulHistorySpanSeconds(int level);
+
+/* Pixel row of a value on one of the axes */
+uint16_t usHistoryAxisRow(const HistoryAxis_t *pxAxis, fix16_t value);
+
+/* Fill in the plot rows of columns that came from elsewhere (the
+ * historian), from their values */
+void vHistoryPlotRows(HistoryColumn_t *pxColumns, uint32_t count);
+
+#endif /* FREQ_HISTORY_H */
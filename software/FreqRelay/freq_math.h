@@ -0,0 +1,68 @@
+/**
+ * Wide arithmetic of the frequency and RoC fit
+ *
+ * The core has a 32-bit hardware multiplier and divider, but no MULX, so
+ * every 32x32->64 product of the estimator's running sums is a __muldi3
+ * call and every quotient of a 64-bit sum a __divdi3 call. This is the one
+ * place those operations are written, so they can go to a custom
+ * instruction where the hardware has one.
+ *
+ * The backend is chosen at compile time from system.h. The BSP generates
+ * ALT_CI_FREQ_MATH(n, A, B) for an extended custom instruction named
+ * freq_math with these functions:
+ *
+ *   FREQ_MATH_CI_MULHI   high word of the signed product A * B
+ *   FREQ_MATH_CI_LOAD    latch the dividend, A low word, B high word
+ *   FREQ_MATH_CI_DIV     latched dividend / A, signed, truncated
+ *
+ * Only the divide keeps state between instructions, so it is issued with
+ * interrupts masked. Any task may use it, and so may an ISR.
+ *
+ * Without the instruction the same results come from plain C, which the
+ * host replay also builds. The results are bit for bit the same as the C.
+ * Quotients must fit 32 bits and divisors must be positive.
+ */
+
+#ifndef FREQ_MATH_H
+#define FREQ_MATH_H
+
+#include <stdint.h>
+#include "system.h"
+
+#ifdef ALT_CI_FREQ_MATH
+#include "sys/alt_irq.h"
+
+#define FREQ_MATH_CI_MULHI             0
+#define FREQ_MATH_CI_LOAD              1
+#define FREQ_MATH_CI_DIV               2
+#endif
+
+/* acc + a * b */
+static inline int64_t llFreqMathMac(int64_t acc, int32_t a, int32_t b) {
+#ifdef ALT_CI_FREQ_MATH
+    uint32_t lo = (uint32_t)a * (uint32_t)b;
+    int32_t hi = ALT_CI_FREQ_MATH(FREQ_MATH_CI_MULHI, a, b);
+
+    return acc + (int64_t)(((uint64_t)(uint32_t)hi << 32) | lo);
+#else
+    return acc + (int64_t)a * b;
+#endif
+}
+
+/* num / den, truncated toward zero. den > 0, quotient within 32 bits. */
+static inline int32_t lFreqMathDiv(int64_t num, int32_t den) {
+#ifdef ALT_CI_FREQ_MATH
+    alt_irq_context context;
+    int32_t quotient;
+
+    context = alt_irq_disable_all();
+    (void)ALT_CI_FREQ_MATH(FREQ_MATH_CI_LOAD, (int32_t)(uint32_t)num, (int32_t)(num >> 32));
+    quotient = ALT_CI_FREQ_MATH(FREQ_MATH_CI_DIV, den, 0);
+    alt_irq_enable_all(context);
+    return quotient;
+#else
+    return (int32_t)(num / den);
+#endif
+}
+
+#endif /* FREQ_MATH_H */
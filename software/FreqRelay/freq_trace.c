@@ -0,0 +1,127 @@
+/**
+ * Synthetic grid event traces
+ *
+ * See freq_trace.h.
+ */
+
+/* Standard includes */
+#include <string.h>
+
+/* Application includes */
+#include "freq_trace.h"
+
+#define TRACE_JITTER                   FIX16_CONST(0.02)  // Background noise, Hz
+#define TRACE_MIN_FREQ                 FIX16_CONST(1.0)   // Floor so a count always exists
+
+/* Scenario windows leave a second of steady signal at each end so the
+ * estimator settles before the event and the staged reconnection can be
+ * seen after it. Bands refer to the default 48.5 Hz lower limit. */
+const TraceScenario_t xTraceScenarios[] = {
+    /* name         type               base                 amount                jitter        period onset length total */
+    { "step-2",     TRACE_STEP,        FIX16_CONST(50.0), FIX16_CONST(2.0),     TRACE_JITTER, 0,   1000, 3000, 8000 },   // Minor band
+    { "step-4",     TRACE_STEP,        FIX16_CONST(50.0), FIX16_CONST(4.0),     TRACE_JITTER, 0,   1000, 3000, 8000 },   // Severe band
+    { "ramp-1",     TRACE_RAMP,        FIX16_CONST(50.0), FIX16_CONST(-1.0),    TRACE_JITTER, 0,   1000, 4000, 12000 },  // Through every band
+    { "ramp-5",     TRACE_RAMP,        FIX16_CONST(50.0), FIX16_CONST(-5.0),    TRACE_JITTER, 0,   1000, 800,  6000 },
+    { "ramp-50",    TRACE_RAMP,        FIX16_CONST(50.0), FIX16_CONST(-50.0),   TRACE_JITTER, 0,   1000, 80,   5000 },   // RoC just under the limit
+    { "ramp-100",   TRACE_RAMP,        FIX16_CONST(50.0), FIX16_CONST(-100.0),  TRACE_JITTER, 0,   1000, 40,   5000 },   // RoC over the limit
+    { "osc-2hz",    TRACE_OSCILLATION, FIX16_CONST(50.0), FIX16_CONST(0.8),     TRACE_JITTER, 500, 1000, 4000, 8000 },
+    { "noise",      TRACE_NOISE,       FIX16_CONST(50.0), FIX16_CONST(1.5),     TRACE_JITTER, 0,   1000, 2000, 6000 },
+    { "noise-burst",TRACE_NOISE,       FIX16_CONST(50.0), FIX16_CONST(5.0),     TRACE_JITTER, 0,   1000, 300,  4000 }    // Worst case evaluation load
+};
+
+const uint32_t ulTraceScenarioCount = sizeof(xTraceScenarios) / sizeof(xTraceScenarios[0]);
+
+/* One cycle, Q1.15 */
+static const int16_t sSine[64] = {
+         0,   3212,   6393,   9512,  12539,  15446,  18204,  20787,
+     23170,  25329,  27245,  28898,  30273,  31356,  32137,  32609,
+     32767,  32609,  32137,  31356,  30273,  28898,  27245,  25329,
+     23170,  20787,  18204,  15446,  12539,   9512,   6393,   3212,
+         0,  -3212,  -6393,  -9512, -12539, -15446, -18204, -20787,
+    -23170, -25329, -27245, -28898, -30273, -31356, -32137, -32609,
+    -32767, -32609, -32137, -31356, -30273, -28898, -27245, -25329,
+    -23170, -20787, -18204, -15446, -12539,  -9512,  -6393,  -3212
+};
+
+const TraceScenario_t *pxTraceScenarioFind(const char *pcName) {
+    uint32_t i;
+
+    for (i = 0; i < ulTraceScenarioCount; i++) {
+        if (strcmp(xTraceScenarios[i].name, pcName) == 0) {
+            return &xTraceScenarios[i];
+        }
+    }
+    return NULL;
+}
+
+void vTraceGenStart(TraceGen_t *pxGen, const TraceScenario_t *pxScenario, uint32_t sampling_hz,
+                    uint32_t seed) {
+    pxGen->pxScenario = pxScenario;
+    pxGen->sampling_hz = sampling_hz;
+    pxGen->elapsed = 0;
+    vPrngSeed(&pxGen->xNoise, seed);
+}
+
+/* Triangular noise in (-1, 1), Q16.16, the sum of two uniform draws */
+static fix16_t xTraceNoise(TraceGen_t *pxGen) {
+    int32_t sum;
+
+    sum = (int32_t)(ulPrngNext(&pxGen->xNoise) >> 16) - 32768;
+    sum += (int32_t)(ulPrngNext(&pxGen->xNoise) >> 16) - 32768;
+    return sum;
+}
+
+static fix16_t xScale(fix16_t amount, int32_t factor_q16) {
+    return (fix16_t)(((int64_t)amount * factor_q16) >> FIX16_SHIFT);
+}
+
+int xTraceGenNext(TraceGen_t *pxGen, uint32_t *pulCount) {
+    const TraceScenario_t *pxScenario = pxGen->pxScenario;
+    uint32_t t_ms = (uint32_t)((uint64_t)pxGen->elapsed * 1000 / pxGen->sampling_hz);
+    uint32_t dt_ms;
+    fix16_t freq = pxScenario->base;
+
+    if (t_ms >= pxScenario->total_ms) {
+        return 0;
+    }
+
+    if (t_ms >= pxScenario->onset_ms) {
+        dt_ms = t_ms - pxScenario->onset_ms;
+        switch (pxScenario->type) {
+        case TRACE_STEP:
+            if (dt_ms < pxScenario->length_ms) {
+                freq -= pxScenario->amount;
+            }
+            break;
+        case TRACE_RAMP:
+            if (dt_ms < pxScenario->length_ms) {
+                freq += (fix16_t)((int64_t)pxScenario->amount * dt_ms / 1000);
+            } else if (dt_ms < 2 * pxScenario->length_ms) {
+                freq += (fix16_t)((int64_t)pxScenario->amount * (2 * pxScenario->length_ms - dt_ms) / 1000);
+            }
+            break;
+        case TRACE_OSCILLATION:
+            if (dt_ms < pxScenario->length_ms) {
+                freq += xScale(pxScenario->amount, (int32_t)sSine[(dt_ms * 64 / pxScenario->period_ms) & 63] * 2);
+            }
+            break;
+        case TRACE_NOISE:
+            if (dt_ms < pxScenario->length_ms) {
+                freq += xScale(pxScenario->amount, xTraceNoise(pxGen));
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    freq += xScale(pxScenario->jitter, xTraceNoise(pxGen));
+    if (freq < TRACE_MIN_FREQ) {
+        freq = TRACE_MIN_FREQ;
+    }
+
+    /* Rounded, as the analyser counts whole sample periods */
+    *pulCount = (uint32_t)((((uint64_t)pxGen->sampling_hz << FIX16_SHIFT) + (uint32_t)freq / 2) / (uint32_t)freq);
+    pxGen->elapsed += *pulCount;
+    return 1;
+}
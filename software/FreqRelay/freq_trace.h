@@ -0,0 +1,63 @@
+/**
+ * Synthetic grid event traces
+ *
+ * Generates the period counts the frequency analyser would produce for a
+ * scripted event: a step drop, a ramp down and back, an oscillation or a
+ * noise burst, on top of a small background jitter. The generator is
+ * deterministic for a given seed (prng.h) and uses no floating point, so the same
+ * scenarios replay bit for bit on the target (FREQ_TRACE_REPLAY in
+ * hello_freqRelay.c) and in the host replay (sim/replay -g).
+ *
+ * Within the event window [onset_ms, onset_ms + length_ms) the frequency is
+ *   TRACE_STEP         base - amount
+ *   TRACE_RAMP         base + amount * t, amount in Hz/s, then back at the
+ *                      same rate over a second window of the same length
+ *   TRACE_OSCILLATION  base + amount * sin(2 pi t / period_ms)
+ *   TRACE_NOISE        base + amount * noise, noise in (-1, 1)
+ * and base outside it.
+ */
+
+#ifndef FREQ_TRACE_H
+#define FREQ_TRACE_H
+
+#include <stdint.h>
+#include "fix16.h"
+#include "prng.h"
+
+#define TRACE_STEP                     1
+#define TRACE_RAMP                     2
+#define TRACE_OSCILLATION              3
+#define TRACE_NOISE                    4
+
+typedef struct {
+    const char *name;
+    uint8_t type;                      // TRACE_*
+    fix16_t base;                      // Hz outside the event
+    fix16_t amount;                    // Hz, or Hz/s for TRACE_RAMP, see above
+    fix16_t jitter;                    // Peak background noise, Hz
+    uint32_t period_ms;                // TRACE_OSCILLATION only
+    uint32_t onset_ms;
+    uint32_t length_ms;
+    uint32_t total_ms;                 // Length of the whole trace
+} TraceScenario_t;
+
+typedef struct {
+    const TraceScenario_t *pxScenario;
+    uint32_t sampling_hz;              // Analyser count rate
+    uint32_t elapsed;                  // Counts generated so far
+    Prng_t xNoise;                     // Seeded by vTraceGenStart()
+} TraceGen_t;
+
+extern const TraceScenario_t xTraceScenarios[];
+extern const uint32_t ulTraceScenarioCount;
+
+/* Built-in scenario by name, NULL if there is none */
+const TraceScenario_t *pxTraceScenarioFind(const char *pcName);
+
+void vTraceGenStart(TraceGen_t *pxGen, const TraceScenario_t *pxScenario, uint32_t sampling_hz,
+                    uint32_t seed);
+
+/* Next period count. Returns 0 once the trace has ended. Safe from an ISR. */
+int xTraceGenNext(TraceGen_t *pxGen, uint32_t *pulCount);
+
+#endif /* FREQ_TRACE_H */
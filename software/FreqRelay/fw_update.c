@@ -0,0 +1,409 @@
+/**
+ * Dual-bank firmware update in CFI flash
+ *
+ * See fw_update.h.
+ */
+
+/* Standard includes */
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Scheduler includes */
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/* Hardware includes */
+#include "system.h"
+#include "sys/alt_cache.h"
+#include "sys/alt_irq.h"
+#include "sys/alt_flash.h"
+
+/* Application includes */
+#include "crc32.h"
+#include "fw_update.h"
+
+#define FW_PAGE_MASK                   (FW_PAGES - 1)
+#define FW_READ_CHUNK                  256
+
+#if FW_SELECT_SLOT_SIZE < 32 || (FW_SELECT_SLOT_SIZE & (FW_SELECT_SLOT_SIZE - 1))
+#error FW_SELECT_SLOT_SIZE must be a power of 2 that holds a FwSelect_t
+#endif
+
+static alt_flash_fd *pxFlash = NULL;
+static flash_region *pxRegions;
+static int iRegions;
+
+/* Selector, flash task only after init */
+static uint32_t ulSelectSector;
+static uint32_t ulSelectSlot;          // FW_SELECT_SLOTS when the sector is full
+static uint32_t ulSelectSequence = 0;
+static uint8_t ucRunningBank = 0;
+
+/* Session. The sender owns state on the way in (xFwUpdateBegin) and the
+ * head side of the pages; the flash task owns state from then on and the
+ * tail side. */
+static volatile uint8_t ucState = FW_IDLE;
+static volatile uint8_t ucAbort = 0;
+static volatile uint8_t ucReboot = 0;
+static uint8_t ucTargetBank;
+static uint32_t ulLength;
+static uint32_t ulImageCrc;
+
+static uint8_t ucPage[FW_PAGES][FW_PAGE_SIZE];
+static uint16_t usPageLen[FW_PAGES];
+static volatile uint32_t ulHead;       // Sender: pages filled
+static volatile uint32_t ulTail;       // Flash task: pages programmed
+static uint32_t ulFill;                // Sender: bytes in the page at head
+static volatile uint32_t ulReceived;
+
+/* Flash task only */
+static uint32_t ulErased;              // Bytes of the bank erased
+static volatile uint32_t ulProgrammed;
+static uint32_t ulVerified;
+static uint32_t ulCrc;
+static uint8_t ucReadBuf[FW_READ_CHUNK];
+static uint32_t ulUpdates = 0;
+static uint32_t ulErrors = 0;
+
+/* The erase block holding offset: its start in *pxStart and its size,
+ * 0 outside the flash */
+static uint32_t ulBlockAt(int offset, int *pxStart) {
+    int i, index;
+
+    for (i = 0; i < iRegions; i++) {
+        if (offset >= pxRegions[i].offset && offset < pxRegions[i].offset + pxRegions[i].region_size) {
+            index = (offset - pxRegions[i].offset) / pxRegions[i].block_size;
+            *pxStart = pxRegions[i].offset + index * pxRegions[i].block_size;
+            return (uint32_t)pxRegions[i].block_size;
+        }
+    }
+    return 0;
+}
+
+static int xSlotOffset(uint32_t sector, uint32_t slot) {
+    return FW_SELECT_OFFSET + (int)(sector * FW_SELECT_SECTOR_SIZE + slot * FW_SELECT_SLOT_SIZE);
+}
+
+static int xSelectValid(const FwSelect_t *pxSelect) {
+    return pxSelect->magic == FW_SELECT_MAGIC && pxSelect->bank < FW_BANKS &&
+           pxSelect->length <= FW_BANK_SIZE &&
+           pxSelect->crc == ulCrc32((const uint8_t *)pxSelect, offsetof(FwSelect_t, crc));
+}
+
+/* Slots are programmed in order, magic first */
+static int xSlotUsed(uint32_t sector, uint32_t slot) {
+    uint32_t magic;
+
+    if (alt_read_flash(pxFlash, xSlotOffset(sector, slot), &magic, sizeof(magic)) != 0) {
+        return 1;
+    }
+    return magic != 0xFFFFFFFFUL;
+}
+
+/* Append a record, erasing the other sector first if this one is full, as
+ * the config store does */
+static int xSelectWrite(const FwSelect_t *pxSelect) {
+    FwSelect_t check;
+    uint32_t sector = ulSelectSector;
+    int offset;
+
+    if (ulSelectSlot >= FW_SELECT_SLOTS) {
+        sector = (ulSelectSector + 1) % FW_SELECT_SECTORS;
+        if (alt_erase_flash_block(pxFlash, xSlotOffset(sector, 0), FW_SELECT_SECTOR_SIZE) != 0) {
+            return -1;
+        }
+        ulSelectSector = sector;
+        ulSelectSlot = 0;
+    }
+
+    offset = xSlotOffset(sector, ulSelectSlot);
+    ulSelectSlot++;
+    if (alt_write_flash_block(pxFlash, xSlotOffset(sector, 0), offset, pxSelect, sizeof(FwSelect_t)) != 0 ||
+        alt_read_flash(pxFlash, offset, &check, sizeof(check)) != 0 ||
+        memcmp(&check, pxSelect, sizeof(FwSelect_t)) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+int xFwUpdateInit(void) {
+    FwSelect_t select, newest;
+    uint32_t sector, lo, hi, mid, slot;
+    int start, found = 0, fits = 0, i;
+
+    pxFlash = alt_flash_open_dev(FLASH_CONTROLLER_NAME);
+    if (pxFlash == NULL) {
+        printf("Firmware: flash not found, updates refused\n");
+        return -1;
+    }
+
+    /* Both banks in the flash, the selector a whole erase block a sector */
+    if (alt_get_flash_info(pxFlash, &pxRegions, &iRegions) == 0) {
+        for (i = 0; i < iRegions; i++) {
+            if (pxRegions[i].offset <= FW_SELECT_OFFSET &&
+                pxRegions[i].offset + pxRegions[i].region_size >= xSlotOffset(FW_SELECT_SECTORS, 0) &&
+                pxRegions[i].block_size == FW_SELECT_SECTOR_SIZE) {
+                fits = 1;
+            }
+        }
+        fits = fits && ulBlockAt(FW_BANK_FIRST, &start) != 0 && start == FW_BANK_FIRST &&
+               ulBlockAt(FW_BANK_OFFSET(FW_BANKS) - 1, &start) != 0;
+    }
+    if (!fits) {
+        printf("Firmware: flash geometry does not match, updates refused\n");
+        alt_flash_close_dev(pxFlash);
+        pxFlash = NULL;
+        return -1;
+    }
+
+    /* First record after a blank or corrupt selector erases sector 0 */
+    ulSelectSector = FW_SELECT_SECTORS - 1;
+    ulSelectSlot = FW_SELECT_SLOTS;
+
+    for (sector = 0; sector < FW_SELECT_SECTORS; sector++) {
+        lo = 0;
+        hi = FW_SELECT_SLOTS;
+        while (lo < hi) {
+            mid = (lo + hi) / 2;
+            if (xSlotUsed(sector, mid)) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        for (slot = lo; slot > 0; slot--) {
+            if (alt_read_flash(pxFlash, xSlotOffset(sector, slot - 1), &select, sizeof(select)) == 0 &&
+                xSelectValid(&select)) {
+                if (!found || (int32_t)(select.sequence - newest.sequence) > 0) {
+                    newest = select;
+                    ulSelectSector = sector;
+                    ulSelectSlot = lo;
+                    found = 1;
+                }
+                break;
+            }
+        }
+    }
+
+    if (found) {
+        ulSelectSequence = newest.sequence;
+        ucRunningBank = (uint8_t)newest.bank;
+    }
+    printf("Firmware: bank %u, selector record %lu\n", (unsigned int)ucRunningBank,
+           (unsigned long)ulSelectSequence);
+    return 0;
+}
+
+int xFwUpdateBegin(uint32_t length, uint32_t image_crc) {
+    uint8_t state = ucState;
+
+    /* The same again before any data, from a sender whose reply was lost */
+    if (state == FW_RECEIVING && !ucAbort && length == ulLength && image_crc == ulImageCrc &&
+        ulReceived == 0) {
+        return 0;
+    }
+    if (pxFlash == NULL || length == 0 || length > FW_BANK_SIZE || ucAbort ||
+        state == FW_RECEIVING || state == FW_VERIFYING) {
+        return -1;
+    }
+
+    /* The flash task leaves the session alone in every other state */
+    ucReboot = 0;
+    ucTargetBank = (uint8_t)(ucRunningBank ^ 1);
+    ulLength = length;
+    ulImageCrc = image_crc;
+    ulHead = 0;
+    ulTail = 0;
+    ulFill = 0;
+    ulReceived = 0;
+    ulErased = 0;
+    ulProgrammed = 0;
+    ucState = FW_RECEIVING;
+    return 0;
+}
+
+int xFwUpdateWrite(uint32_t offset, const uint8_t *pucData, uint32_t len) {
+    uint32_t received = ulReceived, index, n;
+
+    if (ucState != FW_RECEIVING || ucAbort) {
+        return FW_WRITE_REFUSED;
+    }
+    if (offset + len <= received) {
+        return FW_WRITE_OK;
+    }
+    if (offset != received || len > ulLength - offset) {
+        return FW_WRITE_REFUSED;
+    }
+
+    /* All of the chunk or none of it */
+    if ((ulFill + len + FW_PAGE_SIZE - 1) / FW_PAGE_SIZE > FW_PAGES - (ulHead - ulTail)) {
+        return FW_WRITE_BUSY;
+    }
+    while (len > 0) {
+        index = ulHead & FW_PAGE_MASK;
+        n = FW_PAGE_SIZE - ulFill < len ? FW_PAGE_SIZE - ulFill : len;
+        memcpy(&ucPage[index][ulFill], pucData, n);
+        ulFill += n;
+        pucData += n;
+        len -= n;
+        received += n;
+        if (ulFill == FW_PAGE_SIZE || received == ulLength) {
+            usPageLen[index] = (uint16_t)ulFill;
+            ulHead++;
+            ulFill = 0;
+        }
+    }
+    ulReceived = received;
+    return FW_WRITE_OK;
+}
+
+void vFwUpdateAbort(void) {
+    if (ucState == FW_RECEIVING || ucState == FW_VERIFYING) {
+        ucAbort = 1;
+    } else if (ucState == FW_READY) {
+        ucReboot = 0;
+    }
+}
+
+int xFwUpdateReboot(void) {
+    if (ucState != FW_READY || ucAbort) {
+        return -1;
+    }
+    ucReboot = 1;
+    return 0;
+}
+
+static void vFwFail(void) {
+    ulErrors++;
+    ucState = FW_FAILED;
+}
+
+/* As from the reset address, with the caches written back for the boot
+ * copier */
+static void vFwRestart(void) {
+    (void)alt_irq_disable_all();
+    alt_dcache_flush_all();
+    alt_icache_flush_all();
+    ((void (*)(void))NIOS2_RESET_ADDR)();
+}
+
+/* Erase the next block of the bank, or program what pages wait */
+static void vFwProgram(void) {
+    int bank = FW_BANK_OFFSET(ucTargetBank), offset, start;
+    uint32_t size, index, i;
+
+    if (ulErased < ulLength) {
+        size = ulBlockAt(bank + (int)ulErased, &start);
+        if (size == 0 || alt_erase_flash_block(pxFlash, start, (int)size) != 0) {
+            vFwFail();
+            return;
+        }
+        ulErased = (uint32_t)(start - bank) + size;
+        return;
+    }
+
+    for (i = 0; i < FW_PAGES_PER_SERVICE && ulTail != ulHead; i++) {
+        index = ulTail & FW_PAGE_MASK;
+        offset = bank + (int)ulProgrammed;
+        if (ulBlockAt(offset, &start) == 0 ||
+            alt_write_flash_block(pxFlash, start, offset, ucPage[index], usPageLen[index]) != 0) {
+            vFwFail();
+            return;
+        }
+        ulProgrammed += usPageLen[index];
+        ulTail++;
+    }
+
+    if (ulProgrammed == ulLength) {
+        ulVerified = 0;
+        ulCrc = CRC32_INIT;
+        ucState = FW_VERIFYING;
+    }
+}
+
+/* CRC of the next FW_VERIFY_BYTES as the flash holds them */
+static void vFwVerify(void) {
+    int bank = FW_BANK_OFFSET(ucTargetBank);
+    uint32_t end = ulVerified + FW_VERIFY_BYTES, n;
+
+    if (end > ulLength) {
+        end = ulLength;
+    }
+    while (ulVerified < end) {
+        n = end - ulVerified < FW_READ_CHUNK ? end - ulVerified : FW_READ_CHUNK;
+        if (alt_read_flash(pxFlash, bank + (int)ulVerified, ucReadBuf, (int)n) != 0) {
+            vFwFail();
+            return;
+        }
+        ulCrc = ulCrc32Update(ulCrc, ucReadBuf, n);
+        ulVerified += n;
+    }
+
+    if (ulVerified == ulLength) {
+        if (~ulCrc == ulImageCrc) {
+            ulUpdates++;
+            ucState = FW_READY;
+        } else {
+            vFwFail();
+        }
+    }
+}
+
+/* Select the verified bank, then restart into it */
+static void vFwSwitch(void) {
+    FwSelect_t select;
+
+    select.magic = FW_SELECT_MAGIC;
+    select.sequence = ulSelectSequence + 1;
+    select.bank = ucTargetBank;
+    select.length = ulLength;
+    select.image_crc = ulImageCrc;
+    select.crc = ulCrc32((const uint8_t *)&select, offsetof(FwSelect_t, crc));
+
+    ucReboot = 0;
+    if (xSelectWrite(&select) != 0) {
+        vFwFail();
+        return;
+    }
+    ulSelectSequence = select.sequence;
+    vFwRestart();
+}
+
+void vFwUpdateService(void) {
+    if (pxFlash == NULL) {
+        return;
+    }
+    if (ucAbort) {
+        ucState = FW_IDLE;
+        ucAbort = 0;
+        return;
+    }
+
+    switch (ucState) {
+    case FW_RECEIVING:
+        vFwProgram();
+        break;
+    case FW_VERIFYING:
+        vFwVerify();
+        break;
+    case FW_READY:
+        if (ucReboot) {
+            vFwSwitch();
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void vFwUpdateGetStatus(FwUpdateStatus_t *pxStatus) {
+    pxStatus->state = ucState;
+    pxStatus->running_bank = ucRunningBank;
+    pxStatus->target_bank = ucTargetBank;
+    pxStatus->length = ulLength;
+    pxStatus->received = ulReceived;
+    pxStatus->programmed = ulProgrammed;
+    pxStatus->updates = ulUpdates;
+    pxStatus->errors = ulErrors;
+}
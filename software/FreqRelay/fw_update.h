@@ -0,0 +1,121 @@
+/**
+ * Dual-bank firmware update in CFI flash
+ *
+ * Reflashing over JTAG takes the relay out of service for as long as the
+ * programmer runs. Instead the new image streams in while the relay keeps
+ * working, into whichever of the two FW_BANK_SIZE banks the running image
+ * did not boot from, and the switch to it costs one restart.
+ *
+ * The image is the boot copier's (elf2flash output as binary), preceded on
+ * the wire by its length and CRC-32. xFwUpdateBegin() opens a session and
+ * chunks arrive in order through xFwUpdateWrite(), from the Modbus task
+ * (firmware registers, over RS-232 or UDP): each is copied into one of
+ * FW_PAGES RAM pages and the call returns, so a request never waits on the
+ * flash. When every page is waiting the chunk is refused with "busy" and
+ * the sender tries it again. The flash task does the rest in bounded steps
+ * at the lowest priority: per call one erase block of the bank or up to
+ * FW_PAGES_PER_SERVICE pages programmed with alt_write_flash_block(), then
+ * the CRC read back from the flash FW_VERIFY_BYTES at a time. Code runs from
+ * SDRAM, so nothing but the flash task touches the flash while it is busy,
+ * and the control tasks preempt it between and during every step.
+ *
+ * A good CRC leaves the session ready and nothing else changed: the relay
+ * still boots the running bank. xFwUpdateReboot() makes the switch. The
+ * flash task appends a selector record naming the new bank, the image's
+ * length and CRC, then restarts from the reset address. Records go into
+ * the next erased slot of two sectors used in turn, the way the config
+ * store keeps its blocks, and the newest valid one wins, so a restart part
+ * way through a write keeps the previous record.
+ *
+ * Bank choice at reset is the boot copier's: the one at the reset address
+ * reads the selector and copies the bank it names, or bank 0 with no valid
+ * record. The record layout, FwSelect_t, is its contract with this module.
+ */
+
+#ifndef FW_UPDATE_H
+#define FW_UPDATE_H
+
+#include <stdint.h>
+
+/* Flash layout: the boot copier's sector at the reset address, then the
+ * banks, then the selector just below the config store */
+#define FW_BANKS                       2
+#define FW_BANK_FIRST                  0x010000
+#define FW_BANK_SIZE                   0x330000  // Erase block multiple
+#define FW_BANK_OFFSET(bank)           (FW_BANK_FIRST + (bank) * FW_BANK_SIZE)
+#define FW_SELECT_OFFSET               0x6C0000
+#define FW_SELECT_SECTORS              2
+#define FW_SELECT_SECTOR_SIZE          0x10000  // Must match the flash erase block
+#define FW_SELECT_SLOT_SIZE            32
+#define FW_SELECT_SLOTS                (FW_SELECT_SECTOR_SIZE / FW_SELECT_SLOT_SIZE)
+#define FW_SELECT_MAGIC                0x4657534CUL  // "FWSL"
+
+#define FW_PAGE_SIZE                   512   // Bytes programmed per alt_write_flash_block()
+#define FW_PAGES                       4     // RAM pages between the sender and the flash, power of 2
+#define FW_PAGES_PER_SERVICE           4     // Programmed per flash task period at most
+#define FW_VERIFY_BYTES                4096  // Read back per flash task period
+
+/* Session states */
+#define FW_IDLE                        0
+#define FW_RECEIVING                   1     // Erasing and programming as chunks arrive
+#define FW_VERIFYING                   2
+#define FW_READY                       3     // Verified, xFwUpdateReboot() switches to it
+#define FW_FAILED                      4     // CRC or flash error, the running bank stays
+
+/* xFwUpdateWrite() */
+#define FW_WRITE_OK                    0
+#define FW_WRITE_BUSY                  1     // Every page waiting on the flash, send it again
+#define FW_WRITE_REFUSED               (-1)  // Not in order, past the length or no session
+
+/* Selector record, one per slot, read by the boot copier */
+typedef struct {
+    uint32_t magic;                    // FW_SELECT_MAGIC
+    uint32_t sequence;                 // Record count, the highest is the newest
+    uint32_t bank;                     // Bank to boot, 0 .. FW_BANKS - 1
+    uint32_t length;                   // Image bytes from FW_BANK_OFFSET(bank)
+    uint32_t image_crc;                // CRC-32 of those bytes
+    uint32_t crc;                      // CRC-32 of everything above
+} FwSelect_t;
+
+typedef struct {
+    uint8_t state;                     // FW_*
+    uint8_t running_bank;              // Booted from, per the selector
+    uint8_t target_bank;               // Being written
+    uint32_t length;                   // Of the image in the session
+    uint32_t received;                 // Bytes accepted
+    uint32_t programmed;               // Bytes in the flash
+    uint32_t updates;                  // Images verified since boot
+    uint32_t errors;                   // Flash errors and CRC mismatches
+} FwUpdateStatus_t;
+
+/* Open the flash and read the selector, before the scheduler starts.
+ * Returns 0 on success, -1 if the flash does not fit the layout (every
+ * session is then refused). */
+int xFwUpdateInit(void);
+
+/* Start a session for an image of length bytes with this CRC-32, dropping
+ * any verified one not yet switched to. Sender's task. Returns 0, or -1
+ * while the flash task is still busy with a session or the length does not
+ * fit. */
+int xFwUpdateBegin(uint32_t length, uint32_t image_crc);
+
+/* The next len bytes of the image, at offset. A chunk already accepted is
+ * accepted again, for a sender whose reply was lost. Sender's task.
+ * Returns FW_WRITE_*. */
+int xFwUpdateWrite(uint32_t offset, const uint8_t *pucData, uint32_t len);
+
+/* Drop the session, from the sender's task; the flash task stops at its
+ * next step */
+void vFwUpdateAbort(void);
+
+/* Select the verified image and restart into it, from the flash task's
+ * next step. Returns -1 unless one is ready. */
+int xFwUpdateReboot(void);
+
+/* Flash task body: one bounded step of the session */
+void vFwUpdateService(void);
+
+/* Each word written by one task and read whole */
+void vFwUpdateGetStatus(FwUpdateStatus_t *pxStatus);
+
+#endif /* FW_UPDATE_H */
@@ -0,0 +1,54 @@
+/**
+ * Packed health word and heartbeat
+ *
+ * See health.h.
+ */
+
+/* Scheduler includes */
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/* Application includes */
+#include "health.h"
+#include "seqlock.h"
+#include "seven_seg.h"
+#include "telemetry.h"
+
+static SeqLock_t xLock = SEQLOCK_INIT;
+static struct {
+    uint32_t word;
+    uint32_t sequence;                 // Control cycles since boot
+} xHealth;
+static TickType_t xLastPost;           // Actuator only
+
+void vHealthPublish(uint32_t ulWord) {
+    TickType_t xNow = xTaskGetTickCount();
+    uint32_t previous = xHealth.word;
+
+    vSeqWriteBegin(&xLock);
+    xHealth.word = ulWord;
+    xHealth.sequence++;
+    vSeqWriteEnd(&xLock);
+
+    if (ulWord != previous || (xNow - xLastPost) >= pdMS_TO_TICKS(HEALTH_TELEMETRY_MS)) {
+        xLastPost = xNow;
+        vTelemetryPost(TELEMETRY_HEALTH, ulWord, xHealth.sequence, 0);
+    }
+    if ((ulWord ^ previous) >> HEALTH_DIGIT_SHIFT & 0xF) {
+        vSevenSegHealth((uint8_t)(ulWord >> HEALTH_DIGIT_SHIFT & 0xF));
+    }
+}
+
+uint32_t ulHealthGet(uint32_t *pulSequence) {
+    uint32_t start, word, sequence;
+
+    do {
+        start = ulSeqReadBegin(&xLock);
+        word = xHealth.word;
+        sequence = xHealth.sequence;
+    } while (xSeqReadRetry(&xLock, start));
+    if (pulSequence != NULL) {
+        *pulSequence = sequence;
+    }
+    return word;
+}
@@ -0,0 +1,56 @@
+/**
+ * Packed health word and heartbeat
+ *
+ * The relay's whole condition in one 32-bit word, for a supervisor that
+ * polls: the actuator builds it at the end of every control cycle and
+ * vHealthPublish() stores it with a sequence number that counts the
+ * cycles, so a sequence that stops moving is a relay that has stopped
+ * deciding, whatever the word says. Both are kept under a sequence lock and
+ * read together.
+ *
+ *   bits 0-2    STATE_ALERT, STATE_FAILSAFE, STATE_OVERRIDE (system_state.h)
+ *   bit 3       HEALTH_FAULTY: some load has a persistent feedback mismatch
+ *   bit 4       HEALTH_FEEDBACK: the monitor has confirmed a feedback fault
+ *   bit 5       HEALTH_DEADLINE: a control task missed its deadline lately
+ *   bit 6       HEALTH_OVERFLOW: a sample ring, the telemetry, the deferred
+ *               calls or the event log dropped something lately
+ *   bit 7       HEALTH_WATCHDOG: heartbeats were missing at the last
+ *               watchdog supervision
+ *   bits 8-11   loads the decision holds off, up to 15
+ *   bits 12-19  failsafe sources latched, a bit per EVENT_SOURCE_*
+ *   bits 20-31  0
+ *
+ * "Lately" is within HEALTH_HOLD_MS, so a poller at least that often sees
+ * every one. The word goes out over Modbus (input registers MB_IN_HEALTH),
+ * as a TELEMETRY_HEALTH record whenever it changes and every
+ * HEALTH_TELEMETRY_MS with the sequence, and bits 4-7 as the fault digit
+ * of the seven-segment readout (seven_seg.h).
+ */
+
+#ifndef HEALTH_H
+#define HEALTH_H
+
+#include <stdint.h>
+
+#define HEALTH_STATE_MASK              0x00000007UL
+#define HEALTH_FAULTY                  0x00000008UL
+#define HEALTH_FEEDBACK                0x00000010UL
+#define HEALTH_DEADLINE                0x00000020UL
+#define HEALTH_OVERFLOW                0x00000040UL
+#define HEALTH_WATCHDOG                0x00000080UL
+#define HEALTH_DIGIT_SHIFT             4             // Bits 4-7, the seven-segment fault digit
+#define HEALTH_SHED_SHIFT              8
+#define HEALTH_SHED_MAX                15
+#define HEALTH_SOURCE_SHIFT            12
+#define HEALTH_SOURCE_MASK             0xFF
+
+#define HEALTH_HOLD_MS                 1000   // A passing condition stays set this long
+#define HEALTH_TELEMETRY_MS            1000   // Heartbeat record while the word holds
+
+/* Actuator, at the end of each control cycle */
+void vHealthPublish(uint32_t ulWord);
+
+/* The newest word, and the cycle count it was published with (may be NULL) */
+uint32_t ulHealthGet(uint32_t *pulSequence);
+
+#endif /* HEALTH_H */
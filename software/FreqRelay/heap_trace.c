@@ -0,0 +1,182 @@
+/**
+ * Heap allocation tracer
+ *
+ * See heap_trace.h.
+ */
+
+/* Standard includes */
+#include <stdio.h>
+
+/* Scheduler includes */
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/* Hardware includes */
+#include "sys/alt_irq.h"
+
+/* Application includes */
+#include "heap_trace.h"
+#include "log_msg.h"
+#include "time_base.h"
+
+/* The hooks only come from heap_tlsf.c */
+#if configUSE_HEAP_TRACE
+#if !configUSE_TLSF_HEAP
+#error "configUSE_HEAP_TRACE needs the TLSF heap"
+#endif
+
+#define HEAP_TRACE_RING_MASK           (HEAP_TRACE_RING_SIZE - 1)
+
+#if HEAP_TRACE_RING_SIZE & HEAP_TRACE_RING_MASK
+#error "HEAP_TRACE_RING_SIZE must be a power of two"
+#endif
+
+/* Zero in .bss: the kernel allocates before main() gets to any init */
+static HeapTraceRecord_t xRing[HEAP_TRACE_RING_SIZE];
+static uint32_t ulHead;                // Free-running, oldest overwritten
+static HeapTraceSite_t xSites[HEAP_TRACE_SITES];
+static uint32_t ulSites;               // Entries used
+static uint32_t ulLate;                // Allocations after the scheduler started
+static uint32_t ulFrees;
+static uint32_t ulFreedBytes;
+
+/* The entry for site, a new one while there is room, the shared last one
+ * past that */
+static HeapTraceSite_t *pxHeapTraceSite(uint32_t site) {
+    uint32_t i;
+
+    for (i = 0; i < ulSites; i++) {
+        if (xSites[i].site == site) {
+            return &xSites[i];
+        }
+    }
+    if (ulSites == HEAP_TRACE_SITES) {
+        xSites[HEAP_TRACE_SITES - 1].site = 0;
+        return &xSites[HEAP_TRACE_SITES - 1];
+    }
+    xSites[ulSites].site = site;
+    return &xSites[ulSites++];
+}
+
+void vHeapTraceMalloc(void *pvCaller, void *pvAddress, uint32_t ulSize) {
+    alt_irq_context context;
+    HeapTraceRecord_t *pxRecord;
+    HeapTraceSite_t *pxSite;
+    uint32_t site = (uint32_t)pvCaller, time_ms = (uint32_t)(ullTimeToUs(ullTimeNow()) / 1000);
+    uint8_t late = xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED;
+    uint8_t refused = pvAddress == NULL && xPortHeapFrozen() != pdFALSE;
+
+    context = alt_irq_disable_all();
+    pxRecord = &xRing[ulHead++ & HEAP_TRACE_RING_MASK];
+    pxRecord->site = site;
+    pxRecord->size = ulSize;
+    pxRecord->time_ms = time_ms;
+    pxRecord->late = late;
+    pxRecord->failed = pvAddress == NULL;
+    pxRecord->refused = refused;
+
+    pxSite = pxHeapTraceSite(site);
+    pxSite->count++;
+    pxSite->bytes += ulSize;
+    if (late) {
+        pxSite->late_count++;
+        pxSite->late_bytes += ulSize;
+        ulLate++;
+    }
+    if (ulSize > pxSite->largest) {
+        pxSite->largest = ulSize;
+    }
+    if (pvAddress == NULL) {
+        pxSite->failed++;
+    }
+    if (refused) {
+        pxSite->refused++;
+    }
+    alt_irq_enable_all(context);
+
+    if (refused) {
+        vLogPost(LOG_HEAP_REFUSED, ulSize, site);
+    }
+}
+
+void vHeapTraceFree(uint32_t ulSize) {
+    alt_irq_context context;
+
+    context = alt_irq_disable_all();
+    ulFrees++;
+    ulFreedBytes += ulSize;
+    alt_irq_enable_all(context);
+}
+
+uint32_t ulHeapTraceAllocations(void) {
+    return ulHead;
+}
+
+uint32_t ulHeapTraceLateAllocations(void) {
+    return ulLate;
+}
+
+int xHeapTraceGetSite(uint32_t i, HeapTraceSite_t *pxSite) {
+    alt_irq_context context;
+
+    if (i >= ulSites) {
+        return 0;
+    }
+    context = alt_irq_disable_all();
+    *pxSite = xSites[i];
+    alt_irq_enable_all(context);
+    return 1;
+}
+
+void vHeapTracePrint(void) {
+    static HeapTraceSite_t sites[HEAP_TRACE_SITES];
+    static HeapTraceRecord_t ring[HEAP_TRACE_RING_SIZE];
+    HeapTraceSite_t site;
+    alt_irq_context context;
+    uint32_t count, head, frees, freed, i, j, n;
+
+    context = alt_irq_disable_all();
+    count = ulSites;
+    head = ulHead;
+    frees = ulFrees;
+    freed = ulFreedBytes;
+    for (i = 0; i < HEAP_TRACE_RING_SIZE; i++) {
+        ring[i] = xRing[i];
+    }
+    alt_irq_enable_all(context);
+
+    /* Hottest first: most allocations after the start, then most bytes */
+    for (i = 0; i < count && xHeapTraceGetSite(i, &site); i++) {
+        for (j = i; j > 0 && (sites[j - 1].late_count < site.late_count ||
+                              (sites[j - 1].late_count == site.late_count && sites[j - 1].bytes < site.bytes));
+             j--) {
+            sites[j] = sites[j - 1];
+        }
+        sites[j] = site;
+    }
+
+    printf("Heap trace: %lu allocations, %lu after the scheduler started; %lu frees of %lu bytes\n",
+           (unsigned long)head, (unsigned long)ulLate, (unsigned long)frees, (unsigned long)freed);
+    printf("Site        Count    Bytes   Late  Late bytes  Largest  Failed  Refused\n");
+    for (i = 0; i < count; i++) {
+        printf("0x%08lx %6lu %8lu %6lu %11lu %8lu %7lu %8lu\n", (unsigned long)sites[i].site,
+               (unsigned long)sites[i].count, (unsigned long)sites[i].bytes, (unsigned long)sites[i].late_count,
+               (unsigned long)sites[i].late_bytes, (unsigned long)sites[i].largest, (unsigned long)sites[i].failed,
+               (unsigned long)sites[i].refused);
+    }
+
+    /* Oldest first of what the ring still holds */
+    n = head < HEAP_TRACE_RING_SIZE ? head : HEAP_TRACE_RING_SIZE;
+    printf("Newest allocations after the scheduler started:\n");
+    for (i = head - n; i != head; i++) {
+        if (ring[i & HEAP_TRACE_RING_MASK].late) {
+            printf("%10lu ms  0x%08lx %6lu%s\n", (unsigned long)ring[i & HEAP_TRACE_RING_MASK].time_ms,
+                   (unsigned long)ring[i & HEAP_TRACE_RING_MASK].site,
+                   (unsigned long)ring[i & HEAP_TRACE_RING_MASK].size,
+                   ring[i & HEAP_TRACE_RING_MASK].refused ? "  refused, frozen" :
+                   ring[i & HEAP_TRACE_RING_MASK].failed ? "  failed" : "");
+        }
+    }
+}
+
+#endif /* configUSE_HEAP_TRACE */
@@ -0,0 +1,80 @@
+/**
+ * Heap allocation tracer
+ *
+ * The TLSF heap (FreeRTOS/heap_tlsf.c) passes every allocation through
+ * traceMALLOC_CALLER() with the return address of the entry point called:
+ * for pvPortMalloc() the kernel function that wants the memory
+ * (xTaskCreate, xQueueGenericCreate, ...), for newlib's wrapped _malloc_r()
+ * and friends the C library routine (__smakebuf_r for a stdio buffer), and
+ * for pvPortMallocRegion() the application. vHeapTraceMalloc() puts the
+ * call site, size and time into a ring that keeps the newest
+ * HEAP_TRACE_RING_SIZE allocations, and adds it to that call site's totals,
+ * split at the scheduler start. With the newlib allocator routed to the
+ * kernel heap nothing reaches alt_sbrk(), so these are every dynamic
+ * allocation there is.
+ *
+ * vHeapTracePrint() writes the report on the JTAG UART: the call sites
+ * that allocated after the scheduler started first, most of them first,
+ * then the boot-only sites, then the ring's allocations after the start.
+ * Each of the first is something to move to a pool (pool.h) or static
+ * storage for an allocation-free steady state. The sites are code
+ * addresses; nios2-elf-addr2line -f -e FreqRelay.elf <site> names them.
+ *
+ * After vPortHeapFreeze() every allocation is refused; each refusal is
+ * marked in the ring and the site's count, and posted at once as
+ * LOG_HEAP_REFUSED (log_msg.h) with its size and call site, so a frozen
+ * relay that still allocates says where from on the telemetry link.
+ *
+ * Frees are counted, not traced: a block does not remember its call site.
+ * Past HEAP_TRACE_SITES call sites the rest are added to one entry with
+ * site 0.
+ */
+
+#ifndef HEAP_TRACE_H
+#define HEAP_TRACE_H
+
+#include <stdint.h>
+
+/* No kernel includes: FreeRTOSConfig.h includes this for the trace hooks */
+
+#define HEAP_TRACE_RING_SIZE           64     // Allocations kept, power of 2
+#define HEAP_TRACE_SITES               32     // Call sites counted apart
+
+typedef struct {
+    uint32_t site;                     // Return address of the allocator entry
+    uint32_t size;                     // Bytes asked for
+    uint32_t time_ms;                  // Since boot (time_base.h), valid after vLatencyInit()
+    uint8_t late;                      // After the scheduler started
+    uint8_t failed;                    // Returned NULL
+    uint8_t refused;                   // Failed because the heap was frozen
+} HeapTraceRecord_t;
+
+typedef struct {
+    uint32_t site;
+    uint32_t count;                    // Allocations, before and after the start
+    uint32_t bytes;
+    uint32_t late_count;               // Allocations after the scheduler started
+    uint32_t late_bytes;
+    uint32_t largest;                  // Largest single allocation
+    uint32_t failed;
+    uint32_t refused;                  // Of them, with the heap frozen
+} HeapTraceSite_t;
+
+/* traceMALLOC_CALLER(): pvAddress NULL for a failed allocation. From the
+ * allocator, with the scheduler not suspended; not from an ISR. */
+void vHeapTraceMalloc(void *pvCaller, void *pvAddress, uint32_t ulSize);
+
+/* traceFREE(): ulSize is the block size */
+void vHeapTraceFree(uint32_t ulSize);
+
+/* Allocations since boot and since the scheduler started */
+uint32_t ulHeapTraceAllocations(void);
+uint32_t ulHeapTraceLateAllocations(void);
+
+/* Copy out call site i, 0 past the last one used */
+int xHeapTraceGetSite(uint32_t i, HeapTraceSite_t *pxSite);
+
+/* The report, with printf: call with the UART held (xTelemetryUartTake) */
+void vHeapTracePrint(void);
+
+#endif /* HEAP_TRACE_H */
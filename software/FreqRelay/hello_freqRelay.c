@@ -6,6 +6,7 @@
  */
 
 /* Standard includes */
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -15,33 +16,306 @@
 #include "freertos/queue.h"
 #include "freertos/semphr.h"
 #include "freertos/timers.h"
+#include "freertos/croutine.h"
 #include "freertos/portmacro.h"
 
 /* Hardware includes */
 #include "system.h"
 #include "sys/alt_irq.h"
+#include "sys/alt_cache.h"
 #include "io.h"
-#include "altera_avalon_pio_regs.h"
 #include "altera_up_avalon_video_character_buffer_with_dma.h"
 #include "altera_up_avalon_video_pixel_buffer_dma.h"
 
-/* Task Priorities */
-#define SYSTEM_MONITOR_PRIORITY        14  // Highest priority
-#define FREQ_ANALYZER_PRIORITY         13
-#define LOAD_DECISION_PRIORITY         12
-#define LOAD_ACTUATOR_PRIORITY         10
-#define VGA_DISPLAY_PRIORITY           8
-#define MANUAL_OVERRIDE_PRIORITY       6   // Lowest priority
-
-/* Task Stack Sizes */
-#define TASK_STACKSIZE                 2048
-
-/* Task periods */
+/* Application includes */
+#include "bench.h"
+#include "board_io.h"
+#include "budget_server.h"
+#include "char_lcd.h"
+#include "comtrade.h"
+#include "config_store.h"
+#include "coord.h"
+#include "deadline.h"
+#include "disturbance.h"
+#include "eth.h"
+#include "event_log.h"
+#include "excursion.h"
+#include "failsafe.h"
+#include "fast_mem.h"
+#include "fault_inject.h"
+#include "fix16.h"
+#include "idle_jobs.h"
+#include "freq_analyser.h"
+#include "freq_estimate.h"
+#include "freq_history.h"
+#include "freq_trace.h"
+#include "fw_update.h"
+#include "health.h"
+#include "heap_trace.h"
+#include "historian.h"
+#include "input_snapshot.h"
+#include "integrity.h"
+#include "irq_defer.h"
+#include "irq_latency.h"
+#include "jtag_uart.h"
+#include "journal.h"
+#include "kernel_trace.h"
+#include "latency.h"
+#include "load_audit.h"
+#include "load_decision.h"
+#include "load_feedback.h"
+#include "load_limiter.h"
+#include "load_output.h"
+#include "load_policy.h"
+#include "load_registry.h"
+#include "log_msg.h"
+#include "memory_census.h"
+#include "modbus.h"
+#include "msg_bus.h"
+#include "period_monitor.h"
+#include "pool.h"
+#include "perf_counter.h"
+#include "prng.h"
+#include "profile.h"
+#include "ps2_keys.h"
+#include "rta.h"
+#include "run_stats.h"
+#include "system_state.h"
+#include "screen_capture.h"
+#include "seqlock.h"
+#include "seven_seg.h"
+#include "shell.h"
+#include "soak.h"
+#include "status_text.h"
+#include "stream_stats.h"
+#include "swing_door.h"
+#include "telemetry.h"
+#include "time_base.h"
+#include "time_sync.h"
+#include "uf_curve.h"
+#include "vga_raster.h"
+#include "vga_glyph.h"
+#include "vga_text.h"
+#include "warm_state.h"
+#include "watchdog.h"
+#include "wcet.h"
+#include "window_extrema.h"
+
+/* Task Priorities, rate monotonic: the shorter the period (or deadline of an
+ * event driven task) the higher the priority. The timer daemon is above all
+ * of them, see configTIMER_TASK_PRIORITY, and the background daemon below
+ * the display (configTIMER_BACKGROUND_PRIORITY). Checked against the periods
+ * below. */
+#define FREQ_ANALYZER_PRIORITY         10  // Highest application priority
+#define SYSTEM_MONITOR_PRIORITY        9   // Same period as the actuator, ranked first to latch failsafe
+#define LOAD_ACTUATOR_PRIORITY         8
+#define WATCHDOG_PRIORITY              7
+#define SYSTEM_STATE_PRIORITY          7   // Sporadic and microseconds long, outside the rate monotonic order
+#define VGA_DISPLAY_PRIORITY           6
+#define MODBUS_PRIORITY                5
+#define ETH_PRIORITY                   5   // Frame driven, shares the Modbus deadline
+#define COORD_PRIORITY                 7   // Frame driven, its deadline the coordination period, below the actuator
+#define THRESHOLD_EDIT_PRIORITY        4
+#define TIME_SYNC_PRIORITY             2   // Once a time frame, the servo only
+#define RUN_STATS_PRIORITY             1   // Lowest priority
+#define FLASH_PRIORITY                 1   // Background, flash programming and erase
+
+/* Task Stack Sizes (words). Interrupts only push the 116 byte context frame
+ * here and run on their own stack (configISR_STACK_SIZE), so these no longer
+ * carry an allowance for nested handlers. */
+#define SYSTEM_MONITOR_STACK           768
+#define FREQ_ANALYZER_STACK            768
+#define LOAD_ACTUATOR_STACK            768
+#define WATCHDOG_STACK                 384
+#define SYSTEM_STATE_STACK             384
+#define VGA_DISPLAY_STACK              1792  // Calls the pixel and character buffer drivers
+#define THRESHOLD_EDIT_STACK           384
+#define MODBUS_STACK                   512
+#define COORD_STACK                    512
+#define ETH_STACK                      512
+#define TIME_SYNC_STACK                384
+#define RUN_STATS_STACK                1024  // printf to the JTAG UART
+#define FLASH_STACK                    1024  // printf in the deferred boot
+
+/* Task periods. The telemetry drain and the manual override are short and
+ * never block, so they run as timer callbacks rather than each keeping a
+ * task and a stack: the override in the daemon, the drain in the background
+ * daemon. */
 #define SYSTEM_MONITOR_PERIOD_MS       100
-#define FREQ_ANALYZER_PERIOD_MS        50
+#define FREQ_ANALYZER_PERIOD_MS        50   // Backstop wake-up when no samples arrive
 #define LOAD_ACTUATOR_PERIOD_MS        100
+#define WATCHDOG_PERIOD_MS             200  // Supervision, longer than any heartbeat interval
 #define VGA_DISPLAY_PERIOD_MS          200
-#define MANUAL_OVERRIDE_PERIOD_MS      100
+#define RUN_STATS_PERIOD_MS            2000  // Must stay well under the 43 s counter wrap
+#define TELEMETRY_PERIOD_MS            20   // Ring drain timer, 64 records last about 1 s of samples
+#define FLASH_PERIOD_MS                100  // Event ring collection and config saves
+#define THRESHOLD_EDIT_DEADLINE_MS     200  // Event driven: key press shown by the next frame
+#define MODBUS_DEADLINE_MS             200  // Event driven: well inside a SCADA master's reply timeout
+#define SYSTEM_STATE_DEADLINE_MS       10   // Event driven: state change on the LEDs and telemetry
+#define SWITCH_DEBOUNCE_MS             20   // Switches must be still this long to count
+#define IDLE_SLEEP_MAX_MS              10   // Longest tickless sleep, bounds switch polling
+
+/* Release phase of the tick-released tasks, ms into their period, or
+ * PERIOD_OFFSET_AUTO for vPeriodSpread() to place them apart
+ * (period_monitor.h). The telemetry drain timer releases at 0. */
+#ifndef SYSTEM_MONITOR_OFFSET_MS
+#define SYSTEM_MONITOR_OFFSET_MS       PERIOD_OFFSET_AUTO
+#endif
+#ifndef VGA_DISPLAY_OFFSET_MS
+#define VGA_DISPLAY_OFFSET_MS          PERIOD_OFFSET_AUTO
+#endif
+#ifndef RUN_STATS_OFFSET_MS
+#define RUN_STATS_OFFSET_MS            PERIOD_OFFSET_AUTO
+#endif
+#ifndef FLASH_OFFSET_MS
+#define FLASH_OFFSET_MS                PERIOD_OFFSET_AUTO
+#endif
+#ifndef CYCLIC_OFFSET_MS
+#define CYCLIC_OFFSET_MS               PERIOD_OFFSET_AUTO
+#endif
+
+/* Task set per system state, see xModeProfiles: in alert and failsafe the
+ * display, the statistics and the exports slow down or stop, leaving the
+ * CPU to the control path. 0 keeps every task at full rate. */
+#ifndef FREQ_MODE_PROFILES
+#define FREQ_MODE_PROFILES             1
+#endif
+
+/* Headless builds ("make headless"): no VGA display task, plots, pages,
+ * mouse cursor or screen capture, and no zoom button. The status goes out
+ * on the character LCD, the seven-segment readout and the telemetry only;
+ * the keyboard still edits the thresholds. */
+#ifndef FREQ_HEADLESS
+#define FREQ_HEADLESS                  0
+#endif
+
+/* The priority map must fit the kernel and stay rate monotonic, otherwise
+ * xTaskCreate clamps priorities and tasks that should preempt each other
+ * round-robin instead */
+#if FREQ_ANALYZER_PRIORITY >= configTIMER_TASK_PRIORITY || configTIMER_TASK_PRIORITY >= configMAX_PRIORITIES
+#error "Application priorities must be below the timer task and within configMAX_PRIORITIES"
+#endif
+#if RUN_STATS_PRIORITY <= 0 || FLASH_PRIORITY <= 0
+#error "Application tasks must be above the idle task"
+#endif
+#if configUSE_TIMER_BACKGROUND && \
+    (configTIMER_BACKGROUND_PRIORITY >= VGA_DISPLAY_PRIORITY || configTIMER_BACKGROUND_PRIORITY <= 0)
+#error "The background timer daemon must be below the display and above the idle task"
+#endif
+#define PRIORITY_RM_ORDER(hi_prio, hi_period, lo_prio, lo_period) \
+    ((hi_prio) > (lo_prio) && (hi_period) <= (lo_period))
+#if !PRIORITY_RM_ORDER(FREQ_ANALYZER_PRIORITY, FREQ_ANALYZER_PERIOD_MS, SYSTEM_MONITOR_PRIORITY, SYSTEM_MONITOR_PERIOD_MS) || \
+    !PRIORITY_RM_ORDER(SYSTEM_MONITOR_PRIORITY, SYSTEM_MONITOR_PERIOD_MS, LOAD_ACTUATOR_PRIORITY, LOAD_ACTUATOR_PERIOD_MS) || \
+    !PRIORITY_RM_ORDER(LOAD_ACTUATOR_PRIORITY, LOAD_ACTUATOR_PERIOD_MS, WATCHDOG_PRIORITY, WATCHDOG_PERIOD_MS) || \
+    !PRIORITY_RM_ORDER(WATCHDOG_PRIORITY, WATCHDOG_PERIOD_MS, VGA_DISPLAY_PRIORITY, VGA_DISPLAY_PERIOD_MS) || \
+    !PRIORITY_RM_ORDER(VGA_DISPLAY_PRIORITY, VGA_DISPLAY_PERIOD_MS, MODBUS_PRIORITY, MODBUS_DEADLINE_MS) || \
+    !PRIORITY_RM_ORDER(MODBUS_PRIORITY, MODBUS_DEADLINE_MS, THRESHOLD_EDIT_PRIORITY, THRESHOLD_EDIT_DEADLINE_MS) || \
+    !PRIORITY_RM_ORDER(THRESHOLD_EDIT_PRIORITY, THRESHOLD_EDIT_DEADLINE_MS, RUN_STATS_PRIORITY, RUN_STATS_PERIOD_MS)
+#error "Task priorities are not in rate monotonic order"
+#endif
+
+/* Application tasks, highest priority first: X(id, entry, name, stack words,
+ * priority, period or deadline, heartbeat, handle) once each. The list is
+ * expanded for the prototypes (of the tasks in this file, APP_TASKS_HERE),
+ * the static stacks (x<id>Stack), the task table and its indexes
+ * (APP_TASK_<id>) and the heartbeats the watchdog waits for; a task with
+ * heartbeat 0 is not supervised. A stack or priority is resized by its
+ * one macro above. */
+#if FREQ_TIME_TRIGGERED
+/* Owns the outputs, so takes the actuator's notifications */
+#define APP_TASKS_CONTROL(X) \
+    X(Cyclic,        vCyclicTask,            "Cyclic",  CYCLIC_STACK,         CYCLIC_PRIORITY, \
+      CYCLIC_MINOR_MS,            WATCHDOG_BEAT_ANALYZER | WATCHDOG_BEAT_MONITOR | WATCHDOG_BEAT_ACTUATOR, \
+      xLoadActuatorTask)
+#else
+#define APP_TASKS_CONTROL(X) \
+    X(FreqAnalyzer,  vFrequencyAnalyzerTask, "FreqAn",  FREQ_ANALYZER_STACK,  FREQ_ANALYZER_PRIORITY, \
+      FREQ_ANALYZER_PERIOD_MS,    WATCHDOG_BEAT_ANALYZER, xFreqAnalyzerTask) \
+    X(SystemMonitor, vSystemMonitorTask,     "SysMon",  SYSTEM_MONITOR_STACK, SYSTEM_MONITOR_PRIORITY, \
+      SYSTEM_MONITOR_PERIOD_MS,   WATCHDOG_BEAT_MONITOR,  xSystemMonitorTask) \
+    X(LoadActuator,  vLoadActuatorTask,      "LoadAct", LOAD_ACTUATOR_STACK,  LOAD_ACTUATOR_PRIORITY, \
+      LOAD_ACTUATOR_PERIOD_MS,    WATCHDOG_BEAT_ACTUATOR, xLoadActuatorTask)
+#endif
+#if FREQ_UI_COROUTINES
+#define APP_TASKS_UI(X)
+#define APP_TASKS_EDIT(X)
+#else
+#if FREQ_HEADLESS
+#define APP_TASKS_VGA(X)
+#else
+#define APP_TASKS_VGA(X) \
+    X(VGADisplay,    vVGADisplayTask,        "VGADisp", VGA_DISPLAY_STACK,    VGA_DISPLAY_PRIORITY, \
+      VGA_DISPLAY_PERIOD_MS,      0,                      xVGADisplayTask)
+#endif
+#define APP_TASKS_UI(X) \
+    X(SystemState,   vSystemStateTask,       "State",   SYSTEM_STATE_STACK,   SYSTEM_STATE_PRIORITY, \
+      SYSTEM_STATE_DEADLINE_MS,   0,                      xSystemStateTask) \
+    APP_TASKS_VGA(X)
+#define APP_TASKS_EDIT(X) \
+    X(ThresholdEdit, vThresholdEditTask,     "ThrEdit", THRESHOLD_EDIT_STACK, THRESHOLD_EDIT_PRIORITY, \
+      THRESHOLD_EDIT_DEADLINE_MS, 0,                      xThresholdEditTask)
+#endif
+#if FREQ_COORD
+#define APP_TASKS_COORD(X) \
+    X(Coord,         vCoordTask,             "Coord",   COORD_STACK,          COORD_PRIORITY, \
+      COORD_PERIOD_MS,            0,                      xCoordTask)
+#define APP_TASKS_SYNC(X) \
+    X(TimeSync,      vTimeSyncTask,          "TSync",   TIME_SYNC_STACK,      TIME_SYNC_PRIORITY, \
+      COORD_TIME_PERIOD_MS,       0,                      xTimeSyncTask)
+#else
+#define APP_TASKS_COORD(X)
+#define APP_TASKS_SYNC(X)
+#endif
+#if FREQ_ETHERNET
+#define APP_TASKS_ETH(X) \
+    X(Eth,           vEthTask,               "Eth",     ETH_STACK,            ETH_PRIORITY, \
+      MODBUS_DEADLINE_MS,         0,                      xEthTask)
+#else
+#define APP_TASKS_ETH(X)
+#endif
+#if FREQ_FAULT_INJECT
+/* Out of the priority order: wherever the fault settings put it */
+#define APP_TASKS_FAULT(X) \
+    X(FaultHog,      vFaultHogTask,          "Hog",     FAULT_HOG_STACK,      FAULT_HOG_DEFAULT_PRIORITY, \
+      FAULT_HOG_PERIOD_MS,        0,                      xFaultHogTask)
+#else
+#define APP_TASKS_FAULT(X)
+#endif
+#define APP_TASKS_HERE(X) \
+    APP_TASKS_CONTROL(X) \
+    APP_TASKS_COORD(X) \
+    X(Watchdog,      vWatchdogTask,          "Wdog",    WATCHDOG_STACK,       WATCHDOG_PRIORITY, \
+      WATCHDOG_PERIOD_MS,         0,                      xWatchdogTask) \
+    APP_TASKS_UI(X) \
+    X(Modbus,        vModbusTask,            "Modbus",  MODBUS_STACK,         MODBUS_PRIORITY, \
+      MODBUS_DEADLINE_MS,         0,                      xModbusTask) \
+    APP_TASKS_ETH(X) \
+    APP_TASKS_EDIT(X) \
+    APP_TASKS_SYNC(X) \
+    X(RunStats,      vRunStatsTask,          "RunStat", RUN_STATS_STACK,      RUN_STATS_PRIORITY, \
+      RUN_STATS_PERIOD_MS,        0,                      xRunStatsTask) \
+    X(Flash,         vFlashTask,             "Flash",   FLASH_STACK,          FLASH_PRIORITY, \
+      FLASH_PERIOD_MS,            0,                      xFlashTask)
+#define APP_TASKS(X)                   APP_TASKS_HERE(X) APP_TASKS_FAULT(X)
+
+#define APP_TASK_INDEX(id, entry, name, words, prio, period, beat, handle)      APP_TASK_##id,
+#define APP_TASK_HEARTBEAT(id, entry, name, words, prio, period, beat, handle)  | (beat)
+#define APP_TASK_PROTOTYPE(id, entry, name, words, prio, period, beat, handle)  static void entry(void *pvParameters);
+#define APP_TASK_STACK(id, entry, name, words, prio, period, beat, handle) \
+    static FAST_STACK StackType_t x##id##Stack[words];
+#define APP_TASK_ENTRY(id, entry, name, words, prio, period, beat, handle) \
+    { entry, name, words, APP_STACK(x##id##Stack), prio, period, &handle },
+#define APP_TASK_STACK_NAME(id, entry, name, words, prio, period, beat, handle) #words,
+
+enum { APP_TASKS(APP_TASK_INDEX) APP_TASK_COUNT };
+
+/* Interrupt priorities, see vPortIrqDispatch(). A frequency sample preempts
+ * every other handler, and so does a Modbus UART byte (the core holds only
+ * one); the buttons, PS/2, JTAG UART and tick stay at the kernel priority
+ * and are taken one at a time in IRQ number order. With a VIC the
+ * frequency IRQs go to a shadow register set above all of them. */
+#define FREQ_IRQ_PRIORITY              configMAX_SYSCALL_INTERRUPT_PRIORITY
+#define BUTTON_IRQ_PRIORITY            configKERNEL_INTERRUPT_PRIORITY
 
 /* Frequency related constants */
 #define SAMPLING_FREQ                  16000.0  // Sampling frequency in Hz
@@ -49,17 +323,618 @@
 #define NOMINAL_FREQ                   50.0     // Nominal frequency (Hz)
 #define FREQ_TOLERANCE                 1.5      // Frequency tolerance (  Hz)
 #define MAX_FREQ_ROC                   60.0     // Maximum rate of change (Hz/s)
+#define VALID_FREQ_MIN                 40.0     // Analyser readings outside this range are rejected (Hz)
+#define VALID_FREQ_MAX                 65.0
+#define FREQ_EST_WINDOW                8        // Periods in the frequency and RoC fit, not FREQ_EST_KALMAN
+
+/* Instant trip: the frequency ISR latches failsafe itself on a collapse this
+ * deep, microseconds after the period ends instead of an analyzer pass and
+ * an actuator update later. One integer compare per count; the graded
+ * shedding above it is still the tasks'. */
+#ifndef INSTANT_TRIP_FREQ
+#define INSTANT_TRIP_FREQ              47.0     // Trip below this (Hz)
+#endif
+#ifndef INSTANT_TRIP_PERIODS
+#define INSTANT_TRIP_PERIODS           2        // Periods in a row below it, so one bad count cannot trip, 0 for no trip
+#endif
+#define INSTANT_TRIP_COUNT             ((uint32_t)(SAMPLING_FREQ / INSTANT_TRIP_FREQ))  // Longest count that does not trip
+
+/* Disturbance records go out as COMTRADE files in the telemetry stream
+ * (comtrade.h), or with FREQ_COMTRADE_EXPORT 0 as #DREC text behind the run
+ * statistics */
+#ifndef FREQ_COMTRADE_EXPORT
+#define FREQ_COMTRADE_EXPORT           1
+#endif
+
+/* Frequency frames go out as swinging door breakpoints (swing_door.h), to
+ * these tolerances, and load decisions only when they change; either at
+ * least every TELEMETRY_SWING_MAX_MS. 0 tolerances send every change. */
+#define TELEMETRY_FREQ_TOL             0.005    // Hz
+#define TELEMETRY_ROC_TOL              0.05     // Hz/s
+#define TELEMETRY_SWING_MAX_MS         1000
+
+/* Soak builds only ("make soak"): the trace replay runs every scenario in
+ * turn for as long as the board is left, resetting out of any failsafe a
+ * scenario latched, and the run statistics are replaced by a summary of
+ * the whole run and of the last window every SOAK_SUMMARY_MIN minutes,
+ * ending with a stack size table from the peaks reached */
+#ifndef FREQ_RELAY_SOAK
+#define FREQ_RELAY_SOAK                0
+#endif
+#ifndef SOAK_SUMMARY_MIN
+#define SOAK_SUMMARY_MIN               10
+#endif
+#define SOAK_SUMMARY_PERIODS           (SOAK_SUMMARY_MIN * 60000UL / RUN_STATS_PERIOD_MS)
+#define SOAK_STACK_MARGIN_PCT          25       // Over the peak in the sizing table
+#define SOAK_STACK_ROUND               32       // Words the sizes are rounded up to
+
+/* Rate sweep builds only ("make sweep"): the trace replay plays
+ * SWEEP_TRACE on 1 to FREQ_CHANNELS feeders at 1 to 128 times its own
+ * pace, 50 samples a second doubling to 6400, SWEEP_STEP_PERIODS run
+ * stats periods a step. The run statistics are replaced by one line a
+ * step: injection time at interrupt level, samples dropped, the deepest
+ * sample ring, shed latency and deadline misses. */
+#ifndef FREQ_RATE_SWEEP
+#define FREQ_RATE_SWEEP                0
+#endif
+#ifndef SWEEP_TRACE
+#define SWEEP_TRACE                    "step-2"  // Sheds and reconnects every round
+#endif
+#define SWEEP_SPEEDS                   8        // Paces 1 to 128, in doublings
+#define SWEEP_STEP_PERIODS             5
+#if FREQ_RATE_SWEEP && FREQ_RELAY_SOAK
+#error "FREQ_RATE_SWEEP and FREQ_RELAY_SOAK both drive the trace replay"
+#endif
+
+/* Test builds only: the G key replays the built-in freq_trace.c scenarios
+ * through the sample ring in place of the analyser, paced by the tick */
+#ifndef FREQ_TRACE_REPLAY
+#define FREQ_TRACE_REPLAY              (FREQ_RELAY_SOAK || FREQ_RATE_SWEEP)
+#endif
+#if (FREQ_RELAY_SOAK || FREQ_RATE_SWEEP) && !FREQ_TRACE_REPLAY
+#error "FREQ_RELAY_SOAK and FREQ_RATE_SWEEP run on the trace replay"
+#endif
+/* Seeds each replay's noise in turn from one stream, so the same build
+ * replays the same sequence of traces from every boot */
+#ifndef FREQ_TRACE_SEED
+#define FREQ_TRACE_SEED                1
+#endif
+
+/* FREQ_FAULT_INJECT builds (see FreeRTOSConfig.h and fault_inject.h): the
+ * keyboard and Modbus set faults on the feedback, the frequency samples and
+ * interrupts, and a hog task that eats CPU time at a chosen priority. It
+ * starts level with the analyzer, round robin with it. */
+#define FAULT_HOG_DEFAULT_PRIORITY     FREQ_ANALYZER_PRIORITY
+#ifndef FAULT_INJECT_SEED
+#define FAULT_INJECT_SEED              1
+#endif
+
+/* Benchmark builds only ("make bench"): a task times the control path,
+ * kernel primitives and drawing once after boot, then the app carries on.
+ * The decision benchmark drives the load outputs, so not with loads wired. */
+#ifndef FREQ_RELAY_BENCH
+#define FREQ_RELAY_BENCH               0
+#endif
+#if FREQ_RELAY_BENCH && FREQ_HEADLESS
+#error "The benchmark times frame drawing, build it with the display"
+#endif
+/* Time-triggered builds: one cyclic task replaces the analyzer, actuator
+ * and monitor tasks and runs their steps in a fixed order from a frame
+ * table, released by the tick every minor frame. None of the three can
+ * preempt another, so their shared state is only ever used by one of them
+ * at a time. The rest of the application runs below it as before. */
+#ifndef FREQ_TIME_TRIGGERED
+#define FREQ_TIME_TRIGGERED            0
+#endif
+#define CYCLIC_PRIORITY                FREQ_ANALYZER_PRIORITY
+#define CYCLIC_STACK                   1024  // Deepest of the three steps, with margin
+#define CYCLIC_MINOR_MS                10    // Minor frame
+#define CYCLIC_MINOR_FRAMES            10    // Minor frames per major frame
+
+/* Frame table steps, run in this order within a minor frame */
+#define CYCLIC_ANALYZE                 0x01  // Drain the sample rings
+#define CYCLIC_ACTUATE                 0x02  // Decide and apply, if notified or a period has passed
+#define CYCLIC_FEEDBACK                0x04  // Feedback check, if a settle time has expired
+#define CYCLIC_MONITOR                 0x08  // Periodic monitor checks
+
+#if CYCLIC_MINOR_MS * CYCLIC_MINOR_FRAMES != SYSTEM_MONITOR_PERIOD_MS
+#error "The major frame must be the system monitor period"
+#endif
+
+/* FREQ_UI_COROUTINES builds (see FreeRTOSConfig.h): the display, the
+ * threshold editor and the state LEDs run as co-routines from the idle hook,
+ * all on the idle task's stack, and only the control path keeps preemptive
+ * tasks. The UI then only gets time the system would spend idle. */
+#define UI_COROUTINES                  3     // Display, keys, state
+#define UI_KEYS_POLL_MS                20    // Keyboard ring polling, no notification
+
+#define BENCH_PRIORITY                 FREQ_ANALYZER_PRIORITY  // The analyzer is stopped while it runs
+#define BENCH_STACK                    1024
+#define BENCH_PEER_STACK               256
+#define BENCH_START_MS                 3000  // Let the app boot and draw its first frames
+#define BENCH_ITERATIONS               1000
+#define BENCH_FRAMES                   50
+#define BENCH_FRAME_SAMPLES            10    // Counts analysed between timed frames
+#define BENCH_CONTEND_ROUNDS           200   // Timed analyzer batches per condition
+#define BENCH_IRQ_MS                   1000  // Time spent watching for interrupt gaps
+#define BENCH_IRQ_MARGIN               16    // Counts over the bare loop that make a gap
+#define BENCH_TRACE                    "osc-2hz"
+#define BENCH_TRACE_COUNTS             256   // Counts cycled through, a power of two
+#define BENCH_LOADS                    0x00FF  // Connected before each decision
+#define SHED_DEADLINE_MS               200      // Relay spec: shed within this time of an event
+
+/* Predictive shedding (xLoadPolicyPredict): the first loads go early when
+ * the RoC fit puts the lower limit crossing within the longest the actuator
+ * can sleep before it acts. 0 sheds only on a crossing. */
+#ifndef LOAD_PREDICT_LEAD_MS
+#define LOAD_PREDICT_LEAD_MS           LOAD_ACTUATOR_PERIOD_MS
+#endif
+#define LOAD_PREDICT_ARM               0.5      // Only this close above the lower limit (Hz)
+
+/* Staged under-frequency relaying (uf_curve.h): without a registry, each
+ * feeder sheds by the definite and inverse time stages instead of the
+ * policy's instantaneous frequency bands. The policy's RoC column still
+ * applies. */
+#ifndef FREQ_UF_CURVES
+#define FREQ_UF_CURVES                 0
+#endif
+
+/* Stage trips between evaluations (deadline.h): after each one, the stage
+ * that would trip next if the frequency stayed put is armed on a spare
+ * hardware timer and, if no evaluation has re-armed or cancelled it first,
+ * its loads are shed at interrupt level at that time rather than on the
+ * next sample. Only within UF_DEADLINE_HORIZON_MS, the longest gap the
+ * curves count. */
+#ifndef FREQ_DEADLINE_TIMER
+#define FREQ_DEADLINE_TIMER            0
+#endif
+#define UF_DEADLINE_HORIZON_MS         UF_DT_MAX_MS
+#define FREQ_UF_DEADLINE               (FREQ_UF_CURVES && FREQ_DEADLINE_TIMER)
+/* Command shell on the JTAG UART (shell.h), run in idle time */
+#ifndef FREQ_SHELL
+#define FREQ_SHELL                     1
+#endif
+#define SHELL_TRACE_REASON             0x100   // Kernel trace trigger, above the failsafe sources
+#define SHELL_AUDIT_LINES              8       // Loads or reconnections an audit command prints
+#if FREQ_DEADLINE_TIMER && !defined(DEADLINE_TIMER_BASE)
+#error "FREQ_DEADLINE_TIMER needs a spare interval timer, DEADLINE_TIMER in system.h"
+#endif
+
+/* Input journal (journal.h) in the spare row tails of the scan-out frame,
+ * dumped by the run stats task once a failsafe trip or the shell's journal
+ * command has frozen it; sim/replay -J replays a dump. 0 records nothing. */
+#ifndef FREQ_JOURNAL
+#define FREQ_JOURNAL                   1
+#endif
+#define SHELL_JOURNAL_REASON           0x101   // Journal trigger from the shell
+#if FREQ_JOURNAL
+#define JOURNAL_INPUT(type, arg, value) vJournalRecord((type), (arg), (value))
+#else
+#define JOURNAL_INPUT(type, arg, value) ((void)0)
+#endif
+
+/* Screen captures over the telemetry link (screen_capture.h), taken by the
+ * shell's screenshot command */
+#ifndef FREQ_SCREEN_CAPTURE
+#define FREQ_SCREEN_CAPTURE            (!FREQ_HEADLESS)
+#endif
+#if FREQ_SCREEN_CAPTURE && FREQ_HEADLESS
+#error "A headless build has no frame to capture"
+#endif
+
+/* Refuse every heap allocation once the boot work is done (vPortHeapFreeze
+ * in portable.h): whatever still allocates then fails at once and is
+ * reported (heap_trace.h) instead of costing allocator time in the steady
+ * state. Needs the TLSF heap. */
+#ifndef FREQ_HEAP_FREEZE
+#define FREQ_HEAP_FREEZE               configUSE_TLSF_HEAP
+#endif
+
+/* CRC checks of the image and the decision's tables in idle time
+ * (integrity.h); a mismatch latches failsafe. 0 for a debugging session
+ * that sets software breakpoints. */
+#ifndef FREQ_INTEGRITY
+#define FREQ_INTEGRITY                 1
+#endif
+
+/* Minimum on/off times and a change rate limit on the decision's command
+ * (load_limiter.h), so a frequency hovering at a threshold does not flip
+ * the outputs every cycle. Failsafe, override and deadline sheds bypass
+ * it. */
+#ifndef FREQ_ACTUATION_LIMIT
+#define FREQ_ACTUATION_LIMIT           1
+#endif
+#define STDOUT_BUFFER_BYTES            256    // Per C library context, line buffered
+
+/* CPU budget server (budget_server.h, configUSE_BUDGET_SERVER in
+ * FreeRTOSConfig.h): the display, the editor, the run stats, the flash task
+ * and the telemetry drain share BUDGET_SERVER_US of CPU in every
+ * BUDGET_SERVER_PERIOD_MS. The UI coroutines run in the idle task, which
+ * cannot be held off, so that build budgets only the rest. */
+#ifndef BUDGET_SERVER_US
+#define BUDGET_SERVER_US               40000
+#endif
+#ifndef BUDGET_SERVER_PERIOD_MS
+#define BUDGET_SERVER_PERIOD_MS        100
+#endif
+#if configUSE_BUDGET_SERVER && (BUDGET_SERVER_US == 0 || BUDGET_SERVER_US >= BUDGET_SERVER_PERIOD_MS * 1000)
+#error "BUDGET_SERVER_US must be a part of BUDGET_SERVER_PERIOD_MS"
+#endif
+
+/* RoC the shedding decides on: the larger magnitude extreme of each feeder's
+ * last FREQ_ROC_PEAK_SAMPLES estimates (window_extrema.h), so a swing that
+ * peaks between two decisions still sheds. The stability check, the display
+ * and the telemetry keep the estimate itself. 1 decides on the estimate,
+ * and takes the tracker out. */
+#ifndef FREQ_ROC_PEAK_SAMPLES
+#define FREQ_ROC_PEAK_SAMPLES          1
+#endif
+#if FREQ_ROC_PEAK_SAMPLES < 1 || FREQ_ROC_PEAK_SAMPLES > WINDOW_EXTREMA_SIZE
+#error "FREQ_ROC_PEAK_SAMPLES must be 1 to WINDOW_EXTREMA_SIZE"
+#endif
+
+/* Decision memo: the analyzer keys each result by every feeder's policy
+ * cell, crossing due and stability (DECISION_KEY_*), and while the key, the
+ * reconnect due flag and the failsafe latch are those of an evaluation that
+ * changed nothing, the actuator skips the decision and the load state reads
+ * and writes. Band-keyed results only: with a registry or the trip curves
+ * the answer also depends on the exact deviation and the time, and every
+ * pass is evaluated. 0 evaluates every pass. */
+#ifndef FREQ_DECISION_MEMO
+#define FREQ_DECISION_MEMO             1
+#endif
+#define DECISION_KEY_BITS              5             // Per feeder, feeder n at n * this
+#define DECISION_KEY_DUE               0x08          // Predictive crossing due
+#define DECISION_KEY_STABLE            0x10          // Below it, ulLoadPolicyCell()
+#define DECISION_KEY_COORD_SHIFT       24            // Coordinated stage + 1, added by the actuator
+#define DECISION_KEY_RECONNECT         (1UL << 29)   // xReconnectDue, added by the actuator
+#define DECISION_KEY_FAILSAFE          (1UL << 30)   // Failsafe latched, added by the actuator
+#define DECISION_KEY_NONE              0xFFFFFFFFUL  // Evaluate, never memoised
+
+/* Fixed-point (Q16.16) forms of the above, folded at compile time */
+#define SAMPLING_FREQ_Q16              ((uint32_t)(SAMPLING_FREQ * 65536.0))        // Q16.16 Hz per count
+#define FREQ_TABLE_FIRST               ((uint32_t)(SAMPLING_FREQ_Q16 / (uint32_t)FIX16_CONST(VALID_FREQ_MAX)))  // Shortest valid count
+#define MIN_FREQ_Q16                   FIX16_CONST(MIN_FREQ)
+#define NOMINAL_FREQ_Q16               FIX16_CONST(NOMINAL_FREQ)
+#define FREQ_TOLERANCE_Q16             FIX16_CONST(FREQ_TOLERANCE)
+#define MAX_FREQ_ROC_Q16               FIX16_CONST(MAX_FREQ_ROC)
+#define LOAD_PREDICT_LEAD_Q16          FIX16_CONST(LOAD_PREDICT_LEAD_MS / 1000.0)  // Seconds
+#define LOAD_PREDICT_ARM_Q16           FIX16_CONST(LOAD_PREDICT_ARM)
+
+/* Manual override from the slide switches */
+#define OVERRIDE_SWITCH                0x8000  // Switch that enables the override
+#define OVERRIDE_LOAD_MASK             0x7FFF  // Switches below it drive the loads
+
+/* Runtime threshold editing from the PS/2 keyboard */
+#define EDIT_FREQ_STEP_Q16             FIX16_CONST(0.1)   // Hz per key press
+#define EDIT_ROC_STEP_Q16              FIX16_CONST(5.0)   // Hz/s per key press
+#define EDIT_MIN_BAND_Q16              FIX16_CONST(0.2)   // Smallest upper - lower gap
+#define EDIT_FREQ_MIN_Q16              MIN_FREQ_Q16
+#define EDIT_FREQ_MAX_Q16              FIX16_CONST(55.0)
+#define EDIT_ROC_MIN_Q16               FIX16_CONST(5.0)
+#define EDIT_ROC_MAX_Q16               FIX16_CONST(200.0)
+
+/* Modbus registers, one block of MB_FEEDER_STRIDE per feeder.
+ * Input registers (function 04): */
+#define MB_IN_STATE                    0x0000  // STATE_ALERT, STATE_FAILSAFE, STATE_OVERRIDE
+#define MB_IN_LOADS                    0x0001  // Loads the actuator drives connected
+#define MB_IN_REQUESTED                0x0002  // Loads the decision asks for
+#define MB_IN_FAULTY                   0x0003  // Loads with a persistent feedback mismatch
+#define MB_IN_FAULT                    0x0004  // System fault flag
+#define MB_IN_FEEDERS                  0x0005  // FREQ_CHANNELS
+#define MB_IN_HEALTH                   0x0006  // Health word (health.h), high word first
+#define MB_IN_HEARTBEAT                0x0008  // Control cycles published, low 16 bits
+#define MB_IN_FEEDER                   0x0010  // + stride * feeder: MB_FEEDER_FREQ, _ROC, _STABLE
+#define MB_IN_FW                       0x0200  // Firmware update, see fw_update.h:
+#define MB_IN_FW_STATE                 0       // FW_*
+#define MB_IN_FW_BANK                  1       // Running bank
+#define MB_IN_FW_RECEIVED              2       // Bytes accepted, high word first
+#define MB_IN_FW_PROGRAMMED            4       // Bytes in the flash, high word first
+#define MB_IN_FW_ERRORS                6
+#define MB_IN_FW_COUNT                 7
+#define MB_FEEDER_FREQ                 0       // mHz
+#define MB_FEEDER_ROC                  1       // 0.01 Hz/s, signed
+#define MB_FEEDER_STABLE               2       // 1 if stable
+/* Holding registers (functions 03, 06, 16), the thresholds: */
+#define MB_HOLD_FEEDER                 0x0000  // + stride * feeder: MB_FEEDER_LOWER, _UPPER, _MAX_ROC
+#define MB_FEEDER_LOWER                0       // mHz
+#define MB_FEEDER_UPPER                1       // mHz
+#define MB_FEEDER_MAX_ROC              2       // 0.01 Hz/s
+#define MB_HOLD_FAULT                  0x0100  // + FAULT_*, fault injection builds, see fault_inject.h
+/* and the firmware update, write only: a session starts with MB_FW_COMMAND
+ * BEGIN written together with the length and CRC, then each chunk is one
+ * write from MB_FW_OFFSET to its last data register */
+#define MB_HOLD_FW                     0x0200
+#define MB_FW_COMMAND                  0       // MB_FW_BEGIN, _ABORT, _REBOOT
+#define MB_FW_LENGTH                   1       // Image bytes, high word first
+#define MB_FW_CRC                      3       // Image CRC-32, high word first
+#define MB_FW_OFFSET                   5       // Of the chunk in the image, high word first
+#define MB_FW_BYTES                    7       // In the chunk, two a register, high byte first
+#define MB_FW_DATA                     8
+#define MB_FW_CHUNK_WORDS              64
+#define MB_FW_COUNT                    (MB_FW_DATA + MB_FW_CHUNK_WORDS)
+#define MB_FW_BEGIN                    1
+#define MB_FW_ABORT                    2
+#define MB_FW_REBOOT                   3
+#if MB_FW_CHUNK_WORDS > 64 || MB_FW_COUNT - MB_FW_OFFSET > MODBUS_WRITE_MAX
+#error "A firmware chunk must fit the data bit mask and one write multiple request"
+#endif
+#define MB_FEEDER_STRIDE               4
+
+#define EDIT_FIELD_UPPER               0
+#define EDIT_FIELD_LOWER               1
+#define EDIT_FIELD_ROC                 2
+#define EDIT_FIELD_FAULT               3       // Fault injection builds, ulEditFault
+
+/* Shed coordination with the other relays on the island (coord.h), over a
+ * second UART: while the leader's assignment is fresh the relay sheds the
+ * stage it is given, policy row n for stage n, rather than its own bands.
+ * Each stage reports the load it would shed: the registry ratings if one is
+ * flashed, otherwise COORD_LOAD_KW a load. */
+#ifndef FREQ_COORD
+#define FREQ_COORD                     0
+#endif
+#ifndef COORD_NODE
+#define COORD_NODE                     COORD_LEADER  // This relay's place in the ring
+#endif
+#define COORD_LOAD_KW                  10
+#if FREQ_COORD && !defined(COORD_UART_BASE)
+#error "FREQ_COORD needs the coordination UART, COORD_UART in system.h"
+#endif
+
+/* Telemetry and Modbus over UDP (eth.h) instead of the JTAG UART: the
+ * stream goes to the host's ETH_TELEMETRY_PORT, Modbus requests come to
+ * ETH_MODBUS_PORT and are answered by the Modbus task, which serves the
+ * RS-232 port alongside. */
+#ifndef FREQ_ETHERNET
+#define FREQ_ETHERNET                  0
+#endif
+#define ETH_TELEMETRY_PORT             20500
+#define ETH_MODBUS_PORT                502
+#if FREQ_ETHERNET && (!defined(TSE_MAC_BASE) || !defined(SGDMA_RX_BASE) || !defined(SGDMA_TX_BASE) || \
+                      !defined(DESCRIPTOR_MEMORY_BASE))
+#error "FREQ_ETHERNET needs the TSE MAC, both SGDMAs and their DESCRIPTOR_MEMORY in system.h"
+#endif
+
+/* Feeders monitored, one frequency analyser each. Channel 0 is the
+ * FREQUENCY_ANALYSER in system.h; channel n is FREQUENCY_ANALYSER_<n>_BASE
+ * and _IRQ, and sheds only the loads in FREQ_CHANNEL_<n>_LOADS. */
+#ifndef FREQ_CHANNELS
+#define FREQ_CHANNELS                  1
+#endif
+#if FREQ_CHANNELS < 1 || FREQ_CHANNELS > 4
+#error "FREQ_CHANNELS must be 1 to 4"
+#endif
+#ifndef FREQ_CHANNEL_0_LOADS
+#define FREQ_CHANNEL_0_LOADS           LOAD_MASK_ALL  // Every load on the one feeder
+#endif
+#if FREQ_CHANNELS > 1 && !defined(FREQ_CHANNEL_1_LOADS)
+#error "Each extra feeder needs its FREQ_CHANNEL_<n>_LOADS"
+#endif
+#if FREQ_CHANNELS > 2 && !defined(FREQ_CHANNEL_2_LOADS)
+#error "Each extra feeder needs its FREQ_CHANNEL_<n>_LOADS"
+#endif
+#if FREQ_CHANNELS > 3 && !defined(FREQ_CHANNEL_3_LOADS)
+#error "Each extra feeder needs its FREQ_CHANNEL_<n>_LOADS"
+#endif
+
+/* Frequency sample ring (ISR -> analyzer) */
+#define FREQ_RING_SIZE                 64    // Number of slots, must be a power of two
+#define FREQ_RING_MASK                 (FREQ_RING_SIZE - 1)
+#define FREQ_RING_WATERMARK            1     // Pending samples that wake the analyzer
+
+/* What a push does to a full ring:
+ *   DROP_NEWEST  keep the backlog, lose the new reading
+ *   DROP_OLDEST  overwrite the oldest reading, the analyzer skips ahead
+ *   COALESCE     replace the newest queued reading with the new one
+ * Every reading lost either way counts in the ring's dropped. */
+#define FREQ_RING_DROP_NEWEST          0
+#define FREQ_RING_DROP_OLDEST          1
+#define FREQ_RING_COALESCE             2
+#ifndef FREQ_RING_POLICY
+#define FREQ_RING_POLICY               FREQ_RING_DROP_NEWEST
+#endif
+#if FREQ_RING_POLICY != FREQ_RING_DROP_NEWEST && FREQ_RING_POLICY != FREQ_RING_DROP_OLDEST && \
+    FREQ_RING_POLICY != FREQ_RING_COALESCE
+#error "FREQ_RING_POLICY must be FREQ_RING_DROP_NEWEST, FREQ_RING_DROP_OLDEST or FREQ_RING_COALESCE"
+#endif
+
+/* Counts per interrupt with a FIFO analyser (freq_analyser.h). Shedding
+ * then starts up to FREQ_ANALYSER_BATCH - 1 periods later, 60 ms at 50 Hz
+ * with 4, out of SHED_DEADLINE_MS. */
+#ifndef FREQ_ANALYSER_BATCH
+#define FREQ_ANALYSER_BATCH            4
+#endif
+#if FREQ_ANALYSER_FIFO && (FREQ_ANALYSER_BATCH < 1 || FREQ_ANALYSER_BATCH > FREQ_ANALYSER_FIFO_DEPTH)
+#error FREQ_ANALYSER_BATCH must be 1..FREQ_ANALYSER_FIFO_DEPTH
+#endif
+
+/* Arrival bounds for the response time analysis of timing builds (rta.h).
+ * The sample interval holds while the feeders stay inside the valid range;
+ * the key and engine rates are assumptions, not properties of the hardware. */
+#if FREQ_ANALYSER_FIFO
+#define RTA_SAMPLE_MIN_US              ((uint32_t)(1000000.0 * FREQ_ANALYSER_BATCH / VALID_FREQ_MAX))
+#else
+#define RTA_SAMPLE_MIN_US              ((uint32_t)(1000000.0 / VALID_FREQ_MAX))
+#endif
+#define RTA_SAMPLE_MAX_US              ((uint32_t)(1000000.0 / VALID_FREQ_MIN))  // Longest period
+#define RTA_BUTTON_MIN_US              10000  // Debounced keys, far above any press rate
+#define RTA_PS2_MIN_US                 660    // 11 bit frame at the fastest 16.7 kHz clock
+#define RTA_UART_MIN_US                ((UART_DATA_BITS + 2) * 1000000UL / UART_BAUD)
+#define RTA_ENGINE_MIN_US              (VGA_DISPLAY_PERIOD_MS * 1000UL)  // One raster sync per frame
+#define RTA_MODBUS_MIN_US              (8 * RTA_UART_MIN_US + MODBUS_T35_US)  // Shortest request and its silence
+#define RTA_COORD_MIN_US               (COORD_FRAME_SIZE * RTA_UART_MIN_US)   // Frames back to back
+#define RTA_ETH_MIN_US                 7      // Shortest frame and gap at 100 Mb/s
+#define RTA_STATE_MIN_US               (RTA_SAMPLE_MIN_US / FREQ_CHANNELS)   // A state change per control job
+#define RTA_TICK_KERNEL_US             5      // Kernel tick work outside the tick hook probe, allowance
+#define RTA_MAX_ENTRIES                24
+#if configUSE_TIMER_BACKGROUND
+#define TELEMETRY_DAEMON_PRIORITY      configTIMER_BACKGROUND_PRIORITY  // The drain's daemon, for the analysis
+#else
+#define TELEMETRY_DAEMON_PRIORITY      configTIMER_TASK_PRIORITY
+#endif
+
+/* Analyzer results handed to the actuator by pointer: one being filled, one
+ * in the mailbox, one held by the actuator, and a spare */
+#define FREQ_RESULT_SLOTS              4
 
 /* VGA Display Constants */
 #define FREQPLT_ORI_X                  101  // Origin X position for frequency plot
-#define FREQPLT_ORI_Y                  199.0  // Origin Y position for frequency plot
 #define FREQPLT_GRID_SIZE_X            5     // X-axis grid size
-#define FREQPLT_FREQ_RES               20.0  // Y-axis resolution (pixels per Hz)
+#define FREQPLT_LABELS                 4     // Y-axis labels, see vPlotRescale
+#define FREQPLT_LABEL_ROW              22    // Text row of the lowest
+#define FREQPLT_LABEL_ROWS             5     // Text rows between two
 
 #define ROCPLT_ORI_X                   101   // Origin X position for RoC plot
-#define ROCPLT_ORI_Y                   259.0 // Origin Y position for RoC plot
 #define ROCPLT_GRID_SIZE_X             5     // X-axis grid size
-#define ROCPLT_ROC_RES                 0.5   // Y-axis resolution (pixels per Hz/s)
+#define ROCPLT_LABELS                  5
+#define ROCPLT_LABEL_ROW               36
+#define ROCPLT_LABEL_ROWS              2
+
+#define PLOT_HISTORY                   HISTORY_COLUMNS  // Columns across the plots
+#define PLOT_LEVELS                    (HISTORY_LEVELS + 1)  // Live history spans, then the historian's
+#define PLOT_HISTORIAN_SPAN_S          86400 // Historian level, the last day of the edited feeder
+#define PLOT_SEGMENTS                  (PLOT_HISTORY - 1)
+#define PLOT_TRACES                    3     // Frequency min, frequency max, peak RoC
+#define PLOT_RIGHT_X                   (FREQPLT_ORI_X + FREQPLT_GRID_SIZE_X * PLOT_SEGMENTS)  // Newest point
+#define PLOT_AXIS_X0                   100   // Axes, drawn once by vInitializeVGA
+#define PLOT_AXIS_X1                   590
+#define FREQPLT_AXIS_Y                 200
+#define ROCPLT_AXIS_Y                  300
+#define FREQPLT_TOP_Y                  50    // Top of each plot's vertical axis
+#define ROCPLT_TOP_Y                   220
+#define PLOT_LABEL_X                   7     // Labels right-aligned in PLOT_LABEL_WIDTH from here
+#define PLOT_LABEL_WIDTH               5
+#define PLOT_LABEL_PIXELS              8     // Frame rows per text row
+#define PLOT_FIT_MARGIN                8     // A finer scale leaves 1/8 of its plot spare each end
+/* Plot palette, in the rasterizer's pixel format (RASTER_RGB) */
+#define PLOT_TRACE_COLOR               RASTER_RGB(0, 0, 0x3FF)       // Blue
+#define PLOT_AXIS_COLOR                RASTER_RGB(0, 0x3F, 0x3FF)    // Blue, a trace of green
+#define PLOT_THRESHOLD_COLOR           RASTER_RGB(0x1C0, 0, 0)       // Dim red
+#define PLOT_READOUT_COLOR             RASTER_RGB(0x3FF, 0x3FF, 0x3FF)  // White
+
+/* Large frequency digits above the plots' axis labels, left of the columns
+ * VGA_PLOT_SCROLL moves (vga_glyph.h) */
+#define VGA_READOUT_X                  4
+#define VGA_READOUT_Y                  6
+#define VGA_READOUT_CELLS              6     // "-49.87", or a blank and four digits
+#if VGA_READOUT_X + VGA_READOUT_CELLS * GLYPH_CELL_X > FREQPLT_ORI_X
+#error "The frequency readout must stay left of the plot columns"
+#endif
+
+/* Scroll the plots a column when the history has moved on by one and
+ * draw only what then differs, instead of redrawing every segment of a
+ * moving trace. The blit is one command to a 2D engine but a copy of the
+ * whole plot band on the CPU, dearer than the segments it saves, so it is
+ * only on with the engine. */
+#ifndef VGA_PLOT_SCROLL
+#define VGA_PLOT_SCROLL                VGA_RASTER_ENGINE
+#endif
+#if VGA_PLOT_SCROLL && (ROCPLT_ORI_X != FREQPLT_ORI_X || ROCPLT_GRID_SIZE_X != FREQPLT_GRID_SIZE_X)
+#error VGA_PLOT_SCROLL moves both plots together, their columns must line up
+#endif
+
+#define FAILSAFE_BUTTON                0x01  // Push button that latches failsafe (EVENT_SOURCE_ISR)
+#define RESET_BUTTON                   0x02  // Push button that resets out of failsafe
+#define VGA_ZOOM_BUTTON                0x04  // Push button that cycles the plot time span
+#define BUTTONS                        0x07  // Every button with an action, interrupt enabled
+
+/* Mouse cursor over the plots, XOR drawn so moving it rewrites only the
+ * pixels under it. A left click reads the column below it out, the wheel
+ * zooms, the right button cycles the span as VGA_ZOOM_BUTTON does. */
+#define VGA_PIXELS_X                   640
+#define VGA_PIXELS_Y                   480
+#define VGA_CURSOR_ARM                 5     // Pixels each side of the centre
+#define VGA_CURSOR_XOR                 RASTER_INVERT  // Inverts every colour bit
+#define VGA_PICK_TOP                   50    // Pixel rows that pick a column,
+#define VGA_PICK_BOTTOM                300   // both plots
+#define VGA_PICK_ROW                   24    // Status text line of the readout
+
+/* Frame pacing: a 640x480 30-bit frame in X-Y mode spans 1.9 MB of the 2 MB
+ * SRAM, the only memory the pixel DMA master can reach, so there is no room
+ * for a separate back buffer. With front == back a swap request completes at
+ * the next refresh, which is used as a vsync to start drawing on. */
+#define VGA_SWAP_TIMEOUT_MS            50    // Two refreshes at 60 Hz, with margin
+
+/* Where the frame is scanned out from. The SRAM is a memory of its own
+ * beside the SDRAM that holds the code, data, heap and stacks, so the
+ * scan-out never queues the control path at the SDRAM controller; only
+ * drawing touches the SRAM. The frame addresses are the pixel DMA's reset
+ * values, which a regenerated system may put elsewhere: vInitializeVGA()
+ * moves a frame it finds outside the SRAM here. */
+#ifndef VGA_FRAME_BASE
+#define VGA_FRAME_BASE                 SRAM_BASE
+#endif
+#define VGA_FRAME_BYTES                (VGA_PIXELS_Y * 4096)  // X-Y mode, rows of 1024 4-byte pixels at most
+#if VGA_FRAME_BASE < SRAM_BASE || VGA_FRAME_BASE + VGA_FRAME_BYTES > SRAM_BASE + SRAM_SPAN
+#error "VGA_FRAME_BASE must leave the whole frame in the SRAM"
+#endif
+#if FREQ_JOURNAL && (VGA_PIXELS_X * 4 > JOURNAL_TAIL_OFFSET || VGA_PIXELS_Y < JOURNAL_ROWS)
+#error "FREQ_JOURNAL needs the row tails of a frame at most 768 pixels wide and 256 rows high"
+#endif
+
+/* Longest wait for a 2D engine to finish a frame's primitives (vga_raster.h);
+ * the display co-routine cannot block and polls */
+#if FREQ_UI_COROUTINES
+#define VGA_RASTER_SYNC_TICKS          0
+#else
+#define VGA_RASTER_SYNC_TICKS          pdMS_TO_TICKS(VGA_SWAP_TIMEOUT_MS)
+#endif
+
+/* Time-sliced trace drawing: a full redraw is every segment of three traces
+ * back to back, tens of milliseconds of the CPU and the SRAM the pixel DMA
+ * also reads. The erase and draw loops work in chunks of at most
+ * VGA_CHUNK_SEGMENTS segments, and once VGA_CHUNK_US has gone by since the
+ * last pause the display finishes the engine's queue and sleeps a tick, so
+ * the tasks below it get a turn inside every chunk's worth of drawing.
+ * VGA_CHUNK_US 0 draws a frame in one go. The co-routine display runs on
+ * the idle task and cannot sleep mid-frame; the benchmark times frames
+ * whole. */
+#ifndef VGA_CHUNK_US
+#if FREQ_UI_COROUTINES || FREQ_RELAY_BENCH
+#define VGA_CHUNK_US                   0
+#else
+#define VGA_CHUNK_US                   2000
+#endif
+#endif
+#define VGA_CHUNK_SEGMENTS             16    // Longest polyline of one trace
+#define VGA_CHUNK_GAP_TICKS            1
+
+/* Frame governor: the display draws every VGA_DISPLAY_PERIOD_MS while the
+ * CPU has headroom. While the idle task's share since the last frame is
+ * below VGA_GOVERN_IDLE_LOW it draws only every second, third ... period,
+ * up to VGA_GOVERN_MAX_DIVIDE, and comes back a period at a time once the
+ * share is above VGA_GOVERN_IDLE_HIGH. A disturbance that loads the control
+ * path then slows the plots down before it costs a deadline. The co-routine
+ * display only ever gets idle time and is not governed. */
+#ifndef VGA_GOVERN
+#define VGA_GOVERN                     1
+#endif
+#define VGA_GOVERN_IDLE_LOW            150   // Permille of the CPU
+#define VGA_GOVERN_IDLE_HIGH           350
+#define VGA_GOVERN_MAX_DIVIDE          5     // A frame a second
+
+/* Status text column, lines are blank padded to the width */
+#define VGA_STATUS_X                   40
+#define VGA_STATUS_WIDTH               (TEXT_COLS - VGA_STATUS_X)
+
+/* Diagnostics pages, in the text rows below the plots with a row of tabs
+ * above them. T steps through the pages, 1 to 6 pick one (vDrawPage). */
+#define VGA_PAGE_X                     4
+#define VGA_PAGE_Y                     40
+#define VGA_PAGE_ROWS                  (RUN_STATS_MAX_TASKS + 2)  // Tasks page: header, tasks, total
+#define VGA_PAGE_TABS_Y                (VGA_PAGE_Y - 1)
+#define VGA_PAGE_PLOTS                 0      // Nothing below the plots
+#define VGA_PAGE_TASKS                 1      // Run time statistics
+#define VGA_PAGE_MEMORY                2      // Memory census, two entries a row
+#define VGA_PAGE_LOADS                 3      // Decision and output of each load
+#define VGA_PAGE_LATENCY               4      // Shed latency and the period monitors
+#define VGA_PAGE_EVENTS                5      // Newest event log records
+#define VGA_PAGES                      6
+#define VGA_CENSUS_HALF                38     // Columns per census entry
+#if PERIOD_MAX_MONITORS + 5 > VGA_PAGE_ROWS || EVENT_LOG_RECENT + 2 > VGA_PAGE_ROWS || LOAD_PORT_BITS + 2 > VGA_PAGE_ROWS
+#error "A diagnostics page has more rows than VGA_PAGE_ROWS"
+#endif
 
 /* Load Shedding Configuration */
 #define LOAD_PRIORITY_1                0x01  // Critical loads (never shed)
@@ -68,10 +943,21 @@
 #define LOAD_PRIORITY_4                0x08  // Low priority loads
 #define LOAD_PRIORITY_MASK             0x0F  // All loads mask
 
-/* Status Indicators */
-#define STATUS_NORMAL                  0
-#define STATUS_ALERT                   1
-#define STATUS_FAILSAFE                2
+/* Deadline escalation by the system monitor, see period_monitor.h */
+#define DEADLINE_ALERT_PERIODS         10   // Monitor periods in alert after a control task misses
+#define DEADLINE_FAILSAFE_RUN          3    // Consecutive misses of one control task that latch failsafe
+
+/* Heartbeats checked by vWatchdogTask, one per control task */
+#define WATCHDOG_BEAT_ANALYZER         0x01
+#define WATCHDOG_BEAT_MONITOR          0x02
+#define WATCHDOG_BEAT_ACTUATOR         0x04
+#define WATCHDOG_BEATS                 (0 APP_TASKS(APP_TASK_HEARTBEAT))
+#define WATCHDOG_TRIP_MS               (3 * WATCHDOG_PERIOD_MS)  // No kick this long trips from the tick hook
+
+/* Task notification bits for vSystemMonitorTask */
+#define MONITOR_NOTIFY_FEEDBACK        0x01  // Actuators have settled, read the feedback
+#define MONITOR_NOTIFY_RESET           0x02  // System reset, forget past mismatches
+#define MONITOR_NOTIFY_FAILSAFE        0x04  // The failsafe latch has a new source to report
 
 /* System Fault Indicators */
 #define FAULT_NONE                     0
@@ -79,160 +965,1067 @@
 
 /* Shared data structures */
 typedef struct {
-    double current_freq;       // Current frequency in Hz
-    double prev_freq;          // Previous frequency reading
-    double roc;                // Rate of change (Hz/s)
-    double upper_limit;        // Upper frequency limit
-    double lower_limit;        // Lower frequency limit
+    fix16_t current_freq;      // Current frequency in Hz (Q16.16)
+    fix16_t prev_freq;         // Previous frequency reading (Q16.16)
+    fix16_t roc;               // Rate of change in Hz/s (Q16.16)
+    fix16_t roc_peak;          // Decided on, see FREQ_ROC_PEAK_SAMPLES (Q16.16)
+    fix16_t upper_limit;       // Upper frequency limit (Q16.16)
+    fix16_t lower_limit;       // Lower frequency limit (Q16.16)
     int is_stable;             // Frequency stability flag
+    LatencyStamp_t stamp;      // Timestamps of the newest sample along the control path
 } FrequencyData_t;
 
+/* Limits the analyzer applies, edited at runtime from the keyboard */
+typedef struct {
+    fix16_t upper_limit;       // Upper frequency limit (Q16.16)
+    fix16_t lower_limit;       // Lower frequency limit (Q16.16)
+    fix16_t max_roc;           // |RoC| above which the frequency is unstable (Q16.16)
+} Thresholds_t;
+
+/* Every feeder's thresholds, published as a whole (see vThresholdPublish) */
+typedef struct {
+    Thresholds_t channel[FREQ_CHANNELS];
+} ThresholdConfig_t;
+
 typedef struct {
-    uint16_t load_status;      // (current status)16 bits, each bit represents a load 0- dis; 1-con
-    uint16_t requested_status; // (Requested status)Requested status after decision for each load
+    LoadMask_t load_status;    // (current status) each bit represents a load 0- dis; 1-con
+    LoadMask_t requested_status; // (Requested status)Requested status after decision for each load
     uint16_t priority_mask;    // Priority mask for load shedding
 } LoadDecision_t;
 
 typedef struct {
-	uint16_t actuator_status;  // (Actuator status)16 bits, each bit represents a load 0- dis; 1-con
+	LoadMask_t actuator_status; // (Actuator status) each bit represents a load 0- dis; 1-con
 	uint16_t system_fault;     // Fault detection flag (0=normal, 1=fault detected)
+	LoadMask_t faulty_loads;   // Loads with a persistent feedback mismatch
 	uint16_t priority_mask;    // Priority mask matching the LoadDecision priority
 } Actuator_t;
 
+/* What the decision and actuator write on every event, with the lock that
+ * guards it: 20 bytes with one load port, one D-cache line */
 typedef struct {
-    uint8_t system_state;      // Overall system state
-    uint8_t alert_active;      // Alert flag
-    uint8_t failsafe_active;   // Failsafe flag
-    uint8_t override_active;   // Manual override flag
-} SystemStatus_t;
+    SeqLock_t lock;
+    LoadDecision_t decision;
+    Actuator_t actuator;
+} LoadState_t;
+
+/* Single-producer/single-consumer ring of raw analyser counts.
+ * The ISR is the only writer of head, dropped and high_water, the analyzer
+ * task the only writer of tail. Both indices run freely and are masked on
+ * access, so head - tail is the fill level (past FREQ_RING_SIZE when
+ * FREQ_RING_DROP_OLDEST has overwritten readings the analyzer had not
+ * reached). */
+typedef struct {
+    volatile uint32_t head;                 // Next slot the ISR writes
+    volatile uint32_t tail;                 // Next slot the analyzer reads
+    volatile uint32_t dropped;              // Samples lost because the ring was full
+    volatile uint32_t high_water;           // Highest fill level after a push
+    volatile uint32_t count[FREQ_RING_SIZE]; // Raw FREQUENCY_ANALYSER_BASE readings
+    volatile uint32_t stamp[FREQ_RING_SIZE]; // Timestamp count at capture of each reading
+} FreqSampleRing_t;
+
+/* Everything one feeder's samples touch, in one block starting on a D-cache
+ * line, so the analyzer's pass over the channels walks each block in turn
+ * instead of interleaving lines from separate arrays */
+typedef struct {
+    FreqSampleRing_t ring;
+    FreqEstimator_t estimator;
+    FrequencyData_t data;                   // Analyzer's working copy
+    uint32_t base;                          // Analyser registers, read by the ISR
+    uint32_t channel;
+    uint32_t trip_run;                      // Counts in a row past INSTANT_TRIP_COUNT, pushing side only
+} __attribute__((aligned(ALT_CPU_DCACHE_LINE_SIZE))) FreqChannel_t;
+
+/* One analyzer pass, handed to the actuator by pointer */
+typedef struct {
+    FrequencyData_t channel[FREQ_CHANNELS];
+    uint32_t newest;                        // Channel with the latest capture, for the latency stamps
+    uint32_t band_key;                      // For the decision memo, ulDecisionKey
+    uint32_t unstable;                      // Channels outside their limits, a bit each
+} FreqResult_t;
 
-/* Line structure for VGA drawing */
+/* One application task, created from xAppTasks in main, see APP_TASKS */
 typedef struct {
-    unsigned int x1;
-    unsigned int y1;
-    unsigned int x2;
-    unsigned int y2;
-} Line;
+    TaskFunction_t pxCode;
+    const char *pcName;
+    uint16_t usStackWords;
+    StackType_t *pxStack;      // Static stack, NULL to allocate from the heap
+    UBaseType_t uxPriority;
+    uint16_t usPeriodMs;       // Period, or deadline of an event driven task
+    TaskHandle_t *pxHandle;
+} AppTask_t;
 
 /* Task handles */
 TaskHandle_t xSystemMonitorTask;
 TaskHandle_t xFreqAnalyzerTask;
 TaskHandle_t xLoadActuatorTask;
 TaskHandle_t xVGADisplayTask;
-TaskHandle_t xManualOverrideTask;
+TaskHandle_t xThresholdEditTask;
+TaskHandle_t xModbusTask;
+TaskHandle_t xCoordTask;
+TaskHandle_t xEthTask;
+TaskHandle_t xTimeSyncTask;
+TaskHandle_t xRunStatsTask;
+TaskHandle_t xFlashTask;
+TaskHandle_t xWatchdogTask;
+TaskHandle_t xSystemStateTask;
+#if FREQ_FAULT_INJECT
+static TaskHandle_t xFaultHogTask;
+#endif
+
+#if configUSE_NEWLIB_REENTRANT == 2
+/* C library contexts (see vTaskSetNewlibReent) of the tasks that print or
+ * write to the UART, so each has its own errno, stdout and stdout buffer.
+ * The control path keeps no libc state and stays on newlib's global
+ * context, which otherwise only main and the idle task use. */
+static struct _reent xRunStatsReent;
+static struct _reent xFlashReent;
+static struct _reent xDaemonReent;
+#if !FREQ_UI_COROUTINES
+static struct _reent xThresholdEditReent;
+#endif
+
+/* Their stdout buffers, which newlib would otherwise allocate at each
+ * context's first printf, after the heap is frozen. vStdoutStatic() from
+ * the task before it prints. */
+static char cRunStatsStdout[STDOUT_BUFFER_BYTES];
+static char cFlashStdout[STDOUT_BUFFER_BYTES];
+static char cDaemonStdout[STDOUT_BUFFER_BYTES];
+#if !FREQ_UI_COROUTINES
+static char cThresholdEditStdout[STDOUT_BUFFER_BYTES];
+#endif
+#define vStdoutStatic(buffer)          ((void)setvbuf(stdout, (buffer), _IOLBF, STDOUT_BUFFER_BYTES))
+#else
+#define vStdoutStatic(buffer)          ((void)0)
+#endif
+
+/* Sequence locks for shared data - writers never wait, readers retry */
+FAST_DATA SeqLock_t xLatencySeq = SEQLOCK_INIT;  // Guards gDecisionLatency and gShedLatency
+
+/* Software timer handles */
+TimerHandle_t xReconnectTimer;         // Stable hold-off before the next reconnection
+TimerHandle_t xSwitchDebounceTimer;    // Restarted on every slide switch change
+TimerHandle_t xFeedbackTimer;          // Actuator settle time after an output write
+TimerHandle_t xTelemetryTimer;         // Drains the telemetry ring every TELEMETRY_PERIOD_MS
+
+/* Global shared data - protected by the sequence locks above, all of it on
+ * the ISR/control path so kept in on-chip RAM */
+FAST_DATA CACHE_LINE LoadState_t gLoad = { SEQLOCK_INIT };  // Decision and actuator status
+
+/* Thresholds: readers take the pointer and use the copy it points at, which
+ * is never written while published. Written only by vThresholdPublish. */
+static FAST_DATA ThresholdConfig_t xThresholdConfig[2];
+FAST_DATA const ThresholdConfig_t * volatile gThresholds;
+
+/* Per-feeder sample rings (lock free, see FreqSampleRing_t) and analyzer state,
+ * in the data TCM with the interrupt stack in "make tcm" */
+FAST_ISR_DATA CACHE_LINE FreqChannel_t gFreqChannel[FREQ_CHANNELS];
+
+/* Frequency of each count from the shortest valid one, so the estimators
+ * look the valid band (246 to 400 counts at 16 kHz) up instead of dividing */
+static FAST_RODATA const fix16_t xFreqCountTable[FREQ_EST_TABLE_SIZE] =
+    FREQ_EST_TABLE(SAMPLING_FREQ_Q16, FREQ_TABLE_FIRST);
+
+/* Analyzer results for the actuator. The analyzer fills a slot and swaps it
+ * into the mailbox, the actuator takes it out and owns it until the next
+ * one arrives, so a result crosses over as one pointer. The frequency topic
+ * carries the latest one to the slower readers. */
+FAST_DATA POOL_STORAGE(xFreqResultSlots, FreqResult_t, FREQ_RESULT_SLOTS);
+static FAST_DATA Pool_t xFreqResultPool;
+static FAST_DATA void *volatile pvFreqResultMailbox = NULL;
+FAST_DATA BUS_STORAGE(xFreqTopicSlot, FreqResult_t, 1);
+static FAST_DATA BusTopic_t xFreqTopic;     // Latest value, written by the analyzer
+
+/* Written only by vLoadActuatorTask, read by the display */
+FAST_DATA LatencyStats_t gDecisionLatency; // Capture to decision, every new sample
+FAST_DATA LatencyStats_t gShedLatency;     // Capture to load output write, when loads are shed
+
+/* Telemetry compression, each stage used by the one task posting it */
+static SwingStage_t xFreqSwing[FREQ_CHANNELS];  // Analyzer
+static SwingStage_t xDecisionSwing;             // Actuator
+
+#if FREQ_ROC_PEAK_SAMPLES > 1
+/* Windowed RoC peak of each feeder, by estimate number. Analyzer. */
+static WindowExtrema_t xRocPeak[FREQ_CHANNELS];
+static uint32_t ulRocPeakSeq[FREQ_CHANNELS];
+#endif
+static const int32_t lFreqSwingTolerance[2] = { FIX16_CONST(TELEMETRY_FREQ_TOL), FIX16_CONST(TELEMETRY_ROC_TOL) };
+
+/* Minute, hour and day statistics: frequency in mHz by the analyzer, shed
+ * latency in us by the actuator. In SDRAM, they are large and cold. */
+Stats_t gFreqStats[FREQ_CHANNELS];
+Stats_t gShedStats;
+
+/* Boot milestones, us after main started the timestamp timer (the BSP's
+ * driver initialisation before main is not counted), 0 until reached */
+static struct {
+    uint32_t start;
+    uint32_t ready_us;                 // Control path set up, scheduler starting
+    volatile uint32_t protect_us;      // First load decision applied
+} xBoot;
+
+/* Last slide switch value seen by the tick hook */
+static uint32_t ulSwitchSeen = 0;
+
+/* Set by the reconnect timer, consumed by vMakeLoadDecision */
+static volatile uint8_t xReconnectDue = 0;
+
+/* AUDIT_REASON_* for the loads the decision sheds next: set by
+ * vMakeLoadDecision and the system reset, read by the actuator */
+static volatile uint8_t ucShedReason = AUDIT_REASON_NONE;
+
+/* Minimum on/off times of the registry loads, vMakeLoadDecision only */
+static LoadLocks_t xLoadLocks;
+
+#if FREQ_UF_CURVES
+/* Trip curves and each feeder's stage timers, vMakeLoadDecision only */
+static UfCurves_t xUfCurves;
+static UfCurveState_t xUfState[FREQ_CHANNELS];
+#endif
+#if FREQ_UF_DEADLINE
+/* Each feeder's next stage trip, and the loads it sheds */
+static Deadline_t xUfDeadline[FREQ_CHANNELS];
+static volatile LoadMask_t xUfDeadlineLoads[FREQ_CHANNELS];
+#endif
+
+/* Release jitter, execution time and deadline misses, one per periodic task */
+static FAST_DATA PeriodMonitor_t xAnalyzerPeriod;
+static FAST_DATA PeriodMonitor_t xMonitorPeriod;
+static FAST_DATA PeriodMonitor_t xActuatorPeriod;
+#if FREQ_TIME_TRIGGERED
+static FAST_DATA PeriodMonitor_t xCyclicPeriod;
+#endif
+
+/* Health word inputs (health.h), each written by one task and read by the
+ * actuator: a recent deadline miss (monitor), missing heartbeats
+ * (watchdog), the loads held off (actuator) */
+static volatile uint8_t ucHealthDeadline = 0;
+static volatile uint8_t ucHealthWatchdog = 0;
+static uint32_t ulShedLoads = 0;
+
+/* System monitor state, vMonitorFeedback() only */
+static FeedbackFilter_t xMonitorFeedback;
+static uint32_t ulFeedbackReads = 0;
+#if FREQ_TIME_TRIGGERED
+static volatile uint32_t ulMonitorEvents = 0;  // MONITOR_NOTIFY_*, taken by vCyclicTask
+#endif
+#if !FREQ_HEADLESS
+static PeriodMonitor_t xVGAPeriod;
+#endif
+static PeriodMonitor_t xRunStatsPeriod;
+static PeriodMonitor_t xTelemetryPeriod;
+static PeriodMonitor_t xFlashPeriod;
+static PeriodMonitor_t xModbusPeriod;
+#if FREQ_ETHERNET
+static PeriodMonitor_t xEthPeriod;
+static void *volatile pvModbusDatagram = NULL;  // Newest request over UDP, for the Modbus task
+#endif
+#if FREQ_COORD
+static PeriodMonitor_t xCoordPeriod;
+static PeriodMonitor_t xTimeSyncPeriod;
+static uint16_t usCoordStageKw[COORD_STAGES];  // Reported every period, fixed at boot
+#endif
+
+#if FREQ_TRACE_REPLAY
+/* Trace replay, set up by the edit task while inactive, then run by the tick hook */
+static TraceGen_t xTraceGen;
+static uint32_t ulTraceScenario = 0;
+static Prng_t xTraceSeeds;             // Seeded in main, FREQ_TRACE_SEED
+static uint32_t ulTraceSeed;           // Noise seed of the current replay
+static uint32_t ulTraceBudget;         // Sample periods elapsed since the last count was pushed
+static uint32_t ulTraceNext;           // Count waiting to be pushed
+static uint32_t ulTraceSpeed = 1;      // Trace time per real time, set while inactive
+static uint32_t ulTraceChannels = 1;   // Feeders the replay feeds, from feeder 0
+static volatile uint8_t xTraceActive = 0;
+#endif
+
+#if FREQ_RATE_SWEEP
+/* Sweep step, set by the run stats task while the replay is inactive */
+static const TraceScenario_t *pxSweepScenario;
+static uint32_t ulSweepStep = 0;
+static volatile uint32_t ulSweepIsrCycles = 0;  // Tick hook: time injecting this step
+#endif
+
+#if FREQ_RELAY_SOAK
+/* Soak figures: the histograms are written by the actuator, each counter by
+ * the one context named, and all are read by the run stats task */
+static SeqLock_t xSoakSeq = SEQLOCK_INIT;
+static SoakHist_t xSoakShed;           // Capture to shed output
+static SoakHist_t xSoakDecision;       // Capture to decision
+static volatile uint32_t ulSoakScenarios = 0;  // Daemon: scenarios started
+static volatile uint32_t ulSoakFailsafes = 0;  // Daemon: scenarios that ended in failsafe
+static volatile uint32_t ulSoakFaults = 0;     // Monitor: feedback mismatches raised
+#endif
+
+#if FREQ_RELAY_BENCH
+static TaskHandle_t xBenchTask;
+static TaskHandle_t xBenchPeerTask;    // Other end of the context switch round trip
+#endif
+
+#if FREQ_INTEGRITY
+/* Integrity regions the threshold editor rewrites, -1 before main adds them */
+static int xThresholdRegion = -1;
+static int xPolicyRegion = -1;
+#endif
+
+/* Set by the VGA task after requesting a swap, cleared by the tick hook */
+static volatile uint8_t xVGASwapPending = 0;
+
+#if !FREQ_HEADLESS
+/* VGA buffer handles */
+alt_up_pixel_buffer_dma_dev *pixel_buf;
+alt_up_char_buffer_dev *char_buf;
 
-/* Semaphores and mutex handles */
-SemaphoreHandle_t xConfigRegsMutex;    // Protects configuration registers
-SemaphoreHandle_t xActuatorStatusMutex; // Protects actuator status registers
-SemaphoreHandle_t xShedRegsMutex;      // Protects shedding registers
+/* Large frequency digits, display only */
+static GlyphReadout_t xFreqReadout;
+#endif
 
-/* Queue handles */
-QueueHandle_t xFreqDataQueue;          // Queue for frequency data
-QueueHandle_t xFreqResultQueue;        // Queue for frequency analysis results
+/* Threshold the keyboard currently edits, EDIT_FIELD_* */
+static volatile uint8_t xEditField = EDIT_FIELD_UPPER;
 
-/* Global shared data - protected by mutex */
-FrequencyData_t gFrequencyData;
-LoadDecision_t gLoadDecision;
-Actuator_t gActuator;                  // New global actuator status
-SystemStatus_t gSystemStatus;
+/* Feeder the keyboard edits and the display shows, cycled with F */
+static volatile uint8_t xEditChannel = 0;
 
-/* VGA buffer handles */
-alt_up_pixel_buffer_dma_dev *pixel_buf;
-alt_up_char_buffer_dev *char_buf;
+#if FREQ_FAULT_INJECT
+/* FAULT_* the keyboard edits in EDIT_FIELD_FAULT, cycled with I */
+static uint32_t ulEditFault = 0;
+#endif
+
+#if !FREQ_HEADLESS
+/* History zoom level shown on the plots, cycled by VGA_ZOOM_BUTTON */
+static volatile uint8_t xVGAZoomLevel = 0;
+
+/* Display periods per frame, set by the frame governor */
+static uint8_t xVGAFrameDivide = 1;
+
+/* Mouse cursor. Moved by the threshold editor under vCursorLock, taken
+ * off the frame by the display around its plot drawing, which the editor
+ * cannot interrupt. Shown once the display has set the frame up, and only
+ * with a mouse on the port. */
+static int16_t xCursorX = VGA_PIXELS_X / 2;
+static int16_t xCursorY = VGA_PIXELS_Y / 2;
+static uint8_t xCursorDrawn = 0;
+static uint8_t xCursorEnabled = 0;
+
+#if !FREQ_UI_COROUTINES
+/* Ceiling at the display's priority: while the editor moves the cursor the
+ * display cannot run, and the tasks above it never wait for the editor */
+static SemaphoreHandle_t xCursorMutex;
+
+static inline void vCursorLock(void) {
+    xSemaphoreTake(xCursorMutex, portMAX_DELAY);
+}
+
+static inline void vCursorUnlock(void) {
+    xSemaphoreGive(xCursorMutex);
+}
+#else
+/* The display and the editor are co-routines on the idle task, neither
+ * runs while the other is between yields: nothing to lock */
+static inline void vCursorLock(void) {
+}
+
+static inline void vCursorUnlock(void) {
+}
+#endif
+
+/* Plot column clicked, plus one, for the display to read out */
+static volatile uint8_t xVGAPick = 0;
+
+/* Diagnostics page shown, VGA_PAGE_*, selected by the threshold editor */
+static volatile uint8_t xVGAPage = VGA_PAGE_PLOTS;
+#endif
+
+/* Memory census asked for from the keyboard, written by the run stats task */
+static volatile uint8_t xCensusDumpPending = 0;
+
+#if configUSE_HEAP_TRACE
+/* Allocation report asked for from the shell, written by the run stats task */
+static volatile uint8_t xHeapTraceDumpPending = 0;
+#endif
+
+/* Thresholds written over Modbus or the shell, waiting for the threshold
+ * editor to publish the feeders flagged in ulModbusChannels. Both in
+ * critical sections. */
+static ThresholdConfig_t xModbusThresholds;
+static volatile uint32_t ulModbusChannels = 0;
+
+#if FREQ_UI_COROUTINES
+/* Set by the benchmarks to stop the UI co-routines; busy while the idle hook
+ * is inside one */
+static volatile uint8_t xUiPaused = 0;
+static volatile uint8_t xUiBusy = 0;
+#endif
+
+#if FREQ_RELAY_PROFILE
+/* Profile dump asked for from the keyboard, written by the run stats task */
+static volatile uint8_t xProfileDumpPending = 0;
+#endif
+
+#if configAPP_STATIC_STACKS
+#define APP_STACK(buffer)              (buffer)
+APP_TASKS(APP_TASK_STACK)
+#if FREQ_RELAY_BENCH
+static FAST_STACK StackType_t xBenchStack[BENCH_STACK];
+static FAST_STACK StackType_t xBenchPeerStack[BENCH_PEER_STACK];
+#endif
+#else
+#define APP_STACK(buffer)              NULL
+#endif
 
 /*-----------------------------------------------------------*/
 /* Function prototypes */
-static void vSystemMonitorTask(void *pvParameters);
-static void vFrequencyAnalyzerTask(void *pvParameters);
-static void vLoadActuatorTask(void *pvParameters);
-static void vVGADisplayTask(void *pvParameters);
-static void vManualOverrideTask(void *pvParameters);
-
-static void vKeyboardISRHandler(void* context);
-static void vSystemResetISRHandler(void* context);
+APP_TASKS_HERE(APP_TASK_PROTOTYPE)
+#if FREQ_UI_COROUTINES
+#if !FREQ_HEADLESS
+static void vDisplayCoRoutine(CoRoutineHandle_t xHandle, UBaseType_t uxIndex);
+#endif
+static void vKeysCoRoutine(CoRoutineHandle_t xHandle, UBaseType_t uxIndex);
+static void vStateCoRoutine(CoRoutineHandle_t xHandle, UBaseType_t uxIndex);
+#endif
+static void vThresholdEditKeys(Thresholds_t *pxEdit);
+#if !FREQ_HEADLESS
+static void vPlotMouse(void);
+#endif
+static void vThresholdApply(uint32_t channel, const Thresholds_t *pxNew);
+#if FREQ_JOURNAL
+static void vJournalThresholds(uint32_t channel, const Thresholds_t *pxThresholds);
+#endif
+static void vShowState(EventBits_t flags);
+static void vLcdRefresh(void);
+
+static void vButtonISRHandler(void* context);
+static void vButtonReset(BaseType_t *pxHigherPriorityTaskWoken);
+static void vButtonFailsafe(BaseType_t *pxHigherPriorityTaskWoken);
+#if !FREQ_HEADLESS
+static void vButtonZoom(BaseType_t *pxHigherPriorityTaskWoken);
+#endif
 static void vFrequencyISRHandler(void* context);
 //static void vShedISRHandler(void* context);
-static void vFailSafeISRHandler(void* context);
-
-static void vMakeLoadDecision(FrequencyData_t *pxFreqData, LoadDecision_t *pxLoadDecision);
-static uint8_t vCheckActuatorStatus(LoadDecision_t *pxLoadDecision, Actuator_t *pxActuator);
+static void vFailsafeReport(void);
+static void vFailsafeReportDeferred(void *pvParameter1, uint32_t ulParameter2);
+#if FREQ_TRACE_REPLAY
+static void vTraceReplayTick(void);
+static void vTraceReplayNext(void);
+#endif
+#if FREQ_RELAY_SOAK
+static void vSoakNextDeferred(void *pvParameter1, uint32_t ulParameter2);
+static void vSoakSummary(const RunStats_t *pxStats);
+#endif
+#if FREQ_RELAY_BENCH
+static void vBenchTask(void *pvParameters);
+static void vBenchPeerTask(void *pvParameters);
+#endif
+
+static void vAnalyzerInit(void);
+static void vAnalyzerStep(void);
+static void vActuatorStep(void);
+static void vMonitorInit(void);
+static void vMonitorNotify(uint32_t ulEvents);
+static void vMonitorFeedback(uint32_t ulEvents);
+static void vMonitorPeriodic(void);
+static void vMakeLoadDecision(FreqResult_t *pxResult, LoadDecision_t *pxLoadDecision);
+static void vShedPublish(LoadMask_t requested);
+static void vHealthUpdate(void);
+static void vReconnectTimerCallback(TimerHandle_t xTimer);
+static void vSwitchDebounceCallback(TimerHandle_t xTimer);
+static void vFeedbackTimerCallback(TimerHandle_t xTimer);
+static void vTelemetryTimerCallback(TimerHandle_t xTimer);
+#if !FREQ_HEADLESS
 static void vInitializeVGA(void);
-static void vDrawFrequencyPlot(double *freq, double *dfreq, int oldest_idx);
+static void vDrawFrequencyPlot(const HistoryColumn_t *pxColumns);
+static void vCursorHide(void);
+static void vCursorShow(void);
+static void vDrawPage(void);
+#endif
+static void vStatusValues(StatusValues_t *pxValues, const FrequencyData_t *pxData, uint8_t state,
+                          LoadMask_t loads);
+static void vConfigCollect(ConfigParams_t *pxConfig, const Thresholds_t *pxThresholds);
+
+/* Interrupts registered through xIrqRegister, reported by vRunStatsTask,
+ * with the shortest interval between two of them for the response time
+ * analysis */
+static const struct {
+    uint32_t irq;
+    const char *name;
+    uint32_t interval_us;
+} xTimedIrqs[] = {
+    { FREQUENCY_ANALYSER_IRQ,   "FreqAn",  RTA_SAMPLE_MIN_US },
+#if FREQ_CHANNELS > 1
+    { FREQUENCY_ANALYSER_1_IRQ, "FreqAn1", RTA_SAMPLE_MIN_US },
+#endif
+#if FREQ_CHANNELS > 2
+    { FREQUENCY_ANALYSER_2_IRQ, "FreqAn2", RTA_SAMPLE_MIN_US },
+#endif
+#if FREQ_CHANNELS > 3
+    { FREQUENCY_ANALYSER_3_IRQ, "FreqAn3", RTA_SAMPLE_MIN_US },
+#endif
+    { PUSH_BUTTON_IRQ,          "Button",  RTA_BUTTON_MIN_US },
+    { PS2_IRQ,                  "PS2",     RTA_PS2_MIN_US    },
+    { UART_IRQ,                 "Modbus",  RTA_UART_MIN_US   },
+#if FREQ_COORD
+    { COORD_UART_IRQ,           "Coord",   RTA_UART_MIN_US   },
+#endif
+#if FREQ_DEADLINE_TIMER
+    { DEADLINE_TIMER_IRQ,       "Dline",   RTA_SAMPLE_MIN_US / FREQ_CHANNELS },
+#endif
+#if FREQ_IRQ_LATENCY
+    { LATENCY_TIMER_IRQ,        "LatTst",  IRQ_LATENCY_PERIOD_US },
+#endif
+#if FREQ_ETHERNET
+    { SGDMA_RX_IRQ,             "EthRx",   RTA_ETH_MIN_US    },
+    { SGDMA_TX_IRQ,             "EthTx",   RTA_ETH_MIN_US    },
+#endif
+#ifdef VIDEO_2D_ENGINE_IRQ
+    { VIDEO_2D_ENGINE_IRQ,      "2D",      RTA_ENGINE_MIN_US },
+#endif
+};
+
+/* Feeder analysers, see FREQ_CHANNELS */
+static const struct {
+    uint32_t base;
+    uint32_t irq;
+    LoadMask_t loads;          // Outputs this feeder supplies
+} xFreqChannelHw[FREQ_CHANNELS] = {
+    { FREQUENCY_ANALYSER_BASE,   FREQUENCY_ANALYSER_IRQ,   FREQ_CHANNEL_0_LOADS },
+#if FREQ_CHANNELS > 1
+    { FREQUENCY_ANALYSER_1_BASE, FREQUENCY_ANALYSER_1_IRQ, FREQ_CHANNEL_1_LOADS },
+#endif
+#if FREQ_CHANNELS > 2
+    { FREQUENCY_ANALYSER_2_BASE, FREQUENCY_ANALYSER_2_IRQ, FREQ_CHANNEL_2_LOADS },
+#endif
+#if FREQ_CHANNELS > 3
+    { FREQUENCY_ANALYSER_3_BASE, FREQUENCY_ANALYSER_3_IRQ, FREQ_CHANNEL_3_LOADS },
+#endif
+};
+
+/* Application tasks, in APP_TASKS order */
+static const AppTask_t xAppTasks[APP_TASK_COUNT] = {
+    APP_TASKS(APP_TASK_ENTRY)
+};
 
 /*-----------------------------------------------------------*/
 /* ISR Handler Functions */
 
-/* Keyboard ISR Handler */
-static void vKeyboardISRHandler(void* context) {
+/* Push button actions, in the order a single edge capture runs them:
+ * failsafe ahead of reset so a press of both leaves the relay latched.
+ * Each runs at interrupt level and defers anything slow to a task. */
+typedef struct {
+    uint8_t ucButton;                  // *_BUTTON bit in the edge capture
+    void (*pvAction)(BaseType_t *pxHigherPriorityTaskWoken);
+} ButtonAction_t;
+
+static const ButtonAction_t xButtonActions[] = {
+    { FAILSAFE_BUTTON, vButtonFailsafe },
+    { RESET_BUTTON,    vButtonReset    },
+#if !FREQ_HEADLESS
+    { VGA_ZOOM_BUTTON, vButtonZoom     }
+#endif
+};
+
+/* Push button ISR Handler: one edge capture read for every button. Only
+ * the edges read are acknowledged, so a press landing in between stays
+ * captured and raises the interrupt again. */
+static void vButtonISRHandler(void* context) {
     BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-    uint8_t key_value;
+    uint32_t edges;
+    uint32_t i;
 
-    /* Read keyboard data */
-    key_value = IORD_ALTERA_AVALON_PIO_DATA(PUSH_BUTTON_BASE);
+    WCET_BEGIN(WCET_ISR_BUTTON);
 
-    /* Clear the interrupt */
-    IOWR_ALTERA_AVALON_PIO_EDGE_CAP(PUSH_BUTTON_BASE, 0x7);
+    edges = ulBoardButtonEdges(BUTTONS);
+    JOURNAL_INPUT(JOURNAL_BUTTONS, 0, edges);
 
-    /* Process key value based on system state */
-    if (gSystemStatus.system_state == STATUS_NORMAL) {
-        /* Normal operation key handling */
-    } else if (gSystemStatus.system_state == STATUS_ALERT) {
-        /* Alert operation key handling */
+    for (i = 0; i < sizeof(xButtonActions) / sizeof(xButtonActions[0]); i++) {
+        if (edges & xButtonActions[i].ucButton) {
+            xButtonActions[i].pvAction(&xHigherPriorityTaskWoken);
+        }
     }
 
+    WCET_END(WCET_ISR_BUTTON, edges, 0);
     portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
 }
 
+#if !FREQ_HEADLESS
+/* Next plot time span, picked up by the display on its next frame */
+static void vButtonZoom(BaseType_t *pxHigherPriorityTaskWoken) {
+    (void)pxHigherPriorityTaskWoken;
+
+    xVGAZoomLevel = (xVGAZoomLevel + 1) % PLOT_LEVELS;
+}
+#endif
 
-// system reset should be configured as a hardware interrupt callback
-/* System Reset ISR Handler */
-static void vSystemResetISRHandler(void* context) {
-    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-   // int i;
 
-    /* Clear the interrupt */
-    IOWR_ALTERA_AVALON_PIO_EDGE_CAP(PUSH_BUTTON_BASE, 0x7);
+/* System reset, task half: runs in the timer daemon with interrupts on */
+static void vSystemResetDeferred(void *pvParameter1, uint32_t ulParameter2) {
+    (void)pvParameter1;
+    (void)ulParameter2;
+
+    vEventLogPost(EVENT_RESET, 0, 0);
 
     /* Reset system state */
-    gSystemStatus.system_state = STATUS_NORMAL;
-    gSystemStatus.alert_active = 0;
-    gSystemStatus.failsafe_active = 0;
-    gSystemStatus.override_active = 0;
+    vFailsafeClear();
+    vWarmStateClear();
+    vStateClear(STATE_FLAGS);
+
+    /* Drop the latched commands, the decision starts again from nothing */
+    ucShedReason = AUDIT_REASON_RESET;
+    vOutputRelease(OUTPUT_SOURCE_FAILSAFE);
+    vOutputRelease(OUTPUT_SOURCE_OVERRIDE);
+    vOutputPost(OUTPUT_SOURCE_DECISION, 0x0000);
+
+    /* The monitor owns the feedback filter */
+    vMonitorNotify(MONITOR_NOTIFY_RESET);
+
+    /* Reset all loads, staged reconnection brings them back */
+    vShedPublish(0x0000);
+    vSeqWriteBegin(&gLoad.lock);
+    gLoad.decision.load_status = 0x0000;       // All possible loads disconnected
+    gLoad.decision.requested_status = 0x0000;  // All loads requested off
+    gLoad.actuator.actuator_status = 0x0000;   // All actuators disconnected
+
+    /* Reset actuator fault status */
+    gLoad.actuator.system_fault = FAULT_NONE;
+    gLoad.actuator.faulty_loads = 0;
+
+    /* Reset priority masks */
+    gLoad.decision.priority_mask = LOAD_PRIORITY_MASK;
+    gLoad.actuator.priority_mask = LOAD_PRIORITY_MASK;
+    vSeqWriteEnd(&gLoad.lock);
+}
+
+/* System reset, RESET_BUTTON: the reset itself is deferred */
+static void vButtonReset(BaseType_t *pxHigherPriorityTaskWoken) {
+    WCET_BEGIN(WCET_ISR_RESET);
+    xIrqDefer(vSystemResetDeferred, NULL, 0, pxHigherPriorityTaskWoken);
+    WCET_END(WCET_ISR_RESET, 0, 0);
+}
+
+/* Tick hook: poll for the end of a requested buffer swap. The pixel buffer
+ * DMA has no interrupt, so this is the cheapest point to catch the vsync
+ * without the VGA task spinning on the status register.
+ * The input snapshot is taken here first (input_snapshot.h). The slide
+ * switch PIO has no edge capture, so changes are caught in it; each one
+ * restarts the debounce timer. */
+void vApplicationTickHook(void) {
+    InputSnapshot_t xInputs;
+    uint32_t ulSwitches;
+#if FREQ_FAULT_INJECT
+    alt_irq_context context;
+    uint32_t ulSpurious;
+#endif
+
+    WCET_BEGIN(WCET_TICK);
+    vInputSnapshotTake(xTaskGetTickCountFromISR());
+    vInputSnapshotGet(&xInputs);
+    ulSwitches = xInputs.switches;
+    vTimeBaseTick();
+
+    if (ulSwitches != ulSwitchSeen) {
+        ulSwitchSeen = ulSwitches;
+        JOURNAL_INPUT(JOURNAL_SWITCHES, JOURNAL_SWITCHES_CHANGED, ulSwitches);
+        xTimerResetFromISR(xSwitchDebounceTimer, NULL);
+    }
+
+#if !FREQ_HEADLESS
+    if (xVGASwapPending && !alt_up_pixel_buffer_dma_check_swap_buffers_status(pixel_buf)) {
+        xVGASwapPending = 0;
+#if !FREQ_UI_COROUTINES
+        /* Runs inside the tick ISR, the woken task is scheduled on return */
+        vTaskNotifyGiveFromISR(xVGADisplayTask, NULL);
+#endif
+    }
+#endif
+
+#if FREQ_TRACE_REPLAY
+    if (xTraceActive) {
+        vTraceReplayTick();
+    }
+#endif
+#if FREQ_FAULT_INJECT
+    /* Enter the handler as the vector would, at its level so the real
+     * interrupt cannot push alongside; the analyser has nothing new */
+    for (ulSpurious = ulFaultSpuriousDue(); ulSpurious > 0; ulSpurious--) {
+        context = alt_irq_disable_all();
+        vFrequencyISRHandler(&gFreqChannel[0]);
+        alt_irq_enable_all(context);
+    }
+#endif
+
+    /* The supervisor has stopped kicking: latch failsafe here, the
+     * monitor may have stopped too, so the daemon reports it if it still
+     * runs */
+    if (xWatchdogTickExpired()) {
+        xFailsafeTripFromISR(EVENT_SOURCE_WATCHDOG, 0, NULL);
+        xIrqDefer(vFailsafeReportDeferred, NULL, 0, NULL);
+    }
+#if configUSE_BUDGET_SERVER
+    vBudgetServerTick();
+#endif
+    WCET_END(WCET_TICK, ulSwitches, 0);
+}
+
+/* Tickless idle policy, called by the port before the tick is stopped. The
+ * tick hook is the only thing watching the switches and the buffer swap, so
+ * the sleep is capped to keep switch changes within a debounce period, and
+ * skipped altogether while a swap is outstanding. */
+void vApplicationPreSleepProcessing(TickType_t *pxIdleTime) {
+    if (xVGASwapPending) {
+        *pxIdleTime = 0;
+#if FREQ_TRACE_REPLAY
+    } else if (xTraceActive) {
+        *pxIdleTime = 0;  // The replay is paced by every tick
+#endif
+    } else if (xIdleJobsPending()) {
+        *pxIdleTime = 0;  // Back round the idle loop
+#if configUSE_BUDGET_SERVER
+    } else if (xBudgetServerThrottled()) {
+        *pxIdleTime = 0;  // The refill is counted in the tick hook
+#endif
+    } else if (*pxIdleTime > pdMS_TO_TICKS(IDLE_SLEEP_MAX_MS)) {
+        *pxIdleTime = pdMS_TO_TICKS(IDLE_SLEEP_MAX_MS);
+    }
+}
 
-    /* Reset all loads to on */
-    /* Reset all loads to on */
-    if (xSemaphoreTakeFromISR(xActuatorStatusMutex, &xHigherPriorityTaskWoken) == pdTRUE) {
-        /* Set all 16 bits to 1 for full capability, though we're only using 7 now */
-        gLoadDecision.load_status = 0x0000;       // All possible loads disconnected
-        gLoadDecision.requested_status = 0x0000;  // All loads requested off
-        gActuator.actuator_status = 0x0000;       // All actuators disconnected
+#if FREQ_ANALYSER_FIFO
+/* Timestamp counts per sample clock, to date the counts of a batch */
+static FAST_ISR_DATA uint32_t ulStampPerCount;
+#endif
+
+/* One slot of vFreqSamplePush() */
+static inline void vFreqSampleStore(FreqSampleRing_t *pxRing, uint32_t count, uint32_t stamp,
+                                    BaseType_t *pxHigherPriorityTaskWoken) {
+    uint32_t head = pxRing->head;
+    uint32_t level = head - pxRing->tail;
+
+    if (level >= FREQ_RING_SIZE) {
+        /* Ring full - the analyzer is behind */
+        pxRing->dropped++;
+#if FREQ_RING_POLICY == FREQ_RING_COALESCE
+        /* The analyzer is FREQ_RING_SIZE readings short of this slot */
+        pxRing->count[(head - 1) & FREQ_RING_MASK] = count;
+        pxRing->stamp[(head - 1) & FREQ_RING_MASK] = stamp;
+#endif
+#if FREQ_RING_POLICY != FREQ_RING_DROP_OLDEST
+        return;
+#endif
+        level = FREQ_RING_SIZE - 1;
+    }
+    pxRing->count[head & FREQ_RING_MASK] = count;
+    pxRing->stamp[head & FREQ_RING_MASK] = stamp;
+    pxRing->head = ++head;
+    if (++level > pxRing->high_water) {
+        pxRing->high_water = level;
+    }
 
-        /* Reset actuator fault status */
-        gActuator.system_fault = FAULT_NONE;
+    /* Only wake the analyzer when the fill level reaches the watermark.
+     * One pass drains every channel, whichever ring woke it. */
+    if (level == FREQ_RING_WATERMARK && xFreqAnalyzerTask != NULL) {
+        vTaskNotifyGiveFromISR(xFreqAnalyzerTask, pxHigherPriorityTaskWoken);
+    }
+}
 
-        /* Reset priority masks */
-        gLoadDecision.priority_mask = LOAD_PRIORITY_MASK;
-        gActuator.priority_mask = LOAD_PRIORITY_MASK;
+/* Queue one period count, captured at timestamp stamp, for the analyzer,
+ * from interrupt level. Only one source pushes to a ring at a time: its
+ * frequency ISR, or for the feeders it replays to the trace replay in the
+ * tick hook while their ISRs discard their readings. Fault injection may drop the count or
+ * queue it twice. */
+static inline void vFreqSamplePush(FreqSampleRing_t *pxRing, uint32_t count, uint32_t stamp,
+                                   BaseType_t *pxHigherPriorityTaskWoken) {
+#if FREQ_FAULT_INJECT
+    uint32_t copies;
+
+    for (copies = ulFaultSampleCopies(); copies > 0; copies--) {
+        vFreqSampleStore(pxRing, count, stamp, pxHigherPriorityTaskWoken);
+    }
+#else
+    vFreqSampleStore(pxRing, count, stamp, pxHigherPriorityTaskWoken);
+#endif
+}
 
-        xSemaphoreGiveFromISR(xActuatorStatusMutex, &xHigherPriorityTaskWoken);
+/* Instant trip check on one count, from interrupt level beside the push.
+ * The latch is cheap to hit again, so a collapse that outlasts a reset
+ * trips again on its next count. */
+static inline void vFreqInstantTrip(FreqChannel_t *pxChannel, uint32_t count,
+                                    BaseType_t *pxHigherPriorityTaskWoken) {
+#if INSTANT_TRIP_PERIODS
+    if (count <= INSTANT_TRIP_COUNT) {
+        pxChannel->trip_run = 0;
+        return;
     }
+    if (pxChannel->trip_run < INSTANT_TRIP_PERIODS) {
+        pxChannel->trip_run++;
+    }
+    if (pxChannel->trip_run == INSTANT_TRIP_PERIODS) {
+        xFailsafeTripFromISR(EVENT_SOURCE_TRIP, (pxChannel->channel << 16) | (count & 0xFFFF),
+                             pxHigherPriorityTaskWoken);
+    }
+#else
+    (void)pxChannel;
+    (void)count;
+    (void)pxHigherPriorityTaskWoken;
+#endif
+}
 
+#if FREQ_TRACE_REPLAY
+/* Tick hook half of the replay: push each count once that many sample
+ * periods have passed, so samples arrive at the rate the trace describes */
+static void vTraceReplayTick(void) {
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    uint32_t i;
+#if FREQ_RATE_SWEEP
+    uint32_t start = ulLatencyNow();
+#endif
+
+    ulTraceBudget += ulTraceSpeed * ((uint32_t)SAMPLING_FREQ / configTICK_RATE_HZ);
+    while (ulTraceBudget >= ulTraceNext) {
+        ulTraceBudget -= ulTraceNext;
+        for (i = 0; i < ulTraceChannels; i++) {
+            JOURNAL_INPUT(JOURNAL_PERIOD, i, ulTraceNext);
+            vFreqSamplePush(&gFreqChannel[i].ring, ulTraceNext, ulLatencyNow(), &xHigherPriorityTaskWoken);
+            vFreqInstantTrip(&gFreqChannel[i], ulTraceNext, &xHigherPriorityTaskWoken);
+        }
+        if (!xTraceGenNext(&xTraceGen, &ulTraceNext)) {
+#if FREQ_RATE_SWEEP
+            /* The step plays the trace round until the sweep moves on */
+            vTraceGenStart(&xTraceGen, pxSweepScenario, (uint32_t)SAMPLING_FREQ, ulTraceSeed);
+            if (xTraceGenNext(&xTraceGen, &ulTraceNext)) {
+                continue;
+            }
+#endif
+            xTraceActive = 0;
+#if FREQ_RELAY_SOAK
+            xIrqDefer(vSoakNextDeferred, NULL, 0, &xHigherPriorityTaskWoken);
+#endif
+            break;
+        }
+    }
+#if FREQ_RATE_SWEEP
+    ulSweepIsrCycles += ulLatencyNow() - start;
+#endif
     portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
 }
 
-/* Frequency ISR Handler */
+/* Start the next scenario, stopping any that is running. From one task at a
+ * time: the edit task, or in soak builds the daemon. */
+static const TraceScenario_t *pxTraceReplayStart(void) {
+    const TraceScenario_t *pxScenario;
+
+    xTraceActive = 0;
+    pxScenario = &xTraceScenarios[ulTraceScenario];
+    ulTraceScenario = (ulTraceScenario + 1) % ulTraceScenarioCount;
+
+    ulTraceSeed = ulPrngNext(&xTraceSeeds);
+    vTraceGenStart(&xTraceGen, pxScenario, (uint32_t)SAMPLING_FREQ, ulTraceSeed);
+    ulTraceBudget = 0;
+    if (xTraceGenNext(&xTraceGen, &ulTraceNext)) {
+        xTraceActive = 1;
+    }
+    return pxScenario;
+}
+
+#if FREQ_RELAY_SOAK
+/* Soak, daemon half: the last scenario has ended. Clear any failsafe it
+ * latched the way the reset button would, then start the next one. */
+static void vSoakNextDeferred(void *pvParameter1, uint32_t ulParameter2) {
+    if (ulFailsafeLatched()) {
+        ulSoakFailsafes++;
+        vSystemResetDeferred(NULL, 0);
+    }
+    (void)pxTraceReplayStart();
+    ulSoakScenarios++;
+}
+#endif
+
+#if FREQ_RATE_SWEEP
+#define SWEEP_STEPS                    (FREQ_CHANNELS * SWEEP_SPEEDS)
+
+/* Baselines at the start of the step, daemon written, run stats read */
+static uint32_t ulSweepDropped;
+static uint32_t ulSweepMisses;
+static TickType_t xSweepStartTick;
+
+/* Samples lost on every ring, and deadline misses of every monitor */
+static void vSweepCounts(uint32_t *pulDropped, uint32_t *pulMisses) {
+    PeriodStats_t period;
+    uint32_t i;
+
+    *pulDropped = 0;
+    for (i = 0; i < FREQ_CHANNELS; i++) {
+        *pulDropped += gFreqChannel[i].ring.dropped;
+    }
+    *pulMisses = 0;
+    for (i = 0; i < ulPeriodCount(); i++) {
+        vPeriodGetStats(i, &period);
+        *pulMisses += period.misses;
+    }
+}
+
+/* Sweep, daemon half: start step ulSweepStep with every figure its line
+ * reports from zero, clearing any failsafe the last left latched the way
+ * the reset button would. Past the last step the replay stays off. */
+static void vSweepStepDeferred(void *pvParameter1, uint32_t ulParameter2) {
+    uint32_t i;
+
+    xTraceActive = 0;
+    if (ulFailsafeLatched()) {
+        vSystemResetDeferred(NULL, 0);
+    }
+    if (ulSweepStep >= SWEEP_STEPS) {
+        return;
+    }
+    ulTraceChannels = ulSweepStep / SWEEP_SPEEDS + 1;
+    ulTraceSpeed = 1UL << (ulSweepStep % SWEEP_SPEEDS);
+
+    taskENTER_CRITICAL();
+    for (i = 0; i < FREQ_CHANNELS; i++) {
+        gFreqChannel[i].ring.high_water = 0;
+    }
+    ulSweepIsrCycles = 0;
+    taskEXIT_CRITICAL();
+    vSeqWriteBegin(&xLatencySeq);
+    memset(&gShedLatency, 0, sizeof(LatencyStats_t));
+    vSeqWriteEnd(&xLatencySeq);
+    vSweepCounts(&ulSweepDropped, &ulSweepMisses);
+    xSweepStartTick = xTaskGetTickCount();
+
+    vTraceGenStart(&xTraceGen, pxSweepScenario, (uint32_t)SAMPLING_FREQ, ulTraceSeed);
+    ulTraceBudget = 0;
+    if (xTraceGenNext(&xTraceGen, &ulTraceNext)) {
+        xTraceActive = 1;
+    }
+}
+
+/* Sweep, run stats half: the line of the step that has run, then the next
+ * step. Under the UART. */
+static void vSweepReport(void) {
+    LatencyStats_t shed;
+    uint32_t dropped, misses, high_water = 0, elapsed_ms, i;
+    uint64_t permille;
+
+    if (ulSweepStep == 0) {
+        printf("#SWEEP,%s,seed %lu\n", pxSweepScenario->name, (unsigned long)ulTraceSeed);
+        printf("#SWEEP,feeders,samples_per_s,isr_permille,dropped,ring_high,sheds,shed_mean_us,"
+               "shed_max_us,shed_misses,period_misses\n");
+    }
+    vSweepCounts(&dropped, &misses);
+    for (i = 0; i < FREQ_CHANNELS; i++) {
+        if (gFreqChannel[i].ring.high_water > high_water) {
+            high_water = gFreqChannel[i].ring.high_water;
+        }
+    }
+    vLatencyGetStats(&gShedLatency, &xLatencySeq, &shed);
+    elapsed_ms = (uint32_t)((xTaskGetTickCount() - xSweepStartTick) * portTICK_PERIOD_MS);
+    permille = (uint64_t)ulSweepIsrCycles * 1000U /
+               ((uint64_t)(elapsed_ms ? elapsed_ms : 1) * 1000U * ulLatencyCountsPerUs());
+
+    printf("SWEEP,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu\n",
+           (unsigned long)ulTraceChannels, (unsigned long)(ulTraceSpeed * (uint32_t)NOMINAL_FREQ),
+           (unsigned long)permille, (unsigned long)(dropped - ulSweepDropped),
+           (unsigned long)high_water, (unsigned long)shed.count,
+           (unsigned long)ulLatencyMeanUs(&shed), (unsigned long)shed.max_us,
+           (unsigned long)shed.deadline_misses, (unsigned long)(misses - ulSweepMisses));
+    if (++ulSweepStep >= SWEEP_STEPS) {
+        printf("#SWEEP,end\n");
+    }
+    fflush(stdout);
+    xTimerPendFunctionCall(vSweepStepDeferred, NULL, 0, portMAX_DELAY);
+}
+#endif
+
+/* Edit task half: the G key */
+static void vTraceReplayNext(void) {
+    const TraceScenario_t *pxScenario;
+
+#if FREQ_RELAY_SOAK
+    /* Every start of a soak run goes through the daemon */
+    xTimerPendFunctionCall(vSoakNextDeferred, NULL, 0, portMAX_DELAY);
+    return;
+#endif
+#if FREQ_RATE_SWEEP
+    /* The sweep owns the replay */
+    return;
+#endif
+    pxScenario = pxTraceReplayStart();
+
+    xTelemetryUartTake(portMAX_DELAY);
+    printf("Trace replay: %s, seed %lu\n", pxScenario->name, (unsigned long)ulTraceSeed);
+    fflush(stdout);
+    vTelemetryUartGive();
+}
+#endif
+
+/* Frequency ISR Handler, one registration per feeder with its channel as
+ * the context */
+#if !FREQ_ANALYSER_FIFO
 static void vFrequencyISRHandler(void* context) {
+    FreqChannel_t *pxChannel = (FreqChannel_t *)context;
     BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-    double freq;
+    uint32_t count;
+
+    WCET_BEGIN(WCET_ISR_FREQ);
+    PERF_SECTION_BEGIN(PERF_SECTION_ISR);
+
+    /* Always read the analyser so the hardware sees the sample consumed */
+    count = ulBoardFreqPeriod(pxChannel->base);
 
-    /* Calculate frequency from the frequency analyzer hardware */
-    freq = SAMPLING_FREQ / (double)IORD(FREQUENCY_ANALYSER_BASE, 0);
+#if FREQ_TRACE_REPLAY
+    if (xTraceActive && pxChannel->channel < ulTraceChannels) {
+        PERF_SECTION_END(PERF_SECTION_ISR);
+        return;
+    }
+#endif
+    JOURNAL_INPUT(JOURNAL_PERIOD, pxChannel->channel, count);
+    vFreqSamplePush(&pxChannel->ring, count, ulLatencyNow(), &xHigherPriorityTaskWoken);
+    vFreqInstantTrip(pxChannel, count, &xHigherPriorityTaskWoken);
+    PERF_SECTION_END(PERF_SECTION_ISR);
+    WCET_END(WCET_ISR_FREQ, pxChannel->channel, 1);
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
 
-    /* Send frequency to the queue for processing */
-    xQueueSendToBackFromISR(xFreqDataQueue, &freq, &xHigherPriorityTaskWoken);
+#else
+/* FIFO analyser: the whole batch in one interrupt. The newest count ended
+ * about now, each one before it ended one period earlier, so the capture
+ * stamps are dated back by the counts that follow them. */
+static void vFrequencyISRHandler(void* context) {
+    FreqChannel_t *pxChannel = (FreqChannel_t *)context;
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    uint32_t count[FREQ_ANALYSER_FIFO_DEPTH];
+    uint32_t level, later, stamp, i;
+
+    WCET_BEGIN(WCET_ISR_FREQ);
+    PERF_SECTION_BEGIN(PERF_SECTION_ISR);
+    stamp = ulLatencyNow();
+    level = ulBoardFreqLevel(pxChannel->base);
+    if (level > FREQ_ANALYSER_FIFO_DEPTH) {
+        level = FREQ_ANALYSER_FIFO_DEPTH;
+    }
+    later = 0;
+    for (i = 0; i < level; i++) {
+        count[i] = ulBoardFreqPeriod(pxChannel->base);
+        later += i > 0 ? count[i] : 0;
+    }
+    if (xBoardFreqOverflow(pxChannel->base)) {
+        pxChannel->ring.dropped++;
+    }
 
+#if FREQ_TRACE_REPLAY
+    if (xTraceActive && pxChannel->channel < ulTraceChannels) {
+        PERF_SECTION_END(PERF_SECTION_ISR);
+        return;
+    }
+#endif
+    stamp -= later * ulStampPerCount;
+    for (i = 0; i < level; i++) {
+        stamp += i > 0 ? count[i] * ulStampPerCount : 0;
+        JOURNAL_INPUT(JOURNAL_PERIOD, pxChannel->channel, count[i]);
+        vFreqSamplePush(&pxChannel->ring, count[i], stamp, &xHigherPriorityTaskWoken);
+        vFreqInstantTrip(pxChannel, count[i], &xHigherPriorityTaskWoken);
+    }
+    PERF_SECTION_END(PERF_SECTION_ISR);
+    WCET_END(WCET_ISR_FREQ, pxChannel->channel, level);
     portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
 }
+#endif
 
 // DEPRECATED. Reason: We need a writer for makeLoadDecision function to maintain SRP.
 // Unnecessary to create an INT. Not a periodic task
@@ -243,584 +2036,5003 @@ static void vFrequencyISRHandler(void* context) {
 static void vShedISRHandler(void* context) {
     BaseType_t xHigherPriorityTaskWoken = pdFALSE;
 
-    gSystemStatus.alert_active = 1;
+    xStateSetFromISR(STATE_ALERT, &xHigherPriorityTaskWoken);
 
     portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
 }
 */
 
 
-// TODO failsafe ISR should be called immediately once system failure detected
-/* Failsafe ISR Handler */
-static void vFailSafeISRHandler(void* context) {
-    // emergency disconnection. Cut-off everything.
-    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-
-    /* Immediately activate failsafe mode */
-    gSystemStatus.failsafe_active = 1;
-    gSystemStatus.system_state = STATUS_FAILSAFE;
+/* Failsafe, task half: every source the latch has taken since the last
+ * report goes to the state flag, the event log and the display, and the
+ * decision is brought in line with the output. The monitor runs it on its
+ * notification; the daemon and the watchdog run it when the monitor may be
+ * the task that stopped. Each source is taken once, whoever runs first. */
+static void vFailsafeReport(void) {
+    uint32_t sources = ulFailsafeTakeUnreported();
+    uint32_t source, detail;
+    int first;
 
-    /* Turn off non-critical loads immediately */
-    if (xSemaphoreTakeFromISR(xActuatorStatusMutex, &xHigherPriorityTaskWoken) == pdTRUE) {
-        /* Start with all loads disconnected */
-        gLoadDecision.load_status = 0x0000;
-        gLoadDecision.requested_status = 0x0000;
+    if (sources == 0) {
+        return;
+    }
+    first = !(xStateGet() & STATE_FAILSAFE);
+    vStateSet(STATE_FAILSAFE);
+    vDisturbanceTrigger(DISTURB_CAUSE_FAILSAFE, sources);
+
+    /* An owner the trip interrupted mid-update may have written its own
+     * choice once more; the post has it apply the failsafe again */
+    vOutputPost(OUTPUT_SOURCE_FAILSAFE, LOAD_PRIORITY_1);
+
+    while (sources) {
+        source = (uint32_t)__builtin_ctz(sources);
+        sources &= ~(1UL << source);
+        detail = ulFailsafeDetail(source);
+        vEventLogPost(EVENT_FAILSAFE, source, detail);
+        vWarmStateFailsafe(source, detail);
+        if (first) {
+            vSevenSegFault(source, source == EVENT_SOURCE_MONITOR ? (uint16_t)detail : 0);
+            first = 0;
+        }
+    }
 
-        /* Keep only load 0 connected (critical) */
-        gLoadDecision.load_status |= LOAD_PRIORITY_1;
-        gLoadDecision.requested_status |= LOAD_PRIORITY_1;
+    vSeqWriteBegin(&gLoad.lock);
+    /* Keep only load 0 connected (critical) */
+    gLoad.decision.load_status = LOAD_PRIORITY_1;
+    gLoad.decision.requested_status = LOAD_PRIORITY_1;
+    vSeqWriteEnd(&gLoad.lock);
+}
 
-        /* Directly write to the load output - only critical loads (first load) */
-        IOWR_ALTERA_AVALON_PIO_DATA(GREEN_LEDS_BASE, LOAD_PRIORITY_1);
+static void vFailsafeReportDeferred(void *pvParameter1, uint32_t ulParameter2) {
+    (void)pvParameter1;
+    (void)ulParameter2;
 
-        xSemaphoreGiveFromISR(xActuatorStatusMutex, &xHigherPriorityTaskWoken);
-    }
+    vFailsafeReport();
+}
 
-    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+/* Failsafe test, FAILSAFE_BUTTON: the latch drives the critical load
+ * before the interrupt returns, the monitor does the rest */
+static void vButtonFailsafe(BaseType_t *pxHigherPriorityTaskWoken) {
+    WCET_BEGIN(WCET_ISR_FAILSAFE);
+    xFailsafeTripFromISR(EVENT_SOURCE_ISR, 0, pxHigherPriorityTaskWoken);
+    WCET_END(WCET_ISR_FAILSAFE, 0, 0);
 }
 
 /*-----------------------------------------------------------*/
 /* Task Functions */
 
-/* System Monitor Task */
-static void vSystemMonitorTask(void *pvParameters) {
-    TickType_t xLastWakeTime;
-    int alert_count = 0;
+static void vMonitorInit(void) {
+    vFeedbackInit(&xMonitorFeedback);
+#if FEEDBACK_INJECT_PERMILLE
+    vFeedbackInjectSeed(FEEDBACK_INJECT_SEED);
+#endif
+
+    /* First periodic check one period from now */
+    vPeriodAlign(&xMonitorPeriod);
+}
+
+/* MONITOR_NOTIFY_* from task context (both senders run in the daemon) */
+static void vMonitorNotify(uint32_t ulEvents) {
+#if FREQ_TIME_TRIGGERED
+    taskENTER_CRITICAL();
+    ulMonitorEvents |= ulEvents;
+    taskEXIT_CRITICAL();
+#else
+    xTaskNotify(xSystemMonitorTask, ulEvents, eSetBits);
+#endif
+}
+
+/* System monitor, feedback half: after each write has settled, for
+ * FEEDBACK_FOLLOW_READS periods after that, then every FEEDBACK_SWEEP_MS */
+static void vMonitorFeedback(uint32_t ulEvents) {
+    static LoadMask_t last_faulty = 0;
+    static uint32_t follow = FEEDBACK_FOLLOW_READS;
+    static TickType_t last_read = 0;
+    InputSnapshot_t xInputs;
     uint8_t fault_status;
+    LoadMask_t driven, actual, faulty;
+    TickType_t now = xTaskGetTickCount();
 
-    /* Initialize the xLastWakeTime variable with the current time */
-    xLastWakeTime = xTaskGetTickCount();
+    WCET_BEGIN(WCET_FEEDBACK);
+    if (ulEvents & MONITOR_NOTIFY_RESET) {
+        vFeedbackInit(&xMonitorFeedback);
+    }
 
-    for (;;) {
-        /* Wait for the next cycle */
-        vTaskDelayUntil(&xLastWakeTime, pdMS_TO_TICKS(SYSTEM_MONITOR_PERIOD_MS));
-
-        /* Check for actuator faults by comparing requested vs actual status */
-        if (xSemaphoreTake(xActuatorStatusMutex, portMAX_DELAY) == pdTRUE) {
-            fault_status = vCheckActuatorStatus(&gLoadDecision, &gActuator);
-            gActuator.system_fault = fault_status;
-            xSemaphoreGive(xActuatorStatusMutex);
-
-            /* If fault detected, activate failsafe */
-            if (fault_status == FAULT_DETECTED) {
-                gSystemStatus.failsafe_active = 1;
-                gSystemStatus.system_state = STATUS_FAILSAFE;
-            }
-        }
+    /* A settled write is read at once and followed for a few periods, in
+     * case a relay is slow; with nothing written the outputs only drift
+     * by a fault, which the slow sweep finds */
+    if (ulEvents & (MONITOR_NOTIFY_FEEDBACK | MONITOR_NOTIFY_RESET)) {
+        follow = FEEDBACK_FOLLOW_READS + 1;
+    }
 
-        /* Monitor system parameters */
-        if (xSemaphoreTake(xConfigRegsMutex, portMAX_DELAY) == pdTRUE) {
-            /* Check frequency stability */
-            if (!gFrequencyData.is_stable) {
-                alert_count++;
-            } else {
-                if (alert_count > 0) {
-                    alert_count--;
-                }
-            }
+    /* Compare the actuator feedback with the driven outputs. A read inside
+     * a settle window would see relays still moving, so it waits for the
+     * timer. */
+    if ((follow > 0 || now - last_read >= pdMS_TO_TICKS(FEEDBACK_SWEEP_MS)) &&
+        !xTimerIsTimerActive(xFeedbackTimer)) {
+        last_read = now;
+        if (follow > 0) {
+            follow--;
+        }
+        ulFeedbackReads++;
+        vInputSnapshotGet(&xInputs);
+        driven = xInputs.driven;
+        actual = xFeedbackRead(xInputs.feedback);
+#if FREQ_FAULT_INJECT
+        actual = xFaultFeedback(driven, actual);
+#endif
+        JOURNAL_INPUT(JOURNAL_FEEDBACK, 0, actual);
+        faulty = xFeedbackFilter(&xMonitorFeedback, driven, actual);
+        fault_status = faulty ? FAULT_DETECTED : FAULT_NONE;
+
+        /* Published when it differs from what is there, which the system
+         * reset also writes, so a steady read costs no critical section */
+        if (gLoad.actuator.actuator_status != actual || gLoad.actuator.faulty_loads != faulty ||
+            gLoad.actuator.system_fault != fault_status) {
+            vSeqWriteBegin(&gLoad.lock);
+            gLoad.actuator.actuator_status = actual;
+            gLoad.actuator.faulty_loads = faulty;
+            gLoad.actuator.system_fault = fault_status;
+            vSeqWriteEnd(&gLoad.lock);
+        }
 
-            /* Update system state based on conditions */
-            if (gSystemStatus.failsafe_active) {
-                gSystemStatus.system_state = STATUS_FAILSAFE;
-            } else if (alert_count > 5) {
-                gSystemStatus.system_state = STATUS_ALERT;
-                gSystemStatus.alert_active = 1;
-            } else {
-                gSystemStatus.system_state = STATUS_NORMAL;
-                gSystemStatus.alert_active = 0;
+        if (faulty != last_faulty) {
+#if FREQ_RELAY_SOAK
+            if (faulty & ~last_faulty) {
+                ulSoakFaults++;
             }
+#endif
+            last_faulty = faulty;
+            vWarmStateFaults(faulty, fault_status);
+            vTelemetryPost(TELEMETRY_FAULT, faulty, driven, actual);
+            vEventLogPost(EVENT_FAULT, faulty, actual);
+        }
 
-            xSemaphoreGive(xConfigRegsMutex);
+        /* Resample quickly while a mismatch is being confirmed or cleared */
+        if (xMonitorFeedback.pending) {
+            xTimerReset(xFeedbackTimer, 0);
         }
 
-        /* Update LEDs to show system status */
-        if (gSystemStatus.system_state == STATUS_NORMAL) {
-            IOWR_ALTERA_AVALON_PIO_DATA(RED_LEDS_BASE, 0x0000); // All off
-        } else if (gSystemStatus.system_state == STATUS_ALERT) {
-            IOWR_ALTERA_AVALON_PIO_DATA(RED_LEDS_BASE, 0x5555); // Pattern
-        } else if (gSystemStatus.system_state == STATUS_FAILSAFE) {
-            IOWR_ALTERA_AVALON_PIO_DATA(RED_LEDS_BASE, 0xFFFF); // All on
+        /* Persistent mismatch: activate failsafe without waiting for the period */
+        if (fault_status == FAULT_DETECTED) {
+            xFailsafeTrip(EVENT_SOURCE_MONITOR, faulty);
         }
     }
+    WCET_END(WCET_FEEDBACK, ulEvents, last_faulty);
 }
 
-/* Frequency Analyzer Task */
-static void vFrequencyAnalyzerTask(void *pvParameters) {
-    TickType_t xLastWakeTime;
-    double new_freq;
-    FrequencyData_t local_freq_data;
-
-    /* Initialize the xLastWakeTime variable with the current time */
-    xLastWakeTime = xTaskGetTickCount();
-
-    /* Initialize local frequency data */
-    local_freq_data.current_freq = NOMINAL_FREQ;
-    local_freq_data.prev_freq = NOMINAL_FREQ;
-    local_freq_data.roc = 0.0;
-    local_freq_data.upper_limit = NOMINAL_FREQ + FREQ_TOLERANCE;
-    local_freq_data.lower_limit = NOMINAL_FREQ - FREQ_TOLERANCE;
-    local_freq_data.is_stable = 1;
+/* System monitor, periodic half: one job of xMonitorPeriod, already started */
+static void vMonitorPeriodic(void) {
+    static int alert_count = 0;
+    static int deadline_hold = 0;
+#if FREQ_INTEGRITY
+    static uint32_t integrity_failed = 0;
+    IntegrityRegion_t region;
+    uint32_t failed;
+#endif
+    uint32_t missed, run;
+    FreqResult_t freq;
+
+    WCET_BEGIN(WCET_MONITOR);
+
+    /* A control task past its deadline raises the alert; the same task
+     * missing DEADLINE_FAILSAFE_RUN in a row latches failsafe */
+    missed = ulPeriodControlCheck(&run);
+    if (missed) {
+        deadline_hold = DEADLINE_ALERT_PERIODS;
+        vEventLogPost(EVENT_DEADLINE, missed, run);
+        vLogPost(LOG_DEADLINE_MISSED, missed, run);
+    } else if (deadline_hold > 0) {
+        deadline_hold--;
+    }
+    ucHealthDeadline = deadline_hold > 0;
+    if (run >= DEADLINE_FAILSAFE_RUN) {
+        xFailsafeTrip(EVENT_SOURCE_DEADLINE, missed);
+    }
 
-    for (;;) {
-        /* Wait for the next cycle */
-        vTaskDelayUntil(&xLastWakeTime, pdMS_TO_TICKS(FREQ_ANALYZER_PERIOD_MS));
-
-        /* Check for new frequency data from ISR */
-        if (xQueueReceive(xFreqDataQueue, &new_freq, 0) == pdTRUE) {
-            /* Store previous frequency for calculation */
-            local_freq_data.prev_freq = local_freq_data.current_freq;
-            local_freq_data.current_freq = new_freq;
-
-            /* Calculate rate of change in Hz/s */
-            local_freq_data.roc = (local_freq_data.current_freq - local_freq_data.prev_freq) *
-                                  (1000.0 / FREQ_ANALYZER_PERIOD_MS);
-
-            /* Check stability criteria */
-            local_freq_data.is_stable = (local_freq_data.current_freq >= local_freq_data.lower_limit &&
-                                         local_freq_data.current_freq <= local_freq_data.upper_limit &&
-                                         fabs(local_freq_data.roc) < MAX_FREQ_ROC);
-
-            /* Update global frequency data */
-            if (xSemaphoreTake(xConfigRegsMutex, portMAX_DELAY) == pdTRUE) {
-                memcpy(&gFrequencyData, &local_freq_data, sizeof(FrequencyData_t));
-                xSemaphoreGive(xConfigRegsMutex);
-            }
+#if FREQ_INTEGRITY
+    /* Code or tables the background check found changed: nothing they
+     * decide can be trusted any more */
+    failed = ulIntegrityFailed();
+    if (failed & ~integrity_failed) {
+        vIntegrityGetRegion((uint32_t)__builtin_ctz(failed & ~integrity_failed), &region);
+        vLogPost(LOG_INTEGRITY, failed & ~integrity_failed, region.last);
+        integrity_failed = failed;
+        xFailsafeTrip(EVENT_SOURCE_INTEGRITY, failed);
+    }
+#endif
 
-            /* Send to results queue for other tasks */
-            xQueueSend(xFreqResultQueue, &local_freq_data, 0);
+    /* Check frequency stability, an unstable feeder is enough */
+    ulBusLatest(&xFreqTopic, &freq);
+    if (freq.unstable) {
+        alert_count++;
+    } else {
+        if (alert_count > 0) {
+            alert_count--;
         }
     }
-}
-static void vWriteLoadDecision(LoadDecision_t *pxLoadDecision) {
-    /* Take mutex to protect access to shedding registers */
-    if (xSemaphoreTake(xShedRegsMutex, portMAX_DELAY) == pdTRUE) {
-        /* Apply the requested status to the actual load status */
-        pxLoadDecision->load_status = pxLoadDecision->requested_status;
-
-        /* Update the hardware outputs */
-        IOWR_ALTERA_AVALON_PIO_DATA(GREEN_LEDS_BASE, pxLoadDecision->load_status);
-
-        /* Set alert flag to indicate a shedding operation occurred */
-        gSystemStatus.alert_active = 1;
 
-        xSemaphoreGive(xShedRegsMutex);
+    /* Alert while unstable or a control task is late, vSystemStateTask
+     * shows the change */
+    if (alert_count > 5 || deadline_hold > 0) {
+        vStateSet(STATE_ALERT);
+    } else {
+        vStateClear(STATE_ALERT);
     }
+    WCET_END(WCET_MONITOR, missed, freq.unstable == 0);
+    vPeriodEnd(&xMonitorPeriod);
 }
 
-/* Load Decision Function */
-static void vMakeLoadDecision(FrequencyData_t *pxFreqData, LoadDecision_t *pxLoadDecision) {
-    uint16_t load_mask = LOAD_PRIORITY_MASK; // Default mask
-    uint16_t original_requested_status = pxLoadDecision->requested_status;
-
-    /* Default is all loads off */
-    pxLoadDecision->requested_status = 0x0000;
+#if !FREQ_TIME_TRIGGERED
+/* System Monitor Task */
+static void vSystemMonitorTask(void *pvParameters) {
+    uint32_t ulEvents;
 
-    /* Check if frequency is below acceptable limits */
-    if (!pxFreqData->is_stable) {
-        if (pxFreqData->current_freq < pxFreqData->lower_limit) {
-            /* Shed loads based on severity */
-            double deviation = pxFreqData->lower_limit - pxFreqData->current_freq;
+    vMonitorInit();
 
-            if (deviation > 2.0) {
-                /* Severe under-frequency - keep only critical loads */
-                load_mask = LOAD_PRIORITY_1;
-            } else if (deviation > 1.0) {
-                /* Moderate under-frequency - keep critical and high priority */
-                load_mask = LOAD_PRIORITY_1 | LOAD_PRIORITY_2;
-            } else {
-                /* Minor under-frequency - shed only low priority loads */
-                load_mask = LOAD_PRIORITY_1 | LOAD_PRIORITY_2 | LOAD_PRIORITY_3;
-            }
-        } else if (pxFreqData->current_freq > pxFreqData->upper_limit) {
-            /* Over-frequency condition - we could implement a different response if needed */
-            load_mask = LOAD_PRIORITY_MASK;
+    for (;;) {
+        /* Sleep until the actuators settle after a write or the period ends */
+        xTaskNotifyWait(0, 0xFFFFFFFFUL, &ulEvents, xPeriodTicksToRelease(&xMonitorPeriod));
+        vWatchdogBeat(WATCHDOG_BEAT_MONITOR);
+        if (ulEvents & MONITOR_NOTIFY_FAILSAFE) {
+            vFailsafeReport();
         }
+        vMonitorFeedback(ulEvents);
 
-        /* Check rate of change for rapid response */
-        if (fabs(pxFreqData->roc) > MAX_FREQ_ROC) {
-            /* Rate of change too high, shed more loads */
-            load_mask &= (LOAD_PRIORITY_1 | LOAD_PRIORITY_2);
+        /* The remaining checks run once per period, a period the monitor
+         * itself overran is dropped rather than run twice */
+        if (xPeriodReleaseDue(&xMonitorPeriod)) {
+            vMonitorPeriodic();
         }
+    }
+}
+#endif
+
+/* Telemetry frames for one feeder's breakpoints, stamped at their captures */
+static void vTelemetryFreq(uint32_t channel, const FrequencyData_t *pxData) {
+    SwingPoint_t sample, breakpoints[2];
+    uint32_t n, i;
+
+    sample.value[0] = pxData->current_freq;
+    sample.value[1] = pxData->roc;
+    sample.flags = channel << 1 | (uint32_t)pxData->is_stable;
+    sample.stamp = pxData->stamp.capture;
+    n = ulSwingStageAdd(&xFreqSwing[channel], &sample, breakpoints);
+    for (i = 0; i < n; i++) {
+        vTelemetryPostAt(TELEMETRY_FREQ, breakpoints[i].stamp, (uint32_t)breakpoints[i].value[0],
+                         (uint32_t)breakpoints[i].value[1], breakpoints[i].flags);
+    }
+}
 
-        /* Apply loads based on priority mapping */
-        if (load_mask & LOAD_PRIORITY_1) {
-            pxLoadDecision->requested_status |= 0x0001;  // Load 0 is critical
-        }
+/* 1 if the newest result is outside the limits: below the lower, above the
+ * upper, or |RoC| at max_roc or more. Branch free, from the sign bits of the
+ * differences; every operand is well inside 2^30 (the estimator's valid
+ * range, 1.6 kHz/s of RoC at most), so none of them overflows. */
+static inline uint32_t ulLimitViolation(const FrequencyData_t *pxData, fix16_t max_roc) {
+    int32_t sign = pxData->roc >> 31;
+    int32_t roc = (pxData->roc ^ sign) - sign;
 
-        if (load_mask & LOAD_PRIORITY_2) {
-            pxLoadDecision->requested_status |= 0x0006;  // Loads 1-2 are high priority (bits 1-2)
-        }
+    return ((uint32_t)(pxData->current_freq - pxData->lower_limit) |
+            (uint32_t)(pxData->upper_limit - pxData->current_freq) | (uint32_t)(max_roc - 1 - roc)) >> 31;
+}
 
-        if (load_mask & LOAD_PRIORITY_3) {
-            pxLoadDecision->requested_status |= 0x0018;  // Loads 3-4 are medium priority (bits 3-4)
-        }
+/* One analyser count through the estimator and the stability check, then
+ * into the telemetry, and the display history if it is the feeder shown.
+ * Returns 0 if the estimator dropped the count (zero, out of range or a
+ * glitch), leaving *pxData as it was. */
+static int xAnalyzeSample(FreqEstimator_t *pxEstimator, uint32_t count, FrequencyData_t *pxData,
+                          fix16_t max_roc, uint32_t channel) {
+    fix16_t freq, roc;
 
-        if (load_mask & LOAD_PRIORITY_4) {
-            pxLoadDecision->requested_status |= 0x0060;  // Loads 5-6 are low priority (bits 5-6)
-        }
+    if (!xFreqEstAdd(pxEstimator, count, &freq, &roc)) {
+        return 0;
     }
-
-    /* Override with failsafe settings if active */
-    if (gSystemStatus.failsafe_active) {
-        /* Only keep critical load (bit 0) */
-        pxLoadDecision->requested_status = 0x0001;
+    /* The disturbance recorder keeps the lead-up to a RoC limit crossing */
+    if (FIX16_ABS(roc) >= max_roc && FIX16_ABS(pxData->roc) < max_roc) {
+        vDisturbanceTrigger(DISTURB_CAUSE_ROC, channel);
     }
-
-    /* If the decision has changed, write it to hardware */
-    if (pxLoadDecision->requested_status != original_requested_status) {
-        vWriteLoadDecision(pxLoadDecision);
+    pxData->prev_freq = pxData->current_freq;
+    pxData->current_freq = freq;
+    pxData->roc = roc;
+#if FREQ_ROC_PEAK_SAMPLES > 1
+    vWindowExtremaAdd(&xRocPeak[channel], ++ulRocPeakSeq[channel], roc, roc);
+    pxData->roc_peak = xWindowExtremaPeak(&xRocPeak[channel]);
+#else
+    pxData->roc_peak = roc;
+#endif
+
+    /* Check stability criteria */
+    pxData->is_stable = !ulLimitViolation(pxData, max_roc);
+
+#if !FREQ_HEADLESS
+    if (channel == xEditChannel) {
+        vHistoryAdd(pxData->current_freq, pxData->roc, xTaskGetTickCount());
     }
+#endif
+    vTelemetryFreq(channel, pxData);
+    return 1;
 }
 
-/* Function to check if actuator status matches load decision */
-static uint8_t vCheckActuatorStatus(LoadDecision_t *pxLoadDecision, Actuator_t *pxActuator) {
-  //  int i;
-    //uint8_t mismatch = 0;
-
-    // Redundant part
-    /* Compare each load's requested status with actual actuator status */
-    /*
-        if (pxLoadDecision->requested_status != pxActuator->actuator_status) {
-            mismatch = 1;
-            return mismatch;	// Return immediately
-        }
-*/
-
-    return pxLoadDecision->requested_status != pxActuator->actuator_status ? FAULT_DETECTED : FAULT_NONE;
+/* Estimators and per-feeder results from nothing */
+static void vAnalyzerInit(void) {
+    FreqChannel_t *pxChannel;
+    uint32_t i;
+
+    for (i = 0; i < FREQ_CHANNELS; i++) {
+        pxChannel = &gFreqChannel[i];
+        vFreqEstInit(&pxChannel->estimator, FREQ_EST_WINDOW, SAMPLING_FREQ_Q16,
+                     FIX16_CONST(VALID_FREQ_MIN), FIX16_CONST(VALID_FREQ_MAX));
+        vFreqEstTable(&pxChannel->estimator, xFreqCountTable, FREQ_TABLE_FIRST);
+
+        /* Initialize local frequency data */
+        pxChannel->data.current_freq = NOMINAL_FREQ_Q16;
+        pxChannel->data.prev_freq = NOMINAL_FREQ_Q16;
+        pxChannel->data.roc = 0;
+        pxChannel->data.roc_peak = 0;
+#if FREQ_ROC_PEAK_SAMPLES > 1
+        vWindowExtremaInit(&xRocPeak[i], FREQ_ROC_PEAK_SAMPLES);
+#endif
+        pxChannel->data.upper_limit = NOMINAL_FREQ_Q16 + FREQ_TOLERANCE_Q16;
+        pxChannel->data.lower_limit = NOMINAL_FREQ_Q16 - FREQ_TOLERANCE_Q16;
+        pxChannel->data.is_stable = 1;
+        memset(&pxChannel->data.stamp, 0, sizeof(LatencyStamp_t));
+    }
 }
 
-/* Load Actuator Task */
-static void vLoadActuatorTask(void *pvParameters) {
-    TickType_t xLastWakeTime;
-    FrequencyData_t local_freq_data;
-    LoadDecision_t local_load_decision;
-    uint16_t previous_outputs = 0x0000; // All loads off initially
-
-    /* Initialize the xLastWakeTime variable with the current time */
-    xLastWakeTime = xTaskGetTickCount();
+/* Decision memo key of a result: what the policy evaluation reads of it,
+ * reduced to the bands it compares against */
+static uint32_t ulDecisionKey(const FreqResult_t *pxResult) {
+#if FREQ_DECISION_MEMO && !FREQ_UF_CURVES
+    const LoadPolicy_t *pxPolicy = pxLoadPolicyGet();
+    const FrequencyData_t *pxChannel;
+    fix16_t deviation;
+    uint32_t key = 0, i;
+
+    if (pxLoadRegistryGet() != NULL) {
+        return DECISION_KEY_NONE;
+    }
+    for (i = 0; i < FREQ_CHANNELS; i++) {
+        pxChannel = &pxResult->channel[i];
+        deviation = pxChannel->lower_limit - pxChannel->current_freq;
+        key |= (ulLoadPolicyCell(pxPolicy, deviation, pxChannel->roc_peak) |
+                (xLoadPolicyCrossingDue(pxPolicy, deviation, pxChannel->roc_peak, LOAD_PREDICT_LEAD_Q16,
+                                        LOAD_PREDICT_ARM_Q16) ? DECISION_KEY_DUE : 0) |
+                (((pxResult->unstable >> i) & 1) ? 0 : DECISION_KEY_STABLE)) << (i * DECISION_KEY_BITS);
+    }
+    return key;
+#else
+    (void)pxResult;
+    return DECISION_KEY_NONE;
+#endif
+}
 
-    for (;;) {
-        /* Wait for the next cycle */
-        vTaskDelayUntil(&xLastWakeTime, pdMS_TO_TICKS(LOAD_ACTUATOR_PERIOD_MS));
-
-        /* Get latest frequency analysis result */
-        if (xQueuePeek(xFreqResultQueue, &local_freq_data, 0) == pdTRUE) {
-            /* Get current load decision state */
-            if (xSemaphoreTake(xShedRegsMutex, portMAX_DELAY) == pdTRUE) {
-                local_load_decision = gLoadDecision; // Simple struct copy
-                xSemaphoreGive(xShedRegsMutex);
+/* Frequency analyzer: one pass over every feeder */
+static void vAnalyzerStep(void) {
+    uint32_t tail, count, newest, i, key;
+    uint32_t updated;                  // Channels with a new result this pass
+    uint32_t unstable;
+    uint32_t drained;
+    FreqChannel_t *pxChannel;
+    FreqResult_t *pxResult;
+    const ThresholdConfig_t *pxConfig;
+    TickType_t xNow = xTaskGetTickCount();
+
+    vPeriodStart(&xAnalyzerPeriod);
+    vExcursionTick(xNow);
+    vWatchdogBeat(WATCHDOG_BEAT_ANALYZER);
+    WCET_BEGIN(WCET_ANALYZER);
+    PERF_SECTION_BEGIN(PERF_SECTION_ANALYZER);
+
+    /* Pick up any keyboard edit once per batch */
+    pxConfig = gThresholds;
+
+    /* Drain everything the ISRs have produced, one channel block at a
+     * time. tail is published after each sample and head re-read, so a
+     * sample pushed while draining is never left behind without a
+     * notification. */
+    updated = 0;
+    unstable = 0;
+    newest = 0;
+    drained = 0;
+    for (i = 0; i < FREQ_CHANNELS; i++) {
+        pxChannel = &gFreqChannel[i];
+        pxChannel->data.upper_limit = pxConfig->channel[i].upper_limit;
+        pxChannel->data.lower_limit = pxConfig->channel[i].lower_limit;
+
+        tail = pxChannel->ring.tail;
+        while (tail != pxChannel->ring.head) {
+            count = pxChannel->ring.count[tail & FREQ_RING_MASK];
+            pxChannel->data.stamp.capture = pxChannel->ring.stamp[tail & FREQ_RING_MASK];
+#if FREQ_RING_POLICY == FREQ_RING_DROP_OLDEST
+            /* The slot may have been overwritten while it was read; the
+             * ISR has counted every reading it overwrote, so skip to the
+             * oldest one still in the ring */
+            if ((pxChannel->ring.head - tail) > FREQ_RING_SIZE) {
+                tail = pxChannel->ring.head - FREQ_RING_SIZE;
+                pxChannel->ring.tail = tail;
+                continue;
             }
+#endif
+            pxChannel->ring.tail = ++tail;
+            drained++;
+            vDisturbanceSample(i, count, pxChannel->data.stamp.capture);
+
+            if (xAnalyzeSample(&pxChannel->estimator, count, &pxChannel->data, pxConfig->channel[i].max_roc, i)) {
+                updated |= 1u << i;
+                vExcursionSample(i, pxChannel->data.current_freq, pxChannel->data.lower_limit,
+                                 pxChannel->data.upper_limit, pxChannel->data.stamp.capture);
+            }
+            vHistorianAdd(i, pxChannel->data.current_freq, count, pxChannel->data.stamp.capture);
+            vStatsAdd(&gFreqStats[i], (int32_t)(((int64_t)pxChannel->data.current_freq * 1000) >> 16), xNow);
+        }
 
-            /* Make load shedding decision */
-            vMakeLoadDecision(&local_freq_data, &local_load_decision);
-
-            /* Update global load decision if changed */
-            if (local_load_decision.requested_status != gLoadDecision.requested_status) {
-                if (xSemaphoreTake(xShedRegsMutex, portMAX_DELAY) == pdTRUE) {
-                    gLoadDecision.requested_status = local_load_decision.requested_status;
-                    xSemaphoreGive(xShedRegsMutex);
-                }
+        unstable |= (uint32_t)!pxChannel->data.is_stable << i;
+        if (updated & (1u << i)) {
+            pxChannel->data.stamp.analysis = ulLatencyNow();
+            if (!(updated & (1u << newest)) ||
+                (int32_t)(pxChannel->data.stamp.capture - gFreqChannel[newest].data.stamp.capture) > 0) {
+                newest = i;
             }
         }
+    }
 
-        /* Check for manual override */
-        if (!gSystemStatus.override_active) {
-            /* Apply load control if not in override mode */
-            if (xSemaphoreTake(xActuatorStatusMutex, portMAX_DELAY) == pdTRUE) {
-                /* Copy the requested status to load status */
-                gLoadDecision.load_status = gLoadDecision.requested_status;
+    if (updated) {
+        /* Hand the result to the actuator. A result it has not taken yet
+         * is superseded and comes back here to be freed. */
+        pxResult = (FreqResult_t *)pvPoolAlloc(&xFreqResultPool);
+        key = DECISION_KEY_NONE;
+        if (pxResult != NULL) {
+            for (i = 0; i < FREQ_CHANNELS; i++) {
+                pxResult->channel[i] = gFreqChannel[i].data;
+            }
+            pxResult->newest = newest;
+            pxResult->unstable = unstable;
+            pxResult->band_key = key = ulDecisionKey(pxResult);
+            vPoolFree(&xFreqResultPool, pvPoolSwap(&pvFreqResultMailbox, pxResult));
+        }
 
-                /* Only update hardware if status has changed */
-                if (previous_outputs != gLoadDecision.load_status) {
-                    IOWR_ALTERA_AVALON_PIO_DATA(GREEN_LEDS_BASE, gLoadDecision.load_status);
-                    previous_outputs = gLoadDecision.load_status;
-                }
+        /* Publish the result for the monitor and display */
+        pxResult = (FreqResult_t *)pvBusWriteBegin(&xFreqTopic);
+        for (i = 0; i < FREQ_CHANNELS; i++) {
+            pxResult->channel[i] = gFreqChannel[i].data;
+        }
+        pxResult->newest = newest;
+        pxResult->band_key = key;
+        pxResult->unstable = unstable;
+        vBusWriteEnd(&xFreqTopic);
+        vSevenSegFrequency(xEditChannel, gFreqChannel[xEditChannel].data.current_freq);
+
+        /* Signal the actuator that a new result is waiting */
+        xTaskNotifyGive(xLoadActuatorTask);
+    }
+    PERF_SECTION_END(PERF_SECTION_ANALYZER);
+    WCET_END(WCET_ANALYZER, drained, updated);
+    vPeriodEnd(&xAnalyzerPeriod);
+}
 
-                /* Simulate actuator response (in real hardware this would be read from sensors) */
-                /* This would read from actual hardware to get actuator states */
-                /* For this simulation, we'll just create a random mismatch occasionally */
-                if (rand() % 100 < 2) { // 2% chance of random actuator failure
-                    int failed_actuator = rand() % 7;
-
-                    // Toggle the bit of the failed actuator to create a mismatch
-                    if (gLoadDecision.requested_status & (1 << failed_actuator)) {
-                        // If requested is 1, make actuator 0
-                        gActuator.actuator_status &= ~(1 << failed_actuator);
-                    } else {
-                        // If requested is 0, make actuator 1
-                        gActuator.actuator_status |= (1 << failed_actuator);
-                    }
-                } else {
-                    /* Normal case: actuators follow the requested status */
-                    gActuator.actuator_status = gLoadDecision.requested_status;
-                }
+#if !FREQ_TIME_TRIGGERED
+/* Frequency Analyzer Task: one pass over every feeder per wake-up */
+static void vFrequencyAnalyzerTask(void *pvParameters) {
+    vAnalyzerInit();
 
-                xSemaphoreGive(xActuatorStatusMutex);
-            }
-        }
+    for (;;) {
+        /* Sleep until an ISR crosses the watermark. The timeout picks up
+         * samples left below the watermark when the signal is sparse. */
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(FREQ_ANALYZER_PERIOD_MS));
+        vAnalyzerStep();
     }
 }
-/* Initialize VGA display */
-static void vInitializeVGA(void) {
-    /* Initialize pixel buffer */
-    pixel_buf = alt_up_pixel_buffer_dma_open_dev(VIDEO_PIXEL_BUFFER_DMA_NAME);
-    if (pixel_buf == NULL) {
-        printf("Cannot find pixel buffer device\n");
+#endif
+/* The loads the in-band policy keeps on that the decision holds off, and
+ * their registry kW, for the energy not served (excursion.h) and the
+ * health word */
+static void vShedPublish(LoadMask_t requested) {
+    const LoadRegistry_t *pxRegistry = pxLoadRegistryGet();
+    LoadMask_t shed = 0, loads;
+    uint32_t i, kw = 0;
+
+    for (i = 0; i < FREQ_CHANNELS; i++) {
+        shed |= xFreqChannelHw[i].loads;
     }
-    alt_up_pixel_buffer_dma_clear_screen(pixel_buf, 0);
+    shed &= pxLoadPolicyGet()->requested_status[0][0] & ~requested;
+    for (loads = shed; pxRegistry != NULL && loads != 0; loads &= loads - 1) {
+        i = ulLoadFirst(loads);
+        kw += i < REGISTRY_LOADS ? pxRegistry->load[i].rating_kw : 0;
+    }
+    ulShedLoads = ulLoadCount(shed);
+    vExcursionShed(ulShedLoads, kw);
+}
 
-    /* Initialize character buffer */
-    char_buf = alt_up_char_buffer_open_dev("/dev/video_character_buffer_with_dma");
-    if (char_buf == NULL) {
-        printf("Cannot find character buffer device\n");
+/* The decision's request as the actuation limiter lets it through, loads
+ * in forced at once. *pxReleased (may be NULL) gets the held changes that
+ * went through now. Actuator task only. */
+static LoadMask_t xDecisionLimit(LoadMask_t requested, LoadMask_t forced, LoadMask_t *pxReleased) {
+#if FREQ_ACTUATION_LIMIT
+    return xLoadLimiterApply(requested, forced, xTaskGetTickCount() * portTICK_PERIOD_MS, pxReleased);
+#else
+    if (pxReleased != NULL) {
+        *pxReleased = 0;
     }
-    alt_up_char_buffer_clear(char_buf);
+    return requested;
+#endif
+}
 
-    /* Draw frequency plot axes and labels */
-    alt_up_pixel_buffer_dma_draw_hline(pixel_buf, 100, 590, 200, 0xFFFF, 0);
-    alt_up_pixel_buffer_dma_draw_vline(pixel_buf, 100, 50, 200, 0xFFFF, 0);
+static void vWriteLoadDecision(FrequencyData_t *pxFreqData, LoadDecision_t *pxLoadDecision) {
+    static uint32_t last_shed_capture = 0;
+    LoadMask_t previous = pxLoadDecision->load_status;
+    LoadMask_t commanded, shed;
+    uint32_t elapsed_us, n, i;
+    SwingPoint_t decision, breakpoints[2];
+
+    /* Drive the decision now, the output stage applies any higher priority
+     * command instead. Runs in the actuator task, which owns the stage. A
+     * shed the limiter holds is not a shed yet. */
+    commanded = xDecisionLimit(pxLoadDecision->requested_status, 0, NULL);
+    shed = previous & ~commanded;
+    pxLoadDecision->load_status = xOutputCommand(OUTPUT_SOURCE_DECISION, commanded);
+    pxFreqData->stamp.actuation = ulLatencyNow();
+    vShedPublish(pxLoadDecision->requested_status);
+    decision.flags = (uint32_t)usLoadPortBits(pxLoadDecision->requested_status, 0) << 16 |
+                     usLoadPortBits(pxLoadDecision->load_status, 0);
+    decision.stamp = pxFreqData->stamp.actuation;
+    n = ulSwingStageAdd(&xDecisionSwing, &decision, breakpoints);
+    for (i = 0; i < n; i++) {
+        vTelemetryPostAt(TELEMETRY_DECISION, breakpoints[i].stamp, breakpoints[i].flags >> 16,
+                         breakpoints[i].flags & 0xFFFF, 0);
+    }
 
-    /* Draw RoC plot axes */
-    alt_up_pixel_buffer_dma_draw_hline(pixel_buf, 100, 590, 300, 0xFFFF, 0);
-    alt_up_pixel_buffer_dma_draw_vline(pixel_buf, 100, 220, 300, 0xFFFF, 0);
+    /* The flash log keeps what was actually driven, not every request */
+    if (previous & ~pxLoadDecision->load_status) {
+        vEventLogPost(EVENT_SHED, previous & ~pxLoadDecision->load_status, pxLoadDecision->load_status);
+        vDisturbanceTrigger(DISTURB_CAUSE_SHED, previous & ~pxLoadDecision->load_status);
+#if configUSE_KERNEL_TRACE
+        vKernelTraceEvent(KTRACE_MARK, previous & ~pxLoadDecision->load_status);
+#endif
+    }
+    if (pxLoadDecision->load_status & ~previous) {
+        vEventLogPost(EVENT_RECONNECT, pxLoadDecision->load_status & ~previous, pxLoadDecision->load_status);
+    }
 
-    /* Add labels */
-    alt_up_char_buffer_string(char_buf, "Frequency (Hz)", 4, 4);
-    alt_up_char_buffer_string(char_buf, "52", 10, 7);
-    alt_up_char_buffer_string(char_buf, "50", 10, 12);
-    alt_up_char_buffer_string(char_buf, "48", 10, 17);
-    alt_up_char_buffer_string(char_buf, "46", 10, 22);
+    /* Shed latency is measured once per sample, from the capture that caused it */
+    if (shed && pxFreqData->stamp.capture != last_shed_capture) {
+        last_shed_capture = pxFreqData->stamp.capture;
+        elapsed_us = ulLatencyElapsedUs(pxFreqData->stamp.capture, pxFreqData->stamp.actuation);
+        vLatencyRecord(&gShedLatency, &xLatencySeq, elapsed_us, SHED_DEADLINE_MS * 1000UL);
+        vStatsAdd(&gShedStats, (int32_t)elapsed_us, xTaskGetTickCount());
+        vWarmStateShedLatency(elapsed_us);
+#if FREQ_RELAY_SOAK
+        vSoakHistAdd(&xSoakShed, &xSoakSeq, elapsed_us);
+#endif
+        vTelemetryPost(TELEMETRY_LATENCY, TELEMETRY_LATENCY_SHED, elapsed_us, SHED_DEADLINE_MS * 1000UL);
+    }
 
-    alt_up_char_buffer_string(char_buf, "df/dt (Hz/s)", 4, 26);
-    alt_up_char_buffer_string(char_buf, "60", 10, 28);
-    alt_up_char_buffer_string(char_buf, "30", 10, 30);
-    alt_up_char_buffer_string(char_buf, "0", 10, 32);
-    alt_up_char_buffer_string(char_buf, "-30", 9, 34);
-    alt_up_char_buffer_string(char_buf, "-60", 9, 36);
+    /* Set alert flag to indicate a shedding operation occurred */
+    vStateSet(STATE_ALERT);
 }
 
-/* Draw frequency plots */
-static void vDrawFrequencyPlot(double *freq, double *dfreq, int oldest_idx) {
-    int i, j;
-    Line line_freq, line_roc;
-    char status_text[40];
-    uint8_t loads_status = 0;
-    //int k;
+/* Slide switches have been still for SWITCH_DEBOUNCE_MS - runs in the timer
+ * daemon and applies the manual override from the settled value */
+static void vSwitchDebounceCallback(TimerHandle_t xTimer) {
+    InputSnapshot_t xInputs;
+    uint32_t slider_value;
+
+    vInputSnapshotGet(&xInputs);
+    slider_value = xInputs.switches;
 
-    /* Clear old plots */
-    alt_up_pixel_buffer_dma_draw_box(pixel_buf, 101, 0, 639, 199, 0, 0);
-    alt_up_pixel_buffer_dma_draw_box(pixel_buf, 101, 201, 639, 299, 0, 0);
+    JOURNAL_INPUT(JOURNAL_SWITCHES, JOURNAL_SWITCHES_SETTLED, slider_value);
 
-    /* Draw new plots */
-    for (j = 0; j < 99; ++j) {
-        i = (oldest_idx + j) % 100;
-        int next_i = (oldest_idx + j + 1) % 100;
+    /* Hand the switch mask to the output stage, or give control back */
+    if (slider_value & OVERRIDE_SWITCH) {
+        vStateSet(STATE_OVERRIDE);
+        vOutputPost(OUTPUT_SOURCE_OVERRIDE, slider_value & OVERRIDE_LOAD_MASK);
+    } else {
+        vStateClear(STATE_OVERRIDE);
+        vOutputRelease(OUTPUT_SOURCE_OVERRIDE);
+    }
+}
 
-        if ((freq[i] > MIN_FREQ) && (freq[next_i] > MIN_FREQ)) {
-            /* Frequency plot */
-            line_freq.x1 = FREQPLT_ORI_X + FREQPLT_GRID_SIZE_X * j;
-            line_freq.y1 = (int)(FREQPLT_ORI_Y - FREQPLT_FREQ_RES * (freq[i] - MIN_FREQ));
+/* Actuators have had FEEDBACK_SETTLE_MS since the last write - runs in the
+ * timer daemon, the monitor reads and filters the feedback */
+static void vFeedbackTimerCallback(TimerHandle_t xTimer) {
+    vMonitorNotify(MONITOR_NOTIFY_FEEDBACK);
+}
 
-            line_freq.x2 = FREQPLT_ORI_X + FREQPLT_GRID_SIZE_X * (j + 1);
-            line_freq.y2 = (int)(FREQPLT_ORI_Y - FREQPLT_FREQ_RES * (freq[next_i] - MIN_FREQ));
+/* Reconnect timer expiry - runs in the timer daemon, so only flag it and
+ * let the actuator apply it on an immediate re-evaluation */
+static void vReconnectTimerCallback(TimerHandle_t xTimer) {
+    xReconnectDue = 1;
+    xTaskNotifyGive(xLoadActuatorTask);
+}
 
-            /* RoC plot */
-            line_roc.x1 = ROCPLT_ORI_X + ROCPLT_GRID_SIZE_X * j;
-            line_roc.y1 = (int)(ROCPLT_ORI_Y - ROCPLT_ROC_RES * dfreq[i]);
+#if FREQ_UF_DEADLINE
+/* A feeder's stage has come due between two evaluations - interrupt
+ * level, see vOutputShedFromISR() */
+static void vUfDeadlineCallback(void *context, BaseType_t *pxHigherPriorityTaskWoken) {
+    vOutputShedFromISR(xUfDeadlineLoads[(uint32_t)context], pxHigherPriorityTaskWoken);
+}
 
-            line_roc.x2 = ROCPLT_ORI_X + ROCPLT_GRID_SIZE_X * (j + 1);
-            line_roc.y2 = (int)(ROCPLT_ORI_Y - ROCPLT_ROC_RES * dfreq[next_i]);
+/* After a feeder's evaluation: arm its next stage trip, or cancel it if
+ * none is due within the horizon */
+static void vUfDeadlineArm(uint32_t channel, fix16_t deviation) {
+    LoadMask_t loads;
+    uint32_t us = ulUfCurveTripUs(&xUfCurves, &xUfState[channel], deviation, &loads);
 
-            /* Draw lines */
-            alt_up_pixel_buffer_dma_draw_line(pixel_buf, line_freq.x1, line_freq.y1,
-                                             line_freq.x2, line_freq.y2, 0x3ff << 0, 0);
-            alt_up_pixel_buffer_dma_draw_line(pixel_buf, line_roc.x1, line_roc.y1,
-                                             line_roc.x2, line_roc.y2, 0x3ff << 0, 0);
+    loads &= xFreqChannelHw[channel].loads & (LoadMask_t)~LOAD_CRITICAL_MASK;
+    if (loads == 0 || us > UF_DEADLINE_HORIZON_MS * 1000UL) {
+        vDeadlineCancel(&xUfDeadline[channel]);
+        return;
+    }
+    xUfDeadlineLoads[channel] = loads;
+    vDeadlineArm(&xUfDeadline[channel], ulLatencyNow() + us * ulLatencyCountsPerUs());
+}
+#endif
+
+/* A changed decision's trace record: the feeder that shed (or the newest),
+ * its deviation, RoC and policy cell, why, and the loads kept. The reason
+ * is kept for the audit of the loads it sheds. */
+static void vDecisionTrace(const LoadPolicy_t *pxPolicy, const FreqResult_t *pxResult, uint32_t channel,
+                           uint8_t reason, LoadMask_t kept) {
+    const FrequencyData_t *pxChannel = &pxResult->channel[channel];
+    fix16_t deviation = pxChannel->lower_limit - pxChannel->current_freq;
+    uint32_t cell = ulLoadPolicyCell(pxPolicy, deviation, pxChannel->roc_peak);
+
+    if (reason == AUDIT_REASON_BAND) {
+        if (xLoadPolicyCrossingDue(pxPolicy, deviation, pxChannel->roc_peak, LOAD_PREDICT_LEAD_Q16,
+                                   LOAD_PREDICT_ARM_Q16)) {
+            reason = AUDIT_REASON_PREDICT;
+        } else if (cell % POLICY_ROC_BANDS) {
+            reason = AUDIT_REASON_ROC;
         }
     }
+    if (reason != AUDIT_REASON_NONE) {
+        ucShedReason = reason;
+    }
+    vTelemetryPost(TELEMETRY_TRACE, (uint32_t)deviation, (uint32_t)pxChannel->roc_peak,
+                   (uint32_t)usLoadPortBits(kept, 0) << 16 | (uint32_t)reason << 8 | channel << 4 | cell);
+}
 
-    /* Convert load status array to bitfield for display */
-    loads_status = gLoadDecision.load_status;
-
+/* Load Decision Function. Each feeder asks for its own target over the loads
+ * it supplies and the loads kept are those every feeder keeps; the step and
+ * the reconnect hold-off are shared, so a reconnection waits until all of
+ * them are stable. */
+static void vMakeLoadDecision(FreqResult_t *pxResult, LoadDecision_t *pxLoadDecision) {
+    LoadMask_t original_requested_status = pxLoadDecision->requested_status;
+    const LoadPolicy_t *pxPolicy = pxLoadPolicyGet();
+    FrequencyData_t *pxFreqData = &pxResult->channel[pxResult->newest];  // Carries the latency stamps
+    FrequencyData_t *pxChannel;
+    fix16_t deviation;
+    LoadMask_t target, channel_target, held;
+#if FREQ_UF_CURVES
+    LoadMask_t curve_shed;
+#endif
+    int is_stable = pxResult->unstable == 0;
+    uint32_t i, now_ms, trace = pxResult->newest;
+    uint8_t path, reason = AUDIT_REASON_NONE;
+    int coord_stage = -1;
+    LoadStep_t step;
+
+    WCET_BEGIN(WCET_DECISION);
+    PERF_SECTION_BEGIN(PERF_SECTION_DECISION);
+    pxFreqData->stamp.decision = ulLatencyNow();
+    now_ms = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    JOURNAL_INPUT(JOURNAL_TICK, 0, now_ms);
+    held = xLoadLocksHeld(&xLoadLocks, original_requested_status, now_ms);
+#if FREQ_COORD
+    coord_stage = xCoordStage(now_ms);
+#endif
+
+    target = LOAD_MASK_ALL;
+    for (i = 0; i < FREQ_CHANNELS; i++) {
+        pxChannel = &pxResult->channel[i];
+        deviation = pxChannel->lower_limit - pxChannel->current_freq;
+
+        if (coord_stage >= 0) {
+            /* The stage the leader gave this relay, with the policy's RoC
+             * column for the row */
+            channel_target =
+                pxPolicy->requested_status[coord_stage][FIX16_ABS(pxChannel->roc_peak) > pxPolicy->roc_thresholds[0]];
+            path = AUDIT_REASON_COORD;
+        } else if (pxLoadRegistryGet() != NULL) {
+            /* Power to shed for the deficit, or for the one a due crossing
+             * will have reached, from the precomputed cheapest sets. Other
+             * feeders' loads count as held, so they are never picked. */
+            if (xLoadPolicyCrossingDue(pxPolicy, deviation, pxChannel->roc_peak, LOAD_PREDICT_LEAD_Q16,
+                                       LOAD_PREDICT_ARM_Q16)) {
+                deviation -= fix16_mul(pxChannel->roc_peak, LOAD_PREDICT_LEAD_Q16);
+            }
+            channel_target = xLoadRegistryTarget(deviation - pxPolicy->freq_thresholds[0], pxChannel->roc_peak,
+                                                 (held & original_requested_status) | (LoadMask_t)~xFreqChannelHw[i].loads);
+            path = AUDIT_REASON_REGISTRY;
+        } else {
+#if FREQ_UF_CURVES
+            /* Time-graded stages on the deviation, the RoC band as in band */
+            curve_shed = xUfCurveShed(&xUfCurves, &xUfState[i], deviation, now_ms);
+            channel_target =
+                pxPolicy->requested_status[0][FIX16_ABS(pxChannel->roc_peak) > pxPolicy->roc_thresholds[0]] &
+                ~curve_shed;
+            path = (original_requested_status & curve_shed) ? AUDIT_REASON_CURVE : AUDIT_REASON_BAND;
+#if FREQ_UF_DEADLINE
+            vUfDeadlineArm(i, deviation);
+#endif
+#else
+            /* Constant-time policy lookup on the under-frequency deviation and
+             * RoC bands, shedding early on a crossing due within the actuator
+             * period */
+            channel_target = xLoadPolicyPredict(pxPolicy, deviation, pxChannel->roc_peak,
+                                                 LOAD_PREDICT_LEAD_Q16, LOAD_PREDICT_ARM_Q16);
+            path = AUDIT_REASON_BAND;  // Or RoC or predicted, told apart by vDecisionTrace
+#endif
+        }
+        target &= channel_target | (LoadMask_t)~xFreqChannelHw[i].loads;
 
-    /* Update status text */
-    sprintf(status_text, "Frequency: %.2f Hz   ", gFrequencyData.current_freq);
-    alt_up_char_buffer_string(char_buf, status_text, 40, 4);
+        /* The feeder whose target drops a connected load of its own */
+        if (original_requested_status & ~channel_target & xFreqChannelHw[i].loads) {
+            reason = path;
+            trace = i;
+        }
+    }
 
-    sprintf(status_text, "RoC: %.2f Hz/s   ", gFrequencyData.roc);
-    alt_up_char_buffer_string(char_buf, status_text, 40, 6);
+    /* Loads inside their minimum on or off time keep their state */
+    target = (target & ~held) | (original_requested_status & held);
 
-    /* System status */
-    if (gSystemStatus.system_state == STATUS_NORMAL) {
-        alt_up_char_buffer_string(char_buf, "Status: NORMAL   ", 40, 8);
-    } else if (gSystemStatus.system_state == STATUS_ALERT) {
-        alt_up_char_buffer_string(char_buf, "Status: ALERT    ", 40, 8);
-    } else if (gSystemStatus.system_state == STATUS_FAILSAFE) {
-        alt_up_char_buffer_string(char_buf, "Status: FAILSAFE ", 40, 8);
+    /* Shed or reconnect one load, then apply the hold-off the step asks for.
+     * The timer callback only ever sets xReconnectDue, so it is only cleared
+     * here when the step used or cancelled it. */
+    vLoadDecisionStep(pxLoadDecision->requested_status, target, is_stable, xReconnectDue, &step);
+    if (step.clear_due) {
+        xReconnectDue = 0;
+    }
+    if (step.holdoff == LOAD_HOLDOFF_STOP && xTimerIsTimerActive(xReconnectTimer)) {
+        xTimerStop(xReconnectTimer, 0);
+    } else if (step.holdoff == LOAD_HOLDOFF_ARM && !xTimerIsTimerActive(xReconnectTimer)) {
+        xTimerChangePeriod(xReconnectTimer, pdMS_TO_TICKS(step.holdoff_ms), 0);
     }
 
-    /* Load status */
-    sprintf(status_text, "Loads: %02X   ", loads_status);
-    alt_up_char_buffer_string(char_buf, status_text, 40, 10);
+    pxLoadDecision->requested_status = step.connected;
 
-    /* Actuator fault status */
-    if (gActuator.system_fault == FAULT_DETECTED) {
-        alt_up_char_buffer_string(char_buf, "ACTUATOR FAULT DETECTED!", 40, 12);
-    } else {
-        alt_up_char_buffer_string(char_buf, "Actuators normal        ", 40, 12);
+    /* Override with failsafe settings if latched */
+    if (ulFailsafeLatched()) {
+        /* Only keep critical load (bit 0) */
+        pxLoadDecision->requested_status = 0x0001;
+        reason = AUDIT_REASON_FAILSAFE;
     }
-}
-/* Manual Override Task */
-static void vManualOverrideTask(void *pvParameters) {
-    TickType_t xLastWakeTime;
-    uint16_t slider_value, prev_slider_value = 0;
-
-    /* Initialize the xLastWakeTime variable with the current time */
-    xLastWakeTime = xTaskGetTickCount();
 
-    for (;;) {
-        /* Wait for the next cycle */
-        vTaskDelayUntil(&xLastWakeTime, pdMS_TO_TICKS(MANUAL_OVERRIDE_PERIOD_MS));
-
-        /* Read slider switch values */
-        slider_value = IORD_ALTERA_AVALON_PIO_DATA(SLIDE_SWITCH_BASE);
-
-        /* Check if value changed */
-        if (slider_value != prev_slider_value) {
-            prev_slider_value = slider_value;
-
-            /* Check if override is active (MSB of slider) */
-            if (slider_value & 0x8000) {
-                /* Override is active - update system status */
-                gSystemStatus.override_active = 1;
-
-                /* Directly control loads based on other slider switches */
-                if (xSemaphoreTake(xActuatorStatusMutex, portMAX_DELAY) == pdTRUE) {
-                    /* Map slider switches to loads (use lower 4 bits) */
-                    gLoadDecision.load_status = slider_value;
-                    IOWR_ALTERA_AVALON_PIO_DATA(GREEN_LEDS_BASE, gLoadDecision.load_status);
-                    xSemaphoreGive(xActuatorStatusMutex);
-                }
-            } else {
-                /* Override is inactive */
-                gSystemStatus.override_active = 0;
-            }
+    /* If the decision has changed, write it to hardware */
+    if (pxLoadDecision->requested_status != original_requested_status) {
+        JOURNAL_INPUT(JOURNAL_DECISION, 0, pxLoadDecision->requested_status);
+        vDecisionTrace(pxPolicy, pxResult, trace, reason, pxLoadDecision->requested_status);
+        vWriteLoadDecision(pxFreqData, pxLoadDecision);
+    }
+#if FREQ_JOURNAL
+    /* A replay can start here: nothing pending that the journal does not show */
+    if (xJournalCheckpointDue() && pxLoadDecision->requested_status == original_requested_status && is_stable &&
+        held == 0 && !xReconnectDue && !ulFailsafeLatched() && !xTimerIsTimerActive(xReconnectTimer)) {
+        vJournalCheckpoint(pxLoadDecision->requested_status);
+        for (i = 0; i < FREQ_CHANNELS; i++) {
+            vJournalThresholds(i, &gThresholds->channel[i]);
         }
     }
+#endif
+    PERF_SECTION_END(PERF_SECTION_DECISION);
+    WCET_END(WCET_DECISION, (uint32_t)pxFreqData->current_freq, (uint32_t)pxFreqData->roc);
 }
 
-/* VGA Display Task */
-static void vVGADisplayTask(void *pvParameters) {
-    TickType_t xLastWakeTime;
-    double freq_history[100], dfreq_history[100];
-    int i, oldest_idx = 0;
-
-    /* Initialize the xLastWakeTime variable with the current time */
-    xLastWakeTime = xTaskGetTickCount();
-
-    /* Initialize VGA display */
-    vInitializeVGA();
-
-    /* Initialize history arrays */
-    for (i = 0; i < 100; i++) {
-        freq_history[i] = NOMINAL_FREQ;
-        dfreq_history[i] = 0.0;
+/* Why loads the actuator finds newly off have gone: the source driving the
+ * pins, and for the decision the reason it gave or a deadline's stage trip */
+static uint8_t ucAuditReason(LoadMask_t latched) {
+    switch (xOutputDrivenBy()) {
+    case OUTPUT_SOURCE_FAILSAFE:
+        return AUDIT_REASON_FAILSAFE;
+    case OUTPUT_SOURCE_OVERRIDE:
+        return AUDIT_REASON_OVERRIDE;
+    default:
+        return latched ? AUDIT_REASON_CURVE : ucShedReason;
     }
+}
+
+/* The health word at the end of a control cycle. A drop anywhere, seen as
+ * a change in the totals, holds HEALTH_OVERFLOW for HEALTH_HOLD_MS. */
+static void vHealthUpdate(void) {
+    static uint32_t last_drops = 0;
+    static TickType_t xOverflowTick = 0;
+    static uint8_t overflow = 0;
+    TickType_t xNow = xTaskGetTickCount();
+    uint32_t word, drops, i;
+
+    drops = ulTelemetryDropped() + ulIrqDeferDropped() + ulEventLogDropped();
+    for (i = 0; i < FREQ_CHANNELS; i++) {
+        drops += gFreqChannel[i].ring.dropped;
+    }
+    if (drops != last_drops) {
+        last_drops = drops;
+        xOverflowTick = xNow;
+        overflow = 1;
+    } else if (overflow && xNow - xOverflowTick >= pdMS_TO_TICKS(HEALTH_HOLD_MS)) {
+        overflow = 0;
+    }
+
+    word = (uint32_t)(xStateGet() & STATE_FLAGS) |
+           (gLoad.actuator.faulty_loads != 0 ? HEALTH_FAULTY : 0) |
+           (gLoad.actuator.system_fault != FAULT_NONE ? HEALTH_FEEDBACK : 0) |
+           (ucHealthDeadline ? HEALTH_DEADLINE : 0) | (overflow ? HEALTH_OVERFLOW : 0) |
+           (ucHealthWatchdog ? HEALTH_WATCHDOG : 0) |
+           (ulShedLoads > HEALTH_SHED_MAX ? HEALTH_SHED_MAX : ulShedLoads) << HEALTH_SHED_SHIFT |
+           (ulFailsafeLatched() & HEALTH_SOURCE_MASK) << HEALTH_SOURCE_SHIFT;
+    vHealthPublish(word);
+}
+
+/* Load actuator: decide on the newest result and apply the outputs */
+static void vActuatorStep(void) {
+    static FreqResult_t *pxResult = NULL;  // Result owned by the actuator
+    static uint32_t last_capture = 0;
+    static uint32_t memo = DECISION_KEY_NONE;  // Key of the last evaluation that changed nothing
+    static LoadMask_t requested = 0;       // What it asked for
+    uint32_t writes, elapsed_us, key;
+    FreqResult_t *pxNewResult;
+    LatencyStamp_t *pxStamp;
+    LoadDecision_t local_load_decision;
+    LoadMask_t outputs, before, released, latched = 0;
+
+    vPeriodStart(&xActuatorPeriod);
+    vWatchdogBeat(WATCHDOG_BEAT_ACTUATOR);
+    WCET_BEGIN(WCET_ACTUATOR);
+    writes = ulOutputWrites();
+
+    /* Take the newest analysis result if there is one, otherwise keep
+     * deciding on the one already held */
+    pxNewResult = (FreqResult_t *)pvPoolSwap(&pvFreqResultMailbox, NULL);
+    if (pxNewResult != NULL) {
+        vPoolFree(&xFreqResultPool, pxResult);
+        pxResult = pxNewResult;
+    }
+    if (pxResult == NULL) {
+        vHealthUpdate();
+        return;
+    }
+    PERF_SECTION_BEGIN(PERF_SECTION_ACTUATOR);
+
+    /* Same bands, hold-off and latch as an evaluation that changed
+     * nothing, and nobody else (a reset, the failsafe) has rewritten the
+     * request since: it would change nothing again. Otherwise decide on
+     * the current load state. */
+    key = pxResult->band_key;
+    if (key != DECISION_KEY_NONE) {
+        key |= (xReconnectDue ? DECISION_KEY_RECONNECT : 0) | (ulFailsafeLatched() ? DECISION_KEY_FAILSAFE : 0);
+#if FREQ_COORD
+        key |= (uint32_t)(xCoordStage(xTaskGetTickCount() * portTICK_PERIOD_MS) + 1) << DECISION_KEY_COORD_SHIFT;
+#endif
+    }
+    pxStamp = &pxResult->channel[pxResult->newest].stamp;
+    if (key == memo && key != DECISION_KEY_NONE && gLoad.decision.requested_status == requested) {
+        pxStamp->decision = ulLatencyNow();
+    } else {
+        vSeqRead(&gLoad.lock, &local_load_decision, &gLoad.decision, sizeof(LoadDecision_t));
+#if FREQ_UF_DEADLINE
+        /* Stages the deadline timer tripped since the last evaluation are
+         * already shed, and come back only through the hold-off */
+        latched = xOutputShedLatched();
+        local_load_decision.requested_status &= ~latched;
+#endif
+        before = local_load_decision.requested_status;
+        vMakeLoadDecision(pxResult, &local_load_decision);
+        requested = local_load_decision.requested_status;
+        memo = requested == before ? key : DECISION_KEY_NONE;
+
+        /* Update global load decision if changed */
+        if (requested != gLoad.decision.requested_status) {
+            vSeqWriteBegin(&gLoad.lock);
+            gLoad.decision.requested_status = requested;
+            vSeqWriteEnd(&gLoad.lock);
+        }
+    }
+
+    /* Record how long a new sample took to reach a decision */
+    if (pxStamp->capture != last_capture) {
+        last_capture = pxStamp->capture;
+        elapsed_us = ulLatencyElapsedUs(pxStamp->capture, pxStamp->decision);
+        vLatencyRecord(&gDecisionLatency, &xLatencySeq, elapsed_us, SHED_DEADLINE_MS * 1000UL);
+#if FREQ_RELAY_SOAK
+        vSoakHistAdd(&xSoakDecision, &xSoakSeq, elapsed_us);
+#endif
+        vTelemetryPost(TELEMETRY_LATENCY, TELEMETRY_LATENCY_DECISION, elapsed_us, SHED_DEADLINE_MS * 1000UL);
+    }
+
+    /* Apply whichever output command wins, written only if it changed.
+     * Held changes the limiter lets through here are logged here, since
+     * vWriteLoadDecision only logs the ones it drives. */
+    outputs = xOutputCommand(OUTPUT_SOURCE_DECISION, xDecisionLimit(requested, latched, &released));
+    if (latched) {
+        vOutputShedClear(latched);
+    }
+    released &= outputs ^ gLoad.decision.load_status;
+    if (released & ~outputs) {
+        vEventLogPost(EVENT_SHED, released & ~outputs, outputs);
+    }
+    if (released & outputs) {
+        vEventLogPost(EVENT_RECONNECT, released & outputs, outputs);
+    }
+    if (xBoot.protect_us == 0) {
+        xBoot.protect_us = ulLatencyElapsedUs(xBoot.start, ulLatencyNow());
+    }
+
+    if (outputs != gLoad.decision.load_status) {
+        vSeqWriteBegin(&gLoad.lock);
+        gLoad.decision.load_status = outputs;
+        vSeqWriteEnd(&gLoad.lock);
+    }
+    vWarmStateLoads(requested, outputs);
+    vLoadAuditUpdate(outputs, ucAuditReason(latched), xTaskGetTickCount() * portTICK_PERIOD_MS);
+
+    /* Any write this pass, or by a deadline since the last, restarts the
+     * settle time before the read back */
+    if (ulOutputWrites() != writes || latched) {
+        xTimerReset(xFeedbackTimer, 0);
+    }
+    vHealthUpdate();
+    PERF_SECTION_END(PERF_SECTION_ACTUATOR);
+    WCET_END(WCET_ACTUATOR, requested, outputs);
+    vPeriodEnd(&xActuatorPeriod);
+}
+
+#if !FREQ_TIME_TRIGGERED
+/* Load Actuator Task */
+static void vLoadActuatorTask(void *pvParameters) {
+    for (;;) {
+        /* Wake on a new analyzer result or a reconnect timer expiry, and at
+         * least once per period so staged shedding keeps progressing */
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(LOAD_ACTUATOR_PERIOD_MS));
+        vActuatorStep();
+    }
+}
+#endif
+
+#if FREQ_TIME_TRIGGERED
+/* Steps for each minor frame of the major frame */
+static const uint8_t ucCyclicFrames[CYCLIC_MINOR_FRAMES] = {
+    CYCLIC_ANALYZE | CYCLIC_ACTUATE | CYCLIC_FEEDBACK | CYCLIC_MONITOR,
+    CYCLIC_ANALYZE | CYCLIC_ACTUATE | CYCLIC_FEEDBACK,
+    CYCLIC_ANALYZE | CYCLIC_ACTUATE | CYCLIC_FEEDBACK,
+    CYCLIC_ANALYZE | CYCLIC_ACTUATE | CYCLIC_FEEDBACK,
+    CYCLIC_ANALYZE | CYCLIC_ACTUATE | CYCLIC_FEEDBACK,
+    CYCLIC_ANALYZE | CYCLIC_ACTUATE | CYCLIC_FEEDBACK,
+    CYCLIC_ANALYZE | CYCLIC_ACTUATE | CYCLIC_FEEDBACK,
+    CYCLIC_ANALYZE | CYCLIC_ACTUATE | CYCLIC_FEEDBACK,
+    CYCLIC_ANALYZE | CYCLIC_ACTUATE | CYCLIC_FEEDBACK,
+    CYCLIC_ANALYZE | CYCLIC_ACTUATE | CYCLIC_FEEDBACK,
+};
+
+/* Cyclic Task: the control path as a time-triggered executive. A minor
+ * frame that overruns drops the releases it passed (see period_monitor.h),
+ * and the table position follows the time, not the number of frames run.
+ * The steps that were event driven still only run when they have work: the
+ * actuator on a notification or once a period, the feedback check after a
+ * settle time. */
+static void vCyclicTask(void *pvParameters) {
+    TickType_t xLastRelease, xLastActuate;
+    uint32_t minor = 0, ulEvents;
+    uint8_t steps;
+
+    vAnalyzerInit();
+    vMonitorInit();
+    vPeriodAlign(&xCyclicPeriod);
+    xLastRelease = xCyclicPeriod.xNextRelease - xCyclicPeriod.xPeriod;
+    xLastActuate = xTaskGetTickCount();
+
+    for (;;) {
+        vPeriodWait(&xCyclicPeriod);
+        minor = (minor + (xCyclicPeriod.xRelease - xLastRelease) / xCyclicPeriod.xPeriod) % CYCLIC_MINOR_FRAMES;
+        xLastRelease = xCyclicPeriod.xRelease;
+        steps = ucCyclicFrames[minor];
+
+        if (steps & CYCLIC_ANALYZE) {
+            vAnalyzerStep();
+        }
+
+        if ((steps & CYCLIC_ACTUATE) &&
+            (ulTaskNotifyTake(pdTRUE, 0) != 0 ||
+             xTaskGetTickCount() - xLastActuate >= pdMS_TO_TICKS(LOAD_ACTUATOR_PERIOD_MS))) {
+            xLastActuate = xTaskGetTickCount();
+            vActuatorStep();
+        }
+
+        ulEvents = 0;
+        if (steps & CYCLIC_FEEDBACK) {
+            taskENTER_CRITICAL();
+            ulEvents = ulMonitorEvents;
+            ulMonitorEvents = 0;
+            taskEXIT_CRITICAL();
+        }
+        vFailsafeReport();
+        if (ulEvents != 0 || (steps & CYCLIC_MONITOR)) {
+            vWatchdogBeat(WATCHDOG_BEAT_MONITOR);
+            vMonitorFeedback(ulEvents);
+        }
+        if (steps & CYCLIC_MONITOR) {
+            vPeriodStart(&xMonitorPeriod);
+            vMonitorPeriodic();
+        }
+    }
+}
+#endif
+
+#if !FREQ_HEADLESS
+/* One plot's vertical axis: labels a fixed number of text rows apart, the
+ * value between two of them the finest step from a table that fits what
+ * is shown. Label k sits on the middle frame row of its text row. */
+typedef struct {
+    const fix16_t *steps;              // Label steps, finest first
+    uint8_t step_count;
+    uint8_t labels;
+    uint8_t label_row;                 // Text row of the lowest label
+    uint8_t label_rows;                // Text rows between two labels
+    uint8_t symmetric;                 // Labels centred on 0
+    int16_t top;                       // Frame rows of the plot
+    int16_t bottom;
+} PlotScale_t;
+
+/* Where an axis is: its step, and the value of its lowest label */
+typedef struct {
+    uint8_t step;
+    fix16_t base;
+} PlotFit_t;
+
+static const fix16_t xFreqPlotSteps[] = {
+    FIX16_CONST(0.5), FIX16_CONST(1.0), FIX16_CONST(2.0), FIX16_CONST(5.0),
+};
+static const fix16_t xRocPlotSteps[] = {
+    FIX16_CONST(2.0), FIX16_CONST(5.0), FIX16_CONST(10.0), FIX16_CONST(30.0), FIX16_CONST(60.0), FIX16_CONST(150.0),
+};
+static const PlotScale_t xFreqPlotScale = {
+    xFreqPlotSteps, sizeof(xFreqPlotSteps) / sizeof(xFreqPlotSteps[0]), FREQPLT_LABELS,
+    FREQPLT_LABEL_ROW, FREQPLT_LABEL_ROWS, 0, FREQPLT_TOP_Y, FREQPLT_AXIS_Y,
+};
+static const PlotScale_t xRocPlotScale = {
+    xRocPlotSteps, sizeof(xRocPlotSteps) / sizeof(xRocPlotSteps[0]), ROCPLT_LABELS,
+    ROCPLT_LABEL_ROW, ROCPLT_LABEL_ROWS, 1, ROCPLT_TOP_Y, ROCPLT_AXIS_Y,
+};
+
+/* Display only. The axes start as the fixed ones were: 46 to 52 Hz in 2 Hz
+ * steps, -60 to 60 Hz/s in 30. */
+static PlotFit_t xFreqPlotFit = { 2, FIX16_CONST(46.0) };
+static PlotFit_t xRocPlotFit = { 3, FIX16_CONST(-60.0) };
+
+/* Pixel rows of the plots, kept by the history so each sample is placed
+ * once, as it is added: the axes shown, and a spare that the next rescale
+ * fills before handing it to the history */
+static HistoryPlot_t xPlotAxes[2];
+static uint8_t ucPlotAxes = 0;
+
+static inline int32_t lFloorDiv(int32_t a, int32_t b) {
+    return a / b - (a % b != 0 && a < 0);
+}
+
+/* Frame row of an axis' lowest label */
+static inline int32_t lPlotLabelY(const PlotScale_t *pxScale) {
+    return pxScale->label_row * PLOT_LABEL_PIXELS + PLOT_LABEL_PIXELS / 2 - 1;
+}
+
+static void vPlotAxis(const PlotScale_t *pxScale, const PlotFit_t *pxFit, HistoryAxis_t *pxAxis) {
+    pxAxis->origin = pxFit->base;
+    pxAxis->scale = (fix16_t)(((int64_t)(pxScale->label_rows * PLOT_LABEL_PIXELS) << (2 * FIX16_SHIFT)) /
+                              pxScale->steps[pxFit->step]);
+    pxAxis->y0 = (int16_t)lPlotLabelY(pxScale);
+    pxAxis->top = pxScale->top;
+    pxAxis->bottom = pxScale->bottom;
+}
+
+/* How far the plot reaches below and above its lowest label at step, with
+ * margin frame rows kept clear at either end */
+static void vPlotReach(const PlotScale_t *pxScale, uint8_t step, int32_t margin, fix16_t *pxBelow,
+                       fix16_t *pxAbove) {
+    int32_t y0 = lPlotLabelY(pxScale), spacing = pxScale->label_rows * PLOT_LABEL_PIXELS;
+
+    *pxBelow = (fix16_t)((int64_t)pxScale->steps[step] * (pxScale->bottom - margin - y0) / spacing);
+    *pxAbove = (fix16_t)((int64_t)pxScale->steps[step] * (y0 - pxScale->top - margin) / spacing);
+}
+
+/* Lowest label that puts lo..hi on the plot at step, margin frame rows in
+ * from either end. Returns 0 if it does not fit. */
+static int xPlotFits(const PlotScale_t *pxScale, uint8_t step, fix16_t lo, fix16_t hi, int32_t margin,
+                     fix16_t *pxBase) {
+    fix16_t value = pxScale->steps[step], below, above;
+    int32_t first, last;
+
+    vPlotReach(pxScale, step, margin, &below, &above);
+    if (pxScale->symmetric) {
+        *pxBase = -value * ((pxScale->labels - 1) / 2);
+        return lo >= *pxBase - below && hi <= *pxBase + above;
+    }
+    /* Any label step in hi - above .. lo + below will do, the middle one
+     * centres the range */
+    first = -lFloorDiv(above - hi, value);
+    last = lFloorDiv(lo + below, value);
+    if (first > last) {
+        return 0;
+    }
+    *pxBase = (first + (last - first) / 2) * value;
+    return 1;
+}
+
+/* Fit an axis to lo..hi, returns non-zero if it moved. It stays while what
+ * is shown is on it and no finer step fits with PLOT_FIT_MARGIN to spare,
+ * so a range at the edge of two steps does not rescale every frame. */
+static int xPlotRefit(const PlotScale_t *pxScale, PlotFit_t *pxFit, fix16_t lo, fix16_t hi) {
+    int32_t margin = (pxScale->bottom - pxScale->top) / PLOT_FIT_MARGIN;
+    fix16_t base, below, above;
+    uint8_t i;
+
+    for (i = 0; i < pxScale->step_count; i++) {
+        if (i == pxFit->step) {
+            vPlotReach(pxScale, i, 0, &below, &above);
+            if (lo >= pxFit->base - below && hi <= pxFit->base + above) {
+                return 0;
+            }
+        }
+        if (xPlotFits(pxScale, i, lo, hi, i < pxFit->step ? margin : 0, &base)) {
+            break;
+        }
+    }
+    if (i == pxScale->step_count) {
+        /* Off even the coarsest: from the bottom of the range, clamped */
+        i = pxScale->step_count - 1;
+        if (pxScale->symmetric) {
+            base = -pxScale->steps[i] * ((pxScale->labels - 1) / 2);
+        } else {
+            base = lFloorDiv(lo, pxScale->steps[i]) * pxScale->steps[i];
+        }
+        if (i == pxFit->step && base == pxFit->base) {
+            return 0;
+        }
+    }
+    pxFit->step = i;
+    pxFit->base = base;
+    return 1;
+}
+
+/* Y-axis labels of one plot */
+static void vPlotLabels(const PlotScale_t *pxScale, const PlotFit_t *pxFit) {
+    char value[16], text[PLOT_LABEL_WIDTH + 1];
+    fix16_t step = pxScale->steps[pxFit->step];
+    int decimals = (step & (FIX16_ONE - 1)) != 0;
+    int i, n;
+
+    for (i = 0; i < pxScale->labels; i++) {
+        n = (int)(pcTextFix16(value, pxFit->base + step * i, decimals) - value);
+        if (n > PLOT_LABEL_WIDTH) {
+            n = PLOT_LABEL_WIDTH;
+        }
+        memset(text, ' ', PLOT_LABEL_WIDTH - n);
+        memcpy(text + PLOT_LABEL_WIDTH - n, value, n);
+        text[PLOT_LABEL_WIDTH] = '\0';
+        vTextPut(PLOT_LABEL_X, pxScale->label_row - i * pxScale->label_rows, text, PLOT_LABEL_WIDTH);
+    }
+}
+
+/* The axes as they start, for the history before the first frame */
+static const HistoryPlot_t *pxPlotAxesInit(void) {
+    vPlotAxis(&xFreqPlotScale, &xFreqPlotFit, &xPlotAxes[0].freq);
+    vPlotAxis(&xRocPlotScale, &xRocPlotFit, &xPlotAxes[0].roc);
+    xPlotAxes[0].generation = 0;
+    ucPlotAxes = 0;
+    return &xPlotAxes[0];
+}
+
+/* Scale both plots to what is shown and the edited feeder's thresholds,
+ * and on a change hand the history the new axes and relabel them; the next
+ * frame then redraws the plots (vDrawFrequencyPlot). Display only. */
+static void vPlotRescale(fix16_t freq_lo, fix16_t freq_hi, fix16_t roc_lo, fix16_t roc_hi) {
+    const Thresholds_t *pxThresholds = &gThresholds->channel[xEditChannel];
+    HistoryPlot_t *pxPlot;
+    int moved;
+
+    /* Nothing below the valid minimum is drawn */
+    freq_lo = freq_lo < pxThresholds->lower_limit ? freq_lo : pxThresholds->lower_limit;
+    freq_lo = freq_lo < MIN_FREQ_Q16 ? MIN_FREQ_Q16 : freq_lo;
+    freq_hi = freq_hi > pxThresholds->upper_limit ? freq_hi : pxThresholds->upper_limit;
+    roc_lo = roc_lo < -pxThresholds->max_roc ? roc_lo : -pxThresholds->max_roc;
+    roc_hi = roc_hi > pxThresholds->max_roc ? roc_hi : pxThresholds->max_roc;
+
+    moved = xPlotRefit(&xFreqPlotScale, &xFreqPlotFit, freq_lo, freq_hi);
+    moved |= xPlotRefit(&xRocPlotScale, &xRocPlotFit, roc_lo, roc_hi);
+    if (!moved) {
+        return;
+    }
+    pxPlot = &xPlotAxes[ucPlotAxes ^ 1];
+    vPlotAxis(&xFreqPlotScale, &xFreqPlotFit, &pxPlot->freq);
+    vPlotAxis(&xRocPlotScale, &xRocPlotFit, &pxPlot->roc);
+    vHistorySetPlot(pxPlot);
+    ucPlotAxes ^= 1;
+    vPlotLabels(&xFreqPlotScale, &xFreqPlotFit);
+    vPlotLabels(&xRocPlotScale, &xRocPlotFit);
+}
+
+/* Static layer of the plots: axes and, given thresholds, their lines. Drawn
+ * into the background and shown over everything the traces can reach, so
+ * the traces have to be redrawn after it. Display only. */
+static void vPlotBackground(const Thresholds_t *pxThresholds) {
+    int y;
+
+    vRasterBackgroundBox(PLOT_AXIS_X0, FREQPLT_TOP_Y, PLOT_RIGHT_X, ROCPLT_AXIS_Y, 0);
+    if (pxThresholds != NULL) {
+        y = usHistoryAxisRow(&xPlotAxes[ucPlotAxes].freq, pxThresholds->upper_limit);
+        vRasterBackgroundLine(PLOT_AXIS_X0 + 1, y, PLOT_AXIS_X1, y, PLOT_THRESHOLD_COLOR);
+        y = usHistoryAxisRow(&xPlotAxes[ucPlotAxes].freq, pxThresholds->lower_limit);
+        vRasterBackgroundLine(PLOT_AXIS_X0 + 1, y, PLOT_AXIS_X1, y, PLOT_THRESHOLD_COLOR);
+        y = usHistoryAxisRow(&xPlotAxes[ucPlotAxes].roc, pxThresholds->max_roc);
+        vRasterBackgroundLine(PLOT_AXIS_X0 + 1, y, PLOT_AXIS_X1, y, PLOT_THRESHOLD_COLOR);
+        y = usHistoryAxisRow(&xPlotAxes[ucPlotAxes].roc, -pxThresholds->max_roc);
+        vRasterBackgroundLine(PLOT_AXIS_X0 + 1, y, PLOT_AXIS_X1, y, PLOT_THRESHOLD_COLOR);
+    }
+    vRasterBackgroundLine(PLOT_AXIS_X0, FREQPLT_AXIS_Y, PLOT_AXIS_X1, FREQPLT_AXIS_Y, PLOT_AXIS_COLOR);
+    vRasterBackgroundLine(PLOT_AXIS_X0, FREQPLT_TOP_Y, PLOT_AXIS_X0, FREQPLT_AXIS_Y, PLOT_AXIS_COLOR);
+    vRasterBackgroundLine(PLOT_AXIS_X0, ROCPLT_AXIS_Y, PLOT_AXIS_X1, ROCPLT_AXIS_Y, PLOT_AXIS_COLOR);
+    vRasterBackgroundLine(PLOT_AXIS_X0, ROCPLT_TOP_Y, PLOT_AXIS_X0, ROCPLT_AXIS_Y, PLOT_AXIS_COLOR);
+    vRasterBackgroundShow(PLOT_AXIS_X0, FREQPLT_TOP_Y, PLOT_RIGHT_X, ROCPLT_AXIS_Y);
+}
+
+/* Initialize VGA display */
+/* Non-zero if a whole frame at address is in the SRAM */
+static inline int xVGAFrameInSram(uint32_t address) {
+    return address >= SRAM_BASE && address - SRAM_BASE <= SRAM_SPAN - VGA_FRAME_BYTES;
+}
+
+/* Scan out of VGA_FRAME_BASE, front and back, if the DMA was set up to
+ * read a frame from anywhere else. Polls the swap: the co-routine display
+ * cannot block, and this runs once. */
+static void vVGAPlaceFrame(void) {
+    uint32_t front = pixel_buf->buffer_start_address;
+    uint32_t start;
+
+    if (xVGAFrameInSram(front) && pixel_buf->back_buffer_start_address == front) {
+        return;
+    }
+    alt_up_pixel_buffer_dma_change_back_buffer_address(pixel_buf, VGA_FRAME_BASE);
+    alt_up_pixel_buffer_dma_swap_buffers(pixel_buf);
+    start = ulLatencyNow();
+    while (alt_up_pixel_buffer_dma_check_swap_buffers_status(pixel_buf) &&
+           ulLatencyElapsedUs(start, ulLatencyNow()) < VGA_SWAP_TIMEOUT_MS * 1000UL) {
+    }
+    alt_up_pixel_buffer_dma_change_back_buffer_address(pixel_buf, VGA_FRAME_BASE);
+    vLogPost(LOG_VGA_FRAME_MOVED, front, VGA_FRAME_BASE);
+}
+
+static void vInitializeVGA(void) {
+    /* Initialize pixel buffer */
+    pixel_buf = alt_up_pixel_buffer_dma_open_dev(VIDEO_PIXEL_BUFFER_DMA_NAME);
+    if (pixel_buf == NULL) {
+        vLogPost(LOG_VGA_NO_PIXEL_BUFFER, 0, 0);
+    } else {
+        vVGAPlaceFrame();
+    }
+    alt_up_pixel_buffer_dma_clear_screen(pixel_buf, 0);
+    if (xRasterInit(pixel_buf) != 0) {
+        vLogPost(LOG_VGA_RASTER_FALLBACK, 0, 0);
+    }
+
+    /* Initialize character buffer */
+    char_buf = alt_up_char_buffer_open_dev("/dev/video_character_buffer_with_dma");
+    if (char_buf == NULL) {
+        vLogPost(LOG_VGA_NO_CHAR_BUFFER, 0, 0);
+    }
+    vTextInit(char_buf);
+
+    /* Plot axes; the threshold lines follow with the first frame */
+    vPlotBackground(NULL);
+
+    /* Large digits, drawn from the first frame on */
+    vGlyphInit(PLOT_READOUT_COLOR, RASTER_BLACK);
+    vGlyphReadoutInit(&xFreqReadout, VGA_READOUT_X, VGA_READOUT_Y, VGA_READOUT_CELLS);
+
+    /* Add labels, the axes' own follow them as they rescale */
+    vTextPut(4, 4, "Frequency (Hz)", 0);
+    vPlotLabels(&xFreqPlotScale, &xFreqPlotFit);
+    vTextPut(4, 26, "df/dt (Hz/s)", 0);
+    vPlotLabels(&xRocPlotScale, &xRocPlotFit);
+}
+
+/* Non-zero if a trace point differs from the one on screen */
+static inline int xPointMoved(const RasterPoint_t *a, const RasterPoint_t *b) {
+    return a->x != b->x || a->y != b->y;
+}
+
+/* End of a chunk of trace drawing begun at start: past VGA_CHUNK_US, let
+ * the engine catch up and sleep, so what is queued counts in the chunk
+ * that queued it. Returns the start of the next chunk. Display only. */
+static uint32_t ulPlotChunk(uint32_t start) {
+#if VGA_CHUNK_US
+    if (ulLatencyElapsedUs(start, ulLatencyNow()) < VGA_CHUNK_US) {
+        return start;
+    }
+    vRasterSync(VGA_RASTER_SYNC_TICKS);
+    vTaskDelay(VGA_CHUNK_GAP_TICKS);
+    return ulLatencyNow();
+#else
+    return start;
+#endif
+}
+
+/* Plot time span of a zoom level */
+static uint32_t ulPlotSpanSeconds(int level) {
+    return level < HISTORY_LEVELS ? ulHistorySpanSeconds(level) : PLOT_HISTORIAN_SPAN_S;
+}
+
+/* Columns of a zoom level, oldest first: the live history, or past its
+ * longest span the historian's day of the edited feeder, ending now. The
+ * axes are scaled to them first, from the history's running extremes, or
+ * a pass over the historian's columns. */
+static void vPlotSnapshot(int level, HistoryColumn_t *pxColumns) {
+    HistoryRange_t range;
+    uint64_t now_us, span_us;
+    int i, found = 0;
+
+    if (level < HISTORY_LEVELS) {
+        if (xHistoryRange(level, &range)) {
+            vPlotRescale(range.freq_min, range.freq_max, range.roc_min, range.roc_max);
+        }
+        vHistorySnapshot(level, pxColumns);
+        return;
+    }
+    now_us = ullTimeToUs(ullTimeNow());
+    span_us = (uint64_t)PLOT_HISTORIAN_SPAN_S * 1000000;
+    vHistorianColumns(xEditChannel, now_us > span_us ? now_us - span_us : 0, now_us, pxColumns, PLOT_HISTORY);
+    for (i = 0; i < PLOT_HISTORY; i++) {
+        if (pxColumns[i].count == 0) {
+            continue;
+        }
+        if (!found || pxColumns[i].freq_min < range.freq_min) {
+            range.freq_min = pxColumns[i].freq_min;
+        }
+        if (!found || pxColumns[i].freq_max > range.freq_max) {
+            range.freq_max = pxColumns[i].freq_max;
+        }
+        if (!found || pxColumns[i].roc_min < range.roc_min) {
+            range.roc_min = pxColumns[i].roc_min;
+        }
+        if (!found || pxColumns[i].roc_max > range.roc_max) {
+            range.roc_max = pxColumns[i].roc_max;
+        }
+        found = 1;
+    }
+    if (found) {
+        vPlotRescale(range.freq_min, range.freq_max, range.roc_min, range.roc_max);
+    }
+    vHistoryPlotRows(pxColumns, PLOT_HISTORY);
+}
+
+/* Draw frequency plots from one history level, oldest column first.
+ * The frequency plot shows the min and max of each column so short dips
+ * survive the decimation, the RoC plot the larger magnitude extreme.
+ * Only columns whose points moved are touched: the old segments of every
+ * trace there are erased by drawing them in black, then all traces in and
+ * next to those columns redrawn, since traces overlap and share end pixels.
+ * Runs of adjacent segments go to the rasterizer as one polyline. A flat
+ * trace scrolls onto itself, so a steady frequency costs almost no writes.
+ * With VGA_PLOT_SCROLL a moving trace is blitted a column left when that
+ * leaves fewer segments to draw, then only the newest ones differ.
+ * Erasing puts back the static layer (axes, threshold lines) from the
+ * background, which is drawn again only when the thresholds shown or the
+ * axes change.
+ * Both passes are cut into chunks with pauses between (VGA_CHUNK_US); the
+ * cursor stays hidden across them. */
+static void vDrawFrequencyPlot(const HistoryColumn_t *pxColumns) {
+    /* Static: what is on screen must persist, and the working copies are
+     * too large for the task stack (only the VGA task calls this, or the
+     * benchmark while that task is stopped) */
+    static RasterPoint_t drawn_pts[PLOT_TRACES][PLOT_HISTORY];
+    static RasterPoint_t pts[PLOT_TRACES][PLOT_HISTORY];
+    static uint8_t drawn[PLOT_SEGMENTS], visible[PLOT_SEGMENTS], changed[PLOT_SEGMENTS];
+    static uint8_t redraw[PLOT_SEGMENTS];
+    static Thresholds_t shown;
+    static uint32_t shown_generation;  // Of the axes drawn
+    static int shown_valid = 0;
+    static uint32_t status_seen = 0;   // Version of the status text drawn
+    HistoryColumn_t picked;
+    int i, j, k, t, moved = 0;
+    int strip = 0;                     // Segment before the newest partly under a restored strip
+#if VGA_PLOT_SCROLL
+    int stay, shift;
+#endif
+    char status_text[TEXT_COLS + 1];
+    char *p;
+    StatusValues_t values;
+    StatusText_t status;
+    FreqResult_t freq;
+    FrequencyData_t freq_data;
+    LoadDecision_t load_decision;
+    Actuator_t actuator;
+    uint8_t state;
+    Thresholds_t thresholds;
+    LatencyStats_t shed_latency, decision_latency;
+    uint32_t seq, chunk;
+
+    /* New threshold lines or axes cover the traces, which are all drawn
+     * again */
+    thresholds = gThresholds->channel[xEditChannel];
+    if (!shown_valid || thresholds.upper_limit != shown.upper_limit ||
+        thresholds.lower_limit != shown.lower_limit || thresholds.max_roc != shown.max_roc ||
+        xPlotAxes[ucPlotAxes].generation != shown_generation) {
+        vCursorHide();
+        vPlotBackground(&thresholds);
+        memset(drawn, 0, sizeof(drawn));
+        shown = thresholds;
+        shown_generation = xPlotAxes[ucPlotAxes].generation;
+        shown_valid = 1;
+        moved = 1;
+    }
+
+    /* The new traces, rows placed by the history */
+    for (j = 0; j < PLOT_HISTORY; ++j) {
+        pts[0][j].x = FREQPLT_ORI_X + FREQPLT_GRID_SIZE_X * j;
+        pts[0][j].y = pxColumns[j].y_freq_min;
+        pts[1][j].x = pts[0][j].x;
+        pts[1][j].y = pxColumns[j].y_freq_max;
+        pts[2][j].x = ROCPLT_ORI_X + ROCPLT_GRID_SIZE_X * j;
+        pts[2][j].y = pxColumns[j].y_roc;
+    }
+#if VGA_PLOT_SCROLL
+    /* Points that differ from the screen as it is, and as it would be one
+     * column on. The newest column is still filling, so it is left out. */
+    stay = 0;
+    shift = 0;
+    for (t = 0; t < PLOT_TRACES; t++) {
+        for (j = 0; j < PLOT_HISTORY - 2; j++) {
+            stay += pts[t][j].y != drawn_pts[t][j].y;
+            shift += pts[t][j].y != drawn_pts[t][j + 1].y;
+        }
+    }
+    if (shift < stay) {
+        /* Everything right of the vertical axis moves, wherever the
+         * traces went; the axis ends that moved off are put back */
+        vCursorHide();
+        moved = 1;
+        vRasterScroll(FREQPLT_ORI_X, 0, PLOT_RIGHT_X, VGA_PIXELS_Y - 1, -FREQPLT_GRID_SIZE_X, 0, 0);
+        vRasterBackgroundShow(PLOT_AXIS_X1 - FREQPLT_GRID_SIZE_X + 1, FREQPLT_TOP_Y, PLOT_RIGHT_X, ROCPLT_AXIS_Y);
+
+        for (t = 0; t < PLOT_TRACES; t++) {
+            for (j = 0; j < PLOT_HISTORY - 1; j++) {
+                drawn_pts[t][j].y = drawn_pts[t][j + 1].y;
+            }
+        }
+        memmove(drawn, drawn + 1, PLOT_SEGMENTS - 1);
+        drawn[PLOT_SEGMENTS - 1] = 0;
+        strip = 1;
+    }
+#endif
+    for (j = 0; j < PLOT_SEGMENTS; ++j) {
+        visible[j] = pxColumns[j].count && pxColumns[j + 1].count &&
+                     (pxColumns[j].freq_min > MIN_FREQ_Q16) && (pxColumns[j + 1].freq_min > MIN_FREQ_Q16);
+        changed[j] = visible[j] != drawn[j] || (strip && j == PLOT_SEGMENTS - 2);
+        for (t = 0; t < PLOT_TRACES && visible[j] && !changed[j]; t++) {
+            changed[j] = xPointMoved(&pts[t][j], &drawn_pts[t][j]) ||
+                         xPointMoved(&pts[t][j + 1], &drawn_pts[t][j + 1]);
+        }
+        moved |= changed[j];
+    }
+
+    /* The traces must not be drawn into the cursor, its second XOR would
+     * then leave their pixels inverted */
+    if (moved) {
+        vCursorHide();
+    }
+
+    /* Erase the segments that moved, one polyline per run and trace, a run
+     * being at most a chunk */
+    chunk = ulLatencyNow();
+    for (j = 0; j < PLOT_SEGMENTS; j = k) {
+        for (k = j; k < PLOT_SEGMENTS && k - j < VGA_CHUNK_SEGMENTS && changed[k] && drawn[k]; k++) {
+            drawn[k] = 0;
+        }
+        if (k > j) {
+            for (t = 0; t < PLOT_TRACES; t++) {
+                vRasterRestorePolyline(&drawn_pts[t][j], k - j + 1);
+            }
+            chunk = ulPlotChunk(chunk);
+        } else {
+            k++;
+        }
+    }
+
+    /* Draw the moved segments, and their neighbours whose shared end
+     * pixel may have been erased */
+    for (j = 0; j < PLOT_SEGMENTS; ++j) {
+        redraw[j] = visible[j] && (changed[j] || (j > 0 && changed[j - 1]) ||
+                                   (j < PLOT_SEGMENTS - 1 && changed[j + 1]));
+    }
+    for (j = 0; j < PLOT_SEGMENTS; j = k) {
+        for (k = j; k < PLOT_SEGMENTS && k - j < VGA_CHUNK_SEGMENTS && redraw[k]; k++) {
+            drawn[k] = 1;
+        }
+        if (k > j) {
+            for (t = 0; t < PLOT_TRACES; t++) {
+                vRasterPolyline(&pts[t][j], k - j + 1, PLOT_TRACE_COLOR);
+                memcpy(&drawn_pts[t][j], &pts[t][j], (k - j + 1) * sizeof(RasterPoint_t));
+            }
+            chunk = ulPlotChunk(chunk);
+        } else {
+            k++;
+        }
+    }
+    if (moved) {
+        vRasterSync(VGA_RASTER_SYNC_TICKS);
+    }
+    vCursorShow();
+
+    /* Time span of the plots */
+    p = pcTextStr(status_text, "Span: ");
+    i = ulPlotSpanSeconds(xVGAZoomLevel);
+    if (i >= 3600) {
+        p = pcTextUint(p, i / 3600);
+        p = pcTextStr(p, " h");
+    } else if (i >= 60) {
+        p = pcTextUint(p, i / 60);
+        p = pcTextStr(p, " min");
+    } else {
+        p = pcTextUint(p, i);
+        p = pcTextStr(p, " s");
+    }
+    p = pcTextStr(p, ", frame ");
+    p = pcTextUint(p, VGA_DISPLAY_PERIOD_MS * xVGAFrameDivide);
+    pcTextStr(p, " ms");
+    vTextPut(VGA_STATUS_X, 20, status_text, VGA_STATUS_WIDTH);
+
+    /* Column clicked with the mouse, read from this frame's snapshot and
+     * kept until the next click */
+    j = xVGAPick;
+    if (j != 0) {
+        xVGAPick = 0;
+        picked = pxColumns[--j];
+        p = pcTextStr(status_text, "Pick -");
+        p = pcTextUint(p, ulPlotSpanSeconds(xVGAZoomLevel) * (PLOT_HISTORY - 1 - j) / PLOT_HISTORY);
+        p = pcTextStr(p, " s: ");
+        if (picked.count == 0) {
+            pcTextStr(p, "no samples");
+        } else {
+            p = pcTextFix16(p, picked.freq_min, 2);
+            p = pcTextStr(p, "-");
+            p = pcTextFix16(p, picked.freq_max, 2);
+            p = pcTextStr(p, " Hz ");
+            p = pcTextFix16(p, picked.roc_min, 1);
+            p = pcTextStr(p, "/");
+            p = pcTextFix16(p, picked.roc_max, 1);
+            pcTextStr(p, " Hz/s");
+        }
+        vTextPut(VGA_STATUS_X, VGA_PICK_ROW, status_text, VGA_STATUS_WIDTH);
+    }
+
+    /* Editable thresholds, the selected one is bracketed */
+    p = pcTextStr(status_text, xEditField == EDIT_FIELD_UPPER ? "[U " : " U ");
+    p = pcTextFix16(p, thresholds.upper_limit, 1);
+    p = pcTextStr(p, xEditField == EDIT_FIELD_UPPER ? "] " : "  ");
+    p = pcTextStr(p, xEditField == EDIT_FIELD_LOWER ? "[L " : " L ");
+    p = pcTextFix16(p, thresholds.lower_limit, 1);
+    p = pcTextStr(p, xEditField == EDIT_FIELD_LOWER ? "] " : "  ");
+    p = pcTextStr(p, xEditField == EDIT_FIELD_ROC ? "[R " : " R ");
+    p = pcTextFix16(p, thresholds.max_roc, 0);
+    pcTextStr(p, xEditField == EDIT_FIELD_ROC ? "]" : "");
+    vTextPut(VGA_STATUS_X, 22, status_text, VGA_STATUS_WIDTH);
+
+    /* Consistent snapshots of the shared state, never blocks the control tasks */
+    ulBusLatest(&xFreqTopic, &freq);
+    freq_data = freq.channel[xEditChannel];
+    state = ucStateLevel(xStateGet());
+    do {
+        seq = ulSeqReadBegin(&gLoad.lock);
+        load_decision = gLoad.decision;
+        actuator = gLoad.actuator;
+    } while (xSeqReadRetry(&gLoad.lock, seq));
+
+    /* Status lines and large digits, formatted once for every display and
+     * drawn only when they changed */
+    vStatusValues(&values, &freq_data, state, load_decision.load_status);
+    (void)ulStatusTextUpdate(&values);
+    if (xStatusTextGet(&status, &status_seen)) {
+#if FREQ_CHANNELS > 1
+        p = pcTextStr(status_text, "Feeder ");
+        p = pcTextUint(p, xEditChannel);
+        p = pcTextStr(p, ": ");
+#else
+        p = pcTextStr(status_text, "Frequency: ");
+#endif
+        p = pcTextStr(p, status.freq);
+        pcTextStr(p, " Hz");
+        vTextPut(VGA_STATUS_X, 4, status_text, VGA_STATUS_WIDTH);
+
+        if (xGlyphReadoutDiffers(&xFreqReadout, status.freq)) {
+            vCursorHide();
+            xGlyphReadoutPut(&xFreqReadout, status.freq);
+            vCursorShow();
+        }
+
+        p = pcTextStr(status_text, "RoC: ");
+        p = pcTextStr(p, status.roc);
+        pcTextStr(p, " Hz/s");
+        vTextPut(VGA_STATUS_X, 6, status_text, VGA_STATUS_WIDTH);
+
+        p = pcTextStr(status_text, "Status: ");
+        pcTextStr(p, status.pcState);
+        vTextPut(VGA_STATUS_X, 8, status_text, VGA_STATUS_WIDTH);
+
+        p = pcTextStr(status_text, "Loads: ");
+        pcTextStr(p, status.loads);
+        vTextPut(VGA_STATUS_X, 10, status_text, VGA_STATUS_WIDTH);
+    }
+
+    /* Actuator fault status */
+    if (actuator.system_fault == FAULT_DETECTED) {
+        p = pcTextStr(status_text, "ACTUATOR FAULT: ");
+        pcTextHex(p, actuator.faulty_loads, 4);
+        vTextPut(VGA_STATUS_X, 12, status_text, VGA_STATUS_WIDTH);
+    } else {
+        vTextPut(VGA_STATUS_X, 12, "Actuators normal", VGA_STATUS_WIDTH);
+    }
+
+    /* ISR-to-actuation latency of load shedding, oldest to newest (us) */
+    vLatencyGetStats(&gShedLatency, &xLatencySeq, &shed_latency);
+    vLatencyGetStats(&gDecisionLatency, &xLatencySeq, &decision_latency);
+
+    p = pcTextStr(status_text, "Shed us: ");
+    p = pcTextUint(p, shed_latency.min_us);
+    p = pcTextStr(p, "/");
+    p = pcTextUint(p, ulLatencyMeanUs(&shed_latency));
+    p = pcTextStr(p, "/");
+    p = pcTextUint(p, shed_latency.max_us);
+    p = pcTextStr(p, " (");
+    p = pcTextUint(p, shed_latency.deadline_misses);
+    pcTextStr(p, " late)");
+    vTextPut(VGA_STATUS_X, 14, status_text, VGA_STATUS_WIDTH);
+
+    /* Right aligned in 6 character fields */
+    for (i = 0; i < LATENCY_RECENT; i++) {
+        pcTextUint(status_text, shed_latency.recent_us[(shed_latency.recent_next + i) % LATENCY_RECENT]);
+        j = strlen(status_text);
+        vTextPut(VGA_STATUS_X + i * 6, 16, "", 6 - j);
+        vTextPut(VGA_STATUS_X + i * 6 + (6 - j), 16, status_text, 0);
+    }
+
+    p = pcTextStr(status_text, "Decision us: ");
+    p = pcTextUint(p, ulLatencyMeanUs(&decision_latency));
+    p = pcTextStr(p, " (max ");
+    p = pcTextUint(p, decision_latency.max_us);
+    pcTextStr(p, ")");
+    vTextPut(VGA_STATUS_X, 18, status_text, VGA_STATUS_WIDTH);
+}
+#endif /* !FREQ_HEADLESS */
+
+/* What the status displays show of the feeder on display (status_text.h) */
+static void vStatusValues(StatusValues_t *pxValues, const FrequencyData_t *pxData, uint8_t state,
+                          LoadMask_t loads) {
+    pxValues->channel = xEditChannel;
+    pxValues->freq = pxData->current_freq;
+    pxValues->roc = pxData->roc;
+    pxValues->loads = (uint32_t)loads;
+    pxValues->state = state;
+}
+
+#if !FREQ_HEADLESS
+/* Take the cursor off the frame before drawing under it. Display only. */
+static void vCursorHide(void) {
+    if (xCursorDrawn) {
+        vRasterXorCross(xCursorX, xCursorY, VGA_CURSOR_ARM, VGA_CURSOR_XOR);
+        xCursorDrawn = 0;
+    }
+}
+
+/* Put the cursor back once drawing is done. Display only. */
+static void vCursorShow(void) {
+    if (!xCursorEnabled) {
+        xCursorEnabled = xPs2IsMouse();
+    }
+    if (xCursorEnabled && !xCursorDrawn) {
+        vRasterXorCross(xCursorX, xCursorY, VGA_CURSOR_ARM, VGA_CURSOR_XOR);
+        xCursorDrawn = 1;
+    }
+}
+
+#if !FREQ_UI_COROUTINES
+#if VGA_GOVERN
+/* Frame governor, once a frame: the idle task's share of the CPU since the
+ * last frame sets the periods to the next. Display task only. */
+static void vVGAGovern(void) {
+    static uint32_t idle_last, time_last;
+    static int started = 0;
+    uint32_t idle = ulTaskGetIdleRunTimeCounter();
+    uint32_t now = ulRunStatsCounter();
+    uint32_t idle_permille;
+
+    if (started && now != time_last) {
+        idle_permille = (uint32_t)((uint64_t)(idle - idle_last) * 1000 / (now - time_last));
+        if (idle_permille < VGA_GOVERN_IDLE_LOW && xVGAFrameDivide < VGA_GOVERN_MAX_DIVIDE) {
+            xVGAFrameDivide++;
+        } else if (idle_permille > VGA_GOVERN_IDLE_HIGH && xVGAFrameDivide > 1) {
+            xVGAFrameDivide--;
+        }
+    }
+    started = 1;
+    idle_last = idle;
+    time_last = now;
+}
+#endif
+
+/* VGA Display Task */
+static void vVGADisplayTask(void *pvParameters) {
+    /* Static, too large for the task stack */
+    static HistoryColumn_t columns[PLOT_HISTORY];
+#if VGA_GOVERN
+    uint8_t periods = 0;
+#endif
+
+    /* First frame one period from now */
+    vPeriodAlign(&xVGAPeriod);
+
+    /* Initialize VGA display */
+    vInitializeVGA();
+
+    for (;;) {
+        /* Wait for the next cycle */
+        vPeriodWait(&xVGAPeriod);
+#if VGA_GOVERN
+        /* Periods the governor has dropped are empty jobs */
+        if (++periods < xVGAFrameDivide) {
+            continue;
+        }
+        periods = 0;
+        vVGAGovern();
+#endif
+
+        /* Decimated history at the selected time span, fed by the analyzer */
+        vPlotSnapshot(xVGAZoomLevel, columns);
+
+        /* Sleep until the next refresh starts, then draw from the top while
+         * the scan-out is behind us. The tick hook notifies on completion. */
+        alt_up_pixel_buffer_dma_swap_buffers(pixel_buf);
+        xVGASwapPending = 1;
+        if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(VGA_SWAP_TIMEOUT_MS)) == 0) {
+            xVGASwapPending = 0;
+        }
+
+        /* Draw the frequency and RoC plots */
+        PERF_SECTION_BEGIN(PERF_SECTION_RENDER);
+        vDrawFrequencyPlot(columns);
+        vDrawPage();
+        PERF_SECTION_END(PERF_SECTION_RENDER);
+    }
+}
+
+#else
+/* Display co-routine: the task above, with the swap completion polled once
+ * a tick, since the idle task cannot block (tickless sleep is vetoed while
+ * the swap is outstanding) */
+static void vDisplayCoRoutine(CoRoutineHandle_t xHandle, UBaseType_t uxIndex) {
+    /* Co-routine locals do not survive a crDELAY() */
+    static HistoryColumn_t columns[PLOT_HISTORY];
+    static TickType_t xWait, xSwapStart;
+
+    crSTART(xHandle);
+    vPeriodAlign(&xVGAPeriod);
+    vInitializeVGA();
+
+    for (;;) {
+        xWait = xPeriodTicksToRelease(&xVGAPeriod);
+        crDELAY(xHandle, xWait);
+        if (!xPeriodReleaseDue(&xVGAPeriod)) {
+            continue;
+        }
+
+        vPlotSnapshot(xVGAZoomLevel, columns);
+
+        alt_up_pixel_buffer_dma_swap_buffers(pixel_buf);
+        xVGASwapPending = 1;
+        xSwapStart = xTaskGetTickCount();
+        while (xVGASwapPending && xTaskGetTickCount() - xSwapStart < pdMS_TO_TICKS(VGA_SWAP_TIMEOUT_MS)) {
+            crDELAY(xHandle, 1);
+        }
+        xVGASwapPending = 0;
+
+        PERF_SECTION_BEGIN(PERF_SECTION_RENDER);
+        vDrawFrequencyPlot(columns);
+        vDrawPage();
+        PERF_SECTION_END(PERF_SECTION_RENDER);
+        vPeriodEnd(&xVGAPeriod);
+    }
+    crEND();
+}
+#endif
+
+/* Memory census page: the heap on the first row, then two entries a row
+ * as peak/capacity in the entry's unit */
+static void vCensusPageInit(void) {
+    vTextPut(VGA_PAGE_X, VGA_PAGE_Y + 1, "  Name        Peak/Cap    Use%  Mem     Name        Peak/Cap    Use%  Mem",
+             TEXT_COLS - VGA_PAGE_X);
+}
+
+static void vDrawCensus(void) {
+    static Census_t census;
+    static const char cKind[] = { 'S', 'P', 'Q', 'R' };
+    static const char *const pcRegion[] = { "SDRAM", "chip", "-" };
+    char text[TEXT_COLS + 1];
+    char *p;
+    const CensusEntry_t *pxEntry;
+    uint32_t i, x, y;
+
+    vCensusGet(&census);
+    p = pcTextStr(text, "Heap ");
+    p = pcTextUint(p, census.heap_free);
+    p = pcTextStr(p, " of ");
+    p = pcTextUint(p, census.heap_total);
+    p = pcTextStr(p, " free, lowest ");
+    p = pcTextUint(p, census.heap_min_free);
+    p = pcTextStr(p, ", largest ");
+    p = pcTextUint(p, census.heap_largest);
+    p = pcTextStr(p, ", ");
+    p = pcTextUint(p, census.heap_fragments);
+    p = pcTextStr(p, " fragments, ");
+    p = pcTextUint(p, census.heap_failed);
+    pcTextStr(p, " failed");
+    vTextPut(VGA_PAGE_X, VGA_PAGE_Y, text, TEXT_COLS - VGA_PAGE_X);
+
+    for (i = 0; i < 2 * (VGA_PAGE_ROWS - 2); i++) {
+        x = VGA_PAGE_X + (i & 1) * VGA_CENSUS_HALF;
+        y = VGA_PAGE_Y + 2 + i / 2;
+        if (i >= census.count) {
+            vTextPut(x, y, "", (i & 1) ? TEXT_COLS - x : VGA_CENSUS_HALF);
+            continue;
+        }
+        pxEntry = &census.entry[i];
+        text[0] = cKind[pxEntry->kind];
+        text[1] = '\0';
+        vTextPut(x, y, text, 2);
+        vTextPut(x + 2, y, pxEntry->name, 12);
+        p = pcTextUint(text, pxEntry->peak);
+        p = pcTextStr(p, "/");
+        pcTextUint(p, pxEntry->capacity);
+        vTextPut(x + 14, y, text, 12);
+        pcTextUint(text, pxEntry->capacity ? (pxEntry->peak * 100 + pxEntry->capacity - 1) / pxEntry->capacity : 0);
+        vTextPut(x + 26, y, text, 6);
+        vTextPut(x + 32, y, pcRegion[pxEntry->region], (i & 1) ? TEXT_COLS - x - 32 : VGA_CENSUS_HALF - 32);
+    }
+}
+
+/* Run time statistics page, one row per task */
+static void vTasksPageInit(void) {
+    vTextPut(VGA_PAGE_X, VGA_PAGE_Y, "Task     Pri  CPU%   Stack free  Switches/s  Inherits", TEXT_COLS - VGA_PAGE_X);
+}
+
+static void vDrawTasks(void) {
+    static RunStats_t stats;
+    char text[TEXT_COLS + 1];
+    char *p;
+    RunStatsTask_t *pxTask;
+    UBaseType_t i;
+
+    vRunStatsGet(&stats);
+    for (i = 0; i < RUN_STATS_MAX_TASKS; i++) {
+        if (i >= stats.count) {
+            vTextClearRows(VGA_PAGE_Y + 1 + i, 1);
+            continue;
+        }
+        pxTask = &stats.task[i];
+        vTextPut(VGA_PAGE_X, VGA_PAGE_Y + 1 + i, pxTask->name, 9);
+        p = pcTextUint(text, pxTask->priority);
+        pcTextStr(p, pxTask->inherited ? "*" : "");
+        vTextPut(VGA_PAGE_X + 9, VGA_PAGE_Y + 1 + i, text, 5);
+        p = pcTextUint(text, pxTask->cpu_permille / 10);
+        p = pcTextStr(p, ".");
+        pcTextUint(p, pxTask->cpu_permille % 10);
+        vTextPut(VGA_PAGE_X + 14, VGA_PAGE_Y + 1 + i, text, 7);
+        pcTextUint(text, pxTask->stack_free);
+        vTextPut(VGA_PAGE_X + 21, VGA_PAGE_Y + 1 + i, text, 12);
+        pcTextUint(text, stats.interval_us ? (uint32_t)(((uint64_t)pxTask->switches * 1000000) / stats.interval_us) : 0);
+        vTextPut(VGA_PAGE_X + 33, VGA_PAGE_Y + 1 + i, text, 12);
+        pcTextUint(text, pxTask->inherits);
+        vTextPut(VGA_PAGE_X + 45, VGA_PAGE_Y + 1 + i, text, TEXT_COLS - VGA_PAGE_X - 45);
+    }
+
+    p = pcTextStr(text, "Interval ");
+    p = pcTextUint(p, stats.interval_us / 1000);
+    p = pcTextStr(p, " ms, ");
+    p = pcTextUint(p, stats.switches);
+    pcTextStr(p, " switches");
+    vTextPut(VGA_PAGE_X, VGA_PAGE_Y + 1 + RUN_STATS_MAX_TASKS, text, TEXT_COLS - VGA_PAGE_X);
+}
+
+/* Loads page: what the decision asked for and holds, what the outputs
+ * drive, the faults, and each load's registry entry if there is one */
+static void vLoadsPageInit(void) {
+    vTextPut(VGA_PAGE_X, VGA_PAGE_Y, "Load  Requested  Connected  Output  Fault     kW  Priority", TEXT_COLS - VGA_PAGE_X);
+}
+
+static void vDrawLoads(void) {
+    const LoadRegistry_t *pxRegistry = pxLoadRegistryGet();
+    LoadDecision_t decision;
+    Actuator_t actuator;
+    char text[TEXT_COLS + 1];
+    uint32_t seq, bit;
+    int i, y;
+
+    do {
+        seq = ulSeqReadBegin(&gLoad.lock);
+        decision = gLoad.decision;
+        actuator = gLoad.actuator;
+    } while (xSeqReadRetry(&gLoad.lock, seq));
+
+    for (i = 0; i < LOAD_PORT_BITS; i++) {
+        y = VGA_PAGE_Y + 1 + i;
+        bit = 1UL << i;
+        pcTextUint(text, i);
+        vTextPut(VGA_PAGE_X, y, text, 6);
+        vTextPut(VGA_PAGE_X + 6, y, decision.requested_status & bit ? "on" : "off", 11);
+        vTextPut(VGA_PAGE_X + 17, y, decision.load_status & bit ? "on" : "off", 11);
+        vTextPut(VGA_PAGE_X + 28, y, actuator.actuator_status & bit ? "on" : "off", 8);
+        vTextPut(VGA_PAGE_X + 36, y, actuator.faulty_loads & bit ? "FAULT" : "-", 6);
+        if (pxRegistry != NULL) {
+            pcTextUint(text, pxRegistry->load[i].rating_kw);
+            vTextPut(VGA_PAGE_X + 42, y, text, 9);
+            pcTextUint(text, pxRegistry->load[i].priority);
+            vTextPut(VGA_PAGE_X + 51, y, text, TEXT_COLS - VGA_PAGE_X - 51);
+        } else {
+            vTextPut(VGA_PAGE_X + 42, y, "-", TEXT_COLS - VGA_PAGE_X - 42);
+        }
+    }
+    vTextPut(VGA_PAGE_X, VGA_PAGE_Y + 1 + LOAD_PORT_BITS,
+             pxRegistry != NULL ? "Shedding by the load registry" : "Shedding by the policy table", TEXT_COLS - VGA_PAGE_X);
+}
+
+/* Latency page: ISR to decision and to shed, then every period monitor */
+static void vLatencyPageInit(void) {
+    vTextPut(VGA_PAGE_X, VGA_PAGE_Y, "Path         Count     Min us   Mean us    Max us      Late", TEXT_COLS - VGA_PAGE_X);
+    vTextPut(VGA_PAGE_X, VGA_PAGE_Y + 1, "Decision", 0);
+    vTextPut(VGA_PAGE_X, VGA_PAGE_Y + 2, "Shed", 0);
+    vTextPut(VGA_PAGE_X, VGA_PAGE_Y + 4, "Task          Jobs    Misses   Skipped Jitter us   Exec us  Max us", TEXT_COLS - VGA_PAGE_X);
+}
+
+/* Right aligned number of a table column */
+static void vPutColumn(int x, int y, uint32_t value, int width) {
+    char text[12];
+    char field[12];
+    int len, i;
+
+    len = (int)(pcTextUint(text, value) - text);
+    for (i = 0; i < width - len; i++) {
+        field[i] = ' ';
+    }
+    memcpy(&field[i], text, len + 1);
+    vTextPut(x, y, field, width);
+}
+
+static void vDrawLatency(void) {
+    LatencyStats_t latency;
+    PeriodStats_t period;
+    uint32_t i, n;
+    int y;
+
+    for (i = 0; i < 2; i++) {
+        vLatencyGetStats(i == 0 ? &gDecisionLatency : &gShedLatency, &xLatencySeq, &latency);
+        y = VGA_PAGE_Y + 1 + i;
+        vPutColumn(VGA_PAGE_X + 9, y, latency.count, 10);
+        vPutColumn(VGA_PAGE_X + 19, y, latency.count ? latency.min_us : 0, 10);
+        vPutColumn(VGA_PAGE_X + 29, y, ulLatencyMeanUs(&latency), 10);
+        vPutColumn(VGA_PAGE_X + 39, y, latency.max_us, 10);
+        vPutColumn(VGA_PAGE_X + 49, y, latency.deadline_misses, 10);
+    }
+
+    n = ulPeriodCount();
+    for (i = 0; i < PERIOD_MAX_MONITORS; i++) {
+        y = VGA_PAGE_Y + 5 + i;
+        if (i >= n) {
+            vTextPut(0, y, "", TEXT_COLS);
+            continue;
+        }
+        vPeriodGetStats(i, &period);
+        vTextPut(VGA_PAGE_X, y, period.pcName, 10);
+        vPutColumn(VGA_PAGE_X + 10, y, period.jobs, 8);
+        vPutColumn(VGA_PAGE_X + 18, y, period.misses, 10);
+        vPutColumn(VGA_PAGE_X + 28, y, period.skipped, 10);
+        vPutColumn(VGA_PAGE_X + 38, y, period.jitter_max_us, 10);
+        vPutColumn(VGA_PAGE_X + 48, y, period.exec_last_us, 10);
+        vPutColumn(VGA_PAGE_X + 58, y, period.exec_max_us, 8);
+    }
+}
+
+/* Event log page: the newest records, as the log task collected them */
+static void vEventsPageInit(void) {
+    vTextPut(VGA_PAGE_X, VGA_PAGE_Y, "Boot  Uptime s  Event              A           B", TEXT_COLS - VGA_PAGE_X);
+}
+
+static void vDrawEvents(void) {
+    static const char *const pcEventName[] = {
+        "-", "Boot", "Shed", "Reconnect", "Fault", "Failsafe", "Reset", "Deadline", "Warm boot"
+    };
+    EventRecord_t records[EVENT_LOG_RECENT];
+    char text[TEXT_COLS + 1];
+    char *p;
+    uint32_t i, n;
+    int y;
+
+    n = ulEventLogRecent(records);
+    for (i = 0; i < EVENT_LOG_RECENT; i++) {
+        y = VGA_PAGE_Y + 1 + i;
+        if (i >= n) {
+            vTextPut(0, y, "", TEXT_COLS);
+            continue;
+        }
+        vPutColumn(VGA_PAGE_X, y, records[i].boot, 4);
+        vPutColumn(VGA_PAGE_X + 4, y, records[i].uptime_ms / 1000, 10);
+        vTextPut(VGA_PAGE_X + 16, y, records[i].type < sizeof(pcEventName) / sizeof(pcEventName[0]) ?
+                                     pcEventName[records[i].type] : "?", 11);
+        p = pcTextStr(text, "0x");
+        pcTextHex(p, records[i].a, 8);
+        vTextPut(VGA_PAGE_X + 27, y, text, 12);
+        p = pcTextStr(text, "0x");
+        pcTextHex(p, records[i].b, 8);
+        vTextPut(VGA_PAGE_X + 39, y, text, TEXT_COLS - VGA_PAGE_X - 39);
+    }
+
+    p = pcTextUint(text, ulEventLogWritten());
+    p = pcTextStr(p, " written to flash, ");
+    p = pcTextUint(p, ulEventLogDropped());
+    pcTextStr(p, " dropped");
+    vTextPut(VGA_PAGE_X, VGA_PAGE_Y + 1 + EVENT_LOG_RECENT, text, TEXT_COLS - VGA_PAGE_X);
+}
+
+/* A page of the diagnostics area: vInit writes its fixed text once when it
+ * is selected, vUpdate its figures on each frame it is shown. Either may be
+ * NULL. A page that is not shown is never called. */
+typedef struct {
+    const char *pcName;
+    void (*vInit)(void);
+    void (*vUpdate)(void);
+} VGAPage_t;
+
+static const VGAPage_t xVGAPages[VGA_PAGES] = {
+    [VGA_PAGE_PLOTS]   = { "Plots",   NULL,              NULL         },
+    [VGA_PAGE_TASKS]   = { "Tasks",   vTasksPageInit,    vDrawTasks   },
+    [VGA_PAGE_MEMORY]  = { "Memory",  vCensusPageInit,   vDrawCensus  },
+    [VGA_PAGE_LOADS]   = { "Loads",   vLoadsPageInit,    vDrawLoads   },
+    [VGA_PAGE_LATENCY] = { "Latency", vLatencyPageInit,  vDrawLatency },
+    [VGA_PAGE_EVENTS]  = { "Events",  vEventsPageInit,   vDrawEvents  },
+};
+
+/* The diagnostics page selected by the editor. A switch clears the area
+ * and draws the tabs and the page's fixed text, once; after that a frame
+ * costs only the page's own update. */
+static void vDrawPage(void) {
+    static uint8_t shown = VGA_PAGES;  // None yet
+    char text[TEXT_COLS + 1];
+    char *p;
+    uint8_t page = xVGAPage;
+    int i;
+
+    if (page >= VGA_PAGES) {
+        page = VGA_PAGE_PLOTS;
+    }
+    if (page != shown) {
+        vTextClearRows(VGA_PAGE_Y, VGA_PAGE_ROWS);
+        p = text;
+        for (i = 0; i < VGA_PAGES; i++) {
+            p = pcTextStr(p, i == page ? "[" : " ");
+            p = pcTextUint(p, i + 1);
+            p = pcTextStr(p, " ");
+            p = pcTextStr(p, xVGAPages[i].pcName);
+            p = pcTextStr(p, i == page ? "] " : "  ");
+        }
+        vTextPut(VGA_PAGE_X, VGA_PAGE_TABS_Y, text, TEXT_COLS - VGA_PAGE_X);
+        if (xVGAPages[page].vInit != NULL) {
+            xVGAPages[page].vInit();
+        }
+        shown = page;
+    }
+    if (xVGAPages[page].vUpdate != NULL) {
+        xVGAPages[page].vUpdate();
+    }
+}
+#endif /* !FREQ_HEADLESS */
+
+/* Everything the config store keeps: the given limits and the active policy */
+static void vConfigCollect(ConfigParams_t *pxConfig, const Thresholds_t *pxThresholds) {
+    const LoadPolicy_t *pxPolicy = pxLoadPolicyGet();
+
+    pxConfig->upper_limit = pxThresholds->upper_limit;
+    pxConfig->lower_limit = pxThresholds->lower_limit;
+    pxConfig->max_roc = pxThresholds->max_roc;
+    memcpy(pxConfig->freq_thresholds, pxPolicy->freq_thresholds, sizeof(pxConfig->freq_thresholds));
+    memcpy(pxConfig->requested_status, pxPolicy->requested_status, sizeof(pxConfig->requested_status));
+}
+
+/* Publish new thresholds for one feeder as a fresh copy of the whole set,
+ * with a single pointer store. The copy it replaces is left alone until the
+ * next edit, so a reader that took the old pointer still finishes on
+ * consistent values. Every reader runs above the threshold editor (or, in
+ * FREQ_UI_COROUTINES builds, beside it on the idle task) and never blocks
+ * while holding the pointer, so none can still be using a copy an edit
+ * later. Threshold editor only. */
+static void vThresholdPublish(uint32_t channel, const Thresholds_t *pxNew) {
+    const ThresholdConfig_t *pxOld = gThresholds;
+    ThresholdConfig_t *pxConfig = &xThresholdConfig[pxOld == &xThresholdConfig[0] ? 1 : 0];
+
+    *pxConfig = *pxOld;
+    pxConfig->channel[channel] = *pxNew;
+
+    /* The copy is complete before it is published */
+    __asm__ __volatile__("" ::: "memory");
+    gThresholds = pxConfig;
+}
+
+#if FREQ_JOURNAL
+/* One feeder's thresholds into the input journal */
+static void vJournalThresholds(uint32_t channel, const Thresholds_t *pxThresholds) {
+    vJournalRecord(JOURNAL_THRESHOLD, channel << 2 | JOURNAL_FIELD_UPPER, (uint32_t)pxThresholds->upper_limit);
+    vJournalRecord(JOURNAL_THRESHOLD, channel << 2 | JOURNAL_FIELD_LOWER, (uint32_t)pxThresholds->lower_limit);
+    vJournalRecord(JOURNAL_THRESHOLD, channel << 2 | JOURNAL_FIELD_ROC, (uint32_t)pxThresholds->max_roc);
+}
+#endif
+
+/* Publish one feeder's new thresholds; feeder 0's also set the policy RoC
+ * boundary and are saved. Threshold editor only. */
+static void vThresholdApply(uint32_t channel, const Thresholds_t *pxNew) {
+    ConfigParams_t config;
+
+    vThresholdPublish(channel, pxNew);
+#if FREQ_INTEGRITY
+    vIntegrityRebase(xThresholdRegion);
+#endif
+#if FREQ_JOURNAL
+    vJournalThresholds(channel, pxNew);
+#endif
+
+    if (channel == 0) {
+        /* The shedding table uses the same RoC boundary */
+        vLoadPolicySetRocThreshold(pxNew->max_roc);
+#if FREQ_INTEGRITY
+        vIntegrityRebase(xPolicyRegion);
+#endif
+
+        /* Saved by the flash task once the keys have been quiet a while */
+        vConfigCollect(&config, pxNew);
+        vConfigSave(&config);
+    }
+}
+
+#if FREQ_FAULT_INJECT
+/* Edit task half: the setting the keyboard has just picked or changed */
+static void vFaultShow(uint32_t kind) {
+    xTelemetryUartTake(portMAX_DELAY);
+    printf("Fault inject: %s = %u, acted %lu times\n", pcFaultName(kind),
+           (unsigned int)usFaultGet(kind), (unsigned long)ulFaultCount(kind));
+    fflush(stdout);
+    vTelemetryUartGive();
+}
+#endif
+
+#if !FREQ_HEADLESS
+/* Page a digit key selects, VGA_PAGES for any other key */
+static uint8_t xPageKey(uint8_t code) {
+    static const uint8_t ucKeys[VGA_PAGES] = { PS2_KEY_1, PS2_KEY_2, PS2_KEY_3, PS2_KEY_4, PS2_KEY_5, PS2_KEY_6 };
+    uint8_t i;
+
+    for (i = 0; i < VGA_PAGES; i++) {
+        if (ucKeys[i] == code) {
+            return i;
+        }
+    }
+    return VGA_PAGES;
+}
+#endif
+
+/* Apply the thresholds a Modbus master has written, then every key the
+ * PS/2 ISR has queued to the thresholds of the feeder being edited,
+ * *pxEdit */
+static void vThresholdEditKeys(Thresholds_t *pxEdit) {
+    ThresholdConfig_t remote;
+    Ps2Key_t key;
+    uint32_t channels, i;
+    int step;
+
+    if (ulModbusChannels != 0) {
+        taskENTER_CRITICAL();
+        channels = ulModbusChannels;
+        remote = xModbusThresholds;
+        ulModbusChannels = 0;
+        taskEXIT_CRITICAL();
+
+        for (i = 0; i < FREQ_CHANNELS; i++) {
+            if (channels & (1UL << i)) {
+                vThresholdApply(i, &remote.channel[i]);
+                if (i == xEditChannel) {
+                    *pxEdit = remote.channel[i];
+                }
+            }
+        }
+    }
+
+#if !FREQ_HEADLESS
+    if (xPs2IsMouse()) {
+        vPlotMouse();
+        return;
+    }
+#endif
+
+    while (xPs2KeysGet(&key)) {
+        JOURNAL_INPUT(JOURNAL_KEY, 0, JOURNAL_KEY_VALUE(key.code, key.extended, key.released));
+        if (key.released) {
+            continue;
+        }
+
+        step = 0;
+        if (key.extended) {
+            if (key.code == PS2_KEY_UP) {
+                step = 1;
+            } else if (key.code == PS2_KEY_DOWN) {
+                step = -1;
+            }
+        } else if (key.code == PS2_KEY_U) {
+            xEditField = EDIT_FIELD_UPPER;
+        } else if (key.code == PS2_KEY_L) {
+            xEditField = EDIT_FIELD_LOWER;
+        } else if (key.code == PS2_KEY_R) {
+            xEditField = EDIT_FIELD_ROC;
+#if !FREQ_HEADLESS
+        } else if (key.code == PS2_KEY_T) {
+            xVGAPage = (xVGAPage + 1) % VGA_PAGES;
+            continue;
+        } else if (xPageKey(key.code) < VGA_PAGES) {
+            xVGAPage = xPageKey(key.code);
+            continue;
+#endif
+        } else if (key.code == PS2_KEY_M) {
+            xCensusDumpPending = 1;
+            continue;
+#if FREQ_CHANNELS > 1
+        } else if (key.code == PS2_KEY_F) {
+            xEditChannel = (xEditChannel + 1) % FREQ_CHANNELS;
+            *pxEdit = gThresholds->channel[xEditChannel];
+            continue;
+#endif
+#if FREQ_TRACE_REPLAY
+        } else if (key.code == PS2_KEY_G) {
+            vTraceReplayNext();
+            continue;
+#endif
+#if FREQ_RELAY_PROFILE
+        } else if (key.code == PS2_KEY_P) {
+            xProfileDumpPending = 1;
+            continue;
+#endif
+#if FREQ_RELAY_TIMING || FREQ_PERF_COUNTER || FREQ_IRQ_LATENCY
+        } else if (key.code == PS2_KEY_W) {
+            vWcetReset();
+            vPerfReset();
+            vIrqLatencyReset();
+            continue;
+#endif
+#if FREQ_FAULT_INJECT
+        } else if (key.code == PS2_KEY_I) {
+            /* The first press moves +/- over to the faults, each one after
+             * picks the next fault */
+            if (xEditField == EDIT_FIELD_FAULT) {
+                ulEditFault = (ulEditFault + 1) % FAULT_KINDS;
+            }
+            xEditField = EDIT_FIELD_FAULT;
+            vFaultShow(ulEditFault);
+            continue;
+#endif
+        } else if (key.code == PS2_KEY_EQUALS || key.code == PS2_KEY_KP_PLUS) {
+            step = 1;
+        } else if (key.code == PS2_KEY_MINUS || key.code == PS2_KEY_KP_MINUS) {
+            step = -1;
+        } else if (key.code == PS2_KEY_ESC) {
+            pxEdit->upper_limit = NOMINAL_FREQ_Q16 + FREQ_TOLERANCE_Q16;
+            pxEdit->lower_limit = NOMINAL_FREQ_Q16 - FREQ_TOLERANCE_Q16;
+            pxEdit->max_roc = MAX_FREQ_ROC_Q16;
+        } else {
+            continue;
+        }
+
+#if FREQ_FAULT_INJECT
+        if (xEditField == EDIT_FIELD_FAULT && step != 0) {
+            (void)usFaultStep(ulEditFault, step);
+            vFaultShow(ulEditFault);
+            continue;
+        }
+#endif
+
+        /* Apply the step, keeping lower < upper and both in range */
+        if (xEditField == EDIT_FIELD_UPPER) {
+            pxEdit->upper_limit += step * EDIT_FREQ_STEP_Q16;
+            if (pxEdit->upper_limit > EDIT_FREQ_MAX_Q16) {
+                pxEdit->upper_limit = EDIT_FREQ_MAX_Q16;
+            }
+            if (pxEdit->upper_limit < pxEdit->lower_limit + EDIT_MIN_BAND_Q16) {
+                pxEdit->upper_limit = pxEdit->lower_limit + EDIT_MIN_BAND_Q16;
+            }
+        } else if (xEditField == EDIT_FIELD_LOWER) {
+            pxEdit->lower_limit += step * EDIT_FREQ_STEP_Q16;
+            if (pxEdit->lower_limit < EDIT_FREQ_MIN_Q16) {
+                pxEdit->lower_limit = EDIT_FREQ_MIN_Q16;
+            }
+            if (pxEdit->lower_limit > pxEdit->upper_limit - EDIT_MIN_BAND_Q16) {
+                pxEdit->lower_limit = pxEdit->upper_limit - EDIT_MIN_BAND_Q16;
+            }
+        } else {
+            pxEdit->max_roc += step * EDIT_ROC_STEP_Q16;
+            if (pxEdit->max_roc < EDIT_ROC_MIN_Q16) {
+                pxEdit->max_roc = EDIT_ROC_MIN_Q16;
+            } else if (pxEdit->max_roc > EDIT_ROC_MAX_Q16) {
+                pxEdit->max_roc = EDIT_ROC_MAX_Q16;
+            }
+        }
+
+        vThresholdApply(xEditChannel, pxEdit);
+    }
+}
+
+#if !FREQ_HEADLESS
+/* Every packet the mouse has sent: move the cursor, pick a column, zoom.
+ * The cursor is moved under vCursorLock, so the display never finds it
+ * half drawn; that is two crosses of pixels. Threshold editor only. */
+static void vPlotMouse(void) {
+    static uint8_t buttons = 0;
+    Ps2Mouse_t move;
+    uint8_t pressed, level;
+    int x, y;
+
+    while (xPs2MouseGet(&move)) {
+        pressed = move.buttons & ~buttons;
+        buttons = move.buttons;
+
+        if (move.dx != 0 || move.dy != 0) {
+            x = xCursorX + move.dx;
+            y = xCursorY + move.dy;
+            x = x < 0 ? 0 : (x >= VGA_PIXELS_X ? VGA_PIXELS_X - 1 : x);
+            y = y < 0 ? 0 : (y >= VGA_PIXELS_Y ? VGA_PIXELS_Y - 1 : y);
+
+            vCursorLock();
+            WCET_BEGIN(WCET_UI_LOCK);
+            if (xCursorDrawn) {
+                vRasterXorCross(xCursorX, xCursorY, VGA_CURSOR_ARM, VGA_CURSOR_XOR);
+                vRasterXorCross(x, y, VGA_CURSOR_ARM, VGA_CURSOR_XOR);
+            }
+            xCursorX = (int16_t)x;
+            xCursorY = (int16_t)y;
+            WCET_END(WCET_UI_LOCK, x, y);
+            vCursorUnlock();
+        }
+
+        /* Nearest column, the trace points sit on the grid */
+        if ((pressed & PS2_MOUSE_LEFT) && xCursorY >= VGA_PICK_TOP && xCursorY <= VGA_PICK_BOTTOM) {
+            x = (xCursorX - FREQPLT_ORI_X + FREQPLT_GRID_SIZE_X / 2) / FREQPLT_GRID_SIZE_X;
+            if (xCursorX >= FREQPLT_ORI_X && x < PLOT_HISTORY) {
+                xVGAPick = (uint8_t)(x + 1);
+            }
+        }
+
+        /* Wheel away from the user zooms in to the shorter span */
+        level = xVGAZoomLevel;
+        if (move.wheel < 0 && level > 0) {
+            level--;
+        } else if (move.wheel > 0 && level < PLOT_LEVELS - 1) {
+            level++;
+        }
+        if (pressed & PS2_MOUSE_RIGHT) {
+            level = (level + 1) % PLOT_LEVELS;
+        }
+        if (level != xVGAZoomLevel) {
+            xVGAZoomLevel = level;
+        }
+    }
+}
+#endif
+
+/* Threshold Edit Task: U, L or R selects the upper limit, lower limit or RoC
+ * threshold, Up/Down or +/- step it and Esc restores the defaults. With more
+ * than one feeder F selects the next one to edit and show; the plots follow
+ * it from the next sample on. Only feeder 0 is saved to flash and sets the
+ * policy RoC boundary, the others start from its values at boot. G starts
+ * the next trace replay scenario in FREQ_TRACE_REPLAY builds (through the
+ * daemon in soak builds), P dumps the profile in FREQ_RELAY_PROFILE builds
+ * and W clears the probes in FREQ_RELAY_TIMING builds, the sections in
+ * FREQ_PERF_COUNTER builds and the latencies in FREQ_IRQ_LATENCY builds.
+ * T steps through the VGA diagnostics pages and 1 to 6 pick one, M prints
+ * the memory census on the JTAG UART. Thresholds written over Modbus are
+ * applied here too, so the editor stays the only publisher. Runs only when
+ * the PS/2 ISR has queued bytes or the Modbus task has written, or polls in
+ * FREQ_UI_COROUTINES builds. With a mouse on the port instead of the
+ * keyboard it drives the plot cursor, see vPlotMouse(). FREQ_HEADLESS
+ * builds have no pages and ignore the mouse. */
+#if !FREQ_UI_COROUTINES
+static void vThresholdEditTask(void *pvParameters) {
+    Thresholds_t thresholds;
+
+    vStdoutStatic(cThresholdEditStdout);
+    thresholds = gThresholds->channel[xEditChannel];
+
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        vThresholdEditKeys(&thresholds);
+    }
+}
+
+#else
+static void vKeysCoRoutine(CoRoutineHandle_t xHandle, UBaseType_t uxIndex) {
+    /* Co-routine locals do not survive a crDELAY() */
+    static Thresholds_t thresholds;
+
+    crSTART(xHandle);
+    thresholds = gThresholds->channel[xEditChannel];
+
+    for (;;) {
+        crDELAY(xHandle, pdMS_TO_TICKS(UI_KEYS_POLL_MS));
+        vThresholdEditKeys(&thresholds);
+    }
+    crEND();
+}
+#endif
+
+/* Modbus register map. A request reads from one snapshot of the feeders
+ * and loads, taken by vModbusBegin(), so the registers of one reply agree
+ * with each other. */
+static struct {
+    FreqResult_t freq;                 // Every feeder from the same analyzer pass
+    LoadState_t load;
+    ThresholdConfig_t thresholds;      // Staged by writes, handed over on commit
+    uint32_t staged;                   // Feeders written, bit per feeder
+#if FREQ_FAULT_INJECT
+    uint16_t fault[FAULT_KINDS];       // Fault settings written, applied on commit
+    uint32_t faults_staged;            // Bit per FAULT_*
+#endif
+    uint16_t fw[MB_FW_COUNT];          // Firmware registers written, applied on commit
+    uint32_t fw_staged;                // Bit per register below MB_FW_DATA
+    uint64_t fw_data_staged;           // Bit per data register
+    FwUpdateStatus_t fw_status;
+    uint32_t health;                   // Health word and its sequence
+    uint32_t heartbeat;
+} xModbusView;
+
+static uint16_t usMilliHertz(fix16_t value) {
+    int64_t mhz = ((int64_t)value * 1000) >> 16;
+
+    return (uint16_t)(mhz < 0 ? 0 : (mhz > 0xFFFF ? 0xFFFF : mhz));
+}
+
+static uint16_t usCentiHertz(fix16_t value) {
+    int64_t chz = ((int64_t)value * 100) >> 16;
+
+    return (uint16_t)(int16_t)(chz < -32768 ? -32768 : (chz > 32767 ? 32767 : chz));
+}
+
+static void vModbusBegin(uint8_t function) {
+    if (function == MODBUS_FC_READ_INPUT) {
+        ulBusLatest(&xFreqTopic, &xModbusView.freq);
+        vSeqRead(&gLoad.lock, &xModbusView.load.decision, &gLoad.decision,
+                 sizeof(LoadState_t) - offsetof(LoadState_t, decision));
+        xModbusView.health = ulHealthGet(&xModbusView.heartbeat);
+    }
+
+    /* Writes start from the thresholds in use, or from those already
+     * handed over and not yet applied */
+    taskENTER_CRITICAL();
+    xModbusView.thresholds = ulModbusChannels != 0 ? xModbusThresholds : *gThresholds;
+    taskEXIT_CRITICAL();
+    xModbusView.staged = 0;
+#if FREQ_FAULT_INJECT
+    xModbusView.faults_staged = 0;
+#endif
+    xModbusView.fw_staged = 0;
+    xModbusView.fw_data_staged = 0;
+    vFwUpdateGetStatus(&xModbusView.fw_status);
+}
+
+static uint8_t ucModbusReadFw(uint16_t index, uint16_t *pusValue) {
+    const FwUpdateStatus_t *pxStatus = &xModbusView.fw_status;
+
+    switch (index) {
+    case MB_IN_FW_STATE:          *pusValue = pxStatus->state;                     break;
+    case MB_IN_FW_BANK:           *pusValue = pxStatus->running_bank;              break;
+    case MB_IN_FW_RECEIVED:       *pusValue = (uint16_t)(pxStatus->received >> 16);   break;
+    case MB_IN_FW_RECEIVED + 1:   *pusValue = (uint16_t)pxStatus->received;           break;
+    case MB_IN_FW_PROGRAMMED:     *pusValue = (uint16_t)(pxStatus->programmed >> 16); break;
+    case MB_IN_FW_PROGRAMMED + 1: *pusValue = (uint16_t)pxStatus->programmed;         break;
+    default:                      *pusValue = (uint16_t)pxStatus->errors;             break;
+    }
+    return MODBUS_EX_NONE;
+}
+
+static uint8_t ucModbusRead(uint8_t function, uint16_t address, uint16_t *pusValue) {
+    const FrequencyData_t *pxFreq;
+    const Thresholds_t *pxThresholds;
+    uint32_t channel;
+
+    if (function == MODBUS_FC_READ_HOLDING) {
+#if FREQ_FAULT_INJECT
+        if (address >= MB_HOLD_FAULT && address < MB_HOLD_FAULT + FAULT_KINDS) {
+            *pusValue = usFaultGet(address - MB_HOLD_FAULT);
+            return MODBUS_EX_NONE;
+        }
+#endif
+        channel = (address - MB_HOLD_FEEDER) / MB_FEEDER_STRIDE;
+        if (address < MB_HOLD_FEEDER || channel >= FREQ_CHANNELS) {
+            return MODBUS_EX_ILLEGAL_ADDRESS;
+        }
+        pxThresholds = &xModbusView.thresholds.channel[channel];
+        switch ((address - MB_HOLD_FEEDER) % MB_FEEDER_STRIDE) {
+        case MB_FEEDER_LOWER:   *pusValue = usMilliHertz(pxThresholds->lower_limit); return MODBUS_EX_NONE;
+        case MB_FEEDER_UPPER:   *pusValue = usMilliHertz(pxThresholds->upper_limit); return MODBUS_EX_NONE;
+        case MB_FEEDER_MAX_ROC: *pusValue = usCentiHertz(pxThresholds->max_roc);     return MODBUS_EX_NONE;
+        default:                return MODBUS_EX_ILLEGAL_ADDRESS;
+        }
+    }
+
+    if (address >= MB_IN_FW && address < MB_IN_FW + MB_IN_FW_COUNT) {
+        return ucModbusReadFw(address - MB_IN_FW, pusValue);
+    }
+    switch (address) {
+    case MB_IN_STATE:     *pusValue = (uint16_t)(xStateGet() & STATE_FLAGS);              return MODBUS_EX_NONE;
+    case MB_IN_LOADS:     *pusValue = xModbusView.load.decision.load_status;              return MODBUS_EX_NONE;
+    case MB_IN_REQUESTED: *pusValue = xModbusView.load.decision.requested_status;         return MODBUS_EX_NONE;
+    case MB_IN_FAULTY:    *pusValue = xModbusView.load.actuator.faulty_loads;             return MODBUS_EX_NONE;
+    case MB_IN_FAULT:     *pusValue = xModbusView.load.actuator.system_fault;             return MODBUS_EX_NONE;
+    case MB_IN_FEEDERS:   *pusValue = FREQ_CHANNELS;                                      return MODBUS_EX_NONE;
+    case MB_IN_HEALTH:    *pusValue = (uint16_t)(xModbusView.health >> 16);               return MODBUS_EX_NONE;
+    case MB_IN_HEALTH + 1: *pusValue = (uint16_t)xModbusView.health;                      return MODBUS_EX_NONE;
+    case MB_IN_HEARTBEAT: *pusValue = (uint16_t)xModbusView.heartbeat;                    return MODBUS_EX_NONE;
+    default:              break;
+    }
+
+    channel = (address - MB_IN_FEEDER) / MB_FEEDER_STRIDE;
+    if (address < MB_IN_FEEDER || channel >= FREQ_CHANNELS) {
+        return MODBUS_EX_ILLEGAL_ADDRESS;
+    }
+    pxFreq = &xModbusView.freq.channel[channel];
+    switch ((address - MB_IN_FEEDER) % MB_FEEDER_STRIDE) {
+    case MB_FEEDER_FREQ:   *pusValue = usMilliHertz(pxFreq->current_freq); return MODBUS_EX_NONE;
+    case MB_FEEDER_ROC:    *pusValue = usCentiHertz(pxFreq->roc);          return MODBUS_EX_NONE;
+    case MB_FEEDER_STABLE: *pusValue = pxFreq->is_stable ? 1 : 0;          return MODBUS_EX_NONE;
+    default:               return MODBUS_EX_ILLEGAL_ADDRESS;
+    }
+}
+
+static uint8_t ucModbusWrite(uint16_t address, uint16_t value) {
+    Thresholds_t *pxThresholds;
+    uint32_t channel = (address - MB_HOLD_FEEDER) / MB_FEEDER_STRIDE;
+
+    if (address >= MB_HOLD_FW && address < MB_HOLD_FW + MB_FW_COUNT) {
+        xModbusView.fw[address - MB_HOLD_FW] = value;
+        if (address - MB_HOLD_FW < MB_FW_DATA) {
+            xModbusView.fw_staged |= 1UL << (address - MB_HOLD_FW);
+        } else {
+            xModbusView.fw_data_staged |= 1ULL << (address - MB_HOLD_FW - MB_FW_DATA);
+        }
+        return MODBUS_EX_NONE;
+    }
+#if FREQ_FAULT_INJECT
+    if (address >= MB_HOLD_FAULT && address < MB_HOLD_FAULT + FAULT_KINDS) {
+        xModbusView.fault[address - MB_HOLD_FAULT] = value;
+        xModbusView.faults_staged |= 1UL << (address - MB_HOLD_FAULT);
+        return MODBUS_EX_NONE;
+    }
+#endif
+    if (address < MB_HOLD_FEEDER || channel >= FREQ_CHANNELS) {
+        return MODBUS_EX_ILLEGAL_ADDRESS;
+    }
+    pxThresholds = &xModbusView.thresholds.channel[channel];
+    switch ((address - MB_HOLD_FEEDER) % MB_FEEDER_STRIDE) {
+    case MB_FEEDER_LOWER:
+        pxThresholds->lower_limit = (fix16_t)(((uint32_t)value << 16) / 1000);
+        break;
+    case MB_FEEDER_UPPER:
+        pxThresholds->upper_limit = (fix16_t)(((uint32_t)value << 16) / 1000);
+        break;
+    case MB_FEEDER_MAX_ROC:
+        pxThresholds->max_roc = (fix16_t)(((int32_t)(int16_t)value * 65536) / 100);
+        break;
+    default:
+        return MODBUS_EX_ILLEGAL_ADDRESS;
+    }
+    xModbusView.staged |= 1UL << channel;
+    return MODBUS_EX_NONE;
+}
+
+#define MB_FW_STAGED(first, count)     (((1UL << (count)) - 1) << (first))
+
+static uint32_t ulModbusFwLong(uint32_t index) {
+    return ((uint32_t)xModbusView.fw[index] << 16) | xModbusView.fw[index + 1];
+}
+
+/* Firmware registers written: a command, or a chunk whose data registers
+ * were all written, into the data's own bytes */
+static uint8_t ucModbusCommitFw(void) {
+    uint8_t *pucData = (uint8_t *)&xModbusView.fw[MB_FW_DATA];
+    uint32_t bytes = xModbusView.fw[MB_FW_BYTES], words = (bytes + 1) / 2, i;
+    uint16_t value;
+    int result;
+
+    if (xModbusView.fw_staged == MB_FW_STAGED(MB_FW_OFFSET, 3)) {
+        if (bytes == 0 || words > MB_FW_CHUNK_WORDS || xModbusView.fw_data_staged != ~0ULL >> (64 - words)) {
+            return MODBUS_EX_ILLEGAL_VALUE;
+        }
+        for (i = 0; i < words; i++) {
+            value = xModbusView.fw[MB_FW_DATA + i];
+            pucData[2 * i] = (uint8_t)(value >> 8);
+            pucData[2 * i + 1] = (uint8_t)value;
+        }
+        result = xFwUpdateWrite(ulModbusFwLong(MB_FW_OFFSET), pucData, bytes);
+        return result == FW_WRITE_OK ? MODBUS_EX_NONE :
+               result == FW_WRITE_BUSY ? MODBUS_EX_BUSY : MODBUS_EX_ILLEGAL_VALUE;
+    }
+
+    if (xModbusView.fw_data_staged != 0 || !(xModbusView.fw_staged & MB_FW_STAGED(MB_FW_COMMAND, 1))) {
+        return MODBUS_EX_ILLEGAL_VALUE;
+    }
+    switch (xModbusView.fw[MB_FW_COMMAND]) {
+    case MB_FW_BEGIN:
+        if (xModbusView.fw_staged != MB_FW_STAGED(MB_FW_COMMAND, 5)) {
+            return MODBUS_EX_ILLEGAL_VALUE;
+        }
+        return xFwUpdateBegin(ulModbusFwLong(MB_FW_LENGTH), ulModbusFwLong(MB_FW_CRC)) == 0 ?
+               MODBUS_EX_NONE : MODBUS_EX_BUSY;
+    case MB_FW_ABORT:
+        vFwUpdateAbort();
+        return MODBUS_EX_NONE;
+    case MB_FW_REBOOT:
+        return xFwUpdateReboot() == 0 ? MODBUS_EX_NONE : MODBUS_EX_ILLEGAL_VALUE;
+    default:
+        return MODBUS_EX_ILLEGAL_VALUE;
+    }
+}
+
+/* Within the limits the keyboard keeps to */
+static int xThresholdsInRange(const Thresholds_t *pxThresholds) {
+    return pxThresholds->lower_limit >= EDIT_FREQ_MIN_Q16 && pxThresholds->upper_limit <= EDIT_FREQ_MAX_Q16 &&
+           pxThresholds->upper_limit - pxThresholds->lower_limit >= EDIT_MIN_BAND_Q16 &&
+           pxThresholds->max_roc >= EDIT_ROC_MIN_Q16 && pxThresholds->max_roc <= EDIT_ROC_MAX_Q16;
+}
+
+/* Check the written feeders against the keyboard's limits, then hand them
+ * to the threshold editor, which publishes them */
+static uint8_t ucModbusCommit(void) {
+    uint32_t i;
+
+    if (xModbusView.fw_staged != 0 || xModbusView.fw_data_staged != 0) {
+        return ucModbusCommitFw();
+    }
+
+    for (i = 0; i < FREQ_CHANNELS; i++) {
+        if ((xModbusView.staged & (1UL << i)) && !xThresholdsInRange(&xModbusView.thresholds.channel[i])) {
+            return MODBUS_EX_ILLEGAL_VALUE;
+        }
+    }
+
+#if FREQ_FAULT_INJECT
+    /* Fault settings are clamped to their ranges rather than refused */
+    for (i = 0; i < FAULT_KINDS; i++) {
+        if (xModbusView.faults_staged & (1UL << i)) {
+            (void)usFaultSet(i, xModbusView.fault[i]);
+        }
+    }
+    if (xModbusView.staged == 0) {
+        return MODBUS_EX_NONE;
+    }
+#endif
+
+    taskENTER_CRITICAL();
+    xModbusThresholds = xModbusView.thresholds;
+    ulModbusChannels |= xModbusView.staged;
+    taskEXIT_CRITICAL();
+
+    if (xThresholdEditTask != NULL) {
+        xTaskNotifyGive(xThresholdEditTask);
+    }
+    return MODBUS_EX_NONE;
+}
+
+static const ModbusMap_t xModbusMap = {
+    vModbusBegin, ucModbusRead, ucModbusWrite, ucModbusCommit
+};
+
+#if FREQ_SHELL
+/* Shell commands, run on the idle task: every one only reads snapshots or
+ * hands its change to the task that owns it */
+static void vShellStats(int argc, char *argv[]) {
+    LatencyStats_t decision, shed;
+    LoadDecision_t load_decision;
+    FreqResult_t freq;
+    char hz[12], roc[12];
+    uint32_t i, health, heartbeat;
+
+    ulBusLatest(&xFreqTopic, &freq);
+    vSeqRead(&gLoad.lock, &load_decision, &gLoad.decision, sizeof(LoadDecision_t));
+    vLatencyGetStats(&gDecisionLatency, &xLatencySeq, &decision);
+    vLatencyGetStats(&gShedLatency, &xLatencySeq, &shed);
+
+    vShellPrintf("Up %lu s, loads requested 0x%02x driven 0x%02x, failsafe 0x%02lx, %lu output writes\n",
+                 (unsigned long)(xTaskGetTickCount() / configTICK_RATE_HZ),
+                 (unsigned int)load_decision.requested_status, (unsigned int)load_decision.load_status,
+                 (unsigned long)ulFailsafeLatched(), (unsigned long)ulOutputWrites());
+    for (i = 0; i < FREQ_CHANNELS; i++) {
+        *pcTextFix16(hz, freq.channel[i].current_freq, 3) = '\0';
+        *pcTextFix16(roc, freq.channel[i].roc, 2) = '\0';
+        vShellPrintf("Feeder %lu %s Hz %s Hz/s%s\n", (unsigned long)i, hz, roc,
+                     freq.channel[i].is_stable ? "" : ", unstable");
+    }
+    vShellPrintf("Decision %lu/%lu/%lu us, %lu late; shed %lu/%lu/%lu us, %lu late (min/mean/max)\n",
+                 (unsigned long)decision.min_us,
+                 (unsigned long)(decision.count ? decision.total_us / decision.count : 0),
+                 (unsigned long)decision.max_us, (unsigned long)decision.deadline_misses,
+                 (unsigned long)shed.min_us, (unsigned long)(shed.count ? shed.total_us / shed.count : 0),
+                 (unsigned long)shed.max_us, (unsigned long)shed.deadline_misses);
+    vShellPrintf("Telemetry %lu sent, %lu dropped; UART %lu out, %lu in and %lu shell lines dropped\n",
+                 (unsigned long)ulTelemetrySent(), (unsigned long)ulTelemetryDropped(),
+                 (unsigned long)ulJtagUartDropped(), (unsigned long)ulJtagUartRxDropped(),
+                 (unsigned long)ulShellDropped());
+    vShellPrintf("Status text formatted %lu times for the displays\n", (unsigned long)ulStatusTextFormats());
+    vShellPrintf("Feedback read %lu times\n", (unsigned long)ulFeedbackReads);
+    health = ulHealthGet(&heartbeat);
+    vShellPrintf("Health 0x%08lx at cycle %lu\n", (unsigned long)health, (unsigned long)heartbeat);
+}
+
+/* Show every feeder's thresholds, or stage one of them for the threshold
+ * editor as a Modbus write does */
+static void vShellThresholds(int argc, char *argv[]) {
+    Thresholds_t thresholds;
+    char upper[12], lower[12], roc[12];
+    uint32_t channel;
+    fix16_t value;
+
+    if (argc == 1) {
+        for (channel = 0; channel < FREQ_CHANNELS; channel++) {
+            thresholds = gThresholds->channel[channel];
+            *pcTextFix16(upper, thresholds.upper_limit, 2) = '\0';
+            *pcTextFix16(lower, thresholds.lower_limit, 2) = '\0';
+            *pcTextFix16(roc, thresholds.max_roc, 1) = '\0';
+            vShellPrintf("Feeder %lu upper %s lower %s Hz, RoC %s Hz/s\n", (unsigned long)channel, upper, lower, roc);
+        }
+        return;
+    }
+    if (argc != 4 || xShellArgUint(argv[1], &channel) != 0 || channel >= FREQ_CHANNELS ||
+        xShellArgFix16(argv[3], &value) != 0) {
+        vShellPrintf("usage: thr [feeder upper|lower|roc value]\n");
+        return;
+    }
+
+    thresholds = gThresholds->channel[channel];
+    if (strcmp(argv[2], "upper") == 0) {
+        thresholds.upper_limit = value;
+    } else if (strcmp(argv[2], "lower") == 0) {
+        thresholds.lower_limit = value;
+    } else if (strcmp(argv[2], "roc") == 0) {
+        thresholds.max_roc = value;
+    } else {
+        vShellPrintf("thr: upper, lower or roc\n");
+        return;
+    }
+    if (!xThresholdsInRange(&thresholds)) {
+        vShellPrintf("thr: outside the editor's limits\n");
+        return;
+    }
+
+    taskENTER_CRITICAL();
+    xModbusThresholds.channel[channel] = thresholds;
+    ulModbusChannels |= 1UL << channel;
+    taskEXIT_CRITICAL();
+    if (xThresholdEditTask != NULL) {
+        xTaskNotifyGive(xThresholdEditTask);
+    }
+}
+
+#if FREQ_FAULT_INJECT
+/* List the fault settings, or change one */
+static void vShellFault(int argc, char *argv[]) {
+    uint32_t kind, value;
+
+    if (argc == 1) {
+        for (kind = 0; kind < FAULT_KINDS; kind++) {
+            vShellPrintf("%lu %-12s %5u, acted %lu times\n", (unsigned long)kind, pcFaultName(kind),
+                         (unsigned int)usFaultGet(kind), (unsigned long)ulFaultCount(kind));
+        }
+        return;
+    }
+    if (argc != 3 || xShellArgUint(argv[1], &kind) != 0 || kind >= FAULT_KINDS ||
+        xShellArgUint(argv[2], &value) != 0) {
+        vShellPrintf("usage: fault [kind value]\n");
+        return;
+    }
+    vShellPrintf("%s = %u\n", pcFaultName(kind), (unsigned int)usFaultSet(kind, value));
+}
+#endif
+
+#if configUSE_KERNEL_TRACE
+/* Freeze the kernel trace; the run stats task dumps it */
+static void vShellTrace(int argc, char *argv[]) {
+    if (xKernelTraceFrozen()) {
+        vShellPrintf("trace: already frozen, waiting for its dump\n");
+        return;
+    }
+    vKernelTraceTrigger(SHELL_TRACE_REASON);
+    vShellPrintf("trace: frozen after %u more events, dumped with the next report\n",
+                 (unsigned int)KTRACE_POST_EVENTS);
+}
+#endif
+
+#if FREQ_JOURNAL
+/* Freeze the input journal; the run stats task dumps it */
+static void vShellJournal(int argc, char *argv[]) {
+    if (xJournalFrozen()) {
+        vShellPrintf("journal: already frozen, waiting for its dump\n");
+        return;
+    }
+    vJournalTrigger(SHELL_JOURNAL_REASON);
+    vShellPrintf("journal: frozen after %u more records, dumped with the next report\n",
+                 (unsigned int)JOURNAL_POST_RECORDS);
+}
+#endif
+
+#if FREQ_SCREEN_CAPTURE
+static void vShellScreenshot(int argc, char *argv[]) {
+    int32_t capture = lScreenCaptureStart();
+
+    if (capture < 0) {
+        vShellPrintf("screenshot: a capture is being sent, or no frame\n");
+        return;
+    }
+    vShellPrintf("screenshot: capture %ld going out over the telemetry link\n", (long)capture);
+}
+#endif
+
+/* Per-load counts from a first load, or the newest reconnections */
+static void vShellAudit(int argc, char *argv[]) {
+    uint32_t now_ms = xTaskGetTickCount() * portTICK_PERIOD_MS, first = 0, i;
+    AuditReconnect_t reconnect;
+    LoadAudit_t audit;
+
+    if (argc == 2 && strcmp(argv[1], "back") == 0) {
+        for (i = 0; i < SHELL_AUDIT_LINES && xLoadAuditReconnect(i, &reconnect); i++) {
+            vShellPrintf("Load %2u back %lu ms ago after %lu ms off, %s\n", (unsigned int)reconnect.load,
+                         (unsigned long)(now_ms - reconnect.at_ms), (unsigned long)reconnect.off_ms,
+                         pcLoadAuditReason(reconnect.reason));
+        }
+        if (i == 0) {
+            vShellPrintf("audit: no reconnections yet\n");
+        }
+        return;
+    }
+    if (argc > 2 || (argc == 2 && (xShellArgUint(argv[1], &first) != 0 || first >= LOAD_COUNT))) {
+        vShellPrintf("usage: audit [load|back]\n");
+        return;
+    }
+    for (i = first; i < first + SHELL_AUDIT_LINES && xLoadAuditGet(i, now_ms, &audit); i++) {
+        vShellPrintf("Load %2lu %s, %lu shed %lu back, %lu s off, last %s %lu ms ago\n", (unsigned long)i,
+                     audit.off ? "off" : "on ", (unsigned long)audit.sheds, (unsigned long)audit.reconnects,
+                     (unsigned long)(audit.off_ms / 1000), pcLoadAuditReason(audit.reason),
+                     (unsigned long)(now_ms - audit.changed_ms));
+    }
+}
+
+/* The run stats task prints it with its next report */
+static void vShellCensus(int argc, char *argv[]) {
+    xCensusDumpPending = 1;
+    vShellPrintf("census: with the next report, within %u ms\n", (unsigned int)RUN_STATS_PERIOD_MS);
+}
+
+#if configUSE_LOCK_PROFILE
+/* Contention profile of each mutex (queue.h), or with "clear" start them
+ * all again. Waits and holds in us. */
+static void vShellLocks(int argc, char *argv[]) {
+    const struct {
+        const char *pcName;
+        SemaphoreHandle_t xMutex;
+    } xLocks[] = {
+        { "UART",   xTelemetryUartMutex() },
+#if !FREQ_UI_COROUTINES && !FREQ_HEADLESS
+        { "Cursor", xCursorMutex },
+#endif
+    };
+    LockProfile_t profile;
+    uint32_t i;
+
+    if (argc == 2 && strcmp(argv[1], "clear") == 0) {
+        for (i = 0; i < sizeof(xLocks) / sizeof(xLocks[0]); i++) {
+            if (xLocks[i].xMutex != NULL) {
+                vQueueResetLockProfile(xLocks[i].xMutex);
+            }
+        }
+        vShellPrintf("locks: cleared\n");
+        return;
+    }
+    vShellPrintf("Lock        Takes  Contended  Wait max   mean  Hold max  Holder\n");
+    for (i = 0; i < sizeof(xLocks) / sizeof(xLocks[0]); i++) {
+        if (xLocks[i].xMutex == NULL || xQueueGetLockProfile(xLocks[i].xMutex, &profile) != pdPASS) {
+            continue;
+        }
+        vShellPrintf("%-8s %8lu %10lu %9lu %6lu %9lu  %s\n", xLocks[i].pcName, (unsigned long)profile.ulTakes,
+                     (unsigned long)profile.ulContended, (unsigned long)ulLatencyElapsedUs(0, profile.ulWaitMax),
+                     (unsigned long)(profile.ulContended != 0 ?
+                                     ulLatencyElapsedUs(0, (uint32_t)(profile.ullWaitTotal / profile.ulContended)) : 0),
+                     (unsigned long)ulLatencyElapsedUs(0, profile.ulHoldMax),
+                     profile.pvHoldMaxHolder != NULL ? pcTaskGetTaskName((TaskHandle_t)profile.pvHoldMaxHolder) : "-");
+    }
+}
+#endif
+
+#if configUSE_QUEUE_COUNTERS && configQUEUE_REGISTRY_SIZE > 0
+/* Every registered queue, semaphore and mutex: its depth now, its peak and
+ * its traffic since boot (queue.h) */
+static void vShellQueues(int argc, char *argv[]) {
+    QueueCounters_t counters;
+    QueueHandle_t xQueue;
+    const char *pcName;
+    UBaseType_t i, waiting;
+
+    vShellPrintf("Queue       Len  Now Peak     Sends  Receives  Blocks Timeouts\n");
+    for (i = 0; i < configQUEUE_REGISTRY_SIZE; i++) {
+        xQueue = xQueueGetRegistryEntry(i, &pcName);
+        if (xQueue == NULL) {
+            continue;
+        }
+        vQueueGetCounters(xQueue, &counters);
+        waiting = uxQueueMessagesWaiting(xQueue);
+        vShellPrintf("%-10s %4u %4u %4u %9lu %9lu %7lu %8lu\n", pcName,
+                     (unsigned int)(waiting + uxQueueSpacesAvailable(xQueue)), (unsigned int)waiting,
+                     (unsigned int)uxQueueMessagesPeak(xQueue), (unsigned long)counters.ulSends,
+                     (unsigned long)counters.ulReceives, (unsigned long)counters.ulBlocks,
+                     (unsigned long)counters.ulTimeouts);
+    }
+}
+#endif
+
+#if FREQ_INTEGRITY
+/* Each checked region with its reference and its last pass's CRC */
+static void vShellIntegrity(int argc, char *argv[]) {
+    IntegrityStats_t stats;
+    IntegrityRegion_t region;
+    uint32_t i;
+
+    vIntegrityGetStats(&stats);
+    vShellPrintf("Region         Bytes  Reference       Last\n");
+    for (i = 0; i < stats.regions; i++) {
+        vIntegrityGetRegion(i, &region);
+        vShellPrintf("%-10s %9lu  0x%08lx 0x%08lx%s\n", region.pcName, (unsigned long)region.bytes,
+                     (unsigned long)region.reference, (unsigned long)region.last,
+                     stats.failed & (1UL << i) ? "  FAILED" : "");
+    }
+    vShellPrintf("%lu cycles, %lu late, last %lu ms\n", (unsigned long)stats.cycles, (unsigned long)stats.late,
+                 (unsigned long)stats.last_ms);
+}
+#endif
+
+#if FREQ_ACTUATION_LIMIT
+/* The limiter's counts and the loads' minimum times, or set one load's */
+static void vShellLimit(int argc, char *argv[]) {
+    uint32_t first = 0, on_ms, off_ms, i;
+    uint16_t min_on_ms, min_off_ms;
+    LimiterStats_t stats;
+
+    if (argc == 4) {
+        if (xShellArgUint(argv[1], &first) != 0 || xShellArgUint(argv[2], &on_ms) != 0 ||
+            xShellArgUint(argv[3], &off_ms) != 0 || on_ms > UINT16_MAX || off_ms > UINT16_MAX ||
+            !xLoadLimiterSetTimes(first, (uint16_t)on_ms, (uint16_t)off_ms)) {
+            vShellPrintf("usage: limit [load [on_ms off_ms]], times up to %u ms\n", (unsigned int)UINT16_MAX);
+        }
+        return;
+    }
+    if (argc == 3 || argc > 4 || (argc == 2 && (xShellArgUint(argv[1], &first) != 0 || first >= LOAD_COUNT))) {
+        vShellPrintf("usage: limit [load [on_ms off_ms]]\n");
+        return;
+    }
+    vLoadLimiterGetStats(&stats);
+    vShellPrintf("%lu passed, held %lu on %lu off %lu rate, %lu absorbed; %u changes per %u ms\n",
+                 (unsigned long)stats.passed, (unsigned long)stats.held_on, (unsigned long)stats.held_off,
+                 (unsigned long)stats.rate, (unsigned long)stats.absorbed, (unsigned int)LIMITER_CHANGES,
+                 (unsigned int)LIMITER_WINDOW_MS);
+    for (i = first; i < first + SHELL_AUDIT_LINES && xLoadLimiterGetTimes(i, &min_on_ms, &min_off_ms); i++) {
+        vShellPrintf("Load %2lu min on %5u ms, off %5u ms%s\n", (unsigned long)i, (unsigned int)min_on_ms,
+                     (unsigned int)min_off_ms, stats.pending & xLoadBit(i) ? ", held" : "");
+    }
+}
+#endif
+
+#if configUSE_HEAP_TRACE
+static void vShellHeap(int argc, char *argv[]) {
+    xHeapTraceDumpPending = 1;
+    vShellPrintf("heap: %lu allocations, %lu since the scheduler started, call sites with the next report\n",
+                 (unsigned long)ulHeapTraceAllocations(), (unsigned long)ulHeapTraceLateAllocations());
+}
+#endif
+
+static const ShellCommand_t xShellCommands[] = {
+    { "stats",  "  loads, frequencies, latencies and drops", vShellStats },
+    { "thr",    "[feeder upper|lower|roc value]  show or set thresholds", vShellThresholds },
+#if FREQ_FAULT_INJECT
+    { "fault",  "[kind value]  show or set fault injection", vShellFault },
+#endif
+#if configUSE_KERNEL_TRACE
+    { "trace",  "  freeze and dump the kernel trace", vShellTrace },
+#endif
+#if FREQ_JOURNAL
+    { "journal", "  freeze and dump the input journal", vShellJournal },
+#endif
+#if FREQ_SCREEN_CAPTURE
+    { "screenshot", "  capture the screen over the telemetry link", vShellScreenshot },
+#endif
+    { "audit",  "[load|back]  per-load shed counts, or the newest reconnections", vShellAudit },
+    { "census", "  dump the memory census", vShellCensus },
+#if configUSE_LOCK_PROFILE
+    { "locks",  "[clear]  mutex takes, waits and holds", vShellLocks },
+#endif
+#if FREQ_INTEGRITY
+    { "integrity", "  checked regions and their CRCs", vShellIntegrity },
+#endif
+#if FREQ_ACTUATION_LIMIT
+    { "limit",  "[load [on_ms off_ms]]  actuation limiter, or set a load's minimum times", vShellLimit },
+#endif
+#if configUSE_QUEUE_COUNTERS && configQUEUE_REGISTRY_SIZE > 0
+    { "queues", "  kernel object depths, sends, receives, blocks and timeouts", vShellQueues },
+#endif
+#if configUSE_HEAP_TRACE
+    { "heap",   "  allocations by call site, and those after the start", vShellHeap },
+#endif
+};
+#endif /* FREQ_SHELL */
+
+#if FREQ_COORD
+/* Load each coordinated stage sheds beyond the one before: the loads policy
+ * row n drops that row n - 1 keeps (RoC within limit), on any feeder */
+static void vCoordStageKw(uint16_t *pusKw) {
+    const LoadPolicy_t *pxPolicy = pxLoadPolicyGet();
+    const LoadRegistry_t *pxRegistry = pxLoadRegistryGet();
+    LoadMask_t wired = 0, loads;
+    uint32_t i, k, kw;
+
+    for (i = 0; i < FREQ_CHANNELS; i++) {
+        wired |= xFreqChannelHw[i].loads;
+    }
+    for (k = 0; k < COORD_STAGES; k++) {
+        loads = pxPolicy->requested_status[k][0] & ~pxPolicy->requested_status[k + 1][0] & wired;
+        for (kw = 0; loads != 0; loads &= loads - 1) {
+            i = ulLoadFirst(loads);
+            kw += pxRegistry != NULL && i < REGISTRY_LOADS ? pxRegistry->load[i].rating_kw : COORD_LOAD_KW;
+        }
+        pusKw[k] = (uint16_t)(kw > 0xFFFF ? 0xFFFF : kw);
+    }
+}
+
+/* Coordination Task: parses the frames the ring brings, woken by each one,
+ * and sends this relay's status (the leader also its assignment) every
+ * COORD_PERIOD_MS. Forwarding is the UART interrupt's. */
+static void vCoordTask(void *pvParameters) {
+    CoordStatus_t status;
+    FreqResult_t result;
+    FrequencyData_t *pxChannel;
+    uint32_t i, now_ms;
+    int stage;
+
+    memcpy(status.stage_kw, usCoordStageKw, sizeof(status.stage_kw));
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(COORD_PERIOD_MS));
+        vPeriodStart(&xCoordPeriod);
+        now_ms = xTaskGetTickCount() * portTICK_PERIOD_MS;
+
+        /* The feeder furthest down speaks for this relay */
+        ulBusLatest(&xFreqTopic, &result);
+        pxChannel = &result.channel[0];
+        status.flags = COORD_FLAG_STABLE;
+        for (i = 0; i < FREQ_CHANNELS; i++) {
+            if (result.channel[i].current_freq - result.channel[i].lower_limit <
+                pxChannel->current_freq - pxChannel->lower_limit) {
+                pxChannel = &result.channel[i];
+            }
+        }
+        if (result.unstable) {
+            status.flags &= ~COORD_FLAG_STABLE;
+        }
+        if (ulFailsafeLatched()) {
+            status.flags |= COORD_FLAG_FAILSAFE;
+        }
+        status.freq = pxChannel->current_freq;
+        status.roc = pxChannel->roc_peak;
+        status.lower_limit = pxChannel->lower_limit;
+        stage = xCoordStage(now_ms);
+        status.stage = (uint8_t)(stage < 0 ? 0 : stage);
+
+        vCoordService(&status, now_ms);
+        vPeriodEnd(&xCoordPeriod);
+    }
+}
+
+/* Time Sync Task: steers this relay's copy of the leader's clock from each
+ * time sample the coordination task posts, once a COORD_TIME_PERIOD_MS */
+static void vTimeSyncTask(void *pvParameters) {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        vPeriodStart(&xTimeSyncPeriod);
+        vTimeSyncService();
+        vPeriodEnd(&xTimeSyncPeriod);
+    }
+}
+#endif
+
+#if FREQ_ETHERNET
+/* Telemetry datagrams to the host, built in place by the drain */
+static uint8_t *pucTelemetryEthBegin(uint32_t *pulCap) {
+    return pucEthHostBegin(ETH_TELEMETRY_PORT, pulCap);
+}
+
+static const TelemetrySink_t xTelemetryEth = {
+    pucTelemetryEthBegin, vEthSend
+};
+
+/* Modbus requests over UDP go to the Modbus task, which shares the parser
+ * with the RS-232 port. Only the newest waits: an older one not yet
+ * answered has been given up on by its master. */
+static void vModbusDatagram(EthDatagram_t *pxDatagram) {
+    EthDatagram_t *pxOld = pvPoolSwap(&pvModbusDatagram, pxDatagram);
+
+    if (pxOld != NULL) {
+        vEthRelease(pxOld);
+    }
+    xTaskNotifyGive(xModbusTask);
+}
+
+/* Answer the waiting datagram into one back to its sender */
+static void vModbusUdpService(void) {
+    EthDatagram_t *pxRequest = pvPoolSwap(&pvModbusDatagram, NULL);
+    uint8_t *pucReply;
+    uint32_t cap;
+
+    if (pxRequest == NULL) {
+        return;
+    }
+    pucReply = pucEthReplyBegin(pxRequest, &cap);
+    if (pucReply != NULL) {
+        vEthSend(pucReply, ulModbusUdp(pxRequest->pucPayload, pxRequest->len, pucReply));
+    }
+    vEthRelease(pxRequest);
+}
+
+/* Ethernet Task: answers ARP and ping and dispatches datagrams, woken by
+ * each frame received */
+static void vEthTask(void *pvParameters) {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(ETH_ARP_RETRY_MS));
+        vPeriodStart(&xEthPeriod);
+        vEthService(xTaskGetTickCount() * portTICK_PERIOD_MS);
+        vPeriodEnd(&xEthPeriod);
+    }
+}
+#endif
+
+/* Modbus Task: answers the SCADA master's requests, woken by each byte the
+ * UART receives, and by each request over UDP. Thresholds it is sent go
+ * through the threshold editor. */
+static void vModbusTask(void *pvParameters) {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(MODBUS_DEADLINE_MS));
+        vPeriodStart(&xModbusPeriod);
+        vModbusService();
+#if FREQ_ETHERNET
+        vModbusUdpService();
+#endif
+        vPeriodEnd(&xModbusPeriod);
+    }
+}
+
+#if FREQ_RELAY_TIMING
+/* Longest run of a probe, in whole microseconds rounded up */
+static uint32_t ulWcetMaxUs(uint32_t probe) {
+    WcetStats_t wcet;
+    uint32_t counts = ulLatencyCountsPerUs();
+
+    vWcetGetStats(probe, &wcet);
+    return (wcet.max_cycles + counts - 1) / counts;
+}
+
+static void vRtaAdd(RtaTask_t *pxTable, uint32_t *pulCount, const char *pcName, uint32_t priority,
+                    uint32_t period_us, uint32_t wcet_us, uint32_t section_us) {
+    RtaTask_t *pxTask;
+
+    if (*pulCount >= RTA_MAX_ENTRIES) {
+        return;
+    }
+    pxTask = &pxTable[(*pulCount)++];
+    pxTask->pcName = pcName;
+    pxTask->priority = priority;
+    pxTask->period_us = period_us;
+    pxTask->deadline_us = 0;
+    pxTask->wcet_us = wcet_us;
+    pxTask->section_us = section_us;
+    pxTask->section_ceiling = 0;
+}
+
+/* Response time bounds from the longest times measured so far. Jobs with a
+ * probe use it (wcet.h); the others use their period monitor's longest
+ * job, which already holds any preemption and so overstates them. The
+ * interrupts use the trampoline's times, the tick its hook's probe and an
+ * allowance for the kernel. The blocking term is the editor's cursor move,
+ * which holds up only the display and Modbus (its mutex's ceiling is the
+ * display); co-routine builds have no such section, and the
+ * interrupt-masked sections are a few instructions each and are not
+ * counted. The shed path is the analyzer's bound from the sample
+ * landing, then the actuator's from its release, plus any FIFO batching. */
+static void vRtaReport(void) {
+    static RtaTask_t xTable[RTA_MAX_ENTRIES];
+    static RtaResult_t xResult[RTA_MAX_ENTRIES];
+    IrqStats_t irq;
+    uint32_t i, n = 0, missed, shed_us, counts = ulLatencyCountsPerUs();
+#if !FREQ_TIME_TRIGGERED
+    uint32_t analyzer, actuator;
+#else
+    uint32_t cyclic;
+#endif
+
+    for (i = 0; i < sizeof(xTimedIrqs) / sizeof(xTimedIrqs[0]); i++) {
+        vIrqGetStats(xTimedIrqs[i].irq, &irq);
+        vRtaAdd(xTable, &n, xTimedIrqs[i].name, RTA_IRQ_PRIORITY, xTimedIrqs[i].interval_us,
+                (irq.max_cycles + counts - 1) / counts, 0);
+    }
+    vRtaAdd(xTable, &n, "Tick", RTA_IRQ_PRIORITY, 1000000UL / configTICK_RATE_HZ,
+            ulWcetMaxUs(WCET_TICK) + RTA_TICK_KERNEL_US, 0);
+    vRtaAdd(xTable, &n, "Daemon", TELEMETRY_DAEMON_PRIORITY, TELEMETRY_PERIOD_MS * 1000UL,
+            xTelemetryPeriod.exec_max_us, 0);
+#if FREQ_TIME_TRIGGERED
+    cyclic = n;
+    vRtaAdd(xTable, &n, "Cyclic", CYCLIC_PRIORITY, CYCLIC_MINOR_MS * 1000UL, xCyclicPeriod.exec_max_us, 0);
+#else
+    analyzer = n;
+    vRtaAdd(xTable, &n, "FreqAn", FREQ_ANALYZER_PRIORITY, RTA_SAMPLE_MIN_US / FREQ_CHANNELS,
+            ulWcetMaxUs(WCET_ANALYZER), 0);
+    vRtaAdd(xTable, &n, "SysMon", SYSTEM_MONITOR_PRIORITY, SYSTEM_MONITOR_PERIOD_MS * 1000UL,
+            ulWcetMaxUs(WCET_MONITOR) + ulWcetMaxUs(WCET_FEEDBACK), 0);
+    actuator = n;
+    vRtaAdd(xTable, &n, "LoadAct", LOAD_ACTUATOR_PRIORITY, RTA_SAMPLE_MIN_US / FREQ_CHANNELS,
+            ulWcetMaxUs(WCET_ACTUATOR), 0);
+#endif
+    vRtaAdd(xTable, &n, "WDog", WATCHDOG_PRIORITY, WATCHDOG_PERIOD_MS * 1000UL, ulWcetMaxUs(WCET_WATCHDOG), 0);
+#if !FREQ_UI_COROUTINES
+    vRtaAdd(xTable, &n, "SysState", SYSTEM_STATE_PRIORITY, RTA_STATE_MIN_US, ulWcetMaxUs(WCET_STATE), 0);
+#if !FREQ_HEADLESS
+    vRtaAdd(xTable, &n, "VGADisp", VGA_DISPLAY_PRIORITY, VGA_DISPLAY_PERIOD_MS * 1000UL, xVGAPeriod.exec_max_us, 0);
+#endif
+#endif
+    vRtaAdd(xTable, &n, "Modbus", MODBUS_PRIORITY, RTA_MODBUS_MIN_US, xModbusPeriod.exec_max_us, 0);
+#if FREQ_ETHERNET
+    vRtaAdd(xTable, &n, "Eth", ETH_PRIORITY, RTA_ETH_MIN_US, xEthPeriod.exec_max_us, 0);
+#endif
+#if FREQ_COORD
+    vRtaAdd(xTable, &n, "Coord", COORD_PRIORITY, RTA_COORD_MIN_US, xCoordPeriod.exec_max_us, 0);
+#endif
+#if !FREQ_UI_COROUTINES && !FREQ_HEADLESS
+    /* Only the cursor lock blocks anything above it */
+    vRtaAdd(xTable, &n, "ThrEdit", THRESHOLD_EDIT_PRIORITY, 0, 0, ulWcetMaxUs(WCET_UI_LOCK));
+    xTable[n - 1].section_ceiling = VGA_DISPLAY_PRIORITY;
+#endif
+#if FREQ_COORD
+    vRtaAdd(xTable, &n, "TSync", TIME_SYNC_PRIORITY, COORD_TIME_PERIOD_MS * 1000UL, xTimeSyncPeriod.exec_max_us, 0);
+#endif
+    vRtaAdd(xTable, &n, "Flash", FLASH_PRIORITY, FLASH_PERIOD_MS * 1000UL, xFlashPeriod.exec_max_us, 0);
+    vRtaAdd(xTable, &n, "RunStat", RUN_STATS_PRIORITY, RUN_STATS_PERIOD_MS * 1000UL, xRunStatsPeriod.exec_max_us, 0);
+
+    missed = ulRtaAnalyse(xTable, n, xResult);
+
+    printf("RTA      Pri  Period    WCET   Block  Response (us)\n");
+    for (i = 0; i < n; i++) {
+        if (xTable[i].priority == RTA_IRQ_PRIORITY) {
+            printf("%-8s IRQ", xTable[i].pcName);
+        } else {
+            printf("%-8s %3lu", xTable[i].pcName, (unsigned long)xTable[i].priority);
+        }
+        if (xTable[i].period_us == 0) {
+            printf(" %7s %7lu %7lu  %8s\n", "-", (unsigned long)xTable[i].wcet_us,
+                   (unsigned long)xResult[i].blocking_us, "sporadic");
+        } else if (xResult[i].response_us == RTA_UNBOUNDED) {
+            printf(" %7lu %7lu %7lu  %8s  PAST PERIOD\n", (unsigned long)xTable[i].period_us,
+                   (unsigned long)xTable[i].wcet_us, (unsigned long)xResult[i].blocking_us, "none");
+        } else {
+            printf(" %7lu %7lu %7lu  %8lu%s\n", (unsigned long)xTable[i].period_us,
+                   (unsigned long)xTable[i].wcet_us, (unsigned long)xResult[i].blocking_us,
+                   (unsigned long)xResult[i].response_us, xResult[i].met ? "" : "  PAST PERIOD");
+        }
+    }
+
+#if FREQ_TIME_TRIGGERED
+    /* A sample waits for the next minor frame, then the frame's steps run */
+    shed_us = xResult[cyclic].met ? CYCLIC_MINOR_MS * 1000UL + xResult[cyclic].response_us : RTA_UNBOUNDED;
+#else
+    shed_us = xResult[analyzer].met && xResult[actuator].met ?
+              xResult[analyzer].response_us + xResult[actuator].response_us : RTA_UNBOUNDED;
+#endif
+    if (shed_us != RTA_UNBOUNDED && FREQ_ANALYSER_FIFO) {
+        shed_us += (FREQ_ANALYSER_BATCH - 1) * RTA_SAMPLE_MAX_US;
+    }
+    if (shed_us == RTA_UNBOUNDED) {
+        printf("Shed path: no bound, ");
+    } else {
+        printf("Shed path: %lu us bound, ", (unsigned long)shed_us);
+    }
+    printf("deadline %lu us; %lu task(s) past their period\n", SHED_DEADLINE_MS * 1000UL, (unsigned long)missed);
+}
+#endif
+
+#if FREQ_RELAY_SOAK
+/* Counters the summary reports as a window and as the run so far */
+typedef struct {
+    uint32_t misses;                   // Period monitor deadline misses, all tasks
+    uint32_t dropped;                  // Samples the analyzer was too late for, all feeders
+    uint32_t telemetry;                // Telemetry records dropped
+    uint32_t deferred;                 // Deferred calls dropped
+    uint32_t events;                   // Event log entries dropped
+    uint32_t faults;
+    uint32_t scenarios;
+    uint32_t failsafes;
+} SoakCounters_t;
+
+static void vSoakLatencyLine(const char *pcName, const SoakHist_t *pxHist) {
+    printf("%-9s %8lu %7lu %7lu %7lu %7lu %7lu\n", pcName, (unsigned long)pxHist->count,
+           (unsigned long)ulSoakHistPercentile(pxHist, 5000), (unsigned long)ulSoakHistPercentile(pxHist, 9000),
+           (unsigned long)ulSoakHistPercentile(pxHist, 9900), (unsigned long)ulSoakHistPercentile(pxHist, 9990),
+           (unsigned long)ulSoakHistPercentile(pxHist, 10000));
+}
+
+/* One line of the sizing table: the peak so far with the margin on top */
+static uint32_t ulSoakStackLine(const char *pcMacro, uint32_t words, uint32_t never_used) {
+    uint32_t peak = words - never_used;
+    uint32_t sized = (peak * (100 + SOAK_STACK_MARGIN_PCT) / 100 + SOAK_STACK_ROUND - 1) /
+                     SOAK_STACK_ROUND * SOAK_STACK_ROUND;
+
+    printf("#define %-34s %5lu  // peak %lu of %lu\n", pcMacro, (unsigned long)sized, (unsigned long)peak,
+           (unsigned long)words);
+    return sized;
+}
+
+/* Stack sizes to build with, from the deepest each stack has been over the
+ * scenarios so far, as the stack macros; after a full cycle of them the
+ * table can be pasted over the ones in use. The kernel's stacks are in
+ * FreeRTOSConfig.h. */
+static void vSoakStackSizing(void) {
+    static const char *const pcMacros[APP_TASK_COUNT] = { APP_TASKS(APP_TASK_STACK_NAME) };
+    uint32_t i, words = 0, sized = 0;
+
+    printf("Stack sizing, %u%% over the peak in words:\n", (unsigned int)SOAK_STACK_MARGIN_PCT);
+    for (i = 0; i < APP_TASK_COUNT; i++) {
+        words += xAppTasks[i].usStackWords;
+        sized += ulSoakStackLine(pcMacros[i], xAppTasks[i].usStackWords,
+                                 uxTaskGetStackHighWaterMark(*xAppTasks[i].pxHandle));
+    }
+    words += configMINIMAL_STACK_SIZE + configTIMER_TASK_STACK_DEPTH + configISR_STACK_SIZE;
+    sized += ulSoakStackLine("configMINIMAL_STACK_SIZE", configMINIMAL_STACK_SIZE,
+                             uxTaskGetStackHighWaterMark(xTaskGetIdleTaskHandle()));
+    sized += ulSoakStackLine("configTIMER_TASK_STACK_DEPTH", configTIMER_TASK_STACK_DEPTH,
+                             uxTaskGetStackHighWaterMark(xTimerGetTimerDaemonTaskHandle()));
+#if configUSE_TIMER_BACKGROUND
+    words += configTIMER_BACKGROUND_STACK_DEPTH;
+    sized += ulSoakStackLine("configTIMER_BACKGROUND_STACK_DEPTH", configTIMER_BACKGROUND_STACK_DEPTH,
+                             uxTaskGetStackHighWaterMark(xTimerGetBackgroundDaemonTaskHandle()));
+#endif
+    sized += ulSoakStackLine("configISR_STACK_SIZE", configISR_STACK_SIZE, uxPortGetIsrStackHighWaterMark());
+    printf("Sized: %lu of %lu words, %ld bytes of on-chip RAM back\n", (unsigned long)sized,
+           (unsigned long)words, ((long)words - (long)sized) * (long)sizeof(StackType_t));
+}
+
+/* Summary of the last SOAK_SUMMARY_MIN minutes and of the whole run, from
+ * the run stats task with the UART held. Percentiles are bin tops, within
+ * an eighth of the value; a window's top percentile is its top bin. */
+static void vSoakSummary(const RunStats_t *pxStats) {
+    static SoakHist_t xShed, xDecision, xShedLast, xDecisionLast, xWindow;
+    static SoakCounters_t xLast;
+    SoakCounters_t now;
+    PeriodStats_t period;
+#if configUSE_TLSF_HEAP
+    HeapStats_t heap;
+#endif
+    uint32_t i, least = 0;
+
+    now.misses = 0;
+    for (i = 0; i < ulPeriodCount(); i++) {
+        vPeriodGetStats(i, &period);
+        now.misses += period.misses;
+    }
+    now.dropped = 0;
+    for (i = 0; i < FREQ_CHANNELS; i++) {
+        now.dropped += gFreqChannel[i].ring.dropped;
+    }
+    now.telemetry = ulTelemetryDropped();
+    now.deferred = ulIrqDeferDropped();
+    now.events = ulEventLogDropped();
+    now.faults = ulSoakFaults;
+    now.scenarios = ulSoakScenarios;
+    now.failsafes = ulSoakFailsafes;
+
+    vSoakHistGet(&xSoakShed, &xSoakSeq, &xShed);
+    vSoakHistGet(&xSoakDecision, &xSoakSeq, &xDecision);
+
+    printf("Soak: %lu s, %lu scenarios (%lu ended in failsafe), %lu feedback faults\n",
+           (unsigned long)(xTaskGetTickCount() / configTICK_RATE_HZ), (unsigned long)now.scenarios,
+           (unsigned long)now.failsafes, (unsigned long)now.faults);
+    printf("Latency       Count     p50     p90     p99   p99.9     Max (us)\n");
+    vSoakHistDelta(&xShed, &xShedLast, &xWindow);
+    vSoakLatencyLine("Shed", &xWindow);
+    vSoakLatencyLine("  run", &xShed);
+    vSoakHistDelta(&xDecision, &xDecisionLast, &xWindow);
+    vSoakLatencyLine("Decision", &xWindow);
+    vSoakLatencyLine("  run", &xDecision);
+    printf("Last %u min: %lu deadline misses, %lu samples dropped, %lu telemetry, %lu deferred, "
+           "%lu event log drops, %lu faults, %lu scenarios, %lu failsafes\n", (unsigned int)SOAK_SUMMARY_MIN,
+           (unsigned long)(now.misses - xLast.misses), (unsigned long)(now.dropped - xLast.dropped),
+           (unsigned long)(now.telemetry - xLast.telemetry), (unsigned long)(now.deferred - xLast.deferred),
+           (unsigned long)(now.events - xLast.events), (unsigned long)(now.faults - xLast.faults),
+           (unsigned long)(now.scenarios - xLast.scenarios), (unsigned long)(now.failsafes - xLast.failsafes));
+    printf("Run: %lu deadline misses, %lu samples dropped, %lu telemetry, %lu deferred, %lu event log drops\n",
+           (unsigned long)now.misses, (unsigned long)now.dropped, (unsigned long)now.telemetry,
+           (unsigned long)now.deferred, (unsigned long)now.events);
+
+    /* High-water marks are lowest-ever already */
+    for (i = 1; i < pxStats->count; i++) {
+        if (pxStats->task[i].stack_free < pxStats->task[least].stack_free) {
+            least = i;
+        }
+    }
+    if (pxStats->count > 0) {
+        printf("Stack: least free %u words (%s), interrupt stack %u words\n",
+               (unsigned int)pxStats->task[least].stack_free, pxStats->task[least].name,
+               (unsigned int)uxPortGetIsrStackHighWaterMark());
+    }
+#if configUSE_TLSF_HEAP
+    vPortGetHeapStats(&heap);
+    printf("Heap: lowest free %u of %u bytes, now %u, %u failed allocations\n",
+           (unsigned int)heap.xMinimumEverFreeBytes, (unsigned int)heap.xTotalBytes,
+           (unsigned int)heap.xFreeBytes, (unsigned int)heap.xFailedAllocations);
+#else
+    printf("Heap: lowest free %u bytes\n", (unsigned int)xPortGetMinimumEverFreeHeapSize());
+#endif
+    vSoakStackSizing();
+    printf("\n");
+
+    xShedLast = xShed;
+    xDecisionLast = xDecision;
+    xLast = now;
+}
+#endif
+
+/* One stream's day window so far (days counted from boot), from the run
+ * stats task with the UART held. Quantiles are bin tops, within an eighth of the distance from the
+ * stream's reference. */
+static void vStatsLine(const char *pcName, const Stats_t *pxStats, const char *pcUnit) {
+    static StatsWindow_t xWindow;      // Too large for the task stack
+
+    if (!xStatsGet(pxStats, STATS_LEVEL_DAY, 0, xTaskGetTickCount(), &xWindow)) {
+        printf("%s day %lu: no samples\n", pcName, (unsigned long)xWindow.number);
+        return;
+    }
+    printf("%s day %lu: %lu samples, min %ld mean %ld max %ld sd %lu, p0.1 %ld p1 %ld p99 %ld p99.9 %ld %s\n",
+           pcName, (unsigned long)xWindow.number, (unsigned long)xWindow.count, (long)xWindow.min, (long)lStatsMean(pxStats, &xWindow),
+           (long)xWindow.max, (unsigned long)ulStatsStddev(&xWindow), (long)lStatsQuantile(pxStats, &xWindow, 10),
+           (long)lStatsQuantile(pxStats, &xWindow, 100), (long)lStatsQuantile(pxStats, &xWindow, 9900),
+           (long)lStatsQuantile(pxStats, &xWindow, 9990), pcUnit);
+}
+
+/* Excursions and energy not served in the day window so far, from the run
+ * stats task with the UART held. Times per band are during excursions only. */
+static void vExcursionLine(void) {
+    static ExcursionWindow_t xWindow;
+
+    if (!xExcursionGet(STATS_LEVEL_DAY, 0, xTaskGetTickCount(), &xWindow)) {
+        printf("Excursions day %lu: none\n", (unsigned long)xWindow.number);
+        return;
+    }
+    printf("Excursions day %lu: bands 0-3 %lu/%lu/%lu/%lu over %lu, in %lu/%lu/%lu/%lu over %lu ms, longest %lu ms, "
+           "%lu feeders out; shed %lu load-s, %lu kWs not served\n",
+           (unsigned long)xWindow.number, (unsigned long)xWindow.events[0], (unsigned long)xWindow.events[1],
+           (unsigned long)xWindow.events[2], (unsigned long)xWindow.events[3],
+           (unsigned long)xWindow.events[EXCURSION_BAND_OVER], (unsigned long)(xWindow.band_us[0] / 1000),
+           (unsigned long)(xWindow.band_us[1] / 1000), (unsigned long)(xWindow.band_us[2] / 1000),
+           (unsigned long)(xWindow.band_us[3] / 1000), (unsigned long)(xWindow.band_us[EXCURSION_BAND_OVER] / 1000),
+           (unsigned long)xWindow.longest_ms, (unsigned long)__builtin_popcount(ulExcursionOpen()),
+           (unsigned long)(xWindow.shed_load_ms / 1000), (unsigned long)(xWindow.shed_kw_ms / 1000));
+}
+
+#if configUSE_QUEUE_COUNTERS && configQUEUE_REGISTRY_SIZE > 0
+/* Growth of a wrapping counter, held at max */
+static uint32_t ulQueueDelta(uint32_t now, uint32_t last, uint32_t max) {
+    return now - last > max ? max : now - last;
+}
+
+/* A TELEMETRY_QUEUE record for each registered kernel object, with its
+ * traffic since the one before, from the run stats task once a period */
+static void vQueueCountersPost(void) {
+    static QueueCounters_t xLast[configQUEUE_REGISTRY_SIZE];
+    QueueCounters_t counters;
+    QueueHandle_t xQueue;
+    UBaseType_t i, peak;
+
+    for (i = 0; i < configQUEUE_REGISTRY_SIZE; i++) {
+        xQueue = xQueueGetRegistryEntry(i, NULL);
+        if (xQueue == NULL) {
+            continue;
+        }
+        vQueueGetCounters(xQueue, &counters);
+        peak = uxQueueMessagesPeak(xQueue);
+        vTelemetryPost(TELEMETRY_QUEUE, (peak > 0xFF ? 0xFF : peak) << 8 | i,
+                       ulQueueDelta(counters.ulSends, xLast[i].ulSends, 0xFFFF) << 16 |
+                       ulQueueDelta(counters.ulReceives, xLast[i].ulReceives, 0xFFFF),
+                       ulQueueDelta(counters.ulBlocks, xLast[i].ulBlocks, 0xFF) << 8 |
+                       ulQueueDelta(counters.ulTimeouts, xLast[i].ulTimeouts, 0xFF));
+        xLast[i] = counters;
+    }
+}
+#endif
+
+/* Memory census of everything sized at build time: every task stack and the
+ * interrupt stack, the pools, the timer command queue and the rings */
+static void vCensusCollect(Census_t *pxCensus) {
+    static const char *const pcTelemetryClass[TELEMETRY_CLASSES] = { "Tlm events", "Tlm latency", "Tlm samples" };
+    TelemetryClassStats_t telemetry;
+    char name[CENSUS_NAME_LEN];
+    uint32_t i;
+
+    vCensusStart(pxCensus);
+    for (i = 0; i < APP_TASK_COUNT; i++) {
+        vCensusAddStack(pxCensus, xAppTasks[i].pcName, *xAppTasks[i].pxHandle, xAppTasks[i].pxStack,
+                        xAppTasks[i].usStackWords);
+    }
+    vCensusAddStack(pxCensus, "IDLE", xTaskGetIdleTaskHandle(), NULL, configMINIMAL_STACK_SIZE);
+    vCensusAddStack(pxCensus, "Tmr Svc", xTimerGetTimerDaemonTaskHandle(), NULL, configTIMER_TASK_STACK_DEPTH);
+#if configUSE_TIMER_BACKGROUND
+    vCensusAddStack(pxCensus, "Tmr Bg", xTimerGetBackgroundDaemonTaskHandle(), NULL,
+                    configTIMER_BACKGROUND_STACK_DEPTH);
+#endif
+    vCensusAdd(pxCensus, CENSUS_STACK, "ISR", pxPortIsrStackTop - configISR_STACK_SIZE, configISR_STACK_SIZE,
+               configISR_STACK_SIZE - uxPortGetIsrStackHighWaterMark(), sizeof(StackType_t));
+
+    vCensusAddPool(pxCensus, "Results", &xFreqResultPool);
+    vCensusAddPool(pxCensus, "Disturb", pxDisturbancePool());
+
+    /* Its items are private to timers.c */
+    vCensusAddQueue(pxCensus, "Tmr cmds", xTimerGetTimerQueue(), 0);
+#if configUSE_TIMER_BACKGROUND
+    vCensusAddQueue(pxCensus, "Tmr bg cmds", xTimerGetBackgroundQueue(), 0);
+#endif
+
+    for (i = 0; i < FREQ_CHANNELS; i++) {
+        pcTextUint(pcTextStr(name, "Samples "), i);
+        vCensusAdd(pxCensus, CENSUS_RING, name, (const void *)gFreqChannel[i].ring.count, FREQ_RING_SIZE,
+                   gFreqChannel[i].ring.high_water, sizeof(uint32_t) * 2);
+    }
+    for (i = 0; i < TELEMETRY_CLASSES; i++) {
+        vTelemetryClassStats(i, &telemetry);
+        vCensusAdd(pxCensus, CENSUS_RING, pcTelemetryClass[i], NULL, telemetry.size, telemetry.high_water,
+                   sizeof(TelemetryRecord_t));
+    }
+    vCensusAdd(pxCensus, CENSUS_RING, "Event log", NULL, EVENT_LOG_RING_SIZE, ulEventLogHighWater(),
+               sizeof(EventRecord_t));
+}
+
+/* Run Time Statistics Task: samples every task's CPU share, stack
+ * high-water mark and switch count once per period, publishes them and the
+ * memory census for the VGA pages and prints them, with the interrupt
+ * timing and heap statistics, on the JTAG UART; the census itself when
+ * asked for from the keyboard.
+ * Runs below everything else, so it only ever takes time the system would
+ * otherwise spend idle. */
+static void vRunStatsTask(void *pvParameters) {
+    static RunStats_t stats;
+    static Census_t census;
+    IrqStats_t irq;
+#if configUSE_TLSF_HEAP
+    static const char *const pcHeapRegions[heapREGIONS] = { "fast", "SRAM", "bulk" };
+    HeapStats_t heap;
+#endif
+    PeriodStats_t period;
+    char phase[11];
+    IdleJobStats_t job;
+    TelemetryClassStats_t events, latency, samples;
+    ModbusStats_t modbus;
+    FwUpdateStatus_t fw;
+    WarmState_t warm;
+#if configUSE_BUDGET_SERVER
+    BudgetServerStats_t budget;
+#endif
+#if FREQ_ETHERNET
+    EthStats_t eth;
+#endif
+#if FREQ_COORD
+    CoordStats_t coord;
+    TimeSyncStats_t sync;
+#endif
+#if FREQ_DEADLINE_TIMER
+    DeadlineStats_t deadline;
+#endif
+#if FREQ_IRQ_LATENCY
+    IrqLatencyStats_t irq_latency;
+    uint32_t bin_latency;
+#endif
+#if !FREQ_COMTRADE_EXPORT
+    const DisturbRecord_t *pxDisturbance;
+#endif
+#if FREQ_RELAY_TIMING
+    WcetStats_t wcet;
+    uint32_t bin;
+#endif
+#if FREQ_PERF_COUNTER
+    PerfReport_t perf;
+#endif
+#if FREQ_INTEGRITY
+    IntegrityStats_t integrity;
+#endif
+#if FREQ_ACTUATION_LIMIT
+    LimiterStats_t limiter;
+#endif
+    UBaseType_t i;
+#if FREQ_RELAY_SOAK
+    uint32_t soak_periods = 0;
+#endif
+#if FREQ_RATE_SWEEP
+    uint32_t sweep_periods = 0;
+#endif
+
+    vStdoutStatic(cRunStatsStdout);
+
+    /* Starts the first interval */
+    vRunStatsSample(NULL);
+#if FREQ_RATE_SWEEP
+    xTimerPendFunctionCall(vSweepStepDeferred, NULL, 0, portMAX_DELAY);
+#endif
 
     for (;;) {
-        /* Wait for the next cycle */
-        vTaskDelayUntil(&xLastWakeTime, pdMS_TO_TICKS(VGA_DISPLAY_PERIOD_MS));
+        vPeriodWait(&xRunStatsPeriod);
+
+        vRunStatsSample(&stats);
+        vCensusCollect(&census);
+        vCensusPublish(&census);
+#if configUSE_QUEUE_COUNTERS && configQUEUE_REGISTRY_SIZE > 0
+        vQueueCountersPost();
+#endif
+#if FREQ_RELAY_SOAK
+        /* A soak run is left for hours: report only with each summary */
+        if (++soak_periods < SOAK_SUMMARY_PERIODS) {
+            continue;
+        }
+        soak_periods = 0;
+#endif
+#if FREQ_RATE_SWEEP
+        /* One line a step in place of the report, until the sweep ends */
+        if (ulSweepStep < SWEEP_STEPS) {
+            if (++sweep_periods >= SWEEP_STEP_PERIODS) {
+                sweep_periods = 0;
+                xTelemetryUartTake(portMAX_DELAY);
+                vSweepReport();
+                vTelemetryUartGive();
+            }
+            continue;
+        }
+#endif
+
+        /* The telemetry drain shares the UART */
+        xTelemetryUartTake(portMAX_DELAY);
+#if FREQ_RELAY_SOAK
+        vSoakSummary(&stats);
+#endif
+        printf("Task     Pri  CPU%%   Stack  Switches (total)  Inherits (peak)\n");
+        for (i = 0; i < stats.count; i++) {
+            printf("%-8s %3u%c %3u.%u %7u %9lu (%lu) %9lu (%u)\n", stats.task[i].name,
+                   (unsigned int)stats.task[i].priority, stats.task[i].inherited ? '*' : ' ',
+                   stats.task[i].cpu_permille / 10, stats.task[i].cpu_permille % 10,
+                   stats.task[i].stack_free,
+                   (unsigned long)stats.task[i].switches, (unsigned long)stats.task[i].switches_total,
+                   (unsigned long)stats.task[i].inherits, (unsigned int)stats.task[i].peak_priority);
+        }
+        printf("%lu switches in %lu ms\n", (unsigned long)stats.switches,
+               (unsigned long)(stats.interval_us / 1000));
+
+        /* Time spent at interrupt level, in timestamp counts */
+        for (i = 0; i < sizeof(xTimedIrqs) / sizeof(xTimedIrqs[0]); i++) {
+            vIrqGetStats(xTimedIrqs[i].irq, &irq);
+            printf("IRQ %-6s %9lu runs, max %5lu last %5lu counts (%lu us)\n", xTimedIrqs[i].name,
+                   (unsigned long)irq.count, (unsigned long)irq.max_cycles, (unsigned long)irq.last_cycles,
+                   (unsigned long)ulLatencyElapsedUs(0, irq.max_cycles));
+        }
+#if FREQ_IRQ_LATENCY
+        /* From the timer's edge to the handler, in doublings from 1 us */
+        vIrqLatencyGetStats(&irq_latency);
+        printf("IRQ latency %lu edges, min %lu max %lu mean %lu ns, %lu over %u us\n ",
+               (unsigned long)irq_latency.count, (unsigned long)irq_latency.min_ns,
+               (unsigned long)irq_latency.max_ns,
+               (unsigned long)(irq_latency.count ? irq_latency.total_ns / irq_latency.count : 0),
+               (unsigned long)irq_latency.over_limit, (unsigned int)IRQ_LATENCY_LIMIT_US);
+        for (bin_latency = 0; bin_latency < IRQ_LATENCY_BINS; bin_latency++) {
+            printf(" %lu", (unsigned long)irq_latency.hist[bin_latency]);
+        }
+        printf("\n");
+#endif
+#if FREQ_DEADLINE_TIMER
+        vDeadlineGetStats(&deadline);
+        printf("Deadlines %lu run, late max %lu last %lu us, %lu armed past due\n",
+               (unsigned long)deadline.fired, (unsigned long)deadline.late_max_us,
+               (unsigned long)deadline.late_last_us, (unsigned long)deadline.past);
+#endif
+#if FREQ_RELAY_TIMING
+        /* Probes, in timestamp counts, with the inputs of the longest run
+         * and a histogram from under 256 counts in doublings */
+        printf("WCET          Runs      Min      Max     Mean  Worst input\n");
+        for (i = 0; i < WCET_PROBES; i++) {
+            vWcetGetStats(i, &wcet);
+            printf("%-9s %9lu %8lu %8lu %8lu  0x%08lx 0x%08lx\n ", pcWcetName(i),
+                   (unsigned long)wcet.runs, (unsigned long)wcet.min_cycles, (unsigned long)wcet.max_cycles,
+                   (unsigned long)(wcet.runs ? wcet.total_cycles / wcet.runs : 0),
+                   (unsigned long)wcet.worst_a, (unsigned long)wcet.worst_b);
+            for (bin = 0; bin < WCET_HIST_BINS; bin++) {
+                printf(" %lu", (unsigned long)wcet.hist[bin]);
+            }
+            printf("\n");
+        }
+        vRtaReport();
+#endif
+#if FREQ_PERF_COUNTER
+        /* Hardware section counts since boot or the last W, in CPU cycles */
+        vPerfRead(&perf);
+        printf("Section      Starts   Total ms  Mean cycles  Share\n");
+        for (i = 0; i < PERF_SECTIONS; i++) {
+            printf("%-9s %9lu %10lu %12lu %4lu.%lu%%\n", pcPerfName(i + 1), (unsigned long)perf.starts[i],
+                   (unsigned long)(perf.cycles[i] / (ALT_CPU_FREQ / 1000)),
+                   (unsigned long)(perf.starts[i] ? perf.cycles[i] / perf.starts[i] : 0),
+                   (unsigned long)(perf.total_cycles ? perf.cycles[i] * 1000 / perf.total_cycles / 10 : 0),
+                   (unsigned long)(perf.total_cycles ? perf.cycles[i] * 1000 / perf.total_cycles % 10 : 0));
+        }
+#endif
+        /* Periods held, worst case since boot */
+        printf("Period   ms  +ms     Jobs  Misses Skipped  Jitter*  Exec max  last (us)\n");
+        for (i = 0; i < ulPeriodCount(); i++) {
+            vPeriodGetStats(i, &period);
+            if (period.flags & PERIOD_EVENT) {
+                pcTextStr(phase, "-");
+            } else {
+                pcTextUint(phase, period.offset_ms);
+            }
+            printf("%-8s %4lu %4s %8lu %7lu %7lu %8lu%c %9lu %5lu\n", period.pcName,
+                   (unsigned long)(period.period_us / 1000), phase, (unsigned long)period.jobs,
+                   (unsigned long)period.misses, (unsigned long)period.skipped,
+                   (unsigned long)period.jitter_max_us, (period.flags & PERIOD_EVENT) ? 'w' : ' ',
+                   (unsigned long)period.exec_max_us, (unsigned long)period.exec_last_us);
+        }
+        printf("* w: longest wait for an event-driven task\n");
+        printf("Boot: control path ready %lu us, first decision %lu us after main\n",
+               (unsigned long)xBoot.ready_us, (unsigned long)xBoot.protect_us);
+        for (i = 0; i < FREQ_CHANNELS; i++) {
+            printf("Sample ring %u: %lu dropped, high water %lu of %u (%s)\n", (unsigned int)i,
+                   (unsigned long)gFreqChannel[i].ring.dropped, (unsigned long)gFreqChannel[i].ring.high_water,
+                   (unsigned int)FREQ_RING_SIZE, FREQ_RING_POLICY == FREQ_RING_DROP_OLDEST ? "drop oldest" :
+                   FREQ_RING_POLICY == FREQ_RING_COALESCE ? "coalesce" : "drop newest");
+        }
+#if FREQ_FAULT_INJECT
+        printf("Faults injected, setting/times acted:");
+        for (i = 0; i < FAULT_KINDS; i++) {
+            printf(" %s %u/%lu", pcFaultName(i), (unsigned int)usFaultGet(i), (unsigned long)ulFaultCount(i));
+        }
+        printf("\n");
+#endif
+        printf("Deferred calls dropped: %lu, interrupt stack %u of %u words free\n",
+               (unsigned long)ulIrqDeferDropped(), (unsigned int)uxPortGetIsrStackHighWaterMark(),
+               (unsigned int)configISR_STACK_SIZE);
+        for (i = 0; i < ulIdleJobCount(); i++) {
+            vIdleJobGetStats(i, &job);
+            printf("Idle job %-6s %9lu runs, max %5lu us\n", job.pcName,
+                   (unsigned long)job.runs, (unsigned long)job.max_us);
+        }
+
+#if configUSE_TLSF_HEAP
+        for (i = 0; i < heapREGIONS; i++) {
+            vPortGetHeapRegionStats(i, &heap);
+            if (heap.xTotalBytes == 0) {
+                continue;
+            }
+            printf("Heap %-4s %u of %u bytes free (peak use %u), largest %u, %u fragments (%u.%u%%), %u failed\n",
+                   pcHeapRegions[i], (unsigned int)heap.xFreeBytes, (unsigned int)heap.xTotalBytes,
+                   (unsigned int)(heap.xTotalBytes - heap.xMinimumEverFreeBytes),
+                   (unsigned int)heap.xLargestFreeBlock, (unsigned int)heap.xFreeBlocks,
+                   (unsigned int)(heap.ulFragmentationPermille / 10), (unsigned int)(heap.ulFragmentationPermille % 10),
+                   (unsigned int)heap.xFailedAllocations);
+        }
+#endif
+#if configUSE_HEAP_TRACE
+        printf("Heap trace: %lu allocations, %lu since the scheduler started\n",
+               (unsigned long)ulHeapTraceAllocations(), (unsigned long)ulHeapTraceLateAllocations());
+#endif
+#if FREQ_HEAP_FREEZE
+        printf("Heap frozen: %lu allocations refused\n", (unsigned long)xPortGetRefusedAllocations());
+#endif
+        vTelemetryClassStats(TELEMETRY_CLASS_EVENT, &events);
+        vTelemetryClassStats(TELEMETRY_CLASS_LATENCY, &latency);
+        vTelemetryClassStats(TELEMETRY_CLASS_SAMPLE, &samples);
+        printf("Telemetry: %lu records sent, %lu dropped (%lu events, %lu latency, %lu samples, %lu of them "
+               "thinned); %lu UART bytes dropped without a host\n",
+               (unsigned long)ulTelemetrySent(), (unsigned long)ulTelemetryDropped(), (unsigned long)events.dropped,
+               (unsigned long)latency.dropped, (unsigned long)samples.dropped, (unsigned long)samples.thinned,
+               (unsigned long)ulJtagUartDropped());
+        printf("Telemetry compression: %lu of %lu feeder 0 samples, %lu of %lu decisions sent\n",
+               (unsigned long)xFreqSwing[0].breakpoints, (unsigned long)xFreqSwing[0].samples,
+               (unsigned long)xDecisionSwing.breakpoints, (unsigned long)xDecisionSwing.samples);
+        printf("Event log: %lu events written, %lu dropped; %lu config saves\n",
+               (unsigned long)ulEventLogWritten(), (unsigned long)ulEventLogDropped(),
+               (unsigned long)ulConfigSaves());
+#if FREQ_INTEGRITY
+        vIntegrityGetStats(&integrity);
+        printf("Integrity: %lu regions, %lu bytes a cycle; %lu cycles, %lu late, last %lu ms, longest %lu ms; "
+               "%lu rebased, failed 0x%lx\n", (unsigned long)integrity.regions, (unsigned long)integrity.bytes,
+               (unsigned long)integrity.cycles, (unsigned long)integrity.late, (unsigned long)integrity.last_ms,
+               (unsigned long)integrity.longest_ms, (unsigned long)integrity.rebased,
+               (unsigned long)integrity.failed);
+#endif
+#if FREQ_ACTUATION_LIMIT
+        vLoadLimiterGetStats(&limiter);
+        printf("Actuation limit: %lu changes passed; held %lu on, %lu off, %lu by rate; %lu absorbed, "
+               "0x%04x pending\n", (unsigned long)limiter.passed, (unsigned long)limiter.held_on,
+               (unsigned long)limiter.held_off, (unsigned long)limiter.rate, (unsigned long)limiter.absorbed,
+               (unsigned int)usLoadPortBits(limiter.pending, 0));
+#endif
+        vFwUpdateGetStatus(&fw);
+        printf("Firmware: bank %u, update state %u, %lu of %lu bytes programmed; %lu verified, %lu errors\n",
+               (unsigned)fw.running_bank, (unsigned)fw.state, (unsigned long)fw.programmed,
+               (unsigned long)fw.length, (unsigned long)fw.updates, (unsigned long)fw.errors);
+        vWarmStateGet(&warm);
+        printf("Warm restarts: %lu since power-up; %lu sheds, %lu reconnections, longest shed %lu us\n",
+               (unsigned long)warm.warm_boots, (unsigned long)warm.sheds, (unsigned long)warm.reconnects,
+               (unsigned long)warm.shed_max_us);
+        printf("Disturbances: %lu recorded, %lu dropped; %lu exported\n",
+               (unsigned long)ulDisturbanceRecorded(), (unsigned long)ulDisturbanceDropped(),
+#if FREQ_COMTRADE_EXPORT
+               (unsigned long)ulComtradeExported());
+#else
+               0UL);
+#endif
+        printf("Historian: %lu samples in %lu bytes, oldest %lu s after boot\n",
+               (unsigned long)ulHistorianSamples(), (unsigned long)ulHistorianBytes(),
+               (unsigned long)(ullHistorianOldestUs() / 1000000));
+#if configUSE_BUDGET_SERVER
+        vBudgetServerGetStats(&budget);
+        printf("Budget server: %lu us per %lu ms for %lu tasks, %lu us left; %lu throttles, %lu ms held off, "
+               "worst overrun %lu us\n",
+               (unsigned long)budget.budget_us, (unsigned long)budget.period_ms, (unsigned long)budget.members,
+               (unsigned long)budget.remaining_us, (unsigned long)budget.throttles,
+               (unsigned long)budget.throttled_ms, (unsigned long)budget.overrun_max_us);
+#endif
+        vStatsLine("Frequency", &gFreqStats[0], "mHz");
+        vStatsLine("Shed latency", &gShedStats, "us");
+        vExcursionLine();
+        vModbusGetStats(&modbus);
+        printf("Modbus: %lu requests, %lu exceptions; %lu CRC errors, %lu line errors, %lu for other slaves\n",
+               (unsigned long)modbus.requests, (unsigned long)modbus.exceptions,
+               (unsigned long)modbus.crc_errors, (unsigned long)modbus.line_errors,
+               (unsigned long)modbus.other_slaves);
+#if FREQ_ETHERNET
+        vEthGetStats(&eth);
+        printf("Eth: link %u Mb/s, host %s; %lu received, %lu sent, %lu Modbus; %lu errors, %lu dropped, "
+               "%lu not sent, %lu no buffer, %lu to no port\n",
+               (unsigned)eth.link_mbps, eth.host_known ? "known" : "unknown",
+               (unsigned long)eth.rx_frames, (unsigned long)eth.tx_frames, (unsigned long)modbus.udp_requests,
+               (unsigned long)eth.rx_errors, (unsigned long)eth.rx_dropped, (unsigned long)eth.tx_dropped,
+               (unsigned long)eth.no_buffer, (unsigned long)eth.no_port);
+#endif
+#if FREQ_COORD
+        vCoordGetStats(&coord);
+        printf("Coord: %lu frames, %lu forwarded, %lu dropped; %lu CRC errors, %lu line errors, %lu lost; "
+               "ring %lu us (max %lu), %lu kW asked\n",
+               (unsigned long)coord.frames, (unsigned long)coord.forwarded, (unsigned long)coord.dropped,
+               (unsigned long)coord.crc_errors, (unsigned long)coord.line_errors, (unsigned long)coord.lost,
+               (unsigned long)coord.round_trip_us, (unsigned long)coord.round_trip_max_us,
+               (unsigned long)coord.assigned_kw);
+        vTimeSyncGetStats(&sync);
+        printf("Time sync: %s, error %ld us, rate %ld ppb, link %lu us; %lu samples, %lu steps, %lu outliers\n",
+               sync.locked ? "locked" : COORD_NODE == COORD_LEADER ? "leader" : "unlocked",
+               (long)sync.error_us, (long)sync.rate_ppb, (unsigned long)coord.link_us,
+               (unsigned long)sync.samples, (unsigned long)sync.steps, (unsigned long)sync.outliers);
+#endif
+        if (xCensusDumpPending) {
+            xCensusDumpPending = 0;
+            printf("Memory census:\n");
+            vCensusPrint(&census);
+        }
+#if configUSE_HEAP_TRACE
+        if (xHeapTraceDumpPending) {
+            xHeapTraceDumpPending = 0;
+            vHeapTracePrint();
+        }
+#endif
+        printf("\n");
+        fflush(stdout);
+        vTelemetryUartGive();
+
+#if FREQ_RELAY_PROFILE
+        if (xProfileDumpPending) {
+            xProfileDumpPending = 0;
+            vProfileDump();
+        }
+#endif
+#if configUSE_KERNEL_TRACE
+        if (xKernelTraceFrozen()) {
+            vKernelTraceDump();
+        }
+#endif
+#if FREQ_JOURNAL
+        if (xJournalFrozen()) {
+            vJournalDump();
+        }
+#endif
+#if !FREQ_COMTRADE_EXPORT
+        while ((pxDisturbance = pxDisturbanceTake()) != NULL) {
+            vDisturbanceDump(pxDisturbance);
+            vDisturbanceRelease(pxDisturbance);
+        }
+#endif
+    }
+}
+
+#if configUSE_BUDGET_SERVER
+/* Put the tasks below the control path under the budget. The background
+ * daemon is only created with the scheduler, so this runs from a task. */
+static void vBudgetServerStart(void) {
+    if (xBudgetServerInit(BUDGET_SERVER_US, BUDGET_SERVER_PERIOD_MS) != 0) {
+        return;
+    }
+#if !FREQ_UI_COROUTINES
+#if !FREQ_HEADLESS
+    (void)xBudgetServerAdd(xVGADisplayTask);
+#endif
+    (void)xBudgetServerAdd(xThresholdEditTask);
+#endif
+    (void)xBudgetServerAdd(xRunStatsTask);
+    (void)xBudgetServerAdd(xFlashTask);
+#if configUSE_TIMER_BACKGROUND
+    (void)xBudgetServerAdd(xTimerGetBackgroundDaemonTaskHandle());
+#endif
+}
+#endif
+
+/* Boot work nothing on the control path needs: the event log scan (and
+ * the erase of a blank log) and the banner over the JTAG UART. Events
+ * posted before the log is open wait in its ring. The last allocation the
+ * relay makes is here, and with FREQ_HEAP_FREEZE the heap closes after it. */
+static void vBootDeferred(void) {
+    char nominal_text[12], tolerance_text[12];
+    WarmState_t warm;
+    int i;
+
+#if configUSE_BUDGET_SERVER
+    vBudgetServerStart();
+#endif
+
+    /* The telemetry drain shares the UART, and the log reports its state */
+    xTelemetryUartTake(portMAX_DELAY);
+    if (xJtagUartInit() != 0) {
+        printf("JTAG UART: cannot take over the device, writers wait in the BSP driver\n");
+    }
+    xEventLogInit();
 
-        /* Copy latest frequency data */
-        if (xSemaphoreTake(xConfigRegsMutex, portMAX_DELAY) == pdTRUE) {
-            freq_history[oldest_idx] = gFrequencyData.current_freq;
-            dfreq_history[oldest_idx] = gFrequencyData.roc;
-            xSemaphoreGive(xConfigRegsMutex);
+    printf("Load Management System Starting...\n");
+    pcTextFix16(nominal_text, NOMINAL_FREQ_Q16, 1);
+    pcTextFix16(tolerance_text, FREQ_TOLERANCE_Q16, 1);
+    printf("Nominal Frequency: %s Hz (± %s Hz)\n", nominal_text, tolerance_text);
+    printf("Task     Pri  Period ms  Stack words\n");
+    printf("%-8s %3s  %9s  %11d\n", "ISR", "-", "-", (int)configISR_STACK_SIZE);
+    printf("%-8s %3d  %9s  %11d\n", "Tmr Svc", (int)configTIMER_TASK_PRIORITY, "-",
+           (int)configTIMER_TASK_STACK_DEPTH);
+#if configUSE_TIMER_BACKGROUND
+    printf("%-8s %3d  %9d  %11d\n", "Tmr Bg", (int)configTIMER_BACKGROUND_PRIORITY, TELEMETRY_PERIOD_MS,
+           (int)configTIMER_BACKGROUND_STACK_DEPTH);
+#endif
+#if FREQ_UI_COROUTINES
+    printf("%-8s %3d  %9s  %11d\n", "IDLE+UI", (int)tskIDLE_PRIORITY, "-", (int)configMINIMAL_STACK_SIZE);
+#endif
+    for (i = 0; i < APP_TASK_COUNT; i++) {
+        printf("%-8s %3d  %9d  %11d\n", xAppTasks[i].pcName, (int)xAppTasks[i].uxPriority,
+               xAppTasks[i].usPeriodMs, xAppTasks[i].usStackWords);
+    }
+    printf("Heap free at boot: %u bytes\n", (unsigned int)xPortGetFreeHeapSize());
+    printf("Boot: control path ready %lu us after main\n", (unsigned long)xBoot.ready_us);
+    vWarmStateGet(&warm);
+    if (warm.warm_boots != 0) {
+        printf("Boot: warm restart %lu since power-up, loads and latches carried over\n",
+               (unsigned long)warm.warm_boots);
+    }
+#if FREQ_HEAP_FREEZE
+    /* Everything is made: from here on the relay does not allocate */
+    vPortHeapFreeze();
+    printf("Heap frozen: %u bytes free\n", (unsigned int)xPortGetFreeHeapSize());
+#endif
+    fflush(stdout);
+    vTelemetryUartGive();
+}
+
+/* Flash Task: moves queued events into flash pages, saves edited
+ * configuration and writes firmware updates to the spare bank. Every flash program and sector erase after boot happens
+ * here, one at a time and below every control task. Starts with the
+ * deferred part of the boot. */
+static void vFlashTask(void *pvParameters) {
+    vStdoutStatic(cFlashStdout);
+    vBootDeferred();
+    for (;;) {
+        vPeriodWait(&xFlashPeriod);
+        vEventLogService();
+        vConfigService();
+        vFwUpdateService();
+    }
+}
 
-            /* Move to next position in circular buffer */
-            oldest_idx = (oldest_idx + 1) % 100;
+/* Empties the telemetry ring into the JTAG UART without ever waiting on
+ * it - runs in the background timer daemon, so a full ring never delays a
+ * control timer. Whatever the UART cannot take stays for the next period. */
+static void vTelemetryTimerCallback(TimerHandle_t xTimer) {
+    vPeriodStart(&xTelemetryPeriod);
+    ulTelemetryDrain();
+    vPeriodEnd(&xTelemetryPeriod);
+}
+
+/* Watchdog Task: every control task wakes at least once per its period, so
+ * a heartbeat missing for a whole supervision period is a task that has
+ * stopped. Latch failsafe here; if this task stops as well the tick hook
+ * does it instead. */
+static void vWatchdogTask(void *pvParameters) {
+    EventBits_t missing;
+
+    for (;;) {
+        missing = xWatchdogSupervise(pdMS_TO_TICKS(WATCHDOG_PERIOD_MS));
+        WCET_BEGIN(WCET_WATCHDOG);
+        ucHealthWatchdog = missing != 0;
+        if (missing == 0 || ulFailsafeLatched()) {
+            WCET_END(WCET_WATCHDOG, missing, 0);
+            continue;
         }
 
-        /* Draw the frequency and RoC plots */
-        vDrawFrequencyPlot(freq_history, dfreq_history, oldest_idx);
+        xFailsafeTrip(EVENT_SOURCE_WATCHDOG, missing);
+
+        /* A stopped monitor would never report it */
+        if (missing & WATCHDOG_BEAT_MONITOR) {
+            vFailsafeReport();
+        }
+        WCET_END(WCET_WATCHDOG, missing, 0);
+    }
+}
+
+#if FREQ_MODE_PROFILES
+/* What runs in one system state. The protection path, the watchdog, the
+ * event log collection (flash task), the telemetry records, Modbus and
+ * the keyboard are in every profile. */
+typedef struct {
+    uint8_t display;                   // VGA period multiple, 0 stopped
+    uint8_t run_stats;                 // Statistics report period multiple, 0 stopped
+    uint8_t exports;                   // Telemetry exports (COMTRADE files) sent
+} ModeProfile_t;
+
+static const ModeProfile_t xModeProfiles[STATUS_FAILSAFE + 1] = {
+    [STATUS_NORMAL]   = { 1, 1, 1 },
+    [STATUS_ALERT]    = { 5, 5, 0 },  // A frame a second, a report every 10 s
+    [STATUS_FAILSAFE] = { 0, 0, 0 },
+};
+
+/* Switch the task set to a state's profile. A few stores: each task takes
+ * its new period at its next release, a stopped one sleeps there. */
+static void vModeChange(uint8_t state) {
+    static uint8_t current = STATUS_NORMAL;
+    const ModeProfile_t *pxProfile = &xModeProfiles[state];
+
+    if (state == current) {
+        return;
+    }
+    current = state;
+#if !FREQ_HEADLESS
+    vPeriodScale(&xVGAPeriod, pxProfile->display);
+#endif
+    vPeriodScale(&xRunStatsPeriod, pxProfile->run_stats);
+    vTelemetryPauseExports(!pxProfile->exports);
+    vLogPost(LOG_MODE, state, pxProfile->display | pxProfile->run_stats << 8 | pxProfile->exports << 16);
+}
+#endif
+
+/* Show the state flags on the red LEDs and in the telemetry, and give the
+ * state its task set */
+static void vShowState(EventBits_t flags) {
+    uint8_t state = ucStateLevel(flags);
+
+    WCET_BEGIN(WCET_STATE);
+#if FREQ_MODE_PROFILES
+    vModeChange(state);
+#endif
+    vTelemetryPost(TELEMETRY_STATE, state, flags, 0);
+    vSevenSegState(state);
+
+    if (state == STATUS_NORMAL) {
+        vBoardStatusLeds(0x0000); // All off
+    } else if (state == STATUS_ALERT) {
+        vBoardStatusLeds(0x5555); // Pattern
+    } else {
+        vBoardStatusLeds(0xFFFF); // All on
+    }
+    WCET_END(WCET_STATE, flags, state);
+}
+
+/* Character LCD lines, rewritten from the LCD idle job: the frequency and
+ * RoC of the feeder on the VGA display, then the state and the loads */
+static void vLcdRefresh(void) {
+    static uint32_t status_seen = 0;   // Version of the status text shown
+    char line[LCD_COLS + 1];
+    char *p;
+    FreqResult_t freq;
+    LoadDecision_t load_decision;
+    StatusValues_t values;
+    StatusText_t status;
+
+    ulBusLatest(&xFreqTopic, &freq);
+    vSeqRead(&gLoad.lock, &load_decision, &gLoad.decision, sizeof(LoadDecision_t));
+    vStatusValues(&values, &freq.channel[xEditChannel], ucStateLevel(xStateGet()), load_decision.load_status);
+    (void)ulStatusTextUpdate(&values);
+    if (!xStatusTextGet(&status, &status_seen)) {
+        return;
+    }
+
+    p = pcTextStr(line, status.freq);
+    p = pcTextStr(p, "Hz ");
+    p = pcTextStr(p, status.roc_short);
+    pcTextStr(p, "/s");
+    vLcdPut(0, 0, line, LCD_COLS);
+
+    p = pcTextStr(line, status.pcState);
+    p = pcTextStr(p, " L ");
+    pcTextStr(p, status.loads);
+    vLcdPut(0, 1, line, LCD_COLS);
+}
+
+#if !FREQ_UI_COROUTINES
+/* System State Task: shows each state change as soon as it is made, from
+ * whichever task or ISR made it */
+static void vSystemStateTask(void *pvParameters) {
+    for (;;) {
+        vShowState(xStateWaitChange(portMAX_DELAY));
+    }
+}
+#else
+/* State co-routine: the idle task cannot wait on the event group, so the
+ * flags are compared within the state task's deadline */
+static void vStateCoRoutine(CoRoutineHandle_t xHandle, UBaseType_t uxIndex) {
+    static EventBits_t shown = 0xFF;  // None yet
+    EventBits_t flags;
+
+    crSTART(xHandle);
+    for (;;) {
+        crDELAY(xHandle, pdMS_TO_TICKS(SYSTEM_STATE_DEADLINE_MS));
+        flags = xStateGet();
+        if (flags != shown) {
+            shown = flags;
+            vShowState(flags);
+        }
+    }
+    crEND();
+}
+
+/* Idle job: one pass over the UI co-routines, unless the benchmarks have
+ * them stopped. They delay themselves, so there is never more to do. */
+static int xUiCoRoutineJob(void) {
+    int i;
+
+    if (xUiPaused) {
+        return 0;
+    }
+    xUiBusy = 1;
+    for (i = 0; i < UI_COROUTINES; i++) {
+        vCoRoutineSchedule();
+    }
+    xUiBusy = 0;
+    return 0;
+}
+#endif
+
+#if configCHECK_FOR_STACK_OVERFLOW == 3
+/* Runs in the background timer daemon: the hook prints, too deep for the
+ * idle stack and too slow for the control daemon */
+static void vStackReportDeferred(void *pvTask, uint32_t ulIndex) {
+    vRunStatsStackOverflow((TaskHandle_t)pvTask, xAppTasks[ulIndex].pcName);
+}
+
+/* Idle job: the guard words at the end of one static application stack
+ * per call, so an overflow is seen well before the next run statistics
+ * sample (which covers the kernel's own tasks as well) */
+static int xStackScanJob(void) {
+    static uint32_t next = 0, reported = 0;
+    const AppTask_t *pxTask = &xAppTasks[next];
+    uint32_t i, index = next;
+
+    next = (next + 1) % APP_TASK_COUNT;
+    if (pxTask->pxStack == NULL || *pxTask->pxHandle == NULL || (reported & (1UL << index))) {
+        return 0;
+    }
+    for (i = 0; i < RUN_STATS_STACK_GUARD; i++) {
+        if (pxTask->pxStack[i] != STACK_FILL_WORD) {
+            if (xTimerPendFunctionCallBackground(vStackReportDeferred, *pxTask->pxHandle, index, 0) == pdPASS) {
+                reported |= 1UL << index;
+            }
+            break;
+        }
+    }
+    return 0;
+}
+#endif
+
+#if configUSE_NEWLIB_REENTRANT == 2
+/* Runs in the background timer daemon, queued by main ahead of anything it
+ * prints. The control daemon never prints and keeps the global context. */
+static void vDaemonReentDeferred(void *pvReent, uint32_t ulUnused) {
+    vTaskSetNewlibReent(NULL, (struct _reent *)pvReent);
+    vStdoutStatic(cDaemonStdout);
+}
+#endif
+
+/* Idle hook: the background jobs, see idle_jobs.h */
+void vApplicationIdleHook(void) {
+    vIdleJobsRun();
+}
+
+#if FREQ_RELAY_BENCH
+/*-----------------------------------------------------------*/
+/* Benchmarks, see bench.h. Times are timestamp counts. */
+
+typedef struct {
+    FreqEstimator_t estimator;
+    FrequencyData_t data;
+    uint32_t next;
+    uint32_t counts[BENCH_TRACE_COUNTS];  // Analyser counts from BENCH_TRACE
+} BenchAnalyzer_t;
+
+typedef struct {
+    FreqResult_t result;
+    LoadDecision_t decision;
+} BenchDecision_t;
+
+/* Static, too large for the benchmark stack */
+static BenchAnalyzer_t xBenchAnalyzer;
+static HistoryColumn_t xBenchColumns[PLOT_HISTORY];
+static QueueHandle_t xBenchQueue;
+static SemaphoreHandle_t xBenchMutex;
+static uint32_t ulBenchLine = 0;
+
+static void vBenchAnalyzerInit(BenchAnalyzer_t *pxBench) {
+    const TraceScenario_t *pxScenario = pxTraceScenarioFind(BENCH_TRACE);
+    TraceGen_t gen;
+    uint32_t i;
+
+    if (pxScenario == NULL) {
+        pxScenario = &xTraceScenarios[0];
+    }
+    vTraceGenStart(&gen, pxScenario, (uint32_t)SAMPLING_FREQ, 1);
+    for (i = 0; i < BENCH_TRACE_COUNTS; i++) {
+        if (!xTraceGenNext(&gen, &pxBench->counts[i])) {
+            vTraceGenStart(&gen, pxScenario, (uint32_t)SAMPLING_FREQ, 1);
+            xTraceGenNext(&gen, &pxBench->counts[i]);
+        }
+    }
+
+    vFreqEstInit(&pxBench->estimator, FREQ_EST_WINDOW, SAMPLING_FREQ_Q16,
+                 FIX16_CONST(VALID_FREQ_MIN), FIX16_CONST(VALID_FREQ_MAX));
+    vFreqEstTable(&pxBench->estimator, xFreqCountTable, FREQ_TABLE_FIRST);
+    memset(&pxBench->data, 0, sizeof(FrequencyData_t));
+    pxBench->data.current_freq = NOMINAL_FREQ_Q16;
+    pxBench->data.upper_limit = NOMINAL_FREQ_Q16 + FREQ_TOLERANCE_Q16;
+    pxBench->data.lower_limit = NOMINAL_FREQ_Q16 - FREQ_TOLERANCE_Q16;
+    pxBench->next = 0;
+}
+
+/* The estimator on its own */
+static void vBenchEstimate(void *pvContext) {
+    BenchAnalyzer_t *pxBench = (BenchAnalyzer_t *)pvContext;
+    fix16_t freq, roc;
+
+    xFreqEstAdd(&pxBench->estimator, pxBench->counts[pxBench->next++ & (BENCH_TRACE_COUNTS - 1)], &freq, &roc);
+}
+
+/* Everything the analyzer task does per count */
+static void vBenchAnalyzeSample(void *pvContext) {
+    BenchAnalyzer_t *pxBench = (BenchAnalyzer_t *)pvContext;
+
+    xAnalyzeSample(&pxBench->estimator, pxBench->counts[pxBench->next++ & (BENCH_TRACE_COUNTS - 1)],
+                   &pxBench->data, MAX_FREQ_ROC_Q16, 0);
+}
+
+/* A deep unstable dip with every load connected, so each call looks up the
+ * policy, sheds one load and writes the outputs - the shed latency path */
+static void vBenchDecision(void *pvContext) {
+    BenchDecision_t *pxBench = (BenchDecision_t *)pvContext;
+
+    pxBench->decision.requested_status = BENCH_LOADS;
+    pxBench->decision.load_status = BENCH_LOADS;
+    pxBench->result.channel[pxBench->result.newest].stamp.capture = ulLatencyNow();
+    vMakeLoadDecision(&pxBench->result, &pxBench->decision);
+}
+
+/* The enter/exit pair every queue, semaphore and notify call makes. Built
+ * with configUSE_PORT_INLINE_CRITICAL 0 for the kernel's version. */
+static void vBenchCritical(void *pvContext) {
+    taskENTER_CRITICAL();
+    taskEXIT_CRITICAL();
+}
+
+/* A word through a queue nobody waits on, the case configUSE_QUEUE_FAST_PATH
+ * serves. Built with it 0 for the kernel's general path. */
+static void vBenchQueue(void *pvContext) {
+    uint32_t value = 0;
+
+    xQueueSend(xBenchQueue, &value, 0);
+    xQueueReceive(xBenchQueue, &value, 0);
+}
+
+static void vBenchMutex(void *pvContext) {
+    xSemaphoreTake(xBenchMutex, 0);
+    xSemaphoreGive(xBenchMutex);
+}
+
+/* Two context switches: to the peer and back */
+static void vBenchSwitch(void *pvContext) {
+    xTaskNotifyGive(xBenchPeerTask);
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+}
+
+/* Short segments across the free area under the RoC plot, in black so
+ * nothing needs restoring. Rasterizer and driver draw the same lines. */
+static void vBenchNextLine(int *x0, int *y0, int *y1) {
+    ulBenchLine++;
+    *x0 = FREQPLT_ORI_X + (int)((ulBenchLine * FREQPLT_GRID_SIZE_X) % 480);
+    *y0 = 320 + (int)((ulBenchLine * 7) % 140);
+    *y1 = 320 + (int)((ulBenchLine * 13) % 140);
+}
+
+static void vBenchRasterLine(void *pvContext) {
+    int x0, y0, y1;
+
+    vBenchNextLine(&x0, &y0, &y1);
+    vRasterLine(x0, y0, x0 + FREQPLT_GRID_SIZE_X, y1, 0);
+    vRasterSync(0);  // Timed to the last pixel with a 2D engine too
+}
+
+static void vBenchDriverLine(void *pvContext) {
+    int x0, y0, y1;
+
+    vBenchNextLine(&x0, &y0, &y1);
+    alt_up_pixel_buffer_dma_draw_line(pixel_buf, x0, y0, x0 + FREQPLT_GRID_SIZE_X, y1, 0, 0);
+}
+
+/* One VGA refresh as the display task does it, without the vsync wait.
+ * The analyzer benchmark's counts keep the plots moving between frames. */
+static void vBenchFrames(void) {
+    BenchStats_t stats;
+    uint32_t start;
+    int i, j;
+
+    vBenchStatsInit(&stats);
+    for (i = 0; i < BENCH_FRAMES; i++) {
+        for (j = 0; j < BENCH_FRAME_SAMPLES; j++) {
+            vBenchAnalyzeSample(&xBenchAnalyzer);
+        }
+        start = ulLatencyNow();
+        vPlotSnapshot(xVGAZoomLevel, xBenchColumns);
+        vDrawFrequencyPlot(xBenchColumns);
+        vDrawPage();
+        vBenchStatsAdd(&stats, start, ulLatencyNow());
+    }
+    vBenchReport("frame_render", &stats);
+}
+
+/* What the display costs the protection loop: the same batch of analyzer
+ * samples, timed with nothing else between batches, after a frame drawn
+ * as the display task draws it, after the D-cache is flushed and after the
+ * I-cache is. The D-cache flush bounds what the frame's evictions of data
+ * can cost; a render slower than that is bus or SRAM stalls, the engine's
+ * or the write buffer's. The core counts no cache misses, so the I-cache
+ * flush stands in: contend_icold less contend_idle is the batch's code
+ * refilled once, and contend_idle itself holds the misses the batch's
+ * code takes from itself, which the hot text image ("make hot") is
+ * meant to remove. The pixel DMA scans out in every case: this core has
+ * no enable to stop it with. bench_compare.py prints each against
+ * contend_idle. */
+static void vBenchContention(void) {
+    static const char *const pcNames[] = { "contend_idle", "contend_render", "contend_cold", "contend_icold" };
+    BenchStats_t stats;
+    uint32_t start, condition;
+    int i, j;
+
+    for (condition = 0; condition < sizeof(pcNames) / sizeof(pcNames[0]); condition++) {
+        vBenchStatsInit(&stats);
+        for (i = 0; i < BENCH_CONTEND_ROUNDS; i++) {
+            if (condition == 1) {
+                vPlotSnapshot(xVGAZoomLevel, xBenchColumns);
+                vDrawFrequencyPlot(xBenchColumns);
+                vDrawPage();
+            } else if (condition == 2) {
+                alt_dcache_flush_all();
+            } else if (condition == 3) {
+                alt_icache_flush_all();
+            }
+            start = ulLatencyNow();
+            for (j = 0; j < BENCH_FRAME_SAMPLES; j++) {
+                vBenchAnalyzeSample(&xBenchAnalyzer);
+            }
+            vBenchStatsAdd(&stats, start, ulLatencyNow());
+        }
+        vBenchReport(pcNames[condition], &stats);
+    }
+}
+
+/* Interrupt entry to exit: spin on the timestamp timer and record every
+ * gap longer than the bare loop, less the loop itself. Each gap is one
+ * interrupt (tick, analyser, ...) including the dispatch and any nested
+ * ones, the way the interrupted code sees it. */
+static void vBenchIrqGaps(void) {
+    BenchStats_t stats;
+    TickType_t end;
+    uint32_t prev, now, loop = 0xFFFFFFFFUL;
+    int i;
+
+    /* The bare loop, with an interrupt or two in the way at most */
+    prev = ulLatencyNow();
+    for (i = 0; i < BENCH_ITERATIONS; i++) {
+        now = ulLatencyNow();
+        if (now - prev < loop) {
+            loop = now - prev;
+        }
+        prev = now;
+        (void)xTaskGetTickCount();
+    }
+
+    vBenchStatsInit(&stats);
+    end = xTaskGetTickCount() + pdMS_TO_TICKS(BENCH_IRQ_MS);
+    prev = ulLatencyNow();
+    while ((int32_t)(xTaskGetTickCount() - end) < 0) {
+        now = ulLatencyNow();
+        if (now - prev > loop + BENCH_IRQ_MARGIN) {
+            vBenchStatsRecord(&stats, now - prev - loop);
+        }
+        prev = now;
+    }
+    vBenchReport("irq_gap", &stats);
+}
+
+/* Stop every application task, but only while all of them are blocked:
+ * one stopped in the middle of a sequence lock write would leave readers
+ * spinning. Returns 0 to be called again later. */
+static int xBenchStopApp(void) {
+    int i, n = APP_TASK_COUNT;
+
+#if FREQ_UI_COROUTINES
+    /* The UI co-routines stop between steps, the idle task finishes one
+     * the benchmark preempted before it is called again */
+    xUiPaused = 1;
+    if (xUiBusy) {
+        return 0;
+    }
+#endif
+    vTaskSuspendAll();
+    for (i = 0; i < n; i++) {
+        if (eTaskGetState(*xAppTasks[i].pxHandle) != eBlocked) {
+            xTaskResumeAll();
+            return 0;
+        }
+    }
+    for (i = 0; i < n; i++) {
+        vTaskSuspend(*xAppTasks[i].pxHandle);
+    }
+    xTaskResumeAll();
+    return 1;
+}
+
+/* Undo what the benchmarks left in the shared state, then let the app go.
+ * The periodic tasks start new periods, the stop is not counted as misses. */
+static void vBenchRestartApp(void) {
+    int i, n = APP_TASK_COUNT;
+
+    xReconnectDue = 0;
+    if (xTimerIsTimerActive(xReconnectTimer)) {
+        xTimerStop(xReconnectTimer, 0);
+    }
+    xOutputCommand(OUTPUT_SOURCE_DECISION, gLoad.decision.requested_status);
+    memset(&gDecisionLatency, 0, sizeof(LatencyStats_t));
+    memset(&gShedLatency, 0, sizeof(LatencyStats_t));
+    vHistoryInit(pxPlotAxesInit());
+    vEventLogPause(0);
+    vPeriodResyncAll();
+    vWatchdogPause(0);
+    xTimerStart(xTelemetryTimer, 0);
+#if FREQ_UI_COROUTINES
+    xUiPaused = 0;
+#endif
+
+    for (i = 0; i < n; i++) {
+        vTaskResume(*xAppTasks[i].pxHandle);
+    }
+}
+
+static void vBenchPeerTask(void *pvParameters) {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        xTaskNotifyGive(xBenchTask);
     }
 }
 
+/* Benchmark Task: runs the suite once with the application stopped. Never
+ * deleted, that would free the static stacks into the heap. */
+static void vBenchTask(void *pvParameters) {
+    static BenchDecision_t decision;
+    FrequencyData_t *pxData;
+    uint32_t i;
+
+    vTaskDelay(pdMS_TO_TICKS(BENCH_START_MS));
+
+    vBenchAnalyzerInit(&xBenchAnalyzer);
+
+    memset(&decision, 0, sizeof(BenchDecision_t));
+    for (i = 0; i < FREQ_CHANNELS; i++) {
+        pxData = &decision.result.channel[i];
+        pxData->lower_limit = NOMINAL_FREQ_Q16 - FREQ_TOLERANCE_Q16;
+        pxData->upper_limit = NOMINAL_FREQ_Q16 + FREQ_TOLERANCE_Q16;
+        pxData->current_freq = pxData->lower_limit - FIX16_CONST(2.0);
+        pxData->roc = -MAX_FREQ_ROC_Q16;
+        pxData->roc_peak = pxData->roc;
+        pxData->is_stable = 0;
+    }
+    decision.result.unstable = (1u << FREQ_CHANNELS) - 1;
+    decision.decision.priority_mask = LOAD_PRIORITY_MASK;
+
+    vBenchBegin();
+    while (!xBenchStopApp()) {
+        vTaskDelay(1);
+    }
+    vWatchdogPause(1);
+    xTimerStop(xTelemetryTimer, 0);
+    vEventLogPause(1);  // Benchmark sheds are not events
+
+    vBenchRun("freq_estimate", vBenchEstimate, &xBenchAnalyzer, BENCH_ITERATIONS);
+    vBenchRun("analyze_sample", vBenchAnalyzeSample, &xBenchAnalyzer, BENCH_ITERATIONS);
+    vBenchRun("load_decision", vBenchDecision, &decision, BENCH_ITERATIONS);
+    vBenchRun("critical_section", vBenchCritical, NULL, BENCH_ITERATIONS);
+    if (xBenchQueue != NULL && xBenchMutex != NULL) {
+        vBenchRun("queue_send_receive", vBenchQueue, NULL, BENCH_ITERATIONS);
+        vBenchRun("mutex_take_give", vBenchMutex, NULL, BENCH_ITERATIONS);
+    }
+    vBenchRun("switch_round_trip", vBenchSwitch, NULL, BENCH_ITERATIONS);
+    vBenchIrqGaps();
+    vBenchRun("raster_line", vBenchRasterLine, NULL, BENCH_ITERATIONS);
+    vBenchRun("driver_line", vBenchDriverLine, NULL, BENCH_ITERATIONS);
+    vBenchFrames();
+    vBenchContention();
+
+    vBenchRestartApp();
+    vBenchEnd();
+
+    vTaskSuspend(xBenchPeerTask);
+    vTaskSuspend(NULL);
+}
+#endif
 
 /*-----------------------------------------------------------*/
 /* Main Function */
 
 int main(void) {
-   // int i;
+    ConfigParams_t config;
+    FreqResult_t freq_defaults;
+    InputSnapshot_t xInputs;
+    WarmState_t warm;
+    int i, warm_boot;
+
+    /* All red LEDs on to show the system is starting, first so a scope on
+     * them times the boot before main */
+    vBoardStatusLeds(0xFFFF);
 
     /* Initialize hardware components */
 
-    /* Set up keyboard/push button interrupts */
-    IOWR_ALTERA_AVALON_PIO_IRQ_MASK(PUSH_BUTTON_BASE, 0x7);
-    IOWR_ALTERA_AVALON_PIO_EDGE_CAP(PUSH_BUTTON_BASE, 0x7);
-    alt_irq_register(PUSH_BUTTON_IRQ, NULL, vKeyboardISRHandler);
+    /* Set up push button interrupts */
+    vBoardButtonsInit(BUTTONS);
+    vPortSetIrqPriority(PUSH_BUTTON_IRQ, BUTTON_IRQ_PRIORITY);
+    xIrqRegister(PUSH_BUTTON_IRQ, vButtonISRHandler, NULL);
+
+    /* Start the timestamp timer before the first sample is stamped */
+    vLatencyInit();
+    vTimeBaseInit();
+    vPerfInit();
+    xBoot.start = ulLatencyNow();
+    memset(&gDecisionLatency, 0, sizeof(LatencyStats_t));
+    memset(&gShedLatency, 0, sizeof(LatencyStats_t));
+
+    /* Period monitors, the control tasks first; the event driven ones wait
+     * at most their period for a notification */
+    vPeriodInit(&xAnalyzerPeriod, "FreqAn", FREQ_ANALYZER_PERIOD_MS, 0, PERIOD_EVENT | PERIOD_CONTROL);
+    vPeriodInit(&xMonitorPeriod, "SysMon", SYSTEM_MONITOR_PERIOD_MS, 0, PERIOD_TIME | PERIOD_CONTROL);
+    vPeriodInit(&xActuatorPeriod, "LoadAct", LOAD_ACTUATOR_PERIOD_MS, 0, PERIOD_EVENT | PERIOD_CONTROL);
+#if FREQ_TIME_TRIGGERED
+    vPeriodInit(&xCyclicPeriod, "Cyclic", CYCLIC_MINOR_MS, 0, PERIOD_TIME | PERIOD_CONTROL);
+#endif
+#if !FREQ_HEADLESS
+    vPeriodInit(&xVGAPeriod, "VGADisp", VGA_DISPLAY_PERIOD_MS, 0, PERIOD_TIME);
+#endif
+    vPeriodInit(&xRunStatsPeriod, "RunStat", RUN_STATS_PERIOD_MS, 0, PERIOD_TIME);
+    vPeriodInit(&xTelemetryPeriod, "Telem", TELEMETRY_PERIOD_MS, 0, PERIOD_TIME);
+    vPeriodInit(&xFlashPeriod, "Flash", FLASH_PERIOD_MS, 0, PERIOD_TIME);
+    vPeriodInit(&xModbusPeriod, "Modbus", MODBUS_DEADLINE_MS, 0, PERIOD_EVENT);
+#if FREQ_ETHERNET
+    vPeriodInit(&xEthPeriod, "Eth", MODBUS_DEADLINE_MS, 0, PERIOD_EVENT);
+#endif
+#if FREQ_COORD
+    vPeriodInit(&xCoordPeriod, "Coord", COORD_PERIOD_MS, 0, PERIOD_EVENT);
+    vPeriodInit(&xTimeSyncPeriod, "TSync", COORD_TIME_PERIOD_MS, 0, PERIOD_EVENT);
+#endif
+
+    /* Release phases: the ones given first, then the rest spread around them */
+    vPeriodOffset(&xMonitorPeriod, SYSTEM_MONITOR_OFFSET_MS);
+#if FREQ_TIME_TRIGGERED
+    vPeriodOffset(&xCyclicPeriod, CYCLIC_OFFSET_MS);
+#endif
+#if !FREQ_HEADLESS
+    vPeriodOffset(&xVGAPeriod, VGA_DISPLAY_OFFSET_MS);
+#endif
+    vPeriodOffset(&xRunStatsPeriod, RUN_STATS_OFFSET_MS);
+    vPeriodOffset(&xTelemetryPeriod, 0);
+    vPeriodOffset(&xFlashPeriod, FLASH_OFFSET_MS);
+    vPeriodSpread();
+#if FREQ_FAULT_INJECT
+    vFaultInit(FAULT_INJECT_SEED, FAULT_HOG_DEFAULT_PRIORITY);
+#endif
+
+#if FREQ_TRACE_REPLAY
+    vPrngSeed(&xTraceSeeds, FREQ_TRACE_SEED);
+#endif
+#if FREQ_RELAY_SOAK
+    /* The first scenario starts with the tick, the daemon runs the rest */
+    (void)pxTraceReplayStart();
+    ulSoakScenarios = 1;
+    printf("Soak: replaying %lu scenarios in turn, summary every %u min, seed %lu\n",
+           (unsigned long)ulTraceScenarioCount, (unsigned int)SOAK_SUMMARY_MIN,
+           (unsigned long)FREQ_TRACE_SEED);
+#endif
+#if FREQ_RATE_SWEEP
+    /* The run stats task starts the first step, the daemon runs them all */
+    pxSweepScenario = pxTraceScenarioFind(SWEEP_TRACE);
+    if (pxSweepScenario == NULL) {
+        pxSweepScenario = &xTraceScenarios[0];
+    }
+    ulTraceSeed = ulPrngNext(&xTraceSeeds);
+    printf("Sweep: %s on 1 to %u feeders, %u paces, %u s a step\n", pxSweepScenario->name,
+           (unsigned int)FREQ_CHANNELS, (unsigned int)SWEEP_SPEEDS,
+           (unsigned int)(SWEEP_STEP_PERIODS * RUN_STATS_PERIOD_MS / 1000));
+#endif
+
+    /* Set up the frequency analyser interrupts on empty sample rings */
+#if FREQ_ANALYSER_FIFO
+    ulStampPerCount = ulLatencyCountsPerUs() * 1000000UL / (uint32_t)SAMPLING_FREQ;
+#endif
+    for (i = 0; i < FREQ_CHANNELS; i++) {
+        gFreqChannel[i].ring.head = 0;
+        gFreqChannel[i].ring.tail = 0;
+        gFreqChannel[i].ring.dropped = 0;
+        gFreqChannel[i].ring.high_water = 0;
+        gFreqChannel[i].base = xFreqChannelHw[i].base;
+        gFreqChannel[i].channel = i;
+        gFreqChannel[i].trip_run = 0;
+#if FREQ_ANALYSER_FIFO
+        vBoardFreqThreshold(xFreqChannelHw[i].base, FREQ_ANALYSER_BATCH);
+#endif
+        vPortSetIrqPriority(xFreqChannelHw[i].irq, FREQ_IRQ_PRIORITY);
+#if portUSE_VIC
+        /* A system with a VIC takes samples in a register set of their own */
+        vPortSetIrqShadow(xFreqChannelHw[i].irq);
+#endif
+        xIrqRegister(xFreqChannelHw[i].irq, vFrequencyISRHandler, &gFreqChannel[i]);
+    }
+
+    /* System state flags, all clear */
+    if (xStateInit() != 0) {
+        printf("State: no memory for the state event group\n");
+    }
+
+    /* The frequency topic starts from the defaults */
+    memset(&freq_defaults, 0, sizeof(freq_defaults));
+    for (i = 0; i < FREQ_CHANNELS; i++) {
+        freq_defaults.channel[i].current_freq = NOMINAL_FREQ_Q16;
+        freq_defaults.channel[i].prev_freq = NOMINAL_FREQ_Q16;
+        freq_defaults.channel[i].upper_limit = NOMINAL_FREQ_Q16 + FREQ_TOLERANCE_Q16;
+        freq_defaults.channel[i].lower_limit = NOMINAL_FREQ_Q16 - FREQ_TOLERANCE_Q16;
+        freq_defaults.channel[i].is_stable = 1;
+    }
+    vBusTopicInit(&xFreqTopic, "freq", xFreqTopicSlot, sizeof(xFreqTopicSlot[0]), 1, &freq_defaults);
 
-    /* Set up frequency analyzer interrupt */
-    alt_irq_register(FREQUENCY_ANALYSER_IRQ, NULL, vFrequencyISRHandler);
+    /* The actuator starts from the defaults until the first result */
+    vPoolInit(&xFreqResultPool, xFreqResultSlots, sizeof(xFreqResultSlots[0]), FREQ_RESULT_SLOTS);
+    vDisturbanceInit();
+#if FREQ_COMTRADE_EXPORT
+    vComtradeInit(FREQ_CHANNELS, (uint32_t)NOMINAL_FREQ, (uint32_t)SAMPLING_FREQ);
+#endif
+    pvFreqResultMailbox = pvPoolAlloc(&xFreqResultPool);
+    memcpy(pvFreqResultMailbox, &freq_defaults, sizeof(FreqResult_t));
 
-    /* Initialize default system status */
-    gSystemStatus.system_state = STATUS_NORMAL;
-    gSystemStatus.alert_active = 0;
-    gSystemStatus.failsafe_active = 0;
-    gSystemStatus.override_active = 0;
+    /* Default thresholds until edited from the keyboard, published once
+     * the stored ones are in */
+    xThresholdConfig[0].channel[0].upper_limit = NOMINAL_FREQ_Q16 + FREQ_TOLERANCE_Q16;
+    xThresholdConfig[0].channel[0].lower_limit = NOMINAL_FREQ_Q16 - FREQ_TOLERANCE_Q16;
+    xThresholdConfig[0].channel[0].max_roc = MAX_FREQ_ROC_Q16;
 
-    /* Initialize frequency data with defaults */
-    gFrequencyData.current_freq = NOMINAL_FREQ;
-    gFrequencyData.prev_freq = NOMINAL_FREQ;
-    gFrequencyData.roc = 0.0;
-    gFrequencyData.upper_limit = NOMINAL_FREQ + FREQ_TOLERANCE;
-    gFrequencyData.lower_limit = NOMINAL_FREQ - FREQ_TOLERANCE;
-    gFrequencyData.is_stable = 1;
 
     /* Initialize load decision data */
-        gLoadDecision.load_status = 0x0000;         /* All loads on initially */
-        gLoadDecision.requested_status = 0x0000;    /* All loads requested to be on */
-        gActuator.actuator_status = 0x0000;         /* All actuators connected initially */
+        gLoad.decision.load_status = 0x0000;         /* All loads on initially */
+        gLoad.decision.requested_status = 0x0000;    /* All loads requested to be on */
+        gLoad.actuator.actuator_status = 0x0000;     /* All actuators connected initially */
+
+    gLoad.decision.priority_mask = LOAD_PRIORITY_MASK;  /* All loads controlled */
+    gLoad.actuator.system_fault = FAULT_NONE;           /* No fault initially */
+    gLoad.actuator.faulty_loads = 0;
+    gLoad.actuator.priority_mask = LOAD_PRIORITY_MASK;  /* Actuator priority matches decision */
+
+    /* After a reset that kept the SDRAM, carry on from the loads and
+     * fault latch the last run left (warm_state.h): the hold-offs restart
+     * from there rather than from every load off */
+    warm_boot = xWarmStateRestore(&warm);
+    if (warm_boot) {
+        gLoad.decision.load_status = warm.driven;
+        gLoad.decision.requested_status = warm.requested;
+        gLoad.actuator.actuator_status = warm.driven;
+        gLoad.actuator.faulty_loads = warm.faulty_loads;
+        gLoad.actuator.system_fault = warm.system_fault;
+        vEventLogPost(EVENT_WARM_BOOT, warm.warm_boots, (uint32_t)warm.requested << 16 | warm.driven);
+    }
+
+    /* Empty display history and historian */
+#if !FREQ_HEADLESS
+    vHistoryInit(pxPlotAxesInit());
+#endif
+    vHistorianInit((uint32_t)SAMPLING_FREQ, (uint32_t)NOMINAL_FREQ);
+    for (i = 0; i < FREQ_CHANNELS; i++) {
+        vStatsInit(&gFreqStats[i], (int32_t)(NOMINAL_FREQ * 1000));
+    }
+    vStatsInit(&gShedStats, 0);
+    vExcursionInit();
+
+    /* Select the load shedding policy (flash table if present), and the
+     * power-weighted selection if a load registry is flashed as well */
+    xLoadPolicyInit();
+    xLoadRegistryInit();
+    vLoadLocksInit(&xLoadLocks, gLoad.decision.requested_status, 0);
+#if FREQ_ACTUATION_LIMIT
+    vLoadLimiterInit(gLoad.decision.requested_status, 0);
+#endif
+#if FREQ_UF_CURVES
+    vUfCurveInit(&xUfCurves, xUfDefaultStages, ulUfDefaultStageCount);
+    printf("Trip curves: %s stages\n", xUfCurveLoad(&xUfCurves) ? "flash" : "built-in");
+    for (i = 0; i < FREQ_CHANNELS; i++) {
+        vUfCurveReset(&xUfState[i]);
+    }
+#endif
+#if FREQ_UF_DEADLINE
+    for (i = 0; i < FREQ_CHANNELS; i++) {
+        vDeadlineCreate(&xUfDeadline[i], vUfDeadlineCallback, (void *)i);
+    }
+#endif
+
+    /* The bank booted and the spare one updates go to */
+    xFwUpdateInit();
+
+    /* Stored configuration replaces the defaults and the policy bands */
+    vConfigCollect(&config, &xThresholdConfig[0].channel[0]);
+    if (xConfigInit(&config)) {
+        xThresholdConfig[0].channel[0].upper_limit = config.upper_limit;
+        xThresholdConfig[0].channel[0].lower_limit = config.lower_limit;
+        xThresholdConfig[0].channel[0].max_roc = config.max_roc;
+        if (!xLoadPolicySetBands(config.freq_thresholds, config.max_roc, config.requested_status)) {
+            printf("Config: stored bands are not ascending, keeping the policy table\n");
+        }
+    }
+
+    /* Further feeders start from the same limits */
+    for (i = 1; i < FREQ_CHANNELS; i++) {
+        xThresholdConfig[0].channel[i] = xThresholdConfig[0].channel[0];
+    }
+    gThresholds = &xThresholdConfig[0];
 
-    gLoadDecision.priority_mask = LOAD_PRIORITY_MASK;  /* All loads controlled */
-    gActuator.system_fault = FAULT_NONE;               /* No fault initially */
-    gActuator.priority_mask = LOAD_PRIORITY_MASK;      /* Actuator priority matches decision */
+#if configUSE_KERNEL_TRACE
+    if (xKernelTraceInit() != 0) {
+        printf("Kernel trace: pixel buffer overlaps the SRAM ring, not recording\n");
+    }
+#endif
+#if FREQ_JOURNAL
+    if (xJournalInit(VGA_FRAME_BASE) != 0) {
+        printf("Journal: pixel buffer leaves no row tails for the ring, not recording\n");
+    }
+#endif
 
-    /* Create mutexes for shared data protection */
-    xConfigRegsMutex = xSemaphoreCreateMutex();
-    xActuatorStatusMutex = xSemaphoreCreateMutex();
-    xShedRegsMutex = xSemaphoreCreateMutex();
+    /* Heartbeats from the control tasks, kicked by vWatchdogTask */
+    if (xWatchdogInit(WATCHDOG_BEATS, pdMS_TO_TICKS(WATCHDOG_TRIP_MS)) != 0) {
+        printf("Watchdog: no memory for the heartbeat event group, not supervising\n");
+    }
 
-    /* Create queues for inter-task communication */
-    xFreqDataQueue = xQueueCreate(10, sizeof(double));         /* Raw frequency values from ISR */
-    xFreqResultQueue = xQueueCreate(2, sizeof(FrequencyData_t)); /* Processed frequency data */
+#if FREQ_RELAY_PROFILE
+    if (xProfileInit() != 0) {
+        printf("Profile: no memory for the PC sample histograms\n");
+    }
+#endif
+
+    /* Create the reconnection hold-off timer (one shot, period set per load) */
+    xReconnectTimer = xTimerCreate("Reconn", pdMS_TO_TICKS(RECONNECT_STABLE_MS), pdFALSE,
+                                   NULL, vReconnectTimerCallback);
+
+    /* Slide switch debounce (one shot, restarted by the tick hook on each change) */
+    vInputSnapshotTake(0);
+    vInputSnapshotGet(&xInputs);
+    ulSwitchSeen = xInputs.switches;
+    xSwitchDebounceTimer = xTimerCreate("Debounce", pdMS_TO_TICKS(SWITCH_DEBOUNCE_MS), pdFALSE,
+                                        NULL, vSwitchDebounceCallback);
+    xTimerStart(xSwitchDebounceTimer, 0);  // Pick up the switch positions at boot
+
+    /* Actuator settle time before each feedback read (one shot) */
+    xFeedbackTimer = xTimerCreate("Feedback", pdMS_TO_TICKS(FEEDBACK_SETTLE_MS), pdFALSE,
+                                  NULL, vFeedbackTimerCallback);
+
+    /* Telemetry drain (auto reload), housekeeping for the background daemon */
+    xTelemetryTimer = xTimerCreateBackground("Telem", pdMS_TO_TICKS(TELEMETRY_PERIOD_MS), pdTRUE,
+                                             NULL, vTelemetryTimerCallback);
+    xTimerStart(xTelemetryTimer, 0);
+
+    if (xReconnectTimer == NULL || xSwitchDebounceTimer == NULL || xFeedbackTimer == NULL ||
+        xTelemetryTimer == NULL) {
+        printf("ERROR: Cannot create the software timers\n");
+        for(;;);
+    }
+#if configUSE_NEWLIB_REENTRANT == 2
+    xTimerPendFunctionCallBackground(vDaemonReentDeferred, &xDaemonReent, 0, 0);
+#endif
+
+#if !FREQ_UI_COROUTINES && !FREQ_HEADLESS
+    xCursorMutex = xSemaphoreCreateMutexCeiling(VGA_DISPLAY_PRIORITY);
+    if (xCursorMutex == NULL) {
+        printf("ERROR: Cannot create the cursor mutex\n");
+        for(;;);
+    }
+    vQueueAddToRegistry(xCursorMutex, "CursorMtx");
+#endif
 
-    /* Create the tasks */
-    xTaskCreate(vSystemMonitorTask, "SysMonitor", TASK_STACKSIZE,
-               NULL, SYSTEM_MONITOR_PRIORITY, &xSystemMonitorTask);
+    if (xTelemetryInit() != 0) {
+        printf("Telemetry disabled, cannot open %s\n", JTAG_UART_NAME);
+    }
+    for (i = 0; i < FREQ_CHANNELS; i++) {
+        vSwingStageInit(&xFreqSwing[i], 2, lFreqSwingTolerance, TELEMETRY_SWING_MAX_MS * 1000UL);
+    }
+    vSwingStageInit(&xDecisionSwing, 0, NULL, TELEMETRY_SWING_MAX_MS * 1000UL);
+
+    /* Create the tasks, stopping here if any of them cannot be created */
+    for (i = 0; i < APP_TASK_COUNT; i++) {
+        if (xTaskGenericCreate(xAppTasks[i].pxCode, xAppTasks[i].pcName, xAppTasks[i].usStackWords,
+                               NULL, xAppTasks[i].uxPriority, xAppTasks[i].pxHandle,
+                               xAppTasks[i].pxStack, NULL) != pdPASS) {
+            printf("ERROR: Cannot create task %s\n", xAppTasks[i].pcName);
+            for(;;);
+        }
+#if configUSE_EDF_SCHEDULING
+        /* The background band runs by deadline, one period after each release */
+        if (xAppTasks[i].uxPriority == configEDF_PRIORITY) {
+            vTaskSetDeadline(*xAppTasks[i].pxHandle, pdMS_TO_TICKS(xAppTasks[i].usPeriodMs));
+        }
+#endif
+    }
+#if configUSE_NEWLIB_REENTRANT == 2
+    vTaskSetNewlibReent(xRunStatsTask, &xRunStatsReent);
+    vTaskSetNewlibReent(xFlashTask, &xFlashReent);
+#if !FREQ_UI_COROUTINES
+    vTaskSetNewlibReent(xThresholdEditTask, &xThresholdEditReent);
+#endif
+#endif
+
+#if FREQ_RELAY_BENCH
+    /* Made here, before the heap is frozen */
+    xBenchQueue = xQueueCreate(1, sizeof(uint32_t));
+    xBenchMutex = xSemaphoreCreateMutex();
+    vQueueAddToRegistry(xBenchQueue, "BenchQ");
+    vQueueAddToRegistry(xBenchMutex, "BenchMtx");
+    if (xTaskGenericCreate(vBenchTask, "Bench", BENCH_STACK, NULL, BENCH_PRIORITY, &xBenchTask,
+                           APP_STACK(xBenchStack), NULL) != pdPASS ||
+        xTaskGenericCreate(vBenchPeerTask, "BenchPr", BENCH_PEER_STACK, NULL, BENCH_PRIORITY, &xBenchPeerTask,
+                           APP_STACK(xBenchPeerStack), NULL) != pdPASS) {
+        printf("ERROR: Cannot create the benchmark tasks\n");
+        for(;;);
+    }
+#endif
+
+#if FREQ_UI_COROUTINES
+    if (
+#if !FREQ_HEADLESS
+        xCoRoutineCreate(vDisplayCoRoutine, 0, 0) != pdPASS ||
+#endif
+        xCoRoutineCreate(vKeysCoRoutine, 1, 0) != pdPASS ||
+        xCoRoutineCreate(vStateCoRoutine, 1, 0) != pdPASS ||
+        xIdleJobRegister("UI", xUiCoRoutineJob) != 0) {
+        printf("ERROR: Cannot create the UI co-routines\n");
+        for(;;);
+    }
+#endif
+#if configCHECK_FOR_STACK_OVERFLOW == 3
+    xIdleJobRegister("Stack", xStackScanJob);
+#endif
+#if FREQ_INTEGRITY
+    /* The image, then the tables the decision reads, as they stand now */
+    if (xIntegrityInit() != 0 || xIntegrityAddImage() != 0) {
+        printf("Integrity checks disabled\n");
+    } else {
+        xThresholdRegion = xIntegrityAdd("Thresholds", xThresholdConfig, sizeof(xThresholdConfig));
+        xPolicyRegion = xIntegrityAdd("Policy", pxLoadPolicyGet(), sizeof(LoadPolicy_t));
+        if (pxLoadRegistryGet() != NULL) {
+            xIntegrityAdd("Registry", pxLoadRegistryGet(), sizeof(LoadRegistry_t));
+        }
+#if FREQ_UF_CURVES
+        xIntegrityAdd("Curves", &xUfCurves, sizeof(xUfCurves));
+#endif
+    }
+#endif
 
-    xTaskCreate(vFrequencyAnalyzerTask, "FreqAnalyzer", TASK_STACKSIZE,
-               NULL, FREQ_ANALYZER_PRIORITY, &xFreqAnalyzerTask);
+    /* PS/2 keyboard bytes go to the threshold editor (polled by a co-routine,
+     * the handle is NULL then) */
+    if (xPs2KeysInit(xThresholdEditTask) != 0) {
+        printf("PS/2 keyboard not found, thresholds fixed\n");
+    }
 
-    xTaskCreate(vLoadActuatorTask, "LoadAct", TASK_STACKSIZE,
-               NULL, LOAD_ACTUATOR_PRIORITY, &xLoadActuatorTask);
+#if FREQ_SCREEN_CAPTURE
+    if (xScreenCaptureInit() != 0) {
+        printf("Screen capture disabled\n");
+    }
+#endif
 
-    xTaskCreate(vVGADisplayTask, "VGADisplay", TASK_STACKSIZE,
-               NULL, VGA_DISPLAY_PRIORITY, &xVGADisplayTask);
+    /* Status on the character LCD, drawn in idle time */
+    if (xLcdInit(vLcdRefresh) != 0) {
+        printf("LCD: panel not found\n");
+    }
+#if FREQ_SHELL
+    if (xShellInit(xShellCommands, sizeof(xShellCommands) / sizeof(xShellCommands[0])) != 0) {
+        printf("Shell: cannot open %s\n", JTAG_UART_NAME);
+    }
+#endif
 
-    xTaskCreate(vManualOverrideTask, "Override", TASK_STACKSIZE,
-               NULL, MANUAL_OVERRIDE_PRIORITY, &xManualOverrideTask);
+    /* SCADA access on the RS-232 port */
+    if (xModbusInit(MODBUS_ADDRESS, &xModbusMap, xModbusTask) != 0) {
+        printf("Modbus: cannot take the UART over\n");
+    }
+#if FREQ_COORD
+    /* Shed coordination on the second one */
+    vCoordStageKw(usCoordStageKw);
+    vTimeSyncInit(xTimeSyncTask);
+    if (xCoordInit(COORD_NODE, xCoordTask) != 0) {
+        printf("Coord: cannot take the UART over\n");
+    }
+#endif
+#if FREQ_ETHERNET
+    /* Telemetry and a second Modbus port on the Ethernet */
+    if (xEthInit(xEthTask) != 0 || xEthUdpBind(ETH_MODBUS_PORT, vModbusDatagram) != 0) {
+        printf("Eth: cannot set the MAC up, telemetry stays on %s\n", JTAG_UART_NAME);
+    } else {
+        vTelemetrySetSink(&xTelemetryEth);
+    }
+#endif
 
-    /* Initial LED setup - all on to show system is starting */
-    IOWR_ALTERA_AVALON_PIO_DATA(RED_LEDS_BASE, 0xFFFF);
-    IOWR_ALTERA_AVALON_PIO_DATA(GREEN_LEDS_BASE, 0xFF);
+    vOutputInit(xLoadActuatorTask, warm_boot ? warm.driven : 0xFF);
+    vLoadAuditInit(xOutputDriven(), 0);
+#if FREQ_DEADLINE_TIMER
+    if (xDeadlineInit() != 0) {
+        printf("Deadline: cannot register the timer interrupt\n");
+    }
+#endif
+#if FREQ_IRQ_LATENCY
+    if (xIrqLatencyInit() != 0) {
+        printf("IRQ latency: cannot register the timer interrupt\n");
+    }
+#endif
+#if FREQ_TIME_TRIGGERED
+    vFailsafeInit(LOAD_PRIORITY_1, NULL, 0);   // The cyclic task polls
+#else
+    vFailsafeInit(LOAD_PRIORITY_1, xSystemMonitorTask, MONITOR_NOTIFY_FAILSAFE);
+#endif
+
+    /* A latch the last run reported holds over the restart, and is
+     * reported again */
+    for (i = 0; warm_boot && i < FAILSAFE_SOURCES; i++) {
+        if (warm.failsafe & (1UL << i)) {
+            xFailsafeTrip(i, warm.failsafe_detail[i]);
+        }
+    }
 
-    printf("Load Management System Starting...\n");
-    printf("Nominal Frequency: %.1f Hz (± %.1f Hz)\n", NOMINAL_FREQ, FREQ_TOLERANCE);
-    printf("Task Priorities: Monitor=%d, Analyzer=%d, Actuator=%d, Display=%d, Override=%d\n",
-           SYSTEM_MONITOR_PRIORITY, FREQ_ANALYZER_PRIORITY, LOAD_ACTUATOR_PRIORITY,
-           VGA_DISPLAY_PRIORITY, MANUAL_OVERRIDE_PRIORITY);
-    printf("System Ready. Starting scheduler.\n\n");
+    /* Everything else is up, the banner waits for the flash task */
+    xBoot.ready_us = ulLatencyElapsedUs(xBoot.start, ulLatencyNow());
 
     /* Start the scheduler */
     vTaskStartScheduler();
@@ -0,0 +1,436 @@
+/**
+ * Long-term frequency historian
+ *
+ * See historian.h.
+ */
+
+/* Standard includes */
+#include <string.h>
+
+/* Application includes */
+#include "historian.h"
+#include "latency.h"
+#include "seqlock.h"
+#include "time_base.h"
+
+typedef struct {
+    volatile uint32_t number;          // HISTORIAN_INVALID while reused
+    uint16_t used;                     // Packed bytes
+    uint8_t channel;
+    uint8_t closed;                    // No more samples will be added
+    uint32_t samples;                  // Header sample included
+    uint32_t counts;                   // Counts after the header sample
+    uint64_t start_us;                 // Header sample's capture
+    uint32_t start_stamp;              // The same, as a timestamp count
+    int32_t first_mhz;
+    uint32_t first_count;
+    int32_t min_mhz;
+    int32_t max_mhz;
+    int64_t sum_mhz;
+} HistorianBlock_t;
+
+/* SDRAM, cleared by crt0 with the rest of .bss */
+static HistorianBlock_t xBlocks[HISTORIAN_BLOCKS];
+static uint8_t ucData[HISTORIAN_BLOCKS][HISTORIAN_BLOCK_BYTES];
+
+/* Header updates, for the readers */
+static SeqLock_t xLock = SEQLOCK_INIT;
+
+static volatile uint32_t ulNextNumber;  // Block numbers so far
+
+static uint32_t ulSampleHz;
+static int32_t lRefMhz;
+static volatile uint32_t ulSamples;
+static volatile uint32_t ulBytes;
+
+/* Analyzer only: per feeder, the block being filled and the last sample */
+#define HISTORIAN_CHANNELS             8
+#define HISTORIAN_AGE_US               20000000  // Well inside the 43 s a stamp can be extended over
+static uint32_t ulLive[HISTORIAN_CHANNELS];
+static int32_t lLastMhz[HISTORIAN_CHANNELS];
+static uint32_t ulLastCount[HISTORIAN_CHANNELS];
+
+static inline HistorianBlock_t *pxBlock(uint32_t number) {
+    return &xBlocks[number % HISTORIAN_BLOCKS];
+}
+
+static inline uint64_t ullCountsToUs(uint32_t counts) {
+    return (uint64_t)counts * 1000000 / ulSampleHz;
+}
+
+static inline uint32_t ulZigzag(int32_t value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static inline int32_t lUnzigzag(uint32_t value) {
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+static uint8_t *pucPutVarint(uint8_t *p, uint32_t value) {
+    while (value >= 0x80) {
+        *p++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *p++ = (uint8_t)value;
+    return p;
+}
+
+/* Reads a varint from p, no further than pucEnd. Returns the byte after
+ * it, or NULL if it runs past pucEnd. */
+static const uint8_t *pucGetVarint(const uint8_t *p, const uint8_t *pucEnd, uint32_t *pulValue) {
+    uint32_t value = 0, shift = 0;
+
+    while (p < pucEnd && shift < 35) {
+        value |= (uint32_t)(*p & 0x7F) << shift;
+        if (!(*p++ & 0x80)) {
+            *pulValue = value;
+            return p;
+        }
+        shift += 7;
+    }
+    return NULL;
+}
+
+void vHistorianInit(uint32_t sample_hz, uint32_t line_hz) {
+    uint32_t i;
+
+    ulSampleHz = sample_hz;
+    lRefMhz = (int32_t)(line_hz * 1000);
+    ulNextNumber = 0;
+    ulSamples = 0;
+    ulBytes = 0;
+    for (i = 0; i < HISTORIAN_BLOCKS; i++) {
+        xBlocks[i].number = HISTORIAN_INVALID;
+    }
+    for (i = 0; i < HISTORIAN_CHANNELS; i++) {
+        ulLive[i] = HISTORIAN_INVALID;
+    }
+}
+
+/* Take the oldest block for channel, starting from this sample */
+static void vHistorianOpen(uint32_t channel, int32_t mhz, uint32_t count, uint32_t stamp) {
+    uint32_t number = ulNextNumber;
+    HistorianBlock_t *pxNew = pxBlock(number);
+
+    vSeqWriteBegin(&xLock);
+    if (pxNew->number != HISTORIAN_INVALID) {
+        ulSamples -= pxNew->samples;
+        ulBytes -= pxNew->used;
+        /* A feeder gone quiet a whole lap ago loses its block */
+        if (!pxNew->closed) {
+            ulLive[pxNew->channel] = HISTORIAN_INVALID;
+        }
+    }
+    pxNew->number = HISTORIAN_INVALID;
+    pxNew->channel = (uint8_t)channel;
+    pxNew->closed = 0;
+    pxNew->used = 0;
+    pxNew->samples = 1;
+    pxNew->counts = 0;
+    pxNew->start_us = ullTimeToUs(ullTimeExtend(stamp));
+    pxNew->start_stamp = stamp;
+    pxNew->first_mhz = mhz;
+    pxNew->first_count = count;
+    pxNew->min_mhz = mhz;
+    pxNew->max_mhz = mhz;
+    pxNew->sum_mhz = mhz;
+    pxNew->number = number;
+    ulNextNumber = number + 1;
+    ulSamples++;
+    vSeqWriteEnd(&xLock);
+
+    ulLive[channel] = number;
+}
+
+static void vHistorianClose(uint32_t channel) {
+    if (ulLive[channel] != HISTORIAN_INVALID) {
+        vSeqWriteBegin(&xLock);
+        pxBlock(ulLive[channel])->closed = 1;
+        vSeqWriteEnd(&xLock);
+        ulLive[channel] = HISTORIAN_INVALID;
+    }
+}
+
+void vHistorianAdd(uint32_t channel, fix16_t freq, uint32_t count, uint32_t stamp) {
+    int32_t mhz = (int32_t)(((int64_t)freq * 1000) >> 16);
+    HistorianBlock_t *pxLive;
+    uint8_t *p, *pucStart;
+    uint32_t token, counts, elapsed_us;
+    int32_t dcount;
+
+    if (channel >= HISTORIAN_CHANNELS) {
+        return;
+    }
+    if (ulLive[channel] == HISTORIAN_INVALID) {
+        vHistorianOpen(channel, mhz, count, stamp);
+        lLastMhz[channel] = mhz;
+        ulLastCount[channel] = count;
+        return;
+    }
+    pxLive = pxBlock(ulLive[channel]);
+
+    /* The counts must still account for the time since the block started,
+     * or samples are missing and the block's times would drift */
+    counts = pxLive->counts + count;
+    elapsed_us = ulLatencyElapsedUs(pxLive->start_stamp, stamp);
+    if (pxLive->used > HISTORIAN_BLOCK_BYTES - HISTORIAN_SAMPLE_MAX ||
+        elapsed_us > HISTORIAN_AGE_US ||
+        (uint32_t)((int32_t)(elapsed_us - (uint32_t)ullCountsToUs(counts)) + HISTORIAN_DRIFT_US) >
+            2 * HISTORIAN_DRIFT_US) {
+        vHistorianClose(channel);
+        vHistorianOpen(channel, mhz, count, stamp);
+        lLastMhz[channel] = mhz;
+        ulLastCount[channel] = count;
+        return;
+    }
+
+    pucStart = &ucData[ulLive[channel] % HISTORIAN_BLOCKS][pxLive->used];
+    dcount = (int32_t)(count - ulLastCount[channel]);
+    token = ulZigzag(mhz - lLastMhz[channel]) << 2;
+    token |= dcount == 0 ? 0 : (dcount == 1 ? 1 : (dcount == -1 ? 2 : 3));
+    p = pucPutVarint(pucStart, token);
+    if ((token & 3) == 3) {
+        p = pucPutVarint(p, ulZigzag(dcount));
+    }
+    lLastMhz[channel] = mhz;
+    ulLastCount[channel] = count;
+
+    /* The bytes are in place before the header says so */
+    vSeqWriteBegin(&xLock);
+    pxLive->used += (uint16_t)(p - pucStart);
+    pxLive->samples++;
+    pxLive->counts = counts;
+    if (mhz < pxLive->min_mhz) {
+        pxLive->min_mhz = mhz;
+    }
+    if (mhz > pxLive->max_mhz) {
+        pxLive->max_mhz = mhz;
+    }
+    pxLive->sum_mhz += mhz;
+    ulSamples++;
+    ulBytes += (uint32_t)(p - pucStart);
+    vSeqWriteEnd(&xLock);
+}
+
+/* Consistent header copy of a block still holding number */
+static int xHeader(uint32_t number, HistorianBlock_t *pxOut) {
+    vSeqRead(&xLock, pxOut, pxBlock(number), sizeof(*pxOut));
+    return pxOut->number == number;
+}
+
+/* Oldest block number that may still be held */
+static uint32_t ulOldestNumber(void) {
+    uint32_t next = ulNextNumber;
+
+    return next > HISTORIAN_BLOCKS ? next - HISTORIAN_BLOCKS + 1 : 0;
+}
+
+static void vCursorEnter(HistorianCursor_t *pxCursor, const HistorianBlock_t *pxHeader) {
+    pxCursor->number = pxHeader->number;
+    pxCursor->pos = 0;
+    pxCursor->xFirst = 1;
+    pxCursor->start_us = pxHeader->start_us;
+    pxCursor->counts = 0;
+    pxCursor->freq_mhz = pxHeader->first_mhz;
+    pxCursor->count = pxHeader->first_count;
+}
+
+int xHistorianSeek(HistorianCursor_t *pxCursor, uint32_t channel, uint64_t time_us) {
+    HistorianBlock_t header;
+    uint32_t low = ulOldestNumber(), high = ulNextNumber, mid, n;
+
+    if (high == low) {
+        return 0;
+    }
+
+    /* Last block opened at or before time_us, blocks before the oldest
+     * (or being reused) counting as earlier */
+    while (high - low > 1) {
+        mid = low + (high - low) / 2;
+        if (!xHeader(mid, &header) || header.start_us <= time_us) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+
+    /* The feeder's own block from there back, else its oldest after */
+    for (n = low + 1; n-- > ulOldestNumber();) {
+        if (xHeader(n, &header) && header.channel == channel) {
+            break;
+        }
+    }
+    if (n + 1 <= ulOldestNumber()) {
+        for (n = low + 1; n != ulNextNumber; n++) {
+            if (xHeader(n, &header) && header.channel == channel) {
+                break;
+            }
+        }
+        if (n == ulNextNumber) {
+            return 0;
+        }
+    }
+
+    pxCursor->channel = channel;
+    pxCursor->skip_us = time_us;
+    vCursorEnter(pxCursor, &header);
+    return 1;
+}
+
+/* The feeder's block after the cursor's, if it has one yet */
+static int xCursorAdvance(HistorianCursor_t *pxCursor) {
+    HistorianBlock_t header;
+    uint32_t n;
+
+    for (n = pxCursor->number + 1; n != ulNextNumber; n++) {
+        if (xHeader(n, &header) && header.channel == pxCursor->channel) {
+            vCursorEnter(pxCursor, &header);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int xHistorianNext(HistorianCursor_t *pxCursor, HistorianSample_t *pxSample) {
+    HistorianBlock_t header;
+    const uint8_t *pucData, *p;
+    uint32_t token, dcount;
+
+    for (;;) {
+        if (!xHeader(pxCursor->number, &header)) {
+            return -1;
+        }
+
+        if (pxCursor->xFirst) {
+            pxCursor->xFirst = 0;
+        } else if (pxCursor->pos < header.used) {
+            pucData = ucData[pxCursor->number % HISTORIAN_BLOCKS];
+            p = pucGetVarint(pucData + pxCursor->pos, pucData + header.used, &token);
+            if (p != NULL && (token & 3) == 3) {
+                p = pucGetVarint(p, pucData + header.used, &dcount);
+            } else {
+                dcount = (token & 3) == 0 ? 0 : ulZigzag((token & 3) == 1 ? 1 : -1);
+            }
+            /* Reused while it was read: what was read may be anything */
+            if (p == NULL || pxBlock(pxCursor->number)->number != pxCursor->number) {
+                return -1;
+            }
+            pxCursor->pos = (uint32_t)(p - pucData);
+            pxCursor->freq_mhz += lUnzigzag(token >> 2);
+            pxCursor->count += (uint32_t)lUnzigzag(dcount);
+            pxCursor->counts += pxCursor->count;
+        } else if (!header.closed || !xCursorAdvance(pxCursor)) {
+            return 0;
+        } else {
+            continue;
+        }
+
+        pxSample->time_us = pxCursor->start_us + ullCountsToUs(pxCursor->counts);
+        if (pxSample->time_us < pxCursor->skip_us) {
+            continue;
+        }
+        pxSample->freq_mhz = (uint32_t)pxCursor->freq_mhz;
+        pxSample->count = pxCursor->count;
+        return 1;
+    }
+}
+
+static void vColumnAdd(HistoryColumn_t *pxColumn, int32_t min_mhz, int32_t max_mhz,
+                       int32_t sum_about_ref, uint32_t samples) {
+    fix16_t min = (fix16_t)(((int64_t)min_mhz << 16) / 1000);
+    fix16_t max = (fix16_t)(((int64_t)max_mhz << 16) / 1000);
+
+    if (pxColumn->count == 0) {
+        pxColumn->freq_min = min;
+        pxColumn->freq_max = max;
+        pxColumn->freq_mean = 0;
+    } else {
+        if (min < pxColumn->freq_min) {
+            pxColumn->freq_min = min;
+        }
+        if (max > pxColumn->freq_max) {
+            pxColumn->freq_max = max;
+        }
+    }
+    /* The mean's field holds the sum about the nominal frequency until the
+     * columns are finished */
+    pxColumn->freq_mean += sum_about_ref;
+    pxColumn->count += samples;
+}
+
+void vHistorianColumns(uint32_t channel, uint64_t from_us, uint64_t to_us,
+                       HistoryColumn_t *pxColumns, uint32_t columns) {
+    HistorianCursor_t cursor;
+    HistorianSample_t sample;
+    HistorianBlock_t header;
+    uint64_t span_us, end_us;
+    uint32_t first, last, i;
+    int result;
+
+    memset(pxColumns, 0, columns * sizeof(HistoryColumn_t));
+    if (to_us <= from_us || columns == 0 || !xHistorianSeek(&cursor, channel, from_us)) {
+        return;
+    }
+    span_us = to_us - from_us;
+
+    for (;;) {
+        if (!xHeader(cursor.number, &header) || header.start_us >= to_us) {
+            break;
+        }
+
+        /* A closed block inside one column counts from its header */
+        end_us = header.start_us + ullCountsToUs(header.counts);
+        if (header.closed && cursor.xFirst && header.start_us >= from_us && end_us < to_us) {
+            first = (uint32_t)((header.start_us - from_us) * columns / span_us);
+            last = (uint32_t)((end_us - from_us) * columns / span_us);
+            if (first == last) {
+                vColumnAdd(&pxColumns[first], header.min_mhz, header.max_mhz,
+                           (int32_t)(header.sum_mhz - (int64_t)lRefMhz * header.samples), header.samples);
+                if (!xCursorAdvance(&cursor)) {
+                    break;
+                }
+                continue;
+            }
+        }
+
+        /* Otherwise sample by sample to the end of the block */
+        while ((result = xHistorianNext(&cursor, &sample)) == 1 && cursor.number == header.number &&
+               sample.time_us < to_us) {
+            i = (uint32_t)((sample.time_us - from_us) * columns / span_us);
+            vColumnAdd(&pxColumns[i], (int32_t)sample.freq_mhz, (int32_t)sample.freq_mhz,
+                       (int32_t)sample.freq_mhz - lRefMhz, 1);
+        }
+        if (result != 1 || sample.time_us >= to_us) {
+            break;
+        }
+        /* That was the next block's header sample: take the block afresh */
+        cursor.xFirst = 1;
+    }
+
+    for (i = 0; i < columns; i++) {
+        if (pxColumns[i].count != 0) {
+            pxColumns[i].freq_mean = (fix16_t)((((int64_t)lRefMhz * pxColumns[i].count + pxColumns[i].freq_mean) << 16) /
+                                               ((int64_t)1000 * pxColumns[i].count));
+        }
+    }
+}
+
+uint32_t ulHistorianSamples(void) {
+    return ulSamples;
+}
+
+uint32_t ulHistorianBytes(void) {
+    return ulBytes;
+}
+
+uint64_t ullHistorianOldestUs(void) {
+    HistorianBlock_t header;
+    uint32_t n;
+
+    for (n = ulOldestNumber(); n != ulNextNumber; n++) {
+        if (xHeader(n, &header)) {
+            return header.start_us;
+        }
+    }
+    return 0;
+}
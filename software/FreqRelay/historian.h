@@ -0,0 +1,93 @@
+/**
+ * Long-term frequency historian
+ *
+ * Every count the analyzer drains is kept, with the frequency the analyzer
+ * made of it, for a day and more: HISTORIAN_BLOCKS blocks of
+ * HISTORIAN_BLOCK_BYTES in SDRAM, filled and then reused in turn, oldest
+ * first. Each feeder fills its own block at a time.
+ *
+ * A block header holds the first sample whole (frequency in mHz and count)
+ * and its time in us from boot; each sample after it is packed as
+ *
+ *   varint(zigzag(frequency change in mHz) << 2 | c)
+ *
+ * where c is 0, 1 or 2 for a count the same as the last one, one more or
+ * one less, and 3 for any other count, whose zigzag change follows as a
+ * varint of its own. Near 50 Hz nearly every sample is one byte. A
+ * sample's time is the block start plus the counts since, each count being
+ * the period that ended at the capture, so times are exact without a
+ * timestamp per sample; a block is closed early when the capture stamps
+ * stop agreeing with the counts (lost samples, no signal).
+ *
+ * Headers also keep each block's minimum, maximum and sum, so a plot
+ * column covering whole blocks is made from headers alone and only blocks
+ * across a column boundary are decoded. Block numbers run freely, and
+ * blocks are opened in time order, so the block holding a time is found by
+ * a binary search over them.
+ *
+ * Single writer, the analyzer. Readers copy a header under the sequence
+ * lock and decode a block in place, then check its number again: a block
+ * reused under them is given up rather than read torn.
+ */
+
+#ifndef HISTORIAN_H
+#define HISTORIAN_H
+
+#include <stdint.h>
+#include "fix16.h"
+#include "freq_history.h"
+
+#define HISTORIAN_BLOCK_BYTES          1024
+#define HISTORIAN_BLOCKS               8192   // 8 MB, about 30 h of one feeder at 50 Hz
+#define HISTORIAN_SAMPLE_MAX           10     // Longest packed sample
+#define HISTORIAN_DRIFT_US             5000   // Stamps this far from the counts close the block
+#define HISTORIAN_INVALID              0xFFFFFFFFUL  // Number of a block being reused
+
+typedef struct {
+    uint64_t time_us;                  // Capture, from boot
+    uint32_t freq_mhz;
+    uint32_t count;                    // Period count the frequency was made from
+} HistorianSample_t;
+
+/* Where a reader has got to */
+typedef struct {
+    uint32_t number;                   // Block being read
+    uint32_t channel;
+    uint32_t pos;                      // Next byte in it
+    int xFirst;                        // The header sample is still to come
+    uint64_t start_us;
+    uint32_t counts;                   // Counts since the block start
+    int32_t freq_mhz;
+    uint32_t count;
+    uint64_t skip_us;                  // Samples before this are passed over
+} HistorianCursor_t;
+
+/* Empty the store. sample_hz is the analyser clock, line_hz the nominal
+ * frequency the column sums are taken about. Before the analyzer starts. */
+void vHistorianInit(uint32_t sample_hz, uint32_t line_hz);
+
+/* Analyzer only: one drained count of a feeder, its capture stamp and the
+ * frequency after it */
+void vHistorianAdd(uint32_t channel, fix16_t freq, uint32_t count, uint32_t stamp);
+
+/* Start reading a feeder at time_us (us from boot), or from its oldest
+ * sample if that is later. Returns 0 with nothing kept. */
+int xHistorianSeek(HistorianCursor_t *pxCursor, uint32_t channel, uint64_t time_us);
+
+/* Next sample: 1, 0 once caught up with the writer (call again later), -1
+ * if the writer has reused the block being read (seek again) */
+int xHistorianNext(HistorianCursor_t *pxCursor, HistorianSample_t *pxSample);
+
+/* Frequency minimum, maximum and mean of a feeder over columns equal parts
+ * of [from_us, to_us), in the form the live history gives. The RoC fields
+ * are 0: the historian keeps frequency only. The plot rows are left for
+ * vHistoryPlotRows(). */
+void vHistorianColumns(uint32_t channel, uint64_t from_us, uint64_t to_us,
+                       HistoryColumn_t *pxColumns, uint32_t columns);
+
+/* Samples and packed bytes kept, and time from boot of the oldest */
+uint32_t ulHistorianSamples(void);
+uint32_t ulHistorianBytes(void);
+uint64_t ullHistorianOldestUs(void);
+
+#endif /* HISTORIAN_H */
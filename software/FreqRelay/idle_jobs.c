@@ -0,0 +1,80 @@
+/**
+ * Background jobs run from the idle hook
+ *
+ * See idle_jobs.h.
+ */
+
+/* Application includes */
+#include "idle_jobs.h"
+#include "latency.h"
+
+typedef struct {
+    const char *pcName;
+    IdleJobFunction_t pxFunction;
+    uint32_t runs;
+    uint32_t max_us;
+} IdleJob_t;
+
+static IdleJob_t xJobs[IDLE_JOB_MAX];
+static uint32_t ulJobCount = 0;
+static uint32_t ulNextJob = 0;
+static volatile uint32_t ulPending = 0;  // One bit per job with more to do
+
+int xIdleJobRegister(const char *pcName, IdleJobFunction_t pxFunction) {
+    if (ulJobCount >= IDLE_JOB_MAX) {
+        return -1;
+    }
+    xJobs[ulJobCount].pcName = pcName;
+    xJobs[ulJobCount].pxFunction = pxFunction;
+    xJobs[ulJobCount].runs = 0;
+    xJobs[ulJobCount].max_us = 0;
+    ulJobCount++;
+    return 0;
+}
+
+void vIdleJobsRun(void) {
+    uint32_t start = ulLatencyNow(), step, elapsed_us, done = 0;
+    IdleJob_t *pxJob;
+    uint32_t bit;
+
+    /* Until the budget is used or every job in a row had nothing to do */
+    while (done < ulJobCount) {
+        pxJob = &xJobs[ulNextJob];
+        bit = 1UL << ulNextJob;
+        ulNextJob = (ulNextJob + 1) % ulJobCount;
+
+        step = ulLatencyNow();
+        if (pxJob->pxFunction()) {
+            ulPending |= bit;
+            done = 0;
+        } else {
+            ulPending &= ~bit;
+            done++;
+        }
+        elapsed_us = ulLatencyElapsedUs(step, ulLatencyNow());
+
+        /* Single words, read without a snapshot */
+        pxJob->runs++;
+        if (elapsed_us > pxJob->max_us) {
+            pxJob->max_us = elapsed_us;
+        }
+
+        if (ulLatencyElapsedUs(start, ulLatencyNow()) >= IDLE_JOB_BUDGET_US) {
+            break;
+        }
+    }
+}
+
+int xIdleJobsPending(void) {
+    return ulPending != 0;
+}
+
+uint32_t ulIdleJobCount(void) {
+    return ulJobCount;
+}
+
+void vIdleJobGetStats(uint32_t index, IdleJobStats_t *pxStats) {
+    pxStats->pcName = xJobs[index].pcName;
+    pxStats->runs = xJobs[index].runs;
+    pxStats->max_us = xJobs[index].max_us;
+}
@@ -0,0 +1,46 @@
+/**
+ * Background jobs run from the idle hook
+ *
+ * Work with no deadline, maintenance scans and the like, registers a job
+ * here instead of getting a task of its own. vIdleJobsRun(), called from
+ * vApplicationIdleHook(), calls the jobs in turn until IDLE_JOB_BUDGET_US
+ * of the pass is used, starting each pass where the last one stopped. The
+ * jobs only get time no task wants, and a task that becomes ready waits at
+ * most for the job step in progress.
+ *
+ * A job runs on the idle task, so it must never block, and it should do
+ * one short step per call. It returns non-zero while it has more to do;
+ * while any job does, xIdleJobsPending() keeps the tickless sleep off.
+ */
+
+#ifndef IDLE_JOBS_H
+#define IDLE_JOBS_H
+
+#include <stdint.h>
+
+#define IDLE_JOB_MAX                   6
+#define IDLE_JOB_BUDGET_US             200   // Per pass round the idle loop
+
+/* One step, non-zero if there is more to do */
+typedef int (*IdleJobFunction_t)(void);
+
+typedef struct {
+    const char *pcName;
+    uint32_t runs;                     // Steps since boot
+    uint32_t max_us;                   // Longest step
+} IdleJobStats_t;
+
+/* Add a job, before the scheduler starts. Returns 0 on success. */
+int xIdleJobRegister(const char *pcName, IdleJobFunction_t pxFunction);
+
+/* Idle hook: one budgeted pass */
+void vIdleJobsRun(void);
+
+/* Some job had more to do at the end of the last pass */
+int xIdleJobsPending(void);
+
+/* Registered jobs, for the statistics report */
+uint32_t ulIdleJobCount(void);
+void vIdleJobGetStats(uint32_t index, IdleJobStats_t *pxStats);
+
+#endif /* IDLE_JOBS_H */
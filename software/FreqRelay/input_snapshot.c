@@ -0,0 +1,34 @@
+/**
+ * Input snapshot
+ *
+ * See input_snapshot.h.
+ */
+
+/* Application includes */
+#include "board_io.h"
+#include "input_snapshot.h"
+#include "latency.h"
+#include "load_output.h"
+#include "seqlock.h"
+
+static SeqLock_t xLock = SEQLOCK_INIT;
+static InputSnapshot_t xSnapshot;
+
+void vInputSnapshotTake(TickType_t xTick) {
+    InputSnapshot_t xNew;
+
+    /* Read back to back, then published in one write */
+    xNew.stamp = ulLatencyNow();
+    xNew.switches = ulBoardSwitches();
+    xNew.driven = xOutputDriven();
+    xNew.feedback = xBoardLoadFeedback(xNew.driven);
+    xNew.tick = xTick;
+
+    vSeqWriteBeginFromISR(&xLock);
+    xSnapshot = xNew;
+    vSeqWriteEndFromISR(&xLock);
+}
+
+void vInputSnapshotGet(InputSnapshot_t *pxCopy) {
+    vSeqRead(&xLock, pxCopy, &xSnapshot, sizeof(*pxCopy));
+}
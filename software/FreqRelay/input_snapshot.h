@@ -0,0 +1,41 @@
+/**
+ * Input snapshot
+ *
+ * The input PIOs the control logic reads - the slide switches and the
+ * actuator feedback - are read together once a tick, first thing in the
+ * tick hook, with one capture stamp, and published as one snapshot under
+ * a sequence lock. The switch debounce and override, and the monitor's
+ * feedback check, take a copy and decide on it instead of reading the
+ * PIOs themselves, so every consumer within a tick sees the same inputs,
+ * and the feedback comes with the outputs that were driven when it was
+ * read.
+ *
+ * The push buttons are left to their ISR: the PIO's edge capture holds a
+ * press until the ISR clears it, which a level read once a tick could
+ * miss. The frequency counts have their own capture stamps in the sample
+ * rings.
+ */
+
+#ifndef INPUT_SNAPSHOT_H
+#define INPUT_SNAPSHOT_H
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "load_mask.h"
+
+typedef struct {
+    uint32_t stamp;                    // ulLatencyNow() at the reads
+    TickType_t tick;                   // Tick it was taken in
+    uint32_t switches;                 // Slide switch PIO
+    LoadMask_t driven;                 // Load outputs as driven at the read
+    LoadMask_t feedback;               // xBoardLoadFeedback() of them
+} InputSnapshot_t;
+
+/* Read the inputs and publish them. Tick hook, and once in main before
+ * the scheduler starts. */
+void vInputSnapshotTake(TickType_t xTick);
+
+/* Copy of the newest snapshot */
+void vInputSnapshotGet(InputSnapshot_t *pxCopy);
+
+#endif /* INPUT_SNAPSHOT_H */
@@ -0,0 +1,206 @@
+/**
+ * Background memory integrity checks
+ *
+ * See integrity.h.
+ */
+
+/* Scheduler includes */
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/* Hardware includes */
+#include "io.h"
+
+/* Application includes */
+#include "crc32.h"
+#include "idle_jobs.h"
+#include "integrity.h"
+
+/* From the linker script */
+extern char __ram_exceptions_start[];
+extern char __ram_exceptions_end[];
+extern char stext[];
+extern char etext[];
+extern char __ram_rodata_start[];
+extern char __ram_rodata_end[];
+
+typedef struct {
+    const char *pcName;
+    uint32_t start;                    // First word's address
+    uint32_t words;
+    uint32_t reference;
+    uint32_t last;
+} Region_t;
+
+static uint32_t ulCrcTable[4][256];    // Slice-by-4, [0] the byte-wise table
+static Region_t xRegions[INTEGRITY_REGIONS];
+static uint32_t ulRegionCount = 0;
+static volatile uint32_t ulRebase = 0;  // Bit per region, changed in critical sections
+static volatile uint32_t ulFailed = 0;
+static IntegrityStats_t xStats;
+
+/* Idle job only: the pass in progress */
+static uint32_t ulRegion;
+static uint32_t ulWord;
+static uint32_t ulCrc;
+static uint8_t xFresh;                 // This pass is the region's new reference
+static uint8_t xCycleOpen = 0;
+static uint8_t xStarted = 0;
+static TickType_t xCycleStart;
+
+/* Carry crc over words words from address, read around the data cache */
+static uint32_t ulIntegrityCrc(uint32_t crc, uint32_t address, uint32_t words) {
+    while (words--) {
+        crc ^= IORD_32DIRECT(address, 0);
+        address += sizeof(uint32_t);
+        crc = ulCrcTable[3][crc & 0xFF] ^ ulCrcTable[2][(crc >> 8) & 0xFF] ^
+              ulCrcTable[1][(crc >> 16) & 0xFF] ^ ulCrcTable[0][crc >> 24];
+    }
+    return crc;
+}
+
+/* First word of a region's pass: is it a rebase? */
+static void vIntegrityBegin(void) {
+    uint32_t bit = 1UL << ulRegion;
+
+    taskENTER_CRITICAL();
+    xFresh = (ulRebase & bit) != 0;
+    ulRebase &= ~bit;
+    taskEXIT_CRITICAL();
+    ulWord = 0;
+    ulCrc = CRC32_INIT;
+}
+
+/* Last word of a region's pass: compare it, or keep it as the reference */
+static void vIntegrityEnd(void) {
+    Region_t *pxRegion = &xRegions[ulRegion];
+    uint32_t bit = 1UL << ulRegion, crc = ~ulCrc;
+
+    taskENTER_CRITICAL();
+    if (ulRebase & bit) {
+        /* Rewritten during the pass: the next one is the reference */
+    } else if (xFresh) {
+        pxRegion->reference = crc;
+        xStats.rebased++;
+    } else if (crc != pxRegion->reference) {
+        ulFailed |= bit;
+    }
+    taskEXIT_CRITICAL();
+    pxRegion->last = crc;
+}
+
+static int xIntegrityJob(void) {
+    TickType_t xNow = xTaskGetTickCount();
+    uint32_t words, elapsed_ms;
+
+    if (!xCycleOpen) {
+        if (ulRegionCount == 0 ||
+            (xStarted && (TickType_t)(xNow - xCycleStart) < pdMS_TO_TICKS(INTEGRITY_PERIOD_MS))) {
+            return 0;
+        }
+        xStarted = 1;
+        xCycleOpen = 1;
+        xCycleStart = xNow;
+        ulRegion = 0;
+        vIntegrityBegin();
+    }
+
+    words = xRegions[ulRegion].words - ulWord;
+    if (words > INTEGRITY_CHUNK_BYTES / sizeof(uint32_t)) {
+        words = INTEGRITY_CHUNK_BYTES / sizeof(uint32_t);
+    }
+    ulCrc = ulIntegrityCrc(ulCrc, xRegions[ulRegion].start + ulWord * sizeof(uint32_t), words);
+    ulWord += words;
+    if (ulWord < xRegions[ulRegion].words) {
+        return 1;
+    }
+
+    vIntegrityEnd();
+    if (++ulRegion < ulRegionCount) {
+        vIntegrityBegin();
+        return 1;
+    }
+
+    /* Single words, read without a snapshot */
+    xCycleOpen = 0;
+    elapsed_ms = (uint32_t)(xTaskGetTickCount() - xCycleStart) * portTICK_PERIOD_MS;
+    xStats.cycles++;
+    xStats.last_ms = elapsed_ms;
+    if (elapsed_ms > xStats.longest_ms) {
+        xStats.longest_ms = elapsed_ms;
+    }
+    if (elapsed_ms > INTEGRITY_PERIOD_MS) {
+        xStats.late++;
+    }
+    return 0;
+}
+
+int xIntegrityInit(void) {
+    uint32_t i, k, crc;
+
+    for (i = 0; i < 256; i++) {
+        crc = i;
+        for (k = 0; k < 8; k++) {
+            crc = (crc >> 1) ^ (crc & 1 ? 0xEDB88320UL : 0);
+        }
+        ulCrcTable[0][i] = crc;
+    }
+    for (i = 0; i < 256; i++) {
+        for (k = 1; k < 4; k++) {
+            ulCrcTable[k][i] = (ulCrcTable[k - 1][i] >> 8) ^ ulCrcTable[0][ulCrcTable[k - 1][i] & 0xFF];
+        }
+    }
+    return xIdleJobRegister("Scrub", xIntegrityJob);
+}
+
+int xIntegrityAdd(const char *pcName, const void *pvStart, uint32_t bytes) {
+    uint32_t start = ((uint32_t)pvStart + 3) & ~3UL, end = ((uint32_t)pvStart + bytes) & ~3UL;
+    Region_t *pxRegion;
+
+    if (ulRegionCount >= INTEGRITY_REGIONS) {
+        return -1;
+    }
+    pxRegion = &xRegions[ulRegionCount];
+    pxRegion->pcName = pcName;
+    pxRegion->start = start;
+    pxRegion->words = end > start ? (end - start) / sizeof(uint32_t) : 0;
+    pxRegion->reference = ~ulIntegrityCrc(CRC32_INIT, start, pxRegion->words);
+    pxRegion->last = pxRegion->reference;
+    xStats.regions = ++ulRegionCount;
+    xStats.bytes += pxRegion->words * sizeof(uint32_t);
+    return (int)(ulRegionCount - 1);
+}
+
+int xIntegrityAddImage(void) {
+    if (xIntegrityAdd("Vectors", __ram_exceptions_start, __ram_exceptions_end - __ram_exceptions_start) < 0 ||
+        xIntegrityAdd("Code", stext, etext - stext) < 0 ||
+        xIntegrityAdd("Rodata", __ram_rodata_start, __ram_rodata_end - __ram_rodata_start) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+void vIntegrityRebase(int region) {
+    if (region < 0 || (uint32_t)region >= ulRegionCount) {
+        return;
+    }
+    taskENTER_CRITICAL();
+    ulRebase |= 1UL << region;
+    taskEXIT_CRITICAL();
+}
+
+uint32_t ulIntegrityFailed(void) {
+    return ulFailed;
+}
+
+void vIntegrityGetStats(IntegrityStats_t *pxStats) {
+    *pxStats = xStats;
+    pxStats->failed = ulFailed;
+}
+
+void vIntegrityGetRegion(uint32_t region, IntegrityRegion_t *pxRegion) {
+    pxRegion->pcName = xRegions[region].pcName;
+    pxRegion->bytes = xRegions[region].words * sizeof(uint32_t);
+    pxRegion->reference = xRegions[region].reference;
+    pxRegion->last = xRegions[region].last;
+}
@@ -0,0 +1,82 @@
+/**
+ * Background memory integrity checks
+ *
+ * The code image, the constants and the tables the decision reads are
+ * checked against a CRC-32 taken at boot, so a bit that flips in the
+ * on-chip RAM or the SDRAM is found within seconds, not when that cell
+ * is next used. Each region is added with xIntegrityAdd() before the
+ * scheduler starts, which takes its reference. From then on an idle job
+ * (idle_jobs.h) carries the CRC over the regions INTEGRITY_CHUNK_BYTES at
+ * a time, one chunk a step. A step costs the same whatever the image's
+ * size, a few tens of microseconds, and no pass ever runs on the control
+ * path. A cycle over every region starts each INTEGRITY_PERIOD_MS and
+ * normally takes a small part of that. One that takes longer, because the
+ * idle task was starved, is counted as late.
+ *
+ * The chunks are read with ldwio, around the data cache. The check sees
+ * the memory itself, not a line that happens to be cached, and a pass
+ * evicts nothing the control path keeps there. The CRC is crc32.h's,
+ * computed slice-by-4: a word at a time from four 256 entry tables, which
+ * vIntegrityInit() builds.
+ *
+ * A region that is rewritten legitimately at run time (the threshold
+ * copies, the policy's RoC boundary) is re-taken with vIntegrityRebase()
+ * after the write. The next pass over it that starts after the call
+ * becomes its reference instead of being compared, and a pass the call
+ * lands in the middle of is dropped. A region whose CRC differs from its
+ * reference is latched in ulIntegrityFailed(). The system monitor trips
+ * failsafe on it (EVENT_SOURCE_INTEGRITY) and logs LOG_INTEGRITY. A
+ * debugger's software breakpoints rewrite the code, so a session that
+ * sets them trips it too.
+ */
+
+#ifndef INTEGRITY_H
+#define INTEGRITY_H
+
+#include <stdint.h>
+
+#define INTEGRITY_REGIONS              8
+#define INTEGRITY_CHUNK_BYTES          512    // CRC per idle job step
+#define INTEGRITY_PERIOD_MS            2000   // A cycle over every region starts this often
+
+typedef struct {
+    const char *pcName;
+    uint32_t bytes;                    // Checked, whole words
+    uint32_t reference;                // CRC taken at boot or the last rebase
+    uint32_t last;                     // CRC of the last full pass
+} IntegrityRegion_t;
+
+typedef struct {
+    uint32_t regions;
+    uint32_t bytes;                    // All regions, each cycle
+    uint32_t cycles;                   // Completed since boot
+    uint32_t late;                     // Of those, longer than INTEGRITY_PERIOD_MS
+    uint32_t last_ms;                  // Start to end of the last cycle
+    uint32_t longest_ms;
+    uint32_t rebased;                  // Passes taken as the new reference
+    uint32_t failed;                   // Regions latched, bit per region
+} IntegrityStats_t;
+
+/* Build the CRC tables and register the idle job. Before xIntegrityAdd().
+ * Returns 0 on success. */
+int xIntegrityInit(void);
+
+/* Add the exception vectors, the code and the constants, bounds from the
+ * linker script. Returns 0 on success. */
+int xIntegrityAddImage(void);
+
+/* Check bytes from pvStart, trimmed to whole aligned words. Takes the
+ * reference now. Before the scheduler starts. Returns the region number
+ * for vIntegrityRebase(), or -1 if the table is full. */
+int xIntegrityAdd(const char *pcName, const void *pvStart, uint32_t bytes);
+
+/* A task has rewritten the region: take the next pass as its reference */
+void vIntegrityRebase(int region);
+
+/* Regions whose CRC changed, bit per region, latched until reset */
+uint32_t ulIntegrityFailed(void);
+
+void vIntegrityGetStats(IntegrityStats_t *pxStats);
+void vIntegrityGetRegion(uint32_t region, IntegrityRegion_t *pxRegion);
+
+#endif /* INTEGRITY_H */
@@ -0,0 +1,92 @@
+/**
+ * Bounded interrupt handlers with deferred processing
+ *
+ * See irq_defer.h.
+ */
+
+/* Hardware includes */
+#include "sys/alt_irq.h"
+
+/* Application includes */
+#include "fast_mem.h"
+#include "irq_defer.h"
+#include "kernel_trace.h"
+#include "latency.h"
+
+typedef struct {
+    IrqHandler_t handler;
+    void *context;
+    IrqStats_t stats;
+} IrqEntry_t;
+
+/* Touched on every interrupt */
+static FAST_DATA IrqEntry_t xIrqTable[IRQ_MAX];
+static FAST_DATA volatile uint32_t ulDeferDropped = 0;
+
+/* HAL legacy API entry point, id is the IRQ number */
+static void vIrqTrampoline(void *context, alt_u32 id) {
+    IrqEntry_t *pxEntry = (IrqEntry_t *)context;
+    uint32_t start, cycles;
+
+    start = ulLatencyNow();
+#if configUSE_KERNEL_TRACE
+    vKernelTraceEvent(KTRACE_IRQ_ENTER, id);
+#endif
+    pxEntry->handler(pxEntry->context);
+#if configUSE_KERNEL_TRACE
+    vKernelTraceEvent(KTRACE_IRQ_EXIT, id);
+#else
+    (void)id;
+#endif
+    cycles = ulLatencyNow() - start;
+
+    pxEntry->stats.count++;
+    pxEntry->stats.last_cycles = cycles;
+    if (cycles > pxEntry->stats.max_cycles) {
+        pxEntry->stats.max_cycles = cycles;
+    }
+}
+
+int xIrqRegister(uint32_t irq, IrqHandler_t handler, void *context) {
+    IrqEntry_t *pxEntry;
+
+    if (irq >= IRQ_MAX || handler == NULL) {
+        return -1;
+    }
+
+    pxEntry = &xIrqTable[irq];
+    pxEntry->handler = handler;
+    pxEntry->context = context;
+    pxEntry->stats.count = 0;
+    pxEntry->stats.max_cycles = 0;
+    pxEntry->stats.last_cycles = 0;
+    return alt_irq_register(irq, pxEntry, vIrqTrampoline);
+}
+
+BaseType_t xIrqDefer(PendedFunction_t fn, void *pv, uint32_t ul, BaseType_t *pxHigherPriorityTaskWoken) {
+    alt_irq_context context;
+
+    if (xTimerPendFunctionCallFromISR(fn, pv, ul, pxHigherPriorityTaskWoken) != pdPASS) {
+        /* Handlers nest, the count is shared by all of them */
+        context = alt_irq_disable_all();
+        ulDeferDropped++;
+        alt_irq_enable_all(context);
+        return pdFAIL;
+    }
+    return pdPASS;
+}
+
+void vIrqGetStats(uint32_t irq, IrqStats_t *pxStats) {
+    alt_irq_context context;
+
+    if (irq >= IRQ_MAX) {
+        return;
+    }
+    context = alt_irq_disable_all();
+    *pxStats = xIrqTable[irq].stats;
+    alt_irq_enable_all(context);
+}
+
+uint32_t ulIrqDeferDropped(void) {
+    return ulDeferDropped;
+}
@@ -0,0 +1,47 @@
+/**
+ * Bounded interrupt handlers with deferred processing
+ *
+ * Handlers registered through xIrqRegister run behind a trampoline that
+ * times them on the timestamp timer, so the longest time any one IRQ has
+ * held the CPU at interrupt level is known per source. Handlers at the
+ * priority of FREQUENCY_ANALYSER_IRQ or above delay it, see
+ * vPortIrqDispatch(); a handler that was preempted has the time of the
+ * handlers nested in it counted in its own.
+ *
+ * A handler should only capture and acknowledge the hardware and hand the
+ * rest to xIrqDefer, which queues a function call for the timer daemon. The
+ * daemon is the highest priority task (see configTIMER_TASK_PRIORITY), so
+ * deferred work still runs ahead of every application task, but with
+ * interrupts enabled and in task context.
+ */
+
+#ifndef IRQ_DEFER_H
+#define IRQ_DEFER_H
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/timers.h"
+
+#define IRQ_MAX                        32
+
+/* Interrupt level handler, context is what was given at registration */
+typedef void (*IrqHandler_t)(void *context);
+
+typedef struct {
+    uint32_t count;                    // Times the handler ran
+    uint32_t max_cycles;               // Longest run, timestamp counts
+    uint32_t last_cycles;              // Most recent run
+} IrqStats_t;
+
+/* Register a timed handler for an IRQ. Returns 0 on success. */
+int xIrqRegister(uint32_t irq, IrqHandler_t handler, void *context);
+
+/* From a handler: run fn(pv, ul) in the timer daemon. Returns pdFAIL and
+ * counts a drop if the daemon's queue is full. */
+BaseType_t xIrqDefer(PendedFunction_t fn, void *pv, uint32_t ul, BaseType_t *pxHigherPriorityTaskWoken);
+
+/* Copy of one IRQ's timing, and the number of deferred calls dropped */
+void vIrqGetStats(uint32_t irq, IrqStats_t *pxStats);
+uint32_t ulIrqDeferDropped(void);
+
+#endif /* IRQ_DEFER_H */
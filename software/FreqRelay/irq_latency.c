@@ -0,0 +1,103 @@
+/**
+ * Interrupt latency measured against a hardware edge
+ *
+ * See irq_latency.h.
+ */
+
+/* Standard includes */
+#include <string.h>
+
+/* Hardware includes */
+#include "system.h"
+#include "sys/alt_irq.h"
+#ifdef LATENCY_TIMER_BASE
+#include "altera_avalon_timer_regs.h"
+#endif
+
+/* Application includes */
+#include "fast_mem.h"
+#include "irq_defer.h"
+#include "irq_latency.h"
+#include "seqlock.h"
+
+static SeqLock_t xLatencyLock = SEQLOCK_INIT;
+static FAST_DATA IrqLatencyStats_t xStats;
+
+#if FREQ_IRQ_LATENCY
+
+#define LATENCY_TICKS_PER_US           (LATENCY_TIMER_FREQ / 1000000UL)
+#define LATENCY_PERIOD_TICKS           (IRQ_LATENCY_PERIOD_US * LATENCY_TICKS_PER_US)
+
+static uint32_t ulLatencyBin(uint32_t ns) {
+    uint32_t us = ns / 1000, bin;
+
+    if (us == 0) {
+        return 0;
+    }
+    bin = 32 - (uint32_t)__builtin_clz(us);
+    return bin < IRQ_LATENCY_BINS ? bin : IRQ_LATENCY_BINS - 1;
+}
+
+/* Snapshot first: everything before it is the latency */
+static void vIrqLatencyISRHandler(void *context) {
+    uint32_t remaining, ns;
+
+    IOWR_ALTERA_AVALON_TIMER_SNAPL(LATENCY_TIMER_BASE, 0);
+    remaining = IORD_ALTERA_AVALON_TIMER_SNAPL(LATENCY_TIMER_BASE) |
+                IORD_ALTERA_AVALON_TIMER_SNAPH(LATENCY_TIMER_BASE) << 16;
+    IOWR_ALTERA_AVALON_TIMER_STATUS(LATENCY_TIMER_BASE, 0);
+
+    /* The counter reloaded with period - 1 at the edge and counts down */
+    ns = (LATENCY_PERIOD_TICKS - 1 - remaining) * 1000UL / LATENCY_TICKS_PER_US;
+
+    vSeqWriteBeginFromISR(&xLatencyLock);
+    if (xStats.count == 0 || ns < xStats.min_ns) {
+        xStats.min_ns = ns;
+    }
+    if (ns > xStats.max_ns) {
+        xStats.max_ns = ns;
+    }
+    if (ns > IRQ_LATENCY_LIMIT_US * 1000UL) {
+        xStats.over_limit++;
+    }
+    xStats.total_ns += ns;
+    xStats.hist[ulLatencyBin(ns)]++;
+    xStats.count++;
+    vSeqWriteEndFromISR(&xLatencyLock);
+}
+
+int xIrqLatencyInit(void) {
+    memset(&xStats, 0, sizeof(xStats));
+
+    IOWR_ALTERA_AVALON_TIMER_CONTROL(LATENCY_TIMER_BASE, ALTERA_AVALON_TIMER_CONTROL_STOP_MSK);
+    IOWR_ALTERA_AVALON_TIMER_STATUS(LATENCY_TIMER_BASE, 0);
+    IOWR_ALTERA_AVALON_TIMER_PERIODL(LATENCY_TIMER_BASE, (LATENCY_PERIOD_TICKS - 1) & 0xFFFF);
+    IOWR_ALTERA_AVALON_TIMER_PERIODH(LATENCY_TIMER_BASE, (LATENCY_PERIOD_TICKS - 1) >> 16);
+
+    vPortSetIrqPriority(LATENCY_TIMER_IRQ, IRQ_LATENCY_PRIORITY);
+    if (xIrqRegister(LATENCY_TIMER_IRQ, vIrqLatencyISRHandler, NULL) != 0) {
+        return -1;
+    }
+    IOWR_ALTERA_AVALON_TIMER_CONTROL(LATENCY_TIMER_BASE, ALTERA_AVALON_TIMER_CONTROL_ITO_MSK |
+                                                         ALTERA_AVALON_TIMER_CONTROL_CONT_MSK |
+                                                         ALTERA_AVALON_TIMER_CONTROL_START_MSK);
+    return 0;
+}
+
+#else
+int xIrqLatencyInit(void) {
+    return -1;
+}
+#endif
+
+void vIrqLatencyGetStats(IrqLatencyStats_t *pxStats) {
+    vSeqRead(&xLatencyLock, pxStats, &xStats, sizeof(IrqLatencyStats_t));
+}
+
+void vIrqLatencyReset(void) {
+    alt_irq_context irq;
+
+    irq = alt_irq_disable_all();
+    memset(&xStats, 0, sizeof(xStats));
+    alt_irq_enable_all(irq);
+}
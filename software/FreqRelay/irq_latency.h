@@ -0,0 +1,68 @@
+/**
+ * Interrupt latency measured against a hardware edge
+ *
+ * An interrupt latency test build ("make irqlat", FREQ_IRQ_LATENCY) runs a
+ * spare altera_avalon_timer, LATENCY_TIMER in system.h, as a free-running
+ * continuous timer whose timeout raises an interrupt every
+ * IRQ_LATENCY_PERIOD_US. The timeout is the edge, and its time is kept in
+ * hardware: the counter reloads and runs on, so the handler's first act is
+ * to snapshot it, and the counts since the reload are the time from the
+ * edge to that instruction. That takes in the interrupt entry, the port's
+ * dispatch (vPortIrqDispatch), the irq_defer.h trampoline, any handler at
+ * the same or a higher priority that was running, and every critical
+ * section in the kernel or the application that held interrupts off when
+ * the edge came - which a trigger written by software never can, since it
+ * only runs with interrupts on.
+ *
+ * The period is prime to the tick and to the sample rate, so over a run
+ * the edges fall at every phase of the relay's own work, the relay running
+ * as it always does. The handler runs at IRQ_LATENCY_PRIORITY, that of the
+ * frequency analyser, so the result is the latency the analyser sees.
+ *
+ * The latencies go into a histogram in doublings from 1 us, with the
+ * extremes and the mean; the run stats report prints it. A latency should
+ * be well under a period: one over a period cannot be told from a short
+ * one and is counted short.
+ */
+
+#ifndef IRQ_LATENCY_H
+#define IRQ_LATENCY_H
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "system.h"
+
+#ifndef FREQ_IRQ_LATENCY
+#define FREQ_IRQ_LATENCY               0
+#endif
+#if FREQ_IRQ_LATENCY && !defined(LATENCY_TIMER_BASE)
+#error "FREQ_IRQ_LATENCY needs a spare interval timer, LATENCY_TIMER in system.h"
+#endif
+
+#ifndef IRQ_LATENCY_PERIOD_US
+#define IRQ_LATENCY_PERIOD_US          997    // Prime, drifts over the 1 ms tick
+#endif
+#define IRQ_LATENCY_PRIORITY           configMAX_SYSCALL_INTERRUPT_PRIORITY  // The analyser's
+#define IRQ_LATENCY_LIMIT_US           50     // Latencies over this are counted
+#define IRQ_LATENCY_BINS               8      // Bin 0 under 1 us, bin n under 1 << n us, the last open
+
+typedef struct {
+    uint32_t count;
+    uint32_t min_ns;
+    uint32_t max_ns;
+    uint64_t total_ns;
+    uint32_t over_limit;               // Over IRQ_LATENCY_LIMIT_US
+    uint32_t hist[IRQ_LATENCY_BINS];
+} IrqLatencyStats_t;
+
+/* Start the timer and register its handler. Returns 0 on success, or -1
+ * in a build without the test. */
+int xIrqLatencyInit(void);
+
+/* Consistent copy of the latencies so far */
+void vIrqLatencyGetStats(IrqLatencyStats_t *pxStats);
+
+/* Forget every latency so far */
+void vIrqLatencyReset(void);
+
+#endif /* IRQ_LATENCY_H */
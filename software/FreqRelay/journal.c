@@ -0,0 +1,169 @@
+/**
+ * Input journal
+ *
+ * See journal.h.
+ */
+
+/* Standard includes */
+#include <stdio.h>
+
+/* Scheduler includes */
+#include "freertos/FreeRTOS.h"
+
+/* Hardware includes */
+#include "system.h"
+#include "io.h"
+#include "sys/alt_irq.h"
+#include "altera_up_avalon_video_pixel_buffer_dma.h"
+
+/* Application includes */
+#include "fast_mem.h"
+#include "journal.h"
+#include "latency.h"
+#include "telemetry.h"
+#include "time_base.h"
+
+#define JOURNAL_SPAN                   (JOURNAL_ROWS * JOURNAL_ROW_BYTES)
+#define JOURNAL_FRAME_BYTES            (480 * JOURNAL_ROW_BYTES)  // One frame in X-Y mode
+
+typedef enum {
+    JOURNAL_OFF = 0,
+    JOURNAL_RECORDING,
+    JOURNAL_TRIGGERED,                 // Recording up to ulStop
+    JOURNAL_FROZEN                     // Waiting for a dump
+} JournalState_t;
+
+/* Written with interrupts disabled, records are claimed in order. The ring
+ * index is free-running. */
+static FAST_DATA volatile JournalState_t xState = JOURNAL_OFF;
+static FAST_DATA uint32_t ulBase = 0;
+static FAST_DATA uint32_t ulHead = 0;
+static FAST_DATA uint32_t ulStop = 0;
+static FAST_DATA uint32_t ulTriggerAt = 0;
+static FAST_DATA uint64_t ullLast = 0;  // Time of the newest record
+static FAST_DATA volatile int xCheckpointDue = 0;
+
+/* Record n's address: JOURNAL_ROW_RECORDS to a row's tail */
+static inline uint32_t ulSlot(uint32_t n) {
+    n &= JOURNAL_RECORDS - 1;
+    return ulBase + (n / JOURNAL_ROW_RECORDS) * JOURNAL_ROW_BYTES + JOURNAL_TAIL_OFFSET +
+           (n % JOURNAL_ROW_RECORDS) * 8;
+}
+
+/* With interrupts disabled */
+static inline void vStore(uint32_t word0, uint32_t value) {
+    uint32_t slot = ulSlot(ulHead);
+
+    IOWR_32DIRECT(slot, 0, word0);
+    IOWR_32DIRECT(slot, 4, value);
+    ulHead++;
+    if ((ulHead & (JOURNAL_CHECKPOINT_RECORDS - 1)) == 0) {
+        xCheckpointDue = 1;
+    }
+    if (xState == JOURNAL_TRIGGERED && ulHead == ulStop) {
+        xState = JOURNAL_FROZEN;
+    }
+}
+
+void vJournalRecord(uint32_t type, uint32_t arg, uint32_t value) {
+    alt_irq_context context;
+    uint64_t now, delta;
+
+    context = alt_irq_disable_all();
+    if (xState == JOURNAL_RECORDING || xState == JOURNAL_TRIGGERED) {
+        now = ullTimeNow();
+        delta = now - ullLast;
+        ullLast = now;
+        if (delta > JOURNAL_DELTA_MASK) {
+            vStore((uint32_t)JOURNAL_TIME << 28, (uint32_t)(delta >> JOURNAL_DELTA_BITS));
+            delta &= JOURNAL_DELTA_MASK;
+        }
+        if (xState != JOURNAL_FROZEN) {
+            vStore((type << 28) | ((arg & 0xF) << 24) | (uint32_t)delta, value);
+        }
+    }
+    alt_irq_enable_all(context);
+}
+
+static int xOverlaps(uint32_t frame, uint32_t frame_base) {
+    return frame != frame_base && frame < frame_base + JOURNAL_SPAN &&
+           frame + JOURNAL_FRAME_BYTES > frame_base;
+}
+
+int xJournalInit(uint32_t frame_base) {
+    alt_up_pixel_buffer_dma_dev *pxPixelBuf = alt_up_pixel_buffer_dma_open_dev(VIDEO_PIXEL_BUFFER_DMA_NAME);
+
+    xState = JOURNAL_OFF;
+    if (pxPixelBuf == NULL || pxPixelBuf->addressing_mode != ALT_UP_PIXEL_BUFFER_XY_ADDRESS_MODE ||
+        (1UL << pxPixelBuf->y_coord_offset) != JOURNAL_ROW_BYTES ||
+        pxPixelBuf->x_resolution << pxPixelBuf->x_coord_offset > JOURNAL_TAIL_OFFSET ||
+        xOverlaps(pxPixelBuf->buffer_start_address, frame_base) ||
+        xOverlaps(pxPixelBuf->back_buffer_start_address, frame_base)) {
+        return -1;
+    }
+
+    ulBase = frame_base;
+    ulHead = 0;
+    ulStop = 0;
+    ulTriggerAt = 0;
+    ullLast = ullTimeNow();
+    xCheckpointDue = 1;
+    xState = JOURNAL_RECORDING;
+    return 0;
+}
+
+int xJournalCheckpointDue(void) {
+    return xCheckpointDue;
+}
+
+void vJournalCheckpoint(uint32_t requested) {
+    xCheckpointDue = 0;
+    vJournalRecord(JOURNAL_CHECKPOINT, 0, requested);
+}
+
+void vJournalTrigger(uint32_t reason) {
+    alt_irq_context context;
+
+    context = alt_irq_disable_all();
+    if (xState == JOURNAL_RECORDING) {
+        ulTriggerAt = ulHead;
+        ulStop = ulHead + JOURNAL_POST_RECORDS;
+        xState = JOURNAL_TRIGGERED;
+    }
+    alt_irq_enable_all(context);
+
+    vJournalRecord(JOURNAL_TRIGGER, 0, reason);
+}
+
+int xJournalFrozen(void) {
+    return xState == JOURNAL_FROZEN;
+}
+
+void vJournalDump(void) {
+    alt_irq_context context;
+    uint32_t first, n, j, slot;
+
+    if (xState != JOURNAL_FROZEN) {
+        return;
+    }
+
+    n = ulHead < JOURNAL_RECORDS ? ulHead : JOURNAL_RECORDS;
+    first = ulHead - n;
+
+    xTelemetryUartTake(portMAX_DELAY);
+    printf("#JOURNAL,%d,%lu,%lu,%lu\n", JOURNAL_VERSION, (unsigned long)ulLatencyCountsPerUs(),
+           (unsigned long)n, (unsigned long)(ulTriggerAt - first));
+    for (j = first; j != ulHead; j++) {
+        slot = ulSlot(j);
+        printf("J,%08lx,%08lx\n", (unsigned long)IORD_32DIRECT(slot, 0), (unsigned long)IORD_32DIRECT(slot, 4));
+    }
+    printf("#JOURNAL,end\n");
+    vTelemetryUartGive();
+
+    context = alt_irq_disable_all();
+    ulHead = 0;
+    ullLast = ullTimeNow();
+    xCheckpointDue = 1;
+    xState = JOURNAL_RECORDING;
+    alt_irq_enable_all(context);
+}
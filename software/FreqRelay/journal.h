@@ -0,0 +1,119 @@
+/**
+ * Input journal
+ *
+ * A record of everything the relay takes in from outside that decides what
+ * it does: each period count as the frequency ISR reads it, the slide
+ * switches and push button edges, the PS/2 keys as the threshold editor
+ * takes them, the actuator feedback as the monitor reads it, the
+ * thresholds as they are applied (from the keys, the shell or Modbus), and
+ * the tick each load decision ran at. With the decisions that changed the
+ * loads alongside, a journal frozen after an incident replays through the
+ * host build of the same estimator, policy and decision sources
+ * (sim/replay.c -J) and shows where the replay and the relay part.
+ *
+ * It is always on, so a record has to be cheap: two uncached stores and a
+ * subtraction inside a few instructions with interrupts disabled, the
+ * kernel trace's way of claiming a slot, which on a Nios II without atomic
+ * instructions is also the cheapest. Each record is two words:
+ *
+ *   word 0  type << 28 | argument << 24 | delta
+ *   word 1  value
+ *
+ * where delta is the timestamp counts (ullTimeNow) since the record before.
+ * A gap of 2^24 counts (168 ms at 100 MHz) or more is carried by a
+ * JOURNAL_TIME record first, its value the gap in units of 2^24 counts, so
+ * times add up exactly over any length of journal.
+ *
+ * The ring is the SRAM nobody else uses: the last KB of each of the first
+ * JOURNAL_ROWS 4 KB rows of the scan-out frame. A frame in X-Y mode gives
+ * every row 1024 pixels of address space and scans out, clears and draws
+ * only the first 640, so past 768 pixels the rows are free; xJournalInit()
+ * checks the pixel buffer before taking them. Being spread over rows the
+ * pixel DMA does not read there, the records cost the scan-out nothing.
+ *
+ * The relay decides from the estimator's window as well as its present
+ * input, so the analyser adds a JOURNAL_CHECKPOINT, the loads requested,
+ * with the thresholds, at the first decision in every quarter of the ring
+ * that leaves nothing pending: stable, no reconnection hold-off, no load
+ * held by its minimum on or off time. A replay starts from the oldest one.
+ *
+ * vJournalTrigger() (the failsafe entry, or the shell's journal command)
+ * records JOURNAL_POST_RECORDS more and freezes the ring, which the run
+ * stats task then dumps on the JTAG UART as text before rearming it:
+ *
+ *   #JOURNAL,<version>,<counts per us>,<records>,<trigger record>
+ *   J,<word 0>,<word 1>                oldest first, hex
+ *   #JOURNAL,end
+ */
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdint.h>
+
+#define JOURNAL_VERSION                1
+#define JOURNAL_ROW_BYTES              4096  // X-Y mode, 1024 4-byte pixels a row
+#define JOURNAL_TAIL_OFFSET            3072  // Past 768 pixels
+#define JOURNAL_TAIL_BYTES             (JOURNAL_ROW_BYTES - JOURNAL_TAIL_OFFSET)
+#define JOURNAL_ROWS                   256   // Of the frame's 480
+#define JOURNAL_ROW_RECORDS            (JOURNAL_TAIL_BYTES / 8)
+#define JOURNAL_RECORDS                (JOURNAL_ROWS * JOURNAL_ROW_RECORDS)
+#define JOURNAL_POST_RECORDS           (JOURNAL_RECORDS / 8)  // Kept after the trigger
+#define JOURNAL_CHECKPOINT_RECORDS     (JOURNAL_RECORDS / 4)  // One checkpoint wanted in each
+#define JOURNAL_DELTA_BITS             24
+#define JOURNAL_DELTA_MASK             ((1UL << JOURNAL_DELTA_BITS) - 1)
+
+/* Record types, and what the argument and value hold */
+#define JOURNAL_TIME                   0x0   // Value: gap in 2^24 counts, added to the next record's delta
+#define JOURNAL_PERIOD                 0x1   // Argument: channel. Value: period count.
+#define JOURNAL_TICK                   0x2   // Value: the tick, in ms, a load decision ran at
+#define JOURNAL_SWITCHES               0x3   // Argument: JOURNAL_SWITCHES_*. Value: all the switches.
+#define JOURNAL_BUTTONS                0x4   // Value: edges captured
+#define JOURNAL_KEY                    0x5   // Value: JOURNAL_KEY_VALUE()
+#define JOURNAL_FEEDBACK               0x6   // Value: loads the actuators report on
+#define JOURNAL_THRESHOLD              0x7   // Argument: channel << 2 | JOURNAL_FIELD_*. Value: Q16.16.
+#define JOURNAL_DECISION               0x8   // Value: loads requested, when the decision changes them
+#define JOURNAL_CHECKPOINT             0x9   // Value: loads requested, nothing pending
+#define JOURNAL_TRIGGER                0xF   // Value: reason
+
+#define JOURNAL_SWITCHES_CHANGED       0     // Seen by the tick hook
+#define JOURNAL_SWITCHES_SETTLED       1     // Read after the debounce
+
+#define JOURNAL_FIELD_UPPER            0
+#define JOURNAL_FIELD_LOWER            1
+#define JOURNAL_FIELD_ROC              2
+
+#define JOURNAL_KEY_VALUE(code, extended, released) \
+    ((uint32_t)(code) | ((uint32_t)(extended) << 8) | ((uint32_t)(released) << 9))
+
+/* Fields of a record */
+#define JOURNAL_TYPE(word0)            ((word0) >> 28)
+#define JOURNAL_ARG(word0)             (((word0) >> 24) & 0xF)
+#define JOURNAL_DELTA(word0)           ((word0) & JOURNAL_DELTA_MASK)
+
+/* Take the ring in the frame at frame_base and start recording. Fails, and
+ * nothing is recorded, if the pixel buffer is not in X-Y mode with rows
+ * short enough, or a frame elsewhere overlaps the ring. */
+int xJournalInit(uint32_t frame_base);
+
+/* One input. Safe from tasks and interrupts. */
+void vJournalRecord(uint32_t type, uint32_t arg, uint32_t value);
+
+/* Non-zero if the ring wants a checkpoint */
+int xJournalCheckpointDue(void);
+
+/* Record a checkpoint: the loads requested, then the caller records the
+ * thresholds */
+void vJournalCheckpoint(uint32_t requested);
+
+/* Freeze the ring JOURNAL_POST_RECORDS after now. Ignored while a trigger
+ * is already pending or the ring has not been dumped since. */
+void vJournalTrigger(uint32_t reason);
+
+/* Non-zero once a triggered ring has frozen and waits for a dump */
+int xJournalFrozen(void);
+
+/* Write the ring on the JTAG UART, then clear and rearm it. Task context. */
+void vJournalDump(void);
+
+#endif /* JOURNAL_H */
@@ -0,0 +1,199 @@
+/**
+ * Blocking JTAG UART output for tasks
+ *
+ * See jtag_uart.h.
+ */
+
+/* Standard includes */
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+
+/* Scheduler includes */
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+/* Hardware includes */
+#include "system.h"
+#include "sys/alt_alarm.h"
+#include "priv/alt_file.h"
+#include "altera_avalon_jtag_uart.h"
+#include "altera_avalon_jtag_uart_fd.h"
+#include "altera_avalon_jtag_uart_regs.h"
+
+/* Application includes */
+#include "irq_defer.h"
+#include "jtag_uart.h"
+
+/* Free-running indices: any writer claims head inside a critical section,
+ * the interrupt is the only consumer */
+typedef struct {
+    uint32_t head;
+    volatile uint32_t tail;
+    uint8_t data[JTAG_UART_RING_SIZE];
+} JtagRing_t;
+
+/* The interrupt is the only producer, xJtagUartGetChar() the consumer */
+typedef struct {
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    uint8_t data[JTAG_UART_RX_SIZE];
+} JtagRxRing_t;
+
+static JtagRing_t xRing;
+static JtagRxRing_t xRxRing;
+static SemaphoreHandle_t xSpace = NULL;  // Given by the interrupt as the ring drains
+static volatile uint8_t xHostAbsent = 0;
+static uint32_t ulDropped = 0;
+static uint32_t ulRxDropped = 0;
+
+static void vJtagUartISRHandler(void *context) {
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    uint32_t tail = xRing.tail;
+    uint32_t head = xRxRing.head;
+    uint32_t space, data;
+
+    /* Host input first, it has only the FIFO to wait in */
+    data = IORD_ALTERA_AVALON_JTAG_UART_DATA(JTAG_UART_BASE);
+    while (data & ALTERA_AVALON_JTAG_UART_DATA_RVALID_MSK) {
+        if ((head - xRxRing.tail) >= JTAG_UART_RX_SIZE) {
+            ulRxDropped++;
+        } else {
+            xRxRing.data[head & JTAG_UART_RX_MASK] = (uint8_t)(data & ALTERA_AVALON_JTAG_UART_DATA_DATA_MSK);
+            head++;
+        }
+        data = IORD_ALTERA_AVALON_JTAG_UART_DATA(JTAG_UART_BASE);
+    }
+    xRxRing.head = head;
+
+    space = (IORD_ALTERA_AVALON_JTAG_UART_CONTROL(JTAG_UART_BASE) & ALTERA_AVALON_JTAG_UART_CONTROL_WSPACE_MSK) >>
+            ALTERA_AVALON_JTAG_UART_CONTROL_WSPACE_OFST;
+    while (space > 0 && tail != xRing.head) {
+        IOWR_ALTERA_AVALON_JTAG_UART_DATA(JTAG_UART_BASE, xRing.data[tail & JTAG_UART_RING_MASK]);
+        tail++;
+        space--;
+    }
+
+    if (tail != xRing.tail) {
+        xRing.tail = tail;
+        xHostAbsent = 0;
+        xSemaphoreGiveFromISR(xSpace, &xHigherPriorityTaskWoken);
+    }
+
+    /* Writers enable it again with the next byte */
+    if (tail == xRing.head) {
+        IOWR_ALTERA_AVALON_JTAG_UART_CONTROL(JTAG_UART_BASE, ALTERA_AVALON_JTAG_UART_CONTROL_RE_MSK);
+    }
+
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
+static int xJtagUartWrite(alt_fd *fd, const char *ptr, int len) {
+    uint32_t head, n, i;
+    int done = 0;
+
+    for (;;) {
+        taskENTER_CRITICAL();
+        head = xRing.head;
+        n = JTAG_UART_RING_SIZE - (head - xRing.tail);
+        if (n > (uint32_t)(len - done)) {
+            n = (uint32_t)(len - done);
+        }
+        if (n > JTAG_UART_CHUNK) {
+            n = JTAG_UART_CHUNK;
+        }
+        for (i = 0; i < n; i++) {
+            xRing.data[(head + i) & JTAG_UART_RING_MASK] = (uint8_t)ptr[done + (int)i];
+        }
+        if (n != 0) {
+            xRing.head = head + n;
+            IOWR_ALTERA_AVALON_JTAG_UART_CONTROL(JTAG_UART_BASE, ALTERA_AVALON_JTAG_UART_CONTROL_RE_MSK |
+                                                                 ALTERA_AVALON_JTAG_UART_CONTROL_WE_MSK);
+        }
+        taskEXIT_CRITICAL();
+
+        done += (int)n;
+        if (done == len) {
+            return len;
+        }
+        if (n != 0) {
+            continue;
+        }
+
+        /* Ring full */
+        if (fd->fd_flags & O_NONBLOCK) {
+            return done != 0 ? done : -EWOULDBLOCK;
+        }
+        if (xHostAbsent ||
+            xSemaphoreTake(xSpace, pdMS_TO_TICKS(JTAG_UART_HOST_TIMEOUT_MS)) != pdTRUE) {
+            /* Nobody is reading, the caller carries on as if it was sent */
+            xHostAbsent = 1;
+            taskENTER_CRITICAL();
+            ulDropped += (uint32_t)(len - done);
+            taskEXIT_CRITICAL();
+            return len;
+        }
+    }
+}
+
+static int xJtagUartRead(alt_fd *fd, char *ptr, int len) {
+    return 0;
+}
+
+int xJtagUartInit(void) {
+    altera_avalon_jtag_uart_dev *pxDev;
+    TickType_t xStart;
+
+    pxDev = (altera_avalon_jtag_uart_dev *)alt_find_dev(JTAG_UART_NAME, &alt_dev_list);
+    xSpace = xSemaphoreCreateBinary();
+    if (pxDev == NULL || xSpace == NULL) {
+        return -1;
+    }
+    vQueueAddToRegistry(xSpace, "JtagSpace");
+
+    /* Let the BSP driver send what it holds, if a host is reading */
+    xStart = xTaskGetTickCount();
+    while (pxDev->state.tx_out != pxDev->state.tx_in &&
+           (xTaskGetTickCount() - xStart) < pdMS_TO_TICKS(JTAG_UART_HOST_TIMEOUT_MS)) {
+        vTaskDelay(1);
+    }
+
+    /* Its host presence alarm would rewrite the control register */
+    if (pxDev->state.timeout != INT_MAX) {
+        alt_alarm_stop(&pxDev->state.alarm);
+    }
+
+    xRing.head = 0;
+    xRing.tail = 0;
+    xRxRing.head = 0;
+    xRxRing.tail = 0;
+    taskENTER_CRITICAL();
+    IOWR_ALTERA_AVALON_JTAG_UART_CONTROL(JTAG_UART_BASE, ALTERA_AVALON_JTAG_UART_CONTROL_RE_MSK);
+    pxDev->dev.write = xJtagUartWrite;
+    pxDev->dev.read = xJtagUartRead;
+    taskEXIT_CRITICAL();
+
+    vPortSetIrqPriority(JTAG_UART_IRQ, configKERNEL_INTERRUPT_PRIORITY);
+    return xIrqRegister(JTAG_UART_IRQ, vJtagUartISRHandler, NULL);
+}
+
+int xJtagUartGetChar(void) {
+    uint32_t tail = xRxRing.tail;
+    int c;
+
+    if (tail == xRxRing.head) {
+        return -1;
+    }
+    c = xRxRing.data[tail & JTAG_UART_RX_MASK];
+    xRxRing.tail = tail + 1;
+    return c;
+}
+
+uint32_t ulJtagUartDropped(void) {
+    return ulDropped;
+}
+
+uint32_t ulJtagUartRxDropped(void) {
+    return ulRxDropped;
+}
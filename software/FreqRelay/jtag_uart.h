@@ -0,0 +1,52 @@
+/**
+ * Blocking JTAG UART output for tasks
+ *
+ * The BSP's interrupt-driven JTAG UART driver waits for FIFO space in a
+ * polling loop (ALT_SEM and ALT_FLAG are empty in this BSP), so a task
+ * printing into a full FIFO spins at its own priority until the host has
+ * read enough. xJtagUartInit() takes the device over in place: every
+ * descriptor for it, stdout included, then writes into a ring that the
+ * JTAG UART interrupt empties into the FIFO, and a writer that finds the
+ * ring full sleeps on a semaphore the interrupt gives.
+ *
+ * O_NONBLOCK descriptors (the telemetry drain) still get -EWOULDBLOCK
+ * when there is no room. When no host reads the FIFO for
+ * JTAG_UART_HOST_TIMEOUT_MS, output is dropped and counted rather than
+ * delayed, until the host reads again.
+ *
+ * Host input goes the other way, into a receive ring the same interrupt
+ * fills, for xJtagUartGetChar(); what arrives while the ring is full is
+ * dropped and counted. Reads through a descriptor return end of file.
+ *
+ * Ring writes are copied in short critical sections, so any number of
+ * writers is safe; they still hold xTelemetryUartTake() to keep their
+ * lines whole.
+ */
+
+#ifndef JTAG_UART_H
+#define JTAG_UART_H
+
+#include <stdint.h>
+
+#define JTAG_UART_RING_SIZE            1024   // Bytes waiting for the FIFO, power of 2
+#define JTAG_UART_RING_MASK            (JTAG_UART_RING_SIZE - 1)
+#define JTAG_UART_CHUNK                64     // Bytes copied per critical section
+#define JTAG_UART_HOST_TIMEOUT_MS      500    // No FIFO space for this long: host gone
+#define JTAG_UART_RX_SIZE              128    // Host bytes waiting for a reader, power of 2
+#define JTAG_UART_RX_MASK              (JTAG_UART_RX_SIZE - 1)
+
+/* Take the device over from the BSP driver, from a task while holding
+ * xTelemetryUartTake(). Waits for the BSP driver to send what it holds
+ * (at most the host timeout). Returns 0 on success. */
+int xJtagUartInit(void);
+
+/* Next byte from the host, or -1 if none has arrived. One reader. */
+int xJtagUartGetChar(void);
+
+/* Bytes dropped while no host was reading */
+uint32_t ulJtagUartDropped(void);
+
+/* Host bytes dropped with the receive ring full */
+uint32_t ulJtagUartRxDropped(void);
+
+#endif /* JTAG_UART_H */
@@ -0,0 +1,207 @@
+/**
+ * Kernel event recorder
+ *
+ * See kernel_trace.h.
+ */
+
+/* Standard includes */
+#include <stdio.h>
+
+/* Scheduler includes */
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/timers.h"
+
+/* Hardware includes */
+#include "system.h"
+#include "io.h"
+#include "sys/alt_irq.h"
+#include "altera_up_avalon_video_pixel_buffer_dma.h"
+
+/* Application includes */
+#include "kernel_trace.h"
+#include "latency.h"
+#include "run_stats.h"
+#include "telemetry.h"
+
+/* Called from inside the kernel, kept out of the gprof call graph */
+#define KTRACE_HOOK                    __attribute__((no_instrument_function))
+
+#define KTRACE_RING_BASE               (SRAM_BASE + SRAM_SPAN - KTRACE_RING_BYTES)
+#if configUSE_KERNEL_TRACE && configUSE_TLSF_HEAP && configHEAP_SRAM_BYTES > 0 && \
+    configHEAP_SRAM_BASE + configHEAP_SRAM_BYTES > KTRACE_RING_BASE
+#error "configHEAP_SRAM_BYTES overlaps the kernel trace ring"
+#endif
+
+typedef enum {
+    KTRACE_OFF = 0,
+    KTRACE_RECORDING,
+    KTRACE_TRIGGERED,                  // Recording up to ulStop
+    KTRACE_FROZEN                      // Waiting for a dump
+} KernelTraceState_t;
+
+extern volatile uint32_t ulPortInterruptNesting;
+
+/* Written with interrupts disabled, records are claimed in order. The ring
+ * index is free-running. */
+static volatile KernelTraceState_t xState = KTRACE_OFF;
+static uint32_t ulHead = 0;
+static uint32_t ulStop = 0;
+static uint32_t ulTriggerAt = 0;
+static uint8_t ucCurrentTask = 0;
+
+/* Numbers handed out to queues and timers as they are created, which may be
+ * before xKernelTraceInit() */
+static uint32_t ulQueueCount = 0;
+static uint8_t ucQueueType[KTRACE_MAX_QUEUES];
+static uint32_t ulTimerCount = 0;
+static void *pvTimers[KTRACE_MAX_TIMERS];
+
+/* Names for the dump */
+static TaskStatus_t xStatus[RUN_STATS_MAX_TASKS];
+
+static KTRACE_HOOK void vRecord(uint32_t ulType, uint32_t ulTask, uint32_t ulArg) {
+    alt_irq_context context;
+    uint32_t offset;
+
+    context = alt_irq_disable_all();
+    if (xState != KTRACE_OFF && xState != KTRACE_FROZEN) {
+        offset = (ulHead & (KTRACE_EVENTS - 1)) * 8;
+        IOWR_32DIRECT(KTRACE_RING_BASE, offset, ulLatencyNow());
+        IOWR_32DIRECT(KTRACE_RING_BASE, offset + 4, (ulType << 24) | ((ulTask & 0xFF) << 16) | (ulArg & 0xFFFF));
+        ulHead++;
+        if (xState == KTRACE_TRIGGERED && ulHead == ulStop) {
+            xState = KTRACE_FROZEN;
+        }
+    }
+    alt_irq_enable_all(context);
+}
+
+static int xOverlaps(uint32_t ulFrame) {
+    return ulFrame < KTRACE_RING_BASE + KTRACE_RING_BYTES && ulFrame + KTRACE_FRAME_BYTES > KTRACE_RING_BASE;
+}
+
+int xKernelTraceInit(void) {
+    alt_up_pixel_buffer_dma_dev *pxPixelBuf = alt_up_pixel_buffer_dma_open_dev(VIDEO_PIXEL_BUFFER_DMA_NAME);
+
+    /* The frame addresses are the hardware's reset values, both in SRAM
+     * unless the system is regenerated differently */
+    if (pxPixelBuf != NULL && (xOverlaps(pxPixelBuf->buffer_start_address) ||
+                               xOverlaps(pxPixelBuf->back_buffer_start_address))) {
+        return -1;
+    }
+
+    ulHead = 0;
+    xState = KTRACE_RECORDING;
+    return 0;
+}
+
+KTRACE_HOOK void vKernelTraceEvent(uint32_t ulType, uint32_t ulArg) {
+    vRecord(ulType, ulPortInterruptNesting ? KTRACE_TASK_ISR : ucCurrentTask, ulArg);
+}
+
+KTRACE_HOOK void vKernelTraceSwitchedIn(uint32_t ulTaskNumber, uint32_t ulPriority) {
+    /* The hook runs on every scheduling decision, most of which keep the
+     * running task */
+    if ((uint8_t)ulTaskNumber == ucCurrentTask) {
+        return;
+    }
+    ucCurrentTask = (uint8_t)ulTaskNumber;
+    vRecord(KTRACE_SWITCH, ulTaskNumber, ulPriority);
+}
+
+KTRACE_HOOK uint32_t ulKernelTraceQueueCreated(uint32_t ulQueueType) {
+    alt_irq_context context;
+    uint32_t number;
+
+    context = alt_irq_disable_all();
+    number = ++ulQueueCount;
+    if (number <= KTRACE_MAX_QUEUES) {
+        ucQueueType[number - 1] = (uint8_t)ulQueueType;
+    }
+    alt_irq_enable_all(context);
+
+    vKernelTraceEvent(KTRACE_QUEUE_CREATE, number);
+    return number;
+}
+
+KTRACE_HOOK uint32_t ulKernelTraceTimer(void *pvTimer) {
+    alt_irq_context context;
+    uint32_t i;
+
+    /* Lookups come from the timer task only, creation may come from any task */
+    for (i = 0; i < ulTimerCount; i++) {
+        if (pvTimers[i] == pvTimer) {
+            return i + 1;
+        }
+    }
+
+    context = alt_irq_disable_all();
+    if (ulTimerCount < KTRACE_MAX_TIMERS) {
+        pvTimers[ulTimerCount++] = pvTimer;
+        i = ulTimerCount;
+    } else {
+        i = KTRACE_MAX_TIMERS;
+    }
+    alt_irq_enable_all(context);
+
+    vKernelTraceEvent(KTRACE_TIMER_CREATE, i);
+    return i;
+}
+
+void vKernelTraceTrigger(uint32_t ulReason) {
+    alt_irq_context context;
+
+    context = alt_irq_disable_all();
+    if (xState == KTRACE_RECORDING) {
+        ulTriggerAt = ulHead;
+        ulStop = ulHead + KTRACE_POST_EVENTS;
+        xState = KTRACE_TRIGGERED;
+    }
+    alt_irq_enable_all(context);
+
+    vKernelTraceEvent(KTRACE_TRIGGER, ulReason);
+}
+
+int xKernelTraceFrozen(void) {
+    return xState == KTRACE_FROZEN;
+}
+
+void vKernelTraceDump(void) {
+    alt_irq_context context;
+    UBaseType_t count, i;
+    uint32_t first, n, j, offset;
+
+    if (xState != KTRACE_FROZEN) {
+        return;
+    }
+
+    n = ulHead < KTRACE_EVENTS ? ulHead : KTRACE_EVENTS;
+    first = ulHead - n;
+    count = uxTaskGetSystemState(xStatus, RUN_STATS_MAX_TASKS, NULL);
+
+    xTelemetryUartTake(portMAX_DELAY);
+    printf("#KTRACE,%d,%lu,%lu,%lu\n", KTRACE_VERSION, (unsigned long)ulLatencyCountsPerUs(),
+           (unsigned long)n, (unsigned long)(ulTriggerAt - first));
+    for (i = 0; i < count; i++) {
+        printf("N,%lu,%s\n", (unsigned long)xStatus[i].xTaskNumber, xStatus[i].pcTaskName);
+    }
+    for (j = 0; j < ulQueueCount && j < KTRACE_MAX_QUEUES; j++) {
+        printf("Q,%lu,%u\n", (unsigned long)(j + 1), ucQueueType[j]);
+    }
+    for (j = 0; j < ulTimerCount; j++) {
+        printf("R,%lu,%s\n", (unsigned long)(j + 1), pcTimerGetTimerName((TimerHandle_t)pvTimers[j]));
+    }
+    for (j = first; j != ulHead; j++) {
+        offset = (j & (KTRACE_EVENTS - 1)) * 8;
+        printf("E,%08lx,%08lx\n", (unsigned long)IORD_32DIRECT(KTRACE_RING_BASE, offset),
+               (unsigned long)IORD_32DIRECT(KTRACE_RING_BASE, offset + 4));
+    }
+    printf("#KTRACE,end\n");
+    vTelemetryUartGive();
+
+    context = alt_irq_disable_all();
+    ulHead = 0;
+    xState = KTRACE_RECORDING;
+    alt_irq_enable_all(context);
+}
@@ -0,0 +1,100 @@
+/**
+ * Kernel event recorder
+ *
+ * The kernel's trace macros (FreeRTOSConfig.h, configUSE_KERNEL_TRACE) write
+ * timestamped records of context switches, ready list moves, delays, queue
+ * and mutex traffic, task notifications, timer callbacks and interrupts into
+ * a ring of KTRACE_EVENTS records. The ring is the SRAM above the scan-out
+ * frame: a 640x480 frame in X-Y mode covers the first 480 x 4 KB, which
+ * leaves the last 128 KB, and the pixel DMA never reads it. Records are
+ * written with uncached stores so the recorder does not evict the analyzer's
+ * lines from the 2 KB D-cache.
+ *
+ * Each record is two words:
+ *
+ *   word 0  timestamp counts (ulLatencyNow)
+ *   word 1  type << 24 | task << 16 | argument
+ *
+ * where task is the number of the task that was running (uxTCBNumber), or
+ * KTRACE_TASK_ISR from inside an interrupt handler, and the argument depends
+ * on the type - a queue, task, timer or IRQ number, or a priority.
+ *
+ * vKernelTraceTrigger() (the failsafe entry) marks the ring, records for
+ * KTRACE_POST_EVENTS more events and then freezes it, leaving the lead-up
+ * and the first reaction in the buffer. vKernelTraceDump() then writes it on
+ * the JTAG UART as text and rearms the recorder:
+ *
+ *   #KTRACE,<version>,<counts per us>,<events>,<trigger event>
+ *   N,<task number>,<name>
+ *   Q,<queue number>,<queue type>
+ *   R,<timer number>,<name>
+ *   E,<word 0>,<word 1>                oldest first, hex
+ *   #KTRACE,end
+ *
+ * tools/ktrace_decode.py turns a capture into a timeline.
+ */
+
+#ifndef KERNEL_TRACE_H
+#define KERNEL_TRACE_H
+
+#include <stdint.h>
+
+/* No kernel includes: FreeRTOSConfig.h includes this for the event types */
+
+#define KTRACE_VERSION                 1
+#define KTRACE_RING_BYTES              (128 * 1024)  // SRAM above the 480 scan-out rows
+#define KTRACE_FRAME_BYTES             (480 * 4096)  // One frame in X-Y mode, 4-byte pixels
+#define KTRACE_EVENTS                  (KTRACE_RING_BYTES / 8)
+#define KTRACE_POST_EVENTS             (KTRACE_EVENTS / 4)  // Kept after the trigger
+#define KTRACE_MAX_QUEUES              24    // Queue numbers past this are not typed in the dump
+#define KTRACE_MAX_TIMERS              8     // Later timers share the last number
+#define KTRACE_TASK_ISR                0xFF  // Task field inside an interrupt handler
+
+/* Event types */
+#define KTRACE_SWITCH                  0x01  // Argument: priority
+#define KTRACE_READY                   0x02  // Argument: task made ready
+#define KTRACE_DELAY                   0x03
+#define KTRACE_DELAY_UNTIL             0x04
+#define KTRACE_QUEUE_CREATE            0x10  // Argument: queue, for all the queue events
+#define KTRACE_QUEUE_SEND              0x11
+#define KTRACE_QUEUE_SEND_FAILED       0x12
+#define KTRACE_QUEUE_RECEIVE           0x13
+#define KTRACE_QUEUE_RECEIVE_FAILED    0x14
+#define KTRACE_QUEUE_BLOCK_SEND        0x15
+#define KTRACE_QUEUE_BLOCK_RECEIVE     0x16
+#define KTRACE_QUEUE_SEND_ISR          0x17
+#define KTRACE_QUEUE_RECEIVE_ISR       0x18
+#define KTRACE_NOTIFY_TAKE_BLOCK       0x20
+#define KTRACE_NOTIFY_TAKE             0x21  // Argument: notification value
+#define KTRACE_NOTIFY_WAIT_BLOCK       0x22
+#define KTRACE_NOTIFY_WAIT             0x23  // Argument: notification value
+#define KTRACE_NOTIFY                  0x24  // Argument: task notified
+#define KTRACE_NOTIFY_ISR              0x25  // Argument: task notified
+#define KTRACE_TIMER_CREATE            0x30  // Argument: timer
+#define KTRACE_TIMER_EXPIRED           0x31  // Argument: timer
+#define KTRACE_IRQ_ENTER               0x40  // Argument: IRQ
+#define KTRACE_IRQ_EXIT                0x41  // Argument: IRQ
+#define KTRACE_MARK                    0x50  // Application marker, argument is the caller's
+#define KTRACE_TRIGGER                 0x51  // Argument: reason
+
+/* Find the ring and start recording. Fails, and nothing is recorded, if a
+ * pixel buffer frame overlaps the ring. */
+int xKernelTraceInit(void);
+
+/* Kernel hooks, see FreeRTOSConfig.h. Safe from tasks and interrupts. */
+void vKernelTraceEvent(uint32_t ulType, uint32_t ulArg);
+void vKernelTraceSwitchedIn(uint32_t ulTaskNumber, uint32_t ulPriority);
+uint32_t ulKernelTraceQueueCreated(uint32_t ulQueueType);
+uint32_t ulKernelTraceTimer(void *pvTimer);
+
+/* Freeze the ring KTRACE_POST_EVENTS after now. Ignored while a trigger is
+ * already pending or the ring has not been dumped since. */
+void vKernelTraceTrigger(uint32_t ulReason);
+
+/* Non-zero once a triggered ring has frozen and waits for a dump */
+int xKernelTraceFrozen(void);
+
+/* Write the ring on the JTAG UART, then clear and rearm it. Task context. */
+void vKernelTraceDump(void);
+
+#endif /* KERNEL_TRACE_H */
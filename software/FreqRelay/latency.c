@@ -0,0 +1,68 @@
+/**
+ * Control path latency instrumentation
+ *
+ * See latency.h.
+ */
+
+/* Standard includes */
+#include <stdio.h>
+#include <string.h>
+
+/* Application includes */
+#include "latency.h"
+
+/* Timestamp counts per microsecond, set from the timer frequency */
+static uint32_t ulCountsPerUs = 1;
+
+void vLatencyInit(void) {
+    if (alt_timestamp_start() < 0) {
+        printf("Latency: no timestamp timer, measurements disabled\n");
+        return;
+    }
+    ulCountsPerUs = alt_timestamp_freq() / 1000000UL;
+    if (ulCountsPerUs == 0) {
+        ulCountsPerUs = 1;
+    }
+}
+
+uint32_t ulLatencyElapsedUs(uint32_t start, uint32_t end) {
+    /* The counter is free running, unsigned subtraction handles the wrap */
+    return (end - start) / ulCountsPerUs;
+}
+
+uint32_t ulLatencyCountsPerUs(void) {
+    return ulCountsPerUs;
+}
+
+void vLatencyRecord(LatencyStats_t *pxStats, SeqLock_t *pxLock, uint32_t elapsed_us, uint32_t deadline_us) {
+    uint32_t bin = elapsed_us / LATENCY_HIST_BIN_US;
+
+    if (bin >= LATENCY_HIST_BINS) {
+        bin = LATENCY_HIST_BINS - 1;
+    }
+
+    vSeqWriteBegin(pxLock);
+    if (pxStats->count == 0 || elapsed_us < pxStats->min_us) {
+        pxStats->min_us = elapsed_us;
+    }
+    if (elapsed_us > pxStats->max_us) {
+        pxStats->max_us = elapsed_us;
+    }
+    if (elapsed_us > deadline_us) {
+        pxStats->deadline_misses++;
+    }
+    pxStats->total_us += elapsed_us;
+    pxStats->histogram[bin]++;
+    pxStats->recent_us[pxStats->recent_next] = elapsed_us;
+    pxStats->recent_next = (pxStats->recent_next + 1) % LATENCY_RECENT;
+    pxStats->count++;
+    vSeqWriteEnd(pxLock);
+}
+
+void vLatencyGetStats(const LatencyStats_t *pxStats, const SeqLock_t *pxLock, LatencyStats_t *pxCopy) {
+    vSeqRead(pxLock, pxCopy, pxStats, sizeof(LatencyStats_t));
+}
+
+uint32_t ulLatencyMeanUs(const LatencyStats_t *pxStats) {
+    return pxStats->count ? (uint32_t)(pxStats->total_us / pxStats->count) : 0;
+}
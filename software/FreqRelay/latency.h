@@ -0,0 +1,65 @@
+/**
+ * Control path latency instrumentation
+ *
+ * Every frequency sample is stamped with the hardware timestamp timer
+ * (ALT_TIMESTAMP_CLK, timer1us running at the CPU clock) when it is captured
+ * by the ISR, analysed, decided on and written to the load outputs. Completed
+ * measurements feed min/max/mean, a fixed-bin histogram and a short history
+ * of the most recent values for the display.
+ */
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+#include "sys/alt_timestamp.h"
+#include "seqlock.h"
+
+#define LATENCY_RECENT                 5      // Measurements kept for display
+#define LATENCY_HIST_BINS              16     // Last bin also counts overflows
+#define LATENCY_HIST_BIN_US            1000   // Width of one histogram bin (us)
+
+/* Raw timestamp counts taken along the control path */
+typedef struct {
+    uint32_t capture;                  // vFrequencyISRHandler
+    uint32_t analysis;                 // vFrequencyAnalyzerTask
+    uint32_t decision;                 // vMakeLoadDecision
+    uint32_t actuation;                // Load output PIO write
+} LatencyStamp_t;
+
+typedef struct {
+    uint32_t count;                    // Measurements recorded
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t total_us;                 // For the mean
+    uint32_t deadline_misses;          // Measurements over the deadline given at record time
+    uint32_t histogram[LATENCY_HIST_BINS];
+    uint32_t recent_us[LATENCY_RECENT]; // Ring, recent_next is the oldest entry
+    uint32_t recent_next;
+} LatencyStats_t;
+
+/* Start the timestamp timer, call once before the scheduler starts */
+void vLatencyInit(void);
+
+/* Current timestamp count, cheap enough for ISR use. Wraps every 43 s,
+ * see time_base.h for stamps read later. */
+static inline uint32_t ulLatencyNow(void) {
+    return (uint32_t)alt_timestamp();
+}
+
+/* Microseconds between two timestamp counts */
+uint32_t ulLatencyElapsedUs(uint32_t start, uint32_t end);
+
+/* Timestamp counts in one microsecond */
+uint32_t ulLatencyCountsPerUs(void);
+
+/* Add one measurement (single writer per stats object) */
+void vLatencyRecord(LatencyStats_t *pxStats, SeqLock_t *pxLock, uint32_t elapsed_us, uint32_t deadline_us);
+
+/* Consistent copy for readers */
+void vLatencyGetStats(const LatencyStats_t *pxStats, const SeqLock_t *pxLock, LatencyStats_t *pxCopy);
+
+/* Mean of a stats copy, 0 when empty */
+uint32_t ulLatencyMeanUs(const LatencyStats_t *pxStats);
+
+#endif /* LATENCY_H */
@@ -0,0 +1,98 @@
+/**
+ * Per-load operational statistics and shed audit trail
+ *
+ * See load_audit.h.
+ */
+
+/* Standard includes */
+#include <string.h>
+
+/* Application includes */
+#include "load_audit.h"
+#include "seqlock.h"
+
+static SeqLock_t xAuditLock = SEQLOCK_INIT;
+static LoadAudit_t xAudit[LOAD_COUNT];
+static AuditReconnect_t xHistory[AUDIT_HISTORY];
+static uint32_t ulHistoryCount = 0;        // Reconnections since boot
+static LoadMask_t xPrevious = 0;           // Writer only
+
+static const char *const pcReasons[AUDIT_REASONS] = {
+    "boot", "band", "roc", "predict", "curve", "registry", "coord", "failsafe", "override", "reset"
+};
+
+void vLoadAuditInit(LoadMask_t driven, uint32_t now_ms) {
+    uint32_t i;
+
+    memset(xAudit, 0, sizeof(xAudit));
+    memset(xHistory, 0, sizeof(xHistory));
+    ulHistoryCount = 0;
+    for (i = 0; i < LOAD_COUNT; i++) {
+        xAudit[i].changed_ms = now_ms;
+        xAudit[i].off = (driven & xLoadBit(i)) == 0;
+    }
+    xPrevious = driven;
+}
+
+void vLoadAuditUpdate(LoadMask_t driven, uint8_t reason, uint32_t now_ms) {
+    LoadMask_t changed = driven ^ xPrevious;
+    AuditReconnect_t *pxReconnect;
+    LoadAudit_t *pxAudit;
+    uint32_t i;
+
+    if (changed == 0) {
+        return;
+    }
+    xPrevious = driven;
+
+    vSeqWriteBegin(&xAuditLock);
+    for (; changed != 0; changed &= changed - 1) {
+        i = ulLoadFirst(changed);
+        pxAudit = &xAudit[i];
+        if (driven & xLoadBit(i)) {
+            pxAudit->reconnects++;
+            pxAudit->off_ms += now_ms - pxAudit->changed_ms;
+
+            pxReconnect = &xHistory[ulHistoryCount++ & AUDIT_HISTORY_MASK];
+            pxReconnect->at_ms = now_ms;
+            pxReconnect->off_ms = now_ms - pxAudit->changed_ms;
+            pxReconnect->load = (uint8_t)i;
+            pxReconnect->reason = pxAudit->reason;
+            pxAudit->off = 0;
+        } else {
+            pxAudit->sheds++;
+            pxAudit->reason = reason;
+            pxAudit->off = 1;
+        }
+        pxAudit->changed_ms = now_ms;
+    }
+    vSeqWriteEnd(&xAuditLock);
+}
+
+int xLoadAuditGet(uint32_t load, uint32_t now_ms, LoadAudit_t *pxAudit) {
+    if (load >= LOAD_COUNT) {
+        return 0;
+    }
+    vSeqRead(&xAuditLock, pxAudit, &xAudit[load], sizeof(LoadAudit_t));
+    if (pxAudit->off) {
+        pxAudit->off_ms += now_ms - pxAudit->changed_ms;
+    }
+    return 1;
+}
+
+int xLoadAuditReconnect(uint32_t n, AuditReconnect_t *pxReconnect) {
+    uint32_t start, count;
+
+    do {
+        start = ulSeqReadBegin(&xAuditLock);
+        count = ulHistoryCount;
+        if (n < count && n < AUDIT_HISTORY) {
+            *pxReconnect = xHistory[(count - 1 - n) & AUDIT_HISTORY_MASK];
+        }
+    } while (xSeqReadRetry(&xAuditLock, start));
+    return n < count && n < AUDIT_HISTORY;
+}
+
+const char *pcLoadAuditReason(uint8_t reason) {
+    return reason < AUDIT_REASONS ? pcReasons[reason] : "?";
+}
@@ -0,0 +1,78 @@
+/**
+ * Per-load operational statistics and shed audit trail
+ *
+ * For every load: how often it has been shed and reconnected, how long it
+ * has spent off in all, when it last switched, and why it last went off.
+ * The last AUDIT_HISTORY reconnections of any load are kept in order as
+ * well, each with how long that load had been off and why, which is the
+ * trail an audit asks for.
+ *
+ * The actuator calls vLoadAuditUpdate() with the loads driven after each
+ * step. Only the loads in driven ^ previous are visited, lowest first with
+ * ulLoadFirst(), so a step that switches nothing costs one compare and one
+ * that sheds a load costs that load's few stores, whatever LOAD_COUNT.
+ * Nothing ever walks every load on the actuator's side; readers do, at
+ * their own pace.
+ *
+ * Updates come from one task and are written under a sequence lock
+ * (seqlock.h), so a reader takes a consistent copy without holding the
+ * actuator up. A load's current off period is only counted into off_ms
+ * when it comes back; xLoadAuditGet() adds it for the reader.
+ */
+
+#ifndef LOAD_AUDIT_H
+#define LOAD_AUDIT_H
+
+#include <stdint.h>
+#include "load_mask.h"
+
+#define AUDIT_HISTORY                  16     // Reconnections kept, power of 2
+#define AUDIT_HISTORY_MASK             (AUDIT_HISTORY - 1)
+
+/* Why a load went off */
+#define AUDIT_REASON_NONE              0      // Off since boot
+#define AUDIT_REASON_BAND              1      // Policy frequency band
+#define AUDIT_REASON_ROC               2      // Policy RoC band
+#define AUDIT_REASON_PREDICT           3      // Crossing predicted within the lead
+#define AUDIT_REASON_CURVE             4      // Under-frequency stage tripped
+#define AUDIT_REASON_REGISTRY          5      // Registry power selection
+#define AUDIT_REASON_COORD             6      // Stage from the coordination leader
+#define AUDIT_REASON_FAILSAFE          7
+#define AUDIT_REASON_OVERRIDE          8      // Manual switches
+#define AUDIT_REASON_RESET             9      // System reset, staged reconnection
+#define AUDIT_REASONS                  10
+
+typedef struct {
+    uint32_t sheds;
+    uint32_t reconnects;
+    uint32_t off_ms;                   // Total time off, the present period included when read
+    uint32_t changed_ms;               // Last shed or reconnection
+    uint8_t reason;                    // AUDIT_REASON_* of the last shed
+    uint8_t off;                       // Off now
+} LoadAudit_t;
+
+typedef struct {
+    uint32_t at_ms;                    // When it came back
+    uint32_t off_ms;                   // How long it had been off
+    uint8_t load;
+    uint8_t reason;                    // Why it had gone off
+} AuditReconnect_t;
+
+/* Start the counts from the loads driven at boot, those off counted as off
+ * from now */
+void vLoadAuditInit(LoadMask_t driven, uint32_t now_ms);
+
+/* After each actuator step, with what the pins show now and the reason for
+ * any load that has gone off since the last call. One task only. */
+void vLoadAuditUpdate(LoadMask_t driven, uint8_t reason, uint32_t now_ms);
+
+/* One load's counts as of now_ms. Returns 0 for a load out of range. */
+int xLoadAuditGet(uint32_t load, uint32_t now_ms, LoadAudit_t *pxAudit);
+
+/* The n-th newest reconnection, 0 the newest. Returns 0 past the oldest. */
+int xLoadAuditReconnect(uint32_t n, AuditReconnect_t *pxReconnect);
+
+/* Short name of an AUDIT_REASON_* */
+const char *pcLoadAuditReason(uint8_t reason);
+
+#endif /* LOAD_AUDIT_H */
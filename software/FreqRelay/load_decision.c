@@ -0,0 +1,65 @@
+/**
+ * Staged shed and reconnect decision
+ *
+ * See load_decision.h.
+ */
+
+/* Application includes */
+#include "load_decision.h"
+
+/* One port's worth of the default stable time */
+#define RECONNECT_PORT_DELAYS                                                           \
+    RECONNECT_STABLE_MS, RECONNECT_STABLE_MS, RECONNECT_STABLE_MS, RECONNECT_STABLE_MS, \
+    RECONNECT_STABLE_MS, RECONNECT_STABLE_MS, RECONNECT_STABLE_MS, RECONNECT_STABLE_MS, \
+    RECONNECT_STABLE_MS, RECONNECT_STABLE_MS, RECONNECT_STABLE_MS, RECONNECT_STABLE_MS, \
+    RECONNECT_STABLE_MS, RECONNECT_STABLE_MS, RECONNECT_STABLE_MS, RECONNECT_STABLE_MS
+
+/* Stable time each load needs before it is reconnected */
+static const uint16_t usReconnectDelayMs[LOAD_COUNT] = {
+    RECONNECT_PORT_DELAYS,
+#if LOAD_PORTS > 1
+    RECONNECT_PORT_DELAYS,
+#endif
+#if LOAD_PORTS > 2
+    RECONNECT_PORT_DELAYS,
+#endif
+#if LOAD_PORTS > 3
+    RECONNECT_PORT_DELAYS,
+#endif
+};
+
+void vLoadDecisionStep(LoadMask_t connected, LoadMask_t target, int stable, int reconnect_due,
+                       LoadStep_t *pxStep) {
+    LoadMask_t excess = connected & ~target & (LoadMask_t)~LOAD_CRITICAL_MASK;
+    LoadMask_t missing = target & ~connected;
+
+    pxStep->holdoff = LOAD_HOLDOFF_KEEP;
+    pxStep->holdoff_ms = 0;
+    pxStep->clear_due = 0;
+
+    if (excess || !stable) {
+        /* Any instability restarts the stable period */
+        pxStep->holdoff = LOAD_HOLDOFF_STOP;
+        pxStep->clear_due = 1;
+
+        /* Shed one load per evaluation, lowest priority first */
+        if (excess) {
+            connected &= ~xLowestPriorityLoad(excess);
+        }
+    } else if (missing) {
+        /* Stable long enough for the next load */
+        if (reconnect_due) {
+            pxStep->clear_due = 1;
+            connected |= xHighestPriorityLoad(missing);
+            missing = target & ~connected;
+        }
+
+        /* Arm the hold-off for the next load to come back */
+        if (missing) {
+            pxStep->holdoff = LOAD_HOLDOFF_ARM;
+            pxStep->holdoff_ms = usReconnectDelayMs[ulLoadFirst(missing)];
+        }
+    }
+
+    pxStep->connected = connected;
+}
@@ -0,0 +1,41 @@
+/**
+ * Staged shed and reconnect decision
+ *
+ * Load n has priority n, bit 0 highest. Each evaluation compares the loads
+ * left connected with the policy target: one load is shed per unstable
+ * evaluation (lowest priority first) and one is reconnected each time the
+ * stable hold-off has expired (highest priority first). Any instability
+ * restarts the hold-off.
+ *
+ * The step itself is pure; the caller owns the hold-off timer and applies
+ * what the step asks of it, so the same logic runs against FreeRTOS timers
+ * on the target and a simulated clock in the host replay (sim/).
+ */
+
+#ifndef LOAD_DECISION_H
+#define LOAD_DECISION_H
+
+#include <stdint.h>
+#include "load_mask.h"
+
+#define LOAD_CRITICAL_MASK             0x0001  // Loads that are never shed
+#define RECONNECT_STABLE_MS            500     // Default stable time before a reconnection
+
+/* What the caller does with the hold-off timer */
+#define LOAD_HOLDOFF_KEEP              0     // Leave it as it is
+#define LOAD_HOLDOFF_STOP              1     // Stop it, the stable period restarts
+#define LOAD_HOLDOFF_ARM               2     // Start it for holdoff_ms unless it is already running
+
+typedef struct {
+    LoadMask_t connected;              // Loads left connected
+    uint16_t holdoff_ms;               // With LOAD_HOLDOFF_ARM
+    uint8_t holdoff;                   // LOAD_HOLDOFF_*
+    uint8_t clear_due;                 // The expired hold-off was used or cancelled
+} LoadStep_t;
+
+/* One evaluation: connected are the loads requested on so far, target the
+ * policy lookup, reconnect_due whether the hold-off has expired */
+void vLoadDecisionStep(LoadMask_t connected, LoadMask_t target, int stable, int reconnect_due,
+                       LoadStep_t *pxStep);
+
+#endif /* LOAD_DECISION_H */
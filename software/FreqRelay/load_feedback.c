@@ -0,0 +1,67 @@
+/**
+ * Load actuator feedback
+ *
+ * See load_feedback.h.
+ */
+
+/* Standard includes */
+#include <string.h>
+
+/* Application includes */
+#include "load_feedback.h"
+#include "prng.h"
+
+#if FEEDBACK_INJECT_PERMILLE
+static Prng_t xInject;
+
+void vFeedbackInjectSeed(uint32_t seed) {
+    vPrngSeed(&xInject, seed);
+}
+#endif
+
+void vFeedbackInit(FeedbackFilter_t *pxFilter) {
+    memset(pxFilter, 0, sizeof(FeedbackFilter_t));
+}
+
+LoadMask_t xFeedbackRead(LoadMask_t actual) {
+#if FEEDBACK_INJECT_PERMILLE
+    if (ulPrngBelow(&xInject, 1000) < FEEDBACK_INJECT_PERMILLE) {
+        actual ^= xLoadBit(ulPrngBelow(&xInject, LOAD_COUNT));
+    }
+#endif
+    return actual;
+}
+
+LoadMask_t xFeedbackFilter(FeedbackFilter_t *pxFilter, LoadMask_t driven, LoadMask_t actual) {
+    LoadMask_t mismatch = driven ^ actual;
+    LoadMask_t active = mismatch | pxFilter->pending;
+    LoadMask_t bit;
+    uint32_t i;
+
+    /* Only loads that mismatch now or are still counting need any work */
+    while (active) {
+        i = ulLoadFirst(active);
+        bit = xLoadBit(i);
+        active &= ~bit;
+
+        if (mismatch & bit) {
+            if (pxFilter->count[i] < FEEDBACK_COUNT_MAX) {
+                pxFilter->count[i]++;
+            }
+            if (pxFilter->count[i] >= FEEDBACK_FAULT_SET) {
+                pxFilter->faulty |= bit;
+            }
+        } else if (pxFilter->count[i] > 0) {
+            pxFilter->count[i]--;
+        }
+
+        /* Hysteresis: a faulty load clears only once its count is back at 0 */
+        if (pxFilter->count[i] == 0) {
+            pxFilter->faulty &= ~bit;
+            pxFilter->pending &= ~bit;
+        } else {
+            pxFilter->pending |= bit;
+        }
+    }
+    return pxFilter->faulty;
+}
@@ -0,0 +1,70 @@
+/**
+ * Load actuator feedback
+ *
+ * Reads back the state of the load actuators and filters the comparison with
+ * the driven outputs per load. A mismatching load has to be seen
+ * FEEDBACK_FAULT_SET times (net of matching reads) before it counts as
+ * faulty, and only clears again after matching for as long, so a single bad
+ * read or a relay still moving cannot raise a fault or latch failsafe.
+ *
+ * Feedback comes from the PIO at ACTUATOR_FEEDBACK_BASE, for output port
+ * 0's loads (load_mask.h), read once a tick into the input snapshot
+ * (input_snapshot.h) with the outputs driven at the time. This hardware build has no feedback inputs, so
+ * without that define the driven value is looped back and the filter never
+ * sees a mismatch; further ports always are. Only loads that mismatch or are
+ * still counting are visited, so a read costs the word-wide compare and
+ * nothing per load while the actuators agree.
+ *
+ * Test builds can inject faults into the read back to exercise the filter
+ * and everything downstream of a fault: with FEEDBACK_INJECT_PERMILLE set,
+ * that many reads in a thousand come back with one load, drawn at random,
+ * the wrong way round, e.g. APP_CFLAGS_USER_FLAGS=-DFEEDBACK_INJECT_PERMILLE=20.
+ * The draws come from a stream of their own (prng.h) seeded by
+ * vFeedbackInjectSeed(), so a seed replays the same faults at the same reads.
+ */
+
+#ifndef LOAD_FEEDBACK_H
+#define LOAD_FEEDBACK_H
+
+#include <stdint.h>
+#include "load_mask.h"
+
+#ifndef FEEDBACK_SETTLE_MS
+#define FEEDBACK_SETTLE_MS             5     // Actuator settle time before the read back
+#endif
+#define FEEDBACK_FOLLOW_READS          2     // Reads a monitor period apart after a settled write
+#ifndef FEEDBACK_SWEEP_MS
+#define FEEDBACK_SWEEP_MS              500   // Read back with nothing written for this long
+#endif
+#define FEEDBACK_FAULT_SET             3     // Net mismatching reads that mark a load faulty
+#define FEEDBACK_COUNT_MAX             (2 * FEEDBACK_FAULT_SET)  // Saturation, sets the clear time
+
+#ifndef FEEDBACK_INJECT_PERMILLE
+#define FEEDBACK_INJECT_PERMILLE       0     // Injected bad reads per thousand, 0: none
+#endif
+#ifndef FEEDBACK_INJECT_SEED
+#define FEEDBACK_INJECT_SEED           1
+#endif
+
+typedef struct {
+    uint8_t count[LOAD_COUNT];         // Net mismatch count per load
+    LoadMask_t faulty;                 // Loads currently marked faulty
+    LoadMask_t pending;                // Loads with a non-zero count
+} FeedbackFilter_t;
+
+/* Clear all counts and faults */
+void vFeedbackInit(FeedbackFilter_t *pxFilter);
+
+/* The actuator state an input snapshot read, as the filter is to see it
+ * (with any injected fault). From one task only when faults are injected. */
+LoadMask_t xFeedbackRead(LoadMask_t actual);
+
+#if FEEDBACK_INJECT_PERMILLE
+/* Restart the injected fault sequence */
+void vFeedbackInjectSeed(uint32_t seed);
+#endif
+
+/* Fold one read into the filter. Returns the faulty load mask. */
+LoadMask_t xFeedbackFilter(FeedbackFilter_t *pxFilter, LoadMask_t driven, LoadMask_t actual);
+
+#endif /* LOAD_FEEDBACK_H */
@@ -0,0 +1,101 @@
+/**
+ * Actuation limiter: minimum on/off times and a global change rate
+ *
+ * See load_limiter.h.
+ */
+
+/* Standard includes */
+#include <string.h>
+
+/* Application includes */
+#include "load_limiter.h"
+
+static uint16_t usMinOnMs[LOAD_COUNT];
+static uint16_t usMinOffMs[LOAD_COUNT];
+static uint32_t ulChangedMs[LOAD_COUNT];   // When each load's command last changed
+static uint32_t ulWindowMs[LIMITER_CHANGES];  // The last changes let through, oldest at ulNext
+static uint32_t ulNext = 0;
+static LoadMask_t xCommanded = 0;
+static LimiterStats_t xStats;
+
+void vLoadLimiterInit(LoadMask_t commanded, uint32_t now_ms) {
+    uint32_t i;
+
+    for (i = 0; i < LOAD_COUNT; i++) {
+        usMinOnMs[i] = LIMITER_MIN_ON_MS;
+        usMinOffMs[i] = LIMITER_MIN_OFF_MS;
+        ulChangedMs[i] = now_ms - 0x10000UL;  // Longer ago than any minimum time
+    }
+    for (i = 0; i < LIMITER_CHANGES; i++) {
+        ulWindowMs[i] = now_ms - LIMITER_WINDOW_MS;
+    }
+    ulNext = 0;
+    xCommanded = commanded;
+    memset(&xStats, 0, sizeof(xStats));
+}
+
+LoadMask_t xLoadLimiterApply(LoadMask_t requested, LoadMask_t forced, uint32_t now_ms, LoadMask_t *pxReleased) {
+    LoadMask_t changed = requested ^ xCommanded, pending = 0, passed = 0, bit;
+    uint32_t i, *pulCount;
+
+    for (; changed != 0; changed &= changed - 1) {
+        i = ulLoadFirst(changed);
+        bit = xLoadBit(i);
+
+        if (!(forced & bit)) {
+            pulCount = NULL;
+            if (requested & bit) {
+                if (now_ms - ulChangedMs[i] < usMinOffMs[i]) {
+                    pulCount = &xStats.held_off;
+                } else if (now_ms - ulWindowMs[ulNext & LIMITER_CHANGES_MASK] < LIMITER_WINDOW_MS) {
+                    pulCount = &xStats.rate;
+                }
+            } else if (now_ms - ulChangedMs[i] < usMinOnMs[i]) {
+                pulCount = &xStats.held_on;
+            }
+            if (pulCount != NULL) {
+                if (!(xStats.pending & bit)) {
+                    (*pulCount)++;
+                }
+                pending |= bit;
+                continue;
+            }
+        }
+
+        xCommanded ^= bit;
+        ulChangedMs[i] = now_ms;
+        ulWindowMs[ulNext++ & LIMITER_CHANGES_MASK] = now_ms;
+        passed |= bit;
+        xStats.passed++;
+    }
+
+    /* Held before, and neither held nor let through now: withdrawn */
+    xStats.absorbed += ulLoadCount(xStats.pending & ~pending & ~passed);
+    if (pxReleased != NULL) {
+        *pxReleased = xStats.pending & passed;
+    }
+    xStats.pending = pending;
+    return xCommanded;
+}
+
+int xLoadLimiterSetTimes(uint32_t load, uint16_t min_on_ms, uint16_t min_off_ms) {
+    if (load >= LOAD_COUNT) {
+        return 0;
+    }
+    usMinOnMs[load] = min_on_ms;
+    usMinOffMs[load] = min_off_ms;
+    return 1;
+}
+
+int xLoadLimiterGetTimes(uint32_t load, uint16_t *pusMinOnMs, uint16_t *pusMinOffMs) {
+    if (load >= LOAD_COUNT) {
+        return 0;
+    }
+    *pusMinOnMs = usMinOnMs[load];
+    *pusMinOffMs = usMinOffMs[load];
+    return 1;
+}
+
+void vLoadLimiterGetStats(LimiterStats_t *pxStats) {
+    *pxStats = xStats;
+}
@@ -0,0 +1,74 @@
+/**
+ * Actuation limiter: minimum on/off times and a global change rate
+ *
+ * Near a threshold the decision can ask for a load one cycle and drop it
+ * the next. Each flip is a port write, a feedback settle and, on a real
+ * board, a contactor operation. The actuator passes the decision's
+ * command through xLoadLimiterApply() before posting it to the output
+ * stage (load_output.h). A change for a load is let through only when:
+ *
+ *   - the load has held its present state for its minimum time, on before
+ *     a shed and off before a reconnection (per load, LIMITER_MIN_ON_MS
+ *     and LIMITER_MIN_OFF_MS until set otherwise), and
+ *   - for a reconnection, fewer than LIMITER_CHANGES changes of any load
+ *     have been let through in the last LIMITER_WINDOW_MS. Sheds are never
+ *     rate limited, but they count against the window.
+ *
+ * A change that is not let through stays pending and goes through at the
+ * first call it is eligible at; the actuator calls at least once a period.
+ * A pending change that the decision withdraws first is absorbed, a flip
+ * that never reached the pins, and counted as such. Reconnections waiting
+ * on the rate go highest priority (lowest numbered) load first.
+ *
+ * Only the decision's command is limited. Failsafe and override commands
+ * win in the output stage as before, and a load a deadline has shed at
+ * interrupt level (vOutputShedFromISR) is passed in forced, which lets
+ * its change through at once. A minimum on time delays a shed, and that
+ * delay counts against the shed deadline, so LIMITER_MIN_ON_MS is 0 unless
+ * a site sets it.
+ *
+ * Only the loads in requested ^ commanded are visited, lowest first with
+ * ulLoadFirst(), as in load_audit.c. One task calls xLoadLimiterApply();
+ * the statistics are single words, read without a snapshot.
+ */
+
+#ifndef LOAD_LIMITER_H
+#define LOAD_LIMITER_H
+
+#include <stdint.h>
+#include "load_mask.h"
+
+#ifndef LIMITER_MIN_ON_MS
+#define LIMITER_MIN_ON_MS              0      // A load switched on is not shed again for this long
+#endif
+#ifndef LIMITER_MIN_OFF_MS
+#define LIMITER_MIN_OFF_MS             2000   // A load switched off is not reconnected for this long
+#endif
+#define LIMITER_WINDOW_MS              1000
+#define LIMITER_CHANGES                4      // Changes let through per window, power of 2
+#define LIMITER_CHANGES_MASK           (LIMITER_CHANGES - 1)
+
+typedef struct {
+    uint32_t passed;                   // Changes let through
+    uint32_t held_on;                  // Sheds held by a minimum on time
+    uint32_t held_off;                 // Reconnections held by a minimum off time
+    uint32_t rate;                     // Reconnections held by the window
+    uint32_t absorbed;                 // Held changes the decision withdrew
+    LoadMask_t pending;                // Changes held now
+} LimiterStats_t;
+
+/* Start from the decision's command at boot, nothing held */
+void vLoadLimiterInit(LoadMask_t commanded, uint32_t now_ms);
+
+/* The command to post for the decision's request. Changes of loads in
+ * forced go through at once. Sets *pxReleased (may be NULL) to the held
+ * changes that went through now. One task only. */
+LoadMask_t xLoadLimiterApply(LoadMask_t requested, LoadMask_t forced, uint32_t now_ms, LoadMask_t *pxReleased);
+
+/* One load's minimum times, 0 for none. Returns 0 for a load out of range. */
+int xLoadLimiterSetTimes(uint32_t load, uint16_t min_on_ms, uint16_t min_off_ms);
+int xLoadLimiterGetTimes(uint32_t load, uint16_t *pusMinOnMs, uint16_t *pusMinOffMs);
+
+void vLoadLimiterGetStats(LimiterStats_t *pxStats);
+
+#endif /* LOAD_LIMITER_H */
@@ -0,0 +1,84 @@
+/**
+ * Load masks
+ *
+ * Load n is bit n of a LoadMask_t, bit 0 the highest priority. The loads
+ * are driven LOAD_PORT_BITS to an output port: port 0 is the green LEDs'
+ * PIO, port p a LOAD_PORT_<p> PIO in system.h (see board_io.h). The mask
+ * is the narrowest unsigned integer holding LOAD_PORTS ports, so every set
+ * operation the decision does is one or two machine words whatever the
+ * load count, and a one-port build keeps the 16-bit masks, flash images
+ * and frames it has always had.
+ *
+ * Reporting of a fixed width on the wire or the screen - telemetry, Modbus,
+ * the VGA pages, the event log detail - carries the low loads that fit,
+ * port 0's at the least.
+ */
+
+#ifndef LOAD_MASK_H
+#define LOAD_MASK_H
+
+#include <stdint.h>
+
+#ifndef LOAD_PORTS
+#define LOAD_PORTS                     1     // Output PIOs of LOAD_PORT_BITS loads each
+#endif
+
+#define LOAD_PORT_BITS                 16
+#define LOAD_PORT_MASK                 0xFFFFU
+#define LOAD_COUNT                     (LOAD_PORTS * LOAD_PORT_BITS)
+
+#if LOAD_PORTS == 1
+typedef uint16_t LoadMask_t;
+#elif LOAD_PORTS == 2
+typedef uint32_t LoadMask_t;
+#elif LOAD_PORTS <= 4
+typedef uint64_t LoadMask_t;
+#else
+#error "LOAD_PORTS is at most 4, 64 loads"
+#endif
+
+#define LOAD_MASK_ALL                  ((LoadMask_t)~(LoadMask_t)0)
+
+/* Load n alone */
+static inline LoadMask_t xLoadBit(uint32_t n) {
+    return (LoadMask_t)1 << n;
+}
+
+/* Number of the highest priority (lowest numbered) load in a non-empty mask */
+static inline uint32_t ulLoadFirst(LoadMask_t mask) {
+#if LOAD_PORTS > 2
+    return (uint32_t)__builtin_ctzll(mask);
+#else
+    return (uint32_t)__builtin_ctz(mask);
+#endif
+}
+
+/* Lowest priority (highest numbered) load in a non-empty mask */
+static inline LoadMask_t xLowestPriorityLoad(LoadMask_t mask) {
+#if LOAD_PORTS > 2
+    return (LoadMask_t)1 << (63 - __builtin_clzll(mask));
+#else
+    return (LoadMask_t)(0x80000000UL >> __builtin_clz(mask));
+#endif
+}
+
+/* Highest priority (lowest numbered) load in a non-empty mask */
+static inline LoadMask_t xHighestPriorityLoad(LoadMask_t mask) {
+    return mask & (LoadMask_t)(0 - mask);
+}
+
+/* Loads in a mask */
+static inline uint32_t ulLoadCount(LoadMask_t mask) {
+#if LOAD_PORTS > 2
+    return (uint32_t)__builtin_popcountll(mask);
+#else
+    return (uint32_t)__builtin_popcount(mask);
+#endif
+}
+
+/* One port's bits of a mask */
+static inline uint16_t usLoadPortBits(LoadMask_t mask, uint32_t port) {
+    return (uint16_t)(mask >> (port * LOAD_PORT_BITS));
+}
+
+#endif /* LOAD_MASK_H */
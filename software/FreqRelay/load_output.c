@@ -0,0 +1,185 @@
+/**
+ * Load output stage
+ *
+ * See load_output.h.
+ */
+
+/* Hardware includes */
+#include "sys/alt_irq.h"
+
+/* Application includes */
+#include "board_io.h"
+#include "fast_mem.h"
+#include "load_output.h"
+
+/* One slot per source; changed only with interrupts masked */
+static FAST_DATA volatile LoadMask_t xSlots[OUTPUT_SOURCES];
+static FAST_DATA volatile uint32_t ulPosted = 0;    // One bit per source holding a command
+
+static FAST_DATA TaskHandle_t xOwnerTask = NULL;
+static FAST_DATA volatile LoadMask_t xDriven = 0;  // Shadow of every port
+static FAST_DATA volatile int xDrivenBy = -1;      // Source of the last drive
+static FAST_DATA uint32_t ulWrites = 0;
+static FAST_DATA volatile LoadMask_t xShedLatch = 0;  // Kept off the decision's command
+
+/* The winning command, or -1 if nothing is posted. Interrupts masked. */
+static int xOutputWinner(LoadMask_t *pxLoads) {
+    int i;
+
+    if (ulPosted == 0) {
+        return -1;
+    }
+    i = __builtin_ctz(ulPosted);
+    *pxLoads = xSlots[i];
+    if (i == OUTPUT_SOURCE_DECISION) {
+        *pxLoads &= ~xShedLatch;
+    }
+    return i;
+}
+
+/* Write the ports whose bits differ from the shadow. Interrupts masked. */
+static void vOutputDrive(int source, LoadMask_t loads) {
+    LoadMask_t changed = loads ^ xDriven;
+    uint32_t port;
+
+    for (port = 0; port < LOAD_PORTS; port++) {
+        if (usLoadPortBits(changed, port) != 0) {
+            vBoardLoadPortOut(port, usLoadPortBits(loads, port));
+            ulWrites++;
+        }
+    }
+    xDriven = loads;
+    xDrivenBy = source;
+}
+
+/* Fill or empty a slot, any context */
+static void vOutputSlot(int source, int posted, LoadMask_t loads) {
+    alt_irq_context irq;
+
+    irq = alt_irq_disable_all();
+    xSlots[source] = loads;
+    if (posted) {
+        ulPosted |= 1UL << source;
+    } else {
+        ulPosted &= ~(1UL << source);
+    }
+    alt_irq_enable_all(irq);
+}
+
+void vOutputInit(TaskHandle_t xOwner, LoadMask_t initial) {
+    uint32_t port;
+
+    ulPosted = 0;
+    xOwnerTask = xOwner;
+
+    xShedLatch = 0;
+    xDriven = initial;
+    xDrivenBy = -1;
+    for (port = 0; port < LOAD_PORTS; port++) {
+        vBoardLoadPortOut(port, usLoadPortBits(initial, port));
+    }
+    ulWrites = LOAD_PORTS;
+}
+
+void vOutputPost(int source, LoadMask_t loads) {
+    vOutputSlot(source, 1, loads);
+    if (xOwnerTask != NULL) {
+        xTaskNotifyGive(xOwnerTask);
+    }
+}
+
+void vOutputPostFromISR(int source, LoadMask_t loads, BaseType_t *pxHigherPriorityTaskWoken) {
+    vOutputSlot(source, 1, loads);
+    if (xOwnerTask != NULL) {
+        vTaskNotifyGiveFromISR(xOwnerTask, pxHigherPriorityTaskWoken);
+    }
+}
+
+void vOutputRelease(int source) {
+    vOutputSlot(source, 0, 0);
+    if (xOwnerTask != NULL) {
+        xTaskNotifyGive(xOwnerTask);
+    }
+}
+
+void vOutputReleaseFromISR(int source, BaseType_t *pxHigherPriorityTaskWoken) {
+    vOutputSlot(source, 0, 0);
+    if (xOwnerTask != NULL) {
+        vTaskNotifyGiveFromISR(xOwnerTask, pxHigherPriorityTaskWoken);
+    }
+}
+
+void vOutputTrip(LoadMask_t loads) {
+    xSlots[OUTPUT_SOURCE_FAILSAFE] = loads;
+    ulPosted |= 1UL << OUTPUT_SOURCE_FAILSAFE;
+    vOutputDrive(OUTPUT_SOURCE_FAILSAFE, loads);
+}
+
+void vOutputShedFromISR(LoadMask_t loads, BaseType_t *pxHigherPriorityTaskWoken) {
+    alt_irq_context irq;
+    LoadMask_t winning;
+
+    irq = alt_irq_disable_all();
+    xShedLatch |= loads;
+    if (xOutputWinner(&winning) == OUTPUT_SOURCE_DECISION) {
+        vOutputDrive(OUTPUT_SOURCE_DECISION, winning);
+    }
+    alt_irq_enable_all(irq);
+    if (xOwnerTask != NULL) {
+        vTaskNotifyGiveFromISR(xOwnerTask, pxHigherPriorityTaskWoken);
+    }
+}
+
+/* A copy of a mask the interrupt level writes, whole however wide */
+static LoadMask_t xOutputRead(volatile LoadMask_t *pxMask) {
+    alt_irq_context irq;
+    LoadMask_t loads;
+
+    irq = alt_irq_disable_all();
+    loads = *pxMask;
+    alt_irq_enable_all(irq);
+    return loads;
+}
+
+LoadMask_t xOutputShedLatched(void) {
+    return xOutputRead(&xShedLatch);
+}
+
+void vOutputShedClear(LoadMask_t loads) {
+    taskENTER_CRITICAL();
+    xShedLatch &= ~loads;
+    taskEXIT_CRITICAL();
+}
+
+LoadMask_t xOutputUpdate(void) {
+    alt_irq_context irq;
+    LoadMask_t loads;
+    int source;
+
+    /* Nothing posted at all keeps the current outputs */
+    irq = alt_irq_disable_all();
+    source = xOutputWinner(&loads);
+    if (source >= 0) {
+        vOutputDrive(source, loads);
+    }
+    loads = xDriven;
+    alt_irq_enable_all(irq);
+    return loads;
+}
+
+LoadMask_t xOutputCommand(int source, LoadMask_t loads) {
+    vOutputSlot(source, 1, loads);
+    return xOutputUpdate();
+}
+
+LoadMask_t xOutputDriven(void) {
+    return xOutputRead(&xDriven);
+}
+
+int xOutputDrivenBy(void) {
+    return xDrivenBy;
+}
+
+uint32_t ulOutputWrites(void) {
+    return ulWrites;
+}
@@ -0,0 +1,77 @@
+/**
+ * Load output stage
+ *
+ * The only code that writes GREEN_LEDS_BASE. Each command source owns one
+ * mailbox slot holding the loads it wants driven; a source either has a
+ * command posted or has released its slot. When the stage runs, the highest
+ * priority posted slot wins (failsafe > override > decision) and the PIO is
+ * written only if the result differs from what is already driven, so any
+ * number of posts between two runs cost a single bus write.
+ *
+ * Posting is one aligned word store and may be done from an ISR; every post
+ * notifies the owner task, which runs xOutputUpdate(). The worst-case
+ * latency from a post to the pins is therefore the owner's response time to
+ * a notification, and never more than one owner period since the owner also
+ * runs on its periodic timeout.
+ */
+
+#ifndef LOAD_OUTPUT_H
+#define LOAD_OUTPUT_H
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "load_mask.h"
+
+/* Command sources, highest priority first */
+#define OUTPUT_SOURCE_FAILSAFE         0
+#define OUTPUT_SOURCE_OVERRIDE         1
+#define OUTPUT_SOURCE_DECISION         2
+#define OUTPUT_SOURCES                 3
+
+/* Drive the initial pattern and bind the owner task that applies commands */
+void vOutputInit(TaskHandle_t xOwner, LoadMask_t initial);
+
+/* Post a command for a source, replacing its previous one */
+void vOutputPost(int source, LoadMask_t loads);
+void vOutputPostFromISR(int source, LoadMask_t loads, BaseType_t *pxHigherPriorityTaskWoken);
+
+/* Withdraw a source's command so lower priority sources apply again */
+void vOutputRelease(int source);
+void vOutputReleaseFromISR(int source, BaseType_t *pxHigherPriorityTaskWoken);
+
+/* Failsafe trip for failsafe.h, with interrupts masked: post the
+ * command and drive the pins at once, without waiting for an owner that
+ * may be the task that has stopped. */
+void vOutputTrip(LoadMask_t loads);
+
+/* Shed at interrupt level, for a deadline (deadline.h) that cannot wait
+ * for the owner: the loads stay off in whatever the decision asks for until
+ * vOutputShedClear() releases them, and if the decision is the source that
+ * wins the pins are driven at once. Failsafe and override commands are not
+ * changed. The owner is notified as well. */
+void vOutputShedFromISR(LoadMask_t loads, BaseType_t *pxHigherPriorityTaskWoken);
+
+/* Loads shed by vOutputShedFromISR() and not yet released */
+LoadMask_t xOutputShedLatched(void);
+
+/* Release latched sheds, owner task only, once the decision's own command
+ * has them off */
+void vOutputShedClear(LoadMask_t loads);
+
+/* Apply the winning command, owner task only. Returns the driven loads. */
+LoadMask_t xOutputUpdate(void);
+
+/* Post and apply in one step, owner task only (no self notification) */
+LoadMask_t xOutputCommand(int source, LoadMask_t loads);
+
+/* Loads currently driven */
+LoadMask_t xOutputDriven(void);
+
+/* Source of the command last driven, -1 for the initial pattern */
+int xOutputDrivenBy(void);
+
+/* Number of port writes since boot */
+uint32_t ulOutputWrites(void);
+
+#endif /* LOAD_OUTPUT_H */
@@ -0,0 +1,125 @@
+/**
+ * Table-driven load shedding policy
+ *
+ * See load_policy.h for the table layout.
+ */
+
+/* Standard includes */
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Hardware includes */
+#include "system.h"
+#include "sys/alt_flash.h"
+
+/* Application includes */
+#include "fast_mem.h"
+#include "load_policy.h"
+
+/* Load groups, bit 0 is the critical load */
+#define LOADS_CRITICAL                 0x0001  // Load 0
+#define LOADS_HIGH                     0x0006  // Loads 1-2
+#define LOADS_MEDIUM                   0x0018  // Loads 3-4
+#define LOADS_LOW                      0x0060  // Loads 5-6
+
+/* Built-in policy, equivalent to the original hard-coded decision:
+ * shed low, then medium, then high priority loads at 0/1/2 Hz below the lower
+ * limit, and never keep more than critical + high while RoC is excessive. */
+static const LoadPolicy_t xDefaultPolicy = {
+    POLICY_MAGIC,
+    POLICY_VERSION,
+    0,
+    { FIX16_CONST(0.0), FIX16_CONST(1.0), FIX16_CONST(2.0) },
+    { FIX16_CONST(60.0) },
+    {
+        /* RoC ok                                          RoC excessive */
+        { LOADS_CRITICAL | LOADS_HIGH | LOADS_MEDIUM | LOADS_LOW, LOADS_CRITICAL | LOADS_HIGH },  // In band / over
+        { LOADS_CRITICAL | LOADS_HIGH | LOADS_MEDIUM,             LOADS_CRITICAL | LOADS_HIGH },  // Minor
+        { LOADS_CRITICAL | LOADS_HIGH,                            LOADS_CRITICAL | LOADS_HIGH },  // Moderate
+        { LOADS_CRITICAL,                                         LOADS_CRITICAL }                // Severe
+    },
+    0
+};
+
+static FAST_DATA LoadPolicy_t xActivePolicy;  // Read on every decision
+
+uint32_t ulLoadPolicyChecksum(const LoadPolicy_t *pxPolicy) {
+    const uint32_t *pulWord = (const uint32_t *)pxPolicy;
+    uint32_t words = offsetof(LoadPolicy_t, checksum) / sizeof(uint32_t);
+    uint32_t sum = 0;
+
+    while (words--) {
+        sum += *pulWord++;
+    }
+    return ~sum;
+}
+
+/* Thresholds must be ascending, otherwise band indices would not be monotonic */
+static int xLoadPolicyValid(const LoadPolicy_t *pxPolicy) {
+    int i;
+
+    if (pxPolicy->magic != POLICY_MAGIC || pxPolicy->version != POLICY_VERSION) {
+        return 0;
+    }
+    if (pxPolicy->checksum != ulLoadPolicyChecksum(pxPolicy)) {
+        return 0;
+    }
+    for (i = 1; i < POLICY_FREQ_BANDS - 1; i++) {
+        if (pxPolicy->freq_thresholds[i] < pxPolicy->freq_thresholds[i - 1]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int xLoadPolicyInit(void) {
+    alt_flash_fd *fd;
+    LoadPolicy_t candidate;
+    int loaded = 0;
+
+    memcpy(&xActivePolicy, &xDefaultPolicy, sizeof(LoadPolicy_t));
+
+    fd = alt_flash_open_dev(FLASH_CONTROLLER_NAME);
+    if (fd == NULL) {
+        printf("Policy: flash not found, using built-in table\n");
+        return 0;
+    }
+
+    if (alt_read_flash(fd, POLICY_FLASH_OFFSET, &candidate, sizeof(LoadPolicy_t)) == 0 &&
+        xLoadPolicyValid(&candidate)) {
+        memcpy(&xActivePolicy, &candidate, sizeof(LoadPolicy_t));
+        loaded = 1;
+    }
+    alt_flash_close_dev(fd);
+
+    printf("Policy: %s table\n", loaded ? "flash" : "built-in");
+    return loaded;
+}
+
+const LoadPolicy_t *pxLoadPolicyGet(void) {
+    return &xActivePolicy;
+}
+
+int xLoadPolicySetBands(const fix16_t *pxFreqThresholds, fix16_t roc,
+                        const LoadMask_t (*pxRequested)[POLICY_ROC_BANDS]) {
+    LoadPolicy_t candidate;
+
+    memcpy(&candidate, &xActivePolicy, sizeof(LoadPolicy_t));
+    memcpy(candidate.freq_thresholds, pxFreqThresholds, sizeof(candidate.freq_thresholds));
+    memcpy(candidate.requested_status, pxRequested, sizeof(candidate.requested_status));
+    candidate.roc_thresholds[0] = roc;
+    candidate.checksum = ulLoadPolicyChecksum(&candidate);
+
+    if (!xLoadPolicyValid(&candidate)) {
+        return 0;
+    }
+    memcpy(&xActivePolicy, &candidate, sizeof(LoadPolicy_t));
+    return 1;
+}
+
+void vLoadPolicySetRocThreshold(fix16_t roc) {
+    /* A single aligned word store, so a concurrent lookup sees either value */
+    xActivePolicy.roc_thresholds[0] = roc;
+    xActivePolicy.checksum = ulLoadPolicyChecksum(&xActivePolicy);
+}
@@ -0,0 +1,109 @@
+/**
+ * Table-driven load shedding policy
+ *
+ * A policy maps (frequency band, RoC band) to the requested_status bitmap
+ * written to the loads. Band boundaries are stored pre-scaled in Q16.16 so
+ * evaluation is a handful of integer compares and one table read, with no
+ * branches on the measured values.
+ *
+ * A built-in default reproduces the original hard-coded behaviour. At boot a
+ * replacement table can be read from CFI flash; it is only used if its magic,
+ * version and checksum are valid.
+ */
+
+#ifndef LOAD_POLICY_H
+#define LOAD_POLICY_H
+
+#include <stdint.h>
+#include "fix16.h"
+#include "load_mask.h"
+
+/* Table dimensions */
+#define POLICY_FREQ_BANDS              4     // In band, minor, moderate, severe under-frequency
+#define POLICY_ROC_BANDS               2     // RoC within limit, RoC excessive
+
+/* Flash image identification */
+#define POLICY_MAGIC                   0x504F4C59UL  // "POLY"
+#define POLICY_VERSION                 ((LOAD_PORTS - 1) << 8 | 1)  // The mask width is part of the layout
+#define POLICY_FLASH_OFFSET            0x7F0000      // Last 64 KB of the 8 MB CFI flash
+
+typedef struct {
+    uint32_t magic;                                          // POLICY_MAGIC
+    uint16_t version;                                        // POLICY_VERSION
+    uint16_t reserved;
+    fix16_t  freq_thresholds[POLICY_FREQ_BANDS - 1];         // Ascending deviation below lower_limit (Hz)
+    fix16_t  roc_thresholds[POLICY_ROC_BANDS - 1];           // Ascending |RoC| (Hz/s)
+    LoadMask_t requested_status[POLICY_FREQ_BANDS][POLICY_ROC_BANDS]; // Loads left connected
+    uint32_t checksum;                                       // Word sum of everything above
+} LoadPolicy_t;
+
+/* Select the built-in policy, then try to replace it from flash.
+ * Returns 1 if the flash policy was accepted, 0 if the default is in use. */
+int xLoadPolicyInit(void);
+
+/* Currently active policy (read only) */
+const LoadPolicy_t *pxLoadPolicyGet(void);
+
+/* Replace the band boundaries and masks, keeping the active policy if the
+ * new thresholds are not ascending. Not atomic against a lookup, so only
+ * before the scheduler starts. Returns 1 if the policy was accepted. */
+int xLoadPolicySetBands(const fix16_t *pxFreqThresholds, fix16_t roc,
+                        const LoadMask_t (*pxRequested)[POLICY_ROC_BANDS]);
+
+/* Replace the RoC band boundary at runtime (Hz/s, Q16.16) */
+void vLoadPolicySetRocThreshold(fix16_t roc);
+
+/* Checksum over a policy image, excluding the checksum field itself */
+uint32_t ulLoadPolicyChecksum(const LoadPolicy_t *pxPolicy);
+
+/* Band lookup: deviation is lower_limit - frequency (negative when in band).
+ * The compares are written out for the table dimensions above. The cell,
+ * freq band * POLICY_ROC_BANDS + RoC band, names the requested_status entry
+ * read, so two evaluations in the same cell ask for the same loads. */
+#if POLICY_FREQ_BANDS != 4 || POLICY_ROC_BANDS != 2
+#error ulLoadPolicyCell must be updated to match the policy dimensions
+#endif
+
+static inline uint32_t ulLoadPolicyCell(const LoadPolicy_t *pxPolicy, fix16_t deviation, fix16_t roc) {
+    fix16_t roc_abs = FIX16_ABS(roc);
+    int freq_band = (deviation > pxPolicy->freq_thresholds[0]) +
+                    (deviation > pxPolicy->freq_thresholds[1]) +
+                    (deviation > pxPolicy->freq_thresholds[2]);
+    int roc_band = (roc_abs > pxPolicy->roc_thresholds[0]);
+
+    return (uint32_t)(freq_band * POLICY_ROC_BANDS + roc_band);
+}
+
+static inline LoadMask_t xLoadPolicyLookup(const LoadPolicy_t *pxPolicy, fix16_t deviation, fix16_t roc) {
+    uint32_t cell = ulLoadPolicyCell(pxPolicy, deviation, roc);
+
+    return pxPolicy->requested_status[cell / POLICY_ROC_BANDS][cell % POLICY_ROC_BANDS];
+}
+
+/* Predictive shedding: the frequency is still in band but falling within
+ * arm Hz of the limit, and the RoC fit puts the crossing less than lead_s
+ * seconds ahead. The arming margin keeps a swing that turns well above the
+ * limit from shedding on its steepest slope. */
+static inline int xLoadPolicyCrossingDue(const LoadPolicy_t *pxPolicy, fix16_t deviation, fix16_t roc,
+                                         fix16_t lead_s, fix16_t arm) {
+    fix16_t limit = pxPolicy->freq_thresholds[0];
+
+    return roc < 0 && deviation <= limit && deviation > limit - arm &&
+           deviation - fix16_mul(roc, lead_s) > limit;
+}
+
+/* Predictive lookup: shed the first band's loads early on a crossing due
+ * within the lead, rather than after the next evaluation finds it crossed.
+ * Deeper bands stay reactive, so a fast transient is not extrapolated past
+ * where it settles. lead_s 0 is the plain lookup. */
+static inline LoadMask_t xLoadPolicyPredict(const LoadPolicy_t *pxPolicy, fix16_t deviation, fix16_t roc,
+                                            fix16_t lead_s, fix16_t arm) {
+    LoadMask_t target = xLoadPolicyLookup(pxPolicy, deviation, roc);
+
+    if (xLoadPolicyCrossingDue(pxPolicy, deviation, roc, lead_s, arm)) {
+        target &= pxPolicy->requested_status[1][FIX16_ABS(roc) > pxPolicy->roc_thresholds[0]];
+    }
+    return target;
+}
+
+#endif /* LOAD_POLICY_H */
@@ -0,0 +1,261 @@
+/**
+ * Load registry and power-weighted shed selection
+ *
+ * See load_registry.h.
+ */
+
+/* Standard includes */
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Hardware includes */
+#include "system.h"
+#include "sys/alt_flash.h"
+
+/* Application includes */
+#include "fast_mem.h"
+#include "load_registry.h"
+
+typedef struct {
+    uint32_t cost;
+    uint32_t kw;
+} ShedChoice_t;
+
+static LoadRegistry_t xRegistry;
+static int xHaveRegistry = 0;
+
+/* Read on every decision */
+static FAST_DATA uint16_t usShedTable[REGISTRY_STEPS];  // Cheapest set to shed for each step
+static FAST_DATA uint8_t ucShedOrder[REGISTRY_LOADS];       // Sheddable loads, cheapest first
+static FAST_DATA uint32_t ulShedOrderCount = 0;
+static FAST_DATA uint32_t ulStepKw = 1;                 // kW per table step
+static FAST_DATA uint16_t usSheddable = 0;
+static uint32_t ulCost[REGISTRY_LOADS];
+
+static uint32_t ulRegistryChecksum(const LoadRegistry_t *pxRegistry) {
+    const uint32_t *pulWord = (const uint32_t *)pxRegistry;
+    uint32_t words = offsetof(LoadRegistry_t, checksum) / sizeof(uint32_t);
+    uint32_t sum = 0;
+
+    while (words--) {
+        sum += *pulWord++;
+    }
+    return ~sum;
+}
+
+static int xRegistryValid(const LoadRegistry_t *pxRegistry) {
+    int i;
+
+    if (pxRegistry->magic != REGISTRY_MAGIC || pxRegistry->version != REGISTRY_VERSION) {
+        return 0;
+    }
+    if (pxRegistry->checksum != ulRegistryChecksum(pxRegistry)) {
+        return 0;
+    }
+    if (pxRegistry->kw_per_hz < 0 || pxRegistry->kw_per_hz_s < 0) {
+        return 0;
+    }
+    for (i = 0; i < REGISTRY_LOADS; i++) {
+        if (pxRegistry->load[i].priority > REGISTRY_PRIORITY_MAX) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int xCheaper(const ShedChoice_t *pxA, const ShedChoice_t *pxB) {
+    return pxA->cost < pxB->cost || (pxA->cost == pxB->cost && pxA->kw < pxB->kw);
+}
+
+/* Cheapest subset reaching each step, over all 2^n subsets of the n
+ * sheddable loads. Gray code order changes one load per subset, so each
+ * costs one add or subtract; 15 loads take 32768 steps, once at boot. */
+static void vBuildShedTable(void) {
+    ShedChoice_t best[REGISTRY_STEPS];
+    ShedChoice_t current = { 0, 0 };
+    uint8_t position[REGISTRY_LOADS];
+    uint32_t n = 0, total = 0, i, j, k;
+    uint16_t mask = 0, bit;
+    uint8_t swap;
+    int p;
+
+    /* A load costs one more than every less important load together */
+    for (p = REGISTRY_PRIORITY_MAX, k = 0; p >= 0; p--) {
+        j = k + 1;
+        for (i = 0; i < REGISTRY_LOADS; i++) {
+            if ((usSheddable & (1u << i)) && xRegistry.load[i].priority == p) {
+                ulCost[i] = j;
+                k += j;
+            }
+        }
+    }
+
+    for (i = 0; i < REGISTRY_LOADS; i++) {
+        if (usSheddable & (1u << i)) {
+            position[n++] = (uint8_t)i;
+            total += xRegistry.load[i].rating_kw;
+        }
+    }
+    ulStepKw = (total + REGISTRY_STEPS - 2) / (REGISTRY_STEPS - 1);
+    if (ulStepKw == 0) {
+        ulStepKw = 1;
+    }
+
+    for (k = 0; k < REGISTRY_STEPS; k++) {
+        best[k].cost = UINT32_MAX;
+        best[k].kw = UINT32_MAX;
+        usShedTable[k] = usSheddable;
+    }
+    best[0] = current;
+    usShedTable[0] = 0;
+
+    for (i = 1; i < (1UL << n); i++) {
+        j = position[__builtin_ctz(i)];
+        bit = (uint16_t)(1u << j);
+        mask ^= bit;
+        if (mask & bit) {
+            current.cost += ulCost[j];
+            current.kw += xRegistry.load[j].rating_kw;
+        } else {
+            current.cost -= ulCost[j];
+            current.kw -= xRegistry.load[j].rating_kw;
+        }
+        k = current.kw / ulStepKw;
+        if (k >= REGISTRY_STEPS) {
+            k = REGISTRY_STEPS - 1;
+        }
+        if (xCheaper(&current, &best[k])) {
+            best[k] = current;
+            usShedTable[k] = mask;
+        }
+    }
+
+    /* A set reaching a higher step covers every step below it */
+    for (k = REGISTRY_STEPS - 1; k-- > 0;) {
+        if (xCheaper(&best[k + 1], &best[k])) {
+            best[k] = best[k + 1];
+            usShedTable[k] = usShedTable[k + 1];
+        }
+    }
+
+    /* Greedy order: cheapest first, the higher numbered of equals first */
+    ulShedOrderCount = n;
+    for (i = 0; i < n; i++) {
+        ucShedOrder[i] = position[n - 1 - i];
+    }
+    for (i = 1; i < n; i++) {
+        for (j = i; j > 0 && ulCost[ucShedOrder[j]] < ulCost[ucShedOrder[j - 1]]; j--) {
+            swap = ucShedOrder[j];
+            ucShedOrder[j] = ucShedOrder[j - 1];
+            ucShedOrder[j - 1] = swap;
+        }
+    }
+}
+
+int xLoadRegistryInit(void) {
+    alt_flash_fd *fd;
+    int i;
+
+    xHaveRegistry = 0;
+    fd = alt_flash_open_dev(FLASH_CONTROLLER_NAME);
+    if (fd == NULL) {
+        return 0;
+    }
+    if (alt_read_flash(fd, REGISTRY_FLASH_OFFSET, &xRegistry, sizeof(LoadRegistry_t)) == 0 &&
+        xRegistryValid(&xRegistry)) {
+        xHaveRegistry = 1;
+    }
+    alt_flash_close_dev(fd);
+
+    if (!xHaveRegistry) {
+        printf("Registry: none, shedding by policy table\n");
+        return 0;
+    }
+
+    usSheddable = 0;
+    for (i = 0; i < REGISTRY_LOADS; i++) {
+        if (xRegistry.load[i].rating_kw > 0) {
+            usSheddable |= (uint16_t)(1u << i);
+        }
+    }
+    usSheddable &= ~LOAD_CRITICAL_MASK;
+    vBuildShedTable();
+
+    printf("Registry: flash, %lu sheddable loads, %lu kW per step\n",
+           (unsigned long)ulShedOrderCount, (unsigned long)ulStepKw);
+    return 1;
+}
+
+const LoadRegistry_t *pxLoadRegistryGet(void) {
+    return xHaveRegistry ? &xRegistry : NULL;
+}
+
+LoadMask_t xLoadRegistryTarget(fix16_t deficit, fix16_t roc, LoadMask_t held_on) {
+    LoadMask_t wired = usSheddable | LOAD_CRITICAL_MASK | REGISTRY_UNRATED;
+    fix16_t required;
+    uint32_t k, i, kw;
+    uint16_t shed;
+
+    if (deficit <= 0) {
+        return wired;
+    }
+    required = fix16_mul(xRegistry.kw_per_hz, deficit);
+    if (roc < 0) {
+        required += fix16_mul(xRegistry.kw_per_hz_s, -roc);
+    }
+    if (required <= 0) {
+        return wired;
+    }
+
+    /* Round the requirement up to a step, so the set always covers it */
+    kw = (uint32_t)(required + FIX16_ONE - 1) >> FIX16_SHIFT;
+    k = (kw + ulStepKw - 1) / ulStepKw;
+    shed = usShedTable[k < REGISTRY_STEPS ? k : REGISTRY_STEPS - 1];
+
+    if (shed & held_on) {
+        shed = 0;
+        kw = (uint32_t)required;
+        for (i = 0; i < ulShedOrderCount && kw > 0; i++) {
+            if (!(held_on & (1u << ucShedOrder[i]))) {
+                shed |= (uint16_t)(1u << ucShedOrder[i]);
+                kw = kw > ((uint32_t)xRegistry.load[ucShedOrder[i]].rating_kw << FIX16_SHIFT) ?
+                     kw - ((uint32_t)xRegistry.load[ucShedOrder[i]].rating_kw << FIX16_SHIFT) : 0;
+            }
+        }
+    }
+    return wired & ~(LoadMask_t)shed;
+}
+
+void vLoadLocksInit(LoadLocks_t *pxLocks, LoadMask_t connected, uint32_t now_ms) {
+    int i;
+
+    pxLocks->state = (uint16_t)connected;
+    for (i = 0; i < REGISTRY_LOADS; i++) {
+        pxLocks->changed_ms[i] = now_ms - UINT16_MAX;
+    }
+}
+
+LoadMask_t xLoadLocksHeld(LoadLocks_t *pxLocks, LoadMask_t connected, uint32_t now_ms) {
+    uint16_t changed = pxLocks->state ^ (uint16_t)connected;
+    uint16_t held = 0, bit;
+    uint32_t hold;
+    int i;
+
+    pxLocks->state = (uint16_t)connected;
+    if (!xHaveRegistry) {
+        return 0;
+    }
+
+    for (i = 0; i < REGISTRY_LOADS; i++) {
+        bit = (uint16_t)(1u << i);
+        if (changed & bit) {
+            pxLocks->changed_ms[i] = now_ms;
+        }
+        hold = (connected & bit) ? xRegistry.load[i].min_on_ms : xRegistry.load[i].min_off_ms;
+        if (hold != 0 && now_ms - pxLocks->changed_ms[i] < hold) {
+            held |= bit;
+        }
+    }
+    return held;
+}
@@ -0,0 +1,96 @@
+/**
+ * Load registry and power-weighted shed selection
+ *
+ * The policy table treats the loads as equal bits in fixed groups. A site
+ * whose outputs have different ratings can instead flash a registry giving
+ * each load its rating, priority and minimum on and off times. With a valid
+ * registry the decision asks for a power reduction instead of a band mask:
+ *
+ *   required kW = kw_per_hz * deficit Hz + kw_per_hz_s * falling RoC Hz/s
+ *
+ * and sheds the cheapest set of loads that covers it. A load costs one more
+ * than all the less important loads together, so it only goes when they
+ * cannot cover the requirement without it; among sets of equal cost the
+ * one shedding the least power wins.
+ *
+ * The exact answer is found once, in xLoadRegistryInit(): every subset of
+ * the sheddable loads is visited in Gray code order (one load added or
+ * removed per step) and the cheapest one reaching each of REGISTRY_STEPS
+ * power steps is kept. A decision is then one table read. If the table's
+ * answer includes a load held on by its minimum on time, a greedy pass over
+ * the loads in cost order picks from the rest instead, bounded by
+ * REGISTRY_LOADS.
+ *
+ * The registry rates the REGISTRY_LOADS loads of output port 0 (see
+ * load_mask.h), which keeps both its flash image and the subset search,
+ * 2^n steps for n sheddable loads, the size they have always been. Loads on
+ * further ports are unrated: a registry decision keeps them and never
+ * holds them, so a site with more ports sheds those by the policy table.
+ *
+ * Without a registry in flash the policy table stays in charge, as before.
+ * The image sits in the second half of the policy sector, magic, version
+ * and checksum checked like the policy's; tools/load_registry.py writes one.
+ */
+
+#ifndef LOAD_REGISTRY_H
+#define LOAD_REGISTRY_H
+
+#include <stdint.h>
+#include "fix16.h"
+#include "load_decision.h"
+
+#define REGISTRY_MAGIC                 0x4C4F4144UL  // "LOAD"
+#define REGISTRY_VERSION               1
+#define REGISTRY_FLASH_OFFSET          0x7F8000      // Second half of the policy sector
+#define REGISTRY_STEPS                 64            // Power steps in the selection table
+#define REGISTRY_PRIORITY_MAX          15            // Least important
+#define REGISTRY_LOADS                 LOAD_PORT_BITS  // Rated loads, output port 0's
+
+/* Loads the registry has no rating for */
+#define REGISTRY_UNRATED               ((LoadMask_t)~(LoadMask_t)LOAD_PORT_MASK)
+
+typedef struct {
+    uint16_t rating_kw;                // 0 if nothing is wired to the output
+    uint8_t priority;                  // 0 most important .. REGISTRY_PRIORITY_MAX
+    uint8_t reserved;
+    uint16_t min_on_ms;                // Not shed until on this long
+    uint16_t min_off_ms;               // Not reconnected until off this long
+} LoadRating_t;
+
+typedef struct {
+    uint32_t magic;                    // REGISTRY_MAGIC
+    uint16_t version;                  // REGISTRY_VERSION
+    uint16_t reserved;
+    fix16_t kw_per_hz;                 // Shed per Hz below the lower limit (kW, Q16.16)
+    fix16_t kw_per_hz_s;               // Shed per Hz/s of falling RoC (kW, Q16.16)
+    LoadRating_t load[REGISTRY_LOADS];
+    uint32_t checksum;                 // As ulLoadPolicyChecksum, everything above
+} LoadRegistry_t;
+
+/* Minimum on/off time tracking, one per set of outputs */
+typedef struct {
+    uint16_t state;                    // Rated loads connected at the last update
+    uint32_t changed_ms[REGISTRY_LOADS];  // When each rated load last switched
+} LoadLocks_t;
+
+/* Read the registry from flash and build the selection table. Returns 1 if
+ * a registry was accepted, 0 if the policy table stays in use. */
+int xLoadRegistryInit(void);
+
+/* Accepted registry, NULL if there is none */
+const LoadRegistry_t *pxLoadRegistryGet(void);
+
+/* Loads to keep for a deficit below the lower limit (Hz) and RoC, never
+ * shedding the critical loads or those in held_on. Nothing is shed for a
+ * deficit of 0 or less, whatever the RoC; unwired loads are never kept,
+ * unrated ones always are. */
+LoadMask_t xLoadRegistryTarget(fix16_t deficit, fix16_t roc, LoadMask_t held_on);
+
+/* Start tracking with nothing held */
+void vLoadLocksInit(LoadLocks_t *pxLocks, LoadMask_t connected, uint32_t now_ms);
+
+/* Note which loads switched since the last call and return those that must
+ * keep their present state, rated loads only */
+LoadMask_t xLoadLocksHeld(LoadLocks_t *pxLocks, LoadMask_t connected, uint32_t now_ms);
+
+#endif /* LOAD_REGISTRY_H */
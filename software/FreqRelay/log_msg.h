@@ -0,0 +1,38 @@
+/**
+ * Deferred-format log messages
+ *
+ * vLogPost() queues a message number and two argument words as a telemetry
+ * record (TELEMETRY_LOG). The text is only put together on the host by
+ * tools/telemetry_decode.py, which reads the formats from the comments
+ * below, so a post costs the same 20 byte copy as any other record and
+ * needs no printf, no UART lock and no stack for either. It is safe from
+ * an ISR.
+ *
+ * A format takes up to two of %u, %d and %x, each one argument word. The
+ * numbers end up in captures: add messages at the end, do not renumber.
+ * Reports that are formatted anyway (the run statistics, the boot banner)
+ * stay as printf.
+ */
+
+#ifndef LOG_MSG_H
+#define LOG_MSG_H
+
+#include <stdint.h>
+#include "telemetry.h"
+
+/* Messages, the decoder takes the format from the comment */
+#define LOG_VGA_NO_PIXEL_BUFFER        1      // "VGA: cannot find the pixel buffer device"
+#define LOG_VGA_RASTER_FALLBACK        2      // "VGA: pixel format not supported by the rasterizer, using the driver"
+#define LOG_VGA_NO_CHAR_BUFFER         3      // "VGA: cannot find the character buffer device"
+#define LOG_DEADLINE_MISSED            4      // "Deadline: control tasks 0x%x missed, longest run %u"
+#define LOG_VGA_FRAME_MOVED            5      // "VGA: frame at 0x%x is outside the SRAM, moved to 0x%x"
+#define LOG_HEAP_REFUSED               6      // "Heap: frozen, %u bytes refused to the call site at 0x%x"
+#define LOG_EXCURSION                  7      // "Excursion: closed after %u ms, feeder << 8 | deepest band 0x%x"
+#define LOG_MODE                       8      // "Mode: state %u, display | stats << 8 | exports << 16 0x%x"
+#define LOG_INTEGRITY                  9      // "Integrity: regions 0x%x changed, the first's CRC now 0x%x"
+
+static inline void vLogPost(uint32_t ulMessage, uint32_t a, uint32_t b) {
+    vTelemetryPost(TELEMETRY_LOG, ulMessage, a, b);
+}
+
+#endif /* LOG_MSG_H */
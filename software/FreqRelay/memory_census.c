@@ -0,0 +1,147 @@
+/**
+ * Memory census: heap, stacks, pools, queues and rings
+ *
+ * See memory_census.h.
+ */
+
+/* Standard includes */
+#include <stdio.h>
+#include <string.h>
+
+/* Hardware includes */
+#include "system.h"
+
+/* Application includes */
+#include "memory_census.h"
+#include "seqlock.h"
+
+static const char *const pcKindName[] = { "Stack", "Pool", "Queue", "Ring" };
+static const char *const pcRegionName[] = { "SDRAM", "on-chip", "-" };
+
+/* Published for readers */
+static Census_t xPublished;
+static SeqLock_t xPublishedSeq = SEQLOCK_INIT;
+
+void vCensusStart(Census_t *pxCensus) {
+#if configUSE_TLSF_HEAP
+    HeapStats_t heap;
+
+    vPortGetHeapStats(&heap);
+    pxCensus->heap_total = heap.xTotalBytes;
+    pxCensus->heap_free = heap.xFreeBytes;
+    pxCensus->heap_min_free = heap.xMinimumEverFreeBytes;
+    pxCensus->heap_largest = heap.xLargestFreeBlock;
+    pxCensus->heap_fragments = heap.xFreeBlocks;
+    pxCensus->heap_frag_permille = heap.ulFragmentationPermille;
+    pxCensus->heap_failed = heap.xFailedAllocations;
+#else
+    /* heap_4 keeps only the two totals */
+    pxCensus->heap_total = configTOTAL_HEAP_SIZE;
+    pxCensus->heap_free = xPortGetFreeHeapSize();
+    pxCensus->heap_min_free = xPortGetMinimumEverFreeHeapSize();
+    pxCensus->heap_largest = 0;
+    pxCensus->heap_fragments = 0;
+    pxCensus->heap_frag_permille = 0;
+    pxCensus->heap_failed = 0;
+#endif
+    pxCensus->count = 0;
+}
+
+void vCensusAdd(Census_t *pxCensus, uint8_t kind, const char *pcName, const void *pvStorage,
+                uint32_t capacity, uint32_t peak, uint16_t unit_bytes) {
+    CensusEntry_t *pxEntry;
+    uint32_t address = (uint32_t)pvStorage;
+
+    if (pxCensus->count >= CENSUS_ENTRIES) {
+        return;
+    }
+    pxEntry = &pxCensus->entry[pxCensus->count++];
+    strncpy(pxEntry->name, pcName, CENSUS_NAME_LEN - 1);
+    pxEntry->name[CENSUS_NAME_LEN - 1] = '\0';
+    pxEntry->kind = kind;
+    if (pvStorage == NULL) {
+        pxEntry->region = CENSUS_UNPLACED;
+    } else {
+        pxEntry->region = (address - ONCHIP_MEMORY_BASE) < ONCHIP_MEMORY_SPAN ? CENSUS_ONCHIP : CENSUS_SDRAM;
+    }
+    pxEntry->unit_bytes = unit_bytes;
+    pxEntry->capacity = capacity;
+    pxEntry->peak = peak > capacity ? capacity : peak;
+}
+
+void vCensusAddStack(Census_t *pxCensus, const char *pcName, TaskHandle_t xTask,
+                     const void *pvStack, uint32_t words) {
+    uint32_t never_used;
+
+    if (xTask == NULL) {
+        return;
+    }
+    never_used = uxTaskGetStackHighWaterMark(xTask);
+
+    /* A heap stack is where the task's TCB is, both come from the heap */
+    vCensusAdd(pxCensus, CENSUS_STACK, pcName, pvStack != NULL ? pvStack : (const void *)xTask, words,
+               never_used < words ? words - never_used : 0, sizeof(StackType_t));
+}
+
+void vCensusAddPool(Census_t *pxCensus, const char *pcName, const Pool_t *pxPool) {
+    vCensusAdd(pxCensus, CENSUS_POOL, pcName, pxPool->pucStart, pxPool->usCount,
+               usPoolHighWater(pxPool), pxPool->usSlotSize);
+}
+
+void vCensusAddQueue(Census_t *pxCensus, const char *pcName, QueueHandle_t xQueue, uint16_t item_bytes) {
+    if (xQueue == NULL) {
+        return;
+    }
+    /* The queue and its items are one allocation, at the handle */
+    vCensusAdd(pxCensus, CENSUS_QUEUE, pcName, xQueue,
+               uxQueueMessagesWaiting(xQueue) + uxQueueSpacesAvailable(xQueue),
+               uxQueueMessagesPeak(xQueue), item_bytes);
+}
+
+void vCensusPublish(const Census_t *pxCensus) {
+    vSeqWriteBegin(&xPublishedSeq);
+    memcpy(&xPublished, pxCensus, sizeof(Census_t));
+    vSeqWriteEnd(&xPublishedSeq);
+}
+
+void vCensusGet(Census_t *pxCensus) {
+    vSeqRead(&xPublishedSeq, pxCensus, &xPublished, sizeof(Census_t));
+}
+
+void vCensusPrint(const Census_t *pxCensus) {
+    const CensusEntry_t *pxEntry;
+    uint32_t i, spare, spare_sdram = 0, spare_onchip = 0;
+
+    printf("Heap: %lu bytes, %lu free, lowest free %lu (peak use %lu)",
+           (unsigned long)pxCensus->heap_total, (unsigned long)pxCensus->heap_free,
+           (unsigned long)pxCensus->heap_min_free,
+           (unsigned long)(pxCensus->heap_total - pxCensus->heap_min_free));
+    if (pxCensus->heap_fragments != 0) {
+        printf(", largest block %lu, %lu fragments (%lu.%lu%%)", (unsigned long)pxCensus->heap_largest,
+               (unsigned long)pxCensus->heap_fragments, (unsigned long)(pxCensus->heap_frag_permille / 10),
+               (unsigned long)(pxCensus->heap_frag_permille % 10));
+    }
+    printf(", %lu failed\n", (unsigned long)pxCensus->heap_failed);
+
+    printf("Kind  Name            Peak  Capacity  Use%%  Spare bytes  Memory\n");
+    for (i = 0; i < pxCensus->count; i++) {
+        pxEntry = &pxCensus->entry[i];
+        spare = (pxEntry->capacity - pxEntry->peak) * pxEntry->unit_bytes;
+        if (pxEntry->region == CENSUS_ONCHIP) {
+            spare_onchip += spare;
+        } else if (pxEntry->region == CENSUS_SDRAM) {
+            spare_sdram += spare;
+        }
+        printf("%-5s %-12s %7lu %9lu %5lu ", pcKindName[pxEntry->kind], pxEntry->name,
+               (unsigned long)pxEntry->peak, (unsigned long)pxEntry->capacity,
+               (unsigned long)(pxEntry->capacity ? (pxEntry->peak * 100 + pxEntry->capacity - 1) / pxEntry->capacity : 0));
+        if (pxEntry->unit_bytes != 0) {
+            printf("%12lu", (unsigned long)spare);
+        } else {
+            printf("%12s", "-");
+        }
+        printf("  %s\n", pcRegionName[pxEntry->region]);
+    }
+    printf("Spare at peak: %lu bytes on-chip, %lu in SDRAM\n",
+           (unsigned long)spare_onchip, (unsigned long)spare_sdram);
+}
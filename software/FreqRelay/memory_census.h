@@ -0,0 +1,93 @@
+/**
+ * Memory census: heap, stacks, pools, queues and rings
+ *
+ * Every statically sized piece of RAM the system has (the kernel heap, each
+ * task stack and the interrupt stack, the object pools, the kernel queues
+ * and the lock free rings) gets one entry: its capacity and the most of it
+ * ever used since boot, in the object's own unit. The figures are all
+ * high-water marks the owners keep anyway (stack fill, usMinFree,
+ * uxQueueMessagesPeak(), a ring's high_water), so taking a census reads
+ * them and nothing on the control path pays for it.
+ *
+ * Each entry also records whether its storage is in on-chip RAM or SDRAM
+ * (from its address), so the report shows how much of a hot object is
+ * spare before it is moved on-chip, and how much a stack or ring could be
+ * trimmed to make room.
+ *
+ * The run stats task takes a census each period and publishes it, the VGA
+ * diagnostics page copies it out; vCensusPrint() writes one over the JTAG
+ * UART on demand.
+ */
+
+#ifndef MEMORY_CENSUS_H
+#define MEMORY_CENSUS_H
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "pool.h"
+
+#define CENSUS_ENTRIES                 32     // Application, kernel, with spare
+#define CENSUS_NAME_LEN                12
+
+/* What an entry counts */
+#define CENSUS_STACK                   0      // Words
+#define CENSUS_POOL                    1      // Slots
+#define CENSUS_QUEUE                   2      // Items
+#define CENSUS_RING                    3      // Entries
+
+/* Where an entry's storage is */
+#define CENSUS_SDRAM                   0
+#define CENSUS_ONCHIP                  1
+#define CENSUS_UNPLACED                2      // Not given
+
+typedef struct {
+    char name[CENSUS_NAME_LEN];
+    uint8_t kind;                      // CENSUS_STACK ...
+    uint8_t region;                    // CENSUS_SDRAM ...
+    uint16_t unit_bytes;               // Size of one unit, 0 if not known
+    uint32_t capacity;                 // Units
+    uint32_t peak;                     // Most units ever in use
+} CensusEntry_t;
+
+typedef struct {
+    uint32_t heap_total;               // Bytes
+    uint32_t heap_free;
+    uint32_t heap_min_free;            // Lowest ever
+    uint32_t heap_largest;             // Largest free block, 0 if not known
+    uint32_t heap_fragments;           // Free blocks, 0 if not known
+    uint32_t heap_frag_permille;       // Free bytes outside the largest block
+    uint32_t heap_failed;              // pvPortMalloc() calls that returned NULL
+    uint32_t count;                    // Valid entries in entry[]
+    CensusEntry_t entry[CENSUS_ENTRIES];
+} Census_t;
+
+/* Empty census with the heap figures filled in */
+void vCensusStart(Census_t *pxCensus);
+
+/* One entry; pvStorage (may be NULL) only places it in memory. Entries past
+ * CENSUS_ENTRIES are dropped. */
+void vCensusAdd(Census_t *pxCensus, uint8_t kind, const char *pcName, const void *pvStorage,
+                uint32_t capacity, uint32_t peak, uint16_t unit_bytes);
+
+/* A task's stack of words words, left out if xTask is NULL. pvStack NULL
+ * for a stack taken from the heap. */
+void vCensusAddStack(Census_t *pxCensus, const char *pcName, TaskHandle_t xTask,
+                     const void *pvStack, uint32_t words);
+
+void vCensusAddPool(Census_t *pxCensus, const char *pcName, const Pool_t *pxPool);
+
+/* Left out if xQueue is NULL (not created yet) */
+void vCensusAddQueue(Census_t *pxCensus, const char *pcName, QueueHandle_t xQueue, uint16_t item_bytes);
+
+/* Publish a census for vCensusGet(). One writer. */
+void vCensusPublish(const Census_t *pxCensus);
+
+/* Consistent copy of the last published census, count 0 before the first */
+void vCensusGet(Census_t *pxCensus);
+
+/* Write a census as a table, the UART held by the caller */
+void vCensusPrint(const Census_t *pxCensus);
+
+#endif /* MEMORY_CENSUS_H */
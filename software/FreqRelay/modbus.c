@@ -0,0 +1,372 @@
+/**
+ * Modbus RTU slave on the RS-232 UART
+ *
+ * See modbus.h.
+ */
+
+/* Scheduler includes */
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/* Hardware includes */
+#include "system.h"
+#include "altera_avalon_uart_regs.h"
+
+/* Application includes */
+#include "crc16.h"
+#include "irq_defer.h"
+#include "latency.h"
+#include "modbus.h"
+
+#define MODBUS_LINE_ERRORS             (ALTERA_AVALON_UART_STATUS_PE_MSK | ALTERA_AVALON_UART_STATUS_FE_MSK | \
+                                        ALTERA_AVALON_UART_STATUS_ROE_MSK)
+#define MODBUS_CONTROL_RX              (ALTERA_AVALON_UART_CONTROL_RRDY_MSK | ALTERA_AVALON_UART_CONTROL_E_MSK)
+
+/* Free-running indices as in the other rings: the interrupt writes rx.head
+ * and tx.tail, the task rx.tail and tx.head */
+typedef struct {
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    volatile uint32_t stamp;           // Timestamp count of the newest byte
+    volatile uint8_t error;            // Line error or overflow since the task last looked
+    uint8_t data[MODBUS_RX_RING_SIZE];
+} ModbusRxRing_t;
+
+typedef struct {
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    uint8_t data[MODBUS_TX_RING_SIZE];
+} ModbusTxRing_t;
+
+static ModbusRxRing_t xRx;
+static ModbusTxRing_t xTx;
+static volatile uint32_t ulControl;    // Control register copy, changed in critical sections or the ISR
+static TaskHandle_t xModbusTask = NULL;
+static const ModbusMap_t *pxModbusMap;
+static uint8_t ucAddress;
+
+/* Request being parsed and reply being built, task only: in the rings for
+ * RTU, in the datagrams for UDP */
+static const uint8_t *pucReq;
+static uint32_t ulReqMask;
+static uint8_t *pucOut;
+static uint32_t ulOutMask;
+static uint32_t ulReplyStart;
+static uint8_t ucReplyAddress;
+static uint32_t ulTxPut;
+static uint16_t usTxCrc;
+
+static ModbusStats_t xStats;
+
+static void vModbusISRHandler(void *context) {
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    uint32_t status, head, tail;
+    uint8_t byte;
+
+    status = IORD_ALTERA_AVALON_UART_STATUS(UART_BASE);
+
+    if (status & MODBUS_LINE_ERRORS) {
+        xRx.error = 1;
+        IOWR_ALTERA_AVALON_UART_STATUS(UART_BASE, 0);
+    }
+
+    /* One byte of buffering in the core, read it now */
+    if (status & ALTERA_AVALON_UART_STATUS_RRDY_MSK) {
+        byte = (uint8_t)IORD_ALTERA_AVALON_UART_RXDATA(UART_BASE);
+        head = xRx.head;
+        if ((head - xRx.tail) >= MODBUS_RX_RING_SIZE) {
+            xRx.error = 1;
+        } else {
+            xRx.data[head & MODBUS_RX_RING_MASK] = byte;
+            xRx.head = head + 1;
+        }
+        xRx.stamp = ulLatencyNow();
+        vTaskNotifyGiveFromISR(xModbusTask, &xHigherPriorityTaskWoken);
+    }
+
+    if ((status & ALTERA_AVALON_UART_STATUS_TRDY_MSK) && (ulControl & ALTERA_AVALON_UART_CONTROL_TRDY_MSK)) {
+        tail = xTx.tail;
+        if (tail != xTx.head) {
+            IOWR_ALTERA_AVALON_UART_TXDATA(UART_BASE, xTx.data[tail & MODBUS_TX_RING_MASK]);
+            xTx.tail = tail + 1;
+        } else {
+            /* The task enables it again with the next reply */
+            ulControl = MODBUS_CONTROL_RX;
+            IOWR_ALTERA_AVALON_UART_CONTROL(UART_BASE, ulControl);
+        }
+    }
+
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
+/* Received frame bytes, i counted from the frame start */
+static inline uint8_t ucFrameByte(uint32_t start, uint32_t i) {
+    return pucReq[(start + i) & ulReqMask];
+}
+
+static inline uint16_t usFrameWord(uint32_t start, uint32_t i) {
+    return (uint16_t)((ucFrameByte(start, i) << 8) | ucFrameByte(start, i + 1));
+}
+
+static void vReplyByte(uint8_t byte) {
+    pucOut[ulTxPut & ulOutMask] = byte;
+    ulTxPut++;
+    usTxCrc = usCrc16Byte(usTxCrc, byte);
+}
+
+static void vReplyWord(uint16_t word) {
+    vReplyByte((uint8_t)(word >> 8));
+    vReplyByte((uint8_t)word);
+}
+
+/* Start a reply after whatever the interrupt is still sending, or at the
+ * start of the reply datagram */
+static void vReplyBegin(uint8_t function) {
+    ulTxPut = ulReplyStart;
+    usTxCrc = CRC16_INIT;
+    vReplyByte(ucReplyAddress);
+    vReplyByte(function);
+}
+
+/* CRC low byte first, then hand the reply to the interrupt */
+static void vReplySend(void) {
+    uint16_t crc = usTxCrc;
+
+    vReplyByte((uint8_t)crc);
+    vReplyByte((uint8_t)(crc >> 8));
+
+    taskENTER_CRITICAL();
+    xTx.head = ulTxPut;
+    ulControl = MODBUS_CONTROL_RX | ALTERA_AVALON_UART_CONTROL_TRDY_MSK;
+    IOWR_ALTERA_AVALON_UART_CONTROL(UART_BASE, ulControl);
+    taskEXIT_CRITICAL();
+}
+
+/* Parse the request in the receive ring and say what to answer: the reply
+ * is left built in the transmit ring, or an exception code is returned.
+ * len covers the CRC. */
+static uint8_t ucModbusRequest(uint32_t start, uint32_t len, uint8_t function) {
+    uint16_t address, count, value, i;
+    uint8_t ex;
+
+    switch (function) {
+    case MODBUS_FC_READ_HOLDING:
+    case MODBUS_FC_READ_INPUT:
+        address = usFrameWord(start, 2);
+        count = usFrameWord(start, 4);
+        if (len != 8 || count == 0 || count > MODBUS_READ_MAX) {
+            return MODBUS_EX_ILLEGAL_VALUE;
+        }
+        vReplyBegin(function);
+        vReplyByte((uint8_t)(count * 2));
+        for (i = 0; i < count; i++) {
+            ex = pxModbusMap->pxRead(function, (uint16_t)(address + i), &value);
+            if (ex != MODBUS_EX_NONE) {
+                return ex;
+            }
+            vReplyWord(value);
+        }
+        return MODBUS_EX_NONE;
+
+    case MODBUS_FC_WRITE_SINGLE:
+        if (len != 8) {
+            return MODBUS_EX_ILLEGAL_VALUE;
+        }
+        ex = pxModbusMap->pxWrite(usFrameWord(start, 2), usFrameWord(start, 4));
+        if (ex == MODBUS_EX_NONE) {
+            ex = pxModbusMap->pxCommit();
+        }
+        if (ex != MODBUS_EX_NONE) {
+            return ex;
+        }
+        /* The reply echoes the request */
+        vReplyBegin(function);
+        for (i = 2; i < 6; i++) {
+            vReplyByte(ucFrameByte(start, i));
+        }
+        return MODBUS_EX_NONE;
+
+    case MODBUS_FC_WRITE_MULTIPLE:
+        address = usFrameWord(start, 2);
+        count = usFrameWord(start, 4);
+        if (count == 0 || count > MODBUS_WRITE_MAX || ucFrameByte(start, 6) != count * 2 ||
+            len != 9 + 2 * (uint32_t)count) {
+            return MODBUS_EX_ILLEGAL_VALUE;
+        }
+        for (i = 0; i < count; i++) {
+            ex = pxModbusMap->pxWrite((uint16_t)(address + i), usFrameWord(start, 7 + 2 * (uint32_t)i));
+            if (ex != MODBUS_EX_NONE) {
+                return ex;
+            }
+        }
+        ex = pxModbusMap->pxCommit();
+        if (ex != MODBUS_EX_NONE) {
+            return ex;
+        }
+        vReplyBegin(function);
+        vReplyWord(address);
+        vReplyWord(count);
+        return MODBUS_EX_NONE;
+
+    default:
+        return MODBUS_EX_ILLEGAL_FUNCTION;
+    }
+}
+
+/* One complete frame of len bytes at start in the receive ring */
+static void vModbusFrame(uint32_t start, uint32_t len) {
+    uint16_t crc = CRC16_INIT;
+    uint32_t i;
+    uint8_t address, function, ex;
+
+    if (xRx.error || len < 4 || len > MODBUS_FRAME_MAX) {
+        xRx.error = 0;
+        xStats.line_errors++;
+        return;
+    }
+
+    /* Over the CRC as well, a good frame leaves 0 */
+    for (i = 0; i < len; i++) {
+        crc = usCrc16Byte(crc, ucFrameByte(start, i));
+    }
+    if (crc != 0) {
+        xStats.crc_errors++;
+        return;
+    }
+
+    address = ucFrameByte(start, 0);
+    if (address != ucAddress && address != 0) {
+        xStats.other_slaves++;
+        return;
+    }
+    xStats.requests++;
+
+    /* A reply might not fit behind one still being sent; the master has
+     * not waited for it, so this one is dropped too */
+    if (MODBUS_TX_RING_SIZE - (xTx.head - xTx.tail) < MODBUS_FRAME_MAX) {
+        return;
+    }
+
+    /* Broadcast reads have nobody to answer, there is nothing to do */
+    function = ucFrameByte(start, 1);
+    if (address == 0 && (function == MODBUS_FC_READ_HOLDING || function == MODBUS_FC_READ_INPUT)) {
+        return;
+    }
+
+    pucOut = xTx.data;
+    ulOutMask = MODBUS_TX_RING_MASK;
+    ulReplyStart = xTx.head;
+    ucReplyAddress = ucAddress;
+    pxModbusMap->pxBegin(function);
+    ex = ucModbusRequest(start, len, function);
+    if (address == 0) {
+        return;
+    }
+    if (ex != MODBUS_EX_NONE) {
+        /* Rewrite whatever was built with the exception */
+        xStats.exceptions++;
+        vReplyBegin((uint8_t)(function | 0x80));
+        vReplyByte(ex);
+    }
+    vReplySend();
+}
+
+void vModbusService(void) {
+    uint32_t head;
+
+    for (;;) {
+        head = xRx.head;
+        if (head == xRx.tail) {
+            return;
+        }
+
+        /* The frame is complete once the line has been quiet for 3.5
+         * characters; a byte arriving meanwhile starts the wait again */
+        if (ulLatencyElapsedUs(xRx.stamp, ulLatencyNow()) < MODBUS_T35_US || head != xRx.head) {
+            vTaskDelay(1);
+            continue;
+        }
+
+        pucReq = xRx.data;
+        ulReqMask = MODBUS_RX_RING_MASK;
+        vModbusFrame(xRx.tail, head - xRx.tail);
+        xRx.tail = head;
+    }
+}
+
+int xModbusInit(uint8_t address, const ModbusMap_t *pxMap, TaskHandle_t xTask) {
+    if (xTask == NULL || pxMap == NULL) {
+        return -1;
+    }
+
+    xModbusTask = xTask;
+    pxModbusMap = pxMap;
+    ucAddress = address;
+    xRx.head = 0;
+    xRx.tail = 0;
+    xRx.error = 0;
+    xTx.head = 0;
+    xTx.tail = 0;
+
+    /* Replaces the BSP driver's handler and its interrupt enables. The
+     * core holds one received byte, 87 us at 115200, so the interrupt is
+     * above the kernel's. */
+    IOWR_ALTERA_AVALON_UART_CONTROL(UART_BASE, 0);
+    vPortSetIrqPriority(UART_IRQ, configMAX_SYSCALL_INTERRUPT_PRIORITY);
+    if (xIrqRegister(UART_IRQ, vModbusISRHandler, NULL) != 0) {
+        return -1;
+    }
+
+    (void)IORD_ALTERA_AVALON_UART_RXDATA(UART_BASE);
+    IOWR_ALTERA_AVALON_UART_STATUS(UART_BASE, 0);
+    ulControl = MODBUS_CONTROL_RX;
+    IOWR_ALTERA_AVALON_UART_CONTROL(UART_BASE, ulControl);
+    return 0;
+}
+
+uint32_t ulModbusUdp(const uint8_t *pucRequest, uint32_t len, uint8_t *pucReply) {
+    uint32_t length;
+    uint8_t function, ex;
+
+    /* MBAP header: transaction, protocol 0, length of the unit and PDU */
+    if (pxModbusMap == NULL || len < MODBUS_MBAP_BYTES + 2 || pucRequest[2] != 0 || pucRequest[3] != 0) {
+        xStats.line_errors++;
+        return 0;
+    }
+    length = ((uint32_t)pucRequest[4] << 8) | pucRequest[5];
+    if (length < 2 || length + MODBUS_MBAP_BYTES - 1 != len || length + 2 > MODBUS_FRAME_MAX) {
+        xStats.line_errors++;
+        return 0;
+    }
+    xStats.udp_requests++;
+
+    /* From the unit on it is laid out as an RTU frame without the CRC; the
+     * IP address picks the relay, so any unit is this one and is echoed */
+    pucReq = &pucRequest[MODBUS_MBAP_BYTES - 1];
+    ulReqMask = 0xFFFFFFFFUL;          // Straight, no ring
+    pucOut = &pucReply[MODBUS_MBAP_BYTES - 1];
+    ulOutMask = 0xFFFFFFFFUL;
+    ulReplyStart = 0;
+    ucReplyAddress = pucReq[0];
+
+    function = pucReq[1];
+    pxModbusMap->pxBegin(function);
+    ex = ucModbusRequest(0, length + 2, function);
+    if (ex != MODBUS_EX_NONE) {
+        xStats.exceptions++;
+        vReplyBegin((uint8_t)(function | 0x80));
+        vReplyByte(ex);
+    }
+
+    pucReply[0] = pucRequest[0];
+    pucReply[1] = pucRequest[1];
+    pucReply[2] = 0;
+    pucReply[3] = 0;
+    pucReply[4] = (uint8_t)(ulTxPut >> 8);
+    pucReply[5] = (uint8_t)ulTxPut;
+    return MODBUS_MBAP_BYTES - 1 + ulTxPut;
+}
+
+void vModbusGetStats(ModbusStats_t *pxStats) {
+    *pxStats = xStats;
+}
@@ -0,0 +1,111 @@
+/**
+ * Modbus RTU slave on the RS-232 UART
+ *
+ * Lets a SCADA master read the measured frequencies, the load states and
+ * the thresholds, and write the thresholds, over the altera_avalon_uart at
+ * its fixed 115200 8N1. The BSP's driver for it is interrupt driven but
+ * copies through its own buffers and has no notion of an RTU frame, so
+ * xModbusInit() takes the UART over at register level as jtag_uart does
+ * for the JTAG UART; nothing else uses it.
+ *
+ * The UART interrupt moves each received byte into a ring, stamps it and
+ * notifies the Modbus task. The task waits out the 3.5 character gap that
+ * ends a frame (MODBUS_T35_US, the fixed value the specification gives
+ * above 19200 baud) and parses the frame where it lies in the ring: the
+ * CRC, address and fields are read in place, nothing is copied. The reply
+ * is written straight into the transmit ring with its CRC computed on the
+ * way, and the interrupt sends it.
+ *
+ * Function codes 03 (read holding registers), 04 (read input registers),
+ * 06 (write single register) and 16 (write multiple registers). What the
+ * registers mean is the application's, through ModbusMap_t. Address 0 is
+ * broadcast: writes are applied, nothing is answered. A frame with a bad
+ * CRC, a line error or another slave's address is dropped unanswered, as
+ * the specification requires.
+ *
+ * The same requests also come as UDP datagrams (eth.h) with a Modbus-TCP
+ * MBAP header in place of the address and CRC: ulModbusUdp() parses one in
+ * its datagram and writes the reply into another, through the same code.
+ *
+ * Single producer (the interrupt), single consumer (the task given to
+ * xModbusInit, which calls vModbusService) for received bytes; the other
+ * way round for the transmit ring. Plain RS-232: an RS-485 transceiver
+ * would need its driver enable switched around each reply, and this UART
+ * core is built without an RTS output to do it with.
+ */
+
+#ifndef MODBUS_H
+#define MODBUS_H
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#ifndef MODBUS_ADDRESS
+#define MODBUS_ADDRESS                 1     // Slave address, 1 to 247
+#endif
+
+#define MODBUS_RX_RING_SIZE            512   // Received bytes, power of 2, two whole frames
+#define MODBUS_RX_RING_MASK            (MODBUS_RX_RING_SIZE - 1)
+#define MODBUS_TX_RING_SIZE            512   // Reply bytes, power of 2
+#define MODBUS_TX_RING_MASK            (MODBUS_TX_RING_SIZE - 1)
+#define MODBUS_FRAME_MAX               256   // RTU frame limit, address to CRC
+#define MODBUS_T35_US                  1750  // Inter-frame silence above 19200 baud
+#define MODBUS_READ_MAX                125   // Registers per read request
+#define MODBUS_WRITE_MAX               123   // Registers per write multiple request
+#define MODBUS_MBAP_BYTES              7     // Transaction, protocol, length, unit
+#define MODBUS_UDP_REPLY_MAX           (MODBUS_MBAP_BYTES + MODBUS_FRAME_MAX)
+
+/* Function codes */
+#define MODBUS_FC_READ_HOLDING         0x03
+#define MODBUS_FC_READ_INPUT           0x04
+#define MODBUS_FC_WRITE_SINGLE         0x06
+#define MODBUS_FC_WRITE_MULTIPLE       0x10
+
+/* Exception codes, 0 is success */
+#define MODBUS_EX_NONE                 0x00
+#define MODBUS_EX_ILLEGAL_FUNCTION     0x01
+#define MODBUS_EX_ILLEGAL_ADDRESS      0x02
+#define MODBUS_EX_ILLEGAL_VALUE        0x03
+#define MODBUS_EX_BUSY                 0x06  // Slave device busy, the master sends it again later
+
+/* The application's registers, all called from the Modbus task. A request
+ * starts with pxBegin(). Reads call pxRead() for each register; writes call
+ * pxWrite() for each register, then pxCommit() once to apply them all, so
+ * a rejected value leaves every register as it was. Each returns a
+ * MODBUS_EX_* code. */
+typedef struct {
+    void (*pxBegin)(uint8_t function);
+    uint8_t (*pxRead)(uint8_t function, uint16_t address, uint16_t *pusValue);
+    uint8_t (*pxWrite)(uint16_t address, uint16_t value);
+    uint8_t (*pxCommit)(void);
+} ModbusMap_t;
+
+typedef struct {
+    uint32_t requests;                 // Frames for this slave (or broadcast) with a good CRC
+    uint32_t exceptions;               // Exception replies
+    uint32_t crc_errors;
+    uint32_t line_errors;              // Parity, framing, overrun, ring full or bad length
+    uint32_t other_slaves;             // Good frames for another address
+    uint32_t udp_requests;             // Well formed datagrams
+} ModbusStats_t;
+
+/* Take the UART over and start receiving, before the scheduler starts.
+ * xTask is notified on every received byte and calls vModbusService().
+ * Returns 0 on success. */
+int xModbusInit(uint8_t address, const ModbusMap_t *pxMap, TaskHandle_t xTask);
+
+/* Answer every complete frame received, Modbus task only. Blocks while a
+ * frame is still arriving, returns when the receive ring is empty. */
+void vModbusService(void);
+
+/* Answer the MBAP framed request of len bytes at pucRequest into
+ * pucReply, MODBUS_UDP_REPLY_MAX bytes. Returns the reply's length, 0 for
+ * nothing to send. Modbus task only, as it shares the parser. */
+uint32_t ulModbusUdp(const uint8_t *pucRequest, uint32_t len, uint8_t *pucReply);
+
+/* Counters since boot. Each word is written by the Modbus task alone and
+ * read whole. */
+void vModbusGetStats(ModbusStats_t *pxStats);
+
+#endif /* MODBUS_H */
@@ -0,0 +1,104 @@
+/**
+ * Message bus: static publish/subscribe topics
+ *
+ * See msg_bus.h.
+ */
+
+/* Standard includes */
+#include <string.h>
+
+/* Application includes */
+#include "msg_bus.h"
+
+/* Slot of message number n */
+static inline uint8_t *pucBusSlot(const BusTopic_t *pxTopic, uint32_t n) {
+    return pxTopic->pucSlots + ((n - 1) & (pxTopic->usDepth - 1)) * pxTopic->usSlotSize;
+}
+
+void vBusTopicInit(BusTopic_t *pxTopic, const char *pcName, void *pvStorage, size_t slot_size,
+                   uint16_t depth, const void *pvInitial) {
+    configASSERT(depth != 0 && (depth & (depth - 1)) == 0);
+
+    pxTopic->pcName = pcName;
+    pxTopic->pucSlots = (uint8_t *)pvStorage;
+    pxTopic->usSlotSize = (uint16_t)slot_size;
+    pxTopic->usDepth = depth;
+    pxTopic->lock.seq = 0;
+    pxTopic->ulPublished = 0;
+    pxTopic->pxSubscribers = NULL;
+    memset(pvStorage, 0, slot_size * depth);
+    if (pvInitial != NULL) {
+        memcpy(pvStorage, pvInitial, slot_size);
+        pxTopic->ulPublished = 1;
+    }
+}
+
+void vBusSubscribe(BusSubscriber_t *pxSub, BusTopic_t *pxTopic, TaskHandle_t xTask, uint32_t notify_bits) {
+    pxSub->pxTopic = pxTopic;
+    pxSub->xTask = xTask;
+    pxSub->ulNotifyBits = notify_bits;
+    pxSub->ulNext = pxTopic->ulPublished + 1;
+    pxSub->ulLost = 0;
+    pxSub->pxNext = pxTopic->pxSubscribers;
+    pxTopic->pxSubscribers = pxSub;
+}
+
+void *pvBusWriteBegin(BusTopic_t *pxTopic) {
+    vSeqWriteBegin(&pxTopic->lock);
+    return pucBusSlot(pxTopic, pxTopic->ulPublished + 1);
+}
+
+void vBusWriteEnd(BusTopic_t *pxTopic) {
+    BusSubscriber_t *pxSub;
+
+    pxTopic->ulPublished++;
+    vSeqWriteEnd(&pxTopic->lock);
+
+    for (pxSub = pxTopic->pxSubscribers; pxSub != NULL; pxSub = pxSub->pxNext) {
+        if (pxSub->xTask != NULL) {
+            xTaskNotify(pxSub->xTask, pxSub->ulNotifyBits, eSetBits);
+        }
+    }
+}
+
+void vBusPublish(BusTopic_t *pxTopic, const void *pvMsg) {
+    memcpy(pvBusWriteBegin(pxTopic), pvMsg, pxTopic->usSlotSize);
+    vBusWriteEnd(pxTopic);
+}
+
+uint32_t ulBusLatest(const BusTopic_t *pxTopic, void *pvMsg) {
+    uint32_t start, n;
+
+    do {
+        start = ulSeqReadBegin(&pxTopic->lock);
+        n = pxTopic->ulPublished;
+        if (n != 0) {
+            memcpy(pvMsg, pucBusSlot(pxTopic, n), pxTopic->usSlotSize);
+        }
+    } while (xSeqReadRetry(&pxTopic->lock, start));
+    return n;
+}
+
+int xBusRead(BusSubscriber_t *pxSub, void *pvMsg) {
+    const BusTopic_t *pxTopic = pxSub->pxTopic;
+    uint32_t start, newest, n;
+
+    do {
+        start = ulSeqReadBegin(&pxTopic->lock);
+        newest = pxTopic->ulPublished;
+        n = pxSub->ulNext;
+        if (newest - n + 1 > pxTopic->usDepth) {
+            n = newest - pxTopic->usDepth + 1;  // Overwritten up to the oldest kept
+        }
+        if (newest >= n) {
+            memcpy(pvMsg, pucBusSlot(pxTopic, n), pxTopic->usSlotSize);
+        }
+    } while (xSeqReadRetry(&pxTopic->lock, start));
+
+    if (newest < n) {
+        return 0;
+    }
+    pxSub->ulLost += n - pxSub->ulNext;
+    pxSub->ulNext = n + 1;
+    return 1;
+}
@@ -0,0 +1,100 @@
+/**
+ * Message bus: static publish/subscribe topics
+ *
+ * A topic carries one message type from one producer to any number of
+ * readers, through a ring of depth slots declared with BUS_STORAGE(). The
+ * producer fills the next slot in place between xBusWriteBegin() and
+ * vBusWriteEnd() (or copies a message in with vBusPublish()), and every
+ * message gets the next number, 1 up; 0 means nothing published yet.
+ *
+ *     BUS_STORAGE(xStatusSlots, Status_t, 4);
+ *     static BusTopic_t xStatusTopic;
+ *     vBusTopicInit(&xStatusTopic, "status", xStatusSlots, sizeof(xStatusSlots[0]), 4, NULL);
+ *
+ * A depth of 1 makes a latest-value topic: the one slot is overwritten by
+ * every message, and what a producer leaves alone keeps its last value. In
+ * a deeper ring the slot being filled holds a message depth old, so the
+ * producer writes all of it.
+ *
+ * Readers never block the producer and never lock. Each slot is guarded by
+ * the topic's sequence lock, so a reader copies a message out and retries
+ * if it was written meanwhile (see seqlock.h: the write stays a few stores
+ * in a critical section, and copied out that way no reader can see half a
+ * message). A reader wanting the newest message calls xBusLatest(); one
+ * wanting every message keeps a BusSubscriber_t with its place in the ring
+ * and calls xBusRead(), which counts the messages that were overwritten
+ * before it got to them rather than stalling the producer.
+ *
+ * Subscribers are registered before the scheduler starts. One with a task
+ * gets notify_bits set in that task's notification value (eSetBits) after
+ * every message, outside the write, so a task can wait on several topics
+ * and its other notifications at once with xTaskNotifyWait().
+ */
+
+#ifndef MSG_BUS_H
+#define MSG_BUS_H
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "seqlock.h"
+
+/* Ring of count slots of one message type, count a power of two */
+#define BUS_STORAGE(name, type, count) \
+    static type name[count]
+
+typedef struct BusSubscriber {
+    struct BusSubscriber *pxNext;      // Next on the topic
+    struct BusTopic *pxTopic;
+    TaskHandle_t xTask;                // Notified after every message, NULL: none
+    uint32_t ulNotifyBits;
+    uint32_t ulNext;                   // Number of the next message to read
+    uint32_t ulLost;                   // Messages overwritten before they were read
+} BusSubscriber_t;
+
+typedef struct BusTopic {
+    const char *pcName;
+    uint8_t *pucSlots;
+    uint16_t usSlotSize;
+    uint16_t usDepth;                  // Power of two, 1 for a latest-value topic
+    SeqLock_t lock;                    // Guards the slots and ulPublished
+    volatile uint32_t ulPublished;     // Number of the newest message, 0: none
+    BusSubscriber_t *pxSubscribers;
+} BusTopic_t;
+
+/* Bind a topic to its storage. pvInitial, if given, is published as
+ * message 1 so latest-value readers start from it. Before the scheduler. */
+void vBusTopicInit(BusTopic_t *pxTopic, const char *pcName, void *pvStorage, size_t slot_size,
+                   uint16_t depth, const void *pvInitial);
+
+/* Register a reader, starting after the newest message; xTask may be NULL.
+ * Before the scheduler. */
+void vBusSubscribe(BusSubscriber_t *pxSub, BusTopic_t *pxTopic, TaskHandle_t xTask, uint32_t notify_bits);
+
+/* The slot to fill with the next message. Opens the write: the caller holds
+ * a critical section until vBusWriteEnd(), so fill it with a few stores.
+ * Producer task only. */
+void *pvBusWriteBegin(BusTopic_t *pxTopic);
+
+/* Publish the slot filled since pvBusWriteBegin() and notify subscribers */
+void vBusWriteEnd(BusTopic_t *pxTopic);
+
+/* Publish a copy of pvMsg */
+void vBusPublish(BusTopic_t *pxTopic, const void *pvMsg);
+
+/* Copy of the newest message into pvMsg; its number, 0 (pvMsg untouched)
+ * if nothing has been published. Any task. */
+uint32_t ulBusLatest(const BusTopic_t *pxTopic, void *pvMsg);
+
+/* The subscriber's next message into pvMsg, oldest first. Returns 1, or 0
+ * with nothing new. Skips to the oldest message still in the ring if the
+ * subscriber fell depth behind, adding what it missed to ulLost. The
+ * subscriber's own task only. */
+int xBusRead(BusSubscriber_t *pxSub, void *pvMsg);
+
+/* Messages published and not read yet by the subscriber, lost ones included */
+static inline uint32_t ulBusPending(const BusSubscriber_t *pxSub) {
+    return pxSub->pxTopic->ulPublished + 1 - pxSub->ulNext;
+}
+
+#endif /* MSG_BUS_H */
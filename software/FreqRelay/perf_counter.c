@@ -0,0 +1,65 @@
+/**
+ * Section timing on the performance counter core
+ *
+ * See perf_counter.h.
+ */
+
+/* Standard includes */
+#include <string.h>
+
+/* Hardware includes */
+#include "sys/alt_irq.h"
+
+/* Application includes */
+#include "perf_counter.h"
+
+static const char * const pcNames[PERF_SECTIONS] = {
+    "FreqISR", "Analyzer", "Decision", "Actuator", "Render"
+};
+
+#if FREQ_PERF_COUNTER
+void vPerfInit(void) {
+    PERF_RESET(PERF_COUNTER_BASE);
+    PERF_START_MEASURING(PERF_COUNTER_BASE);
+}
+
+void vPerfRead(PerfReport_t *pxReport) {
+    alt_irq_context irq;
+    uint32_t i;
+
+    irq = alt_irq_disable_all();
+    PERF_STOP_MEASURING(PERF_COUNTER_BASE);
+    pxReport->total_cycles = perf_get_total_time((void *)PERF_COUNTER_BASE);
+    for (i = 0; i < PERF_SECTIONS; i++) {
+        pxReport->cycles[i] = perf_get_section_time((void *)PERF_COUNTER_BASE, i + 1);
+        pxReport->starts[i] = perf_get_num_starts((void *)PERF_COUNTER_BASE, i + 1);
+    }
+    PERF_START_MEASURING(PERF_COUNTER_BASE);
+    alt_irq_enable_all(irq);
+}
+
+void vPerfReset(void) {
+    alt_irq_context irq;
+
+    /* A section open now ends uncounted; its next run counts again */
+    irq = alt_irq_disable_all();
+    PERF_RESET(PERF_COUNTER_BASE);
+    PERF_START_MEASURING(PERF_COUNTER_BASE);
+    alt_irq_enable_all(irq);
+}
+
+#else
+void vPerfInit(void) {
+}
+
+void vPerfRead(PerfReport_t *pxReport) {
+    memset(pxReport, 0, sizeof(PerfReport_t));
+}
+
+void vPerfReset(void) {
+}
+#endif
+
+const char *pcPerfName(uint32_t section) {
+    return section >= 1 && section <= PERF_SECTIONS ? pcNames[section - 1] : "?";
+}
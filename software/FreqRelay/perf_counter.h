@@ -0,0 +1,76 @@
+/**
+ * Section timing on the performance counter core
+ *
+ * The altera_avalon_performance_counter core keeps a 64-bit cycle count
+ * and a start count per section in hardware. PERF_BEGIN and PERF_END are
+ * one store each to the core, so a section costs two bus writes and no
+ * timestamp read, no bookkeeping and no interrupt masking: what it shows
+ * is the code itself, to the cycle, without gprof's sampling error or the
+ * probes' own overhead (wcet.h). It keeps no maxima; use the timing build
+ * for worst cases and this one for where the cycles go.
+ *
+ * A perf counter build ("make perf", FREQ_PERF_COUNTER) times the
+ * frequency ISR, the analyzer pass, the load decision, the actuator pass
+ * and the VGA renderer. The core has to be added in Qsys as perf_counter,
+ * with at least PERF_SECTIONS sections and on the CPU's clock, so that
+ * system.h has PERF_COUNTER_BASE. The run stats task prints the sections
+ * with each report; W on the keyboard starts them over.
+ *
+ * A section's time is wall clock between its marks, anything that ran in
+ * between included, as with the probes: the frequency ISR lands in every
+ * task section, and the decision is inside the actuator. A section must
+ * not be entered again before it ends; the feeders share the ISR section,
+ * which is safe as handlers do not nest.
+ */
+
+#ifndef PERF_COUNTER_H
+#define PERF_COUNTER_H
+
+#include <stdint.h>
+#include "system.h"
+
+#ifndef FREQ_PERF_COUNTER
+#define FREQ_PERF_COUNTER              0
+#endif
+#if FREQ_PERF_COUNTER && !defined(PERF_COUNTER_BASE)
+#error "FREQ_PERF_COUNTER needs the performance counter core, PERF_COUNTER in system.h"
+#endif
+
+/* Sections, numbered from 1 as the core's (0 is its global count) */
+#define PERF_SECTION_ISR               1     // Frequency ISR, every feeder
+#define PERF_SECTION_ANALYZER          2     // vAnalyzerStep
+#define PERF_SECTION_DECISION          3     // vMakeLoadDecision
+#define PERF_SECTION_ACTUATOR          4     // vActuatorStep
+#define PERF_SECTION_RENDER            5     // Plot and page of one VGA frame
+#define PERF_SECTIONS                  5
+
+typedef struct {
+    uint64_t total_cycles;             // Since the counts started
+    uint64_t cycles[PERF_SECTIONS];    // Section n at index n - 1
+    uint32_t starts[PERF_SECTIONS];
+} PerfReport_t;
+
+#if FREQ_PERF_COUNTER
+#include "altera_avalon_performance_counter.h"
+
+#define PERF_SECTION_BEGIN(section)    PERF_BEGIN(PERF_COUNTER_BASE, section)
+#define PERF_SECTION_END(section)      PERF_END(PERF_COUNTER_BASE, section)
+#else
+#define PERF_SECTION_BEGIN(section)    ((void)0)
+#define PERF_SECTION_END(section)      ((void)0)
+#endif
+
+/* Clear the core and start counting */
+void vPerfInit(void);
+
+/* The counts so far. The core stops for the read, with interrupts masked,
+ * so the sections are read at one instant; a few cycles go uncounted. */
+void vPerfRead(PerfReport_t *pxReport);
+
+/* Start every count over, e.g. after the start-up transient */
+void vPerfReset(void);
+
+/* Name of section n, 1 to PERF_SECTIONS */
+const char *pcPerfName(uint32_t section);
+
+#endif /* PERF_COUNTER_H */
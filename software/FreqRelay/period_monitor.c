@@ -0,0 +1,329 @@
+/**
+ * Period, jitter and deadline monitor for the periodic tasks
+ *
+ * See period_monitor.h.
+ */
+
+/* Standard includes */
+#include <string.h>
+
+/* Scheduler includes */
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/* Application includes */
+#include "latency.h"
+#include "period_monitor.h"
+
+static PeriodMonitor_t *pxMonitors[PERIOD_MAX_MONITORS];
+static uint32_t ulMonitorCount = 0;
+static uint32_t ulSeenMisses[PERIOD_MAX_MONITORS];  // ulPeriodControlCheck() only
+
+void vPeriodInit(PeriodMonitor_t *pxMonitor, const char *pcName, uint32_t period_ms,
+                 uint32_t deadline_ms, uint8_t flags) {
+    memset(pxMonitor, 0, sizeof(PeriodMonitor_t));
+    pxMonitor->pcName = pcName;
+    pxMonitor->flags = flags;
+    pxMonitor->resync = 1;
+    pxMonitor->xPeriod = pdMS_TO_TICKS(period_ms);
+    pxMonitor->xBasePeriod = pxMonitor->xPeriod;
+    pxMonitor->base_us = period_ms * 1000UL;
+    pxMonitor->scale = 1;
+    pxMonitor->scale_req = 1;
+    pxMonitor->xDeadline = pdMS_TO_TICKS(deadline_ms != 0 ? deadline_ms : period_ms);
+    pxMonitor->period_us = period_ms * 1000UL;
+    pxMonitor->deadline_us = (deadline_ms != 0 ? deadline_ms : period_ms) * 1000UL;
+
+    if (ulMonitorCount < PERIOD_MAX_MONITORS) {
+        ulSeenMisses[ulMonitorCount] = 0;
+        pxMonitors[ulMonitorCount++] = pxMonitor;
+    }
+}
+
+void vPeriodOffset(PeriodMonitor_t *pxMonitor, uint32_t offset_ms) {
+    if (offset_ms == PERIOD_OFFSET_AUTO || pxMonitor->xPeriod == 0) {
+        pxMonitor->offset_set = 0;
+        return;
+    }
+    pxMonitor->xOffset = pdMS_TO_TICKS(offset_ms) % pxMonitor->xPeriod;
+    pxMonitor->offset_set = 1;
+}
+
+static TickType_t xPeriodGcd(TickType_t a, TickType_t b) {
+    TickType_t t;
+
+    while (b != 0) {
+        t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+/* How well offset o of a period suits against the placed monitors: the
+ * ticks to the nearest release of any of them, and the share of its own
+ * releases that fall on one of theirs (1 << 16 is every one). Two periods
+ * release together only on offsets equal modulo their gcd. */
+static void vPeriodScore(TickType_t xPeriod, TickType_t o, TickType_t *pxGap, uint32_t *pulShared) {
+    const PeriodMonitor_t *pxPlaced;
+    TickType_t g, d;
+    uint32_t i;
+
+    *pxGap = xPeriod;
+    *pulShared = 0;
+    for (i = 0; i < ulMonitorCount; i++) {
+        pxPlaced = pxMonitors[i];
+        if ((pxPlaced->flags & PERIOD_EVENT) || !pxPlaced->offset_set || pxPlaced->xPeriod == 0) {
+            continue;
+        }
+        g = xPeriodGcd(xPeriod, pxPlaced->xPeriod);
+        d = (o % g + g - pxPlaced->xOffset % g) % g;
+        if (g - d < d) {
+            d = g - d;
+        }
+        if (d < *pxGap) {
+            *pxGap = d;
+        }
+        if (d == 0) {
+            *pulShared += ((uint32_t)g << 16) / pxPlaced->xPeriod;
+        }
+    }
+}
+
+void vPeriodSpread(void) {
+    PeriodMonitor_t *pxMonitor;
+    TickType_t o, best, gap, best_gap;
+    uint32_t i, shared, best_shared;
+
+    for (i = 0; i < ulMonitorCount; i++) {
+        pxMonitor = pxMonitors[i];
+        if ((pxMonitor->flags & PERIOD_EVENT) || pxMonitor->offset_set || pxMonitor->xPeriod == 0) {
+            continue;
+        }
+        best = 0;
+        vPeriodScore(pxMonitor->xPeriod, 0, &best_gap, &best_shared);
+        for (o = 1; o < pxMonitor->xPeriod; o++) {
+            vPeriodScore(pxMonitor->xPeriod, o, &gap, &shared);
+            if (gap > best_gap || (gap == best_gap && shared < best_shared)) {
+                best = o;
+                best_gap = gap;
+                best_shared = shared;
+            }
+        }
+        pxMonitor->xOffset = best;
+        pxMonitor->offset_set = 1;
+    }
+}
+
+void vPeriodAlign(PeriodMonitor_t *pxMonitor) {
+    TickType_t xNow = xTaskGetTickCount();
+    TickType_t xPhase = (xNow % pxMonitor->xPeriod + pxMonitor->xPeriod - pxMonitor->xOffset) % pxMonitor->xPeriod;
+
+    pxMonitor->xNextRelease = xNow + pxMonitor->xPeriod - xPhase;
+    pxMonitor->resync = 1;
+}
+
+void vPeriodStart(PeriodMonitor_t *pxMonitor) {
+    TickType_t xNow = xTaskGetTickCount();
+    TickType_t xLate;
+    uint32_t now = ulLatencyNow();
+    uint32_t elapsed_us, jitter_us = 0, skipped = 0;
+    uint8_t late = 0;
+
+    if (pxMonitor->open) {
+        vPeriodEnd(pxMonitor);
+    }
+
+    if (pxMonitor->flags & PERIOD_EVENT) {
+        /* How long the task waited for its event or its timeout */
+        if (!pxMonitor->resync) {
+            jitter_us = ulLatencyElapsedUs(pxMonitor->last_end, now);
+            late = jitter_us > pxMonitor->period_us + 1000UL * portTICK_PERIOD_MS;
+        }
+        pxMonitor->xRelease = xNow;
+    } else if (pxMonitor->resync) {
+        pxMonitor->xRelease = xNow;
+        pxMonitor->xNextRelease = xNow + pxMonitor->xPeriod;
+    } else {
+        /* Releases an overrun has already passed are dropped, the job runs
+         * for the latest one */
+        pxMonitor->xRelease = pxMonitor->xNextRelease;
+        xLate = xNow - pxMonitor->xRelease;
+        if ((int32_t)xLate >= (int32_t)pxMonitor->xPeriod) {
+            skipped = xLate / pxMonitor->xPeriod;
+            pxMonitor->xRelease += skipped * pxMonitor->xPeriod;
+        }
+        pxMonitor->xNextRelease = pxMonitor->xRelease + pxMonitor->xPeriod;
+
+        if (skipped == 0) {
+            elapsed_us = ulLatencyElapsedUs(pxMonitor->start, now);
+            jitter_us = elapsed_us > pxMonitor->period_us ? elapsed_us - pxMonitor->period_us :
+                                                             pxMonitor->period_us - elapsed_us;
+        }
+    }
+
+    vSeqWriteBegin(&pxMonitor->lock);
+    if (jitter_us > pxMonitor->jitter_max_us) {
+        pxMonitor->jitter_max_us = jitter_us;
+    }
+    pxMonitor->skipped += skipped;
+    vSeqWriteEnd(&pxMonitor->lock);
+
+    pxMonitor->resync = 0;
+    pxMonitor->open = 1;
+    pxMonitor->late = late;
+    pxMonitor->start = now;
+}
+
+void vPeriodEnd(PeriodMonitor_t *pxMonitor) {
+    uint32_t now = ulLatencyNow();
+    uint32_t exec_us;
+    int missed;
+
+    if (!pxMonitor->open) {
+        return;
+    }
+    exec_us = ulLatencyElapsedUs(pxMonitor->start, now);
+    if (pxMonitor->flags & PERIOD_EVENT) {
+        missed = pxMonitor->late || exec_us > pxMonitor->deadline_us;
+    } else {
+        missed = (int32_t)(xTaskGetTickCount() - pxMonitor->xRelease) >= (int32_t)pxMonitor->xDeadline;
+    }
+    pxMonitor->open = 0;
+    pxMonitor->last_end = now;
+
+    vSeqWriteBegin(&pxMonitor->lock);
+    pxMonitor->jobs++;
+    pxMonitor->exec_last_us = exec_us;
+    if (exec_us > pxMonitor->exec_max_us) {
+        pxMonitor->exec_max_us = exec_us;
+    }
+    if (missed) {
+        pxMonitor->misses++;
+        pxMonitor->run++;
+    } else {
+        pxMonitor->run = 0;
+    }
+    vSeqWriteEnd(&pxMonitor->lock);
+}
+
+void vPeriodScale(PeriodMonitor_t *pxMonitor, uint8_t scale) {
+    pxMonitor->scale_req = scale;
+}
+
+/* The task's own side of vPeriodScale(), between jobs. A new period
+ * starts afresh, the change is not counted as jitter. Returns non-zero if
+ * the scale changed. */
+static int xPeriodTakeScale(PeriodMonitor_t *pxMonitor) {
+    uint8_t scale = pxMonitor->scale_req;
+
+    if (scale == pxMonitor->scale) {
+        return 0;
+    }
+    pxMonitor->scale = scale;
+    if (scale != 0) {
+        pxMonitor->xPeriod = pxMonitor->xBasePeriod * scale;
+        pxMonitor->period_us = pxMonitor->base_us * scale;
+    }
+    pxMonitor->resync = 1;
+    return 1;
+}
+
+void vPeriodWait(PeriodMonitor_t *pxMonitor) {
+    TickType_t xLastWake;
+
+    vPeriodEnd(pxMonitor);
+    (void)xPeriodTakeScale(pxMonitor);
+    while (pxMonitor->scale == 0) {
+        vTaskDelay(pxMonitor->xBasePeriod);
+        (void)xPeriodTakeScale(pxMonitor);
+    }
+    if (pxMonitor->resync) {
+        vPeriodAlign(pxMonitor);
+    }
+
+    /* Returns at once if the release has passed, vPeriodStart() sorts out
+     * which release the job is for */
+    xLastWake = pxMonitor->xNextRelease - pxMonitor->xPeriod;
+    vTaskDelayUntil(&xLastWake, pxMonitor->xPeriod);
+    vPeriodStart(pxMonitor);
+}
+
+TickType_t xPeriodTicksToRelease(const PeriodMonitor_t *pxMonitor) {
+    TickType_t xWait = pxMonitor->xNextRelease - xTaskGetTickCount();
+
+    return (int32_t)xWait > 0 ? xWait : 0;
+}
+
+int xPeriodReleaseDue(PeriodMonitor_t *pxMonitor) {
+    if (xPeriodTicksToRelease(pxMonitor) != 0) {
+        return 0;
+    }
+    vPeriodEnd(pxMonitor);
+    if (xPeriodTakeScale(pxMonitor) || pxMonitor->scale == 0) {
+        /* The first release of the new period, or a period from now to
+         * ask again while parked */
+        if (pxMonitor->scale != 0) {
+            vPeriodAlign(pxMonitor);
+        } else {
+            pxMonitor->xNextRelease = xTaskGetTickCount() + pxMonitor->xBasePeriod;
+        }
+        return 0;
+    }
+    vPeriodStart(pxMonitor);
+    return 1;
+}
+
+void vPeriodResyncAll(void) {
+    uint32_t i;
+
+    for (i = 0; i < ulMonitorCount; i++) {
+        pxMonitors[i]->resync = 1;
+    }
+}
+
+uint32_t ulPeriodControlCheck(uint32_t *pulRun) {
+    uint32_t i, misses, run, missed = 0, longest = 0;
+
+    for (i = 0; i < ulMonitorCount; i++) {
+        if (!(pxMonitors[i]->flags & PERIOD_CONTROL)) {
+            continue;
+        }
+        /* Single words, no snapshot needed */
+        misses = pxMonitors[i]->misses;
+        run = pxMonitors[i]->run;
+        if (misses != ulSeenMisses[i]) {
+            ulSeenMisses[i] = misses;
+            missed |= 1UL << i;
+        }
+        if (run > longest) {
+            longest = run;
+        }
+    }
+    *pulRun = longest;
+    return missed;
+}
+
+uint32_t ulPeriodCount(void) {
+    return ulMonitorCount;
+}
+
+void vPeriodGetStats(uint32_t index, PeriodStats_t *pxStats) {
+    const PeriodMonitor_t *pxMonitor = pxMonitors[index];
+    uint32_t seq;
+
+    pxStats->pcName = pxMonitor->pcName;
+    pxStats->flags = pxMonitor->flags;
+    pxStats->period_us = pxMonitor->period_us;
+    pxStats->offset_ms = pxMonitor->xOffset * portTICK_PERIOD_MS;
+    do {
+        seq = ulSeqReadBegin(&pxMonitor->lock);
+        pxStats->jobs = pxMonitor->jobs;
+        pxStats->misses = pxMonitor->misses;
+        pxStats->skipped = pxMonitor->skipped;
+        pxStats->run = pxMonitor->run;
+        pxStats->jitter_max_us = pxMonitor->jitter_max_us;
+        pxStats->exec_last_us = pxMonitor->exec_last_us;
+        pxStats->exec_max_us = pxMonitor->exec_max_us;
+    } while (xSeqReadRetry(&pxMonitor->lock, seq));
+}
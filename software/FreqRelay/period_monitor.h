@@ -0,0 +1,152 @@
+/**
+ * Period, jitter and deadline monitor for the periodic tasks
+ *
+ * vTaskDelayUntil() in this kernel returns at once when the wake time has
+ * already passed, so a task that overruns just runs its next period late
+ * and nothing notices. Each monitored task brackets its work with a
+ * PeriodMonitor_t instead:
+ *
+ *   PERIOD_TIME   released by the tick every period. vPeriodWait() replaces
+ *                 vTaskDelayUntil(): it closes the job, counts a miss if it
+ *                 ended after its release plus the deadline, skips the
+ *                 releases an overrun has already passed (rather than
+ *                 running them back to back) and opens the next job.
+ *                 Jitter is how far one job start is from a period after
+ *                 the last, in either direction.
+ *   PERIOD_EVENT  released by a notification, with the period as the wait
+ *                 timeout. vPeriodStart()/vPeriodEnd() bracket each job; a
+ *                 miss is a job that ran longer than the deadline, or a wait
+ *                 that lasted longer than the timeout plus a tick (the task
+ *                 was ready and did not get the CPU). The longest wait is
+ *                 kept in place of the jitter.
+ *
+ * PERIOD_TIME releases fall on ticks a whole number of periods after the
+ * monitor's offset, not after the moment the task first waited, so tasks
+ * started together do not all release in the same tick at every common
+ * multiple of their periods. An offset is set with vPeriodOffset(), or
+ * left to vPeriodSpread(): highest priority first (registration order),
+ * each monitor takes the offset within its period furthest from the
+ * releases already placed, then the one that shares the fewest of them.
+ * Event monitors have no offset. The response time bound (rta.h) still
+ * assumes the synchronous release, so it stays safe either way.
+ *
+ * Another task may slow a PERIOD_TIME task down with vPeriodScale(): the
+ * task itself takes the new multiple of its period at its next release, so
+ * the change never lands in the middle of a job, and with 0 it sleeps a
+ * period at a time from there until it is scaled back up, holding nothing.
+ *
+ * Times are timestamp counts (ulLatencyNow), release and deadline checks
+ * are in ticks. Each monitor is written only by its task and read under a
+ * sequence lock. Monitors flagged PERIOD_CONTROL feed
+ * ulPeriodControlCheck(), which the system monitor uses to escalate.
+ */
+
+#ifndef PERIOD_MONITOR_H
+#define PERIOD_MONITOR_H
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "seqlock.h"
+
+#define PERIOD_MAX_MONITORS            12
+
+/* Monitor flags */
+#define PERIOD_TIME                    0x00  // Released by the tick, uses vPeriodWait()
+#define PERIOD_EVENT                   0x01  // Released by an event, period is the longest wait
+#define PERIOD_CONTROL                 0x02  // Misses count towards ulPeriodControlCheck()
+
+#define PERIOD_OFFSET_AUTO             0xFFFFFFFFUL  // vPeriodOffset(): let vPeriodSpread() choose
+
+typedef struct {
+    const char *pcName;
+    uint8_t flags;                     // PERIOD_*
+    uint8_t open;                      // A job is in progress
+    uint8_t late;                      // PERIOD_EVENT: the job started after an overlong wait
+    uint8_t resync;                    // Next start begins a new period, see vPeriodResyncAll()
+    TickType_t xPeriod;                // Ticks
+    TickType_t xDeadline;              // Ticks after the release (or the start of an event job)
+    TickType_t xRelease;               // Release of the job in progress
+    TickType_t xNextRelease;           // PERIOD_TIME only
+    TickType_t xOffset;                // PERIOD_TIME: releases at xOffset + n * xPeriod
+    uint8_t offset_set;                // xOffset given or already spread
+    uint8_t scale;                     // Multiple of the base period in force, 0 parked
+    volatile uint8_t scale_req;        // vPeriodScale(), taken at the next release
+    TickType_t xBasePeriod;            // As initialised, xPeriod is scale times it
+    uint32_t base_us;
+    uint32_t period_us;
+    uint32_t deadline_us;
+    uint32_t start;                    // Timestamp count at the job start
+    uint32_t last_end;
+    SeqLock_t lock;                    // Guards everything below
+    uint32_t jobs;                     // Jobs completed
+    uint32_t misses;                   // Deadline misses
+    uint32_t skipped;                  // PERIOD_TIME releases dropped after an overrun
+    uint32_t run;                      // Consecutive misses, 0 after a job on time
+    uint32_t jitter_max_us;            // PERIOD_TIME: start jitter; PERIOD_EVENT: longest wait
+    uint32_t exec_last_us;
+    uint32_t exec_max_us;
+} PeriodMonitor_t;
+
+/* Copy for readers */
+typedef struct {
+    const char *pcName;
+    uint8_t flags;
+    uint32_t period_us;
+    uint32_t offset_ms;                // PERIOD_TIME release phase
+    uint32_t jobs;
+    uint32_t misses;
+    uint32_t skipped;
+    uint32_t run;
+    uint32_t jitter_max_us;
+    uint32_t exec_last_us;
+    uint32_t exec_max_us;
+} PeriodStats_t;
+
+/* Set up and register a monitor, before the scheduler starts. A deadline of
+ * 0 means the period. The first job starts with the first vPeriodWait() or
+ * vPeriodStart(). */
+void vPeriodInit(PeriodMonitor_t *pxMonitor, const char *pcName, uint32_t period_ms,
+                 uint32_t deadline_ms, uint8_t flags);
+
+/* PERIOD_TIME: release phase in ms, less than the period, or
+ * PERIOD_OFFSET_AUTO (the default). Before vPeriodSpread(). */
+void vPeriodOffset(PeriodMonitor_t *pxMonitor, uint32_t offset_ms);
+
+/* Give every PERIOD_TIME monitor left at PERIOD_OFFSET_AUTO its offset,
+ * around those already set. Once, after the last vPeriodInit(). */
+void vPeriodSpread(void);
+
+/* PERIOD_TIME: first release at the next tick of its phase, for a task
+ * that does not start with vPeriodWait() */
+void vPeriodAlign(PeriodMonitor_t *pxMonitor);
+
+/* PERIOD_TIME: end the job, sleep until the next release and start it */
+void vPeriodWait(PeriodMonitor_t *pxMonitor);
+
+/* PERIOD_TIME, from any task: run at scale times the period from the next
+ * release, 1 to restore it, 0 to park the task there */
+void vPeriodScale(PeriodMonitor_t *pxMonitor, uint8_t scale);
+
+/* PERIOD_TIME tasks that wait on something else as well: ticks until the
+ * next release, 0 if it is due, and whether it is (starting the job if so) */
+TickType_t xPeriodTicksToRelease(const PeriodMonitor_t *pxMonitor);
+int xPeriodReleaseDue(PeriodMonitor_t *pxMonitor);
+
+/* Bracket one job */
+void vPeriodStart(PeriodMonitor_t *pxMonitor);
+void vPeriodEnd(PeriodMonitor_t *pxMonitor);
+
+/* After every task was stopped (the benchmarks): the next start of each
+ * monitor begins a new period without counting the gap */
+void vPeriodResyncAll(void);
+
+/* PERIOD_CONTROL monitors that missed a deadline since the last call, one
+ * bit each in registration order, and the longest current run of
+ * consecutive misses among them through *pulRun. One caller only. */
+uint32_t ulPeriodControlCheck(uint32_t *pulRun);
+
+/* Registered monitors, for the statistics report */
+uint32_t ulPeriodCount(void);
+void vPeriodGetStats(uint32_t index, PeriodStats_t *pxStats);
+
+#endif /* PERIOD_MONITOR_H */
@@ -0,0 +1,79 @@
+/**
+ * Fixed-size object pools
+ *
+ * See pool.h.
+ */
+
+/* Hardware includes */
+#include "sys/alt_irq.h"
+
+/* Application includes */
+#include "freertos/FreeRTOS.h"
+#include "pool.h"
+
+void vPoolInit(Pool_t *pxPool, void *pvStorage, size_t slot_size, uint16_t count) {
+    uint8_t *slot = (uint8_t *)pvStorage;
+    uint16_t i;
+
+    /* Link every slot to the next, the last one ends the list */
+    for (i = 0; i < count; i++) {
+        *(void **)slot = (i + 1 < count) ? (void *)(slot + slot_size) : NULL;
+        slot += slot_size;
+    }
+
+    pxPool->pvFree = count ? pvStorage : NULL;
+    pxPool->pucStart = (uint8_t *)pvStorage;
+    pxPool->pucEnd = slot;
+    pxPool->usSlotSize = (uint16_t)slot_size;
+    pxPool->usCount = count;
+    pxPool->usFree = count;
+    pxPool->usMinFree = count;
+    pxPool->ulFailures = 0;
+}
+
+void *pvPoolAlloc(Pool_t *pxPool) {
+    alt_irq_context context;
+    void *slot;
+
+    context = alt_irq_disable_all();
+    slot = pxPool->pvFree;
+    if (slot != NULL) {
+        pxPool->pvFree = *(void **)slot;
+        if (--pxPool->usFree < pxPool->usMinFree) {
+            pxPool->usMinFree = pxPool->usFree;
+        }
+    } else {
+        pxPool->ulFailures++;
+    }
+    alt_irq_enable_all(context);
+
+    return slot;
+}
+
+void *pvPoolSwap(void *volatile *ppvMailbox, void *pvNew) {
+    alt_irq_context context;
+    void *old;
+
+    context = alt_irq_disable_all();
+    old = *ppvMailbox;
+    *ppvMailbox = pvNew;
+    alt_irq_enable_all(context);
+
+    return old;
+}
+
+void vPoolFree(Pool_t *pxPool, void *pvSlot) {
+    alt_irq_context context;
+
+    if (pvSlot == NULL) {
+        return;
+    }
+    configASSERT((uint8_t *)pvSlot >= pxPool->pucStart && (uint8_t *)pvSlot < pxPool->pucEnd &&
+                 ((uint8_t *)pvSlot - pxPool->pucStart) % pxPool->usSlotSize == 0);
+
+    context = alt_irq_disable_all();
+    *(void **)pvSlot = pxPool->pvFree;
+    pxPool->pvFree = pvSlot;
+    pxPool->usFree++;
+    alt_irq_enable_all(context);
+}
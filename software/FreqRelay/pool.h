@@ -0,0 +1,68 @@
+/**
+ * Fixed-size object pools
+ *
+ * Each pool is a free list threaded through a statically sized array of one
+ * object type, so records can be handed between ISRs and tasks by pointer
+ * without touching the heap or copying them. Allocation and release are a
+ * pointer swap, O(1), and may be called from tasks and ISRs alike.
+ *
+ * The Nios II has no atomic read-modify-write instruction, so the swap runs
+ * with interrupts masked for a handful of instructions rather than being
+ * truly lock free; nothing ever waits on a pool and no kernel call is made.
+ *
+ * Storage is declared with POOL_STORAGE() so every slot can also hold the
+ * free list link, then bound with vPoolInit:
+ *
+ *     POOL_STORAGE(xRecordSlots, Record_t, 16);
+ *     static Pool_t xRecordPool;
+ *     vPoolInit(&xRecordPool, xRecordSlots, sizeof(xRecordSlots[0]), 16);
+ *
+ * Ownership of a slot is handed on through a one-word mailbox with
+ * pvPoolSwap: the producer swaps its filled slot in and frees whatever
+ * unconsumed slot it got back, the consumer swaps NULL in to take the
+ * newest one.
+ */
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Array of count slots, each large enough for one type or a free list link */
+#define POOL_STORAGE(name, type, count) \
+    static union { type obj; void *link; } name[count]
+
+typedef struct {
+    void *volatile pvFree;             // Head of the free list
+    uint8_t *pucStart;                 // Storage bounds, for vPoolFree checks
+    uint8_t *pucEnd;
+    uint16_t usSlotSize;
+    uint16_t usCount;
+    volatile uint16_t usFree;          // Slots currently free
+    volatile uint16_t usMinFree;       // Low-water mark of usFree
+    volatile uint32_t ulFailures;      // pvPoolAlloc calls that found the pool empty
+} Pool_t;
+
+/* Bind a pool to its storage, all slots free. Call before first use. */
+void vPoolInit(Pool_t *pxPool, void *pvStorage, size_t slot_size, uint16_t count);
+
+/* A free slot, or NULL if the pool is empty. Task or ISR. */
+void *pvPoolAlloc(Pool_t *pxPool);
+
+/* Return a slot taken from this pool. Task or ISR. */
+void vPoolFree(Pool_t *pxPool, void *pvSlot);
+
+/* Store pvNew in a pointer mailbox and return what it held. Task or ISR. */
+void *pvPoolSwap(void *volatile *ppvMailbox, void *pvNew);
+
+/* Slots free now, and the most ever in use at once */
+static inline uint16_t usPoolFree(const Pool_t *pxPool) {
+    return pxPool->usFree;
+}
+
+static inline uint16_t usPoolHighWater(const Pool_t *pxPool) {
+    return pxPool->usCount - pxPool->usMinFree;
+}
+
+#endif /* POOL_H */
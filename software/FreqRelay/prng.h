@@ -0,0 +1,45 @@
+/**
+ * Seedable pseudo-random streams for test builds
+ *
+ * xorshift32 (Marsaglia): three shifts and three exclusive ors per number,
+ * period 2^32 - 1, no multiply or divide. Plenty for noise and fault
+ * injection, not for anything that must be unpredictable.
+ *
+ * Each user owns its Prng_t, so a stream needs no locking and is not
+ * disturbed by anyone else drawing numbers, unlike newlib's rand(). The
+ * same seed gives the same sequence on the target and in the host replay,
+ * so a run can be repeated exactly.
+ */
+
+#ifndef PRNG_H
+#define PRNG_H
+
+#include <stdint.h>
+
+#define PRNG_DEFAULT_SEED              1u     // Stands in for 0, which xorshift never leaves
+
+typedef struct {
+    uint32_t state;                    // Never 0
+} Prng_t;
+
+static inline void vPrngSeed(Prng_t *pxPrng, uint32_t seed) {
+    pxPrng->state = seed != 0 ? seed : PRNG_DEFAULT_SEED;
+}
+
+static inline uint32_t ulPrngNext(Prng_t *pxPrng) {
+    uint32_t x = pxPrng->state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    pxPrng->state = x;
+    return x;
+}
+
+/* Uniform in [0, n) for n up to 65536, from the top half of the next
+ * number by a 32-bit multiply and shift, rather than a modulo */
+static inline uint32_t ulPrngBelow(Prng_t *pxPrng, uint32_t n) {
+    return ((ulPrngNext(pxPrng) >> 16) * n) >> 16;
+}
+
+#endif /* PRNG_H */
@@ -0,0 +1,164 @@
+/**
+ * gprof PC sampling under FreeRTOS
+ *
+ * See profile.h.
+ */
+
+/* Standard includes */
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Scheduler includes */
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/* Hardware includes */
+#include "priv/nios2_gmon_data.h"
+
+/* Application includes */
+#include "profile.h"
+#include "telemetry.h"
+
+/* Kept out of the call graph: the sampler runs in the tick interrupt */
+#define PROFILE_NO_INSTRUMENT          __attribute__((no_instrument_function))
+
+/* Layout of the call graph records alt_gmon.c builds for mcount */
+typedef struct ProfileArc {
+    struct ProfileArc *next;
+    void *from_pc;
+    unsigned int count;
+} ProfileArc_t;
+
+typedef struct ProfileFunction {
+    struct ProfileFunction *next;
+    void *self_pc;
+    ProfileArc_t *arc_head;
+} ProfileFunction_t;
+
+typedef struct {
+    void *pvTask;                      // TCB the samples belong to
+    uint32_t samples;
+    uint32_t *pulBuckets;
+} ProfileTask_t;
+
+/* From the linker script, as in alt_gmon.c */
+extern char stext[];
+extern char etext[];
+
+/* Written by the tick interrupt only, slots are claimed in order */
+static ProfileTask_t xTasks[PROFILE_MAX_TASKS];
+static volatile uint32_t ulTaskCount = 0;
+static uint32_t ulBuckets = 0;
+static uint32_t ulOutside = 0;
+static uint32_t ulLost = 0;
+static volatile int xPaused = 0;
+
+/* Names for the dump */
+static TaskStatus_t xStatus[PROFILE_MAX_TASKS];
+
+int xProfileInit(void) {
+    uint32_t *pulBuckets;
+    int i;
+
+    /* Never freed, so straight from the HAL heap in SDRAM like the call graph */
+    ulBuckets = ((uint32_t)etext - (uint32_t)stext + PROFILE_BUCKET_BYTES - 1) / PROFILE_BUCKET_BYTES;
+    pulBuckets = (uint32_t *)sbrk(PROFILE_MAX_TASKS * ulBuckets * sizeof(uint32_t));
+    if (pulBuckets == (uint32_t *)-1) {
+        ulBuckets = 0;
+        return -1;
+    }
+    memset(pulBuckets, 0, PROFILE_MAX_TASKS * ulBuckets * sizeof(uint32_t));
+
+    for (i = 0; i < PROFILE_MAX_TASKS; i++) {
+        xTasks[i].pvTask = NULL;
+        xTasks[i].samples = 0;
+        xTasks[i].pulBuckets = pulBuckets + i * ulBuckets;
+    }
+    return 0;
+}
+
+PROFILE_NO_INSTRUMENT void vProfileTickSample(uint32_t ulPc, void *pvTask) {
+    ProfileTask_t *pxTask;
+    uint32_t i, n = ulTaskCount;
+
+    if (ulBuckets == 0 || xPaused) {
+        return;
+    }
+
+    for (i = 0; i < n && xTasks[i].pvTask != pvTask; i++) {
+    }
+    if (i == n) {
+        if (n == PROFILE_MAX_TASKS) {
+            ulLost++;
+            return;
+        }
+        xTasks[n].pvTask = pvTask;
+        ulTaskCount = n + 1;
+    }
+
+    pxTask = &xTasks[i];
+    pxTask->samples++;
+    if (ulPc >= (uint32_t)stext && ulPc < (uint32_t)etext) {
+        pxTask->pulBuckets[(ulPc - (uint32_t)stext) / PROFILE_BUCKET_BYTES]++;
+    } else {
+        ulOutside++;
+    }
+}
+
+static PROFILE_NO_INSTRUMENT const char *pcTaskName(void *pvTask, UBaseType_t count) {
+    UBaseType_t i;
+
+    for (i = 0; i < count; i++) {
+        if ((void *)xStatus[i].xHandle == pvTask) {
+            return xStatus[i].pcTaskName;
+        }
+    }
+    return "?";
+}
+
+PROFILE_NO_INSTRUMENT void vProfileDump(void) {
+    ProfileFunction_t **ppxHead;
+    ProfileFunction_t *pxFunction;
+    ProfileArc_t *pxArc;
+    UBaseType_t count;
+    uint32_t i, j;
+
+    if (ulBuckets == 0) {
+        return;
+    }
+
+    xTelemetryUartTake(portMAX_DELAY);
+    xPaused = 1;
+    count = uxTaskGetSystemState(xStatus, PROFILE_MAX_TASKS, NULL);
+
+    printf("#GMON,%d,%08lx,%08lx,%d,%d\n", PROFILE_VERSION, (unsigned long)stext, (unsigned long)etext,
+           PROFILE_BUCKET_BYTES, (int)configTICK_RATE_HZ);
+    for (i = 0; i < ulTaskCount; i++) {
+        printf("T,%lu,%s,%lu\n", (unsigned long)i, pcTaskName(xTasks[i].pvTask, count),
+               (unsigned long)xTasks[i].samples);
+        for (j = 0; j < ulBuckets; j++) {
+            if (xTasks[i].pulBuckets[j]) {
+                printf("H,%lu,%lx,%lu\n", (unsigned long)i, (unsigned long)j,
+                       (unsigned long)xTasks[i].pulBuckets[j]);
+            }
+        }
+    }
+
+    /* mcount only ever adds at the head of a list, so walking them while
+     * it runs is safe */
+    for (ppxHead = (ProfileFunction_t **)alt_gmon_data[GMON_DATA_MCOUNT_START];
+         ppxHead < (ProfileFunction_t **)alt_gmon_data[GMON_DATA_MCOUNT_LIMIT]; ppxHead++) {
+        for (pxFunction = *ppxHead; pxFunction != NULL; pxFunction = pxFunction->next) {
+            for (pxArc = pxFunction->arc_head; pxArc != NULL; pxArc = pxArc->next) {
+                printf("A,%08lx,%08lx,%u\n", (unsigned long)pxArc->from_pc,
+                       (unsigned long)pxFunction->self_pc, pxArc->count);
+            }
+        }
+    }
+    printf("#GMON,end,%lu\n", (unsigned long)(ulOutside + ulLost));
+    fflush(stdout);
+
+    xPaused = 0;
+    vTelemetryUartGive();
+}
@@ -0,0 +1,47 @@
+/**
+ * gprof PC sampling under FreeRTOS
+ *
+ * The HAL's gprof support (alt_gmon.c) records the call graph from mcount
+ * and samples the PC from a HAL alarm. The alarm never fires here: the
+ * FreeRTOS port takes the system clock timer over from the HAL tick. In a
+ * profiling build ("make profile", FREQ_RELAY_PROFILE) the port's tick
+ * handler passes the PC it interrupted, and the task it interrupted, to
+ * vProfileTickSample() instead. The tick runs at the lowest interrupt
+ * priority, so every sample lands in a task; time in interrupt handlers is
+ * not sampled (the per-IRQ timing in irq_defer.h covers it). Tickless idle
+ * is off in these builds so the idle task is sampled like the others.
+ *
+ * Each task gets its own histogram of the text section in gprof's bucket
+ * size. vProfileDump() writes them and the HAL's call graph arcs on the
+ * JTAG UART as text:
+ *
+ *   #GMON,<version>,<low pc>,<high pc>,<bucket bytes>,<samples per s>
+ *   T,<slot>,<task>,<samples>
+ *   H,<slot>,<bucket>,<count>          non-zero buckets only
+ *   A,<from pc>,<self pc>,<count>
+ *   #GMON,end,<samples in no histogram>
+ *
+ * Addresses and buckets are hex. tools/gmon_capture.py turns a capture into
+ * gmon.out for nios2-elf-gprof, for all tasks and for each one.
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+
+#define PROFILE_VERSION                1
+#define PROFILE_BUCKET_BYTES           32    // As PCSAMPLE_BYTES_PER_BUCKET in alt_gmon.c
+#define PROFILE_MAX_TASKS              16    // Later tasks are counted as lost
+
+/* Allocate the histograms. Call before the scheduler starts. Returns 0 if
+ * sampling is on. */
+int xProfileInit(void);
+
+/* From the tick interrupt only, see FreeRTOSConfig.h */
+void vProfileTickSample(uint32_t ulPc, void *pvTask);
+
+/* Write the profile so far on the JTAG UART. Sampling pauses meanwhile. */
+void vProfileDump(void);
+
+#endif /* PROFILE_H */
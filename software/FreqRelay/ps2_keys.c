@@ -0,0 +1,205 @@
+/**
+ * Interrupt-driven PS/2 keyboard and mouse input
+ *
+ * See ps2_keys.h.
+ */
+
+/* Hardware includes */
+#include "system.h"
+#include "altera_up_avalon_ps2.h"
+#include "altera_up_avalon_ps2_regs.h"
+
+/* Application includes */
+#include "fast_mem.h"
+#include "irq_defer.h"
+#include "ps2_keys.h"
+
+#define PS2_PREFIX_EXTENDED            0xE0
+#define PS2_PREFIX_PAUSE               0xE1
+#define PS2_PREFIX_BREAK               0xF0
+#define PS2_MAX_MAKE_CODE              0x83  // Anything above is a reply or error
+#define PS2_PAUSE_TAIL                 7     // Bytes after E1 in the Pause sequence
+
+/* Mouse commands and packet bits */
+#define PS2_MOUSE_ENABLE               0xF4  // Start streaming packets
+#define PS2_MOUSE_DISABLE              0xF5
+#define PS2_MOUSE_SET_RATE             0xF3
+#define PS2_MOUSE_GET_ID               0xF2
+#define PS2_MOUSE_ID_WHEEL             0x03  // IntelliMouse, 4 byte packets
+#define PS2_MOUSE_SYNC                 0x08  // Always set in the first byte
+#define PS2_MOUSE_X_SIGN               0x10
+#define PS2_MOUSE_Y_SIGN               0x20
+#define PS2_MOUSE_OVERFLOW             0xC0
+#define PS2_MOUSE_BUTTONS              0x07
+
+/* Same scheme as the frequency sample ring: free-running indices, the ISR
+ * only writes head and the consumer only writes tail. */
+typedef struct {
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    volatile uint32_t dropped;
+    volatile uint8_t data[PS2_RING_SIZE];
+} Ps2Ring_t;
+
+static FAST_DATA Ps2Ring_t xRing;
+static FAST_DATA TaskHandle_t xConsumerTask = NULL;
+
+/* Decoder state, consumer task only */
+static uint8_t ucExtended = 0;
+static uint8_t ucBreak = 0;
+static uint8_t ucSkip = 0;
+static uint8_t ucPacket[4];
+static uint8_t ucPacketLen = 0;
+
+/* Set at init: 0 for a keyboard, else the mouse packet length */
+static uint8_t ucPacketSize = 0;
+
+static void vPs2ISRHandler(void *context) {
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    uint32_t head = xRing.head;
+    uint32_t data;
+
+    /* Each read pops the FIFO; the interrupt drops once it is empty */
+    data = IORD_ALT_UP_PS2_PORT_DATA_REG(PS2_BASE);
+    while (data & ALT_UP_PS2_PORT_DATA_REG_RVALID_MSK) {
+        if ((head - xRing.tail) >= PS2_RING_SIZE) {
+            xRing.dropped++;
+        } else {
+            xRing.data[head & PS2_RING_MASK] = (uint8_t)(data & ALT_UP_PS2_PORT_DATA_REG_DATA_MSK);
+            head++;
+        }
+        data = IORD_ALT_UP_PS2_PORT_DATA_REG(PS2_BASE);
+    }
+
+    if (head != xRing.head) {
+        xRing.head = head;
+        if (xConsumerTask != NULL) {
+            vTaskNotifyGiveFromISR(xConsumerTask, &xHigherPriorityTaskWoken);
+        }
+    }
+
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
+/* The IntelliMouse knock: sample rates 200, 100, 80 and the mouse reports
+ * ID 3 from then on if it has a wheel. Reporting is stopped meanwhile so
+ * no packet is mistaken for a reply. Returns the packet length. */
+static uint8_t ucPs2MouseSetup(alt_up_ps2_dev *pxDev) {
+    static const uint8_t ucKnock[] = { 200, 100, 80 };
+    unsigned char id = 0;
+    uint8_t size = 3;
+    int i, status;
+
+    status = alt_up_ps2_write_data_byte_with_ack(pxDev, PS2_MOUSE_DISABLE);
+    for (i = 0; i < (int)sizeof(ucKnock) && status == 0; i++) {
+        status = alt_up_ps2_write_data_byte_with_ack(pxDev, PS2_MOUSE_SET_RATE);
+        if (status == 0) {
+            status = alt_up_ps2_write_data_byte_with_ack(pxDev, ucKnock[i]);
+        }
+    }
+    if (status == 0 && alt_up_ps2_write_data_byte_with_ack(pxDev, PS2_MOUSE_GET_ID) == 0 &&
+        alt_up_ps2_read_data_byte_timeout(pxDev, &id) == 0 && id == PS2_MOUSE_ID_WHEEL) {
+        size = 4;
+    }
+
+    (void)alt_up_ps2_write_data_byte_with_ack(pxDev, PS2_MOUSE_ENABLE);
+    return size;
+}
+
+int xPs2KeysInit(TaskHandle_t xConsumer) {
+    alt_up_ps2_dev *pxDev = alt_up_ps2_open_dev(PS2_NAME);
+
+    if (pxDev == NULL) {
+        return -1;
+    }
+
+    xRing.head = 0;
+    xRing.tail = 0;
+    xRing.dropped = 0;
+    xConsumerTask = xConsumer;
+    ucPacketLen = 0;
+    ucPacketSize = pxDev->device_type == PS2_MOUSE ? ucPs2MouseSetup(pxDev) : 0;
+
+    /* Start from a clean byte boundary */
+    alt_up_ps2_clear_fifo(pxDev);
+    xIrqRegister(PS2_IRQ, vPs2ISRHandler, NULL);
+    alt_up_ps2_enable_read_interrupt(pxDev);
+    return 0;
+}
+
+int xPs2KeysGet(Ps2Key_t *pxKey) {
+    uint32_t tail = xRing.tail;
+    uint8_t byte;
+
+    while (tail != xRing.head) {
+        byte = xRing.data[tail & PS2_RING_MASK];
+        xRing.tail = ++tail;
+
+        if (ucSkip) {
+            ucSkip--;
+        } else if (byte == PS2_PREFIX_EXTENDED) {
+            ucExtended = 1;
+        } else if (byte == PS2_PREFIX_BREAK) {
+            ucBreak = 1;
+        } else if (byte == PS2_PREFIX_PAUSE) {
+            ucSkip = PS2_PAUSE_TAIL;
+            ucExtended = 0;
+            ucBreak = 0;
+        } else if (byte == 0 || byte > PS2_MAX_MAKE_CODE) {
+            /* ACK, self-test result or overrun - not a key */
+            ucExtended = 0;
+            ucBreak = 0;
+        } else {
+            pxKey->code = byte;
+            pxKey->extended = ucExtended;
+            pxKey->released = ucBreak;
+            ucExtended = 0;
+            ucBreak = 0;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int xPs2IsMouse(void) {
+    return ucPacketSize != 0;
+}
+
+int xPs2MouseGet(Ps2Mouse_t *pxMove) {
+    uint32_t tail = xRing.tail;
+    uint8_t byte, flags;
+
+    while (tail != xRing.head) {
+        byte = xRing.data[tail & PS2_RING_MASK];
+        xRing.tail = ++tail;
+
+        /* Out of step: wait for a byte that can start a packet */
+        if (ucPacketLen == 0 && !(byte & PS2_MOUSE_SYNC)) {
+            continue;
+        }
+        ucPacket[ucPacketLen++] = byte;
+        if (ucPacketLen < ucPacketSize) {
+            continue;
+        }
+        ucPacketLen = 0;
+
+        /* 9-bit two's complement counts, PS/2 Y grows upwards */
+        flags = ucPacket[0];
+        if (flags & PS2_MOUSE_OVERFLOW) {
+            pxMove->dx = 0;
+            pxMove->dy = 0;
+        } else {
+            pxMove->dx = (int16_t)(ucPacket[1] - ((flags & PS2_MOUSE_X_SIGN) ? 256 : 0));
+            pxMove->dy = (int16_t)(((flags & PS2_MOUSE_Y_SIGN) ? 256 : 0) - ucPacket[2]);
+        }
+        /* Wheel in the low nibble, 4-bit two's complement */
+        pxMove->wheel = ucPacketSize == 4 ? (int8_t)(((ucPacket[3] & 0x0F) ^ 0x08) - 8) : 0;
+        pxMove->buttons = flags & PS2_MOUSE_BUTTONS;
+        return 1;
+    }
+    return 0;
+}
+
+uint32_t ulPs2KeysDropped(void) {
+    return xRing.dropped;
+}
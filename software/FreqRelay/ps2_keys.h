@@ -0,0 +1,99 @@
+/**
+ * Interrupt-driven PS/2 keyboard and mouse input
+ *
+ * The ISR only moves raw bytes from the PS/2 FIFO into a lock-free ring and
+ * notifies one consumer task, so keyboard activity costs the frequency path
+ * no more than a few register reads. Scancode set 2 is decoded into key
+ * events by the consumer, in task context.
+ *
+ * The BSP's decode_scancode() reads the hardware FIFO itself and blocks until
+ * a full code has arrived, so it cannot be used behind the ring; the small
+ * decoder here handles the E0 (extended) and F0 (break) prefixes, skips the
+ * Pause sequence and drops the keyboard's command replies.
+ *
+ * The port takes either a keyboard or a mouse, whichever the BSP found at
+ * boot. A mouse is switched to the IntelliMouse protocol if it accepts it,
+ * for the wheel, and its 3 or 4 byte packets are decoded by xPs2MouseGet()
+ * instead. Packets are kept in step by bit 3 of the first byte, which is
+ * always set, so a byte lost to a full ring costs at most one packet.
+ *
+ * Single producer (the ISR), single consumer (the task given to xPs2KeysInit).
+ */
+
+#ifndef PS2_KEYS_H
+#define PS2_KEYS_H
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define PS2_RING_SIZE                  32    // Raw bytes, must be a power of two
+#define PS2_RING_MASK                  (PS2_RING_SIZE - 1)
+
+/* Set 2 make codes used by the application (extended keys marked) */
+#define PS2_KEY_U                      0x3C
+#define PS2_KEY_L                      0x4B
+#define PS2_KEY_R                      0x2D
+#define PS2_KEY_T                      0x2C
+#define PS2_KEY_G                      0x34
+#define PS2_KEY_P                      0x4D
+#define PS2_KEY_F                      0x2B
+#define PS2_KEY_W                      0x1D
+#define PS2_KEY_I                      0x43
+#define PS2_KEY_M                      0x3A
+#define PS2_KEY_1                      0x16
+#define PS2_KEY_2                      0x1E
+#define PS2_KEY_3                      0x26
+#define PS2_KEY_4                      0x25
+#define PS2_KEY_5                      0x2E
+#define PS2_KEY_6                      0x36
+#define PS2_KEY_MINUS                  0x4E
+#define PS2_KEY_EQUALS                 0x55  // Unshifted '+'
+#define PS2_KEY_ESC                    0x76
+#define PS2_KEY_KP_PLUS                0x79
+#define PS2_KEY_KP_MINUS               0x7B
+#define PS2_KEY_UP                     0x75  // Extended
+#define PS2_KEY_DOWN                   0x72  // Extended
+
+/* Mouse buttons, Ps2Mouse_t.buttons */
+#define PS2_MOUSE_LEFT                 0x01
+#define PS2_MOUSE_RIGHT                0x02
+#define PS2_MOUSE_MIDDLE               0x04
+
+typedef struct {
+    uint8_t code;                      // Make code, without prefixes
+    uint8_t extended;                  // 1 if preceded by E0
+    uint8_t released;                  // 1 for a break code
+} Ps2Key_t;
+
+typedef struct {
+    int16_t dx;                        // Counts, right positive
+    int16_t dy;                        // Counts, down positive as on the screen
+    int8_t wheel;                      // Notches, towards the user positive
+    uint8_t buttons;                   // PS2_MOUSE_* held
+} Ps2Mouse_t;
+
+/* Open the PS/2 port, set up a mouse if that is what is attached, empty
+ * the FIFO and enable the receive interrupt. xConsumer is notified (task
+ * notification give) whenever bytes arrive. Before the scheduler starts,
+ * the mouse set up waits on its replies. Returns 0 on success, -1 if the
+ * device is missing. */
+int xPs2KeysInit(TaskHandle_t xConsumer);
+
+/* Decode the next complete key event from the ring. Returns 1 and fills
+ * pxKey if one was decoded, 0 once the ring is empty. Consumer task only. */
+int xPs2KeysGet(Ps2Key_t *pxKey);
+
+/* Non-zero if a mouse is attached: the ring is then read with
+ * xPs2MouseGet() instead of xPs2KeysGet() */
+int xPs2IsMouse(void);
+
+/* Decode the next complete mouse packet from the ring. Returns 1 and fills
+ * pxMove if one was decoded, 0 once the ring is empty. Movement that
+ * overflowed the packet is reported as none. Consumer task only. */
+int xPs2MouseGet(Ps2Mouse_t *pxMove);
+
+/* Bytes lost because the ring was full */
+uint32_t ulPs2KeysDropped(void);
+
+#endif /* PS2_KEYS_H */
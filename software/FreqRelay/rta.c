@@ -0,0 +1,67 @@
+/**
+ * Response time analysis of a fixed priority task set
+ *
+ * See rta.h.
+ */
+
+/* Application includes */
+#include "rta.h"
+
+static void vRtaBound(const RtaTask_t *pxTasks, uint32_t count, uint32_t i, RtaResult_t *pxResult) {
+    const RtaTask_t *pxTask = &pxTasks[i];
+    uint64_t response, next, deadline;
+    uint32_t blocking = 0, j, n;
+
+    deadline = pxTask->deadline_us != 0 ? pxTask->deadline_us : pxTask->period_us;
+    for (j = 0; j < count; j++) {
+        if (pxTasks[j].priority < pxTask->priority && pxTasks[j].section_us > blocking &&
+            (pxTasks[j].section_ceiling == 0 || pxTasks[j].section_ceiling >= pxTask->priority)) {
+            blocking = pxTasks[j].section_us;
+        }
+    }
+    pxResult->blocking_us = blocking;
+    pxResult->response_us = RTA_UNBOUNDED;
+    pxResult->met = 0;
+
+    if (pxTask->period_us == 0 || deadline == 0) {
+        return;
+    }
+    for (j = 0; j < count; j++) {
+        if (j != i && pxTasks[j].priority >= pxTask->priority && pxTasks[j].period_us == 0) {
+            return;
+        }
+    }
+
+    /* Fixed point iteration from the job alone, non-decreasing, so it
+     * either settles or passes the deadline */
+    response = (uint64_t)pxTask->wcet_us + blocking;
+    for (n = 0; n < RTA_MAX_ITERATIONS && response <= deadline; n++) {
+        next = (uint64_t)pxTask->wcet_us + blocking;
+        for (j = 0; j < count; j++) {
+            if (j != i && pxTasks[j].priority >= pxTask->priority) {
+                next += ((response + pxTasks[j].period_us - 1) / pxTasks[j].period_us) * pxTasks[j].wcet_us;
+            }
+        }
+        if (next == response) {
+            pxResult->response_us = (uint32_t)response;
+            pxResult->met = 1;
+            return;
+        }
+        response = next;
+    }
+    if (response > deadline && response < RTA_UNBOUNDED) {
+        pxResult->response_us = (uint32_t)response;  // Where it passed the deadline
+    }
+}
+
+uint32_t ulRtaAnalyse(const RtaTask_t *pxTasks, uint32_t count, RtaResult_t *pxResults) {
+    uint32_t i, missed = 0;
+
+    for (i = 0; i < count; i++) {
+        vRtaBound(pxTasks, count, i, &pxResults[i]);
+        if (!pxResults[i].met && pxTasks[i].period_us != 0) {
+            missed++;
+        }
+    }
+    return missed;
+}
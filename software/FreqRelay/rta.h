@@ -0,0 +1,57 @@
+/**
+ * Response time analysis of a fixed priority task set
+ *
+ * The classic bound for preemptive fixed priority scheduling: a job of
+ * task i released together with everything above it finishes within the
+ * smallest R that satisfies
+ *
+ *   R = C(i) + B(i) + sum over j at or above i of ceil(R / T(j)) * C(j)
+ *
+ * where C is the longest job, T the period (or the shortest interval
+ * between releases of an event driven task), and B(i) the longest section
+ * any task below i runs with the scheduler suspended or interrupts masked,
+ * or holding a ceiling mutex whose ceiling is at or above i.
+ * Interrupt handlers go in the same table at RTA_IRQ_PRIORITY, so their
+ * interference is in every task's sum. Equal priorities count against
+ * each other, which covers round robin and handlers taken one at a time.
+ *
+ * The table holds microseconds; where they come from (measured or
+ * declared) is the caller's business. Deadlines must not exceed periods.
+ * A task with no period (sporadic with no bound on its arrivals) only
+ * contributes its section: it gets no bound itself, and neither does
+ * anything below it.
+ *
+ * Pure computation, no kernel calls, so the host build can run it on the
+ * same tables.
+ */
+
+#ifndef RTA_H
+#define RTA_H
+
+#include <stdint.h>
+
+#define RTA_IRQ_PRIORITY               0xFFFFu     // Above every task
+#define RTA_UNBOUNDED                  0xFFFFFFFFu // No finite bound within the deadline
+#define RTA_MAX_ITERATIONS             100
+
+typedef struct {
+    const char *pcName;
+    uint32_t priority;                 // Task priority, or RTA_IRQ_PRIORITY
+    uint32_t period_us;                // 0: sporadic, unbounded arrivals
+    uint32_t deadline_us;              // 0: the period
+    uint32_t wcet_us;                  // Longest job, C
+    uint32_t section_us;               // Longest non-preemptible section, blocks what is above
+    uint32_t section_ceiling;          // Highest priority the section blocks, 0: all
+} RtaTask_t;
+
+typedef struct {
+    uint32_t response_us;              // Bound, the first value past the deadline, or RTA_UNBOUNDED
+    uint32_t blocking_us;              // B used
+    uint8_t met;                       // Bound within the deadline
+} RtaResult_t;
+
+/* Bound every task of the table. Returns the number of tasks with a period
+ * that miss their deadline or have no bound. */
+uint32_t ulRtaAnalyse(const RtaTask_t *pxTasks, uint32_t count, RtaResult_t *pxResults);
+
+#endif /* RTA_H */
@@ -0,0 +1,153 @@
+/**
+ * Per-task CPU usage, stack and context switch statistics
+ *
+ * See run_stats.h.
+ */
+
+/* Standard includes */
+#include <string.h>
+
+/* Application includes */
+#include "fast_mem.h"
+#include "latency.h"
+#include "run_stats.h"
+#include "seqlock.h"
+
+/* Written in the switch-in hook, indexed by the kernel's task number */
+static FAST_DATA uint32_t ulSwitchCount[RUN_STATS_MAX_TASKS];
+static FAST_DATA UBaseType_t uxLastTaskIn = 0;
+
+/* Written in the priority inheritance hooks, inside the kernel */
+static uint32_t ulInheritCount[RUN_STATS_MAX_TASKS];
+static UBaseType_t uxPeakPriority[RUN_STATS_MAX_TASKS];
+static uint8_t ucInherited[RUN_STATS_MAX_TASKS];
+
+#if configCHECK_FOR_STACK_OVERFLOW == 3
+/* In port.c */
+extern void vApplicationStackOverflowHook(TaskHandle_t *pxTask, signed char *pcTaskName);
+
+/* Tasks already reported, by task number */
+static uint32_t ulStackReported = 0;
+#endif
+
+/* Previous sample, vRunStatsSample only */
+static TaskStatus_t xStatus[RUN_STATS_MAX_TASKS];
+static uint32_t ulPrevRunTime[RUN_STATS_MAX_TASKS];
+static uint32_t ulPrevSwitches[RUN_STATS_MAX_TASKS];
+static uint32_t ulPrevTotal = 0;
+
+/* Published for readers */
+static RunStats_t xPublished;
+static SeqLock_t xPublishedSeq = SEQLOCK_INIT;
+
+uint32_t ulRunStatsCounter(void) {
+    return ulLatencyNow();
+}
+
+void vRunStatsSwitchedIn(UBaseType_t uxTaskNumber) {
+    /* The scheduler reselects the running task on most ticks, only count
+     * real switches */
+    if (uxTaskNumber != uxLastTaskIn) {
+        uxLastTaskIn = uxTaskNumber;
+        if (uxTaskNumber < RUN_STATS_MAX_TASKS) {
+            ulSwitchCount[uxTaskNumber]++;
+        }
+    }
+}
+
+void vRunStatsPriorityInherit(UBaseType_t uxTaskNumber, UBaseType_t uxPriority) {
+    if (uxTaskNumber < RUN_STATS_MAX_TASKS) {
+        ulInheritCount[uxTaskNumber]++;
+        ucInherited[uxTaskNumber] = 1;
+        if (uxPriority > uxPeakPriority[uxTaskNumber]) {
+            uxPeakPriority[uxTaskNumber] = uxPriority;
+        }
+    }
+}
+
+void vRunStatsPriorityDisinherit(UBaseType_t uxTaskNumber, UBaseType_t uxPriority) {
+    (void)uxPriority;
+    if (uxTaskNumber < RUN_STATS_MAX_TASKS) {
+        ucInherited[uxTaskNumber] = 0;
+    }
+}
+
+void vRunStatsSample(RunStats_t *pxStats) {
+    static RunStats_t xSample;
+    UBaseType_t uxCount, i, n;
+    uint32_t ulTotal, ulElapsed, ulRun, ulSwitches;
+    RunStatsTask_t *pxTask;
+
+    uxCount = uxTaskGetSystemState(xStatus, RUN_STATS_MAX_TASKS, &ulTotal);
+    ulElapsed = ulTotal - ulPrevTotal;
+    ulPrevTotal = ulTotal;
+
+    xSample.interval_us = ulLatencyElapsedUs(0, ulElapsed);
+    xSample.switches = 0;
+    xSample.count = 0;
+
+    for (i = 0; i < uxCount; i++) {
+        n = xStatus[i].xTaskNumber;
+        if (n >= RUN_STATS_MAX_TASKS) {
+            continue;
+        }
+
+        /* Unsigned differences, correct across a counter wrap */
+        ulRun = xStatus[i].ulRunTimeCounter - ulPrevRunTime[n];
+        ulPrevRunTime[n] = xStatus[i].ulRunTimeCounter;
+        ulSwitches = ulSwitchCount[n] - ulPrevSwitches[n];
+        ulPrevSwitches[n] = ulSwitchCount[n];
+
+        pxTask = &xSample.task[xSample.count++];
+        strncpy(pxTask->name, xStatus[i].pcTaskName, configMAX_TASK_NAME_LEN - 1);
+        pxTask->name[configMAX_TASK_NAME_LEN - 1] = '\0';
+        pxTask->priority = xStatus[i].uxCurrentPriority;
+        pxTask->cpu_permille = ulElapsed ? (uint16_t)(((uint64_t)ulRun * 1000) / ulElapsed) : 0;
+        pxTask->stack_free = xStatus[i].usStackHighWaterMark;
+#if configCHECK_FOR_STACK_OVERFLOW == 3
+        /* The high-water mark stops at the first byte off the fill pattern,
+         * so this covers the region the switch-time check used to compare */
+        if (pxTask->stack_free < RUN_STATS_STACK_GUARD) {
+            vRunStatsStackOverflow(xStatus[i].xHandle, xStatus[i].pcTaskName);
+        }
+#endif
+        pxTask->switches = ulSwitches;
+        pxTask->switches_total = ulSwitchCount[n];
+        pxTask->inherits = ulInheritCount[n];
+        pxTask->peak_priority = uxPeakPriority[n];
+        pxTask->inherited = ucInherited[n];
+        xSample.switches += ulSwitches;
+    }
+
+    /* Built outside the critical section, only the final copy is guarded */
+    vSeqWriteBegin(&xPublishedSeq);
+    xPublished = xSample;
+    vSeqWriteEnd(&xPublishedSeq);
+
+    if (pxStats != NULL) {
+        *pxStats = xSample;
+    }
+}
+
+void vRunStatsGet(RunStats_t *pxStats) {
+    vSeqRead(&xPublishedSeq, pxStats, &xPublished, sizeof(RunStats_t));
+}
+
+#if configCHECK_FOR_STACK_OVERFLOW == 3
+void vRunStatsStackOverflow(TaskHandle_t xTask, const char *pcName) {
+    UBaseType_t n = uxTaskGetTaskNumber(xTask);
+    int first;
+
+    /* The run statistics task and the background timer daemon both report */
+    taskENTER_CRITICAL();
+    first = n < RUN_STATS_MAX_TASKS && !(ulStackReported & (1UL << n));
+    if (first) {
+        ulStackReported |= 1UL << n;
+    }
+    taskEXIT_CRITICAL();
+
+    if (first) {
+        vApplicationStackOverflowHook((TaskHandle_t *)xTask, (signed char *)pcName);
+    }
+}
+#endif
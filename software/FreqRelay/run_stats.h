@@ -0,0 +1,73 @@
+/**
+ * Per-task CPU usage, stack and context switch statistics
+ *
+ * The kernel's run time counter is the timestamp timer (timer1us at the CPU
+ * clock, started by vLatencyInit), so a task's share is measured in CPU
+ * cycles rather than whole 1 ms ticks and short tasks no longer read as 0%.
+ * Interrupt time is charged to the task that was interrupted.
+ *
+ * The 32-bit counter wraps after about 43 s at 100 MHz. vRunStatsSample()
+ * therefore works on the change since the previous sample, which stays
+ * correct across the wrap as long as samples are taken more often than that.
+ * Context switches are counted in the kernel's switch-in trace hook, and
+ * mutex priority inheritance in the inherit/disinherit hooks: the holder's
+ * inheritance count and the highest priority it was raised to.
+ *
+ * With configCHECK_FOR_STACK_OVERFLOW 3 each sample is also the background
+ * stack check: a task that has ever reached into the last
+ * RUN_STATS_STACK_GUARD words of its stack is reported, once, through
+ * vApplicationStackOverflowHook(). The idle job in hello_freqRelay.c checks
+ * the application's static stacks in between.
+ */
+
+#ifndef RUN_STATS_H
+#define RUN_STATS_H
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define RUN_STATS_MAX_TASKS            16    // Application, idle, timer and benchmark tasks, with spare
+#define RUN_STATS_STACK_GUARD          5     // Words at the end of a stack that must stay unused
+#define STACK_FILL_WORD                0xA5A5A5A5UL  // The kernel's tskSTACK_FILL_BYTE in every byte
+
+/* One task over the last sample interval */
+typedef struct {
+    char name[configMAX_TASK_NAME_LEN];
+    UBaseType_t priority;
+    uint16_t cpu_permille;             // Share of the interval, 0-1000
+    uint16_t stack_free;               // Stack high-water mark, words never used
+    uint32_t switches;                 // Times switched in during the interval
+    uint32_t switches_total;           // Times switched in since boot
+    uint32_t inherits;                 // Times raised by priority inheritance since boot
+    UBaseType_t peak_priority;         // Highest priority inherited, 0 if never
+    uint8_t inherited;                 // Currently running at an inherited priority
+} RunStatsTask_t;
+
+typedef struct {
+    uint32_t interval_us;              // Length of the interval the figures cover
+    uint32_t switches;                 // All context switches during the interval
+    UBaseType_t count;                 // Valid entries in task[]
+    RunStatsTask_t task[RUN_STATS_MAX_TASKS];
+} RunStats_t;
+
+/* Kernel hooks, see FreeRTOSConfig.h */
+uint32_t ulRunStatsCounter(void);
+void vRunStatsSwitchedIn(UBaseType_t uxTaskNumber);
+void vRunStatsPriorityInherit(UBaseType_t uxTaskNumber, UBaseType_t uxPriority);
+void vRunStatsPriorityDisinherit(UBaseType_t uxTaskNumber, UBaseType_t uxPriority);
+
+/* Take a new sample, publish it and return it through pxStats (may be NULL).
+ * One caller only. */
+void vRunStatsSample(RunStats_t *pxStats);
+
+/* Consistent copy of the last published sample */
+void vRunStatsGet(RunStats_t *pxStats);
+
+#if configCHECK_FOR_STACK_OVERFLOW == 3
+/* Report a task that has reached its stack guard through
+ * vApplicationStackOverflowHook(), the first time only. Task context. */
+void vRunStatsStackOverflow(TaskHandle_t xTask, const char *pcName);
+#endif
+
+#endif /* RUN_STATS_H */
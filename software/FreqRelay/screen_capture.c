@@ -0,0 +1,238 @@
+/**
+ * Screen capture over the telemetry link
+ *
+ * See screen_capture.h.
+ */
+
+/* Standard includes */
+#include <string.h>
+
+/* Scheduler includes */
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/* Application includes */
+#include "idle_jobs.h"
+#include "screen_capture.h"
+#include "vga_raster.h"
+#include "vga_text.h"
+
+#define CAPTURE_RING_MASK              (SCREEN_CAPTURE_RING_BYTES - 1)
+#define CAPTURE_LITERAL_MAX            128   // Values after one literal code
+#define CAPTURE_REPEAT_MAX             128   // Longest run with a one byte code
+#define CAPTURE_REPEAT_LONG            0xFF
+#define CAPTURE_TEXT_HEADER            2
+#define CAPTURE_IMAGE_HEADER           5
+
+/* Most bytes a row of n values of size bytes encodes to, all literals */
+#define CAPTURE_ROW_WORST(n, size)     ((n) * (size) + ((n) + CAPTURE_LITERAL_MAX - 1) / CAPTURE_LITERAL_MAX)
+
+#if SCREEN_CAPTURE_RING_BYTES & CAPTURE_RING_MASK
+#error "SCREEN_CAPTURE_RING_BYTES must be a power of two"
+#endif
+#if CAPTURE_IMAGE_HEADER + CAPTURE_ROW_WORST(VGA_RASTER_LAYER_X, VGA_RASTER_BYTES_PER_PIXEL) > SCREEN_CAPTURE_RING_BYTES
+#error "SCREEN_CAPTURE_RING_BYTES must hold the longest image row"
+#endif
+
+#define CAPTURE_IDLE                   0
+#define CAPTURE_TEXT                   1     // Rows of the character buffer
+#define CAPTURE_IMAGE                  2     // Rows of the frame
+#define CAPTURE_DONE                   3     // Encoded, the drain sends the rest
+
+static uint8_t ucRing[SCREEN_CAPTURE_RING_BYTES];
+static volatile uint32_t ulWritten;   // Free-running, by the job
+static volatile uint32_t ulRead;      // Free-running, by the drain
+static volatile uint32_t ulImageStart;  // Count the image part starts at, ~0 until then
+static volatile uint8_t ucPhase = CAPTURE_IDLE;
+static uint32_t ulCapture = 0;
+static uint32_t ulSent = 0;
+
+/* Job only */
+static uint32_t ulRow;
+static int xWidth, xHeight;
+static uint32_t ulValues[VGA_RASTER_LAYER_X > TEXT_COLS ? VGA_RASTER_LAYER_X : TEXT_COLS];
+static char cText[TEXT_COLS];
+
+static inline uint32_t ulCaptureFree(void) {
+    return SCREEN_CAPTURE_RING_BYTES - (ulWritten - ulRead);
+}
+
+static inline void vCapturePut(uint32_t *pulPos, uint32_t value, int size) {
+    int i;
+
+    for (i = 0; i < size; i++) {
+        ucRing[(*pulPos)++ & CAPTURE_RING_MASK] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+/* One row of n values into the ring at *pulPos */
+static void vCaptureEncodeRow(uint32_t *pulPos, const uint32_t *pulValues, int n, int size) {
+    int i = 0, run, start;
+
+    while (i < n) {
+        for (run = 1; i + run < n && pulValues[i + run] == pulValues[i] && run < 0xFFFF; run++) {
+        }
+        if (run >= 2) {
+            if (run <= CAPTURE_REPEAT_MAX) {
+                vCapturePut(pulPos, 0x7E + run, 1);
+            } else {
+                vCapturePut(pulPos, CAPTURE_REPEAT_LONG, 1);
+                vCapturePut(pulPos, run, 2);
+            }
+            vCapturePut(pulPos, pulValues[i], size);
+            i += run;
+            continue;
+        }
+
+        /* Literals up to the next run */
+        start = i;
+        do {
+            i++;
+        } while (i < n && i - start < CAPTURE_LITERAL_MAX && (i + 1 >= n || pulValues[i + 1] != pulValues[i]));
+        vCapturePut(pulPos, i - start - 1, 1);
+        for (; start < i; start++) {
+            vCapturePut(pulPos, pulValues[start], size);
+        }
+    }
+}
+
+/* One step: the next row, or nothing while the ring has no room for it */
+static int xScreenCaptureJob(void) {
+    uint32_t pos = ulWritten;
+    int col;
+
+    if (ucPhase == CAPTURE_TEXT) {
+        if (ulCaptureFree() < CAPTURE_TEXT_HEADER + CAPTURE_ROW_WORST(TEXT_COLS, 1)) {
+            return 0;
+        }
+        if (ulRow == 0) {
+            vCapturePut(&pos, TEXT_COLS, 1);
+            vCapturePut(&pos, TEXT_ROWS, 1);
+        }
+        vTextGetRow((int)ulRow, cText);
+        for (col = 0; col < TEXT_COLS; col++) {
+            ulValues[col] = (uint8_t)cText[col];
+        }
+        vCaptureEncodeRow(&pos, ulValues, TEXT_COLS, 1);
+        portCOMPILER_BARRIER();
+        ulWritten = pos;
+
+        if (++ulRow == TEXT_ROWS) {
+            ulImageStart = pos;
+            ulRow = 0;
+            ucPhase = CAPTURE_IMAGE;
+        }
+        return 1;
+    }
+
+    if (ucPhase == CAPTURE_IMAGE) {
+        if (ulCaptureFree() < CAPTURE_IMAGE_HEADER + CAPTURE_ROW_WORST(xWidth, VGA_RASTER_BYTES_PER_PIXEL)) {
+            return 0;
+        }
+        if (ulRow == 0) {
+            vCapturePut(&pos, (uint32_t)xWidth, 2);
+            vCapturePut(&pos, (uint32_t)xHeight, 2);
+            vCapturePut(&pos, VGA_RASTER_BYTES_PER_PIXEL, 1);
+        }
+        if (!xRasterReadRow((int)ulRow, ulValues, xWidth)) {
+            memset(ulValues, 0, sizeof(ulValues[0]) * (uint32_t)xWidth);
+        }
+        vCaptureEncodeRow(&pos, ulValues, xWidth, VGA_RASTER_BYTES_PER_PIXEL);
+        portCOMPILER_BARRIER();
+        ulWritten = pos;
+
+        if (++ulRow == (uint32_t)xHeight) {
+            ucPhase = CAPTURE_DONE;
+            return 0;
+        }
+        return 1;
+    }
+    return 0;
+}
+
+int xScreenCaptureInit(void) {
+    if (xTelemetryAddExport(xScreenCaptureChunk) != 0) {
+        return -1;
+    }
+    return xIdleJobRegister("Capture", xScreenCaptureJob);
+}
+
+int32_t lScreenCaptureStart(void) {
+    int width, height;
+    int32_t capture = -1;
+
+    vRasterFrameSize(&width, &height);
+    if (width == 0 || height == 0) {
+        return -1;
+    }
+    if (width > VGA_RASTER_LAYER_X) {
+        width = VGA_RASTER_LAYER_X;
+    }
+
+    taskENTER_CRITICAL();
+    if (ucPhase == CAPTURE_IDLE) {
+        xWidth = width;
+        xHeight = height;
+        ulRow = 0;
+        ulWritten = 0;
+        ulRead = 0;
+        ulImageStart = 0xFFFFFFFFUL;
+        capture = (int32_t)(++ulCapture & 0xFFFF);
+        ucPhase = CAPTURE_TEXT;
+    }
+    taskEXIT_CRITICAL();
+    return capture;
+}
+
+int xScreenCaptureChunk(TelemetryChunk_t *pxChunk) {
+    uint32_t written, image, read = ulRead, end, n, i;
+    uint8_t phase;
+
+    /* The phase before the count, and the count before the image start,
+     * so neither is older than the bytes it covers */
+    phase = ucPhase;
+    if (phase == CAPTURE_IDLE) {
+        return 0;
+    }
+    written = ulWritten;
+    image = ulImageStart;
+
+    pxChunk->record = (uint16_t)ulCapture;
+    if (read < image) {
+        pxChunk->part = SCREEN_CAPTURE_PART_TEXT;
+        pxChunk->offset = read;
+        end = written < image ? written : image;
+    } else {
+        pxChunk->part = SCREEN_CAPTURE_PART_IMAGE;
+        pxChunk->offset = read - image;
+        end = written;
+    }
+
+    n = end - read;
+    if (n == 0) {
+        if (phase != CAPTURE_DONE || read != written) {
+            return 0;
+        }
+        pxChunk->part = SCREEN_CAPTURE_PART_END;
+        pxChunk->offset = 0;
+        pxChunk->length = 0;
+        ulSent++;
+        ucPhase = CAPTURE_IDLE;
+        return 1;
+    }
+
+    if (n > TELEMETRY_CHUNK_BYTES) {
+        n = TELEMETRY_CHUNK_BYTES;
+    }
+    for (i = 0; i < n; i++) {
+        pxChunk->data[i] = ucRing[(read + i) & CAPTURE_RING_MASK];
+    }
+    pxChunk->length = (uint8_t)n;
+    portCOMPILER_BARRIER();
+    ulRead = read + n;
+    return 1;
+}
+
+uint32_t ulScreenCaptureSent(void) {
+    return ulSent;
+}
@@ -0,0 +1,59 @@
+/**
+ * Screen capture over the telemetry link
+ *
+ * lScreenCaptureStart() takes what the VGA shows, the character buffer
+ * (vga_text.h) and the pixel frame (vga_raster.h), and sends it out as
+ * TELEMETRY_EXPORT chunks from the telemetry drain, the text part, the
+ * image part, then an empty SCREEN_CAPTURE_PART_END chunk. An idle job
+ * (idle_jobs.h) encodes one row a step into a SCREEN_CAPTURE_RING_BYTES
+ * ring, and only while the ring has room for the longest row, so the
+ * capture costs no control task any time and waits for the link however
+ * slow it is; the drain hands the ring out as chunks.
+ *
+ * Each row is read as the job gets to it, so a capture taken while the
+ * display redraws can mix rows from before and after the redraw.
+ *
+ * The parts, the record number of each chunk being the capture's:
+ *
+ *   SCREEN_CAPTURE_PART_TEXT   u8 columns, u8 rows, then each row
+ *   SCREEN_CAPTURE_PART_IMAGE  u16 width, u16 height, u8 bytes per pixel,
+ *                              then each row, pixels little endian
+ *
+ * Each row is run-length encoded on its own, in runs of values (characters
+ * or pixels):
+ *
+ *   0x00-0x7F    n + 1 values follow
+ *   0x80-0xFE    the next value, n - 0x7E times (2 to 128)
+ *   0xFF         u16 count, then the value, count times
+ *
+ * A decoder knows where a row ends by its length. tools/
+ * telemetry_decode.py --screens writes screen_<n>.ppm and screen_<n>.txt.
+ */
+
+#ifndef SCREEN_CAPTURE_H
+#define SCREEN_CAPTURE_H
+
+#include <stdint.h>
+#include "telemetry.h"
+
+/* After the COMTRADE parts (comtrade.h), so a decoder tells them apart */
+#define SCREEN_CAPTURE_PART_TEXT       3
+#define SCREEN_CAPTURE_PART_IMAGE      4
+#define SCREEN_CAPTURE_PART_END        5      // Empty, the capture is complete
+#define SCREEN_CAPTURE_RING_BYTES      8192   // Encoded, power of 2
+
+/* Add the export source and the idle job. Before the scheduler starts.
+ * Returns 0 on success. */
+int xScreenCaptureInit(void);
+
+/* Start a capture. Returns its number, or -1 while one is being sent or
+ * without the rasterizer. */
+int32_t lScreenCaptureStart(void);
+
+/* TelemetryExport_t: the next chunk of the capture being sent */
+int xScreenCaptureChunk(TelemetryChunk_t *pxChunk);
+
+/* Captures fully sent */
+uint32_t ulScreenCaptureSent(void);
+
+#endif /* SCREEN_CAPTURE_H */
@@ -0,0 +1,78 @@
+/**
+ * Sequence lock for shared relay state
+ *
+ * A writer makes the sequence odd, updates the data and makes it even again.
+ * A reader copies the data without locking and retries if the sequence was
+ * odd or changed during the copy, so readers never block.
+ *
+ * This is a single-core design: task writers run inside a critical section
+ * and ISRs cannot nest, so writers never interleave and a reader only ever
+ * retries after being preempted by a complete write. Keep writer sections to
+ * a few stores.
+ */
+
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <stdint.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+typedef struct {
+    volatile uint32_t seq;
+} SeqLock_t;
+
+#define SEQLOCK_INIT                   { 0 }
+
+/* Stop the compiler from moving data accesses across the sequence updates */
+#define seqlockBARRIER()               __asm__ __volatile__("" ::: "memory")
+
+/* Writer from task context */
+static inline void vSeqWriteBegin(SeqLock_t *pxLock) {
+    taskENTER_CRITICAL();
+    pxLock->seq++;
+    seqlockBARRIER();
+}
+
+static inline void vSeqWriteEnd(SeqLock_t *pxLock) {
+    seqlockBARRIER();
+    pxLock->seq++;
+    taskEXIT_CRITICAL();
+}
+
+/* Writer from an ISR, interrupts are already disabled */
+static inline void vSeqWriteBeginFromISR(SeqLock_t *pxLock) {
+    pxLock->seq++;
+    seqlockBARRIER();
+}
+
+static inline void vSeqWriteEndFromISR(SeqLock_t *pxLock) {
+    seqlockBARRIER();
+    pxLock->seq++;
+}
+
+/* Reader: snapshot of the write count, or an odd value if a write is open */
+static inline uint32_t ulSeqReadBegin(const SeqLock_t *pxLock) {
+    uint32_t seq = pxLock->seq;
+    seqlockBARRIER();
+    return seq;
+}
+
+/* Reader: non-zero if the data read since ulSeqReadBegin() must be discarded */
+static inline int xSeqReadRetry(const SeqLock_t *pxLock, uint32_t start) {
+    seqlockBARRIER();
+    return (start & 1) || (pxLock->seq != start);
+}
+
+/* Consistent copy of a shared object */
+static inline void vSeqRead(const SeqLock_t *pxLock, void *pvDest, const volatile void *pvSrc, size_t len) {
+    uint32_t start;
+
+    do {
+        start = ulSeqReadBegin(pxLock);
+        memcpy(pvDest, (const void *)pvSrc, len);
+    } while (xSeqReadRetry(pxLock, start));
+}
+
+#endif /* SEQLOCK_H */
@@ -0,0 +1,97 @@
+/**
+ * Seven-segment frequency readout
+ *
+ * See seven_seg.h.
+ */
+
+/* Hardware includes */
+#include "system.h"
+#include "io.h"
+#include "sys/alt_irq.h"
+
+/* Application includes */
+#include "seven_seg.h"
+#include "system_state.h"
+
+#define SEVEN_SEG_MHZ_MAX              99999  // Five digits
+
+/* 0..99 as two BCD digits */
+#define BCD_ROW(t)                     0x##t##0, 0x##t##1, 0x##t##2, 0x##t##3, 0x##t##4, \
+                                       0x##t##5, 0x##t##6, 0x##t##7, 0x##t##8, 0x##t##9
+static const uint8_t ucBcd[100] = {
+    BCD_ROW(0), BCD_ROW(1), BCD_ROW(2), BCD_ROW(3), BCD_ROW(4),
+    BCD_ROW(5), BCD_ROW(6), BCD_ROW(7), BCD_ROW(8), BCD_ROW(9)
+};
+
+/* Changed with interrupts masked */
+static uint32_t ulFreqDigits = 0;      // Normal and alert readout, less the state digit
+static uint32_t ulFaultDigits = 0;     // Failsafe readout, 0 until failsafe is latched
+static uint32_t ulHealthDigit = 0;     // In place, third digit from the left
+static uint8_t ucState = STATUS_NORMAL;
+static uint32_t ulShown = 0xFFFFFFFFUL;
+
+/* Write the readout for the current state if it differs from the last */
+static void vSevenSegWrite(void) {
+    uint32_t digits;
+
+    if (ucState == STATUS_FAILSAFE) {
+        digits = ulFaultDigits != 0 ? ulFaultDigits :
+                 ((uint32_t)SEVEN_SEG_FAILSAFE_DIGIT << 28) | ((uint32_t)SEVEN_SEG_SOURCE_UNKNOWN << 24);
+    } else {
+        digits = ((uint32_t)ucState << 28) | ulFreqDigits;
+    }
+    digits |= ulHealthDigit;
+
+    if (digits != ulShown) {
+        ulShown = digits;
+        IOWR(SEVEN_SEG_BASE, 0, digits);
+    }
+}
+
+void vSevenSegFrequency(uint32_t channel, fix16_t freq) {
+    alt_irq_context context;
+    uint32_t mhz, hundreds, digits;
+
+    mhz = freq <= 0 ? 0 : (uint32_t)(((uint64_t)freq * 1000) >> 16);
+    if (mhz > SEVEN_SEG_MHZ_MAX) {
+        mhz = SEVEN_SEG_MHZ_MAX;
+    }
+    hundreds = mhz / 100;
+    digits = ((channel & 0xF) << 24) | ((hundreds / 100) << 16) |
+             ((uint32_t)ucBcd[hundreds % 100] << 8) | ucBcd[mhz % 100];
+
+    context = alt_irq_disable_all();
+    ulFreqDigits = digits;
+    vSevenSegWrite();
+    alt_irq_enable_all(context);
+}
+
+void vSevenSegState(uint8_t state) {
+    alt_irq_context context;
+
+    context = alt_irq_disable_all();
+    if (ucState == STATUS_FAILSAFE && state != STATUS_FAILSAFE) {
+        ulFaultDigits = 0;
+    }
+    ucState = state;
+    vSevenSegWrite();
+    alt_irq_enable_all(context);
+}
+
+void vSevenSegFault(uint32_t source, uint16_t loads) {
+    alt_irq_context context;
+
+    context = alt_irq_disable_all();
+    ulFaultDigits = ((uint32_t)SEVEN_SEG_FAILSAFE_DIGIT << 28) | ((source & 0xF) << 24) | loads;
+    vSevenSegWrite();
+    alt_irq_enable_all(context);
+}
+
+void vSevenSegHealth(uint8_t digit) {
+    alt_irq_context context;
+
+    context = alt_irq_disable_all();
+    ulHealthDigit = (uint32_t)(digit & 0xF) << 20;
+    vSevenSegWrite();
+    alt_irq_enable_all(context);
+}
@@ -0,0 +1,48 @@
+/**
+ * Seven-segment frequency readout
+ *
+ * The seven_seg core drives the eight digits HEX7..HEX0 from one 32-bit
+ * register, a nibble per digit with HEX7 in the top nibble, and decodes
+ * each nibble to segments itself. The readout is therefore one register
+ * write of packed digits, made only when the shown value changes:
+ *
+ *   normal, alert   S C h d d d d d    S: STATUS_* level, C: feeder,
+ *                                      ddddd: frequency in mHz (50012 is
+ *                                      50.012 Hz)
+ *   failsafe        F E h 0 l l l l    E: EVENT_SOURCE_* that latched it,
+ *                                      llll: loads with a feedback
+ *                                      mismatch, in hex
+ *
+ * and h in both the fault digit, bits 4-7 of the health word (health.h):
+ * 1 feedback fault, 2 deadline missed, 4 queue overflow, 8 watchdog, 0
+ * when all is well.
+ *
+ * The digits are built with a 100 entry binary to BCD table. Each update
+ * is a few instructions and the write, in a short interrupt-masked section,
+ * so any task or ISR may call them and no task draws the readout: it keeps
+ * up while the display tasks are starved or absent.
+ */
+
+#ifndef SEVEN_SEG_H
+#define SEVEN_SEG_H
+
+#include <stdint.h>
+#include "fix16.h"
+
+#define SEVEN_SEG_FAILSAFE_DIGIT       0xF
+#define SEVEN_SEG_SOURCE_UNKNOWN       0xE   // Failsafe shown before its source was given
+
+/* Newest frequency of the feeder on display. Shown unless in failsafe. */
+void vSevenSegFrequency(uint32_t channel, fix16_t freq);
+
+/* Overall state, STATUS_*. STATUS_FAILSAFE switches to the fault code. */
+void vSevenSegState(uint8_t state);
+
+/* What latched failsafe, for the fault code: source EVENT_SOURCE_* and the
+ * mismatched loads. Kept until the state leaves failsafe. */
+void vSevenSegFault(uint32_t source, uint16_t loads);
+
+/* The fault digit, 0 to 0xF */
+void vSevenSegHealth(uint8_t digit);
+
+#endif /* SEVEN_SEG_H */
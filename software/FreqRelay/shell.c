@@ -0,0 +1,247 @@
+/**
+ * Command shell on the JTAG UART
+ *
+ * See shell.h.
+ */
+
+/* Standard includes */
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Hardware includes */
+#include "system.h"
+
+/* Application includes */
+#include "idle_jobs.h"
+#include "jtag_uart.h"
+#include "shell.h"
+#include "telemetry.h"
+
+#define SHELL_FIX16_INT_MAX            32767
+#define SHELL_FIX16_SCALE_MAX          10000  // Four fraction digits
+
+/* Idle job only, so nothing here is locked */
+static const ShellCommand_t *pxShellCommands = NULL;
+static uint32_t ulShellCommandCount = 0;
+static char cLine[SHELL_LINE_MAX + 1];
+static uint32_t ulLineLen = 0;
+static uint8_t ucOut[SHELL_OUT_SIZE];
+static uint32_t ulOutHead = 0;
+static uint32_t ulOutTail = 0;
+static uint32_t ulDropped = 0;
+static int iShellFd = -1;
+
+/* Append len bytes whole, or drop them. Returns 0 if they fit. */
+static int xShellPut(const char *pcData, uint32_t len) {
+    uint32_t i;
+
+    if (len > SHELL_OUT_SIZE - (ulOutHead - ulOutTail)) {
+        ulDropped++;
+        return -1;
+    }
+    for (i = 0; i < len; i++) {
+        ucOut[(ulOutHead + i) & SHELL_OUT_MASK] = (uint8_t)pcData[i];
+    }
+    ulOutHead += len;
+    return 0;
+}
+
+/* Write what the UART takes now, if the telemetry drain is not using it */
+static void vShellFlush(void) {
+    uint32_t tail = ulOutTail, n;
+    int written;
+
+    if (tail == ulOutHead || xTelemetryUartTake(0) != pdTRUE) {
+        return;
+    }
+    while (tail != ulOutHead) {
+        /* Up to the end of the ring at most */
+        n = ulOutHead - tail;
+        if (n > SHELL_OUT_SIZE - (tail & SHELL_OUT_MASK)) {
+            n = SHELL_OUT_SIZE - (tail & SHELL_OUT_MASK);
+        }
+        written = write(iShellFd, &ucOut[tail & SHELL_OUT_MASK], n);
+        if (written <= 0) {
+            break;
+        }
+        tail += (uint32_t)written;
+    }
+    vTelemetryUartGive();
+    ulOutTail = tail;
+}
+
+static void vShellHelp(void) {
+    uint32_t i;
+
+    vShellPrintf("help  this list\n");
+    for (i = 0; i < ulShellCommandCount; i++) {
+        vShellPrintf("%s %s\n", pxShellCommands[i].pcName, pxShellCommands[i].pcHelp);
+    }
+}
+
+/* Split the line into words in place and run its command */
+static void vShellExecute(void) {
+    char *argv[SHELL_ARGS_MAX];
+    char *pc = cLine;
+    int argc = 0;
+    uint32_t i;
+
+    while (*pc != '\0' && argc < SHELL_ARGS_MAX) {
+        while (*pc == ' ') {
+            *pc++ = '\0';
+        }
+        if (*pc == '\0') {
+            break;
+        }
+        argv[argc++] = pc;
+        while (*pc != ' ' && *pc != '\0') {
+            pc++;
+        }
+    }
+    if (argc == 0) {
+        return;
+    }
+
+    if (strcmp(argv[0], "help") == 0) {
+        vShellHelp();
+        return;
+    }
+    for (i = 0; i < ulShellCommandCount; i++) {
+        if (strcmp(argv[0], pxShellCommands[i].pcName) == 0) {
+            pxShellCommands[i].pxHandler(argc, argv);
+            return;
+        }
+    }
+    vShellPrintf("%s: no such command, try help\n", argv[0]);
+}
+
+/* One step: flush, then take typed characters while no output waits */
+static int xShellJob(void) {
+    uint32_t budget = SHELL_CHARS_PER_STEP;
+    char echo;
+    int c = -1;
+
+    vShellFlush();
+    while (ulOutHead == ulOutTail && budget > 0 && (c = xJtagUartGetChar()) >= 0) {
+        budget--;
+        echo = (char)c;
+        if (c == '\r' || c == '\n') {
+            if (ulLineLen == 0) {
+                continue;              // The other half of a CR LF, or an empty line
+            }
+            (void)xShellPut("\n", 1);
+            cLine[ulLineLen] = '\0';
+            ulLineLen = 0;
+            vShellExecute();
+            (void)xShellPut(SHELL_PROMPT, sizeof(SHELL_PROMPT) - 1);
+        } else if (c == '\b' || c == 0x7F) {
+            if (ulLineLen > 0) {
+                ulLineLen--;
+                (void)xShellPut("\b \b", 3);
+            }
+        } else if (c >= ' ' && c < 0x7F && ulLineLen < SHELL_LINE_MAX) {
+            cLine[ulLineLen++] = echo;
+            (void)xShellPut(&echo, 1);
+        }
+        vShellFlush();
+    }
+
+    /* More waits if output is left or the budget ran out first */
+    return ulOutHead != ulOutTail || budget == 0;
+}
+
+int xShellInit(const ShellCommand_t *pxCommands, uint32_t count) {
+    pxShellCommands = pxCommands;
+    ulShellCommandCount = count;
+    ulLineLen = 0;
+    ulOutHead = 0;
+    ulOutTail = 0;
+
+    iShellFd = open(JTAG_UART_NAME, O_WRONLY | O_NONBLOCK);
+    if (iShellFd < 0) {
+        return -1;
+    }
+    return xIdleJobRegister("Shell", xShellJob);
+}
+
+void vShellPrintf(const char *pcFormat, ...) {
+    char buffer[SHELL_PRINT_MAX];
+    va_list args;
+    int len;
+
+    va_start(args, pcFormat);
+    len = vsnprintf(buffer, sizeof(buffer), pcFormat, args);
+    va_end(args);
+    if (len < 0) {
+        return;
+    }
+    if (len >= (int)sizeof(buffer)) {
+        len = (int)sizeof(buffer) - 1;  // Cut short, still sent
+    }
+    (void)xShellPut(buffer, (uint32_t)len);
+}
+
+int xShellArgUint(const char *pcArg, uint32_t *pulValue) {
+    uint32_t value = 0, base = 10, digit;
+
+    if (pcArg[0] == '0' && (pcArg[1] == 'x' || pcArg[1] == 'X')) {
+        base = 16;
+        pcArg += 2;
+    }
+    if (*pcArg == '\0') {
+        return -1;
+    }
+    for (; *pcArg != '\0'; pcArg++) {
+        if (*pcArg >= '0' && *pcArg <= '9') {
+            digit = (uint32_t)(*pcArg - '0');
+        } else if (base == 16 && (*pcArg | 0x20) >= 'a' && (*pcArg | 0x20) <= 'f') {
+            digit = (uint32_t)((*pcArg | 0x20) - 'a' + 10);
+        } else {
+            return -1;
+        }
+        if (value > (0xFFFFFFFFUL - digit) / base) {
+            return -1;
+        }
+        value = value * base + digit;
+    }
+    *pulValue = value;
+    return 0;
+}
+
+int xShellArgFix16(const char *pcArg, fix16_t *pxValue) {
+    uint32_t whole = 0, fraction = 0, scale = 1, digits = 0;
+    int negative = 0;
+    fix16_t value;
+
+    if (*pcArg == '-' || *pcArg == '+') {
+        negative = *pcArg++ == '-';
+    }
+    for (; *pcArg >= '0' && *pcArg <= '9'; pcArg++, digits++) {
+        whole = whole * 10 + (uint32_t)(*pcArg - '0');
+        if (whole > SHELL_FIX16_INT_MAX) {
+            return -1;
+        }
+    }
+    if (*pcArg == '.') {
+        for (pcArg++; *pcArg >= '0' && *pcArg <= '9'; pcArg++, digits++) {
+            if (scale < SHELL_FIX16_SCALE_MAX) {  // Further digits are below a Q16.16 step
+                fraction = fraction * 10 + (uint32_t)(*pcArg - '0');
+                scale *= 10;
+            }
+        }
+    }
+    if (*pcArg != '\0' || digits == 0) {
+        return -1;
+    }
+
+    value = FIX16_FROM_INT((fix16_t)whole) + (fix16_t)(((fraction << FIX16_SHIFT) + scale / 2) / scale);
+    *pxValue = negative ? -value : value;
+    return 0;
+}
+
+uint32_t ulShellDropped(void) {
+    return ulDropped;
+}
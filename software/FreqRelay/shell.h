@@ -0,0 +1,65 @@
+/**
+ * Command shell on the JTAG UART
+ *
+ * A line-at-a-time shell for a host on the JTAG UART (nios2-terminal),
+ * run as an idle job (see idle_jobs.h), so it only ever gets time no task
+ * wants and never blocks. Each step takes what the host has typed from the
+ * UART's receive ring (xJtagUartGetChar), echoes it and edits the line; a
+ * carriage return or line feed splits the line into words and runs the
+ * command named by the first. There is no scanf: arguments are parsed with
+ * xShellArgUint() and xShellArgFix16().
+ *
+ * A command handler prints with vShellPrintf() into an output ring of
+ * SHELL_OUT_SIZE bytes, and the job writes the ring to the UART through
+ * an O_NONBLOCK descriptor, with the telemetry drain's UART lock taken
+ * only if it is free (xTelemetryUartTake(0)). So a busy or absent host
+ * only stops the shell's output: a line that does not fit whole is
+ * dropped and counted, and no more input is taken while any output waits.
+ * Anything long, the memory census or a kernel trace, is left to the task
+ * that already prints it; a command only asks for it.
+ *
+ * Handlers run on the idle task: they must not block, and should be as
+ * short as a few lines of output.
+ */
+
+#ifndef SHELL_H
+#define SHELL_H
+
+#include <stdint.h>
+#include "fix16.h"
+
+#define SHELL_LINE_MAX                 64     // Typed characters per line
+#define SHELL_ARGS_MAX                 6      // Words per line, command included
+#define SHELL_PRINT_MAX                96     // Longest vShellPrintf() output
+#define SHELL_OUT_SIZE                 1024   // Output ring bytes, power of 2
+#define SHELL_OUT_MASK                 (SHELL_OUT_SIZE - 1)
+#define SHELL_CHARS_PER_STEP           16     // Typed characters handled per job step
+#define SHELL_PROMPT                   "> "
+
+/* argv[0] is the command's name */
+typedef void (*ShellHandler_t)(int argc, char *argv[]);
+
+typedef struct {
+    const char *pcName;
+    const char *pcHelp;                // One line for "help", arguments first
+    ShellHandler_t pxHandler;
+} ShellCommand_t;
+
+/* Open the UART and register the idle job, before the scheduler starts.
+ * pxCommands stays in use; "help" is added to them. Returns 0 on success. */
+int xShellInit(const ShellCommand_t *pxCommands, uint32_t count);
+
+/* Formatted output from a handler, dropped whole if the ring is full */
+void vShellPrintf(const char *pcFormat, ...) __attribute__((format(printf, 1, 2)));
+
+/* Unsigned decimal, or hex after 0x. Returns 0 on success. */
+int xShellArgUint(const char *pcArg, uint32_t *pulValue);
+
+/* Signed decimal with up to four fraction digits, as Q16.16. Returns 0 on
+ * success. */
+int xShellArgFix16(const char *pcArg, fix16_t *pxValue);
+
+/* Output lines dropped with the ring full */
+uint32_t ulShellDropped(void);
+
+#endif /* SHELL_H */
@@ -0,0 +1,304 @@
+/**
+ * One relay of the host ring simulation
+ *
+ * See coord_node.h.
+ */
+
+/* Standard includes */
+#include <string.h>
+
+/* Scheduler includes */
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/* Hardware includes */
+#include "system.h"
+#include "altera_avalon_uart_regs.h"
+#include "sys/alt_timestamp.h"
+
+/* Application includes */
+#include "coord_node.h"
+#include "irq_defer.h"
+#include "latency.h"
+#include "time_base.h"
+
+#define SIM_UART_ERRORS                (ALTERA_AVALON_UART_STATUS_PE_MSK | ALTERA_AVALON_UART_STATUS_FE_MSK | \
+                                        ALTERA_AVALON_UART_STATUS_ROE_MSK)
+#define SIM_UART_SOURCES               (ALTERA_AVALON_UART_CONTROL_RRDY_MSK | ALTERA_AVALON_UART_CONTROL_TRDY_MSK | \
+                                        ALTERA_AVALON_UART_CONTROL_TMT_MSK)
+#define SIM_ISR_RUNS                   16      // Handler runs in a row before the UART is taken to be stuck
+
+struct SimTask {
+    int notified;
+};
+
+static struct {
+    uint32_t control;
+    uint32_t errors;                   // SIM_UART_ERRORS bits
+    uint8_t rx;
+    uint8_t rrdy;
+    uint8_t hold;                      // Transmit holding register
+    uint8_t holding;
+    uint64_t shift_end;                // Line time the shift register empties
+    SimByte_t *pxTx;                   // This run's characters sent
+    uint32_t tx_count;
+    uint32_t tx_max;
+} xUart;
+
+static SimNodeConfig_t xConfig;
+static uint64_t ullNow;                // Line time
+static IrqHandler_t pxHandler;
+static void *pvHandlerContext;
+static struct SimTask xCoordTask, xSyncTask;
+static uint64_t ullServiceAt;          // The coordination task's timeout
+static SimNodeReport_t xReport;
+static int xRight;                     // On the expected stage since the event
+
+uint64_t ullSimNodeClock(uint32_t offset, int32_t drift_ppb, uint64_t at) {
+    return offset + at + (uint64_t)((int64_t)at * drift_ppb / 1000000000LL);
+}
+
+/* The HAL's timestamp timer and the IRQ API, on this relay's clock */
+int alt_timestamp_start(void) {
+    return 0;
+}
+
+alt_timestamp_type alt_timestamp(void) {
+    return (alt_timestamp_type)ullSimNodeClock(xConfig.offset, xConfig.drift_ppb, ullNow);
+}
+
+uint32_t alt_timestamp_freq(void) {
+    return SIM_COUNTS_PER_US * 1000000UL;
+}
+
+int xIrqRegister(uint32_t irq, IrqHandler_t handler, void *context) {
+    (void)irq;
+    pxHandler = handler;
+    pvHandlerContext = context;
+    return 0;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t xTask, BaseType_t *pxHigherPriorityTaskWoken) {
+    xTask->notified = 1;
+    *pxHigherPriorityTaskWoken = pdTRUE;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t xTask) {
+    xTask->notified = 1;
+    return pdPASS;
+}
+
+static uint32_t ulUartStatus(void) {
+    uint32_t status = xUart.errors;
+
+    if (xUart.errors != 0) {
+        status |= ALTERA_AVALON_UART_STATUS_E_MSK;
+    }
+    if (xUart.rrdy) {
+        status |= ALTERA_AVALON_UART_STATUS_RRDY_MSK;
+    }
+    if (!xUart.holding) {
+        status |= ALTERA_AVALON_UART_STATUS_TRDY_MSK;
+        if (ullNow >= xUart.shift_end) {
+            status |= ALTERA_AVALON_UART_STATUS_TMT_MSK;
+        }
+    }
+    return status;
+}
+
+/* The holding register into an empty shift register, the character's
+ * start bit going out now */
+static void vUartShift(void) {
+    if (!xUart.holding || ullNow < xUart.shift_end) {
+        return;
+    }
+    if (xUart.tx_count < xUart.tx_max) {
+        xUart.pxTx[xUart.tx_count].at = ullNow;
+        xUart.pxTx[xUart.tx_count].byte = xUart.hold;
+        xUart.pxTx[xUart.tx_count].error = 0;
+        xUart.tx_count++;
+    }
+    xUart.holding = 0;
+    xUart.shift_end = ullNow + xConfig.byte_counts;
+    xReport.sent++;
+}
+
+/* A character unread when the next one arrives is overrun */
+static void vUartReceive(const SimByte_t *pxByte) {
+    if (xUart.rrdy) {
+        xUart.errors |= ALTERA_AVALON_UART_STATUS_ROE_MSK;
+    }
+    if (pxByte->error) {
+        xUart.errors |= ALTERA_AVALON_UART_STATUS_FE_MSK;
+    }
+    xUart.rx = pxByte->byte;
+    xUart.rrdy = 1;
+}
+
+uint32_t ulSimUartRead(uint32_t base, uint32_t reg) {
+    (void)base;
+    if (reg == SIM_UART_RXDATA) {
+        xUart.rrdy = 0;
+        return xUart.rx;
+    }
+    return reg == SIM_UART_STATUS ? ulUartStatus() : 0;
+}
+
+void vSimUartWrite(uint32_t base, uint32_t reg, uint32_t value) {
+    (void)base;
+    switch (reg) {
+    case SIM_UART_TXDATA:
+        xUart.hold = (uint8_t)value;
+        xUart.holding = 1;
+        vUartShift();
+        break;
+    case SIM_UART_STATUS:
+        xUart.errors = 0;
+        break;
+    case SIM_UART_CONTROL:
+        xUart.control = value;
+        break;
+    default:
+        break;
+    }
+}
+
+/* The handler for as long as the UART holds its interrupt up */
+static void vSimInterrupt(void) {
+    uint32_t status, i;
+
+    for (i = 0; i < SIM_ISR_RUNS && pxHandler != NULL; i++) {
+        status = ulUartStatus();
+        if (!(status & xUart.control & SIM_UART_SOURCES) &&
+            !(xUart.errors && (xUart.control & ALTERA_AVALON_UART_CONTROL_E_MSK))) {
+            break;
+        }
+        pxHandler(pvHandlerContext);
+    }
+}
+
+static uint32_t ulNowMs(void) {
+    return (uint32_t)(ullSimNodeClock(xConfig.offset, xConfig.drift_ppb, ullNow) / (SIM_COUNTS_PER_US * 1000ULL));
+}
+
+/* The coordination task as vCoordTask runs it, then the time sync task */
+static void vSimTasks(void) {
+    CoordStatus_t status;
+    int stage;
+
+    if (xCoordTask.notified || ullNow >= ullServiceAt) {
+        xCoordTask.notified = 0;
+        status = ullNow >= xConfig.event_at ? xConfig.after : xConfig.before;
+        stage = xCoordStage(ulNowMs());
+        status.stage = (uint8_t)(stage < 0 ? 0 : stage);
+        vCoordService(&status, ulNowMs());
+        ullServiceAt = ullNow + COORD_PERIOD_MS * 1000ULL * SIM_COUNTS_PER_US;
+        vSimInterrupt();
+    }
+    if (xSyncTask.notified) {
+        xSyncTask.notified = 0;
+        vTimeSyncService();
+    }
+}
+
+/* The assignment and the synced time against what they should be */
+static void vSimTrack(void) {
+    TimeSyncStats_t sync;
+    uint64_t leader;
+    int64_t error;
+    uint32_t error_us;
+    int stage = xCoordStage(ulNowMs());
+
+    if (stage >= 0 && xReport.joined_at < 0) {
+        xReport.joined_at = (int64_t)ullNow;
+    }
+    if (ullNow >= xConfig.event_at) {
+        if (stage == xConfig.expected && !xRight) {
+            xRight = 1;
+            xReport.settled_at = (int64_t)(ullNow - xConfig.event_at);
+            if (xReport.first_at < 0) {
+                xReport.first_at = xReport.settled_at;
+            }
+        } else if (stage != xConfig.expected) {
+            xRight = 0;
+        }
+    }
+
+    if (xConfig.node != COORD_LEADER) {
+        vTimeSyncGetStats(&sync);
+        if (sync.locked) {
+            leader = ullSimNodeClock(xConfig.leader_offset, xConfig.leader_drift_ppb, ullNow);
+            error = (int64_t)(ullTimeSynced() - leader) / SIM_COUNTS_PER_US;
+            error_us = (uint32_t)(error < 0 ? -error : error);
+            if (error_us > xReport.sync_worst_us) {
+                xReport.sync_worst_us = error_us;
+            }
+        }
+    }
+}
+
+void vSimNodeInit(const SimNodeConfig_t *pxConfig) {
+    xConfig = *pxConfig;
+    ullNow = 0;
+    memset(&xUart, 0, sizeof(xUart));
+    memset(&xReport, 0, sizeof(xReport));
+    xReport.joined_at = -1;
+    xReport.first_at = -1;
+    xReport.settled_at = -1;
+    xRight = 0;
+
+    vLatencyInit();
+    vTimeBaseInit();
+    vTimeSyncInit(&xSyncTask);
+    (void)xCoordInit(xConfig.node, &xCoordTask);
+    ullServiceAt = 0;
+}
+
+uint64_t ullSimNodeRun(uint64_t end, const SimByte_t *pxRx, uint32_t rx_count, SimByte_t *pxTx, uint32_t tx_max,
+                       uint32_t *pulTxCount) {
+    uint32_t next = 0;
+    uint64_t at;
+
+    xUart.pxTx = pxTx;
+    xUart.tx_count = 0;
+    xUart.tx_max = tx_max;
+    for (;;) {
+        at = ullServiceAt;
+        if (next < rx_count && pxRx[next].at < at) {
+            at = pxRx[next].at;
+        }
+        if (xUart.shift_end > ullNow && xUart.shift_end < at) {
+            at = xUart.shift_end;
+        }
+        if (at >= end) {
+            break;
+        }
+
+        ullNow = at;
+        while (next < rx_count && pxRx[next].at <= ullNow) {
+            vUartReceive(&pxRx[next++]);
+        }
+        vUartShift();
+        vTimeBaseTick();
+        vSimInterrupt();
+        vSimTasks();
+        vSimTrack();
+    }
+
+    *pulTxCount = xUart.tx_count;
+    at = ullServiceAt;
+    if (xUart.shift_end > ullNow && xUart.shift_end < at) {
+        at = xUart.shift_end;
+    }
+    return at;
+}
+
+void vSimNodeReport(SimNodeReport_t *pxReport) {
+    *pxReport = xReport;
+    vCoordGetStats(&pxReport->coord);
+    vTimeSyncGetStats(&pxReport->sync);
+    pxReport->stage = xCoordStage(ulNowMs());
+    if (!xRight) {
+        pxReport->settled_at = -1;
+    }
+}
@@ -0,0 +1,79 @@
+/**
+ * One relay of the host ring simulation
+ *
+ * Runs the target's coordination (coord.c) and time sync (time_sync.c)
+ * sources unchanged over a model of the altera_avalon_uart: a receive data
+ * register, a transmit holding register ahead of the shift register, and
+ * the interrupt on RRDY, TRDY, TMT and the line errors as the core raises
+ * it. Their state is file static, so it takes a process to a relay, and
+ * coord_sim.c forks one for each.
+ *
+ * The interrupt handler runs as soon as the UART raises it, and until it
+ * lowers it. The coordination task runs straight after an interrupt that
+ * notified it, and COORD_PERIOD_MS after it last ran otherwise, as
+ * ulTaskNotifyTake in vCoordTask has it; the time sync task straight after
+ * each sample. Neither takes any time.
+ *
+ * Line times are in SIM_COUNTS_PER_US counts from the simulation's start.
+ * Each relay's timestamp timer runs from the line clock with its own
+ * offset and drift, so that time sync has something to find.
+ */
+
+#ifndef SIM_COORD_NODE_H
+#define SIM_COORD_NODE_H
+
+#include <stdint.h>
+
+#include "coord.h"
+#include "time_sync.h"
+
+#define SIM_COUNTS_PER_US              100     // ALT_TIMESTAMP_CLK on the board
+
+/* A character on the line */
+typedef struct {
+    uint64_t at;                       // Sent: its start bit. Arriving: its stop bit, received.
+    uint8_t byte;
+    uint8_t error;                     // Arrives with a framing error
+} SimByte_t;
+
+typedef struct {
+    uint8_t node;
+    uint64_t byte_counts;              // A character's time on the line
+    uint32_t offset;                   // Timestamp timer at the start
+    int32_t drift_ppb;                 // Its rate against the line clock
+    uint32_t leader_offset;            // The same for node 0, to check time sync against
+    int32_t leader_drift_ppb;
+    uint64_t event_at;                 // When the status goes from before to after
+    CoordStatus_t before;
+    CoordStatus_t after;
+    int expected;                      // The stage the leader should assign after the event
+} SimNodeConfig_t;
+
+typedef struct {
+    CoordStats_t coord;
+    TimeSyncStats_t sync;
+    uint32_t sent;                     // Characters put on the line
+    uint32_t sync_worst_us;            // Synced time against the leader's clock, once locked
+    int64_t joined_at;                 // First fresh assignment, -1 for none
+    int64_t first_at;                  // From the event: first assigned the expected stage, -1 for never
+    int64_t settled_at;                // From the event: last came to it, -1 if not on it at the end
+    int stage;                         // xCoordStage() at the end
+} SimNodeReport_t;
+
+/* Boot the relay at line time 0 */
+void vSimNodeInit(const SimNodeConfig_t *pxConfig);
+
+/* Run the relay until end, the characters in pxRx arriving at their times
+ * (in order, all before end). The characters it starts sending go to pxTx,
+ * which has room for tx_max, their count to *pulTxCount. Returns the line
+ * time of the next thing the relay does if nothing more arrives. */
+uint64_t ullSimNodeRun(uint64_t end, const SimByte_t *pxRx, uint32_t rx_count, SimByte_t *pxTx, uint32_t tx_max,
+                       uint32_t *pulTxCount);
+
+void vSimNodeReport(SimNodeReport_t *pxReport);
+
+/* The relay's timestamp timer at line time at, 64 bits as ullTimeNow()
+ * extends it */
+uint64_t ullSimNodeClock(uint32_t offset, int32_t drift_ppb, uint64_t at);
+
+#endif /* SIM_COORD_NODE_H */
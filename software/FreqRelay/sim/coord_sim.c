@@ -0,0 +1,453 @@
+/**
+ * Host simulation of a coordination ring
+ *
+ * Runs COORD_NODES relays, each the target's coord.c and time_sync.c in a
+ * process of its own (coord_node.h), on a simulated daisy chain: every
+ * character a relay's UART starts sending reaches the next relay's a
+ * character time and the link's latency later, unless the link loses or
+ * corrupts it. The ring size is the build's, so each size is its own
+ * binary:
+ *
+ *   make -C sim coord_sim_50
+ *   sim/coord_sim_50                          # 115200 baud, 5 s, an event at 1 s
+ *   sim/coord_sim_50 -b 460800 -d 200 -J 50   # faster links, 200..250 us latency each
+ *   sim/coord_sim_50 -l 1e-4 -e 1e-4 -q       # lossy links, summary only
+ *   make -C sim coord_sim_50 COORD_CFLAGS=-DCOORD_PERIOD_MS=250
+ *
+ * The island is at 50 Hz until the event, then every relay reads -f Hz
+ * falling at -r Hz/s against a lower limit of -L Hz. Each relay's stages
+ * take off 1 to -w kW each, drawn from -s, and its timestamp oscillator is
+ * off by up to -D ppm. A CSV row per relay goes to stdout (not with -q)
+ * and a summary to stderr.
+ *
+ * Converged is when every relay has been assigned the stage the leader's
+ * search gives for the island after the event and stays so to the end of
+ * the run. Load is the busiest link's share of its character times, and
+ * the frames each relay takes in a second.
+ *
+ * The relays run in lockstep rounds of one character time plus the
+ * shortest link latency, the least a character takes from one relay to
+ * the next, so none can be sent in a round and arrive in it. Rounds in
+ * which nothing would happen are skipped.
+ */
+
+/* Standard includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Application includes */
+#include "coord.h"
+#include "coord_node.h"
+#include "fix16.h"
+#include "prng.h"
+
+#define SIM_BAUD                       115200
+#define SIM_CHAR_BITS                  10      // 8N1
+#define SIM_DURATION_S                 5.0
+#define SIM_EVENT_S                    1.0
+#define SIM_NOMINAL_FREQ               50.0
+#define SIM_EVENT_FREQ                 48.0
+#define SIM_EVENT_ROC                  -1.0
+#define SIM_LOWER_LIMIT                48.5    // NOMINAL_FREQ - FREQ_TOLERANCE
+#define SIM_STAGE_KW                   10
+#define SIM_DRIFT_PPM                  50
+
+/* A round's request to a relay (end 0: report and exit) and its answer,
+ * each followed by its characters */
+typedef struct {
+    uint64_t end;
+    uint32_t count;
+} SimRequest_t;
+
+typedef struct {
+    uint64_t next;
+    uint32_t count;
+} SimAnswer_t;
+
+/* A relay and the link into it */
+typedef struct {
+    SimNodeConfig_t config;
+    pid_t pid;
+    int to_fd;
+    int from_fd;
+    uint64_t latency;                  // Of the link in, line counts
+    SimByte_t *pxRing;                 // Characters on their way in, in arrival order
+    uint32_t ring_size;
+    uint32_t head;
+    uint32_t tail;
+    uint64_t next;                     // Its next own activity
+    uint32_t lost;                     // On the link in
+    uint32_t corrupted;
+    SimNodeReport_t report;
+} SimRelay_t;
+
+static void vUsage(const char *pcName) {
+    fprintf(stderr, "usage: %s [-q] [-b baud] [-d latency us] [-J spread us] [-l loss] [-e errors] [-t s]\n"
+                    "       [-E event s] [-f Hz] [-r Hz/s] [-L lower Hz] [-w stage kW] [-D drift ppm] [-s seed]\n",
+            pcName);
+    exit(2);
+}
+
+static int xSimRead(int fd, void *pvBuffer, size_t len) {
+    uint8_t *pucAt = pvBuffer;
+    ssize_t got;
+
+    while (len > 0) {
+        if ((got = read(fd, pucAt, len)) <= 0) {
+            return -1;
+        }
+        pucAt += got;
+        len -= (size_t)got;
+    }
+    return 0;
+}
+
+static int xSimWrite(int fd, const void *pvBuffer, size_t len) {
+    const uint8_t *pucAt = pvBuffer;
+    ssize_t put;
+
+    while (len > 0) {
+        if ((put = write(fd, pucAt, len)) <= 0) {
+            return -1;
+        }
+        pucAt += put;
+        len -= (size_t)put;
+    }
+    return 0;
+}
+
+/* A relay's process: rounds until told to report */
+static void vSimRelayMain(const SimRelay_t *pxRelay, uint32_t chars) {
+    SimRequest_t request;
+    SimAnswer_t answer;
+    SimNodeReport_t report;
+    SimByte_t *pxRx = calloc(chars, sizeof(SimByte_t)), *pxTx = calloc(chars, sizeof(SimByte_t));
+
+    if (pxRx == NULL || pxTx == NULL) {
+        _exit(1);
+    }
+    vSimNodeInit(&pxRelay->config);
+    for (;;) {
+        if (xSimRead(pxRelay->to_fd, &request, sizeof(request)) != 0 || request.count > chars ||
+            xSimRead(pxRelay->to_fd, pxRx, request.count * sizeof(SimByte_t)) != 0) {
+            _exit(1);
+        }
+        if (request.end == 0) {
+            vSimNodeReport(&report);
+            _exit(xSimWrite(pxRelay->from_fd, &report, sizeof(report)) == 0 ? 0 : 1);
+        }
+        answer.next = ullSimNodeRun(request.end, pxRx, request.count, pxTx, chars, &answer.count);
+        if (xSimWrite(pxRelay->from_fd, &answer, sizeof(answer)) != 0 ||
+            xSimWrite(pxRelay->from_fd, pxTx, answer.count * sizeof(SimByte_t)) != 0) {
+            _exit(1);
+        }
+    }
+}
+
+/* The leader's requirement for the island after the event, as vCoordLead
+ * works it out: the lowest of its own reading and the others' as their
+ * status frames carry them, in mHz and 0.01 Hz/s */
+static uint32_t ulSimRequired(const CoordStatus_t *pxAfter) {
+    fix16_t freq = pxAfter->freq, roc = pxAfter->roc, heard_freq, heard_roc, deficit;
+    int64_t required = 0;
+
+    heard_freq = freq <= 0 ? 0 : (fix16_t)(((uint32_t)(((int64_t)freq * 1000) >> FIX16_SHIFT) << FIX16_SHIFT) / 1000);
+    heard_roc = (fix16_t)(((int32_t)(int16_t)(((int64_t)roc * 100) >> FIX16_SHIFT) << FIX16_SHIFT) / 100);
+    if (heard_freq < freq) {
+        freq = heard_freq;
+        roc = heard_roc;
+    }
+    deficit = pxAfter->lower_limit - freq;
+    if (deficit > 0) {
+        required += (int64_t)deficit * COORD_KW_PER_HZ;
+    }
+    if (roc < 0) {
+        required -= (int64_t)roc * COORD_KW_PER_HZ_S;
+    }
+    return (uint32_t)((required + FIX16_ONE - 1) >> FIX16_SHIFT);
+}
+
+static double dSimMs(int64_t counts) {
+    return counts / (SIM_COUNTS_PER_US * 1000.0);
+}
+
+int main(int argc, char **argv) {
+    static SimRelay_t xRelays[COORD_NODES];
+    static uint16_t usKw[COORD_NODES][COORD_STAGES];
+    uint8_t live[COORD_NODES], stages[COORD_NODES];
+    SimRequest_t request;
+    SimAnswer_t answer;
+    SimByte_t *pxBuffer, *pxByte;
+    SimRelay_t *pxRelay, *pxNext;
+    CoordStatus_t before, after;
+    Prng_t prng;
+    struct timespec start, finish;
+    uint32_t baud = SIM_BAUD, seed = 1, stage_kw = SIM_STAGE_KW, required, assigned, chars, n, k, i, bit;
+    uint32_t chars_lost = 0, chars_corrupted = 0, off = 0, dropped = 0, lost = 0, crc = 0, line = 0;
+    uint32_t round_trip = 0, sync_worst = 0, locked = 0, sent = 0;
+    uint64_t byte_counts, quantum, duration, t0, t1, next, rounds = 0, frames = 0;
+    int64_t converged = 0, first = 0, joined = 0;
+    double latency_us = 0.0, spread_us = 0.0, loss = 0.0, errors = 0.0, duration_s = SIM_DURATION_S;
+    double event_s = SIM_EVENT_S, drift_ppm = SIM_DRIFT_PPM, host_s, busiest;
+    int quiet = 0, option, pipes[2][2];
+
+    memset(&after, 0, sizeof(after));
+    after.freq = FIX16_CONST(SIM_EVENT_FREQ);
+    after.roc = FIX16_CONST(SIM_EVENT_ROC);
+    after.lower_limit = FIX16_CONST(SIM_LOWER_LIMIT);
+    while ((option = getopt(argc, argv, "qb:d:J:l:e:t:E:f:r:L:w:D:s:")) != -1) {
+        switch (option) {
+        case 'q': quiet = 1; break;
+        case 'b': baud = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 'd': latency_us = atof(optarg); break;
+        case 'J': spread_us = atof(optarg); break;
+        case 'l': loss = atof(optarg); break;
+        case 'e': errors = atof(optarg); break;
+        case 't': duration_s = atof(optarg); break;
+        case 'E': event_s = atof(optarg); break;
+        case 'f': after.freq = FIX16_CONST(atof(optarg)); break;
+        case 'r': after.roc = FIX16_CONST(atof(optarg)); break;
+        case 'L': after.lower_limit = FIX16_CONST(atof(optarg)); break;
+        case 'w': stage_kw = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 'D': drift_ppm = atof(optarg); break;
+        case 's': seed = (uint32_t)strtoul(optarg, NULL, 0); break;
+        default: vUsage(argv[0]);
+        }
+    }
+    if (optind < argc || baud < 1200 || latency_us < 0.0 || spread_us < 0.0 || duration_s <= 0.0 ||
+        stage_kw < 1 || stage_kw > 65535) {
+        vUsage(argv[0]);
+    }
+
+    byte_counts = (uint64_t)SIM_CHAR_BITS * 1000000ULL * SIM_COUNTS_PER_US / baud;
+    quantum = byte_counts + (uint64_t)(latency_us * SIM_COUNTS_PER_US);
+    duration = (uint64_t)(duration_s * 1e6 * SIM_COUNTS_PER_US);
+    chars = (uint32_t)(quantum / byte_counts) + 2;
+    before = after;
+    before.freq = FIX16_CONST(SIM_NOMINAL_FREQ);
+    before.roc = 0;
+    before.flags = after.flags = COORD_FLAG_STABLE;
+
+    /* The island: each relay's stages and oscillator, and what the leader
+     * should make of them */
+    vPrngSeed(&prng, seed * 0x9E3779B9UL);
+    for (n = 0; n < COORD_NODES; n++) {
+        pxRelay = &xRelays[n];
+        pxRelay->config.node = (uint8_t)n;
+        pxRelay->config.byte_counts = byte_counts;
+        pxRelay->config.offset = ulPrngNext(&prng);
+        pxRelay->config.drift_ppb = (int32_t)((ulPrngBelow(&prng, 65536) / 32768.0 - 1.0) * drift_ppm * 1000.0);
+        pxRelay->config.event_at = (uint64_t)(event_s * 1e6 * SIM_COUNTS_PER_US);
+        pxRelay->config.before = before;
+        pxRelay->config.after = after;
+        for (k = 0; k < COORD_STAGES; k++) {
+            usKw[n][k] = (uint16_t)(1 + ulPrngBelow(&prng, stage_kw));
+        }
+        memcpy(pxRelay->config.before.stage_kw, usKw[n], sizeof(usKw[n]));
+        memcpy(pxRelay->config.after.stage_kw, usKw[n], sizeof(usKw[n]));
+        pxRelay->latency = (uint64_t)((latency_us + spread_us * ulPrngBelow(&prng, 65536) / 65536.0) * SIM_COUNTS_PER_US);
+        pxRelay->ring_size = (uint32_t)(pxRelay->latency / byte_counts) + 2 * chars + 4;
+        pxRelay->pxRing = calloc(pxRelay->ring_size, sizeof(SimByte_t));
+        if (pxRelay->pxRing == NULL) {
+            fprintf(stderr, "no memory for the links\n");
+            return 1;
+        }
+        live[n] = 1;
+    }
+    required = ulSimRequired(&after);
+    assigned = ulCoordAssign((const uint16_t (*)[COORD_STAGES])usKw, live, COORD_NODES, required, stages);
+    for (n = 0; n < COORD_NODES; n++) {
+        xRelays[n].config.leader_offset = xRelays[COORD_LEADER].config.offset;
+        xRelays[n].config.leader_drift_ppb = xRelays[COORD_LEADER].config.drift_ppb;
+        xRelays[n].config.expected = stages[n];
+    }
+
+    fflush(stdout);
+    for (n = 0; n < COORD_NODES; n++) {
+        pxRelay = &xRelays[n];
+        if (pipe(pipes[0]) != 0 || pipe(pipes[1]) != 0 || (pxRelay->pid = fork()) < 0) {
+            perror("relay");
+            return 1;
+        }
+        if (pxRelay->pid == 0) {
+            for (k = 0; k < n; k++) {
+                close(xRelays[k].to_fd);
+                close(xRelays[k].from_fd);
+            }
+            close(pipes[0][1]);
+            close(pipes[1][0]);
+            pxRelay->to_fd = pipes[0][0];
+            pxRelay->from_fd = pipes[1][1];
+            vSimRelayMain(pxRelay, chars);
+        }
+        close(pipes[0][0]);
+        close(pipes[1][1]);
+        pxRelay->to_fd = pipes[0][1];
+        pxRelay->from_fd = pipes[1][0];
+    }
+
+    pxBuffer = calloc(chars, sizeof(SimByte_t));
+    if (pxBuffer == NULL) {
+        fprintf(stderr, "no memory for a round\n");
+        return 1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (t0 = 0; t0 < duration; rounds++) {
+        t1 = t0 + quantum < duration ? t0 + quantum : duration;
+
+        /* Every relay gets what arrives in the round, then runs it */
+        for (n = 0; n < COORD_NODES; n++) {
+            pxRelay = &xRelays[n];
+            request.end = t1;
+            for (request.count = 0; pxRelay->tail != pxRelay->head; request.count++) {
+                pxByte = &pxRelay->pxRing[pxRelay->tail % pxRelay->ring_size];
+                if (pxByte->at >= t1) {
+                    break;
+                }
+                pxBuffer[request.count] = *pxByte;
+                pxRelay->tail++;
+            }
+            if (xSimWrite(pxRelay->to_fd, &request, sizeof(request)) != 0 ||
+                xSimWrite(pxRelay->to_fd, pxBuffer, request.count * sizeof(SimByte_t)) != 0) {
+                fprintf(stderr, "relay %u has gone\n", n);
+                return 1;
+            }
+        }
+
+        /* What each sent goes down the link to the next */
+        next = duration;
+        for (n = 0; n < COORD_NODES; n++) {
+            pxRelay = &xRelays[n];
+            pxNext = &xRelays[(n + 1) % COORD_NODES];
+            if (xSimRead(pxRelay->from_fd, &answer, sizeof(answer)) != 0 || answer.count > chars ||
+                xSimRead(pxRelay->from_fd, pxBuffer, answer.count * sizeof(SimByte_t)) != 0) {
+                fprintf(stderr, "relay %u has gone\n", n);
+                return 1;
+            }
+            for (i = 0; i < answer.count; i++) {
+                pxByte = &pxBuffer[i];
+                if (loss > 0.0 && ulPrngNext(&prng) / 4294967296.0 < loss) {
+                    pxNext->lost++;
+                    continue;
+                }
+                if (errors > 0.0 && ulPrngNext(&prng) / 4294967296.0 < errors) {
+                    /* A data bit flips, or the start or stop bit and the
+                     * character is misframed */
+                    bit = ulPrngBelow(&prng, SIM_CHAR_BITS);
+                    if (bit >= 1 && bit <= 8) {
+                        pxByte->byte ^= (uint8_t)(1 << (bit - 1));
+                    } else {
+                        pxByte->error = 1;
+                    }
+                    pxNext->corrupted++;
+                }
+                if (pxNext->head - pxNext->tail < pxNext->ring_size) {
+                    pxByte->at += byte_counts + pxNext->latency;
+                    pxNext->pxRing[pxNext->head++ % pxNext->ring_size] = *pxByte;
+                }
+            }
+            pxRelay->next = answer.next;
+            if (answer.next < next) {
+                next = answer.next;
+            }
+        }
+        for (n = 0; n < COORD_NODES; n++) {
+            pxRelay = &xRelays[n];
+            if (pxRelay->tail != pxRelay->head && pxRelay->pxRing[pxRelay->tail % pxRelay->ring_size].at < next) {
+                next = pxRelay->pxRing[pxRelay->tail % pxRelay->ring_size].at;
+            }
+        }
+        t0 = next > t1 ? next : t1;
+    }
+
+    request.end = 0;
+    request.count = 0;
+    for (n = 0; n < COORD_NODES; n++) {
+        pxRelay = &xRelays[n];
+        if (xSimWrite(pxRelay->to_fd, &request, sizeof(request)) != 0 ||
+            xSimRead(pxRelay->from_fd, &pxRelay->report, sizeof(pxRelay->report)) != 0) {
+            fprintf(stderr, "relay %u has gone\n", n);
+            return 1;
+        }
+    }
+    while (wait(NULL) > 0) {
+    }
+    clock_gettime(CLOCK_MONOTONIC, &finish);
+    host_s = (double)(finish.tv_sec - start.tv_sec) + (double)(finish.tv_nsec - start.tv_nsec) / 1e9;
+
+    if (!quiet) {
+        printf("node,kw1,kw2,kw3,expected,stage,joined_ms,first_ms,settled_ms,frames,forwarded,dropped,lost,"
+               "crc_errors,line_errors,round_trip_max_us,link_us,time_samples,sync_error_us,sync_locked,sync_worst_us,sent\n");
+    }
+    busiest = 0.0;
+    for (n = 0; n < COORD_NODES; n++) {
+        SimNodeReport_t *pxReport = &xRelays[n].report;
+
+        if (!quiet) {
+            printf("%u,%u,%u,%u,%d,%d,%.1f,%.1f,%.1f,%u,%u,%u,%u,%u,%u,%u,%u,%u,%d,%u,%u,%u\n", n, usKw[n][0], usKw[n][1],
+                   usKw[n][2], xRelays[n].config.expected, pxReport->stage, dSimMs(pxReport->joined_at),
+                   dSimMs(pxReport->first_at), dSimMs(pxReport->settled_at), pxReport->coord.frames,
+                   pxReport->coord.forwarded, pxReport->coord.dropped, pxReport->coord.lost,
+                   pxReport->coord.crc_errors, pxReport->coord.line_errors, pxReport->coord.round_trip_max_us,
+                   pxReport->coord.link_us, pxReport->coord.time_samples, (int)pxReport->sync.error_us,
+                   pxReport->sync.locked, pxReport->sync_worst_us, pxReport->sent);
+        }
+        if (pxReport->settled_at < 0) {
+            off++;
+        } else if (pxReport->settled_at > converged) {
+            converged = pxReport->settled_at;
+        }
+        if (first >= 0) {
+            first = pxReport->first_at < 0 || pxReport->first_at > first ? pxReport->first_at : first;
+        }
+        if (joined >= 0) {
+            joined = pxReport->joined_at < 0 || pxReport->joined_at > joined ? pxReport->joined_at : joined;
+        }
+        if (pxReport->sent * (double)byte_counts / duration > busiest) {
+            busiest = pxReport->sent * (double)byte_counts / duration;
+        }
+        frames += pxReport->coord.frames;
+        sent += pxReport->sent;
+        chars_lost += xRelays[n].lost;
+        chars_corrupted += xRelays[n].corrupted;
+        dropped += pxReport->coord.dropped;
+        lost += pxReport->coord.lost;
+        crc += pxReport->coord.crc_errors;
+        line += pxReport->coord.line_errors;
+        if (pxReport->coord.round_trip_max_us > round_trip) {
+            round_trip = pxReport->coord.round_trip_max_us;
+        }
+        if (n != COORD_LEADER) {
+            locked += pxReport->sync.locked;
+            if (pxReport->sync_worst_us > sync_worst) {
+                sync_worst = pxReport->sync_worst_us;
+            }
+        }
+    }
+
+    fprintf(stderr, "%u relays at %u baud, %.1f s in %.2f s host time over %llu rounds\n", COORD_NODES, baud,
+            duration_s, host_s, (unsigned long long)rounds);
+    fprintf(stderr, "after the event: %u kW required, %u kW over the expected stages\n", required, assigned);
+    if (off == 0) {
+        fprintf(stderr, "converged %.1f ms after the event, every relay first on its stage by %.1f ms\n",
+                dSimMs(converged), dSimMs(first));
+    } else {
+        fprintf(stderr, "not converged: %u relays off their stage at the end\n", off);
+    }
+    if (joined >= 0) {
+        fprintf(stderr, "every relay assigned by %.1f ms from the start\n", dSimMs(joined));
+    }
+    fprintf(stderr, "load: busiest link %.1f%%, mean %.1f%%, %.1f frames a second into each relay\n",
+            busiest * 100.0, sent * (double)byte_counts / duration / COORD_NODES * 100.0,
+            frames / duration_s / COORD_NODES);
+    fprintf(stderr, "links lost %u and corrupted %u characters; frames dropped %u, lost %u, CRC errors %u, "
+            "line errors %u; round trip %u us at most\n", chars_lost, chars_corrupted, dropped, lost, crc, line,
+            round_trip);
+    fprintf(stderr, "time sync within %u us once locked, %u of %u relays locked\n", sync_worst, locked,
+            COORD_NODES - 1);
+    return off == 0 ? 0 : 1;
+}
@@ -0,0 +1,45 @@
+/**
+ * Host stand-in for the altera_avalon_uart registers
+ *
+ * The register accesses go to the UART model in coord_node.c. Bit
+ * positions as the core's.
+ */
+
+#ifndef SIM_ALTERA_AVALON_UART_REGS_H
+#define SIM_ALTERA_AVALON_UART_REGS_H
+
+#include <stdint.h>
+
+#define SIM_UART_RXDATA                0
+#define SIM_UART_TXDATA                1
+#define SIM_UART_STATUS                2
+#define SIM_UART_CONTROL               3
+
+uint32_t ulSimUartRead(uint32_t base, uint32_t reg);
+void vSimUartWrite(uint32_t base, uint32_t reg, uint32_t value);
+
+#define IORD_ALTERA_AVALON_UART_RXDATA(base)         ulSimUartRead(base, SIM_UART_RXDATA)
+#define IOWR_ALTERA_AVALON_UART_TXDATA(base, data)   vSimUartWrite(base, SIM_UART_TXDATA, data)
+#define IORD_ALTERA_AVALON_UART_STATUS(base)         ulSimUartRead(base, SIM_UART_STATUS)
+#define IOWR_ALTERA_AVALON_UART_STATUS(base, data)   vSimUartWrite(base, SIM_UART_STATUS, data)
+#define IOWR_ALTERA_AVALON_UART_CONTROL(base, data)  vSimUartWrite(base, SIM_UART_CONTROL, data)
+
+#define ALTERA_AVALON_UART_STATUS_PE_MSK             0x0001
+#define ALTERA_AVALON_UART_STATUS_FE_MSK             0x0002
+#define ALTERA_AVALON_UART_STATUS_BRK_MSK            0x0004
+#define ALTERA_AVALON_UART_STATUS_ROE_MSK            0x0008
+#define ALTERA_AVALON_UART_STATUS_TOE_MSK            0x0010
+#define ALTERA_AVALON_UART_STATUS_TMT_MSK            0x0020
+#define ALTERA_AVALON_UART_STATUS_TRDY_MSK           0x0040
+#define ALTERA_AVALON_UART_STATUS_RRDY_MSK           0x0080
+#define ALTERA_AVALON_UART_STATUS_E_MSK              0x0100
+
+#define ALTERA_AVALON_UART_CONTROL_PE_MSK            0x0001
+#define ALTERA_AVALON_UART_CONTROL_FE_MSK            0x0002
+#define ALTERA_AVALON_UART_CONTROL_ROE_MSK           0x0008
+#define ALTERA_AVALON_UART_CONTROL_TMT_MSK           0x0020
+#define ALTERA_AVALON_UART_CONTROL_TRDY_MSK          0x0040
+#define ALTERA_AVALON_UART_CONTROL_RRDY_MSK          0x0080
+#define ALTERA_AVALON_UART_CONTROL_E_MSK             0x0100
+
+#endif /* SIM_ALTERA_AVALON_UART_REGS_H */
@@ -0,0 +1,83 @@
+/**
+ * Host stand-in for the application's board I/O
+ *
+ * ../board_io.h includes this one when BOARD_IO_HOST is defined: the same
+ * functions over xSimBoard, which the simulation sets and checks. Outputs
+ * land in it, inputs are read from it. See sim_hal.c.
+ */
+
+#ifndef SIM_BOARD_IO_HOST_H
+#define SIM_BOARD_IO_HOST_H
+
+#include <stdint.h>
+#include "load_mask.h"
+
+typedef struct {
+    LoadMask_t loads;                  // Last written to the load outputs
+    LoadMask_t feedback;               // Actuator feedback inputs
+    int feedback_wired;                // 0: the feedback follows the outputs
+    uint32_t switches;
+    uint32_t status_leds;
+    uint32_t button_mask;
+    uint32_t button_edges;             // Captured, cleared as they are read
+    uint32_t freq_period;              // Count every analyser read returns
+    uint32_t freq_level;
+    uint32_t freq_threshold;
+    int freq_overflow;
+} SimBoard_t;
+
+extern SimBoard_t xSimBoard;
+
+static inline void vBoardLoadPortOut(uint32_t port, uint16_t bits) {
+    xSimBoard.loads = (xSimBoard.loads & ~((LoadMask_t)LOAD_PORT_MASK << (port * LOAD_PORT_BITS))) |
+                      (LoadMask_t)bits << (port * LOAD_PORT_BITS);
+}
+
+static inline LoadMask_t xBoardLoadFeedback(LoadMask_t driven) {
+    return xSimBoard.feedback_wired ? xSimBoard.feedback : driven;
+}
+
+static inline uint32_t ulBoardSwitches(void) {
+    return xSimBoard.switches;
+}
+
+static inline void vBoardStatusLeds(uint32_t pattern) {
+    xSimBoard.status_leds = pattern;
+}
+
+static inline void vBoardButtonsInit(uint32_t mask) {
+    xSimBoard.button_mask = mask;
+    xSimBoard.button_edges &= ~mask;
+}
+
+static inline uint32_t ulBoardButtonEdges(uint32_t mask) {
+    uint32_t edges = xSimBoard.button_edges & mask;
+
+    xSimBoard.button_edges &= ~edges;
+    return edges;
+}
+
+static inline uint32_t ulBoardFreqPeriod(uint32_t base) {
+    (void)base;
+    return xSimBoard.freq_period;
+}
+
+static inline uint32_t ulBoardFreqLevel(uint32_t base) {
+    (void)base;
+    return xSimBoard.freq_level;
+}
+
+static inline void vBoardFreqThreshold(uint32_t base, uint32_t level) {
+    (void)base;
+    xSimBoard.freq_threshold = level;
+}
+
+static inline int xBoardFreqOverflow(uint32_t base) {
+    int overflow = xSimBoard.freq_overflow;
+
+    (void)base;
+    xSimBoard.freq_overflow = 0;
+    return overflow;
+}
+
+#endif /* SIM_BOARD_IO_HOST_H */
@@ -0,0 +1,32 @@
+/**
+ * Host stand-in for the kernel's FreeRTOS.h
+ *
+ * Only what the coordination sources built by sim/Makefile use: one relay
+ * to a process, its coordination task and UART interrupt run in turn by
+ * coord_node.c, so a critical section has nothing to hold off.
+ */
+
+#ifndef SIM_FREERTOS_H
+#define SIM_FREERTOS_H
+
+#include <stdint.h>
+
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE                        ((BaseType_t)0)
+#define pdTRUE                         ((BaseType_t)1)
+#define pdPASS                         pdTRUE
+#define pdFAIL                         pdFALSE
+
+#define configMAX_SYSCALL_INTERRUPT_PRIORITY 1
+
+#define portYIELD_FROM_ISR(x)          ((void)(x))
+
+static inline void vPortSetIrqPriority(uint32_t ulIrq, UBaseType_t uxPriority) {
+    (void)ulIrq;
+    (void)uxPriority;
+}
+
+#endif /* SIM_FREERTOS_H */
@@ -0,0 +1,20 @@
+/**
+ * Host stand-in for the kernel's task.h
+ *
+ * A notification only marks the task to run, see coord_node.c.
+ */
+
+#ifndef SIM_TASK_H
+#define SIM_TASK_H
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct SimTask *TaskHandle_t;
+
+#define taskENTER_CRITICAL()
+#define taskEXIT_CRITICAL()
+
+void vTaskNotifyGiveFromISR(TaskHandle_t xTask, BaseType_t *pxHigherPriorityTaskWoken);
+BaseType_t xTaskNotifyGive(TaskHandle_t xTask);
+
+#endif /* SIM_TASK_H */
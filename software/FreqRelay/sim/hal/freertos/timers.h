@@ -0,0 +1,12 @@
+/**
+ * Host stand-in for the kernel's timers.h
+ */
+
+#ifndef SIM_TIMERS_H
+#define SIM_TIMERS_H
+
+#include "freertos/FreeRTOS.h"
+
+typedef void (*PendedFunction_t)(void *, uint32_t);
+
+#endif /* SIM_TIMERS_H */
@@ -0,0 +1,27 @@
+/**
+ * Host stand-in for the HAL flash API
+ *
+ * Reads come from the images given to vSimFlashLoad(), everything else
+ * reads as erased flash. See sim_hal.c.
+ */
+
+#ifndef SIM_ALT_FLASH_H
+#define SIM_ALT_FLASH_H
+
+typedef struct alt_flash_fd alt_flash_fd;
+
+typedef struct flash_region {
+    int offset;
+    int region_size;
+    int number_of_blocks;
+    int block_size;
+} flash_region;
+
+alt_flash_fd *alt_flash_open_dev(const char *name);
+void alt_flash_close_dev(alt_flash_fd *fd);
+int alt_read_flash(alt_flash_fd *fd, int offset, void *dest_addr, int length);
+
+/* Place the contents of a file at a flash offset. Returns 0 on success. */
+int xSimFlashLoad(const char *path, int offset);
+
+#endif /* SIM_ALT_FLASH_H */
@@ -0,0 +1,18 @@
+/**
+ * Host stand-in for the HAL timestamp driver
+ *
+ * The relay's own clock in a ring simulation, see coord_node.c.
+ */
+
+#ifndef SIM_ALT_TIMESTAMP_H
+#define SIM_ALT_TIMESTAMP_H
+
+#include <stdint.h>
+
+typedef uint32_t alt_timestamp_type;
+
+int alt_timestamp_start(void);
+alt_timestamp_type alt_timestamp(void);
+uint32_t alt_timestamp_freq(void);
+
+#endif /* SIM_ALT_TIMESTAMP_H */
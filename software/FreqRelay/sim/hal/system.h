@@ -0,0 +1,14 @@
+/**
+ * Host stand-in for the BSP's system.h
+ *
+ * Only what the modules built by sim/Makefile use.
+ */
+
+#ifndef SIM_SYSTEM_H
+#define SIM_SYSTEM_H
+
+#define FLASH_CONTROLLER_NAME          "/dev/flash_controller"
+#define COORD_UART_BASE                0       // The UART model in coord_node.c
+#define COORD_UART_IRQ                 0
+
+#endif /* SIM_SYSTEM_H */
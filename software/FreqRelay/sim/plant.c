@@ -0,0 +1,107 @@
+/**
+ * Grid and load plant for closed-loop host replay
+ *
+ * See plant.h.
+ */
+
+/* Standard includes */
+#include <math.h>
+#include <string.h>
+
+/* Application includes */
+#include "plant.h"
+
+void vPlantDefaults(PlantParams_t *pxParams, LoadMask_t all_loads) {
+    uint32_t i;
+
+    memset(pxParams, 0, sizeof(PlantParams_t));
+    pxParams->nominal_hz = 50.0;
+    pxParams->inertia_s = 4.0;
+    pxParams->damping = 1.0;
+    pxParams->droop = 0.05;
+    pxParams->governor_s = 0.5;
+    pxParams->reserve_kw = 50.0;
+    pxParams->other_kw = 650.0;
+    for (i = 0; i < LOAD_COUNT; i++) {
+        pxParams->load_kw[i] = all_loads & xLoadBit(i) ? 50.0 : 0.0;
+    }
+    pxParams->loss_kw = 150.0;
+    pxParams->event_s = 1.0;
+    pxParams->duration_s = 20.0;
+}
+
+double dPlantLoadKw(const Plant_t *pxPlant, LoadMask_t loads) {
+    double kw = 0.0;
+
+    for (; loads != 0; loads &= loads - 1) {
+        kw += pxPlant->params.load_kw[ulLoadFirst(loads)];
+    }
+    return kw;
+}
+
+void vPlantInit(Plant_t *pxPlant, const PlantParams_t *pxParams, uint32_t clock_hz, LoadMask_t connected) {
+    memset(pxPlant, 0, sizeof(Plant_t));
+    pxPlant->params = *pxParams;
+    pxPlant->clock_hz = clock_hz;
+    pxPlant->initial = connected;
+    pxPlant->base_kw = pxParams->other_kw + dPlantLoadKw(pxPlant, connected);
+    pxPlant->hz = pxParams->nominal_hz;
+    pxPlant->pm_kw = pxPlant->base_kw;
+    pxPlant->set_kw = pxPlant->base_kw;
+    pxPlant->nadir_hz = pxParams->nominal_hz;
+}
+
+/* One step of dt with demand_kw connected */
+static void vPlantStep(Plant_t *pxPlant, double demand_kw, double dt) {
+    const PlantParams_t *pxP = &pxPlant->params;
+    double dev = (pxPlant->hz - pxP->nominal_hz) / pxP->nominal_hz;
+    double pe = demand_kw * (1.0 + pxP->damping * dev);
+    double target_kw = pxPlant->set_kw - pxPlant->base_kw / pxP->droop * dev;
+
+    pxPlant->hz += dt * pxP->nominal_hz / (2.0 * pxP->inertia_s * pxPlant->base_kw) * (pxPlant->pm_kw - pe);
+    pxPlant->pm_kw += dt * (target_kw - pxPlant->pm_kw) / pxP->governor_s;
+    if (pxPlant->pm_kw > pxPlant->set_kw + pxP->reserve_kw) {
+        pxPlant->pm_kw = pxPlant->set_kw + pxP->reserve_kw;
+    } else if (pxPlant->pm_kw < 0.0) {
+        pxPlant->pm_kw = 0.0;
+    }
+    pxPlant->t += dt;
+}
+
+int xPlantNextCount(Plant_t *pxPlant, LoadMask_t connected, uint32_t *pulCount) {
+    const PlantParams_t *pxP = &pxPlant->params;
+    double demand_kw, phase = 0.0, period = 0.0, dt, counts;
+
+    if (pxPlant->t >= pxP->duration_s || pxPlant->hz < PLANT_COLLAPSE_HZ) {
+        return 0;
+    }
+    demand_kw = pxP->other_kw + dPlantLoadKw(pxPlant, connected);
+    if (pxPlant->base_kw - demand_kw > pxPlant->shed_kw) {
+        pxPlant->shed_kw = pxPlant->base_kw - demand_kw;
+    }
+
+    /* Integrate until the waveform has turned through one cycle */
+    while (phase < 1.0) {
+        if (!pxPlant->tripped && pxPlant->t >= pxP->event_s) {
+            pxPlant->tripped = 1;
+            pxPlant->pm_kw -= pxP->loss_kw;
+            pxPlant->set_kw -= pxP->loss_kw;
+        }
+        dt = PLANT_STEP_S;
+        if (phase + pxPlant->hz * dt >= 1.0) {
+            dt = (1.0 - phase) / pxPlant->hz;
+        }
+        phase += pxPlant->hz * dt;
+        period += dt;
+        vPlantStep(pxPlant, demand_kw, dt);
+        if (pxPlant->hz < pxPlant->nadir_hz) {
+            pxPlant->nadir_hz = pxPlant->hz;
+            pxPlant->nadir_s = pxPlant->t;
+        }
+    }
+
+    counts = period * pxPlant->clock_hz + pxPlant->carry;
+    *pulCount = (uint32_t)floor(counts);
+    pxPlant->carry = counts - *pulCount;
+    return 1;
+}
@@ -0,0 +1,78 @@
+/**
+ * Grid and load plant for closed-loop host replay
+ *
+ * Stands in for the islanded network behind the relay, so that a shed
+ * changes the frequency it goes on to measure. One lumped machine, all
+ * quantities in kW and Hz:
+ *
+ *   df/dt  = f0 / (2 H S) * (Pm - Pe)
+ *   Pe     = (other + sum of connected load kW) * (1 + D (f - f0) / f0)
+ *   dPm/dt = (Pset - S / R * (f - f0) / f0 - Pm) / Tg,  Pm <= Pset + reserve
+ *
+ * S is the demand before the event, which generation meets exactly, so the
+ * plant starts at rest at f0. At event_s a unit carrying loss_kw trips:
+ * Pm and Pset both drop by it, and the governors of the rest pick up what
+ * their droop and headroom allow. Each call gives the next period of the
+ * resulting frequency as a count of the analyser's clock, integrated in
+ * steps of PLANT_STEP_S, with the fraction of a count carried over so that
+ * the counts average to the exact frequency.
+ */
+
+#ifndef PLANT_H
+#define PLANT_H
+
+#include <stdint.h>
+
+#include "load_mask.h"
+
+#define PLANT_STEP_S                   0.001   // Integration step
+#define PLANT_COLLAPSE_HZ              30.0    // Below this the run ends, the machine is lost
+
+typedef struct {
+    double nominal_hz;                 // f0
+    double inertia_s;                  // H, on S
+    double damping;                    // D, pu load per pu frequency
+    double droop;                      // R, pu frequency per pu output
+    double governor_s;                 // Tg
+    double reserve_kw;                 // Governor headroom above Pset
+    double other_kw;                   // Demand that is never shed
+    double load_kw[LOAD_COUNT];        // Each output's load
+    double loss_kw;                    // Generation tripped at event_s
+    double event_s;
+    double duration_s;                 // Counts stop after this
+} PlantParams_t;
+
+typedef struct {
+    PlantParams_t params;
+    uint32_t clock_hz;                 // Analyser count rate
+    double base_kw;                    // S
+    double t;                          // Plant time, s
+    double hz;
+    double pm_kw;                      // Mechanical power
+    double set_kw;                     // Pset
+    double carry;                      // Counts owed to the next period
+    int tripped;
+    LoadMask_t initial;                // Connected at the start
+
+    /* Outcome so far */
+    double nadir_hz;
+    double nadir_s;
+    double shed_kw;                    // Most load off at once
+} Plant_t;
+
+/* Defaults: 1 MW, 650 kW of it unsheddable and 50 kW on each of the loads
+ * in all_loads, H 4 s, 5% droop, a 150 kW unit lost at 1 s with only 50 kW
+ * of reserve, 20 s run */
+void vPlantDefaults(PlantParams_t *pxParams, LoadMask_t all_loads);
+
+/* Start at rest with the loads in connected */
+void vPlantInit(Plant_t *pxPlant, const PlantParams_t *pxParams, uint32_t clock_hz, LoadMask_t connected);
+
+/* The next period's count with the loads now connected. Returns 0 once
+ * duration_s has passed or the frequency has collapsed. */
+int xPlantNextCount(Plant_t *pxPlant, LoadMask_t connected, uint32_t *pulCount);
+
+/* kW of the loads in loads */
+double dPlantLoadKw(const Plant_t *pxPlant, LoadMask_t loads);
+
+#endif /* PLANT_H */
@@ -0,0 +1,178 @@
+#!/usr/bin/env python3
+"""Replay a corpus of traces and diff the decisions against golden outputs.
+
+Each line of the corpus (corpus.txt) names a case and gives the replay
+arguments for it: a built-in scenario (-g), a recorded trace or journal
+capture, the closed-loop plant (-P), with whatever options the case is
+about (-c, -d 0, -z, -e, -p, -k). Every case is run through the replay
+built here, its CSV reduced to the decisions - the rows where the target
+or the connected loads change - and those are compared with golden/<name>.csv:
+
+    make -C sim regress               # or sim/regress.py after make -C sim
+    sim/regress.py -t 50 ramp-5       # one case, 50 ms of timing slack
+    sim/regress.py --update           # take the current decisions as golden
+
+A case passes when it makes the same decisions, in the same order, each
+within the timing tolerance (-t, ms) of the golden one; the loads
+themselves must match exactly. An estimator or filter change that moves
+a shed by a sample passes, one that sheds other loads, one more or one
+fewer time does not. The first difference of a failing case is shown.
+
+Every case also reports its cost: the replay's nanoseconds per sample and
+the wall time of the run, next to the cost when the golden output was
+taken. The cost is for information - it depends on the host - and never
+fails a case; run the corpus before and after a speed-up on one machine to
+compare. Exits with status 1 if any case failed.
+"""
+
+import argparse
+import os
+import re
+import shlex
+import subprocess
+import sys
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+COST = re.compile(r"\((\d+) ns per sample\)")
+
+
+def corpus(path):
+    """[(name, [replay arguments])] in file order."""
+    cases = []
+    with open(path) as text:
+        for number, line in enumerate(text, 1):
+            words = shlex.split(line, comments=True)
+            if not words:
+                continue
+            if len(words) < 2:
+                sys.exit("%s:%d: a case is a name and its replay arguments" % (path, number))
+            cases.append((words[0], words[1:]))
+    return cases
+
+
+def decisions(csv):
+    """[(time_ms, target, connected)] where either mask changes."""
+    rows = []
+    last = None
+    for line in csv.splitlines():
+        fields = line.split(",")
+        if len(fields) != 6 or fields[0] == "time_ms":
+            continue
+        masks = (int(fields[4], 16), int(fields[5], 16))
+        if masks != last:
+            rows.append((float(fields[0]),) + masks)
+            last = masks
+    return rows
+
+
+def run(replay, args):
+    """(decisions, ns per sample or None, wall ms) of one replay."""
+    start = time.perf_counter()
+    result = subprocess.run([replay] + args, cwd=HERE, stdout=subprocess.PIPE, stderr=subprocess.PIPE,
+                            universal_newlines=True)
+    wall_ms = (time.perf_counter() - start) * 1000.0
+    if result.returncode != 0:
+        raise RuntimeError(result.stderr.strip() or "replay exited with %d" % result.returncode)
+    cost = COST.search(result.stderr)
+    return decisions(result.stdout), int(cost.group(1)) if cost else None, wall_ms
+
+
+def load_golden(path):
+    """(decisions, ns per sample or None) from a golden file."""
+    rows = []
+    cost = None
+    with open(path) as text:
+        for line in text:
+            if line.startswith("# ns_per_sample "):
+                cost = int(line.split()[2])
+            elif line.strip() and not line.startswith("#") and not line.startswith("time_ms"):
+                fields = line.strip().split(",")
+                rows.append((float(fields[0]), int(fields[1], 16), int(fields[2], 16)))
+    return rows, cost
+
+
+def save_golden(path, args, rows, cost):
+    with open(path, "w") as out:
+        out.write("# replay %s\n" % " ".join(shlex.quote(arg) for arg in args))
+        if cost is not None:
+            out.write("# ns_per_sample %d\n" % cost)
+        out.write("time_ms,target,connected\n")
+        for time_ms, target, connected in rows:
+            out.write("%.3f,0x%04x,0x%04x\n" % (time_ms, target, connected))
+
+
+def compare(golden, rows, tolerance_ms):
+    """None if they agree, otherwise the first difference as text."""
+    for i, (want, got) in enumerate(zip(golden, rows)):
+        if want[1:] != got[1:]:
+            return "decision %d: golden 0x%04x/0x%04x at %.1f ms, now 0x%04x/0x%04x at %.1f ms" % (
+                i, want[1], want[2], want[0], got[1], got[2], got[0])
+        if abs(want[0] - got[0]) > tolerance_ms:
+            return "decision %d (0x%04x/0x%04x): golden at %.1f ms, now at %.1f ms" % (
+                i, want[1], want[2], want[0], got[0])
+    if len(golden) != len(rows):
+        extra = rows[len(golden)] if len(rows) > len(golden) else golden[len(rows)]
+        return "%d decisions, golden has %d; %s 0x%04x/0x%04x at %.1f ms" % (
+            len(rows), len(golden), "first extra" if len(rows) > len(golden) else "first missing",
+            extra[1], extra[2], extra[0])
+    return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("cases", nargs="*", help="names of the cases to run, default all")
+    parser.add_argument("-f", "--corpus", default=os.path.join(HERE, "corpus.txt"))
+    parser.add_argument("-g", "--golden", default=os.path.join(HERE, "golden"), help="golden output directory")
+    parser.add_argument("-r", "--replay", default=os.path.join(HERE, "replay"))
+    parser.add_argument("-t", "--tolerance", type=float, default=25.0,
+                        help="timing tolerance in ms, default %(default)s (about one sample)")
+    parser.add_argument("--update", action="store_true", help="write the current decisions as golden")
+    args = parser.parse_args()
+
+    cases = corpus(args.corpus)
+    unknown = set(args.cases) - set(name for name, _ in cases)
+    if unknown:
+        sys.exit("no case %s in %s" % (", ".join(sorted(unknown)), args.corpus))
+    if args.cases:
+        cases = [case for case in cases if case[0] in args.cases]
+    if not os.access(args.replay, os.X_OK):
+        sys.exit("%s not built, make -C sim first" % args.replay)
+    os.makedirs(args.golden, exist_ok=True)
+
+    failed = 0
+    print("%-18s %-6s %9s %8s %9s  %s" % ("case", "result", "decisions", "ns/samp", "golden", "wall ms"))
+    for name, replay_args in cases:
+        path = os.path.join(args.golden, name + ".csv")
+        try:
+            rows, cost, wall_ms = run(args.replay, replay_args)
+        except RuntimeError as error:
+            print("%-18s %-6s  %s" % (name, "ERROR", error))
+            failed += 1
+            continue
+
+        golden_cost = None
+        if args.update:
+            save_golden(path, replay_args, rows, cost)
+            result, difference = "saved", None
+        elif not os.path.exists(path):
+            result, difference = "NEW", "no golden output, --update to take one"
+            failed += 1
+        else:
+            golden, golden_cost = load_golden(path)
+            difference = compare(golden, rows, args.tolerance)
+            result = "FAIL" if difference else "ok"
+            failed += difference is not None
+
+        print("%-18s %-6s %9d %8s %9s  %.1f" % (name, result, len(rows), "-" if cost is None else cost,
+                                                 "-" if golden_cost is None else golden_cost, wall_ms))
+        if difference:
+            print("    %s" % difference)
+
+    if not args.update:
+        print("%d of %d cases passed%s" % (len(cases) - failed, len(cases), ", %d failed" % failed if failed else ""))
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
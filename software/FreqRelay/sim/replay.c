@@ -0,0 +1,843 @@
+/**
+ * Host replay of the frequency relay decision path
+ *
+ * Feeds a trace of frequency analyser period counts through the target's
+ * own estimator (freq_estimate.c), shedding policy (load_policy.c) and
+ * staged decision (load_decision.c) on a simulated clock that advances by
+ * each period, so minutes of trace replay in milliseconds and a policy
+ * change can be regression tested against recorded events.
+ *
+ *   make -C sim
+ *   sim/replay trace.txt > decisions.csv
+ *   sim/replay -p policy.bin -q trace.txt     # policy image as flashed, summary only
+ *   sim/replay -k registry.bin -g ramp-5      # power-weighted selection (load_registry.h)
+ *   sim/replay -g ramp-5 -s 7                 # built-in scenario (freq_trace.c), seed 7
+ *   sim/replay -g step-4 -t > step-4.txt      # write the generated trace instead
+ *   sim/replay -g list
+ *   sim/replay -g ramp-5 -d 0                 # reactive shedding only, no prediction lead
+ *   sim/replay -g ramp-5 -z 16000             # waveform at 16 kHz through zero_cross.c
+ *   sim/replay -g ramp-5 -c                   # staged trip curves (uf_curve.h), FREQ_UF_CURVES
+ *   sim/replay -p policy.bin -g ramp-5 -c     # compiled policy and curves (tools/policy_compile.py)
+ *   sim/replay -g ramp-5 -e 8                 # decide on the RoC peak of 8 estimates, FREQ_ROC_PEAK_SAMPLES
+ *   sim/replay -P 150                         # closed loop: 150 kW of generation lost (plant.h)
+ *   sim/replay -P 150 -n 5000 -j 8 > runs.csv # 5000 plant runs on 8 processes
+ *   sim/replay -J console.txt                 # the relay's input journal (journal.h)
+ *
+ * A trace is one count per line at SIM_SAMPLING_FREQ, as read from
+ * FREQUENCY_ANALYSER_BASE; blank lines and lines starting with # are
+ * skipped. A CSV row is written for every sample that changes the loads or
+ * the stability (every sample with -a), and a summary goes to stderr.
+ *
+ * With -P the counts come from the plant model in plant.h instead, which is
+ * fed the loads the decision leaves connected, so a shed arrests the
+ * decline it measures. The run starts at rest and loses the given kW of
+ * generation at 1 s; -H, -R and -T set the inertia, the governors'
+ * reserve and the length of the run, and a registry (-k) gives the loads
+ * their ratings. With -n the plant is run that many times, each with the
+ * loss and the inertia drawn from half to one and a half times the given
+ * ones (from -s), spread over -j processes. Each run is one CSV row, with
+ * its frequency nadir and the load shed, and the summary compares them:
+ * run the same batch with -d 0 (staged), the default (predictive), -c or
+ * -k (power-weighted) to compare the policies.
+ *
+ * With -z the counts are not replayed directly: each one becomes a cycle of
+ * a sine sampled at the given ADC rate (a scenario is generated to the
+ * microsecond for this), and the zero-crossing meter's sub-sample periods
+ * are replayed instead, as a waveform analyser would deliver them.
+ *
+ * With -J the counts are feeder 0's from an input journal dump, found in a
+ * capture of the JTAG UART console, and the decision runs on the relay's
+ * own tick and thresholds from it: time_ms in the CSV is the tick of the
+ * last decision the relay journaled. Each checkpoint in the journal sets
+ * the loads to those the relay had requested and clears the hold-off and
+ * the minimum on/off times, as the relay had nothing pending there. From
+ * the first one on, wherever the relay journaled a decision the replay's
+ * loads are checked against what the relay requested, and the summary
+ * gives the decisions that differ and the first of them. The estimator has
+ * by then had every count since the oldest record; the switches, buttons,
+ * keys and feedback are counted but not modelled (no manual override, no
+ * reset). A relay with FREQ_ANALYSER_BATCH above 1 decides once a batch
+ * where the replay decides every count, so it may shed a count or two
+ * later; other feeders' counts are not replayed.
+ *
+ * The defaults below follow hello_freqRelay.c, and the replay starts with
+ * every load connected. Not modelled: failsafe,
+ * the manual override and the monitor. An expired hold-off is acted on at
+ * the next sample rather than straight away, as the actuator does.
+ */
+
+/* Standard includes */
+#include <stdio.h>
+#include <math.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Hardware includes */
+#include "sys/alt_flash.h"
+
+/* Application includes */
+#include "fix16.h"
+#include "freq_estimate.h"
+#include "freq_trace.h"
+#include "journal.h"
+#include "load_decision.h"
+#include "load_policy.h"
+#include "load_registry.h"
+#include "plant.h"
+#include "prng.h"
+#include "uf_curve.h"
+#include "window_extrema.h"
+#include "zero_cross.h"
+
+#define SIM_SAMPLING_FREQ              16000
+#define SIM_NOMINAL_FREQ               50.0
+#define SIM_FREQ_TOLERANCE             1.5
+#define SIM_MAX_FREQ_ROC               60.0
+#define SIM_VALID_FREQ_MIN             40.0
+#define SIM_VALID_FREQ_MAX             65.0
+#define SIM_FREQ_EST_WINDOW            8
+#define SIM_PREDICT_LEAD_MS            100     // LOAD_PREDICT_LEAD_MS
+#define SIM_PREDICT_ARM                0.5     // LOAD_PREDICT_ARM
+#define SIM_ALL_LOADS                  0x007F  // Loads wired on the board
+#define SIM_WAVE_CLOCK                 1000000 // Scenario count rate behind a waveform, 1 us
+#define SIM_WAVE_AMPLITUDE             20000   // ADC codes
+#define SIM_WAVE_HYSTERESIS            1000
+#define SIM_WAVE_BLOCK                 32      // Words metered at once, as an ADC FIFO would hand them over
+#define SIM_NADIR_FLOOR                47.5    // A batch counts the runs whose nadir falls below
+#define SIM_MAX_JOBS                   64
+
+/* Waveform synthesis for -z */
+typedef struct {
+    uint32_t adc_hz;                   // 0: replay the counts themselves
+    uint32_t source_hz;                // Rate of the counts the cycles come from
+    double phase;                      // Cycles into the current one
+    double step;                       // Phase per ADC sample in the current cycle
+    ZeroCross_t meter;
+    uint32_t periods[2 * SIM_WAVE_BLOCK];
+    uint32_t count;                    // Periods in periods[]
+    uint32_t next;
+} SimWave_t;
+
+static uint32_t ulSimClockHz = SIM_SAMPLING_FREQ;  // Rate of the counts replayed
+
+/* Settings of every run */
+typedef struct {
+    fix16_t upper;
+    fix16_t lower;
+    fix16_t max_roc;
+    fix16_t lead;
+    fix16_t arm;
+    uint32_t window;
+    uint32_t peak_samples;             // FREQ_ROC_PEAK_SAMPLES
+    int use_curves;
+    int print;                         // 0 summary only, 1 changes, 2 every sample
+} SimConfig_t;
+
+/* Input journal for -J, read a record at a time */
+typedef struct {
+    FILE *file;
+    uint32_t counts_per_us;
+    uint64_t time;                     // Relay's timestamp counts since the oldest record
+    uint32_t tick_ms;                  // Of the newest decision
+    int ticked;                        // A decision ran on the count just returned
+    int held;                          // A feeder 0 count read ahead, in held_count
+    uint32_t held_count;
+    int checkpoint;                    // A checkpoint since the last count, in relay
+    int aligned;                       // Past the first checkpoint
+    LoadMask_t relay;                  // Loads the relay requested last
+    int thresholds;                    // Feeder 0's changed since the last count
+    fix16_t upper;
+    fix16_t lower;
+    fix16_t max_roc;
+    uint32_t types[16];                // Records of each type
+} SimJournal_t;
+
+/* Where the counts come from */
+typedef struct {
+    FILE *trace;
+    TraceGen_t gen;
+    SimWave_t wave;
+    Plant_t *pxPlant;                  // Closed loop, fed the loads left connected
+    SimJournal_t *pxJournal;
+} SimSource_t;
+
+typedef struct {
+    uint32_t samples;
+    uint32_t rejected;
+    uint32_t sheds;
+    uint32_t reconnects;
+    uint64_t clock;
+    LoadMask_t fewest;                 // Smallest set of loads left connected
+    uint64_t target_since;             // Clock when the loads first exceeded the target, 0 if not
+    uint64_t worst_to_target;          // Longest wait for the loads to come down to it
+    uint32_t checked;                  // -J: decisions checked against the relay's
+    uint32_t differed;
+    uint64_t first_differed;           // Clock of the first, 0 for none
+} SimStats_t;
+
+/* One run of a batch, as a worker sends it back */
+typedef struct {
+    uint32_t run;
+    uint32_t sheds;
+    uint32_t reconnects;
+    double loss_kw;
+    double inertia_s;
+    double nadir_hz;
+    double nadir_ms;
+    double shed_kw;                    // Most load off at once
+    double final_hz;
+} SimOutcome_t;
+
+static void vUsage(const char *pcName) {
+    fprintf(stderr, "usage: %s [-a] [-c] [-q] [-t] [-p policy.bin] [-k registry.bin] [-g scenario] [-s seed] [-w window]\n"
+                    "       [-l lower] [-u upper] [-r roc] [-e roc peak samples] [-d lead ms] [-z adc hz]\n"
+                    "       [-P loss kW [-H inertia s] [-R reserve kW] [-T s] [-n runs] [-j jobs]] [-J journal] [trace]\n",
+            pcName);
+    exit(2);
+}
+
+/* Next count from the generator if one is running, otherwise the trace file */
+static int xSimNextCount(TraceGen_t *pxGen, FILE *trace, uint32_t *pulCount) {
+    char line[64];
+
+    if (pxGen->pxScenario != NULL) {
+        return xTraceGenNext(pxGen, pulCount);
+    }
+    while (fgets(line, sizeof(line), trace) != NULL) {
+        if (line[0] != '#' && line[0] != '\n' && line[0] != '\r') {
+            *pulCount = (uint32_t)strtoul(line, NULL, 10);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Next count from the meter, synthesising blocks of waveform as needed */
+static int xSimNextWave(SimWave_t *pxWave, TraceGen_t *pxGen, FILE *trace, uint32_t *pulCount) {
+    uint32_t words[SIM_WAVE_BLOCK], cycle, i;
+    int16_t sample[2];
+    int half;
+
+    while (pxWave->next == pxWave->count) {
+        for (i = 0; i < SIM_WAVE_BLOCK; i++) {
+            for (half = 0; half < 2; half++) {
+                while (pxWave->step == 0.0 || pxWave->phase >= 1.0) {
+                    if (!xSimNextCount(pxGen, trace, &cycle)) {
+                        return 0;
+                    }
+                    if (cycle == 0) {
+                        continue;
+                    }
+                    /* Carry the phase past the end into the next cycle */
+                    if (pxWave->step != 0.0) {
+                        pxWave->phase -= 1.0;
+                    }
+                    pxWave->step = (double)pxWave->source_hz / ((double)cycle * pxWave->adc_hz);
+                }
+                sample[half] = (int16_t)lrint(SIM_WAVE_AMPLITUDE * sin(2.0 * M_PI * pxWave->phase));
+                pxWave->phase += pxWave->step;
+            }
+            words[i] = (uint16_t)sample[0] | ((uint32_t)(uint16_t)sample[1] << 16);
+        }
+        pxWave->count = ulZeroCrossBlock(&pxWave->meter, words, SIM_WAVE_BLOCK, pxWave->periods,
+                                         sizeof(pxWave->periods) / sizeof(pxWave->periods[0]));
+        pxWave->next = 0;
+    }
+    *pulCount = pxWave->periods[pxWave->next++];
+    return 1;
+}
+
+
+/* Skip to the first dump in a console capture. Returns 0 if there is none. */
+static int xSimJournalOpen(SimJournal_t *pxJournal) {
+    char line[128];
+    unsigned long counts_per_us;
+    int version;
+
+    while (fgets(line, sizeof(line), pxJournal->file) != NULL) {
+        if (sscanf(line, "#JOURNAL,%d,%lu", &version, &counts_per_us) == 2 && version == JOURNAL_VERSION &&
+            counts_per_us != 0) {
+            pxJournal->counts_per_us = (uint32_t)counts_per_us;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Next record of the dump, its time added up. Returns 0 at its end. */
+static int xSimJournalRecord(SimJournal_t *pxJournal, uint32_t *pulWord0, uint32_t *pulValue) {
+    char line[128];
+    unsigned long word0, value;
+
+    while (fgets(line, sizeof(line), pxJournal->file) != NULL) {
+        if (strncmp(line, "#JOURNAL,end", 12) == 0) {
+            return 0;
+        }
+        if (sscanf(line, "J,%lx,%lx", &word0, &value) != 2) {
+            continue;                  // Other console output in between
+        }
+        *pulWord0 = (uint32_t)word0;
+        *pulValue = (uint32_t)value;
+        pxJournal->time += JOURNAL_DELTA(*pulWord0);
+        if (JOURNAL_TYPE(*pulWord0) == JOURNAL_TIME) {
+            pxJournal->time += (uint64_t)*pulValue << JOURNAL_DELTA_BITS;
+        }
+        pxJournal->types[JOURNAL_TYPE(*pulWord0)]++;
+        return 1;
+    }
+    return 0;
+}
+
+/* What records other than feeder 0's counts tell the replay */
+static void vSimJournalApply(SimJournal_t *pxJournal, uint32_t word0, uint32_t value) {
+    switch (JOURNAL_TYPE(word0)) {
+    case JOURNAL_TICK:
+        pxJournal->tick_ms = value;
+        pxJournal->ticked = 1;
+        break;
+    case JOURNAL_DECISION:
+        pxJournal->relay = (LoadMask_t)value;
+        break;
+    case JOURNAL_CHECKPOINT:
+        pxJournal->relay = (LoadMask_t)value;
+        pxJournal->checkpoint = 1;
+        pxJournal->aligned = 1;
+        break;
+    case JOURNAL_THRESHOLD:
+        if (JOURNAL_ARG(word0) >> 2 != 0) {
+            break;
+        }
+        if ((JOURNAL_ARG(word0) & 3) == JOURNAL_FIELD_UPPER) {
+            pxJournal->upper = (fix16_t)value;
+        } else if ((JOURNAL_ARG(word0) & 3) == JOURNAL_FIELD_LOWER) {
+            pxJournal->lower = (fix16_t)value;
+        } else {
+            pxJournal->max_roc = (fix16_t)value;
+        }
+        pxJournal->thresholds = 1;
+        break;
+    default:
+        break;
+    }
+}
+
+static int xSimJournalCount(uint32_t word0) {
+    return JOURNAL_TYPE(word0) == JOURNAL_PERIOD && JOURNAL_ARG(word0) == 0;
+}
+
+/* Next feeder 0 count, with what came before it, then on up to the tick of
+ * the decision that ran on it or the next count, whichever is first */
+static int xSimNextJournal(SimJournal_t *pxJournal, uint32_t *pulCount) {
+    uint32_t word0, value;
+
+    pxJournal->ticked = 0;
+    if (pxJournal->held) {
+        pxJournal->held = 0;
+        *pulCount = pxJournal->held_count;
+    } else {
+        for (;;) {
+            if (!xSimJournalRecord(pxJournal, &word0, &value)) {
+                return 0;
+            }
+            if (xSimJournalCount(word0)) {
+                break;
+            }
+            vSimJournalApply(pxJournal, word0, value);
+        }
+        *pulCount = value;
+    }
+
+    while (!pxJournal->ticked && xSimJournalRecord(pxJournal, &word0, &value)) {
+        if (xSimJournalCount(word0)) {
+            pxJournal->held = 1;
+            pxJournal->held_count = value;
+            break;
+        }
+        vSimJournalApply(pxJournal, word0, value);
+    }
+    return 1;
+}
+
+/* Next count from the plant, the journal, the meter or the counts
+ * themselves */
+static int xSimNext(SimSource_t *pxSource, LoadMask_t connected, uint32_t *pulCount) {
+    if (pxSource->pxJournal != NULL) {
+        return xSimNextJournal(pxSource->pxJournal, pulCount);
+    }
+    if (pxSource->pxPlant != NULL) {
+        return xPlantNextCount(pxSource->pxPlant, connected, pulCount);
+    }
+    if (pxSource->wave.adc_hz != 0) {
+        return xSimNextWave(&pxSource->wave, &pxSource->gen, pxSource->trace, pulCount);
+    }
+    return xSimNextCount(&pxSource->gen, pxSource->trace, pulCount);
+}
+
+static double dSimMs(uint64_t clock) {
+    return (double)clock * 1000.0 / ulSimClockHz;
+}
+
+/* Replay the source through the decision path from every load connected */
+static void vSimRun(const SimConfig_t *pxConfig, SimSource_t *pxSource, SimStats_t *pxStats) {
+    SimJournal_t *pxJournal = pxSource->pxJournal;
+    FreqEstimator_t estimator;
+    LoadStep_t step;
+    LoadLocks_t locks;
+    UfCurves_t curves;
+    UfCurveState_t curve_state;
+    WindowExtrema_t peak_window;
+    uint32_t peak_seq = 0;
+    fix16_t freq = FIX16_CONST(SIM_NOMINAL_FREQ), roc = 0, peak, deviation;
+    fix16_t upper = pxConfig->upper, lower = pxConfig->lower, max_roc = pxConfig->max_roc;
+    uint64_t clock = 0, holdoff_at = 0;
+    uint32_t count;
+    LoadMask_t connected = SIM_ALL_LOADS, target, previous, held;
+    int stable = 1, was_stable = 1, due = 0, relay_decided = 0;
+
+    vLoadLocksInit(&locks, connected, 0);
+    vUfCurveInit(&curves, xUfDefaultStages, ulUfDefaultStageCount);
+    (void)xUfCurveLoad(&curves);       // Compiled with the policy, if -p gave one
+    vUfCurveReset(&curve_state);
+    vFreqEstInit(&estimator, pxConfig->window, (uint64_t)ulSimClockHz << FIX16_SHIFT,
+                 FIX16_CONST(SIM_VALID_FREQ_MIN), FIX16_CONST(SIM_VALID_FREQ_MAX));
+    vWindowExtremaInit(&peak_window, pxConfig->peak_samples);
+
+    memset(pxStats, 0, sizeof(SimStats_t));
+    pxStats->fewest = connected;
+    if (pxConfig->print) {
+        printf("time_ms,freq,roc,stable,target,connected\n");
+    }
+
+    while (xSimNext(pxSource, connected, &count)) {
+        pxStats->samples++;
+        if (pxJournal == NULL) {
+            clock += count ? count : 1;
+        } else {
+            /* The decision the relay ran on the count before has been
+             * read by now, if it changed the loads */
+            if (relay_decided && pxJournal->aligned && !pxJournal->checkpoint) {
+                pxStats->checked++;
+                if (connected != pxJournal->relay) {
+                    pxStats->differed++;
+                    if (pxStats->first_differed == 0) {
+                        pxStats->first_differed = clock ? clock : 1;
+                    }
+                }
+            }
+            relay_decided = pxJournal->ticked;
+            clock = (uint64_t)pxJournal->tick_ms * ulSimClockHz / 1000;
+            if (pxJournal->thresholds) {
+                pxJournal->thresholds = 0;
+                upper = pxJournal->upper;
+                lower = pxJournal->lower;
+                max_roc = pxJournal->max_roc;
+                vLoadPolicySetRocThreshold(max_roc);
+            }
+            if (pxJournal->checkpoint) {
+                pxJournal->checkpoint = 0;
+                connected = pxJournal->relay;
+                vLoadLocksInit(&locks, connected, (uint32_t)dSimMs(clock));
+                vUfCurveReset(&curve_state);
+                holdoff_at = 0;
+                due = 0;
+            }
+        }
+
+        if (holdoff_at != 0 && clock >= holdoff_at) {
+            holdoff_at = 0;
+            due = 1;
+        }
+        if (!xFreqEstAdd(&estimator, count, &freq, &roc)) {
+            continue;
+        }
+        peak = roc;
+        if (pxConfig->peak_samples > 1) {
+            vWindowExtremaAdd(&peak_window, ++peak_seq, roc, roc);
+            peak = xWindowExtremaPeak(&peak_window);
+        }
+
+        /* Analyzer stability check and actuator decision, on the RoC peak
+         * as the relay's is */
+        stable = freq >= lower && freq <= upper && FIX16_ABS(roc) < max_roc;
+        held = xLoadLocksHeld(&locks, connected, (uint32_t)dSimMs(clock));
+        if (pxLoadRegistryGet() != NULL) {
+            deviation = lower - freq;
+            if (xLoadPolicyCrossingDue(pxLoadPolicyGet(), deviation, peak, pxConfig->lead, pxConfig->arm)) {
+                deviation -= fix16_mul(peak, pxConfig->lead);
+            }
+            target = xLoadRegistryTarget(deviation - pxLoadPolicyGet()->freq_thresholds[0], peak,
+                                         held & connected);
+        } else if (pxConfig->use_curves) {
+            target = pxLoadPolicyGet()->requested_status[0][FIX16_ABS(peak) > pxLoadPolicyGet()->roc_thresholds[0]] &
+                     (LoadMask_t)~xUfCurveShed(&curves, &curve_state, lower - freq, (uint32_t)dSimMs(clock));
+        } else {
+            target = xLoadPolicyPredict(pxLoadPolicyGet(), lower - freq, peak, pxConfig->lead, pxConfig->arm);
+        }
+        target = (target & ~held) | (connected & held);
+
+        previous = connected;
+        vLoadDecisionStep(connected, target, stable, due, &step);
+        if (step.clear_due) {
+            due = 0;
+        }
+        if (step.holdoff == LOAD_HOLDOFF_STOP) {
+            holdoff_at = 0;
+        } else if (step.holdoff == LOAD_HOLDOFF_ARM && holdoff_at == 0) {
+            holdoff_at = clock + (uint64_t)step.holdoff_ms * ulSimClockHz / 1000;
+        }
+        connected = step.connected;
+
+        pxStats->sheds += ulLoadCount(previous & ~connected);
+        pxStats->reconnects += ulLoadCount(connected & ~previous);
+        if (ulLoadCount(connected) < ulLoadCount(pxStats->fewest)) {
+            pxStats->fewest = connected;
+        }
+        if ((connected & ~target & ~LOAD_CRITICAL_MASK) == 0) {
+            if (pxStats->target_since != 0 && clock - pxStats->target_since > pxStats->worst_to_target) {
+                pxStats->worst_to_target = clock - pxStats->target_since;
+            }
+            pxStats->target_since = 0;
+        } else if (pxStats->target_since == 0) {
+            pxStats->target_since = clock;
+        }
+
+        if (pxConfig->print > 1 || (pxConfig->print && (connected != previous || stable != was_stable))) {
+            printf("%.3f,%.3f,%.3f,%d,0x%04x,0x%04x\n", dSimMs(clock), FIX16_TO_DOUBLE(freq),
+                   FIX16_TO_DOUBLE(roc), stable, (unsigned int)target, (unsigned int)connected);
+        }
+        was_stable = stable;
+    }
+    pxStats->clock = clock;
+    pxStats->rejected = estimator.rejected;
+}
+
+/* Fraction in [0.5, 1.5) for a batch run's spread */
+static double dSimSpread(Prng_t *pxPrng) {
+    return 0.5 + ulPrngBelow(pxPrng, 65536) / 65536.0;
+}
+
+/* One plant run of a batch, its loss and inertia drawn from the run number */
+static void vSimPlantRun(const SimConfig_t *pxConfig, const PlantParams_t *pxParams, uint32_t seed,
+                         uint32_t run, SimOutcome_t *pxOutcome) {
+    PlantParams_t params = *pxParams;
+    SimSource_t source;
+    SimStats_t stats;
+    Plant_t plant;
+    Prng_t prng;
+
+    vPrngSeed(&prng, (seed + run) * 0x9E3779B9UL);
+    params.loss_kw *= dSimSpread(&prng);
+    params.inertia_s *= dSimSpread(&prng);
+    vPlantInit(&plant, &params, ulSimClockHz, SIM_ALL_LOADS);
+    memset(&source, 0, sizeof(source));
+    source.pxPlant = &plant;
+    vSimRun(pxConfig, &source, &stats);
+
+    pxOutcome->run = run;
+    pxOutcome->sheds = stats.sheds;
+    pxOutcome->reconnects = stats.reconnects;
+    pxOutcome->loss_kw = params.loss_kw;
+    pxOutcome->inertia_s = params.inertia_s;
+    pxOutcome->nadir_hz = plant.nadir_hz;
+    pxOutcome->nadir_ms = plant.nadir_s * 1000.0;
+    pxOutcome->shed_kw = plant.shed_kw;
+    pxOutcome->final_hz = plant.hz;
+}
+
+/* runs plant runs over jobs worker processes, one CSV row a run in run
+ * order and a summary on stderr. Returns 0 if every run came back. */
+static int xSimBatch(const SimConfig_t *pxConfig, const PlantParams_t *pxParams, uint32_t seed,
+                     uint32_t runs, uint32_t jobs) {
+    struct pollfd fds[SIM_MAX_JOBS];
+    SimOutcome_t *pxOutcomes, outcome;
+    uint32_t i, job, done = 0, open, below = 0;
+    double nadir_sum = 0.0, shed_sum = 0.0, worst = SIM_NOMINAL_FREQ, most = 0.0;
+    int pipes[2];
+    pid_t pid;
+
+    pxOutcomes = calloc(runs, sizeof(SimOutcome_t));
+    if (pxOutcomes == NULL) {
+        fprintf(stderr, "no memory for %u runs\n", runs);
+        return 1;
+    }
+
+    /* Each worker takes every jobs-th run. An outcome is smaller than
+     * PIPE_BUF, so each write arrives whole. */
+    fflush(stdout);
+    for (job = 0; job < jobs; job++) {
+        if (pipe(pipes) != 0 || (pid = fork()) < 0) {
+            perror("worker");
+            return 1;
+        }
+        if (pid == 0) {
+            close(pipes[0]);
+            for (i = job; i < runs; i += jobs) {
+                vSimPlantRun(pxConfig, pxParams, seed, i, &outcome);
+                if (write(pipes[1], &outcome, sizeof(outcome)) != sizeof(outcome)) {
+                    _exit(1);
+                }
+            }
+            _exit(0);
+        }
+        close(pipes[1]);
+        fds[job].fd = pipes[0];
+        fds[job].events = POLLIN;
+    }
+
+    for (open = jobs; open > 0;) {
+        if (poll(fds, jobs, -1) < 0) {
+            perror("poll");
+            return 1;
+        }
+        for (job = 0; job < jobs; job++) {
+            if (fds[job].fd < 0 || fds[job].revents == 0) {
+                continue;
+            }
+            if (read(fds[job].fd, &outcome, sizeof(outcome)) == sizeof(outcome) && outcome.run < runs) {
+                pxOutcomes[outcome.run] = outcome;
+                done++;
+            } else {
+                close(fds[job].fd);
+                fds[job].fd = -1;
+                open--;
+            }
+        }
+    }
+    while (wait(NULL) > 0) {
+    }
+
+    printf("run,loss_kw,inertia_s,nadir_hz,nadir_ms,shed_kw,sheds,reconnects,final_hz\n");
+    for (i = 0; i < runs; i++) {
+        SimOutcome_t *pxRun = &pxOutcomes[i];
+
+        printf("%u,%.1f,%.3f,%.4f,%.1f,%.1f,%u,%u,%.4f\n", i, pxRun->loss_kw, pxRun->inertia_s,
+               pxRun->nadir_hz, pxRun->nadir_ms, pxRun->shed_kw, pxRun->sheds, pxRun->reconnects,
+               pxRun->final_hz);
+        nadir_sum += pxRun->nadir_hz;
+        shed_sum += pxRun->shed_kw;
+        if (pxRun->nadir_hz < worst) {
+            worst = pxRun->nadir_hz;
+        }
+        if (pxRun->shed_kw > most) {
+            most = pxRun->shed_kw;
+        }
+        below += pxRun->nadir_hz < SIM_NADIR_FLOOR;
+    }
+    fprintf(stderr, "%u of %u runs on %u processes: nadir mean %.3f Hz, worst %.3f Hz, %u under %.1f Hz\n",
+            done, runs, jobs, runs ? nadir_sum / runs : 0.0, worst, below, SIM_NADIR_FLOOR);
+    fprintf(stderr, "shed mean %.1f kW, most %.1f kW\n", runs ? shed_sum / runs : 0.0, most);
+    free(pxOutcomes);
+    return done == runs ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+    SimConfig_t config;
+    SimSource_t source;
+    SimStats_t stats;
+    SimJournal_t journal;
+    PlantParams_t params;
+    Plant_t plant;
+    const TraceScenario_t *pxScenario = NULL;
+    const char *pcJournal = NULL;
+    const LoadRegistry_t *pxRegistry;
+    uint32_t seed = 1, runs = 0, jobs = 1, count, i;
+    struct timespec start, end;
+    double loss_kw = -1.0, inertia_s = 0.0, reserve_kw = -1.0, duration_s = 0.0;
+    int all = 0, quiet = 0, write_trace = 0, option, saved_stdout, result;
+    double host_ns;
+
+    memset(&config, 0, sizeof(config));
+    config.upper = FIX16_CONST(SIM_NOMINAL_FREQ + SIM_FREQ_TOLERANCE);
+    config.lower = FIX16_CONST(SIM_NOMINAL_FREQ - SIM_FREQ_TOLERANCE);
+    config.max_roc = FIX16_CONST(SIM_MAX_FREQ_ROC);
+    config.lead = FIX16_CONST(SIM_PREDICT_LEAD_MS / 1000.0);
+    config.arm = FIX16_CONST(SIM_PREDICT_ARM);
+    config.window = SIM_FREQ_EST_WINDOW;
+    config.peak_samples = 1;
+    memset(&source, 0, sizeof(source));
+    source.trace = stdin;
+    while ((option = getopt(argc, argv, "acqtp:k:g:s:w:l:u:r:e:d:z:P:H:R:T:n:j:J:")) != -1) {
+        switch (option) {
+        case 'a': all = 1; break;
+        case 'c': config.use_curves = 1; break;
+        case 'q': quiet = 1; break;
+        case 't': write_trace = 1; break;
+        case 's': seed = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 'g':
+            if (strcmp(optarg, "list") == 0) {
+                for (i = 0; i < ulTraceScenarioCount; i++) {
+                    printf("%s\n", xTraceScenarios[i].name);
+                }
+                return 0;
+            }
+            if ((pxScenario = pxTraceScenarioFind(optarg)) == NULL) {
+                fprintf(stderr, "no scenario %s, see -g list\n", optarg);
+                return 1;
+            }
+            break;
+        case 'p':
+            if (xSimFlashLoad(optarg, POLICY_FLASH_OFFSET) != 0) {
+                fprintf(stderr, "cannot read %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'k':
+            if (xSimFlashLoad(optarg, REGISTRY_FLASH_OFFSET) != 0) {
+                fprintf(stderr, "cannot read %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'w': config.window = (uint32_t)atoi(optarg); break;
+        case 'l': config.lower = FIX16_CONST(atof(optarg)); break;
+        case 'u': config.upper = FIX16_CONST(atof(optarg)); break;
+        case 'r': config.max_roc = FIX16_CONST(atof(optarg)); break;
+        case 'e': config.peak_samples = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 'd': config.lead = FIX16_CONST(atof(optarg) / 1000.0); break;
+        case 'z': source.wave.adc_hz = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 'P': loss_kw = atof(optarg); break;
+        case 'H': inertia_s = atof(optarg); break;
+        case 'R': reserve_kw = atof(optarg); break;
+        case 'T': duration_s = atof(optarg); break;
+        case 'n': runs = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 'j': jobs = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 'J': pcJournal = optarg; break;
+        default: vUsage(argv[0]);
+        }
+    }
+    if (loss_kw < 0.0 && (runs != 0 || inertia_s != 0.0 || reserve_kw >= 0.0 || duration_s != 0.0)) {
+        fprintf(stderr, "-H, -R, -T and -n need the plant, -P\n");
+        return 1;
+    }
+    if (loss_kw >= 0.0 && (pxScenario != NULL || source.wave.adc_hz != 0 || optind < argc)) {
+        fprintf(stderr, "-P replaces the trace: no -g, -z or trace file with it\n");
+        return 1;
+    }
+    if (pcJournal != NULL && (loss_kw >= 0.0 || pxScenario != NULL || source.wave.adc_hz != 0 || optind < argc)) {
+        fprintf(stderr, "-J replaces the trace: no -P, -g, -z or trace file with it\n");
+        return 1;
+    }
+    if (config.peak_samples < 1 || config.peak_samples > WINDOW_EXTREMA_SIZE) {
+        fprintf(stderr, "-e takes 1 to %d estimates\n", WINDOW_EXTREMA_SIZE);
+        return 1;
+    }
+    if (jobs < 1 || jobs > SIM_MAX_JOBS) {
+        fprintf(stderr, "-j takes 1 to %d processes\n", SIM_MAX_JOBS);
+        return 1;
+    }
+    if (loss_kw < 0.0 && pxScenario == NULL && optind < argc && (source.trace = fopen(argv[optind], "r")) == NULL) {
+        fprintf(stderr, "cannot open %s\n", argv[optind]);
+        return 1;
+    }
+    if (pcJournal != NULL) {
+        memset(&journal, 0, sizeof(journal));
+        journal.upper = config.upper;
+        journal.lower = config.lower;
+        journal.max_roc = config.max_roc;
+        if ((journal.file = fopen(pcJournal, "r")) == NULL) {
+            fprintf(stderr, "cannot open %s\n", pcJournal);
+            return 1;
+        }
+        if (!xSimJournalOpen(&journal)) {
+            fprintf(stderr, "no version %d journal dump in %s\n", JOURNAL_VERSION, pcJournal);
+            return 1;
+        }
+        source.pxJournal = &journal;
+    }
+    source.wave.source_hz = pxScenario != NULL && source.wave.adc_hz != 0 ? SIM_WAVE_CLOCK : SIM_SAMPLING_FREQ;
+    if (pxScenario != NULL) {
+        vTraceGenStart(&source.gen, pxScenario, source.wave.source_hz, seed);
+    }
+    if (source.wave.adc_hz != 0) {
+        vZeroCrossInit(&source.wave.meter, SIM_WAVE_HYSTERESIS);
+        ulSimClockHz = ZC_CLOCK_HZ(source.wave.adc_hz);
+    }
+
+    /* Same start-up as the target: policy first, then the RoC boundary the
+     * threshold editor would have set. load_policy.c reports its choice with
+     * printf, which goes to stderr here to keep it out of the CSV. */
+    fflush(stdout);
+    saved_stdout = dup(STDOUT_FILENO);
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+    xLoadPolicyInit();
+    xLoadRegistryInit();
+    fflush(stdout);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+    vLoadPolicySetRocThreshold(config.max_roc);
+
+    /* The plant, its loads rated by the registry if there is one */
+    if (loss_kw >= 0.0) {
+        vPlantDefaults(&params, SIM_ALL_LOADS);
+        params.loss_kw = loss_kw;
+        if (inertia_s > 0.0) {
+            params.inertia_s = inertia_s;
+        }
+        if (reserve_kw >= 0.0) {
+            params.reserve_kw = reserve_kw;
+        }
+        if (duration_s > 0.0) {
+            params.duration_s = duration_s;
+        }
+        if ((pxRegistry = pxLoadRegistryGet()) != NULL) {
+            for (i = 0; i < REGISTRY_LOADS; i++) {
+                params.load_kw[i] = SIM_ALL_LOADS & xLoadBit(i) ? pxRegistry->load[i].rating_kw : 0.0;
+            }
+        }
+        vPlantInit(&plant, &params, ulSimClockHz, SIM_ALL_LOADS);
+        source.pxPlant = &plant;
+    }
+
+    if (write_trace) {
+        printf("# %s, seed %u, %u Hz counts\n", pxScenario ? pxScenario->name : source.pxPlant ? "plant" : "trace",
+               seed, ulSimClockHz);
+        while (xSimNext(&source, SIM_ALL_LOADS, &count)) {
+            printf("%u\n", count);
+        }
+        return 0;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (runs != 0) {
+        config.print = 0;
+        result = xSimBatch(&config, &params, seed, runs, jobs);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        host_ns = (double)(end.tv_sec - start.tv_sec) * 1e9 + (double)(end.tv_nsec - start.tv_nsec);
+        fprintf(stderr, "%.0f s of plant time in %.2f s (%.2f ms per run)\n", runs * params.duration_s,
+                host_ns / 1e9, host_ns / 1e6 / runs);
+        return result;
+    }
+    config.print = quiet ? 0 : all ? 2 : 1;
+    vSimRun(&config, &source, &stats);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    host_ns = (double)(end.tv_sec - start.tv_sec) * 1e9 + (double)(end.tv_nsec - start.tv_nsec);
+    fprintf(stderr, "%u samples (%u rejected) over %.1f s, replayed in %.2f ms (%.0f ns per sample)\n",
+            stats.samples, stats.rejected, dSimMs(stats.clock) / 1000.0, host_ns / 1e6,
+            stats.samples ? host_ns / stats.samples : 0.0);
+    fprintf(stderr, "%u sheds, %u reconnects, fewest loads 0x%04x, longest above target %.1f ms\n",
+            stats.sheds, stats.reconnects, (unsigned int)stats.fewest, dSimMs(stats.worst_to_target));
+    if (source.pxJournal != NULL) {
+        fprintf(stderr, "journal: %.3f s of the relay's time, %u ticks, %u checkpoints, %u decisions; "
+                "%u switch, %u button, %u key and %u feedback records (not modelled)\n",
+                (double)journal.time / journal.counts_per_us / 1e6, journal.types[JOURNAL_TICK],
+                journal.types[JOURNAL_CHECKPOINT], journal.types[JOURNAL_DECISION], journal.types[JOURNAL_SWITCHES],
+                journal.types[JOURNAL_BUTTONS], journal.types[JOURNAL_KEY], journal.types[JOURNAL_FEEDBACK]);
+        if (!journal.aligned) {
+            fprintf(stderr, "journal: no checkpoint, nothing checked against the relay\n");
+        } else if (stats.differed == 0) {
+            fprintf(stderr, "journal: all %u of the relay's decisions matched\n", stats.checked);
+        } else {
+            fprintf(stderr, "journal: %u of the relay's %u decisions differ, the first at %.0f ms\n", stats.differed,
+                    stats.checked, dSimMs(stats.first_differed));
+        }
+    }
+    if (source.pxPlant != NULL) {
+        fprintf(stderr, "plant: %.0f kW lost, nadir %.3f Hz at %.0f ms, %.0f kW shed at most, %.3f Hz at the end\n",
+                params.loss_kw, plant.nadir_hz, plant.nadir_s * 1000.0, plant.shed_kw, plant.hz);
+    }
+    return 0;
+}
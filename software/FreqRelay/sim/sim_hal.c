@@ -0,0 +1,94 @@
+/**
+ * Host stand-ins for the HAL flash API and the board I/O
+ *
+ * A sparse flash: each loaded image is kept in memory at its offset, and
+ * any read outside them returns 0xFF like erased CFI flash. The board is
+ * one struct of register values, see hal/board_io_host.h.
+ */
+
+/* Standard includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Hardware includes */
+#include "system.h"
+#include "sys/alt_flash.h"
+#include "board_io_host.h"
+
+#define SIM_FLASH_IMAGES               4
+
+struct alt_flash_fd {
+    int open;
+};
+
+static struct {
+    int offset;
+    long length;
+    unsigned char *data;
+} xImages[SIM_FLASH_IMAGES];
+
+static int xImageCount = 0;
+static alt_flash_fd xFlash;
+
+SimBoard_t xSimBoard;
+
+int xSimFlashLoad(const char *path, int offset) {
+    FILE *file;
+    long length;
+    unsigned char *data;
+
+    if (xImageCount == SIM_FLASH_IMAGES || (file = fopen(path, "rb")) == NULL) {
+        return -1;
+    }
+    fseek(file, 0, SEEK_END);
+    length = ftell(file);
+    rewind(file);
+
+    data = malloc(length > 0 ? (size_t)length : 1);
+    if (data == NULL || fread(data, 1, (size_t)length, file) != (size_t)length) {
+        free(data);
+        fclose(file);
+        return -1;
+    }
+    fclose(file);
+
+    xImages[xImageCount].offset = offset;
+    xImages[xImageCount].length = length;
+    xImages[xImageCount].data = data;
+    xImageCount++;
+    return 0;
+}
+
+alt_flash_fd *alt_flash_open_dev(const char *name) {
+    if (strcmp(name, FLASH_CONTROLLER_NAME) != 0) {
+        return NULL;
+    }
+    xFlash.open = 1;
+    return &xFlash;
+}
+
+void alt_flash_close_dev(alt_flash_fd *fd) {
+    fd->open = 0;
+}
+
+int alt_read_flash(alt_flash_fd *fd, int offset, void *dest_addr, int length) {
+    unsigned char *pucDest = dest_addr;
+    long at;
+    int i, j;
+
+    if (!fd->open) {
+        return -1;
+    }
+
+    memset(dest_addr, 0xFF, (size_t)length);
+    for (i = 0; i < xImageCount; i++) {
+        for (j = 0; j < length; j++) {
+            at = (long)offset + j - xImages[i].offset;
+            if (at >= 0 && at < xImages[i].length) {
+                pucDest[j] = xImages[i].data[at];
+            }
+        }
+    }
+    return 0;
+}
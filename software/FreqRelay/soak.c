@@ -0,0 +1,84 @@
+/**
+ * Latency histograms for long soak runs
+ *
+ * See soak.h.
+ */
+
+/* Application includes */
+#include "soak.h"
+
+#define SOAK_LINEAR_SHIFT              3      // 8 us bins below the first doubling
+#define SOAK_FIRST_OCTAVE              6      // 64 us
+
+static uint32_t ulSoakBin(uint32_t us) {
+    uint32_t octave;
+
+    if (us < (1u << SOAK_FIRST_OCTAVE)) {
+        return us >> SOAK_LINEAR_SHIFT;
+    }
+    octave = 31 - (uint32_t)__builtin_clz(us) - SOAK_FIRST_OCTAVE;
+    if (octave >= SOAK_HIST_OCTAVES) {
+        return SOAK_HIST_BINS - 1;
+    }
+    /* The three bits below the leading one pick the bin in the doubling */
+    return SOAK_HIST_SUB + octave * SOAK_HIST_SUB + ((us >> (octave + SOAK_LINEAR_SHIFT)) & (SOAK_HIST_SUB - 1));
+}
+
+/* First value above the bin */
+static uint32_t ulSoakBinTop(uint32_t bin) {
+    uint32_t octave, sub;
+
+    if (bin < SOAK_HIST_SUB) {
+        return (bin + 1) << SOAK_LINEAR_SHIFT;
+    }
+    octave = (bin - SOAK_HIST_SUB) / SOAK_HIST_SUB;
+    sub = (bin - SOAK_HIST_SUB) % SOAK_HIST_SUB;
+    return (SOAK_HIST_SUB + sub + 1) << (octave + SOAK_LINEAR_SHIFT);
+}
+
+void vSoakHistAdd(SoakHist_t *pxHist, SeqLock_t *pxLock, uint32_t us) {
+    uint32_t bin = ulSoakBin(us);
+
+    vSeqWriteBegin(pxLock);
+    pxHist->bins[bin]++;
+    pxHist->count++;
+    if (us > pxHist->max_us) {
+        pxHist->max_us = us;
+    }
+    vSeqWriteEnd(pxLock);
+}
+
+void vSoakHistGet(const SoakHist_t *pxHist, const SeqLock_t *pxLock, SoakHist_t *pxCopy) {
+    vSeqRead(pxLock, pxCopy, pxHist, sizeof(SoakHist_t));
+}
+
+void vSoakHistDelta(const SoakHist_t *pxNow, const SoakHist_t *pxThen, SoakHist_t *pxDelta) {
+    uint32_t i;
+
+    for (i = 0; i < SOAK_HIST_BINS; i++) {
+        pxDelta->bins[i] = pxNow->bins[i] - pxThen->bins[i];
+    }
+    pxDelta->count = pxNow->count - pxThen->count;
+    pxDelta->max_us = pxNow->max_us;
+}
+
+uint32_t ulSoakHistPercentile(const SoakHist_t *pxHist, uint32_t per10k) {
+    uint64_t rank;
+    uint32_t i, seen = 0, top;
+
+    if (pxHist->count == 0) {
+        return 0;
+    }
+    rank = ((uint64_t)pxHist->count * per10k + 9999) / 10000;
+    if (rank == 0) {
+        rank = 1;
+    }
+    for (i = 0; i < SOAK_HIST_BINS - 1; i++) {
+        seen += pxHist->bins[i];
+        if (seen >= rank) {
+            break;
+        }
+    }
+    top = ulSoakBinTop(i) - 1;
+    return i == SOAK_HIST_BINS - 1 || top > pxHist->max_us ? pxHist->max_us : top;
+}
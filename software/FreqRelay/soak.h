@@ -0,0 +1,46 @@
+/**
+ * Latency histograms for long soak runs
+ *
+ * The control path's LatencyStats_t bins by the millisecond up to 16 ms,
+ * which is right for the display but too coarse for the tail of a run that
+ * lasts hours. A SoakHist_t keeps eight bins per doubling from 64 us to
+ * about a second (8 us bins below 64 us), so any percentile is known to
+ * within an eighth, in under half a kilobyte.
+ *
+ * A histogram only ever counts up. The soak summary keeps the copy it took
+ * last time and reports the difference as the rolling window, so the one
+ * writer never has to be reset by the reader. Writers and readers pair up
+ * through a sequence lock, as for the latency statistics.
+ */
+
+#ifndef SOAK_H
+#define SOAK_H
+
+#include <stdint.h>
+#include "seqlock.h"
+
+#define SOAK_HIST_SUB                  8      // Bins per doubling
+#define SOAK_HIST_OCTAVES              14     // 64 us up to 2^20 us
+#define SOAK_HIST_BINS                 (SOAK_HIST_SUB + SOAK_HIST_SUB * SOAK_HIST_OCTAVES)  // Last also counts overflows
+
+typedef struct {
+    uint32_t count;
+    uint32_t max_us;                   // Cumulative histograms only
+    uint32_t bins[SOAK_HIST_BINS];
+} SoakHist_t;
+
+/* Add one measurement (single writer per histogram) */
+void vSoakHistAdd(SoakHist_t *pxHist, SeqLock_t *pxLock, uint32_t us);
+
+/* Consistent copy for the reader */
+void vSoakHistGet(const SoakHist_t *pxHist, const SeqLock_t *pxLock, SoakHist_t *pxCopy);
+
+/* now - then, bin by bin, for the window between two copies. The
+ * difference has no exact maximum, its max_us is that of now. */
+void vSoakHistDelta(const SoakHist_t *pxNow, const SoakHist_t *pxThen, SoakHist_t *pxDelta);
+
+/* Value at or below which per10k / 10000 of the measurements lie, as the
+ * top of its bin and no more than max_us. 0 when empty. */
+uint32_t ulSoakHistPercentile(const SoakHist_t *pxHist, uint32_t per10k);
+
+#endif /* SOAK_H */
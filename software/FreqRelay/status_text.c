@@ -0,0 +1,67 @@
+/**
+ * Status text formatted once for every display
+ *
+ * See status_text.h.
+ */
+
+/* Application includes */
+#include "seqlock.h"
+#include "status_text.h"
+#include "system_state.h"
+#include "vga_text.h"
+
+static SeqLock_t xStatusLock = SEQLOCK_INIT;
+static StatusText_t xStatus;           // Under xStatusLock
+static volatile uint32_t ulFormats = 0;
+
+static int xStatusSame(const StatusValues_t *a, const StatusValues_t *b) {
+    return a->channel == b->channel && a->freq == b->freq && a->roc == b->roc &&
+           a->loads == b->loads && a->state == b->state;
+}
+
+uint32_t ulStatusTextUpdate(const StatusValues_t *pxValues) {
+    StatusText_t text;
+    StatusValues_t shown;
+    uint32_t start, version;
+
+    do {
+        start = ulSeqReadBegin(&xStatusLock);
+        shown = xStatus.values;
+        version = xStatus.version;
+    } while (xSeqReadRetry(&xStatusLock, start));
+    if (version != 0 && xStatusSame(&shown, pxValues)) {
+        return version;
+    }
+
+    text.values = *pxValues;
+    text.pcState = pxValues->state == STATUS_NORMAL ? "NORMAL" :
+                   (pxValues->state == STATUS_ALERT ? "ALERT" : "FAILSAFE");
+    pcTextFix16(text.freq, pxValues->freq, 2);
+    pcTextFix16(text.roc, pxValues->roc, 2);
+    pcTextFix16(text.roc_short, pxValues->roc, 1);
+    pcTextHex(text.loads, pxValues->loads, STATUS_TEXT_LOAD_DIGITS);
+
+    /* Another display may have published the same values meanwhile */
+    vSeqWriteBegin(&xStatusLock);
+    if (xStatus.version == 0 || !xStatusSame(&xStatus.values, pxValues)) {
+        text.version = xStatus.version + 1;
+        xStatus = text;
+        ulFormats++;
+    }
+    version = xStatus.version;
+    vSeqWriteEnd(&xStatusLock);
+    return version;
+}
+
+int xStatusTextGet(StatusText_t *pxText, uint32_t *pulSeen) {
+    if (xStatus.version == *pulSeen) {
+        return 0;
+    }
+    vSeqRead(&xStatusLock, pxText, &xStatus, sizeof(xStatus));
+    *pulSeen = pxText->version;
+    return 1;
+}
+
+uint32_t ulStatusTextFormats(void) {
+    return ulFormats;
+}
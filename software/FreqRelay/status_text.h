@@ -0,0 +1,65 @@
+/**
+ * Status text formatted once for every display
+ *
+ * The VGA status lines, its large digit readout and the character LCD all
+ * show the same frequency, RoC, state and loads. Instead of each of them
+ * formatting those every refresh, a display gathers the values it would
+ * show and hands them to ulStatusTextUpdate(), which formats them only if
+ * they differ from the last ones formatted, into one cache with a version
+ * that goes up with each change. xStatusTextGet() copies the cache only
+ * when its version is newer than the one the display last drew, so an
+ * unchanged status costs a compare of a few words per display, and the
+ * formatting is done once per change however many displays there are.
+ *
+ * The seven-segment readout (seven_seg.h) packs its own digits straight
+ * from the analyser path, in a few instructions, so that it keeps up when
+ * no display task runs; it does not go through the cache.
+ *
+ * Any task, co-routine or idle job may update or read. The cache is under
+ * a sequence lock (seqlock.h); formatting is done outside it, so two
+ * displays racing with the same new values both format them but only the
+ * first one publishes.
+ */
+
+#ifndef STATUS_TEXT_H
+#define STATUS_TEXT_H
+
+#include <stdint.h>
+#include "fix16.h"
+
+#define STATUS_TEXT_FIELD              12     // Formatted number with its NUL
+#define STATUS_TEXT_LOAD_DIGITS        4      // Hex digits of the loads
+
+/* What is shown */
+typedef struct {
+    uint32_t channel;                  // Feeder on display
+    fix16_t freq;                      // Hz
+    fix16_t roc;                       // Hz/s
+    uint32_t loads;                    // Decided load status
+    uint8_t state;                     // STATUS_*
+} StatusValues_t;
+
+/* The values and their text */
+typedef struct {
+    uint32_t version;                  // 0 before the first update
+    StatusValues_t values;
+    const char *pcState;               // "NORMAL", "ALERT" or "FAILSAFE"
+    char freq[STATUS_TEXT_FIELD];      // 2 decimals
+    char roc[STATUS_TEXT_FIELD];       // 2 decimals
+    char roc_short[STATUS_TEXT_FIELD]; // 1 decimal
+    char loads[STATUS_TEXT_LOAD_DIGITS + 1];
+} StatusText_t;
+
+/* Format the values into the cache if they changed. Returns the version
+ * that holds them. */
+uint32_t ulStatusTextUpdate(const StatusValues_t *pxValues);
+
+/* Copy the cache into pxText and advance *pulSeen if its version is not
+ * *pulSeen. Returns 1 if it copied, 0 if the display is up to date. Start
+ * *pulSeen at 0. */
+int xStatusTextGet(StatusText_t *pxText, uint32_t *pulSeen);
+
+/* Times the values were formatted, for the statistics */
+uint32_t ulStatusTextFormats(void);
+
+#endif /* STATUS_TEXT_H */
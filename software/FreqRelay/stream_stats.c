@@ -0,0 +1,179 @@
+/**
+ * Streaming statistics over minute, hour and day windows
+ *
+ * See stream_stats.h.
+ */
+
+/* Standard includes */
+#include <string.h>
+
+/* Application includes */
+#include "stream_stats.h"
+
+#define STATS_LINEAR                   STATS_SUB  // One unit per bin below this
+#define STATS_SUB_SHIFT                3          // log2(STATS_SUB)
+
+static const uint32_t ulSpanMs[STATS_LEVELS] = STATS_SPANS_MS;
+
+/* Bin of a distance from the reference, on one side */
+static uint32_t ulStatsBin(uint32_t magnitude) {
+    uint32_t octave;
+
+    if (magnitude < STATS_LINEAR) {
+        return magnitude;
+    }
+    octave = 31 - (uint32_t)__builtin_clz(magnitude);
+    if (octave >= STATS_OCTAVES) {
+        return STATS_SIDE_BINS - 1;
+    }
+    return STATS_SUB * (octave - 2) + ((magnitude >> (octave - STATS_SUB_SHIFT)) & (STATS_SUB - 1));
+}
+
+/* Smallest distance in a bin */
+static uint32_t ulStatsBinLow(uint32_t bin) {
+    if (bin < STATS_LINEAR) {
+        return bin;
+    }
+    return (STATS_SUB + bin % STATS_SUB) << (bin / STATS_SUB + 2 - STATS_SUB_SHIFT);
+}
+
+static void vStatsEmpty(StatsWindow_t *pxWindow, uint32_t number) {
+    memset(pxWindow, 0, sizeof(*pxWindow));
+    pxWindow->number = number;
+}
+
+void vStatsInit(Stats_t *pxStats, int32_t reference) {
+    int level;
+
+    memset(pxStats, 0, sizeof(*pxStats));
+    pxStats->reference = reference;
+    for (level = 0; level < STATS_LEVELS; level++) {
+        pxStats->window[level][0].number = STATS_NO_WINDOW;
+        pxStats->window[level][1].number = STATS_NO_WINDOW;
+    }
+}
+
+void vStatsAdd(Stats_t *pxStats, int32_t value, TickType_t xNow) {
+    int64_t d = (int64_t)value - pxStats->reference;
+    uint32_t bin = d >= 0 ? STATS_SIDE_BINS + ulStatsBin(d > UINT32_MAX ? UINT32_MAX : (uint32_t)d)
+                          : STATS_SIDE_BINS - 1 - ulStatsBin(-d - 1 > UINT32_MAX ? UINT32_MAX : (uint32_t)(-d - 1));
+    uint32_t number;
+    StatsWindow_t *pxWindow;
+    int level;
+
+    vSeqWriteBegin(&pxStats->lock);
+    for (level = 0; level < STATS_LEVELS; level++) {
+        number = (uint32_t)xNow / ulSpanMs[level];
+        pxWindow = &pxStats->window[level][number & 1];
+        if (pxWindow->number != number) {
+            vStatsEmpty(pxWindow, number);
+        }
+        if (pxWindow->count == 0 || value < pxWindow->min) {
+            pxWindow->min = value;
+        }
+        if (pxWindow->count == 0 || value > pxWindow->max) {
+            pxWindow->max = value;
+        }
+        pxWindow->count++;
+        pxWindow->sum += d;
+        pxWindow->sum_sq += (uint64_t)(d * d);
+        pxWindow->bins[bin]++;
+    }
+    vSeqWriteEnd(&pxStats->lock);
+}
+
+int xStatsGet(const Stats_t *pxStats, int level, int xPrevious, TickType_t xNow, StatsWindow_t *pxCopy) {
+    uint32_t number = (uint32_t)xNow / ulSpanMs[level] - (xPrevious ? 1 : 0);
+
+    vSeqRead(&pxStats->lock, pxCopy, &pxStats->window[level][number & 1], sizeof(*pxCopy));
+    if (pxCopy->number != number || pxCopy->count == 0) {
+        vStatsEmpty(pxCopy, number);
+        return 0;
+    }
+    return 1;
+}
+
+int32_t lStatsMean(const Stats_t *pxStats, const StatsWindow_t *pxWindow) {
+    int64_t n = pxWindow->count;
+
+    if (n == 0) {
+        return 0;
+    }
+    return pxStats->reference + (int32_t)((pxWindow->sum >= 0 ? pxWindow->sum + n / 2 : pxWindow->sum - n / 2) / n);
+}
+
+static uint64_t ullStatsSqrt(uint64_t value) {
+    uint64_t root = 0, bit = 1ULL << 62;
+
+    while (bit > value) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+uint32_t ulStatsStddev(const StatsWindow_t *pxWindow) {
+    uint64_t n = pxWindow->count, s, q, r, spread, root;
+
+    if (n < 2) {
+        return 0;
+    }
+
+    /* sum_sq - sum^2 / n, with sum = q n + r so nothing overflows:
+     * sum^2 / n = q^2 n + 2 q r + r^2 / n */
+    s = pxWindow->sum >= 0 ? (uint64_t)pxWindow->sum : (uint64_t)-pxWindow->sum;
+    q = s / n;
+    r = s % n;
+    spread = pxWindow->sum_sq - (q * q * n + 2 * q * r + r * r / n);
+
+    /* Variance with 16 fraction bits while they fit, the root with 8 */
+    if (spread < (1ULL << 47)) {
+        root = ullStatsSqrt((spread << 16) / (n - 1));
+        return (uint32_t)((root + 128) >> 8);
+    }
+    return (uint32_t)ullStatsSqrt(spread / (n - 1));
+}
+
+int32_t lStatsQuantile(const Stats_t *pxStats, const StatsWindow_t *pxWindow, uint32_t per10k) {
+    uint64_t rank;
+    uint32_t i, seen = 0;
+    int64_t top;
+
+    if (pxWindow->count == 0) {
+        return 0;
+    }
+    rank = ((uint64_t)pxWindow->count * per10k + 9999) / 10000;
+    if (rank == 0) {
+        rank = 1;
+    }
+    for (i = 0; i < STATS_BINS - 1; i++) {
+        seen += pxWindow->bins[i];
+        if (seen >= rank) {
+            break;
+        }
+    }
+
+    /* Largest value the bin holds */
+    if (i >= STATS_SIDE_BINS) {
+        i -= STATS_SIDE_BINS;
+        top = i == STATS_SIDE_BINS - 1 ? INT32_MAX : (int64_t)ulStatsBinLow(i + 1) - 1;
+    } else {
+        top = -(int64_t)ulStatsBinLow(STATS_SIDE_BINS - 1 - i) - 1;
+    }
+    top += pxStats->reference;
+    if (top > pxWindow->max) {
+        top = pxWindow->max;
+    }
+    if (top < pxWindow->min) {
+        top = pxWindow->min;
+    }
+    return (int32_t)top;
+}
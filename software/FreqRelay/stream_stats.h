@@ -0,0 +1,80 @@
+/**
+ * Streaming statistics over minute, hour and day windows
+ *
+ * Each sample of a stream (a feeder's frequency in mHz, the shed latency
+ * in us) is folded into the window of every level it falls in: count,
+ * minimum, maximum, sum and sum of squares about the stream's reference,
+ * and a log-bucket histogram of the value against the reference, eight
+ * bins per doubling either side of it (one unit wide below 8) out to
+ * 2^STATS_OCTAVES. A sample costs the same few increments whatever the
+ * window holds; nothing is stored per sample and nothing is sorted.
+ *
+ * The sums are exact integers taken about the reference, so the variance
+ * comes out without the cancellation Welford's update exists to avoid,
+ * and without a division per sample. A day of 50 Hz samples within 2 Hz
+ * of nominal, or of latencies under a second, is far inside 64 bits.
+ *
+ * Quantiles come from the histogram: the top of the bin the rank falls in,
+ * so within an eighth of the distance from the reference, never below the
+ * true value; then held inside the window's min and max.
+ *
+ * A level keeps two windows, the one filling and the one before it, told
+ * apart by window number (tick / span), so a window starting is a reset of
+ * the older slot rather than a copy. Single writer per stream; readers copy
+ * a window under the stream's sequence lock, never blocking the writer.
+ */
+
+#ifndef STREAM_STATS_H
+#define STREAM_STATS_H
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "seqlock.h"
+
+#define STATS_LEVELS                   3
+#define STATS_LEVEL_MINUTE             0
+#define STATS_LEVEL_HOUR               1
+#define STATS_LEVEL_DAY                2
+#define STATS_SPANS_MS                 { 60000UL, 3600000UL, 86400000UL }
+
+#define STATS_SUB                      8      // Bins per doubling
+#define STATS_OCTAVES                  24     // Either side of the reference
+#define STATS_SIDE_BINS                (STATS_SUB * (STATS_OCTAVES - 2))  // Last also counts overflows
+#define STATS_BINS                     (2 * STATS_SIDE_BINS)              // Below the reference, then above
+#define STATS_NO_WINDOW                0xFFFFFFFFUL
+
+typedef struct {
+    uint32_t number;                   // tick / span, STATS_NO_WINDOW before the first sample
+    uint32_t count;
+    int32_t min;
+    int32_t max;
+    int64_t sum;                       // Of value - reference
+    uint64_t sum_sq;                   // Of (value - reference)^2
+    uint32_t bins[STATS_BINS];
+} StatsWindow_t;
+
+typedef struct {
+    int32_t reference;                 // Histogram centre, nominal or expected value
+    SeqLock_t lock;
+    StatsWindow_t window[STATS_LEVELS][2];  // By window number parity
+} Stats_t;
+
+/* Empty every window. Before the first sample. */
+void vStatsInit(Stats_t *pxStats, int32_t reference);
+
+/* Add one sample taken at xNow (single writer per stream) */
+void vStatsAdd(Stats_t *pxStats, int32_t value, TickType_t xNow);
+
+/* Copy of the window of a level current at xNow, or with xPrevious the one
+ * before it. Returns 0, the copy emptied, if it had no samples. */
+int xStatsGet(const Stats_t *pxStats, int level, int xPrevious, TickType_t xNow, StatsWindow_t *pxCopy);
+
+/* Mean and sample standard deviation of a window copy, rounded, 0 when empty */
+int32_t lStatsMean(const Stats_t *pxStats, const StatsWindow_t *pxWindow);
+uint32_t ulStatsStddev(const StatsWindow_t *pxWindow);
+
+/* Value at or below which per10k ten-thousandths of the window's samples
+ * fall (9900 for p99, 9990 for p99.9), to the histogram's resolution */
+int32_t lStatsQuantile(const Stats_t *pxStats, const StatsWindow_t *pxWindow, uint32_t per10k);
+
+#endif /* STREAM_STATS_H */
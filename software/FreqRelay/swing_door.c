@@ -0,0 +1,136 @@
+/**
+ * Swinging door compression of sampled signals
+ *
+ * See swing_door.h.
+ */
+
+/* Standard includes */
+#include <string.h>
+
+/* Application includes */
+#include "swing_door.h"
+#include "latency.h"
+
+void vSwingStageInit(SwingStage_t *pxStage, uint32_t signals, const int32_t *plTolerance, uint32_t max_us) {
+    uint32_t i;
+
+    memset(pxStage, 0, sizeof(*pxStage));
+    pxStage->signals = signals < SWING_SIGNALS ? signals : SWING_SIGNALS;
+    for (i = 0; i < pxStage->signals; i++) {
+        pxStage->tolerance[i] = plTolerance[i];
+    }
+    pxStage->max_us = max_us;
+}
+
+/* dv_a / dt_a < dv_b / dt_b, both dt non-zero */
+static inline int xSlopeBelow(int32_t dv_a, uint32_t dt_a, int32_t dv_b, uint32_t dt_b) {
+    return (int64_t)dv_a * dt_b < (int64_t)dv_b * dt_a;
+}
+
+/* Doors for the first sample of a segment */
+static void vSwingOpen(SwingStage_t *pxStage, const SwingPoint_t *pxSample, uint32_t dt) {
+    SwingDoor_t *pxDoor;
+    int32_t dv;
+    uint32_t i;
+
+    for (i = 0; i < pxStage->signals; i++) {
+        pxDoor = &pxStage->door[i];
+        dv = pxSample->value[i] - pxStage->origin.value[i];
+        pxDoor->low_dv = dv - pxStage->tolerance[i];
+        pxDoor->low_dt = dt;
+        pxDoor->high_dv = dv + pxStage->tolerance[i];
+        pxDoor->high_dt = dt;
+    }
+}
+
+/* Non-zero if the line from the origin to the sample stays inside every
+ * door, so the segment can be extended to it */
+static int xSwingFits(const SwingStage_t *pxStage, const SwingPoint_t *pxSample, uint32_t dt) {
+    const SwingDoor_t *pxDoor;
+    int32_t dv;
+    uint32_t i;
+
+    for (i = 0; i < pxStage->signals; i++) {
+        pxDoor = &pxStage->door[i];
+        dv = pxSample->value[i] - pxStage->origin.value[i];
+        if (xSlopeBelow(dv, dt, pxDoor->low_dv, pxDoor->low_dt) ||
+            xSlopeBelow(pxDoor->high_dv, pxDoor->high_dt, dv, dt)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Swing the doors shut on a sample of the segment */
+static void vSwingNarrow(SwingStage_t *pxStage, const SwingPoint_t *pxSample, uint32_t dt) {
+    SwingDoor_t *pxDoor;
+    int32_t dv;
+    uint32_t i;
+
+    for (i = 0; i < pxStage->signals; i++) {
+        pxDoor = &pxStage->door[i];
+        dv = pxSample->value[i] - pxStage->origin.value[i];
+        if (xSlopeBelow(pxDoor->low_dv, pxDoor->low_dt, dv - pxStage->tolerance[i], dt)) {
+            pxDoor->low_dv = dv - pxStage->tolerance[i];
+            pxDoor->low_dt = dt;
+        }
+        if (xSlopeBelow(dv + pxStage->tolerance[i], dt, pxDoor->high_dv, pxDoor->high_dt)) {
+            pxDoor->high_dv = dv + pxStage->tolerance[i];
+            pxDoor->high_dt = dt;
+        }
+    }
+}
+
+uint32_t ulSwingStageAdd(SwingStage_t *pxStage, const SwingPoint_t *pxSample, SwingPoint_t pxOut[2]) {
+    uint32_t n = 0, dt;
+
+    pxStage->samples++;
+    if (!pxStage->xStarted || pxSample->flags != pxStage->last.flags) {
+        /* Flags are kept exactly: the sample before the change ends the
+         * segment and the change starts the next one */
+        if (pxStage->xPending) {
+            pxOut[n++] = pxStage->last;
+        }
+        pxOut[n++] = *pxSample;
+        pxStage->xStarted = 1;
+        pxStage->xPending = 0;
+        pxStage->origin = *pxSample;
+        pxStage->last = *pxSample;
+        pxStage->breakpoints += n;
+        return n;
+    }
+
+    dt = ulLatencyElapsedUs(pxStage->origin.stamp, pxSample->stamp);
+    if (dt == 0) {
+        dt = 1;
+    }
+    if (!pxStage->xPending) {
+        if (dt <= pxStage->max_us) {
+            vSwingOpen(pxStage, pxSample, dt);
+            pxStage->last = *pxSample;
+            pxStage->xPending = 1;
+            return 0;
+        }
+        /* Nothing since the breakpoint for max_us: this one is the next */
+        pxOut[n++] = *pxSample;
+        pxStage->origin = *pxSample;
+        pxStage->last = *pxSample;
+        pxStage->breakpoints += n;
+        return n;
+    }
+
+    if (dt <= pxStage->max_us && xSwingFits(pxStage, pxSample, dt)) {
+        vSwingNarrow(pxStage, pxSample, dt);
+        pxStage->last = *pxSample;
+        return 0;
+    }
+
+    /* The segment ends at the last sample, the next starts there */
+    pxOut[n++] = pxStage->last;
+    pxStage->origin = pxStage->last;
+    pxStage->last = *pxSample;
+    dt = ulLatencyElapsedUs(pxStage->origin.stamp, pxSample->stamp);
+    vSwingOpen(pxStage, pxSample, dt == 0 ? 1 : dt);
+    pxStage->breakpoints += n;
+    return n;
+}
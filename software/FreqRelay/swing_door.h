@@ -0,0 +1,72 @@
+/**
+ * Swinging door compression of sampled signals
+ *
+ * A stage sits in front of a stream of samples (a feeder's frequency and
+ * RoC, the load state) and passes on only breakpoints: samples such that
+ * the straight line between two consecutive breakpoints is within each
+ * signal's tolerance of every sample dropped between them. Joining the
+ * breakpoints up reconstructs the signal to that tolerance, exactly
+ * bounded, not on average.
+ *
+ * For the segment from the last breakpoint, each sample since narrows the
+ * range of slopes that keep it inside its tolerance (the doors). A new
+ * sample whose slope from the breakpoint is still inside the range extends
+ * the segment and narrows it further; one outside it makes the sample
+ * before it the next breakpoint. Slopes are kept as fractions and compared
+ * cross-multiplied, so there is no division per sample. A tolerance of 0
+ * drops only samples exactly on the line, and is lossless.
+ *
+ * Flags (feeder, stable, a load bit pattern) are not interpolated: a sample
+ * whose flags differ from the last one is a breakpoint itself, with the
+ * sample before it, so flag changes are never lost or moved. A segment is
+ * also closed after max_us, so a steady signal still shows up that often.
+ *
+ * A breakpoint is known one sample late, so each carries its own timestamp
+ * and the consumer posts it with that (vTelemetryPostAt()). One stage per
+ * stream, used by its single writer.
+ */
+
+#ifndef SWING_DOOR_H
+#define SWING_DOOR_H
+
+#include <stdint.h>
+
+#define SWING_SIGNALS                  2      // Signals a stage carries at most
+
+/* One sample of a stage's signals */
+typedef struct {
+    int32_t value[SWING_SIGNALS];
+    uint32_t flags;
+    uint32_t stamp;                    // Timestamp count
+} SwingPoint_t;
+
+/* Slope bounds of one signal for the current segment, as dv / dt */
+typedef struct {
+    int32_t low_dv;
+    uint32_t low_dt;
+    int32_t high_dv;
+    uint32_t high_dt;
+} SwingDoor_t;
+
+typedef struct {
+    uint32_t signals;
+    int32_t tolerance[SWING_SIGNALS];
+    uint32_t max_us;                   // Longest segment
+    int xStarted;
+    int xPending;                      // last is not a breakpoint yet
+    SwingPoint_t origin;               // Last breakpoint
+    SwingPoint_t last;                 // Last sample
+    SwingDoor_t door[SWING_SIGNALS];
+    uint32_t samples;
+    uint32_t breakpoints;
+} SwingStage_t;
+
+/* Empty stage of signals signals (0 for flags only), with their tolerances
+ * in the signals' own units */
+void vSwingStageInit(SwingStage_t *pxStage, uint32_t signals, const int32_t *plTolerance, uint32_t max_us);
+
+/* Add a sample. Returns the breakpoints it settles, 0, 1 or 2, oldest first
+ * in pxOut[]. */
+uint32_t ulSwingStageAdd(SwingStage_t *pxStage, const SwingPoint_t *pxSample, SwingPoint_t pxOut[2]);
+
+#endif /* SWING_DOOR_H */
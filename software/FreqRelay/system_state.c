@@ -0,0 +1,51 @@
+/**
+ * System state flags
+ *
+ * See system_state.h.
+ */
+
+/* Scheduler includes */
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+
+/* Application includes */
+#include "system_state.h"
+
+static EventGroupHandle_t xState = NULL;
+
+int xStateInit(void) {
+    xState = xEventGroupCreate();
+    return xState != NULL ? 0 : -1;
+}
+
+void vStateSet(EventBits_t flags) {
+    if ((xEventGroupGetBits(xState) & flags) != flags) {
+        xEventGroupSetBits(xState, flags | STATE_CHANGED);
+    }
+}
+
+void vStateClear(EventBits_t flags) {
+    /* Returns the bits before the clear */
+    if (xEventGroupClearBits(xState, flags) & flags) {
+        xEventGroupSetBits(xState, STATE_CHANGED);
+    }
+}
+
+BaseType_t xStateSetFromISR(EventBits_t flags, BaseType_t *pxHigherPriorityTaskWoken) {
+    if ((xEventGroupGetBitsFromISR(xState) & flags) == flags) {
+        return pdPASS;
+    }
+    return xEventGroupSetBitsFromISR(xState, flags | STATE_CHANGED, pxHigherPriorityTaskWoken);
+}
+
+EventBits_t xStateGet(void) {
+    return xEventGroupGetBits(xState) & STATE_FLAGS;
+}
+
+EventBits_t xStateGetFromISR(void) {
+    return xEventGroupGetBitsFromISR(xState) & STATE_FLAGS;
+}
+
+EventBits_t xStateWaitChange(TickType_t xTimeout) {
+    return xEventGroupWaitBits(xState, STATE_CHANGED, pdTRUE, pdFALSE, xTimeout) & STATE_FLAGS;
+}
@@ -0,0 +1,58 @@
+/**
+ * System state flags
+ *
+ * Alert, failsafe and override are bits in one event group rather than
+ * flags polled under a lock. Tasks and ISRs set and clear them (ISRs
+ * through xEventGroupSetBitsFromISR(), which the timer daemon completes),
+ * readers take all of them in one word, and every change also sets
+ * STATE_CHANGED so one task can block until the state moves instead of
+ * sampling it each period.
+ */
+
+#ifndef SYSTEM_STATE_H
+#define SYSTEM_STATE_H
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+
+/* Flags, in the order of the telemetry state record */
+#define STATE_ALERT                    0x01  // Shedding, unstable feeder or late control task
+#define STATE_FAILSAFE                 0x02  // Critical load only until a reset
+#define STATE_OVERRIDE                 0x04  // Slide switches drive the loads
+#define STATE_FLAGS                    (STATE_ALERT | STATE_FAILSAFE | STATE_OVERRIDE)
+#define STATE_CHANGED                  0x08  // Set with every change, cleared by xStateWaitChange()
+
+/* Overall state, the most severe flag */
+#define STATUS_NORMAL                  0
+#define STATUS_ALERT                   1
+#define STATUS_FAILSAFE                2
+
+/* Create the event group with every flag clear, before the scheduler
+ * starts. Returns 0 on success. */
+int xStateInit(void);
+
+/* From task context. Only a flag that actually changes counts as a change. */
+void vStateSet(EventBits_t flags);
+void vStateClear(EventBits_t flags);
+
+/* From an ISR at or below configMAX_SYSCALL_INTERRUPT_PRIORITY. Readers see
+ * the flags once the daemon has run; returns pdFAIL if its queue is full. */
+BaseType_t xStateSetFromISR(EventBits_t flags, BaseType_t *pxHigherPriorityTaskWoken);
+
+/* The flags now */
+EventBits_t xStateGet(void);
+EventBits_t xStateGetFromISR(void);
+
+/* STATUS_* for a set of flags */
+static inline uint8_t ucStateLevel(EventBits_t flags) {
+    if (flags & STATE_FAILSAFE) {
+        return STATUS_FAILSAFE;
+    }
+    return (flags & STATE_ALERT) ? STATUS_ALERT : STATUS_NORMAL;
+}
+
+/* Block until the flags change or xTimeout passes, and return them. One
+ * task only, a change before the call is reported at once. */
+EventBits_t xStateWaitChange(TickType_t xTimeout);
+
+#endif /* SYSTEM_STATE_H */
@@ -0,0 +1,535 @@
+/**
+ * Nonblocking telemetry over the JTAG UART
+ *
+ * See telemetry.h.
+ */
+
+/* Standard includes */
+#include <fcntl.h>
+#include <unistd.h>
+
+/* Scheduler includes */
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+/* Hardware includes */
+#include "system.h"
+#include "sys/alt_irq.h"
+
+/* Application includes */
+#include "latency.h"
+#include "telemetry.h"
+#include "time_base.h"
+
+/* Free-running indices as in the other rings, but with any number of
+ * producers: head is claimed and the record copied with interrupts masked.
+ * One per QoS class. */
+typedef struct {
+    uint32_t head;
+    volatile uint32_t tail;
+    uint32_t dropped;                  // Including thinned
+    uint32_t thinned;                  // Samples dropped to make room
+    uint32_t high_water;               // Most records ever waiting
+    uint32_t size;                     // Records, power of 2
+    TelemetryRecord_t *record;
+} TelemetryRing_t;
+
+static TelemetryRecord_t xEventRecords[TELEMETRY_EVENT_RING_SIZE];
+static TelemetryRecord_t xLatencyRecords[TELEMETRY_LATENCY_RING_SIZE];
+static TelemetryRecord_t xSampleRecords[TELEMETRY_SAMPLE_RING_SIZE];
+static TelemetryRing_t xRings[TELEMETRY_CLASSES] = {
+    { 0, 0, 0, 0, 0, TELEMETRY_EVENT_RING_SIZE, xEventRecords },
+    { 0, 0, 0, 0, 0, TELEMETRY_LATENCY_RING_SIZE, xLatencyRecords },
+    { 0, 0, 0, 0, 0, TELEMETRY_SAMPLE_RING_SIZE, xSampleRecords },
+};
+static uint8_t ucThin = 0;             // Alternates while samples are thinned
+
+/* Class of each record type, TELEMETRY_CLASS_EVENT for those not listed */
+static const uint8_t ucTypeClass[TELEMETRY_QUEUE + 1] = {
+    [TELEMETRY_FREQ] = TELEMETRY_CLASS_SAMPLE,
+    [TELEMETRY_LATENCY] = TELEMETRY_CLASS_LATENCY,
+    [TELEMETRY_WCET] = TELEMETRY_CLASS_LATENCY,
+};
+static const uint8_t ucClassWeight[TELEMETRY_CLASSES] = TELEMETRY_CLASS_WEIGHTS;
+
+static SemaphoreHandle_t xUartMutex = NULL;
+static int iUartFd = -1;
+
+/* Drain task only: the encoded batch and how far it has got */
+static uint8_t ucBatch[TELEMETRY_BATCH_BYTES];
+static uint32_t ulBatchBytes = 0;
+static uint32_t ulBatchSent = 0;
+static uint32_t ulBatchRecords = 0;
+static uint32_t ulSent = 0;
+static uint8_t ucCredit[TELEMETRY_CLASSES];  // Frames left in the weighted round
+static TelemetryExport_t pxExportSources[TELEMETRY_EXPORT_SOURCES];
+static uint32_t ulExportSources = 0;
+static volatile uint8_t xExportsPaused = 0;
+static const TelemetrySink_t *pxSinkOut = NULL;
+
+/* Encoder time base: timestamp and absolute time of the previous frame */
+static int xTimeBaseValid = 0;
+static uint32_t ulLastStamp;
+static uint32_t ulTimeUs;
+static uint32_t ulFramesToTime = 0;
+static uint32_t ulDroppedReported = 0;
+
+/* CRC-16/CCITT-FALSE, one nibble at a time */
+static const uint16_t usCrcNibble[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+int xTelemetryInit(void) {
+    uint32_t i;
+
+    for (i = 0; i < TELEMETRY_CLASSES; i++) {
+        xRings[i].head = 0;
+        xRings[i].tail = 0;
+        xRings[i].dropped = 0;
+        xRings[i].thinned = 0;
+        xRings[i].high_water = 0;
+        ucCredit[i] = 0;
+    }
+
+    xUartMutex = xSemaphoreCreateMutex();
+    if (xUartMutex != NULL) {
+        vQueueAddToRegistry(xUartMutex, "UartMtx");
+    }
+    iUartFd = open(JTAG_UART_NAME, O_WRONLY | O_NONBLOCK);
+    return (xUartMutex == NULL || iUartFd < 0) ? -1 : 0;
+}
+
+/* xNow: stamped inside the masked section, so such records stay in time
+ * order in their ring */
+static void vTelemetryPut(uint8_t type, int xNow, uint32_t stamp, uint32_t a, uint32_t b, uint32_t c) {
+    alt_irq_context context;
+    TelemetryRing_t *pxRing = &xRings[type <= TELEMETRY_QUEUE ? ucTypeClass[type] : TELEMETRY_CLASS_EVENT];
+    TelemetryRecord_t *pxRecord;
+    uint32_t waiting;
+
+    context = alt_irq_disable_all();
+    waiting = pxRing->head - pxRing->tail;
+    if (waiting >= pxRing->size) {
+        pxRing->dropped++;
+    } else if (pxRing == &xRings[TELEMETRY_CLASS_SAMPLE] && waiting >= TELEMETRY_SAMPLE_THIN &&
+               (ucThin ^= 1) != 0) {
+        /* Backing up: every other sample goes, so the rest still span
+         * the time until the drain catches up */
+        pxRing->dropped++;
+        pxRing->thinned++;
+    } else {
+        pxRecord = &pxRing->record[pxRing->head & (pxRing->size - 1)];
+        pxRecord->type = type;
+        pxRecord->stamp = xNow ? ulLatencyNow() : stamp;
+        pxRecord->a = a;
+        pxRecord->b = b;
+        pxRecord->c = c;
+        pxRing->head++;
+        if ((pxRing->head - pxRing->tail) > pxRing->high_water) {
+            pxRing->high_water = pxRing->head - pxRing->tail;
+        }
+    }
+    alt_irq_enable_all(context);
+}
+
+void vTelemetryPost(uint8_t type, uint32_t a, uint32_t b, uint32_t c) {
+    vTelemetryPut(type, 1, 0, a, b, c);
+}
+
+void vTelemetryPostAt(uint8_t type, uint32_t stamp, uint32_t a, uint32_t b, uint32_t c) {
+    vTelemetryPut(type, 0, stamp, a, b, c);
+}
+
+static uint16_t usTelemetryCrc(const uint8_t *pucData, uint32_t len) {
+    uint16_t crc = 0xFFFF;
+
+    while (len--) {
+        crc = (uint16_t)((crc << 4) ^ usCrcNibble[(crc >> 12) ^ (*pucData >> 4)]);
+        crc = (uint16_t)((crc << 4) ^ usCrcNibble[(crc >> 12) ^ (*pucData & 0x0F)]);
+        pucData++;
+    }
+    return crc;
+}
+
+static uint8_t *pucPut16(uint8_t *pucOut, uint32_t value) {
+    pucOut[0] = (uint8_t)value;
+    pucOut[1] = (uint8_t)(value >> 8);
+    return pucOut + 2;
+}
+
+static uint8_t *pucPut32(uint8_t *pucOut, uint32_t value) {
+    return pucPut16(pucPut16(pucOut, value), value >> 16);
+}
+
+static uint32_t ulSaturate16(uint32_t value) {
+    return value > 0xFFFF ? 0xFFFF : value;
+}
+
+/* A signed Q16.16 value in units of 1/scale, saturated to 16 bits */
+static int32_t lTelemetryScale16(int32_t value, int32_t scale) {
+    int32_t scaled = (int32_t)(((int64_t)value * scale) >> 16);
+
+    return scaled > 32767 ? 32767 : (scaled < -32768 ? -32768 : scaled);
+}
+
+/* Frame around a payload already written at pucOut + 5. Returns its length. */
+static uint32_t ulTelemetryFrame(uint8_t *pucOut, uint8_t type, uint32_t delta_us, uint8_t *pucEnd) {
+    pucPut16(pucOut, TELEMETRY_SYNC);
+    pucOut[2] = (uint8_t)((TELEMETRY_VERSION << 5) | type);
+    pucPut16(pucOut + 3, delta_us);
+    pucEnd = pucPut16(pucEnd, usTelemetryCrc(pucOut + 2, (uint32_t)(pucEnd - (pucOut + 2))));
+    return (uint32_t)(pucEnd - pucOut);
+}
+
+/* Move the time base on to stamp for the next frame, writing a time base
+ * frame first when one is due or forced. Returns its length; *pulDelta is
+ * the next frame's delta. */
+static uint32_t ulTelemetryTimeBase(uint8_t *pucOut, uint32_t stamp, int xForce, uint32_t *pulDelta) {
+    uint32_t len = 0, delta_us, counts_per_us = ulLatencyCountsPerUs();
+    uint8_t *p;
+
+    if (!xTimeBaseValid) {
+        xTimeBaseValid = 1;
+        ulLastStamp = stamp;
+        ulTimeUs = (uint32_t)ullTimeToUs(ullTimeExtend(stamp));
+        ulFramesToTime = 0;
+    }
+
+    /* A record stamped before the last one (vTelemetryPostAt()) restarts
+     * the time base there */
+    if ((int32_t)(stamp - ulLastStamp) < 0) {
+        ulLastStamp = stamp;
+        ulTimeUs = (uint32_t)ullTimeToUs(ullTimeExtend(stamp));
+        xForce = 1;
+    }
+
+    /* Advance in whole microseconds so the remainder carries over */
+    delta_us = ulLatencyElapsedUs(ulLastStamp, stamp);
+    ulLastStamp += delta_us * counts_per_us;
+    ulTimeUs += delta_us;
+
+    if (ulFramesToTime == 0 || delta_us > 0xFFFF || xForce) {
+        p = pucPut32(pucOut + 5, ulTimeUs);
+        len = ulTelemetryFrame(pucOut, TELEMETRY_TIME, 0, p);
+        ulFramesToTime = TELEMETRY_TIME_EVERY;
+        delta_us = 0;
+    }
+    ulFramesToTime--;
+    *pulDelta = delta_us;
+    return len;
+}
+
+/* Encode one export chunk, stamped now, with the time base frame. pucOut
+ * has room for TELEMETRY_FRAME_MAX and TELEMETRY_CHUNK_FRAME. */
+static uint32_t ulTelemetryEncodeChunk(uint8_t *pucOut, const TelemetryChunk_t *pxChunk) {
+    uint32_t len, delta_us, i;
+    uint8_t *p;
+
+    len = ulTelemetryTimeBase(pucOut, ulLatencyNow(), 0, &delta_us);
+    pucOut += len;
+    p = pucOut + 5;
+    p = pucPut16(p, pxChunk->record);
+    *p++ = pxChunk->part;
+    p = pucPut32(p, pxChunk->offset);
+    *p++ = pxChunk->length;
+    for (i = 0; i < TELEMETRY_CHUNK_BYTES; i++) {
+        *p++ = i < pxChunk->length ? pxChunk->data[i] : 0;
+    }
+    return len + ulTelemetryFrame(pucOut, TELEMETRY_EXPORT, delta_us, p);
+}
+
+/* Encode one ring entry, preceded by a time base frame when one is due.
+ * pucOut has room for two TELEMETRY_FRAME_MAX frames. */
+static uint32_t ulTelemetryEncode(uint8_t *pucOut, const TelemetryRecord_t *pxRecord) {
+    uint32_t len, delta_us;
+    uint8_t *p;
+
+    len = ulTelemetryTimeBase(pucOut, pxRecord->stamp, pxRecord->type == TELEMETRY_TIME, &delta_us);
+    if (pxRecord->type == TELEMETRY_TIME) {
+        return len;
+    }
+
+    pucOut += len;
+    p = pucOut + 5;
+    switch (pxRecord->type) {
+    case TELEMETRY_FREQ:
+        p = pucPut16(p, ulSaturate16((uint32_t)(((uint64_t)pxRecord->a * 1000) >> 16)));
+        p = pucPut16(p, (uint32_t)lTelemetryScale16((int32_t)pxRecord->b, 100));
+        *p++ = (uint8_t)pxRecord->c;
+        break;
+    case TELEMETRY_FAULT:
+        p = pucPut16(p, pxRecord->a);
+        p = pucPut16(p, pxRecord->b);
+        p = pucPut16(p, pxRecord->c);
+        break;
+    case TELEMETRY_STATE:
+        *p++ = (uint8_t)pxRecord->a;
+        *p++ = (uint8_t)pxRecord->b;
+        break;
+    case TELEMETRY_LATENCY:
+        *p++ = (uint8_t)pxRecord->a;
+        p = pucPut32(p, pxRecord->b);
+        p = pucPut16(p, ulSaturate16(pxRecord->c / 1000));
+        break;
+    case TELEMETRY_LOST:
+        p = pucPut16(p, pxRecord->a);
+        break;
+    case TELEMETRY_INJECT:
+        *p++ = (uint8_t)pxRecord->a;
+        p = pucPut16(p, pxRecord->b);
+        p = pucPut32(p, pxRecord->c);
+        break;
+    case TELEMETRY_TRACE:
+        p = pucPut16(p, (uint32_t)lTelemetryScale16((int32_t)pxRecord->a, 1000));
+        p = pucPut16(p, (uint32_t)lTelemetryScale16((int32_t)pxRecord->b, 100));
+        *p++ = (uint8_t)pxRecord->c;
+        *p++ = (uint8_t)(pxRecord->c >> 8);
+        p = pucPut16(p, pxRecord->c >> 16);
+        break;
+    case TELEMETRY_HEALTH:
+        p = pucPut32(p, pxRecord->a);
+        p = pucPut32(p, pxRecord->b);
+        break;
+    case TELEMETRY_QUEUE:
+        *p++ = (uint8_t)pxRecord->a;
+        *p++ = (uint8_t)(pxRecord->a >> 8);
+        p = pucPut16(p, pxRecord->b >> 16);
+        p = pucPut16(p, pxRecord->b);
+        *p++ = (uint8_t)(pxRecord->c >> 8);
+        *p++ = (uint8_t)pxRecord->c;
+        break;
+    case TELEMETRY_LOG:
+    case TELEMETRY_WCET:
+        *p++ = (uint8_t)pxRecord->a;
+        p = pucPut32(p, pxRecord->b);
+        p = pucPut32(p, pxRecord->c);
+        break;
+    default:
+        /* TELEMETRY_DECISION */
+        p = pucPut16(p, pxRecord->a);
+        p = pucPut16(p, pxRecord->b);
+        break;
+    }
+    return len + ulTelemetryFrame(pucOut, pxRecord->type, delta_us, p);
+}
+
+int xTelemetryAddExport(TelemetryExport_t pxExport) {
+    if (ulExportSources >= TELEMETRY_EXPORT_SOURCES) {
+        return -1;
+    }
+    pxExportSources[ulExportSources++] = pxExport;
+    return 0;
+}
+
+void vTelemetryPauseExports(int xPause) {
+    xExportsPaused = xPause != 0;
+}
+
+/* The next chunk from the first source that has one, none while paused */
+static int xTelemetryNextChunk(TelemetryChunk_t *pxChunk) {
+    uint32_t i;
+
+    if (xExportsPaused) {
+        return 0;
+    }
+    for (i = 0; i < ulExportSources; i++) {
+        if (pxExportSources[i](pxChunk)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void vTelemetrySetSink(const TelemetrySink_t *pxSink) {
+    pxSinkOut = pxSink;
+}
+
+/* The class to send the next record from, -1 with every ring empty. While
+ * all that waits fits in room the oldest record goes first, so the frames
+ * keep time order. Past that, a weighted round: each class in turn, most
+ * important first, sends up to its weight while it has records, so events
+ * get through a backlog of samples at once and samples still get a share. */
+static int xTelemetryPick(uint32_t room) {
+    const TelemetryRing_t *pxRing;
+    uint32_t cls, waiting = 0, stamp = 0;
+    int oldest = -1;
+
+    for (cls = 0; cls < TELEMETRY_CLASSES; cls++) {
+        pxRing = &xRings[cls];
+        if (pxRing->head != pxRing->tail) {
+            waiting += pxRing->head - pxRing->tail;
+            if (oldest < 0 || (int32_t)(pxRing->record[pxRing->tail & (pxRing->size - 1)].stamp - stamp) < 0) {
+                oldest = (int)cls;
+                stamp = pxRing->record[pxRing->tail & (pxRing->size - 1)].stamp;
+            }
+        }
+    }
+    if (oldest < 0 || waiting * TELEMETRY_FRAME_MAX <= room) {
+        return oldest;
+    }
+
+    /* Some class has records, so a second pass after the refill finds one */
+    for (;;) {
+        for (cls = 0; cls < TELEMETRY_CLASSES; cls++) {
+            if (ucCredit[cls] != 0 && xRings[cls].head != xRings[cls].tail) {
+                ucCredit[cls]--;
+                return (int)cls;
+            }
+        }
+        for (cls = 0; cls < TELEMETRY_CLASSES; cls++) {
+            ucCredit[cls] = ucClassWeight[cls];
+        }
+    }
+}
+
+/* Encode into pucOut what is waiting and fits in cap bytes: records,
+ * then a time base or loss report, then export chunks while the rings are
+ * empty and *pulChunks is under limit. Returns the bytes written, with the
+ * records taken in *pulRecords. */
+static uint32_t ulTelemetryFill(uint8_t *pucOut, uint32_t cap, uint32_t *pulRecords, uint32_t *pulChunks,
+                                uint32_t limit) {
+    TelemetryRecord_t record;
+    TelemetryChunk_t chunk;
+    TelemetryRing_t *pxRing;
+    uint32_t count = 0, dropped, bytes = 0;
+    int cls;
+
+    while (bytes + 2 * TELEMETRY_FRAME_MAX <= cap && (cls = xTelemetryPick(cap - bytes)) >= 0) {
+        pxRing = &xRings[cls];
+        record = pxRing->record[pxRing->tail & (pxRing->size - 1)];
+        pxRing->tail++;
+        bytes += ulTelemetryEncode(pucOut + bytes, &record);
+        count++;
+    }
+    *pulRecords = count;
+
+    /* Keep the time base ahead of the 43 s counter wrap while idle */
+    if (count == 0 && xTimeBaseValid &&
+        ulLatencyElapsedUs(ulLastStamp, ulLatencyNow()) >= TELEMETRY_IDLE_TIME_US) {
+        record.type = TELEMETRY_TIME;
+        record.stamp = ulLatencyNow();
+        bytes += ulTelemetryEncode(pucOut, &record);
+    }
+
+    /* Records are only dropped while a ring is full or backing up, so the
+     * loss follows what was in it. Reported at the last record's time. */
+    dropped = ulTelemetryDropped() - ulDroppedReported;
+    if (dropped != 0) {
+        record.type = TELEMETRY_LOST;
+        record.stamp = xTimeBaseValid ? ulLastStamp : ulLatencyNow();
+        record.a = ulSaturate16(dropped);
+        ulDroppedReported += record.a;
+        bytes += ulTelemetryEncode(pucOut + bytes, &record);
+    }
+
+    /* Exports, the bulk class, fill what the records leave idle */
+    while (count == 0 && *pulChunks < limit && bytes + TELEMETRY_FRAME_MAX + TELEMETRY_CHUNK_FRAME <= cap &&
+           xTelemetryNextChunk(&chunk)) {
+        bytes += ulTelemetryEncodeChunk(pucOut + bytes, &chunk);
+        (*pulChunks)++;
+    }
+    return bytes;
+}
+
+/* Straight into the sink's buffers, a datagram each, no copy */
+static uint32_t ulTelemetryDrainSink(void) {
+    uint8_t *pucOut;
+    uint32_t cap, bytes, records, chunks = 0, start = ulSent;
+
+    for (;;) {
+        pucOut = pxSinkOut->pxBegin(&cap);
+        if (pucOut == NULL) {
+            break;
+        }
+        bytes = ulTelemetryFill(pucOut, cap, &records, &chunks, TELEMETRY_SINK_EXPORT_PER_DRAIN);
+        pxSinkOut->pxSend(pucOut, bytes);
+        ulSent += records;
+        if (bytes == 0) {
+            break;
+        }
+    }
+    return ulSent - start;
+}
+
+uint32_t ulTelemetryDrain(void) {
+    uint32_t chunks = 0, start = ulSent;
+    int written;
+
+    if (pxSinkOut != NULL) {
+        return ulTelemetryDrainSink();
+    }
+    if (iUartFd < 0 || xTelemetryUartTake(0) != pdTRUE) {
+        return 0;
+    }
+
+    for (;;) {
+        /* Refill once the previous batch is fully out */
+        if (ulBatchSent == ulBatchBytes) {
+            ulSent += ulBatchRecords;
+            ulBatchSent = 0;
+            ulBatchBytes = ulTelemetryFill(ucBatch, TELEMETRY_BATCH_BYTES, &ulBatchRecords, &chunks,
+                                           TELEMETRY_EXPORT_PER_DRAIN);
+            if (ulBatchBytes == 0) {
+                break;
+            }
+        }
+
+        /* Takes what fits in the driver buffer, or fails with EWOULDBLOCK */
+        written = write(iUartFd, ucBatch + ulBatchSent, ulBatchBytes - ulBatchSent);
+        if (written <= 0) {
+            break;
+        }
+        ulBatchSent += (uint32_t)written;
+    }
+
+    vTelemetryUartGive();
+    return ulSent - start;
+}
+
+BaseType_t xTelemetryUartTake(TickType_t xTicksToWait) {
+    /* Nothing to serialise with before the drain is set up */
+    if (xUartMutex == NULL) {
+        return pdTRUE;
+    }
+    return xSemaphoreTake(xUartMutex, xTicksToWait);
+}
+
+void vTelemetryUartGive(void) {
+    if (xUartMutex != NULL) {
+        xSemaphoreGive(xUartMutex);
+    }
+}
+
+SemaphoreHandle_t xTelemetryUartMutex(void) {
+    return xUartMutex;
+}
+
+uint32_t ulTelemetryDropped(void) {
+    uint32_t cls, dropped = 0;
+
+    for (cls = 0; cls < TELEMETRY_CLASSES; cls++) {
+        dropped += xRings[cls].dropped;
+    }
+    return dropped;
+}
+
+uint32_t ulTelemetrySent(void) {
+    return ulSent;
+}
+
+uint32_t ulTelemetryHighWater(void) {
+    uint32_t cls, high_water = 0;
+
+    for (cls = 0; cls < TELEMETRY_CLASSES; cls++) {
+        high_water += xRings[cls].high_water;
+    }
+    return high_water;
+}
+
+void vTelemetryClassStats(uint32_t cls, TelemetryClassStats_t *pxStats) {
+    pxStats->size = xRings[cls].size;
+    pxStats->high_water = xRings[cls].high_water;
+    pxStats->dropped = xRings[cls].dropped;
+    pxStats->thinned = xRings[cls].thinned;
+}
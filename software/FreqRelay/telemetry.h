@@ -0,0 +1,212 @@
+/**
+ * Nonblocking telemetry over the JTAG UART
+ *
+ * Control tasks post records into a ring and carry on; a background task
+ * encodes them into compact frames and drains them to the JTAG UART, in
+ * batches, through a descriptor opened with O_NONBLOCK. A post costs a
+ * 20 byte copy with interrupts masked and never waits. When the ring is full
+ * the record is dropped and counted, so a missing or slow host only loses
+ * telemetry, and the loss is reported in the stream.
+ *
+ * Each record type belongs to a class with a ring of its own, most
+ * important first: events (state, faults, decisions, log messages,
+ * injections, traces, health), latency (TELEMETRY_LATENCY, TELEMETRY_WCET), then
+ * samples (TELEMETRY_FREQ); exports are a fourth class below them. A flood
+ * of one class only fills its own ring, so it never drops another's
+ * records. While the link keeps up the drain sends the oldest record
+ * first, in time order as with one ring. Once what waits is more than a
+ * drain takes, it sends TELEMETRY_CLASS_WEIGHTS records of each class in
+ * turn, events first, and the sample ring, when TELEMETRY_SAMPLE_THIN deep,
+ * keeps only every other sample posted, which halves the rate rather than
+ * losing a stretch; exports wait for the rings to empty. The loss reported
+ * is that of every class, and each one's is counted
+ * (vTelemetryClassStats()).
+ *
+ * Frame format, version TELEMETRY_VERSION, all fields little endian:
+ *
+ *   sync    u16   TELEMETRY_SYNC (bytes 0x5A 0xA5)
+ *   header  u8    version << 5 | type
+ *   delta   u16   microseconds since the previous frame
+ *   payload       per type, see below
+ *   crc     u16   CRC-16/CCITT-FALSE of header, delta and payload
+ *
+ *   type                 payload
+ *   TELEMETRY_FREQ       u16 frequency mHz, s16 RoC 0.01 Hz/s, u8 feeder << 1 | stable
+ *   TELEMETRY_DECISION   u16 requested loads, u16 driven loads
+ *   TELEMETRY_FAULT      u16 faulty loads, u16 driven loads, u16 feedback
+ *   TELEMETRY_STATE      u8 system state, u8 alert | failsafe << 1 | override << 2
+ *   TELEMETRY_LATENCY    u8 TELEMETRY_LATENCY_*, u32 elapsed us, u16 deadline ms
+ *   TELEMETRY_TIME       u32 absolute time us (delta is 0)
+ *   TELEMETRY_LOST       u16 records dropped since the last TELEMETRY_LOST
+ *   TELEMETRY_LOG        u8 LOG_* message number, u32 argument, u32 argument
+ *   TELEMETRY_WCET       u8 WCET_* probe, u32 new longest run in cycles, u32 its first input
+ *   TELEMETRY_INJECT     u8 FAULT_* fault, u16 setting, u32 times it has acted
+ *   TELEMETRY_EXPORT     u16 record, u8 part, u32 byte offset in the part,
+ *                        u8 bytes used, TELEMETRY_CHUNK_BYTES bytes
+ *   TELEMETRY_TRACE      s16 deviation below the lower limit mHz, s16 RoC 0.01 Hz/s,
+ *                        u8 feeder << 4 | policy cell, u8 AUDIT_REASON_*, u16 loads kept
+ *   TELEMETRY_HEALTH     u32 health word (health.h), u32 control cycles
+ *   TELEMETRY_QUEUE      u8 registry slot, u8 peak items, u16 sends, u16 receives,
+ *                        u8 blocks, u8 timeouts, the counts since the slot's last record
+ *
+ * A TELEMETRY_TIME frame comes first, whenever a delta would not fit or a
+ * record is older than the one before it, every TELEMETRY_TIME_EVERY frames
+ * and once a second while nothing else is sent, so a decoder that joins late
+ * or drops a corrupt frame regains the time base. The printf text sharing the port is
+ * ASCII only and fails the sync and CRC checks.
+ *
+ * The application sends TELEMETRY_FREQ and TELEMETRY_DECISION frames through
+ * swinging door stages (swing_door.h): each is a breakpoint stamped at its
+ * own sample, and lines joining a feeder's breakpoints are within the
+ * tolerances of every sample not sent; decisions hold until the next one.
+ *
+ * Export frames carry a file (comtrade.h, screen_capture.h) a chunk at a
+ * time, from the sources added with xTelemetryAddExport(). The drain asks
+ * for a chunk only when the rings are empty, at most
+ * TELEMETRY_EXPORT_PER_DRAIN of them per drain, each time from the first
+ * source that has one, and the source builds each as it is asked, so a
+ * record of any length goes out behind the other records through a 32 byte
+ * buffer. Each chunk says where its bytes belong, so a decoder places them
+ * whatever it missed; the sources keep their parts apart.
+ *
+ * tools/telemetry_decode.py converts a capture of the port to CSV, and
+ * writes out the exported files.
+ *
+ * A sink set with vTelemetrySetSink() takes the stream instead of the
+ * UART: the drain asks it for a buffer, encodes frames straight into it
+ * and hands it back to send, as many times as there is something to send
+ * and the sink has buffers. Over Ethernet (eth.h) each buffer is one UDP
+ * datagram of whole frames, so a lost datagram loses its frames and
+ * nothing else, and TELEMETRY_SINK_EXPORT_PER_DRAIN chunks go per drain.
+ *
+ * The JTAG UART driver has one unlocked transmit buffer per device, so
+ * anything else printing while the scheduler runs holds xTelemetryUartTake()
+ * around its output.
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#define TELEMETRY_SYNC                 0xA55A
+#define TELEMETRY_VERSION              1
+#define TELEMETRY_EVENT_RING_SIZE      32     // Records, power of 2
+#define TELEMETRY_LATENCY_RING_SIZE    16     // Records, power of 2
+#define TELEMETRY_SAMPLE_RING_SIZE     32     // Records, power of 2
+#define TELEMETRY_RING_SIZE            (TELEMETRY_EVENT_RING_SIZE + TELEMETRY_LATENCY_RING_SIZE + \
+                                        TELEMETRY_SAMPLE_RING_SIZE)
+#define TELEMETRY_SAMPLE_THIN          (TELEMETRY_SAMPLE_RING_SIZE * 3 / 4)  // Waiting samples that halve the rate
+#define TELEMETRY_CLASS_WEIGHTS        { 8, 2, 1 }  // Records of each class a round under backpressure
+#define TELEMETRY_BATCH_BYTES          256    // Encoded bytes per UART write
+#define TELEMETRY_FRAME_MAX            16     // Longest record frame (LOG, WCET)
+#define TELEMETRY_CHUNK_BYTES          32     // File bytes per TELEMETRY_EXPORT frame
+#define TELEMETRY_CHUNK_FRAME          (5 + 8 + TELEMETRY_CHUNK_BYTES + 2)
+#define TELEMETRY_EXPORT_PER_DRAIN     4      // Chunks a drain sends at most
+#define TELEMETRY_SINK_EXPORT_PER_DRAIN 64    // The same through a sink
+#define TELEMETRY_EXPORT_SOURCES       2      // Disturbance records, then screen captures
+#define TELEMETRY_TIME_EVERY           128    // Frames between time base frames
+#define TELEMETRY_IDLE_TIME_US         1000000UL  // Time base frame when idle this long
+
+/* Record types */
+#define TELEMETRY_FREQ                 1      // a: frequency Q16 Hz, b: RoC Q16 Hz/s, c: feeder << 1 | stable
+#define TELEMETRY_DECISION             2      // a: requested loads, b: driven loads
+#define TELEMETRY_FAULT                3      // a: faulty loads, b: driven loads, c: feedback
+#define TELEMETRY_STATE                4      // a: system state, b: alert | failsafe << 1 | override << 2
+#define TELEMETRY_LATENCY              5      // a: TELEMETRY_LATENCY_*, b: elapsed us, c: deadline us
+#define TELEMETRY_TIME                 6      // Generated by the encoder
+#define TELEMETRY_LOST                 7      // Generated by the encoder
+#define TELEMETRY_LOG                  8      // a: LOG_* message, b, c: its arguments, see log_msg.h
+#define TELEMETRY_WCET                 9      // a: WCET_* probe, b: cycles, c: first input, see wcet.h
+#define TELEMETRY_INJECT               10     // a: FAULT_* fault, b: setting, c: occurrences, see fault_inject.h
+#define TELEMETRY_EXPORT               11     // Generated by the encoder from the export sources
+#define TELEMETRY_TRACE                12     // a: deviation Q16 Hz, b: RoC Q16 Hz/s, c: loads << 16 | reason << 8 | feeder << 4 | cell
+#define TELEMETRY_HEALTH               13     // a: health word, b: its sequence, see health.h
+#define TELEMETRY_QUEUE                14     // a: peak << 8 | slot, b: sends << 16 | receives, c: blocks << 8 | timeouts
+
+/* QoS classes, most important first */
+#define TELEMETRY_CLASS_EVENT          0
+#define TELEMETRY_CLASS_LATENCY        1
+#define TELEMETRY_CLASS_SAMPLE         2
+#define TELEMETRY_CLASSES              3
+
+#define TELEMETRY_LATENCY_DECISION     0      // Capture to decision
+#define TELEMETRY_LATENCY_SHED         1      // Capture to shed output
+
+/* Ring entry, encoded into a frame by the drain */
+typedef struct {
+    uint8_t type;                      // TELEMETRY_*
+    uint32_t stamp;                    // Timestamp timer at the post
+    uint32_t a;
+    uint32_t b;
+    uint32_t c;
+} TelemetryRecord_t;
+
+/* Counts of one class's ring */
+typedef struct {
+    uint32_t size;                     // Records it holds
+    uint32_t high_water;               // Most records ever waiting
+    uint32_t dropped;                  // Records lost, thinned ones included
+    uint32_t thinned;                  // Samples dropped while the ring backed up
+} TelemetryClassStats_t;
+
+/* One chunk of an exported file, filled by the export source */
+typedef struct {
+    uint16_t record;                   // The source's number for the file
+    uint8_t part;                      // File of the record it belongs to
+    uint8_t length;                    // Bytes of data used
+    uint32_t offset;                   // Where data starts in the file
+    uint8_t data[TELEMETRY_CHUNK_BYTES];
+} TelemetryChunk_t;
+
+/* Fills the next chunk and returns 1, or returns 0 if it has nothing to
+ * send. Called from the drain. */
+typedef int (*TelemetryExport_t)(TelemetryChunk_t *pxChunk);
+
+/* Where the stream goes instead of the UART. pxBegin returns a buffer of
+ * *pulCap bytes, or NULL with none free; pxSend sends len bytes of it, and
+ * takes it back unsent with len 0. Called from the drain. */
+typedef struct {
+    uint8_t *(*pxBegin)(uint32_t *pulCap);
+    void (*pxSend)(uint8_t *pucData, uint32_t len);
+} TelemetrySink_t;
+
+/* Open the UART and empty the rings. Returns 0 on success. */
+int xTelemetryInit(void);
+
+/* Queue a record, from a task or an ISR. Never blocks. */
+void vTelemetryPost(uint8_t type, uint32_t a, uint32_t b, uint32_t c);
+
+/* Queue a record stamped earlier than now, as for a swinging door
+ * breakpoint (swing_door.h). Costs a time base frame if it is older than
+ * the record before it. */
+void vTelemetryPostAt(uint8_t type, uint32_t stamp, uint32_t a, uint32_t b, uint32_t c);
+
+/* Write what the UART will take. Returns the records completed. */
+uint32_t ulTelemetryDrain(void);
+
+/* Add a source of export chunks, asked after those added before it. Before
+ * the drain runs. Returns 0 on success, -1 if full. */
+int xTelemetryAddExport(TelemetryExport_t pxExport);
+
+/* Hold the export sources back (non-zero) or let them send again. Records
+ * are not affected. From any task. */
+void vTelemetryPauseExports(int xPause);
+
+/* Send the stream through pxSink, NULL for the UART. Before the drain
+ * runs. */
+void vTelemetrySetSink(const TelemetrySink_t *pxSink);
+
+/* Serialise other users of the JTAG UART with the drain */
+BaseType_t xTelemetryUartTake(TickType_t xTicksToWait);
+void vTelemetryUartGive(void);
+SemaphoreHandle_t xTelemetryUartMutex(void);  // For its lock profile, NULL before xTelemetryInit()
+
+uint32_t ulTelemetryDropped(void);    // Every class
+uint32_t ulTelemetrySent(void);
+uint32_t ulTelemetryHighWater(void);   // Sum of the classes' high water marks
+void vTelemetryClassStats(uint32_t cls, TelemetryClassStats_t *pxStats);  // cls: TELEMETRY_CLASS_*
+
+#endif /* TELEMETRY_H */
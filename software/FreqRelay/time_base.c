@@ -0,0 +1,14 @@
+/**
+ * 64-bit monotonic time base
+ *
+ * See time_base.h.
+ */
+
+/* Application includes */
+#include "time_base.h"
+
+volatile uint32_t ulTimeBaseHalves = 0;
+
+void vTimeBaseInit(void) {
+    ulTimeBaseHalves = ulLatencyNow() >> 31;
+}
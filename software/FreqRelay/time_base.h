@@ -0,0 +1,65 @@
+/**
+ * 64-bit monotonic time base
+ *
+ * The timestamp timer (ulLatencyNow) counts CPU cycles in 32 bits and wraps
+ * every 43 s at 100 MHz, and the 1 ms tick wraps after 49 days. Differences
+ * over a short interval are fine with either, but anything stamped to be
+ * read later - event log records, the telemetry time base - needs a clock
+ * that does not wrap.
+ *
+ * ullTimeNow() extends the timestamp counter with a count of its half
+ * periods: a single word, updated from the tick hook whenever the top bit
+ * of the counter has flipped. A reader takes the word and the counter and
+ * adds the half period the tick hook has not seen yet, so there is no lock
+ * and no retry, and it is safe from any context. The count only has to be
+ * updated at least once every 21 s, which the tick (or a tickless sleep
+ * capped at IDLE_SLEEP_MAX_MS) always does.
+ */
+
+#ifndef TIME_BASE_H
+#define TIME_BASE_H
+
+#include <stdint.h>
+#include "latency.h"
+
+/* Half periods of the timestamp counter seen so far, vTimeBaseTick() only
+ * writes it */
+extern volatile uint32_t ulTimeBaseHalves;
+
+/* Take the current counter as the first half period. After vLatencyInit(),
+ * before the scheduler starts. */
+void vTimeBaseInit(void);
+
+/* Tick hook: account for a flip of the counter's top bit */
+static inline void vTimeBaseTick(void) {
+    uint32_t halves = ulTimeBaseHalves;
+
+    if ((ulLatencyNow() >> 31) != (halves & 1)) {
+        ulTimeBaseHalves = halves + 1;
+    }
+}
+
+/* Timestamp counts since the timer started, from any context */
+static inline uint64_t ullTimeNow(void) {
+    uint32_t halves = ulTimeBaseHalves;
+    uint32_t now = ulLatencyNow();
+
+    if ((now >> 31) != (halves & 1)) {
+        halves++;
+    }
+    return ((uint64_t)(halves >> 1) << 32) | now;
+}
+
+/* The full time of a 32-bit stamp (ulLatencyNow) taken in the last 43 s */
+static inline uint64_t ullTimeExtend(uint32_t stamp) {
+    uint64_t now = ullTimeNow();
+
+    return now - (uint32_t)((uint32_t)now - stamp);
+}
+
+/* Timestamp counts to microseconds */
+static inline uint64_t ullTimeToUs(uint64_t counts) {
+    return counts / ulLatencyCountsPerUs();
+}
+
+#endif /* TIME_BASE_H */
@@ -0,0 +1,152 @@
+/**
+ * Common time base across the relays of a coordination ring
+ *
+ * See time_sync.h.
+ */
+
+/* Standard includes */
+#include <string.h>
+
+/* Scheduler includes */
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/* Application includes */
+#include "latency.h"
+#include "seqlock.h"
+#include "time_sync.h"
+
+/* The map from local to leader's time, written by the sync task under the
+ * lock */
+typedef struct {
+    uint64_t local_at;
+    uint64_t master_at;
+    int32_t rate;                      // 2^-32 units
+} TimeSyncMap_t;
+
+static SeqLock_t xLock = SEQLOCK_INIT;
+static TimeSyncMap_t xMap;
+static TimeSyncStats_t xStats;
+
+/* The posted pair, under a critical section */
+static uint64_t ullPostLocal, ullPostMaster;
+static uint8_t ucPosted;
+static TaskHandle_t xSyncTask = NULL;
+
+/* Servo state, sync task only */
+static uint8_t ucStarted;
+static uint32_t ulFar;                 // Samples off by more than TIME_SYNC_STEP_US in a row
+static uint32_t ulNear;                // Within TIME_SYNC_LOCK_US in a row
+
+void vTimeSyncInit(TaskHandle_t xTask) {
+    xSyncTask = xTask;
+}
+
+void vTimeSyncPost(uint64_t local, uint64_t master) {
+    taskENTER_CRITICAL();
+    ullPostLocal = local;
+    ullPostMaster = master;
+    ucPosted = 1;
+    taskEXIT_CRITICAL();
+    if (xSyncTask != NULL) {
+        xTaskNotifyGive(xSyncTask);
+    }
+}
+
+/* In 64 bits however long since the anchor: (d * rate) >> 32 in two halves */
+static uint64_t ullMapAt(const TimeSyncMap_t *pxMap, uint64_t local) {
+    uint64_t d = local - pxMap->local_at;
+    int64_t adjust = (int64_t)(d >> 32) * pxMap->rate +
+                     (((int64_t)(d & 0xFFFFFFFFULL) * pxMap->rate) >> 32);
+
+    return pxMap->master_at + d + (uint64_t)adjust;
+}
+
+uint64_t ullTimeSyncedAt(uint64_t local) {
+    TimeSyncMap_t map;
+
+    vSeqRead(&xLock, &map, &xMap, sizeof(map));
+    return ullMapAt(&map, local);
+}
+
+void vTimeSyncService(void) {
+    TimeSyncMap_t map = xMap;
+    uint64_t local, master, dt;
+    int64_t error, error_us, limit, rate;
+    uint32_t per_us = ulLatencyCountsPerUs();
+    int posted;
+
+    taskENTER_CRITICAL();
+    local = ullPostLocal;
+    master = ullPostMaster;
+    posted = ucPosted;
+    ucPosted = 0;
+    taskEXIT_CRITICAL();
+    if (!posted) {
+        return;
+    }
+
+    error = (int64_t)(master - ullMapAt(&map, local));
+    limit = (int64_t)TIME_SYNC_STEP_US * per_us;
+    dt = local - map.local_at;
+    error_us = error / (int64_t)per_us;
+
+    vSeqWriteBegin(&xLock);
+    xStats.samples++;
+    xStats.error_us = (int32_t)(error_us > INT32_MAX ? INT32_MAX : error_us < -INT32_MAX ? -INT32_MAX : error_us);
+    vSeqWriteEnd(&xLock);
+
+    if (!ucStarted || ((error > limit || error < -limit) && ++ulFar >= TIME_SYNC_STEP_SAMPLES)) {
+        map.local_at = local;
+        map.master_at = master;
+        ucStarted = 1;
+        ulFar = 0;
+        ulNear = 0;
+        vSeqWriteBegin(&xLock);
+        xMap = map;
+        xStats.steps++;
+        xStats.locked = 0;
+        vSeqWriteEnd(&xLock);
+        return;
+    }
+    if (ulFar != 0) {
+        if (error > limit || error < -limit) {
+            vSeqWriteBegin(&xLock);
+            xStats.outliers++;
+            vSeqWriteEnd(&xLock);
+            return;
+        }
+        ulFar = 0;
+    }
+
+    /* The error over the interval is the rate still missing; dt is at
+     * least a sync period, so error << 32 / dt stays small */
+    rate = map.rate;
+    if (dt != 0) {
+        rate += ((error * ((int64_t)1 << 32)) / (int64_t)dt) >> TIME_SYNC_KI_SHIFT;
+    }
+    if (rate > TIME_SYNC_RATE_MAX) {
+        rate = TIME_SYNC_RATE_MAX;
+    } else if (rate < -TIME_SYNC_RATE_MAX) {
+        rate = -TIME_SYNC_RATE_MAX;
+    }
+    map.master_at = ullMapAt(&map, local) + (uint64_t)(error >> TIME_SYNC_KP_SHIFT);
+    map.local_at = local;
+    map.rate = (int32_t)rate;
+
+    if (error <= (int64_t)TIME_SYNC_LOCK_US * per_us && error >= -(int64_t)TIME_SYNC_LOCK_US * per_us) {
+        ulNear++;
+    } else {
+        ulNear = 0;
+    }
+
+    vSeqWriteBegin(&xLock);
+    xMap = map;
+    xStats.rate_ppb = (int32_t)((rate * 1000000000LL) >> 32);
+    xStats.locked = ulNear >= TIME_SYNC_LOCK_SAMPLES;
+    vSeqWriteEnd(&xLock);
+}
+
+void vTimeSyncGetStats(TimeSyncStats_t *pxStats) {
+    vSeqRead(&xLock, pxStats, &xStats, sizeof(*pxStats));
+}
@@ -0,0 +1,93 @@
+/**
+ * Common time base across the relays of a coordination ring
+ *
+ * Disturbance records from several relays only line up if their clocks do.
+ * The coordination ring (coord.h) carries the leader's clock to the other
+ * nodes the way PTP's two-step sync does: every COORD_TIME_PERIOD_MS the
+ * leader sends a time frame, its UART interrupt stamping the moment the
+ * first byte goes out, and the next time frame carries that stamp. Each
+ * node's interrupt stamps the first byte of a frame arriving, so once a
+ * period a node learns what the leader's clock read as it sent and what its
+ * own read as the frame came in.
+ *
+ * Between the two lies the path, measured both ways round the ring: each
+ * node that passes the frame on adds the time it held it to the frame's
+ * transit field (a transparent clock, in PTP terms), which leaves one link
+ * delay per hop - a character time and the interrupt's latency, the same on
+ * every link. A node's own status frames coming back round take every link
+ * once and collect every holding time, so the link delay is their round
+ * trip less their transit over COORD_NODES. A frame starts only once the
+ * transmitter is empty, so its first byte leaves as it is stamped and what
+ * is left is interrupt latency, a few microseconds either end.
+ *
+ * The local clock is never adjusted: ullTimeNow() runs on for the control
+ * path, and ullTimeSynced() maps it onto the leader's,
+ *
+ *   synced = master_at + (local - local_at) * (1 + rate / 2^32)
+ *
+ * from the anchor of the last sample. Each sample's error against that map
+ * feeds a proportional-integral servo: the map moves 1/2^TIME_SYNC_KP_SHIFT
+ * of the way to the sample, and the rate, in 2^-32 units (0.23 ppb), takes
+ * 1/2^TIME_SYNC_KI_SHIFT of the error over the interval, so the crystals'
+ * drift between boards (tens of ppm) is tracked and a second between
+ * samples adds well under a microsecond. The servo runs in a low-priority
+ * task from the samples the coordination task posts; the control path
+ * reads nothing of it.
+ *
+ * A first sample, and TIME_SYNC_STEP_SAMPLES in a row off by more than
+ * TIME_SYNC_STEP_US (the leader restarting), step the map to the sample
+ * instead; a single sample that far off is dropped. Locked means the last
+ * TIME_SYNC_LOCK_SAMPLES were within TIME_SYNC_LOCK_US.
+ *
+ * Without samples - the leader, or no ring - synced time is local time.
+ */
+
+#ifndef TIME_SYNC_H
+#define TIME_SYNC_H
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "time_base.h"
+
+#define TIME_SYNC_KP_SHIFT             1     // Phase: half of each error
+#define TIME_SYNC_KI_SHIFT             3     // Rate: an eighth of each error per interval
+#define TIME_SYNC_RATE_MAX             (1L << 22)   // About 1000 ppm, 2^-32 units
+#define TIME_SYNC_STEP_US              1000
+#define TIME_SYNC_STEP_SAMPLES         2
+#define TIME_SYNC_LOCK_US              20
+#define TIME_SYNC_LOCK_SAMPLES         4
+
+typedef struct {
+    uint32_t samples;                  // Taken by the servo
+    uint32_t steps;                    // Map set straight to a sample
+    uint32_t outliers;                 // Single samples dropped
+    int32_t error_us;                  // Of the last sample against the map
+    int32_t rate_ppb;                  // Drift of the leader's clock against this one
+    uint8_t locked;
+} TimeSyncStats_t;
+
+/* xTask is notified of each sample posted and calls vTimeSyncService().
+ * Before the scheduler starts. */
+void vTimeSyncInit(TaskHandle_t xTask);
+
+/* A pair of readings: the leader's clock stood at master when this one
+ * stood at local (ullTimeNow counts). The newest pair waits for the sync
+ * task, an older one not yet taken is replaced. */
+void vTimeSyncPost(uint64_t local, uint64_t master);
+
+/* Servo update from the posted pair, sync task only */
+void vTimeSyncService(void);
+
+/* A local time (ullTimeNow counts) on the leader's clock, from any context */
+uint64_t ullTimeSyncedAt(uint64_t local);
+
+/* Now on the leader's clock */
+static inline uint64_t ullTimeSynced(void) {
+    return ullTimeSyncedAt(ullTimeNow());
+}
+
+/* Counters since boot, read in one copy */
+void vTimeSyncGetStats(TimeSyncStats_t *pxStats);
+
+#endif /* TIME_SYNC_H */
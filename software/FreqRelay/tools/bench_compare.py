@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+"""Compare a FreqRelay benchmark run with a baseline.
+
+Picks the BENCH lines described in bench.h out of a JTAG UART capture of
+the "make bench" image, prints each benchmark in microseconds next to the
+baseline, and exits with status 1 if any mean got slower than the baseline
+by more than the threshold. Either file may be a raw capture or the
+output of --save.
+
+    nios2-terminal | tee bench.bin
+    tools/bench_compare.py bench.bin --save > baseline.csv
+    tools/bench_compare.py bench.bin baseline.csv -t 10
+"""
+
+import argparse
+import sys
+
+VERSION = 1
+
+
+def parse(path):
+    """Return (counts per us, {name: (iterations, min, mean, max)})."""
+    with open(path, "rb") as capture:
+        text = capture.read().decode("latin-1")
+    rate = None
+    results = {}
+    for line in text.replace("\r", "\n").split("\n"):
+        fields = line.strip().split(",")
+        if fields[0] == "#BENCH" and len(fields) == 4:
+            if int(fields[1]) != VERSION:
+                sys.exit("%s: bench output version %s, expected %d" % (path, fields[1], VERSION))
+            rate = int(fields[2])
+        elif fields[0] == "BENCH" and len(fields) == 6 and fields[2] != "0":
+            results[fields[1]] = tuple(int(value) for value in fields[2:])
+    if rate is None:
+        sys.exit("%s: no #BENCH header" % path)
+    return rate, results
+
+
+def save(rate, results, out):
+    out.write("#BENCH,%d,%d,0\n" % (VERSION, rate))
+    for name, values in results.items():
+        out.write("BENCH,%s,%d,%d,%d,%d\n" % ((name,) + values))
+    out.write("#BENCH,end\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("run", help="capture of the run to check")
+    parser.add_argument("baseline", nargs="?", help="capture or saved baseline")
+    parser.add_argument("-t", "--threshold", type=float, default=10.0,
+                        help="allowed slowdown of the mean, percent (default 10)")
+    parser.add_argument("--save", action="store_true",
+                        help="write the run's BENCH lines to stdout and stop")
+    args = parser.parse_args()
+
+    rate, run = parse(args.run)
+    if args.save:
+        save(rate, run, sys.stdout)
+        return 0
+    base_rate, base = parse(args.baseline) if args.baseline else (rate, {})
+
+    print("%-20s %10s %10s %10s %10s  %s" % ("benchmark", "min us", "mean us", "max us",
+                                           "base us", "change"))
+    failed = []
+    for name, (_, low, mean, high) in run.items():
+        line = "%-20s %10.2f %10.2f %10.2f" % (name, low / rate, mean / rate, high / rate)
+        if name in base:
+            base_mean = base[name][2] / base_rate
+            change = 100.0 * (mean / rate - base_mean) / base_mean if base_mean else 0.0
+            line += " %10.2f  %+.1f%%" % (base_mean, change)
+            if change > args.threshold:
+                failed.append(name)
+                line += "  SLOWER"
+        print(line)
+    for name in base:
+        if name not in run:
+            print("%-20s missing from the run" % name)
+
+    # The same analyzer batch under each display condition
+    if "contend_idle" in run and run["contend_idle"][2]:
+        idle = run["contend_idle"][2]
+        for name, (_, _, mean, _) in run.items():
+            if name.startswith("contend_") and name != "contend_idle":
+                print("%-20s %+.1f%% against contend_idle" % (name, 100.0 * (mean - idle) / idle))
+
+    if failed:
+        print("%d benchmark(s) slower than the baseline by more than %.1f%%: %s"
+              % (len(failed), args.threshold, ", ".join(failed)))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,163 @@
+#!/usr/bin/env python3
+"""Send a firmware image to a FreqRelay's spare flash bank (fw_update.h).
+
+The image is the boot copier's, the application's elf2flash output as
+binary. It goes over Modbus, by UDP to an Ethernet build (FREQ_ETHERNET) or
+RTU on the RS-232 port, while the relay keeps running:
+
+    elf2flash --input=FreqRelay.elf --output=FreqRelay.flash --base=<flash base> ...
+    nios2-elf-objcopy -I srec -O binary FreqRelay.flash image.bin
+    tools/fw_update.py image.bin --udp 192.168.1.50
+    tools/fw_update.py image.bin --serial /dev/ttyUSB0 --reboot
+
+Without --reboot the verified image waits for a later run with --reboot-only.
+"""
+
+import argparse
+import socket
+import struct
+import sys
+import time
+import zlib
+
+MB_IN_FW = 0x0200
+MB_HOLD_FW = 0x0200
+MB_FW_OFFSET = 5
+MB_FW_BEGIN, MB_FW_ABORT, MB_FW_REBOOT = 1, 2, 3
+CHUNK_BYTES = 128
+FW_STATES = ("idle", "receiving", "verifying", "ready", "failed")
+FW_READY, FW_FAILED = 3, 4
+EX_BUSY = 0x06
+
+
+class ModbusError(Exception):
+    def __init__(self, code):
+        Exception.__init__(self, "Modbus exception %d" % code)
+        self.code = code
+
+
+def crc16(data):
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0xA001 if crc & 1 else crc >> 1
+    return crc
+
+
+class UdpLink:
+    def __init__(self, host, port, timeout):
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.settimeout(timeout)
+        self.peer = (host, port)
+        self.transaction = 0
+
+    def request(self, pdu, expect):
+        self.transaction = (self.transaction + 1) & 0xFFFF
+        self.sock.sendto(struct.pack(">HHHB", self.transaction, 0, len(pdu) + 1, 1) + pdu, self.peer)
+        while True:
+            reply = self.sock.recv(1500)
+            if len(reply) > 7 and struct.unpack(">H", reply[:2])[0] == self.transaction:
+                return reply[7:]
+
+
+class RtuLink:
+    def __init__(self, device, address, timeout):
+        import serial
+        self.port = serial.Serial(device, 115200, timeout=timeout)
+        self.address = address
+
+    def request(self, pdu, expect):
+        frame = bytes([self.address]) + pdu
+        self.port.reset_input_buffer()
+        self.port.write(frame + struct.pack("<H", crc16(frame)))
+        reply = self.port.read(2)
+        if len(reply) < 2:
+            raise socket.timeout()
+        reply += self.port.read(3 if reply[1] & 0x80 else expect + 1)
+        if crc16(reply) != 0:
+            raise socket.timeout()
+        return reply[1:-2]
+
+
+def call(link, pdu, expect, retries=20, busy_s=30.0):
+    """One request, expecting a reply PDU of expect bytes, sent again on a
+    timeout and for as long as busy_s while the relay is busy"""
+    deadline = time.time() + busy_s
+    while retries > 0:
+        try:
+            reply = link.request(pdu, expect)
+        except socket.timeout:
+            retries -= 1
+            continue
+        if reply[0] & 0x80:
+            if reply[1] == EX_BUSY and time.time() < deadline:
+                time.sleep(0.05)
+                continue
+            raise ModbusError(reply[1])
+        return reply
+    sys.exit("no answer from the relay")
+
+
+def write_registers(link, address, values):
+    call(link, struct.pack(">BHHB", 0x10, address, len(values), 2 * len(values)) +
+         struct.pack(">%dH" % len(values), *values), 5)
+
+
+def read_status(link):
+    reply = call(link, struct.pack(">BHH", 0x04, MB_IN_FW, 7), 16)
+    state, bank, received_hi, received_lo, programmed_hi, programmed_lo, errors = \
+        struct.unpack(">7H", reply[2:16])
+    return state, bank, received_hi << 16 | received_lo, programmed_hi << 16 | programmed_lo, errors
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("image", nargs="?", help="boot copier image, binary")
+    parser.add_argument("--udp", metavar="HOST", help="the relay's address, FREQ_ETHERNET builds")
+    parser.add_argument("--port", type=int, default=502)
+    parser.add_argument("--serial", metavar="DEVICE", help="RS-232 port, needs pyserial")
+    parser.add_argument("--address", type=int, default=1, help="Modbus slave address on RS-232")
+    parser.add_argument("--reboot", action="store_true", help="switch to the image once verified")
+    parser.add_argument("--reboot-only", action="store_true", help="switch to an image already verified")
+    args = parser.parse_args()
+
+    if bool(args.udp) == bool(args.serial):
+        sys.exit("give one of --udp or --serial")
+    link = UdpLink(args.udp, args.port, 0.5) if args.udp else RtuLink(args.serial, args.address, 0.5)
+
+    if not args.reboot_only:
+        if not args.image:
+            sys.exit("no image given")
+        with open(args.image, "rb") as image_file:
+            image = image_file.read()
+        crc = zlib.crc32(image) & 0xFFFFFFFF
+        write_registers(link, MB_HOLD_FW, [MB_FW_BEGIN, len(image) >> 16, len(image) & 0xFFFF,
+                                           crc >> 16, crc & 0xFFFF])
+        for offset in range(0, len(image), CHUNK_BYTES):
+            chunk = image[offset:offset + CHUNK_BYTES]
+            padded = chunk + b"\0" * (len(chunk) & 1)
+            write_registers(link, MB_HOLD_FW + MB_FW_OFFSET,
+                            [offset >> 16, offset & 0xFFFF, len(chunk)] +
+                            list(struct.unpack(">%dH" % (len(padded) // 2), padded)))
+            sys.stderr.write("\r%d of %d bytes" % (offset + len(chunk), len(image)))
+        sys.stderr.write("\n")
+
+        while True:
+            state, bank, received, programmed, errors = read_status(link)
+            if state in (FW_READY, FW_FAILED):
+                break
+            sys.stderr.write("\r%s, %d bytes programmed" % (FW_STATES[state], programmed))
+            time.sleep(0.2)
+        sys.stderr.write("\n")
+        if state != FW_READY:
+            sys.exit("the relay could not verify the image, %d errors; it stays on bank %d" % (errors, bank))
+        print("verified; running bank %d, the image is in bank %d" % (bank, bank ^ 1))
+
+    if args.reboot or args.reboot_only:
+        write_registers(link, MB_HOLD_FW, [MB_FW_REBOOT])
+        print("switching banks, the relay restarts")
+
+
+if __name__ == "__main__":
+    main()
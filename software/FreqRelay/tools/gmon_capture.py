@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+"""Turn a FreqRelay profile dump into gmon.out files for nios2-elf-gprof.
+
+Picks the #GMON dump described in profile.h (press P on the keyboard in a
+"make profile" image) out of a JTAG UART capture, the last one if there
+are several, and writes gmon.out with every task's samples and the call
+graph, plus gmon.<task>.out with one task's samples each. Prints each
+task's share of the samples.
+
+    nios2-terminal | tee profile.bin
+    tools/gmon_capture.py profile.bin -o prof
+    nios2-elf-gprof FreqRelay_profile.elf prof/gmon.out
+    nios2-elf-gprof -b -p FreqRelay_profile.elf prof/gmon.FreqAn.out
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+VERSION = 1
+HIST_MAX = 0xFFFF  # gmon histogram buckets are 16 bit
+
+
+def parse(path):
+    """Return the last complete dump in the capture as a dict."""
+    with open(path, "rb") as capture:
+        text = capture.read().decode("latin-1")
+    dump = None
+    last = None
+    for line in text.replace("\r", "\n").split("\n"):
+        fields = line.strip().split(",")
+        if fields[0] == "#GMON" and len(fields) == 6:
+            if int(fields[1]) != VERSION:
+                sys.exit("%s: profile dump version %s, expected %d" % (path, fields[1], VERSION))
+            dump = {"low": int(fields[2], 16), "high": int(fields[3], 16),
+                    "bucket": int(fields[4]), "rate": int(fields[5]),
+                    "tasks": {}, "arcs": []}
+        elif dump is None:
+            continue
+        elif fields[0] == "T" and len(fields) == 4:
+            dump["tasks"][int(fields[1])] = {"name": fields[2], "samples": int(fields[3]),
+                                             "hist": {}}
+        elif fields[0] == "H" and len(fields) == 4:
+            task = dump["tasks"].get(int(fields[1]))
+            if task is not None:
+                task["hist"][int(fields[2], 16)] = int(fields[3])
+        elif fields[0] == "A" and len(fields) == 4:
+            dump["arcs"].append((int(fields[1], 16), int(fields[2], 16), int(fields[3])))
+        elif fields[0] == "#GMON" and len(fields) == 3 and fields[1] == "end":
+            dump["unattributed"] = int(fields[2])
+            last = dump
+            dump = None
+    if last is None:
+        sys.exit("%s: no complete #GMON dump" % path)
+    return last
+
+
+def scale(hist, rate):
+    """Fit the counts in 16 bits: divide counts and rate by a divisor of the
+    rate, which leaves the times gprof reports unchanged."""
+    peak = max(hist.values(), default=0)
+    for divisor in range(1, rate + 1):
+        if rate % divisor == 0 and peak // divisor <= HIST_MAX:
+            return {k: v // divisor for k, v in hist.items()}, rate // divisor
+    return {k: min(v // rate, HIST_MAX) for k, v in hist.items()}, 1
+
+
+def write_gmon(path, dump, hist, arcs):
+    buckets = (dump["high"] - dump["low"] + dump["bucket"] - 1) // dump["bucket"]
+    hist, rate = scale(hist, dump["rate"])
+    with open(path, "wb") as out:
+        out.write(b"gmon" + struct.pack("<I", 1) + b"\0" * 12)
+        out.write(struct.pack("<BIIII", 0, dump["low"], dump["low"] + buckets * dump["bucket"],
+                              buckets, rate))
+        out.write(b"seconds".ljust(15, b"\0") + b"s")
+        out.write(b"".join(struct.pack("<H", hist.get(i, 0)) for i in range(buckets)))
+        for from_pc, self_pc, count in arcs:
+            out.write(struct.pack("<BIII", 1, from_pc, self_pc, count))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("capture", help="raw capture of the JTAG UART")
+    parser.add_argument("-o", "--output", default=".", help="directory for the gmon files")
+    args = parser.parse_args()
+
+    dump = parse(args.capture)
+    os.makedirs(args.output, exist_ok=True)
+
+    total = {}
+    for task in dump["tasks"].values():
+        for bucket, count in task["hist"].items():
+            total[bucket] = total.get(bucket, 0) + count
+    write_gmon(os.path.join(args.output, "gmon.out"), dump, total, dump["arcs"])
+
+    samples = sum(task["samples"] for task in dump["tasks"].values()) + dump["unattributed"]
+    print("%-8s %9s %7s" % ("task", "samples", "share"))
+    for slot, task in sorted(dump["tasks"].items()):
+        name = re.sub(r"[^A-Za-z0-9_-]", "_", task["name"]) or "task%d" % slot
+        write_gmon(os.path.join(args.output, "gmon.%s.out" % name), dump, task["hist"], [])
+        print("%-8s %9d %6.1f%%" % (task["name"], task["samples"],
+                                    100.0 * task["samples"] / samples if samples else 0.0))
+    print("%d samples at %d Hz, %d not in a histogram, %d call arcs"
+          % (samples, dump["rate"], dump["unattributed"], len(dump["arcs"])))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,145 @@
+#!/usr/bin/env python3
+"""Order the control path's functions for the hot text image from a profile.
+
+Reads the #GMON dump of a "make profile" image (see profile.h and
+gmon_capture.py) and that image's ELF, and writes hot_text.ld for
+"make hot": the functions the control tasks spend their samples in,
+most sampled first, after the interrupt path. The profile's PC samples
+are taken from the tick and never land in an interrupt handler, so the
+interrupt path is a fixed seed list, followed by whatever it was seen to
+call in the call graph arcs. Functions are taken while they fit in the
+I-cache with the exception code, which the linker places first, so the
+whole of the hot text maps to distinct cache lines.
+
+Sizes come from the profile image, whose functions each carry an mcount
+call, so the budget errs on the safe side.
+
+    nios2-terminal | tee profile.bin
+    tools/hot_text.py profile.bin FreqRelay_profile.elf -o hot_text.ld
+    make hot
+"""
+
+import argparse
+import subprocess
+import sys
+
+from gmon_capture import parse
+
+ICACHE_BYTES = 4096  # ALT_CPU_ICACHE_SIZE
+CONTROL_TASKS = "FreqAn,SysMon,LoadAct,Cyclic"
+
+# The interrupt path, in the order it runs: entry, the frequency ISR, the
+# tick, the switch, and the kernel calls the ISRs and the control tasks
+# block and wake with.
+SEED = [
+    "vFrequencyISRHandler", "vShedISRHandler",
+    "vPortSysTickHandler", "xTaskIncrementTick", "vTaskSwitchContext",
+    "vTaskNotifyGiveFromISR", "xTaskNotify", "ulTaskNotifyTake", "xTaskNotifyWait",
+    "xTaskRemoveFromEventList", "vTaskPlaceOnEventList", "prvAddCurrentTaskToDelayedList",
+    "vListInsert", "vListInsertEnd", "uxListRemove",
+    "xTaskGetTickCount", "vTaskSuspendAll", "xTaskResumeAll",
+]
+
+
+def symbols(elf, nm):
+    """Return the ELF's functions as (address, size, name), by address."""
+    try:
+        out = subprocess.run([nm, "-S", "-n", elf], check=True, capture_output=True,
+                             text=True).stdout
+    except (OSError, subprocess.CalledProcessError) as err:
+        sys.exit("%s: %s" % (nm, err))
+    funcs, marks = [], {}
+    for line in out.splitlines():
+        fields = line.split()
+        if len(fields) == 4 and fields[2] in "Tt":
+            funcs.append((int(fields[0], 16), int(fields[1], 16), fields[3]))
+        elif len(fields) >= 3:
+            marks[fields[-1]] = int(fields[0], 16)
+    if "__ram_exceptions_start" not in marks or "__ram_exceptions_end" not in marks:
+        sys.exit("%s: no __ram_exceptions_start/end, not a Nios II HAL image" % elf)
+    return funcs, marks["__ram_exceptions_end"] - marks["__ram_exceptions_start"]
+
+
+def function_at(funcs, pc):
+    """Name of the function holding pc, or None."""
+    low, high = 0, len(funcs)
+    while low < high:
+        mid = (low + high) // 2
+        if funcs[mid][0] <= pc:
+            low = mid + 1
+        else:
+            high = mid
+    if low and pc < funcs[low - 1][0] + funcs[low - 1][1]:
+        return funcs[low - 1][2]
+    return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("capture", help="raw capture of the JTAG UART with a #GMON dump")
+    parser.add_argument("elf", help="the profile image the dump came from")
+    parser.add_argument("-o", "--output", default="hot_text.ld", help="linker script to write")
+    parser.add_argument("--tasks", default=CONTROL_TASKS,
+                        help="tasks whose samples count, comma separated (%(default)s)")
+    parser.add_argument("--icache", type=int, default=ICACHE_BYTES,
+                        help="I-cache bytes (%(default)s)")
+    parser.add_argument("--nm", default="nios2-elf-nm", help="nm for the ELF (%(default)s)")
+    args = parser.parse_args()
+
+    dump = parse(args.capture)
+    funcs, exceptions = symbols(args.elf, args.nm)
+    sizes = {name: size for _, size, name in funcs}
+
+    tasks = set(args.tasks.split(","))
+    samples = {}
+    for task in dump["tasks"].values():
+        if task["name"] not in tasks:
+            continue
+        for bucket, count in task["hist"].items():
+            name = function_at(funcs, dump["low"] + bucket * dump["bucket"])
+            if name is not None:
+                samples[name] = samples.get(name, 0) + count
+
+    # What the interrupt path calls, by call count
+    seeds = set(SEED)
+    called = {}
+    for from_pc, self_pc, count in dump["arcs"]:
+        if function_at(funcs, from_pc) in seeds:
+            name = function_at(funcs, self_pc)
+            if name is not None and name not in seeds:
+                called[name] = called.get(name, 0) + count
+
+    order = [name for name in SEED if name in sizes]
+    order += sorted(called, key=lambda name: -called[name])
+    order += sorted((name for name in samples if name not in seeds and name not in called),
+                    key=lambda name: -samples[name])
+
+    budget = args.icache - exceptions
+    used, chosen = 0, []
+    for name in order:
+        if name not in chosen and used + sizes[name] <= budget:
+            chosen.append(name)
+            used += sizes[name]
+
+    with open(args.output, "w") as out:
+        out.write("/*\n * Hot text for \"make hot\", written by tools/hot_text.py from %s.\n"
+                  " * %d bytes after %d of exception code, in a %d byte I-cache. The\n"
+                  " * build puts it in the BSP's linker script ahead of .text.\n */\n\n"
+                  % (args.capture, used, exceptions, args.icache))
+        out.write("    .hot_text :\n    {\n"
+                  "        PROVIDE (__hot_text_start = ABSOLUTE(.));\n")
+        for name in chosen:
+            out.write("        *(.text.%s)\n" % name)
+        out.write("        PROVIDE (__hot_text_end = ABSOLUTE(.));\n"
+                  "    } > onchip_memory\n\n")
+
+    print("%-32s %6s %9s %7s" % ("function", "bytes", "samples", "calls"))
+    for name in chosen:
+        print("%-32s %6d %9d %7d" % (name, sizes[name], samples.get(name, 0), called.get(name, 0)))
+    left = [name for name in order if name not in chosen and samples.get(name, 0)]
+    print("%d functions, %d of %d bytes; %d sampled functions did not fit"
+          % (len(chosen), used, budget, len(left)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,150 @@
+#!/usr/bin/env python3
+"""Print a FreqRelay kernel trace dump as a timeline.
+
+Picks the #KTRACE dump described in kernel_trace.h (written by the stats
+task after a failsafe trigger) out of a JTAG UART capture, the last one if
+there are several, and prints one line per event with its time relative to
+the trigger in microseconds, the task it ran in and what happened.
+
+    nios2-terminal | tee trace.bin
+    tools/ktrace_decode.py trace.bin
+    tools/ktrace_decode.py trace.bin --before 2000 --after 500
+"""
+
+import argparse
+import sys
+
+VERSION = 1
+TASK_ISR = 0xFF
+
+QUEUE_TYPES = {0: "queue", 1: "mutex", 2: "counting", 3: "binary", 4: "recursive"}
+TRIGGER_REASONS = {0: "monitor", 1: "failsafe irq", 2: "deadline", 3: "watchdog",
+                   4: "instant trip"}
+
+# Type: (name, how the argument reads)
+EVENTS = {
+    0x01: ("switch", "prio"),
+    0x02: ("ready", "task"),
+    0x03: ("delay", None),
+    0x04: ("delay_until", None),
+    0x10: ("queue_create", "queue"),
+    0x11: ("send", "queue"),
+    0x12: ("send_failed", "queue"),
+    0x13: ("receive", "queue"),
+    0x14: ("receive_failed", "queue"),
+    0x15: ("block_send", "queue"),
+    0x16: ("block_receive", "queue"),
+    0x17: ("send_isr", "queue"),
+    0x18: ("receive_isr", "queue"),
+    0x20: ("notify_take_block", None),
+    0x21: ("notify_take", "value"),
+    0x22: ("notify_wait_block", None),
+    0x23: ("notify_wait", "value"),
+    0x24: ("notify", "task"),
+    0x25: ("notify_isr", "task"),
+    0x30: ("timer_create", "timer"),
+    0x31: ("timer_expired", "timer"),
+    0x40: ("irq_enter", "irq"),
+    0x41: ("irq_exit", "irq"),
+    0x50: ("mark", "value"),
+    0x51: ("TRIGGER", "reason"),
+}
+
+
+def parse(path):
+    """Return the last complete dump in the capture as a dict."""
+    with open(path, "rb") as capture:
+        text = capture.read().decode("latin-1")
+    dump = None
+    last = None
+    for line in text.replace("\r", "\n").split("\n"):
+        fields = line.strip().split(",")
+        if fields[0] == "#KTRACE" and len(fields) == 5:
+            if int(fields[1]) != VERSION:
+                sys.exit("%s: kernel trace version %s, expected %d" % (path, fields[1], VERSION))
+            dump = {"counts_per_us": int(fields[2]), "events": int(fields[3]),
+                    "trigger": int(fields[4]), "tasks": {}, "queues": {}, "timers": {},
+                    "records": []}
+        elif dump is None:
+            continue
+        elif fields[0] == "N" and len(fields) == 3:
+            dump["tasks"][int(fields[1])] = fields[2]
+        elif fields[0] == "Q" and len(fields) == 3:
+            dump["queues"][int(fields[1])] = int(fields[2])
+        elif fields[0] == "R" and len(fields) == 3:
+            dump["timers"][int(fields[1])] = fields[2]
+        elif fields[0] == "E" and len(fields) == 3:
+            dump["records"].append((int(fields[1], 16), int(fields[2], 16)))
+        elif fields[0] == "#KTRACE" and len(fields) == 2 and fields[1] == "end":
+            last = dump
+            dump = None
+    if last is None:
+        sys.exit("%s: no complete #KTRACE dump" % path)
+    if len(last["records"]) != last["events"]:
+        print("warning: %d of %d events in the capture" % (len(last["records"]), last["events"]),
+              file=sys.stderr)
+    return last
+
+
+def unwrap(records):
+    """Timestamps as a monotonic count, the 32-bit counter wraps every 43 s."""
+    times = []
+    base = 0
+    previous = None
+    for stamp, _ in records:
+        if previous is not None and stamp < previous:
+            base += 1 << 32
+        times.append(base + stamp)
+        previous = stamp
+    return times
+
+
+def describe(dump, kind, arg):
+    if kind == "task":
+        return "task %s" % dump["tasks"].get(arg, arg)
+    if kind == "queue":
+        queue_type = dump["queues"].get(arg)
+        return "queue %d (%s)" % (arg, QUEUE_TYPES.get(queue_type, "?"))
+    if kind == "timer":
+        return "timer %s" % dump["timers"].get(arg, arg)
+    if kind == "reason":
+        return TRIGGER_REASONS.get(arg, str(arg))
+    if kind is None:
+        return ""
+    return "%s %d" % (kind, arg)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("capture", help="JTAG UART capture holding a #KTRACE dump")
+    parser.add_argument("--before", type=float, help="only events this many us before the trigger")
+    parser.add_argument("--after", type=float, help="only events this many us after the trigger")
+    args = parser.parse_args()
+
+    dump = parse(args.capture)
+    records = dump["records"]
+    if not records:
+        sys.exit("%s: dump holds no events" % args.capture)
+    times = unwrap(records)
+    trigger = times[min(dump["trigger"], len(times) - 1)]
+    rate = float(dump["counts_per_us"] or 1)
+
+    for when, (_, word) in zip(times, records):
+        us = (when - trigger) / rate
+        if args.before is not None and us < -args.before:
+            continue
+        if args.after is not None and us > args.after:
+            break
+        kind = (word >> 24) & 0xFF
+        task = (word >> 16) & 0xFF
+        arg = word & 0xFFFF
+        name, arg_kind = EVENTS.get(kind, ("type 0x%02x" % kind, "arg"))
+        if task == TASK_ISR:
+            task_name = "(isr)"
+        else:
+            task_name = dump["tasks"].get(task, str(task))
+        print("%12.2f  %-8s  %-18s %s" % (us, task_name, name, describe(dump, arg_kind, arg)))
+
+
+if __name__ == "__main__":
+    main()
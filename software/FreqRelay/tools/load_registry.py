@@ -0,0 +1,72 @@
+#!/usr/bin/env python3
+"""Write a FreqRelay load registry image (load_registry.h) from a CSV file.
+
+One line per wired output, the others are left unrated and never switched:
+
+    # load,rating_kw,priority,min_on_ms,min_off_ms
+    0,40,0,0,0
+    1,25,1,0,2000
+    5,120,3,5000,10000
+
+Priority 0 is the most important, 15 the least; load 0 (the critical load)
+is never shed whatever its priority. Lines starting with # are skipped.
+The response to a deficit is given on the command line:
+
+    tools/load_registry.py site.csv --kw-per-hz 80 --kw-per-hz-s 4 -o registry.bin
+    bin2flash --input=registry.bin --output=registry.flash --location=0x7F8000
+    nios2-flash-programmer --base=<flash base> registry.flash
+    sim/replay -k registry.bin -g ramp-5
+"""
+
+import argparse
+import struct
+import sys
+
+MAGIC = 0x4C4F4144  # "LOAD"
+VERSION = 1
+LOAD_COUNT = 16
+PRIORITY_MAX = 15
+
+
+def q16(value):
+    return int(round(value * 65536.0)) & 0xFFFFFFFF
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("csv", help="load,rating_kw,priority,min_on_ms,min_off_ms per line")
+    parser.add_argument("--kw-per-hz", type=float, required=True, help="kW to shed per Hz below the lower limit")
+    parser.add_argument("--kw-per-hz-s", type=float, default=0.0, help="kW to shed per Hz/s of falling RoC")
+    parser.add_argument("-o", "--output", default="registry.bin")
+    args = parser.parse_args()
+
+    loads = [(0, PRIORITY_MAX, 0, 0)] * LOAD_COUNT
+    with open(args.csv) as table:
+        for number, line in enumerate(table, 1):
+            line = line.strip()
+            if not line or line.startswith("#"):
+                continue
+            try:
+                load, rating, priority, min_on, min_off = (int(field) for field in line.split(","))
+            except ValueError:
+                sys.exit("%s:%d: expected five integers" % (args.csv, number))
+            if not 0 <= load < LOAD_COUNT or not 0 <= priority <= PRIORITY_MAX or \
+                    not 0 <= rating <= 0xFFFF or not 0 <= min_on <= 0xFFFF or not 0 <= min_off <= 0xFFFF:
+                sys.exit("%s:%d: value out of range" % (args.csv, number))
+            loads[load] = (rating, priority, min_on, min_off)
+
+    if args.kw_per_hz < 0 or args.kw_per_hz_s < 0:
+        sys.exit("the deficit response must not be negative")
+
+    body = struct.pack("<IHHII", MAGIC, VERSION, 0, q16(args.kw_per_hz), q16(args.kw_per_hz_s))
+    for rating, priority, min_on, min_off in loads:
+        body += struct.pack("<HBBHH", rating, priority, 0, min_on, min_off)
+    checksum = ~sum(struct.unpack("<%dI" % (len(body) // 4), body)) & 0xFFFFFFFF
+    with open(args.output, "wb") as image:
+        image.write(body + struct.pack("<I", checksum))
+    print("%s: %d wired loads, %d kW" % (args.output, sum(1 for load in loads if load[0]),
+                                         sum(load[0] for load in loads)))
+
+
+if __name__ == "__main__":
+    main()
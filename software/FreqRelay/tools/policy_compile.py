@@ -0,0 +1,256 @@
+#!/usr/bin/env python3
+"""Compile a FreqRelay shedding policy into its flash image.
+
+The policy is written as text, one statement per line, # to the end of a
+line a comment. Loads are named by priority, so a band or stage says
+which priorities it keeps or sheds instead of spelling out masks:
+
+    priority 0 0            # load 0, the critical load, is never shed
+    priority 1-2 1          # loads 1 and 2 at priority 1
+    priority 3-4 2
+    priority 5-6 3          # 0 is the most important
+    roc 60                  # RoC band boundary, Hz/s
+
+    # Bands, from where each starts below the lower limit (Hz, "in" for
+    # the first), and the loads kept with the RoC within and past "roc"
+    band in  p0-3 p0-1
+    band 0.0 p0-2 p0-1
+    band 1.0 p0-1 p0-1
+    band 2.0 p0   p0
+
+    # Trip curves (uf_curve.h, FREQ_UF_CURVES): pickup below the lower
+    # limit (Hz), the loads shed, the time, and how far above the pickup
+    # the frequency has to come back before they may return (Hz)
+    stage 0.0 p3   inverse 2000
+    stage 0.5 p2   inverse 1000
+    stage 1.0 p1   inverse 500
+    stage 2.0 p1-3 definite 100 reset 0.1
+
+A load set is pN (the loads of priority N), pA-B (priorities A to B), a
+mask such as 0x60, "none", or several of these joined with +. That file
+compiles to the built-in policy and curves.
+
+Everything is checked here, where it is cheap: the bands are ascending,
+the critical load is kept everywhere, a deeper band or a faster RoC keeps
+no load a shallower one sheds, and every value fits its field. The output
+is the policy table (load_policy.h) at the start of the policy sector and,
+with stages, the trip curves (uf_curve.h) 256 bytes in, their rate tables
+worked out as vUfCurveInit() would, so the target only checks the magic,
+version and checksum of each and indexes the tables:
+
+    tools/policy_compile.py site.policy -o policy.bin
+    bin2flash --input=policy.bin --output=policy.flash --location=0x7F0000
+    nios2-flash-programmer --base=<flash base> policy.flash
+    sim/replay -p policy.bin -g ramp-5 -c
+"""
+
+import argparse
+import math
+import re
+import struct
+import sys
+
+POLICY_MAGIC = 0x504F4C59  # "POLY"
+CURVE_MAGIC = 0x55464356  # "UFCV"
+CURVE_OFFSET = 0x100  # UF_CURVE_FLASH_OFFSET - POLICY_FLASH_OFFSET
+FREQ_BANDS = 4
+ROC_BANDS = 2
+STAGES_MAX = 8
+LUT_SIZE = 32
+LUT_SHIFT = 12
+TRIP_FULL = 1 << 24
+INVERSE_REF_Q16 = 32768  # UF_INVERSE_REF, 0.5 Hz
+INVERSE_MIN_MS = 50
+RESET_HZ = 0.1
+PORT_BITS = 16
+MASK_FORMATS = {1: "H", 2: "I", 3: "Q", 4: "Q"}  # LoadMask_t by LOAD_PORTS
+
+
+class PolicyError(Exception):
+    pass
+
+
+def q16(value, what):
+    """FIX16_CONST of a value that must fit a non-negative Q16.16."""
+    if not 0 <= value < 32768:
+        raise PolicyError("%s %g out of range" % (what, value))
+    return int(math.floor(value * 65536.0 + 0.5))
+
+
+def number(text, what):
+    try:
+        return float(text)
+    except ValueError:
+        raise PolicyError("%s: expected a number, not %r" % (what, text))
+
+
+def integer(text, what, low, high):
+    try:
+        value = int(text, 0)
+    except ValueError:
+        raise PolicyError("%s: expected an integer, not %r" % (what, text))
+    if not low <= value <= high:
+        raise PolicyError("%s %d out of range %d-%d" % (what, value, low, high))
+    return value
+
+
+def span(text, what, high):
+    """A or A-B as a range of integers up to high."""
+    first, _, last = text.partition("-")
+    first = integer(first, what, 0, high)
+    last = integer(last, what, first, high) if last else first
+    return range(first, last + 1)
+
+
+class Policy:
+    def __init__(self, ports):
+        self.loads = ports * PORT_BITS
+        self.priority = {}
+        self.roc = None
+        self.bands = []
+        self.stages = []
+
+    def mask(self, text):
+        """A load set as a mask."""
+        mask = 0
+        for term in text.split("+"):
+            if term == "none":
+                continue
+            if term.startswith("0x"):
+                value = integer(term, "mask", 0, (1 << self.loads) - 1)
+            elif term.startswith("p"):
+                levels = span(term[1:], "priority", 15)
+                value = sum(1 << load for load, level in self.priority.items() if level in levels)
+                if value == 0:
+                    raise PolicyError("no load has priority %s" % term[1:])
+            else:
+                raise PolicyError("load set %r is not pN, pA-B, a mask or none" % term)
+            mask |= value
+        return mask
+
+    def statement(self, words):
+        keyword, args = words[0], words[1:]
+        if keyword == "priority" and len(args) == 2:
+            level = integer(args[1], "priority", 0, 15)
+            for load in span(args[0], "load", self.loads - 1):
+                if load == 0 and level != 0:
+                    raise PolicyError("load 0 is the critical load, priority 0")
+                self.priority[load] = level
+        elif keyword == "roc" and len(args) == 1:
+            self.roc = q16(number(args[0], "roc"), "roc")
+        elif keyword == "band" and len(args) == 3:
+            start = None if args[0] == "in" else q16(number(args[0], "band start"), "band start")
+            if (start is None) != (not self.bands):
+                raise PolicyError('only the first band starts "in"')
+            self.bands.append((start, self.mask(args[1]), self.mask(args[2])))
+        elif keyword == "stage" and len(args) in (4, 6):
+            if args[2] not in ("inverse", "definite"):
+                raise PolicyError("a stage is inverse or definite, not %r" % args[2])
+            reset = RESET_HZ
+            if len(args) == 6:
+                if args[4] != "reset":
+                    raise PolicyError("expected reset, not %r" % args[4])
+                reset = number(args[5], "reset")
+            self.stages.append((q16(number(args[0], "pickup"), "pickup"), self.mask(args[1]),
+                                integer(args[3], "delay ms", 0, 0xFFFF), args[2] == "inverse",
+                                q16(reset, "reset")))
+        else:
+            raise PolicyError("cannot read %r" % " ".join(words))
+
+    def check(self):
+        if self.roc is None:
+            raise PolicyError("no roc boundary")
+        if len(self.bands) != FREQ_BANDS:
+            raise PolicyError("%d bands, the table has %d" % (len(self.bands), FREQ_BANDS))
+        starts = [band[0] for band in self.bands[1:]]
+        if starts != sorted(starts):
+            raise PolicyError("the bands must start ever further below the limit")
+        for i, (_, ok, fast) in enumerate(self.bands):
+            if not ok & fast & 1:
+                raise PolicyError("band %d sheds the critical load" % i)
+            if fast & ~ok:
+                raise PolicyError("band %d keeps more loads with the RoC past the boundary" % i)
+            if i and (ok & ~self.bands[i - 1][1] or fast & ~self.bands[i - 1][2]):
+                raise PolicyError("band %d keeps loads the band above it sheds" % i)
+        if len(self.stages) > STAGES_MAX:
+            raise PolicyError("%d stages, at most %d" % (len(self.stages), STAGES_MAX))
+        for i, stage in enumerate(self.stages):
+            if stage[1] & 1:
+                raise PolicyError("stage %d sheds the critical load" % i)
+            if stage[1] == 0:
+                raise PolicyError("stage %d sheds nothing" % i)
+
+
+def rates(delay_ms, inverse):
+    """The stage's rate table, as vUfCurveInit() builds it."""
+    table = []
+    for i in range(LUT_SIZE):
+        t_ms = delay_ms
+        if inverse:
+            t_ms = max(t_ms * INVERSE_REF_Q16 // ((2 * i + 1) << (LUT_SHIFT - 1)), INVERSE_MIN_MS)
+        table.append(TRIP_FULL // (t_ms or 1))
+    return table
+
+
+def sealed(body):
+    """The image with its checksum, ~ the sum of the words before it."""
+    return body + struct.pack("<I", ~sum(struct.unpack("<%dI" % (len(body) // 4), body)) & 0xFFFFFFFF)
+
+
+def compile_policy(policy, ports):
+    mask = "<" + MASK_FORMATS[ports]
+    version = (ports - 1) << 8 | 1
+    body = struct.pack("<IHH", POLICY_MAGIC, version, 0)
+    body += struct.pack("<3I", *(band[0] for band in policy.bands[1:]))
+    body += struct.pack("<I", policy.roc)
+    for _, ok, fast in policy.bands:
+        body += struct.pack(mask, ok) + struct.pack(mask, fast)
+    image = sealed(body)
+    if not policy.stages:
+        return image
+
+    image += b"\xff" * (CURVE_OFFSET - len(image))
+    stages = policy.stages + [(0, 0, 0, False, 0)] * (STAGES_MAX - len(policy.stages))
+    body = struct.pack("<IHH", CURVE_MAGIC, version, len(policy.stages))
+    body += struct.pack("<8I", *(stage[0] for stage in stages))
+    body += struct.pack("<8I", *(stage[4] for stage in stages))
+    body += b"".join(struct.pack(mask, stage[1]) for stage in stages)
+    body += struct.pack("<8H", *(stage[2] for stage in stages))
+    body += struct.pack("<8B", *(int(stage[3]) for stage in stages))
+    for stage in stages:
+        body += struct.pack("<%dI" % LUT_SIZE, *(rates(stage[2], stage[3]) if stage[1] else [0] * LUT_SIZE))
+    return image + sealed(body)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("policy", help="policy text")
+    parser.add_argument("--ports", type=int, choices=sorted(MASK_FORMATS), default=1,
+                        help="LOAD_PORTS of the build, default %(default)s")
+    parser.add_argument("-o", "--output", default="policy.bin")
+    args = parser.parse_args()
+
+    policy = Policy(args.ports)
+    with open(args.policy) as text:
+        for number_, line in enumerate(text, 1):
+            words = re.sub(r"#.*", "", line).split()
+            if not words:
+                continue
+            try:
+                policy.statement(words)
+            except PolicyError as error:
+                sys.exit("%s:%d: %s" % (args.policy, number_, error))
+    try:
+        policy.check()
+    except PolicyError as error:
+        sys.exit("%s: %s" % (args.policy, error))
+
+    image = compile_policy(policy, args.ports)
+    with open(args.output, "wb") as out:
+        out.write(image)
+    print("%s: %d bands, %d trip stages, %d bytes" % (args.output, len(policy.bands), len(policy.stages),
+                                                      len(image)))
+
+
+if __name__ == "__main__":
+    main()
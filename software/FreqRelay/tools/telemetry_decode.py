@@ -0,0 +1,349 @@
+#!/usr/bin/env python3
+"""Convert a capture of the FreqRelay JTAG UART to CSV.
+
+Picks the telemetry frames described in telemetry.h out of the byte stream
+(skipping the printf text around them and any frame that fails its CRC) and
+writes one CSV row per frame. Columns that do not apply to a frame's type
+are left empty. Log records are formatted with the message texts from
+log_msg.h. With --comtrade, the exported disturbance records are written
+out as record_<n>.cfg and record_<n>.dat in that directory as well, and
+with --screens the screen captures as screen_<n>.ppm and screen_<n>.txt.
+
+    nios2-terminal | tee capture.bin        # or any raw capture
+    tools/telemetry_decode.py capture.bin > telemetry.csv
+    tools/telemetry_decode.py --comtrade records capture.bin > telemetry.csv
+    tools/telemetry_decode.py --screens screens capture.bin > telemetry.csv
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+SYNC = b"\x5a\xa5"
+VERSION = 1
+HEADER_LEN = 5  # sync, version/type, delta
+CRC_LEN = 2
+
+FREQ, DECISION, FAULT, STATE, LATENCY, TIME, LOST, LOG, WCET, INJECT, EXPORT, TRACE, HEALTH, QUEUE = range(1, 15)
+CHUNK_BYTES = 32  # TELEMETRY_CHUNK_BYTES
+
+# Payload layout per type, little endian
+PAYLOAD = {
+    FREQ: "<HhB",
+    DECISION: "<HH",
+    FAULT: "<HHH",
+    STATE: "<BB",
+    LATENCY: "<BIH",
+    TIME: "<I",
+    LOST: "<H",
+    LOG: "<BII",
+    WCET: "<BII",
+    INJECT: "<BHI",
+    EXPORT: "<HBIB%ds" % CHUNK_BYTES,
+    TRACE: "<hhBBH",
+    HEALTH: "<II",
+    QUEUE: "<BBHHBB",
+}
+
+NAMES = {
+    FREQ: "freq", DECISION: "decision", FAULT: "fault", STATE: "state",
+    LATENCY: "latency", TIME: "time", LOST: "lost", LOG: "log",
+    WCET: "wcet", INJECT: "inject", EXPORT: "export", TRACE: "trace",
+    HEALTH: "health", QUEUE: "queue",
+}
+
+STATES = {0: "normal", 1: "alert", 2: "failsafe"}
+LATENCIES = {0: "decision", 1: "shed"}
+
+# WCET_* probes in wcet.h
+PROBES = {0: "analyzer", 1: "decision", 2: "actuator", 3: "feedback", 4: "monitor",
+          5: "freq_isr", 6: "button_isr", 7: "reset_isr", 8: "failsafe_isr", 9: "tick",
+          10: "ui_lock", 11: "watchdog", 12: "state"}
+
+# COMTRADE_PART_* in comtrade.h, then SCREEN_CAPTURE_PART_* in screen_capture.h
+PARTS = {0: "cfg", 1: "dat", 2: "end", 3: "text", 4: "screen", 5: "screen_end"}
+
+# AUDIT_REASON_* in load_audit.h
+REASONS = {0: "boot", 1: "band", 2: "roc", 3: "predict", 4: "curve", 5: "registry",
+           6: "coord", 7: "failsafe", 8: "override", 9: "reset"}
+
+# FAULT_* faults in fault_inject.h
+FAULTS = {0: "stuck_low", 1: "stuck_high", 2: "feedback_delay", 3: "sample_drop",
+          4: "sample_dup", 5: "spurious_irq", 6: "cpu_hog", 7: "hog_priority"}
+
+COLUMNS = ["time_us", "record", "feeder", "freq_hz", "roc_hz_s", "stable",
+           "requested", "driven", "faulty", "feedback", "state", "alert",
+           "failsafe", "override", "latency", "elapsed_us", "deadline_ms",
+           "lost", "message", "probe", "cycles", "input", "fault", "setting",
+           "occurrences", "export", "part", "offset", "bytes", "deviation_hz",
+           "band", "reason", "kept", "health", "sequence", "slot", "peak",
+           "sends", "receives", "blocks", "timeouts"]
+
+LOG_MSG_H = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "log_msg.h")
+LOG_DEFINE = re.compile(r'^#define\s+LOG_\w+\s+(\d+)\s+//\s+"(.*)"\s*$')
+LOG_ARG = re.compile(r"%[udx]")
+
+
+def messages(path):
+    """Message number to format, from the LOG_* defines in log_msg.h."""
+    table = {}
+    with open(path) as header:
+        for line in header:
+            match = LOG_DEFINE.match(line)
+            if match:
+                table[int(match.group(1))] = match.group(2)
+    return table
+
+
+def format_log(table, number, args):
+    """Expand a format the way printf would for 32-bit argument words."""
+    text = table.get(number)
+    if text is None:
+        return "message %d: 0x%x 0x%x" % ((number,) + args)
+    words = iter(args)
+
+    def expand(match):
+        word = next(words, 0)
+        if match.group(0) == "%d":
+            return str(word - (1 << 32) if word & 0x80000000 else word)
+        if match.group(0) == "%x":
+            return "%x" % word
+        return str(word)
+
+    return LOG_ARG.sub(expand, text)
+
+
+def quote(text):
+    return '"%s"' % text.replace('"', '""')
+
+
+def crc16(data):
+    """CRC-16/CCITT-FALSE, as usTelemetryCrc()."""
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def frames(data):
+    """Yield (type, delta_us, fields) for every valid frame in data."""
+    pos = 0
+    while True:
+        pos = data.find(SYNC, pos)
+        if pos < 0 or pos + HEADER_LEN > len(data):
+            return
+        header = data[pos + 2]
+        kind = header & 0x1F
+        layout = PAYLOAD.get(kind)
+        if header >> 5 != VERSION or layout is None:
+            pos += 1
+            continue
+        end = pos + HEADER_LEN + struct.calcsize(layout)
+        if end + CRC_LEN > len(data):
+            return
+        (crc,) = struct.unpack_from("<H", data, end)
+        if crc != crc16(data[pos + 2:end]):
+            pos += 1
+            continue
+        (delta,) = struct.unpack_from("<H", data, pos + 3)
+        yield kind, delta, struct.unpack_from(layout, data, pos + HEADER_LEN)
+        pos = end + CRC_LEN
+
+
+def hex16(value):
+    return "0x%04x" % value
+
+
+def rows(data, table):
+    """Yield CSV rows, rebuilding absolute time from the delta stream."""
+    now = None
+    for kind, delta, fields in frames(data):
+        if kind == TIME:
+            now = fields[0]
+        elif now is not None:
+            now += delta
+        row = {"time_us": "" if now is None else now, "record": NAMES[kind]}
+        if kind == FREQ:
+            row.update(freq_hz="%.3f" % (fields[0] / 1000.0),
+                       roc_hz_s="%.2f" % (fields[1] / 100.0), stable=fields[2] & 1,
+                       feeder=fields[2] >> 1)
+        elif kind == DECISION:
+            row.update(requested=hex16(fields[0]), driven=hex16(fields[1]))
+        elif kind == FAULT:
+            row.update(faulty=hex16(fields[0]), driven=hex16(fields[1]),
+                       feedback=hex16(fields[2]))
+        elif kind == STATE:
+            row.update(state=STATES.get(fields[0], fields[0]),
+                       alert=fields[1] & 1, failsafe=(fields[1] >> 1) & 1,
+                       override=(fields[1] >> 2) & 1)
+        elif kind == LATENCY:
+            row.update(latency=LATENCIES.get(fields[0], fields[0]),
+                       elapsed_us=fields[1], deadline_ms=fields[2])
+        elif kind == LOST:
+            row.update(lost=fields[0])
+        elif kind == LOG:
+            row.update(message=quote(format_log(table, fields[0], fields[1:])))
+        elif kind == WCET:
+            row.update(probe=PROBES.get(fields[0], fields[0]), cycles=fields[1],
+                       input="0x%08x" % fields[2])
+        elif kind == INJECT:
+            row.update(fault=FAULTS.get(fields[0], fields[0]), setting=fields[1],
+                       occurrences=fields[2])
+        elif kind == TRACE:
+            row.update(feeder=fields[2] >> 4, deviation_hz="%.3f" % (fields[0] / 1000.0),
+                       roc_hz_s="%.2f" % (fields[1] / 100.0), band=fields[2] & 0xF,
+                       reason=REASONS.get(fields[3], fields[3]), kept=hex16(fields[4]))
+        elif kind == HEALTH:
+            row.update(health="0x%08x" % fields[0], sequence=fields[1], alert=fields[0] & 1,
+                       failsafe=(fields[0] >> 1) & 1, override=(fields[0] >> 2) & 1)
+        elif kind == QUEUE:
+            row.update(slot=fields[0], peak=fields[1], sends=fields[2], receives=fields[3],
+                       blocks=fields[4], timeouts=fields[5])
+        elif kind == EXPORT:
+            row.update(export=fields[0], part=PARTS.get(fields[1], fields[1]),
+                       offset=fields[2], bytes=fields[3])
+        yield row, kind, fields
+
+
+def place(parts, key, offset, length, data):
+    """Puts a chunk's bytes at its offset in the part they belong to."""
+    buffer = bytearray(parts.get(key, b""))
+    if len(buffer) < offset + length:
+        buffer.extend(bytes(offset + length - len(buffer)))
+    buffer[offset:offset + length] = data[:length]
+    parts[key] = bytes(buffer)
+
+
+class Comtrade:
+    """Reassembles exported records from their chunks, each placed at its
+    offset, and writes a record's files once its end chunk arrives."""
+
+    def __init__(self, directory):
+        self.directory = directory
+        self.parts = {}
+        os.makedirs(directory, exist_ok=True)
+
+    def add(self, fields):
+        record, part, offset, length, data = fields
+        if part > 2:
+            return
+        if part == 2:
+            for number, suffix in ((0, "cfg"), (1, "dat")):
+                name = os.path.join(self.directory, "record_%d.%s" % (record, suffix))
+                with open(name, "wb") as out:
+                    out.write(self.parts.pop((record, number), b""))
+            return
+        place(self.parts, (record, part), offset, length, data)
+
+
+def unrun(data, at, count, size):
+    """Decodes one run-length encoded row of count values of size bytes from
+    data at at, returning the values and where the next row starts."""
+    values = []
+    while len(values) < count and at < len(data):
+        code = data[at]
+        at += 1
+        if code < 0x80:
+            for _ in range(code + 1):
+                values.append(int.from_bytes(data[at:at + size], "little"))
+                at += size
+            continue
+        if code == 0xFF:
+            run = struct.unpack_from("<H", data, at)[0]
+            at += 2
+        else:
+            run = code - 0x7E
+        values.extend([int.from_bytes(data[at:at + size], "little")] * run)
+        at += size
+    return values[:count] + [0] * (count - len(values)), at
+
+
+def rgb(pixel, size):
+    """8 bit red, green and blue of a VGA_RASTER_BYTES_PER_PIXEL pixel."""
+    if size == 4:
+        return bytes(((pixel >> 22) & 0xFF, (pixel >> 12) & 0xFF, (pixel >> 2) & 0xFF))
+    if size == 2:
+        return bytes((((pixel >> 11) & 0x1F) * 255 // 31, ((pixel >> 5) & 0x3F) * 255 // 63,
+                      (pixel & 0x1F) * 255 // 31))
+    return bytes((((pixel >> 5) & 0x7) * 255 // 7, ((pixel >> 2) & 0x7) * 255 // 7, (pixel & 0x3) * 255 // 3))
+
+
+class Screens:
+    """Reassembles screen captures like Comtrade does records, and writes
+    the character buffer as text and the frame as a binary PPM."""
+
+    def __init__(self, directory):
+        self.directory = directory
+        self.parts = {}
+        os.makedirs(directory, exist_ok=True)
+
+    def add(self, fields):
+        record, part, offset, length, data = fields
+        if part in (3, 4):
+            place(self.parts, (record, part), offset, length, data)
+        elif part == 5:
+            self.text(record, self.parts.pop((record, 3), b""))
+            self.image(record, self.parts.pop((record, 4), b""))
+
+    def text(self, record, data):
+        if len(data) < 2:
+            return
+        cols, count, at, lines = data[0], data[1], 2, []
+        for _ in range(count):
+            values, at = unrun(data, at, cols, 1)
+            lines.append(bytes(values).decode("latin-1").rstrip())
+        with open(os.path.join(self.directory, "screen_%d.txt" % record), "w") as out:
+            out.write("\n".join(lines) + "\n")
+
+    def image(self, record, data):
+        if len(data) < 5:
+            return
+        width, height, size = struct.unpack_from("<HHB", data)
+        at, pixels = 5, bytearray()
+        for _ in range(height):
+            values, at = unrun(data, at, width, size)
+            for pixel in values:
+                pixels += rgb(pixel, size)
+        with open(os.path.join(self.directory, "screen_%d.ppm" % record), "wb") as out:
+            out.write(b"P6\n%d %d\n255\n" % (width, height))
+            out.write(bytes(pixels))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("capture", nargs="?", help="raw capture, default stdin")
+    parser.add_argument("-t", "--type", action="append", choices=sorted(NAMES.values()),
+                        help="only these record types (repeatable)")
+    parser.add_argument("-m", "--messages", default=LOG_MSG_H, help="log message formats, default %(default)s")
+    parser.add_argument("-c", "--comtrade", metavar="DIR", help="write exported COMTRADE records here")
+    parser.add_argument("-s", "--screens", metavar="DIR", help="write screen captures here")
+    args = parser.parse_args()
+    table = messages(args.messages)
+
+    if args.capture:
+        with open(args.capture, "rb") as capture:
+            data = capture.read()
+    else:
+        data = sys.stdin.buffer.read()
+
+    comtrade = Comtrade(args.comtrade) if args.comtrade else None
+    screens = Screens(args.screens) if args.screens else None
+    out = sys.stdout
+    out.write(",".join(COLUMNS) + "\n")
+    for row, kind, fields in rows(data, table):
+        if comtrade and kind == EXPORT:
+            comtrade.add(fields)
+        if screens and kind == EXPORT:
+            screens.add(fields)
+        if args.type and row["record"] not in args.type:
+            continue
+        out.write(",".join(str(row.get(column, "")) for column in COLUMNS) + "\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,183 @@
+/**
+ * Staged under-frequency trip curves
+ *
+ * See uf_curve.h.
+ */
+
+/* Standard includes */
+#include <stddef.h>
+#include <string.h>
+
+/* Hardware includes */
+#include "system.h"
+#include "sys/alt_flash.h"
+
+/* Application includes */
+#include "uf_curve.h"
+
+/* The policy's load groups, bit 0 is the critical load */
+#define UF_LOADS_HIGH                  0x0006
+#define UF_LOADS_MEDIUM                0x0018
+#define UF_LOADS_LOW                   0x0060
+
+const UfStage_t xUfDefaultStages[] = {
+    { FIX16_CONST(0.0), UF_LOADS_LOW,                                  2000, 1, UF_RESET_Q16 },
+    { FIX16_CONST(0.5), UF_LOADS_MEDIUM,                               1000, 1, UF_RESET_Q16 },
+    { FIX16_CONST(1.0), UF_LOADS_HIGH,                                 500,  1, UF_RESET_Q16 },
+    { FIX16_CONST(2.0), UF_LOADS_HIGH | UF_LOADS_MEDIUM | UF_LOADS_LOW, 100, 0, UF_RESET_Q16 },
+};
+const uint32_t ulUfDefaultStageCount = sizeof(xUfDefaultStages) / sizeof(xUfDefaultStages[0]);
+
+void vUfCurveInit(UfCurves_t *pxCurves, const UfStage_t *pxStages, uint32_t count) {
+    uint32_t s, i, depth, t_ms;
+
+    memset(pxCurves, 0, sizeof(*pxCurves));
+    pxCurves->count = count < UF_STAGES_MAX ? count : UF_STAGES_MAX;
+
+    for (s = 0; s < pxCurves->count; s++) {
+        pxCurves->stage[s] = pxStages[s];
+        for (i = 0; i < UF_LUT_SIZE; i++) {
+            t_ms = pxStages[s].delay_ms;
+            if (pxStages[s].inverse) {
+                depth = (2 * i + 1) << (UF_LUT_SHIFT - 1);  // Middle of the step
+                t_ms = (uint32_t)(((uint64_t)t_ms * UF_INVERSE_REF_Q16) / depth);
+                if (t_ms < UF_INVERSE_MIN_MS) {
+                    t_ms = UF_INVERSE_MIN_MS;
+                }
+            }
+            pxCurves->rate[s][i] = UF_TRIP_FULL / (t_ms ? t_ms : 1);
+        }
+    }
+}
+
+/* Word sum as the policy image's, the checksum field left out */
+static uint32_t ulUfCurveChecksum(const UfCurveImage_t *pxImage) {
+    const uint32_t *pulWord = (const uint32_t *)pxImage;
+    uint32_t words = offsetof(UfCurveImage_t, checksum) / sizeof(uint32_t);
+    uint32_t sum = 0;
+
+    while (words--) {
+        sum += *pulWord++;
+    }
+    return ~sum;
+}
+
+/* The compiler checked the stages; this only keeps a corrupt or foreign
+ * image from indexing past the tables */
+static int xUfCurveImageValid(const UfCurveImage_t *pxImage) {
+    uint32_t s;
+
+    if (pxImage->magic != UF_CURVE_MAGIC || pxImage->version != UF_CURVE_VERSION ||
+        pxImage->count == 0 || pxImage->count > UF_STAGES_MAX ||
+        pxImage->checksum != ulUfCurveChecksum(pxImage)) {
+        return 0;
+    }
+    for (s = 0; s < pxImage->count; s++) {
+        if (pxImage->pickup[s] < 0 || pxImage->reset[s] < 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int xUfCurveLoad(UfCurves_t *pxCurves) {
+    static UfCurveImage_t xImage;      // Too large for a start-up stack
+    alt_flash_fd *fd;
+    uint32_t s;
+    int valid;
+
+    fd = alt_flash_open_dev(FLASH_CONTROLLER_NAME);
+    if (fd == NULL) {
+        return 0;
+    }
+    valid = alt_read_flash(fd, UF_CURVE_FLASH_OFFSET, &xImage, sizeof(xImage)) == 0 &&
+            xUfCurveImageValid(&xImage);
+    alt_flash_close_dev(fd);
+    if (!valid) {
+        return 0;
+    }
+
+    memset(pxCurves, 0, sizeof(*pxCurves));
+    pxCurves->count = xImage.count;
+    for (s = 0; s < xImage.count; s++) {
+        pxCurves->stage[s].pickup = xImage.pickup[s];
+        pxCurves->stage[s].loads = xImage.loads[s];
+        pxCurves->stage[s].delay_ms = xImage.delay_ms[s];
+        pxCurves->stage[s].inverse = xImage.inverse[s];
+        pxCurves->stage[s].reset = xImage.reset[s];
+    }
+    memcpy(pxCurves->rate, xImage.rate, sizeof(pxCurves->rate));
+    return 1;
+}
+
+void vUfCurveReset(UfCurveState_t *pxState) {
+    memset(pxState, 0, sizeof(*pxState));
+}
+
+LoadMask_t xUfCurveShed(const UfCurves_t *pxCurves, UfCurveState_t *pxState, fix16_t deviation,
+                        uint32_t now_ms) {
+    uint32_t dt = pxState->started ? now_ms - pxState->last_ms : 0;
+    uint32_t s, step, rate;
+    LoadMask_t shed = 0;
+    uint16_t bit;
+    fix16_t below;
+
+    pxState->last_ms = now_ms;
+    pxState->started = 1;
+    if (dt > UF_DT_MAX_MS) {
+        dt = UF_DT_MAX_MS;             // Keeps rate * dt in 32 bits
+    }
+
+    for (s = 0, bit = 1; s < pxCurves->count; s++, bit <<= 1) {
+        below = deviation - pxCurves->stage[s].pickup;
+        if (below <= 0) {
+            /* Recovered: a running timer resets straight away, a tripped
+             * stage once clear of the pickup by the reset margin */
+            pxState->acc[s] = 0;
+            if (below <= -pxCurves->stage[s].reset) {
+                pxState->tripped &= ~bit;
+            }
+        } else if (!(pxState->tripped & bit)) {
+            step = (uint32_t)below >> UF_LUT_SHIFT;
+            rate = pxCurves->rate[s][step < UF_LUT_SIZE ? step : UF_LUT_SIZE - 1];
+            pxState->acc[s] += rate * dt;
+            if (rate >= UF_TRIP_FULL || pxState->acc[s] >= UF_TRIP_FULL) {
+                pxState->tripped |= bit;
+                pxState->acc[s] = 0;
+            }
+        }
+        if (pxState->tripped & bit) {
+            shed |= pxCurves->stage[s].loads;
+        }
+    }
+    return shed;
+}
+
+uint32_t ulUfCurveTripUs(const UfCurves_t *pxCurves, const UfCurveState_t *pxState, fix16_t deviation,
+                         LoadMask_t *pxLoads) {
+    uint32_t s, step, rate, us, first = UF_TRIP_NEVER;
+    uint16_t bit;
+    fix16_t below;
+
+    *pxLoads = 0;
+    for (s = 0, bit = 1; s < pxCurves->count; s++, bit <<= 1) {
+        below = deviation - pxCurves->stage[s].pickup;
+        if (below <= 0 || (pxState->tripped & bit)) {
+            continue;
+        }
+        step = (uint32_t)below >> UF_LUT_SHIFT;
+        rate = pxCurves->rate[s][step < UF_LUT_SIZE ? step : UF_LUT_SIZE - 1];
+        if (rate == 0) {
+            continue;
+        }
+        us = (uint32_t)((uint64_t)(UF_TRIP_FULL - pxState->acc[s]) * 1000 / rate);
+        if (us < first) {
+            first = us;
+            *pxLoads = 0;
+        }
+        if (us == first) {
+            *pxLoads |= pxCurves->stage[s].loads;  // Stages tripping together
+        }
+    }
+    return first;
+}
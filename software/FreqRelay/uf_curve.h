@@ -0,0 +1,131 @@
+/**
+ * Staged under-frequency trip curves
+ *
+ * Utility load shedding is staged: each stage has a pickup some way below
+ * the lower limit and sheds its loads once the frequency has stayed below
+ * it for long enough. How long is either a definite time, or an inverse
+ * time that shortens the deeper the frequency goes:
+ *
+ *   t = delay_ms * UF_INVERSE_REF / (depth below the pickup)
+ *
+ * so delay_ms is the time at UF_INVERSE_REF Hz below the pickup, never less
+ * than UF_INVERSE_MIN_MS. A stage trips when the integral of 1/t over the
+ * time spent below its pickup reaches one, the way an induction disc or a
+ * numerical relay's timer does; a frequency that dips and recovers before
+ * then resets it, and a deeper dip gets there sooner.
+ *
+ * The curves are worked out once, in vUfCurveInit(): each stage gets a
+ * table of UF_LUT_SIZE rates, UF_TRIP_FULL / t at the middle of each
+ * 1/2^(16 - UF_LUT_SHIFT) Hz step of depth (the last step standing for
+ * anything deeper). An evaluation is then, per stage, one compare, one
+ * table read and one multiply-add into the stage's accumulator by the
+ * milliseconds since the last one: O(stages), integers only.
+ *
+ * A tripped stage keeps its loads shed until the frequency is back its
+ * reset margin (UF_RESET_HZ for the built-in stages) above its pickup;
+ * they then come back through the decision's stable hold-off like any
+ * other. Stage pickups are relative to the
+ * feeder's lower limit, like the policy bands, so editing the limit moves
+ * the curves with it.
+ *
+ * One UfCurves_t holds the stage table for every feeder, and each feeder
+ * keeps its own UfCurveState_t, used by the decision only.
+ *
+ * A site's own curves come compiled (tools/policy_compile.py) as a
+ * UfCurveImage_t in flash after the policy table: the stages, each with
+ * its own reset margin, and the rate tables already worked out, so
+ * xUfCurveLoad() only copies them in after the magic, version, checksum and
+ * a few bounds check out, with no divisions or float at boot.
+ */
+
+#ifndef UF_CURVE_H
+#define UF_CURVE_H
+
+#include <stdint.h>
+#include "fix16.h"
+#include "load_mask.h"
+
+#define UF_STAGES_MAX                  8     // One tripped bit each
+#define UF_LUT_SIZE                    32    // Depth steps per stage
+#define UF_LUT_SHIFT                   12    // Q16.16 depth >> this is the step, 1/16 Hz
+#define UF_TRIP_FULL                   (1UL << 24)  // Accumulator at which a stage trips
+#define UF_DT_MAX_MS                   200   // Longest gap between evaluations counted
+#define UF_INVERSE_REF                 0.5   // Depth at which an inverse stage takes delay_ms (Hz)
+#define UF_INVERSE_MIN_MS              50    // Shortest inverse time, however deep
+#define UF_RESET_HZ                    0.1   // Built-in stages' reset margin above the pickup
+
+#define UF_TRIP_NEVER                  0xFFFFFFFFUL
+
+/* Flash image identification */
+#define UF_CURVE_MAGIC                 0x55464356UL  // "UFCV"
+#define UF_CURVE_VERSION               ((LOAD_PORTS - 1) << 8 | 1)  // The mask width is part of the layout
+#define UF_CURVE_FLASH_OFFSET          0x7F0100      // POLICY_FLASH_OFFSET + 256, behind the policy
+
+#define UF_INVERSE_REF_Q16             FIX16_CONST(UF_INVERSE_REF)
+#define UF_RESET_Q16                   FIX16_CONST(UF_RESET_HZ)
+
+typedef struct {
+    fix16_t pickup;                    // Deviation below the lower limit where it starts (Hz)
+    LoadMask_t loads;                  // Shed when it trips
+    uint16_t delay_ms;                 // Definite time, or inverse time at UF_INVERSE_REF
+    uint8_t inverse;                   // 0: definite time
+    fix16_t reset;                     // Above the pickup to reset once tripped (Hz)
+} UfStage_t;
+
+typedef struct {
+    uint32_t count;                    // Stages in use
+    UfStage_t stage[UF_STAGES_MAX];
+    uint32_t rate[UF_STAGES_MAX][UF_LUT_SIZE];  // UF_TRIP_FULL / t, per ms
+} UfCurves_t;
+
+typedef struct {
+    uint32_t acc[UF_STAGES_MAX];       // Towards UF_TRIP_FULL
+    uint32_t last_ms;                  // Time of the last evaluation
+    uint16_t tripped;                  // One bit per stage
+    uint8_t started;                   // last_ms is valid
+} UfCurveState_t;
+
+/* Compiled curves as flashed, all fields little endian */
+typedef struct {
+    uint32_t magic;                    // UF_CURVE_MAGIC
+    uint16_t version;                  // UF_CURVE_VERSION
+    uint16_t count;                    // Stages in use, 1 to UF_STAGES_MAX
+    fix16_t pickup[UF_STAGES_MAX];
+    fix16_t reset[UF_STAGES_MAX];
+    LoadMask_t loads[UF_STAGES_MAX];
+    uint16_t delay_ms[UF_STAGES_MAX];
+    uint8_t inverse[UF_STAGES_MAX];
+    uint32_t rate[UF_STAGES_MAX][UF_LUT_SIZE];
+    uint32_t checksum;                 // As ulLoadPolicyChecksum, everything above
+} UfCurveImage_t;
+
+/* Built-in stages: the policy's load groups go at 0, 0.5 and 1 Hz below
+ * the lower limit on inverse curves, and everything but the critical load
+ * after a definite 100 ms at 2 Hz */
+extern const UfStage_t xUfDefaultStages[];
+extern const uint32_t ulUfDefaultStageCount;
+
+/* Build the rate tables for count stages (at most UF_STAGES_MAX, the rest
+ * are dropped). A delay_ms of 0 trips on the first evaluation below the
+ * pickup. */
+void vUfCurveInit(UfCurves_t *pxCurves, const UfStage_t *pxStages, uint32_t count);
+
+/* Replace the curves with the image in flash if there is a valid one.
+ * Returns 1 if it was taken, 0 if the curves are as they were. */
+int xUfCurveLoad(UfCurves_t *pxCurves);
+
+/* Nothing picked up or tripped */
+void vUfCurveReset(UfCurveState_t *pxState);
+
+/* One evaluation at now_ms (wrapping), deviation being lower_limit -
+ * frequency as for the policy. Returns the loads of every tripped stage. */
+LoadMask_t xUfCurveShed(const UfCurves_t *pxCurves, UfCurveState_t *pxState, fix16_t deviation,
+                        uint32_t now_ms);
+
+/* After an evaluation: the microseconds until the first stage still
+ * running would trip if the deviation stayed where it is, with the loads
+ * it sheds in *pxLoads. UF_TRIP_NEVER and no loads if none is running. */
+uint32_t ulUfCurveTripUs(const UfCurves_t *pxCurves, const UfCurveState_t *pxState, fix16_t deviation,
+                         LoadMask_t *pxLoads);
+
+#endif /* UF_CURVE_H */
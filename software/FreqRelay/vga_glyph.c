@@ -0,0 +1,109 @@
+/**
+ * Large digit readouts on the pixel buffer
+ *
+ * See vga_glyph.h.
+ */
+
+/* Standard includes */
+#include <string.h>
+
+/* Application includes */
+#include "vga_glyph.h"
+
+#define GLYPH_COUNT                    13     // Digits, '.', '-', blank
+#define GLYPH_BLANK                    12
+
+/* 5x7 font, a row a byte, bit 4 the leftmost pixel */
+static const uint8_t ucFont[GLYPH_COUNT][GLYPH_FONT_Y] = {
+    { 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E },  // 0
+    { 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E },  // 1
+    { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F },  // 2
+    { 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E },  // 3
+    { 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 },  // 4
+    { 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E },  // 5
+    { 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E },  // 6
+    { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 },  // 7
+    { 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E },  // 8
+    { 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C },  // 9
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C },  // .
+    { 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00 },  // -
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },  // blank
+};
+
+/* Every glyph as the frame rows of one cell */
+static uint32_t ulGlyphCache[GLYPH_COUNT][GLYPH_CELL_Y * GLYPH_CELL_WORDS];
+
+static int xGlyphIndex(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c == '.') {
+        return 10;
+    }
+    if (c == '-') {
+        return 11;
+    }
+    return GLYPH_BLANK;
+}
+
+void vGlyphInit(uint32_t color, uint32_t background) {
+    uint32_t *pulRow;
+    uint32_t pixel;
+    int g, y, x, font_x;
+
+    for (g = 0; g < GLYPH_COUNT; g++) {
+        for (y = 0; y < GLYPH_CELL_Y; y++) {
+            pulRow = &ulGlyphCache[g][y * GLYPH_CELL_WORDS];
+            memset(pulRow, 0, GLYPH_CELL_WORDS * sizeof(uint32_t));
+            for (x = 0; x < GLYPH_CELL_X; x++) {
+                font_x = x / GLYPH_SCALE;
+                pixel = font_x < GLYPH_FONT_X &&
+                        (ucFont[g][y / GLYPH_SCALE] & (0x10 >> font_x)) ? color : background;
+                pulRow[x / RASTER_PIXELS_PER_WORD] |=
+                    (pixel & RASTER_INVERT) << (8 * VGA_RASTER_BYTES_PER_PIXEL * (x % RASTER_PIXELS_PER_WORD));
+            }
+        }
+    }
+}
+
+void vGlyphReadoutInit(GlyphReadout_t *pxReadout, int x, int y, int cells) {
+    memset(pxReadout, 0, sizeof(*pxReadout));
+    pxReadout->x = (int16_t)x;
+    pxReadout->y = (int16_t)y;
+    pxReadout->cells = (uint8_t)(cells < GLYPH_MAX_CELLS ? cells : GLYPH_MAX_CELLS);
+}
+
+/* pcText right aligned in the readout's cells, blanks to the left */
+static void vGlyphAlign(const GlyphReadout_t *pxReadout, const char *pcText, char *pcCells) {
+    int len = (int)strlen(pcText);
+    int pad = pxReadout->cells - len;
+    int i;
+
+    for (i = 0; i < pxReadout->cells; i++) {
+        pcCells[i] = i < pad ? ' ' : pcText[i - (pad > 0 ? pad : 0)];
+    }
+}
+
+int xGlyphReadoutDiffers(const GlyphReadout_t *pxReadout, const char *pcText) {
+    char cells[GLYPH_MAX_CELLS];
+
+    vGlyphAlign(pxReadout, pcText, cells);
+    return memcmp(cells, pxReadout->shown, pxReadout->cells) != 0;
+}
+
+int xGlyphReadoutPut(GlyphReadout_t *pxReadout, const char *pcText) {
+    char cells[GLYPH_MAX_CELLS];
+    int i, drawn = 0;
+
+    vGlyphAlign(pxReadout, pcText, cells);
+    for (i = 0; i < pxReadout->cells; i++) {
+        if (cells[i] == pxReadout->shown[i]) {
+            continue;
+        }
+        vRasterBlit(pxReadout->x + i * GLYPH_CELL_X, pxReadout->y, ulGlyphCache[xGlyphIndex(cells[i])],
+                    GLYPH_CELL_WORDS, GLYPH_CELL_Y);
+        pxReadout->shown[i] = cells[i];
+        drawn++;
+    }
+    return drawn;
+}
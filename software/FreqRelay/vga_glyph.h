@@ -0,0 +1,55 @@
+/**
+ * Large digit readouts on the pixel buffer
+ *
+ * The character buffer's 8x8 text is too small to read across a control
+ * room, so the frequency is also shown in digits GLYPH_SCALE times the size
+ * of a 5x7 font, drawn on the pixel buffer. vGlyphInit() rasterises every
+ * glyph once, at boot, into a cache of frame rows in the compiled pixel
+ * format (packed 32-bit words, see vRasterBlit()), foreground and background
+ * both, so a glyph is drawn by copying words and needs no clear.
+ *
+ * A readout remembers the characters it shows, and redraws only the cells
+ * whose character changed: a change is one cell of GLYPH_CELL_Y rows of
+ * GLYPH_CELL_WORDS words, and a steady reading costs a string compare.
+ * Characters other than digits, '.', '-' and ' ' show as blanks.
+ *
+ * Cells must stay out of anything that scrolls or is erased under them,
+ * and the cursor must be off them while they are drawn. One task draws.
+ */
+
+#ifndef VGA_GLYPH_H
+#define VGA_GLYPH_H
+
+#include <stdint.h>
+#include "vga_raster.h"
+
+#define GLYPH_FONT_X                   5
+#define GLYPH_FONT_Y                   7
+#define GLYPH_SCALE                    3      // Frame pixels per font pixel
+#define GLYPH_CELL_X                   16     // Glyph and a gap, whole words at every depth
+#define GLYPH_CELL_Y                   (GLYPH_FONT_Y * GLYPH_SCALE)
+#define GLYPH_CELL_WORDS               (GLYPH_CELL_X / RASTER_PIXELS_PER_WORD)
+#define GLYPH_MAX_CELLS                8      // Longest readout
+
+typedef struct {
+    int16_t x;                         // Top left of the first cell, a word boundary
+    int16_t y;
+    uint8_t cells;
+    char shown[GLYPH_MAX_CELLS];       // 0: cell not drawn yet
+} GlyphReadout_t;
+
+/* Rasterise the font in two colours of the pixel format (RASTER_RGB) */
+void vGlyphInit(uint32_t color, uint32_t background);
+
+/* An empty readout of cells cells, at most GLYPH_MAX_CELLS */
+void vGlyphReadoutInit(GlyphReadout_t *pxReadout, int x, int y, int cells);
+
+/* Non-zero if pcText (right aligned, cut to the cells) would change what
+ * the readout shows */
+int xGlyphReadoutDiffers(const GlyphReadout_t *pxReadout, const char *pcText);
+
+/* Show pcText right aligned, drawing only the cells that change. Returns
+ * the cells drawn. */
+int xGlyphReadoutPut(GlyphReadout_t *pxReadout, const char *pcText);
+
+#endif /* VGA_GLYPH_H */
@@ -0,0 +1,666 @@
+/**
+ * Span-based rasterizer for the VGA pixel buffer
+ *
+ * See vga_raster.h.
+ */
+
+/* Standard includes */
+#include <stdlib.h>
+
+/* Scheduler includes */
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/* Hardware includes */
+#include "system.h"
+#include "io.h"
+
+/* Application includes */
+#include "irq_defer.h"
+#include "vga_raster.h"
+
+static alt_up_pixel_buffer_dma_dev *pxRasterDev = NULL;
+static int xRasterReady = 0;
+static int xRowShift;                  // log2 of the X-Y mode row pitch in bytes
+static int xResX, xResY;
+
+/* What a span does with its pixels */
+#define RASTER_STORE                   0     // Colour into the frame
+#define RASTER_RESTORE                 1     // Background into the frame
+#define RASTER_BACKGROUND              2     // Colour into the background
+
+#if VGA_RASTER_BYTES_PER_PIXEL == 4
+typedef uint32_t RasterPixel_t;
+#define rasterWRITE(addr, v)           IOWR_32DIRECT(addr, 0, v)
+#elif VGA_RASTER_BYTES_PER_PIXEL == 2
+typedef uint16_t RasterPixel_t;
+#define rasterWRITE(addr, v)           IOWR_16DIRECT(addr, 0, v)
+#else
+typedef uint8_t RasterPixel_t;
+#define rasterWRITE(addr, v)           IOWR_8DIRECT(addr, 0, v)
+#endif
+
+/* Background layer, rows of xResX pixels. Ordinary cached SDRAM: only the
+ * CPU reads or writes it. */
+static RasterPixel_t xBackground[VGA_RASTER_LAYER_X * VGA_RASTER_LAYER_Y];
+static int xBackgroundReady = 0;
+
+#if VGA_RASTER_ENGINE
+/* 2D engine registers, word offsets. A command is four words pushed into
+ * CMD: opcode, first corner, second corner, colour (or offset for a
+ * scroll), each a pair packed as x | y << 16. The engine clips to RES. */
+#define RASTER_ENGINE_CMD              0     // Command FIFO, write only
+#define RASTER_ENGINE_STATUS           1     // Free FIFO words in 15:0, busy in 31
+#define RASTER_ENGINE_FRAME            2     // Frame base address
+#define RASTER_ENGINE_PITCH            3     // log2 of the row pitch in bytes
+#define RASTER_ENGINE_RES              4     // x | y << 16
+#define RASTER_ENGINE_IRQ_ENABLE       5     // 1: interrupt while idle
+
+#define RASTER_ENGINE_FREE_MSK         0xFFFF
+#define RASTER_ENGINE_BUSY_MSK         0x80000000UL
+#define RASTER_ENGINE_CMD_WORDS        4
+
+#define RASTER_OP_LINE                 1
+#define RASTER_OP_FILL                 2
+#define RASTER_OP_SCROLL               3
+
+#define rasterXY(x, y)                 (((uint32_t)(x) & 0xFFFF) | ((uint32_t)(y) << 16))
+
+static int xEngineReady = 0;
+static volatile TaskHandle_t xEngineWaiter = NULL;
+
+/* Queue one command. A full FIFO is waited out here: the engine empties
+ * it at memory speed. */
+static void prvEngineCmd(uint32_t op, uint32_t a, uint32_t b, uint32_t c) {
+    while ((IORD(VIDEO_2D_ENGINE_BASE, RASTER_ENGINE_STATUS) & RASTER_ENGINE_FREE_MSK) < RASTER_ENGINE_CMD_WORDS) {
+    }
+    IOWR(VIDEO_2D_ENGINE_BASE, RASTER_ENGINE_CMD, op);
+    IOWR(VIDEO_2D_ENGINE_BASE, RASTER_ENGINE_CMD, a);
+    IOWR(VIDEO_2D_ENGINE_BASE, RASTER_ENGINE_CMD, b);
+    IOWR(VIDEO_2D_ENGINE_BASE, RASTER_ENGINE_CMD, c);
+}
+
+static inline int xEngineBusy(void) {
+    return (IORD(VIDEO_2D_ENGINE_BASE, RASTER_ENGINE_STATUS) & RASTER_ENGINE_BUSY_MSK) != 0;
+}
+
+/* Level interrupt while idle with the enable set; it is cleared here so
+ * it fires once per vRasterSync() */
+static void prvEngineISR(void *context) {
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    TaskHandle_t xWaiter = xEngineWaiter;
+
+    IOWR(VIDEO_2D_ENGINE_BASE, RASTER_ENGINE_IRQ_ENABLE, 0);
+    if (xWaiter != NULL) {
+        vTaskNotifyGiveFromISR(xWaiter, &xHigherPriorityTaskWoken);
+    }
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+#endif
+
+/* Colour replicated across a 32-bit word for packed writes */
+#if VGA_RASTER_BYTES_PER_PIXEL == 1
+#define rasterPACK(c)                  (((c) & 0xFF) * 0x01010101UL)
+#elif VGA_RASTER_BYTES_PER_PIXEL == 2
+#define rasterPACK(c)                  (((c) & 0xFFFF) * 0x00010001UL)
+#else
+#define rasterPACK(c)                  (c)
+#endif
+
+int xRasterInit(alt_up_pixel_buffer_dma_dev *pxDev) {
+    pxRasterDev = pxDev;
+    xRasterReady = 0;
+
+    if (pxDev == NULL) {
+        return -1;
+    }
+    if (pxDev->addressing_mode != ALT_UP_PIXEL_BUFFER_XY_ADDRESS_MODE ||
+        (1 << pxDev->x_coord_offset) != VGA_RASTER_BYTES_PER_PIXEL) {
+        return -1;
+    }
+
+    xRowShift = pxDev->y_coord_offset;
+    xResX = pxDev->x_resolution;
+    xResY = pxDev->y_resolution;
+    xRasterReady = 1;
+    xBackgroundReady = xResX <= VGA_RASTER_LAYER_X && xResY <= VGA_RASTER_LAYER_Y;
+
+#if VGA_RASTER_ENGINE
+    IOWR(VIDEO_2D_ENGINE_BASE, RASTER_ENGINE_IRQ_ENABLE, 0);
+    IOWR(VIDEO_2D_ENGINE_BASE, RASTER_ENGINE_FRAME, pxDev->buffer_start_address);
+    IOWR(VIDEO_2D_ENGINE_BASE, RASTER_ENGINE_PITCH, xRowShift);
+    IOWR(VIDEO_2D_ENGINE_BASE, RASTER_ENGINE_RES, rasterXY(xResX, xResY));
+    xEngineReady = xIrqRegister(VIDEO_2D_ENGINE_IRQ, prvEngineISR, NULL) == 0;
+#endif
+    return 0;
+}
+
+/* Background layer part of a span: n pixels from (x, y), step apart in
+ * the layer and addr_step apart in the frame */
+static void prvLayerSpan(int op, uint32_t addr, int x, int y, int n, int step, uint32_t addr_step, uint32_t color) {
+    RasterPixel_t *pxPixel = &xBackground[y * xResX + x];
+
+    if (op == RASTER_BACKGROUND) {
+        for (; n; n--) {
+            *pxPixel = (RasterPixel_t)color;
+            pxPixel += step;
+        }
+        return;
+    }
+    for (; n; n--) {
+        rasterWRITE(addr, *pxPixel);
+        pxPixel += step;
+        addr += addr_step;
+    }
+}
+
+/* Horizontal run, clipped once */
+static void prvSpanH(uint32_t base, int xa, int xb, int y, uint32_t color, int op) {
+    uint32_t addr, packed;
+    int n;
+
+    if (y < 0 || y >= xResY) {
+        return;
+    }
+    if (xa < 0) {
+        xa = 0;
+    }
+    if (xb >= xResX) {
+        xb = xResX - 1;
+    }
+    if (xa > xb) {
+        return;
+    }
+
+    addr = base + ((uint32_t)y << xRowShift) + (uint32_t)xa * VGA_RASTER_BYTES_PER_PIXEL;
+    n = xb - xa + 1;
+    if (op != RASTER_STORE) {
+        prvLayerSpan(op, addr, xa, y, n, 1, VGA_RASTER_BYTES_PER_PIXEL, color);
+        return;
+    }
+    packed = rasterPACK(color);
+
+#if VGA_RASTER_BYTES_PER_PIXEL == 4
+    while (n--) {
+        IOWR_32DIRECT(addr, 0, packed);
+        addr += 4;
+    }
+#elif VGA_RASTER_BYTES_PER_PIXEL == 2
+    if ((addr & 2) && n) {
+        IOWR_16DIRECT(addr, 0, packed);
+        addr += 2;
+        n--;
+    }
+    for (; n >= 2; n -= 2) {
+        IOWR_32DIRECT(addr, 0, packed);
+        addr += 4;
+    }
+    if (n) {
+        IOWR_16DIRECT(addr, 0, packed);
+    }
+#else
+    for (; n && (addr & 3); n--) {
+        IOWR_8DIRECT(addr++, 0, packed);
+    }
+    for (; n >= 4; n -= 4) {
+        IOWR_32DIRECT(addr, 0, packed);
+        addr += 4;
+    }
+    while (n--) {
+        IOWR_8DIRECT(addr++, 0, packed);
+    }
+#endif
+}
+
+/* Vertical run, clipped once, stepped by the row pitch */
+static void prvSpanV(uint32_t base, int x, int ya, int yb, uint32_t color, int op) {
+    uint32_t addr;
+    int n;
+
+    if (x < 0 || x >= xResX) {
+        return;
+    }
+    if (ya < 0) {
+        ya = 0;
+    }
+    if (yb >= xResY) {
+        yb = xResY - 1;
+    }
+    if (ya > yb) {
+        return;
+    }
+
+    addr = base + ((uint32_t)ya << xRowShift) + (uint32_t)x * VGA_RASTER_BYTES_PER_PIXEL;
+    if (op != RASTER_STORE) {
+        prvLayerSpan(op, addr, x, ya, yb - ya + 1, xResX, 1UL << xRowShift, color);
+        return;
+    }
+    for (n = yb - ya + 1; n; n--) {
+#if VGA_RASTER_BYTES_PER_PIXEL == 4
+        IOWR_32DIRECT(addr, 0, color);
+#elif VGA_RASTER_BYTES_PER_PIXEL == 2
+        IOWR_16DIRECT(addr, 0, color);
+#else
+        IOWR_8DIRECT(addr, 0, color);
+#endif
+        addr += 1UL << xRowShift;
+    }
+}
+
+/* Bresenham, same pixels as the driver, emitted as runs along the major axis */
+static void prvLine(uint32_t base, int x0, int y0, int x1, int y1, uint32_t color, int op) {
+    int dx = abs(x1 - x0);
+    int dy = abs(y1 - y0);
+    int t, err, step, start, i, j;
+
+    /* Whole line off screen */
+    if ((x0 < 0 && x1 < 0) || (y0 < 0 && y1 < 0) ||
+        (x0 >= xResX && x1 >= xResX) || (y0 >= xResY && y1 >= xResY)) {
+        return;
+    }
+
+    if (dy <= dx) {
+        if (x0 > x1) {
+            t = x0; x0 = x1; x1 = t;
+            t = y0; y0 = y1; y1 = t;
+        }
+        step = (y0 < y1) ? 1 : -1;
+        err = -(dx / 2);
+        j = y0;
+        start = x0;
+        for (i = x0; i <= x1; i++) {
+            err += dy;
+            if (err > 0) {
+                prvSpanH(base, start, i, j, color, op);
+                j += step;
+                err -= dx;
+                start = i + 1;
+            }
+        }
+        if (start <= x1) {
+            prvSpanH(base, start, x1, j, color, op);
+        }
+    } else {
+        if (y0 > y1) {
+            t = x0; x0 = x1; x1 = t;
+            t = y0; y0 = y1; y1 = t;
+        }
+        step = (x0 < x1) ? 1 : -1;
+        err = -(dy / 2);
+        j = x0;
+        start = y0;
+        for (i = y0; i <= y1; i++) {
+            err += dx;
+            if (err > 0) {
+                prvSpanV(base, j, start, i, color, op);
+                j += step;
+                err -= dy;
+                start = i + 1;
+            }
+        }
+        if (start <= y1) {
+            prvSpanV(base, j, start, y1, color, op);
+        }
+    }
+}
+
+void vRasterLine(int x0, int y0, int x1, int y1, uint32_t color) {
+    if (!xRasterReady) {
+        if (pxRasterDev != NULL) {
+            alt_up_pixel_buffer_dma_draw_line(pxRasterDev, x0, y0, x1, y1, color, 0);
+        }
+        return;
+    }
+#if VGA_RASTER_ENGINE
+    if (xEngineReady) {
+        prvEngineCmd(RASTER_OP_LINE, rasterXY(x0, y0), rasterXY(x1, y1), color);
+        return;
+    }
+#endif
+    prvLine(pxRasterDev->buffer_start_address, x0, y0, x1, y1, color, RASTER_STORE);
+}
+
+void vRasterPolyline(const RasterPoint_t *pxPoints, int n, uint32_t color) {
+    uint32_t base;
+    int i;
+
+    if (!xRasterReady) {
+        for (i = 1; i < n && pxRasterDev != NULL; i++) {
+            alt_up_pixel_buffer_dma_draw_line(pxRasterDev, pxPoints[i - 1].x, pxPoints[i - 1].y,
+                                              pxPoints[i].x, pxPoints[i].y, color, 0);
+        }
+        return;
+    }
+
+#if VGA_RASTER_ENGINE
+    if (xEngineReady) {
+        for (i = 1; i < n; i++) {
+            prvEngineCmd(RASTER_OP_LINE, rasterXY(pxPoints[i - 1].x, pxPoints[i - 1].y),
+                         rasterXY(pxPoints[i].x, pxPoints[i].y), color);
+        }
+        return;
+    }
+#endif
+    base = pxRasterDev->buffer_start_address;
+    for (i = 1; i < n; i++) {
+        prvLine(base, pxPoints[i - 1].x, pxPoints[i - 1].y, pxPoints[i].x, pxPoints[i].y, color, RASTER_STORE);
+    }
+}
+
+void vRasterBox(int x0, int y0, int x1, int y1, uint32_t color) {
+    uint32_t base;
+    int t, y;
+
+    if (!xRasterReady) {
+        if (pxRasterDev != NULL) {
+            alt_up_pixel_buffer_dma_draw_box(pxRasterDev, x0, y0, x1, y1, color, 0);
+        }
+        return;
+    }
+
+    if (x0 > x1) {
+        t = x0; x0 = x1; x1 = t;
+    }
+    if (y0 > y1) {
+        t = y0; y0 = y1; y1 = t;
+    }
+#if VGA_RASTER_ENGINE
+    if (xEngineReady) {
+        prvEngineCmd(RASTER_OP_FILL, rasterXY(x0, y0), rasterXY(x1, y1), color);
+        return;
+    }
+#endif
+    if (y0 < 0) {
+        y0 = 0;
+    }
+    if (y1 >= xResY) {
+        y1 = xResY - 1;
+    }
+
+    base = pxRasterDev->buffer_start_address;
+    for (y = y0; y <= y1; y++) {
+        prvSpanH(base, x0, x1, y, color, RASTER_STORE);
+    }
+}
+
+void vRasterBlit(int x, int y, const uint32_t *pulWords, int words, int rows) {
+    uint32_t addr, word;
+    int i, p, r;
+
+    if (!xRasterReady) {
+        /* The driver a pixel at a time, it clips */
+        if (pxRasterDev == NULL) {
+            return;
+        }
+        for (r = 0; r < rows; r++) {
+            for (i = 0; i < words; i++) {
+                word = *pulWords++;
+                for (p = 0; p < RASTER_PIXELS_PER_WORD; p++) {
+                    alt_up_pixel_buffer_dma_draw(pxRasterDev, word & RASTER_INVERT,
+                                                 x + i * RASTER_PIXELS_PER_WORD + p, y + r);
+                    word = (uint32_t)((uint64_t)word >> (8 * VGA_RASTER_BYTES_PER_PIXEL));
+                }
+            }
+        }
+        return;
+    }
+    if (x < 0 || y < 0 || x + words * RASTER_PIXELS_PER_WORD > xResX || y + rows > xResY ||
+        (x % RASTER_PIXELS_PER_WORD) != 0) {
+        return;
+    }
+
+    addr = pxRasterDev->buffer_start_address + ((uint32_t)y << xRowShift) + (uint32_t)x * VGA_RASTER_BYTES_PER_PIXEL;
+    for (r = 0; r < rows; r++) {
+        for (i = 0; i < words; i++) {
+            IOWR_32DIRECT(addr, i * 4, *pulWords++);
+        }
+        addr += 1UL << xRowShift;
+    }
+}
+
+/* One pixel read back and written XORed, clipped */
+static void prvXorPixel(uint32_t base, int x, int y, uint32_t mask) {
+    uint32_t addr;
+
+    if (x < 0 || x >= xResX || y < 0 || y >= xResY) {
+        return;
+    }
+
+    addr = base + ((uint32_t)y << xRowShift) + (uint32_t)x * VGA_RASTER_BYTES_PER_PIXEL;
+#if VGA_RASTER_BYTES_PER_PIXEL == 4
+    IOWR_32DIRECT(addr, 0, IORD_32DIRECT(addr, 0) ^ mask);
+#elif VGA_RASTER_BYTES_PER_PIXEL == 2
+    IOWR_16DIRECT(addr, 0, IORD_16DIRECT(addr, 0) ^ mask);
+#else
+    IOWR_8DIRECT(addr, 0, IORD_8DIRECT(addr, 0) ^ mask);
+#endif
+}
+
+void vRasterXorCross(int x, int y, int arm, uint32_t mask) {
+    uint32_t base;
+    int i;
+
+    if (!xRasterReady) {
+        return;
+    }
+
+#if VGA_RASTER_ENGINE
+    /* Read after the engine's writes. Callers sync first, this only
+     * guards against reading half a primitive. */
+    while (xEngineReady && xEngineBusy()) {
+    }
+#endif
+
+    /* The centre once, or it would be XORed back */
+    base = pxRasterDev->buffer_start_address;
+    prvXorPixel(base, x, y, mask);
+    for (i = 1; i <= arm; i++) {
+        prvXorPixel(base, x - i, y, mask);
+        prvXorPixel(base, x + i, y, mask);
+        prvXorPixel(base, x, y - i, mask);
+        prvXorPixel(base, x, y + i, mask);
+    }
+}
+
+void vRasterFrameSize(int *pxWidth, int *pxHeight) {
+    *pxWidth = xRasterReady ? xResX : 0;
+    *pxHeight = xRasterReady ? xResY : 0;
+}
+
+int xRasterReadRow(int y, uint32_t *pulPixels, int count) {
+    uint32_t addr, word = 0;
+    int i;
+
+    if (!xRasterReady || y < 0 || y >= xResY || count < 0 || count > xResX) {
+        return 0;
+    }
+
+    /* A word at a time, the pixels in it low bits first */
+    addr = pxRasterDev->buffer_start_address + ((uint32_t)y << xRowShift);
+    for (i = 0; i < count; i++) {
+        if (i % RASTER_PIXELS_PER_WORD == 0) {
+            word = IORD_32DIRECT(addr, i * VGA_RASTER_BYTES_PER_PIXEL);
+        }
+        pulPixels[i] = word & (uint32_t)(RasterPixel_t)~0U;
+        word = (uint32_t)((uint64_t)word >> (8 * VGA_RASTER_BYTES_PER_PIXEL));
+    }
+    return 1;
+}
+
+#if VGA_RASTER_BYTES_PER_PIXEL == 4
+#define rasterCOPY(dst, src)           IOWR_32DIRECT(dst, 0, IORD_32DIRECT(src, 0))
+#elif VGA_RASTER_BYTES_PER_PIXEL == 2
+#define rasterCOPY(dst, src)           IOWR_16DIRECT(dst, 0, IORD_16DIRECT(src, 0))
+#else
+#define rasterCOPY(dst, src)           IOWR_8DIRECT(dst, 0, IORD_8DIRECT(src, 0))
+#endif
+
+/* Pixels of a clipped box moved by (dx, dy), |dx| and |dy| less than its
+ * size. Rows and pixels go in the order that reads each one before it is
+ * overwritten. */
+static void prvScrollPixels(uint32_t base, int x0, int y0, int x1, int y1, int dx, int dy) {
+    uint32_t src, dst, step;
+    int t, y, n, w;
+    int32_t offset = (int32_t)(((int32_t)dy << xRowShift) + dx * VGA_RASTER_BYTES_PER_PIXEL);
+
+    w = x1 - x0 + 1 - abs(dx);
+    for (t = 0; t <= y1 - y0 - abs(dy); t++) {
+        y = dy < 0 ? y0 + t : y1 - t;
+        dst = base + ((uint32_t)y << xRowShift) + (uint32_t)(dx > 0 ? x0 + dx : x0) * VGA_RASTER_BYTES_PER_PIXEL;
+        step = VGA_RASTER_BYTES_PER_PIXEL;
+        if (dy == 0 && dx > 0) {
+            /* Within a row to the right: from its right end */
+            dst += (uint32_t)(w - 1) * VGA_RASTER_BYTES_PER_PIXEL;
+            step = -step;
+        }
+        src = dst - (uint32_t)offset;
+        for (n = w; n; n--) {
+            rasterCOPY(dst, src);
+            dst += step;
+            src += step;
+        }
+    }
+}
+
+void vRasterScroll(int x0, int y0, int x1, int y1, int dx, int dy, uint32_t fill) {
+    int t;
+
+    if (!xRasterReady) {
+        return;
+    }
+    if (x0 > x1) {
+        t = x0; x0 = x1; x1 = t;
+    }
+    if (y0 > y1) {
+        t = y0; y0 = y1; y1 = t;
+    }
+    if (x0 < 0) {
+        x0 = 0;
+    }
+    if (x1 >= xResX) {
+        x1 = xResX - 1;
+    }
+    if (y0 < 0) {
+        y0 = 0;
+    }
+    if (y1 >= xResY) {
+        y1 = xResY - 1;
+    }
+    if (x0 > x1 || y0 > y1 || (dx == 0 && dy == 0)) {
+        return;
+    }
+    if (abs(dx) > x1 - x0 || abs(dy) > y1 - y0) {
+        vRasterBox(x0, y0, x1, y1, fill);
+        return;
+    }
+
+#if VGA_RASTER_ENGINE
+    if (xEngineReady) {
+        prvEngineCmd(RASTER_OP_SCROLL, rasterXY(x0, y0), rasterXY(x1, y1), rasterXY(dx, dy));
+    } else {
+        prvScrollPixels(pxRasterDev->buffer_start_address, x0, y0, x1, y1, dx, dy);
+    }
+#else
+    prvScrollPixels(pxRasterDev->buffer_start_address, x0, y0, x1, y1, dx, dy);
+#endif
+
+    /* The rows and columns left behind */
+    if (dy < 0) {
+        vRasterBox(x0, y1 + dy + 1, x1, y1, fill);
+    } else if (dy > 0) {
+        vRasterBox(x0, y0, x1, y0 + dy - 1, fill);
+    }
+    if (dx < 0) {
+        vRasterBox(x1 + dx + 1, y0, x1, y1, fill);
+    } else if (dx > 0) {
+        vRasterBox(x0, y0, x0 + dx - 1, y1, fill);
+    }
+}
+
+/* The CPU writes the frame after every queued command has */
+static void prvEngineDrain(void) {
+#if VGA_RASTER_ENGINE
+    while (xEngineReady && xEngineBusy()) {
+    }
+#endif
+}
+
+/* Rows of a box, sorted and clipped, through prvSpanH */
+static void prvBoxSpans(uint32_t base, int x0, int y0, int x1, int y1, uint32_t color, int op) {
+    int t, y;
+
+    if (x0 > x1) {
+        t = x0; x0 = x1; x1 = t;
+    }
+    if (y0 > y1) {
+        t = y0; y0 = y1; y1 = t;
+    }
+    if (y0 < 0) {
+        y0 = 0;
+    }
+    if (y1 >= xResY) {
+        y1 = xResY - 1;
+    }
+    for (y = y0; y <= y1; y++) {
+        prvSpanH(base, x0, x1, y, color, op);
+    }
+}
+
+void vRasterBackgroundLine(int x0, int y0, int x1, int y1, uint32_t color) {
+    if (!xRasterReady || !xBackgroundReady) {
+        vRasterLine(x0, y0, x1, y1, color);
+        return;
+    }
+    prvLine(0, x0, y0, x1, y1, color, RASTER_BACKGROUND);
+}
+
+void vRasterBackgroundBox(int x0, int y0, int x1, int y1, uint32_t color) {
+    if (!xRasterReady || !xBackgroundReady) {
+        vRasterBox(x0, y0, x1, y1, color);
+        return;
+    }
+    prvBoxSpans(0, x0, y0, x1, y1, color, RASTER_BACKGROUND);
+}
+
+void vRasterRestorePolyline(const RasterPoint_t *pxPoints, int n) {
+    uint32_t base;
+    int i;
+
+    if (!xRasterReady || !xBackgroundReady) {
+        vRasterPolyline(pxPoints, n, 0);
+        return;
+    }
+    prvEngineDrain();
+    base = pxRasterDev->buffer_start_address;
+    for (i = 1; i < n; i++) {
+        prvLine(base, pxPoints[i - 1].x, pxPoints[i - 1].y, pxPoints[i].x, pxPoints[i].y, 0, RASTER_RESTORE);
+    }
+}
+
+void vRasterBackgroundShow(int x0, int y0, int x1, int y1) {
+    if (!xRasterReady || !xBackgroundReady) {
+        return;
+    }
+    prvEngineDrain();
+    prvBoxSpans(pxRasterDev->buffer_start_address, x0, y0, x1, y1, 0, RASTER_RESTORE);
+}
+
+void vRasterSync(TickType_t xTicksToWait) {
+#if VGA_RASTER_ENGINE
+    if (!xEngineReady || !xEngineBusy()) {
+        return;
+    }
+    if (xTicksToWait != 0) {
+        xEngineWaiter = xTaskGetCurrentTaskHandle();
+        IOWR(VIDEO_2D_ENGINE_BASE, RASTER_ENGINE_IRQ_ENABLE, 1);
+        (void)ulTaskNotifyTake(pdTRUE, xTicksToWait);
+        IOWR(VIDEO_2D_ENGINE_BASE, RASTER_ENGINE_IRQ_ENABLE, 0);
+        xEngineWaiter = NULL;
+    }
+    /* Polled: no wait asked for, or the interrupt timed out */
+    while (xEngineBusy()) {
+    }
+#else
+    (void)xTicksToWait;
+#endif
+}
@@ -0,0 +1,156 @@
+/**
+ * Span-based rasterizer for the VGA pixel buffer
+ *
+ * A faster replacement for the pixel buffer driver's draw_line/draw_box. The
+ * colour depth is fixed at compile time (VGA_RASTER_BYTES_PER_PIXEL), pixel
+ * addresses are stepped instead of recomputed, horizontal runs are written as
+ * 32-bit words, and the bounds are checked once per primitive.
+ *
+ * The driver is BSP-generated, so this lives with the application. If the
+ * hardware does not match the compiled configuration, xRasterInit() fails and
+ * every call falls back to the driver.
+ *
+ * Drawing goes straight to the visible frame on purpose. The pixel buffer DMA
+ * master is only connected to the SRAM, so it cannot scan out of an SDRAM
+ * shadow frame, and a copy from SDRAM would cost at least as many uncached
+ * writes as the incremental spans it replaces. Cached writes to the SRAM do
+ * not help either: the D-cache allocates on write, so every sparse store
+ * would first read a whole line from the 16-bit SRAM. cache_io.h has the
+ * rules for any buffer that is shared with a master through the cache.
+ *
+ * With a 2D engine in the system (VIDEO_2D_ENGINE_BASE in system.h) the
+ * lines, boxes and scrolls are queued to its command FIFO instead, and the
+ * engine writes them into the SRAM frame itself. The calls then return as
+ * soon as the command is queued. They run in order, so an erase followed
+ * by a redraw still comes out right. vRasterSync() waits for the engine
+ * to finish, and after it the frame may be read again. Without the engine
+ * every call draws on the CPU and vRasterSync() returns at once.
+ *
+ * Static content (axes, threshold lines) is drawn once into a background
+ * layer, a copy of the frame in ordinary cached SDRAM that only the CPU
+ * touches, and copied to the frame with vRasterBackgroundShow(). A trace is
+ * then erased by vRasterRestorePolyline(): the same pixels the line drew
+ * are put back from the layer rather than painted black, so what the
+ * trace crossed reappears and static content costs nothing per frame. The
+ * engine cannot read SDRAM, so restores are CPU copies made after the
+ * queued commands have run. Without the rasterizer, or for a frame larger
+ * than the layer, the background calls draw straight to the frame and the
+ * restores paint black, as before.
+ */
+
+#ifndef VGA_RASTER_H
+#define VGA_RASTER_H
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "system.h"
+#include "altera_up_avalon_video_pixel_buffer_dma.h"
+
+/* Pixel format of video_pixel_buffer_dma (30-bit RGB, X-Y addressing) */
+#ifndef VGA_RASTER_BYTES_PER_PIXEL
+#define VGA_RASTER_BYTES_PER_PIXEL     4      // 1, 2 or 4
+#endif
+
+#if VGA_RASTER_BYTES_PER_PIXEL != 1 && VGA_RASTER_BYTES_PER_PIXEL != 2 && VGA_RASTER_BYTES_PER_PIXEL != 4
+#error VGA_RASTER_BYTES_PER_PIXEL must be 1, 2 or 4
+#endif
+
+/* Colours in the compiled pixel format, from 10-bit components: 30-bit RGB,
+ * RGB565 or the pixel DMA's 8-bit RGB332. Callers name their colours with
+ * these so the same plots draw at any depth; with a pixel buffer and
+ * resampler generated for 8 bits, VGA_RASTER_BYTES_PER_PIXEL 1 halves every
+ * span write and the scan-out against 16 bits (a quarter of 30-bit), and
+ * the background layer with it. RASTER_INVERT is an XOR mask of every
+ * colour bit. */
+#if VGA_RASTER_BYTES_PER_PIXEL == 4
+#define RASTER_RGB(r, g, b)            (((uint32_t)(r) << 20) | ((uint32_t)(g) << 10) | (uint32_t)(b))
+#define RASTER_INVERT                  0x3FFFFFFFUL
+#elif VGA_RASTER_BYTES_PER_PIXEL == 2
+#define RASTER_RGB(r, g, b)            ((((uint32_t)(r) >> 5) << 11) | (((uint32_t)(g) >> 4) << 5) | ((uint32_t)(b) >> 5))
+#define RASTER_INVERT                  0xFFFFUL
+#else
+#define RASTER_RGB(r, g, b)            ((((uint32_t)(r) >> 7) << 5) | (((uint32_t)(g) >> 7) << 2) | ((uint32_t)(b) >> 8))
+#define RASTER_INVERT                  0xFFUL
+#endif
+#define RASTER_BLACK                   0UL
+#define RASTER_PIXELS_PER_WORD         (4 / VGA_RASTER_BYTES_PER_PIXEL)
+
+/* Largest frame the background layer holds */
+#ifndef VGA_RASTER_LAYER_X
+#define VGA_RASTER_LAYER_X             640
+#endif
+#ifndef VGA_RASTER_LAYER_Y
+#define VGA_RASTER_LAYER_Y             480
+#endif
+
+#ifdef VIDEO_2D_ENGINE_BASE
+#define VGA_RASTER_ENGINE              1
+#else
+#define VGA_RASTER_ENGINE              0
+#endif
+
+typedef struct {
+    int16_t x;
+    int16_t y;
+} RasterPoint_t;
+
+/* Bind to the pixel buffer. Returns 0 on success, -1 if the device does not
+ * match the compiled pixel format (the driver is then used instead). */
+int xRasterInit(alt_up_pixel_buffer_dma_dev *pxDev);
+
+/* Line between two points, both end points included */
+void vRasterLine(int x0, int y0, int x1, int y1, uint32_t color);
+
+/* Connected line through n points (n - 1 segments) */
+void vRasterPolyline(const RasterPoint_t *pxPoints, int n, uint32_t color);
+
+/* Filled box, corners included */
+void vRasterBox(int x0, int y0, int x1, int y1, uint32_t color);
+
+/* Move the contents of a box by (dx, dy), right and down positive, and
+ * fill what is uncovered with fill, clipped to the screen. Outside the box
+ * nothing changes. */
+void vRasterScroll(int x0, int y0, int x1, int y1, int dx, int dy, uint32_t fill);
+
+/* Draw into the background layer only. Without the layer they draw on the
+ * frame instead. */
+void vRasterBackgroundLine(int x0, int y0, int x1, int y1, uint32_t color);
+void vRasterBackgroundBox(int x0, int y0, int x1, int y1, uint32_t color);
+
+/* Copy a box of the layer to the frame, corners included. Nothing without
+ * the layer, the background calls have drawn there already. */
+void vRasterBackgroundShow(int x0, int y0, int x1, int y1);
+
+/* Put the background back along a polyline, the pixels vRasterPolyline()
+ * would draw. Paints them black without the layer. */
+void vRasterRestorePolyline(const RasterPoint_t *pxPoints, int n);
+
+/* Copy rows of packed pixels to the frame with its top left at (x, y):
+ * words 32-bit words a row, RASTER_PIXELS_PER_WORD pixels each, the first
+ * in the low bits, rows one after the other. x must fall on a word of the
+ * frame; a block out of bounds or off the word is not drawn. The CPU
+ * writes it whether or not there is an engine, so nothing queued may
+ * cover the same pixels. */
+void vRasterBlit(int x, int y, const uint32_t *pulWords, int words, int rows);
+
+/* Frame size in pixels, 0 by 0 without the rasterizer */
+void vRasterFrameSize(int *pxWidth, int *pxHeight);
+
+/* The first count pixels of row y of the frame as it is scanned out, one
+ * pixel value a word. Uncached reads; whatever is queued may or may not
+ * have reached them. Returns 0 without the rasterizer, out of bounds or
+ * past the row, 1 otherwise. */
+int xRasterReadRow(int y, uint32_t *pulPixels, int count);
+
+/* Wait for every queued primitive to reach the frame. Blocks the calling
+ * task for at most xTicksToWait, then polls; 0 polls only, for callers
+ * that cannot block. */
+void vRasterSync(TickType_t xTicksToWait);
+
+/* Cross of 2 * arm + 1 pixels each way centred on (x, y), every pixel
+ * XORed with mask, so drawing it again at the same place restores what was
+ * under it. Reads the frame, so nothing else may draw over it in between.
+ * Ignored without the rasterizer: the driver has no read. */
+void vRasterXorCross(int x, int y, int arm, uint32_t mask);
+
+#endif /* VGA_RASTER_H */
@@ -0,0 +1,189 @@
+/**
+ * Character buffer text layer
+ *
+ * See vga_text.h.
+ */
+
+/* Standard includes */
+#include <string.h>
+
+/* HAL includes */
+#include <io.h>
+
+/* Application includes */
+#include "vga_text.h"
+
+#if TEXT_COLS % 4 != 0 || TEXT_COLS / 4 > 32
+#error "vTextFlush() needs whole groups of four columns, one bit each in a word"
+#endif
+
+static alt_up_char_buffer_dev *pxTextDev = NULL;
+
+/* What the character buffer currently holds, 0 after a clear. Rows start
+ * on a word, as in the buffer, so a group of four is one load and store. */
+static char cShadow[TEXT_ROWS][TEXT_COLS] __attribute__((aligned(4)));
+
+static const uint32_t ulPow10[] = { 1, 10, 100, 1000, 10000 };
+
+/* Store the shadow's groups of row y with a bit set in dirty, one per
+ * group of four columns */
+static void vTextFlush(int y, uint32_t dirty) {
+    uint32_t base = pxTextDev->buffer_base + ((uint32_t)y << pxTextDev->y_coord_offset);
+    uint32_t word;
+    int group;
+
+    for (group = 0; dirty != 0; group++, dirty >>= 1) {
+        if (dirty & 1) {
+            memcpy(&word, &cShadow[y][group * 4], sizeof(word));
+            IOWR_32DIRECT(base, group * 4, word);
+        }
+    }
+}
+
+void vTextInit(alt_up_char_buffer_dev *pxDev) {
+    pxTextDev = pxDev;
+    vTextClear();
+}
+
+void vTextClear(void) {
+    memset(cShadow, 0, sizeof(cShadow));
+    if (pxTextDev != NULL) {
+        alt_up_char_buffer_clear(pxTextDev);
+    }
+}
+
+void vTextClearRows(int y, int rows) {
+    uint32_t dirty;
+    int col;
+
+    if (pxTextDev == NULL || y < 0) {
+        return;
+    }
+    for (; rows > 0 && y < TEXT_ROWS; rows--, y++) {
+        dirty = 0;
+        for (col = 0; col < TEXT_COLS; col++) {
+            if (cShadow[y][col] != 0) {
+                cShadow[y][col] = 0;
+                dirty |= 1UL << (col / 4);
+            }
+        }
+        vTextFlush(y, dirty);
+    }
+}
+
+void vTextPut(int x, int y, const char *text, int width) {
+    uint32_t dirty = 0;
+    char *row;
+    char ch;
+    int col;
+
+    if (pxTextDev == NULL || y < 0 || y >= TEXT_ROWS || x < 0) {
+        return;
+    }
+
+    row = cShadow[y];
+    for (col = x; col < TEXT_COLS; col++) {
+        if (*text) {
+            ch = *text++;
+        } else if (col - x < width) {
+            ch = ' ';
+        } else {
+            break;
+        }
+        if (row[col] != ch) {
+            row[col] = ch;
+            dirty |= 1UL << (col / 4);
+        }
+    }
+    vTextFlush(y, dirty);
+}
+
+void vTextGetRow(int y, char *dst) {
+    int col;
+
+    for (col = 0; col < TEXT_COLS; col++) {
+        dst[col] = cShadow[y][col] != 0 ? cShadow[y][col] : ' ';
+    }
+}
+
+char *pcTextStr(char *dst, const char *src) {
+    while (*src) {
+        *dst++ = *src++;
+    }
+    *dst = '\0';
+    return dst;
+}
+
+char *pcTextUint(char *dst, uint32_t value) {
+    char tmp[10];
+    int n = 0;
+
+    do {
+        tmp[n++] = '0' + (value % 10);
+        value /= 10;
+    } while (value);
+
+    while (n) {
+        *dst++ = tmp[--n];
+    }
+    *dst = '\0';
+    return dst;
+}
+
+char *pcTextInt(char *dst, int32_t value) {
+    if (value < 0) {
+        *dst++ = '-';
+        return pcTextUint(dst, (uint32_t)0 - (uint32_t)value);
+    }
+    return pcTextUint(dst, (uint32_t)value);
+}
+
+char *pcTextHex(char *dst, uint32_t value, int digits) {
+    static const char hex[] = "0123456789ABCDEF";
+    int i;
+
+    for (i = digits - 1; i >= 0; i--) {
+        dst[i] = hex[value & 0xF];
+        value >>= 4;
+    }
+    dst[digits] = '\0';
+    return dst + digits;
+}
+
+char *pcTextFix16(char *dst, fix16_t value, int decimals) {
+    uint32_t mag, whole, frac, scale;
+
+    if (decimals < 0) {
+        decimals = 0;
+    } else if (decimals > 4) {
+        decimals = 4;
+    }
+    scale = ulPow10[decimals];
+
+    if (value < 0) {
+        *dst++ = '-';
+        mag = (uint32_t)0 - (uint32_t)value;
+    } else {
+        mag = (uint32_t)value;
+    }
+
+    /* Round the fraction to the requested digits, carrying into the integer
+     * part (frac * 10^4 still fits in 32 bits) */
+    whole = mag >> FIX16_SHIFT;
+    frac = ((mag & (FIX16_ONE - 1)) * scale + (FIX16_ONE / 2)) >> FIX16_SHIFT;
+    if (frac >= scale) {
+        frac -= scale;
+        whole++;
+    }
+
+    dst = pcTextUint(dst, whole);
+    if (decimals) {
+        *dst++ = '.';
+        while (decimals--) {
+            scale /= 10;
+            *dst++ = '0' + (frac / scale) % 10;
+        }
+        *dst = '\0';
+    }
+    return dst;
+}
@@ -0,0 +1,56 @@
+/**
+ * Character buffer text layer
+ *
+ * Keeps a shadow copy of the 80x60 character buffer and only writes the
+ * characters that differ, so redrawing an unchanged status line costs a
+ * memory compare instead of bus writes. Numbers are formatted with the
+ * integer-only helpers below rather than sprintf, which keeps newlib's
+ * floating point printf and its stack usage out of the display path.
+ *
+ * The changed characters go out a word at a time: the buffer holds a row's
+ * characters at consecutive addresses, rows 128 bytes apart, so each
+ * aligned group of four columns is one 32-bit store of the shadow's copy,
+ * and a put writes each group it changed once. A status line that changes
+ * a few digits costs one or two stores, not one a character. (With the
+ * buffer's 8-bit slave the interconnect makes the byte writes; the CPU
+ * issues a quarter of them.)
+ *
+ * The formatters write at dst, NUL terminate and return a pointer to the
+ * terminator, so a line is built by chaining calls.
+ */
+
+#ifndef VGA_TEXT_H
+#define VGA_TEXT_H
+
+#include <stdint.h>
+#include "altera_up_avalon_video_character_buffer_with_dma.h"
+#include "fix16.h"
+
+#define TEXT_COLS                      80
+#define TEXT_ROWS                      60
+
+/* Bind to the character buffer, clear it and the shadow copy */
+void vTextInit(alt_up_char_buffer_dev *pxDev);
+
+/* Blank the whole screen with the controller's clear, waiting for it */
+void vTextClear(void);
+
+/* Blank rows y to y + rows - 1, writing only the words that hold text */
+void vTextClearRows(int y, int rows);
+
+/* Write text at (x, y), padded with spaces to width characters (0 = no
+ * padding). Clipped at the right edge. */
+void vTextPut(int x, int y, const char *text, int width);
+
+/* Row y as the character buffer shows it, TEXT_COLS characters into dst,
+ * blanks where nothing was written */
+void vTextGetRow(int y, char *dst);
+
+/* Formatters */
+char *pcTextStr(char *dst, const char *src);
+char *pcTextUint(char *dst, uint32_t value);
+char *pcTextInt(char *dst, int32_t value);
+char *pcTextHex(char *dst, uint32_t value, int digits);
+char *pcTextFix16(char *dst, fix16_t value, int decimals);  // Rounded, decimals 0-4
+
+#endif /* VGA_TEXT_H */
@@ -0,0 +1,103 @@
+/**
+ * Warm restart snapshot
+ *
+ * See warm_state.h.
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+/* Scheduler includes */
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/* Application includes */
+#include "crc32.h"
+#include "warm_state.h"
+
+/* GCC makes a named section PROGBITS whatever is in it; the flags after
+ * the name make it NOBITS, and the '#' comments out the ones GCC appends */
+#define WARM_NOINIT                    __attribute__((section("sdram.noinit,\"aw\",@nobits#")))
+
+static WARM_NOINIT WarmState_t xWarm;
+
+static uint32_t ulWarmCrc(const WarmState_t *pxState) {
+    return ulCrc32((const uint8_t *)pxState, offsetof(WarmState_t, crc));
+}
+
+int xWarmStateRestore(WarmState_t *pxState) {
+    if (xWarm.magic == WARM_STATE_MAGIC && xWarm.size == sizeof(WarmState_t) &&
+        xWarm.crc == ulWarmCrc(&xWarm)) {
+        xWarm.warm_boots++;
+        xWarm.crc = ulWarmCrc(&xWarm);
+        *pxState = xWarm;
+        return 1;
+    }
+
+    memset(&xWarm, 0, sizeof(xWarm));
+    xWarm.magic = WARM_STATE_MAGIC;
+    xWarm.size = sizeof(WarmState_t);
+    xWarm.crc = ulWarmCrc(&xWarm);
+    return 0;
+}
+
+void vWarmStateLoads(LoadMask_t requested, LoadMask_t driven) {
+    if (requested == xWarm.requested && driven == xWarm.driven) {
+        return;
+    }
+    taskENTER_CRITICAL();
+    xWarm.sheds += ulLoadCount(xWarm.driven & ~driven);
+    xWarm.reconnects += ulLoadCount(driven & ~xWarm.driven);
+    xWarm.requested = requested;
+    xWarm.driven = driven;
+    xWarm.crc = ulWarmCrc(&xWarm);
+    taskEXIT_CRITICAL();
+}
+
+void vWarmStateShedLatency(uint32_t latency_us) {
+    if (latency_us <= xWarm.shed_max_us) {
+        return;
+    }
+    taskENTER_CRITICAL();
+    xWarm.shed_max_us = latency_us;
+    xWarm.crc = ulWarmCrc(&xWarm);
+    taskEXIT_CRITICAL();
+}
+
+void vWarmStateFaults(LoadMask_t faulty_loads, uint16_t system_fault) {
+    if (faulty_loads == xWarm.faulty_loads && system_fault == xWarm.system_fault) {
+        return;
+    }
+    taskENTER_CRITICAL();
+    xWarm.faulty_loads = faulty_loads;
+    xWarm.system_fault = system_fault;
+    xWarm.crc = ulWarmCrc(&xWarm);
+    taskEXIT_CRITICAL();
+}
+
+void vWarmStateFailsafe(uint32_t source, uint32_t detail) {
+    if (source >= FAILSAFE_SOURCES) {
+        return;
+    }
+    taskENTER_CRITICAL();
+    xWarm.failsafe |= 1UL << source;
+    xWarm.failsafe_detail[source] = detail;
+    xWarm.crc = ulWarmCrc(&xWarm);
+    taskEXIT_CRITICAL();
+}
+
+void vWarmStateClear(void) {
+    taskENTER_CRITICAL();
+    xWarm.faulty_loads = 0;
+    xWarm.system_fault = 0;
+    xWarm.failsafe = 0;
+    memset(xWarm.failsafe_detail, 0, sizeof(xWarm.failsafe_detail));
+    xWarm.crc = ulWarmCrc(&xWarm);
+    taskEXIT_CRITICAL();
+}
+
+void vWarmStateGet(WarmState_t *pxState) {
+    taskENTER_CRITICAL();
+    *pxState = xWarm;
+    taskEXIT_CRITICAL();
+}
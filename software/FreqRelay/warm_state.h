@@ -0,0 +1,82 @@
+/**
+ * Warm restart snapshot
+ *
+ * A watchdog reset or the firmware update's restart used to bring the
+ * relay up as from power-on: the decision starting from nothing, the
+ * failsafe latch open, and the staged reconnection bringing the feeder's
+ * loads back one hold-off at a time, with every other relay on it doing
+ * the same. The SDRAM keeps its contents over a reset of the system if not
+ * over a power cycle, so what the loads were doing is kept there instead,
+ * and main() picks it up before the scheduler starts.
+ *
+ * The snapshot, WarmState_t, is one record in an input section named
+ * sdram.noinit, declared NOBITS. The generated linker.x collects it into
+ * its .sdram output section, after .bss and below the heap's start, so as
+ * with fast_mem.h's names no BSP file changes. crt0 clears only .bss, and
+ * a NOBITS section is not part of the load image, so neither a JTAG
+ * download nor the boot copier's copy from flash writes over it. A
+ * download of the same build therefore restarts warm too.
+ *
+ * Each update rewrites the fields that changed and a CRC-32 over the
+ * record in one critical section, tens of bytes, and only when something
+ * did change: the loads driven or requested, the feedback fault latch, a
+ * failsafe source reported. A reset part way through leaves the CRC wrong
+ * and the next boot is cold, as is the first after power-up (or a build
+ * whose record differs: the size is in the check). The restored loads are
+ * only a starting point; the first decision on a new sample overrides
+ * them, so a frequency event during the restart is acted on as ever.
+ *
+ * A restart between a failsafe trip and its report by the monitor comes
+ * back without that source; whatever tripped it trips it again.
+ */
+
+#ifndef WARM_STATE_H
+#define WARM_STATE_H
+
+#include <stdint.h>
+#include "failsafe.h"
+#include "load_mask.h"
+
+#define WARM_STATE_MAGIC               0x5741524DUL  // "WARM"
+
+typedef struct {
+    uint32_t magic;                    // WARM_STATE_MAGIC
+    uint32_t size;                     // sizeof(WarmState_t)
+    uint32_t warm_boots;               // Restored since power-up
+    LoadMask_t requested;              // The decision's request, the shed stage
+    LoadMask_t driven;                 // On the output ports
+    LoadMask_t faulty_loads;           // Feedback fault latch
+    uint16_t system_fault;
+    uint32_t failsafe;                 // Sources reported, bit per source
+    uint32_t failsafe_detail[FAILSAFE_SOURCES];
+    uint32_t sheds;                    // Loads shed since power-up
+    uint32_t reconnects;               // Loads reconnected since power-up
+    uint32_t shed_max_us;              // Longest shed latency since power-up
+    uint32_t crc;                      // CRC-32 of everything above
+} WarmState_t;
+
+/* Before the scheduler starts. A valid snapshot is counted as a warm boot,
+ * copied to *pxState and 1 returned; otherwise a new one starts from zero
+ * and 0 is returned. */
+int xWarmStateRestore(WarmState_t *pxState);
+
+/* What the actuator applied, after each step. Sheds and reconnections are
+ * counted from the change in driven. */
+void vWarmStateLoads(LoadMask_t requested, LoadMask_t driven);
+
+/* A shed's latency, from the actuator */
+void vWarmStateShedLatency(uint32_t latency_us);
+
+/* The feedback fault latch, from the monitor when it changes */
+void vWarmStateFaults(LoadMask_t faulty_loads, uint16_t system_fault);
+
+/* A failsafe source as it is reported */
+void vWarmStateFailsafe(uint32_t source, uint32_t detail);
+
+/* System reset: fault and failsafe latches open, the counts stay */
+void vWarmStateClear(void);
+
+/* Copy of the snapshot, any task */
+void vWarmStateGet(WarmState_t *pxState);
+
+#endif /* WARM_STATE_H */
@@ -0,0 +1,104 @@
+/**
+ * Task watchdog supervisor
+ *
+ * See watchdog.h.
+ */
+
+/* Scheduler includes */
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+
+/* Hardware includes */
+#include "system.h"
+#ifdef WATCHDOG_TIMER_BASE
+#include "altera_avalon_timer_regs.h"
+#endif
+
+/* Application includes */
+#include "watchdog.h"
+
+static EventGroupHandle_t xHeartbeats = NULL;
+static EventBits_t xRequired = 0;
+static TickType_t xTrip = 0;
+static volatile TickType_t xLastKick = 0;
+static volatile uint8_t xPaused = 0;
+static volatile uint8_t xTripped = 0;
+static uint8_t xGrace = 0;             // Supervisor only: next period is not checked
+
+static void vWatchdogKick(void) {
+    xLastKick = xTaskGetTickCount();
+    xTripped = 0;
+#ifdef WATCHDOG_TIMER_BASE
+    /* Any write to a period register reloads a watchdog timer */
+    IOWR_ALTERA_AVALON_TIMER_PERIODL(WATCHDOG_TIMER_BASE, 0);
+#endif
+}
+
+int xWatchdogInit(EventBits_t required, TickType_t xTripTicks) {
+    xHeartbeats = xEventGroupCreate();
+    if (xHeartbeats == NULL) {
+        return -1;
+    }
+    xRequired = required;
+    xTrip = xTripTicks;
+    xGrace = 1;
+    vWatchdogKick();
+#ifdef WATCHDOG_TIMER_BASE
+    /* Cannot be stopped once started */
+    IOWR_ALTERA_AVALON_TIMER_CONTROL(WATCHDOG_TIMER_BASE, ALTERA_AVALON_TIMER_CONTROL_START_MSK);
+#endif
+    return 0;
+}
+
+void vWatchdogBeat(EventBits_t bit) {
+    if (xHeartbeats != NULL) {
+        xEventGroupSetBits(xHeartbeats, bit);
+    }
+}
+
+EventBits_t xWatchdogSupervise(TickType_t xPeriod) {
+    EventBits_t xBits, xMissing;
+
+    if (xHeartbeats == NULL) {
+        vTaskDelay(xPeriod);
+        return 0;
+    }
+
+    /* Bits are cleared on the way out only if all of them arrived */
+    xBits = xEventGroupWaitBits(xHeartbeats, xRequired, pdTRUE, pdTRUE, xPeriod);
+    xMissing = xRequired & ~xBits;
+    if (xMissing != 0) {
+        /* Partial sets do not carry into the next period */
+        xEventGroupClearBits(xHeartbeats, xRequired);
+    }
+
+    if (xPaused || xGrace) {
+        xGrace = xPaused;
+        vWatchdogKick();
+        return 0;
+    }
+    if (xMissing == 0) {
+        vWatchdogKick();
+    }
+    return xMissing;
+}
+
+int xWatchdogTickExpired(void) {
+    if (xPaused || xTripped || xHeartbeats == NULL) {
+        return 0;
+    }
+    if (xTaskGetTickCountFromISR() - xLastKick < xTrip) {
+        return 0;
+    }
+    xTripped = 1;
+    return 1;
+}
+
+void vWatchdogPause(int paused) {
+    if (!paused) {
+        xGrace = 1;
+        vWatchdogKick();
+    }
+    xPaused = (uint8_t)paused;
+}
@@ -0,0 +1,46 @@
+/**
+ * Task watchdog supervisor
+ *
+ * Every supervised task sets its heartbeat bit in one event group each time
+ * round its loop. The supervisor waits for all of the bits in a single
+ * xEventGroupWaitBits() and only when they have all arrived kicks the
+ * watchdog; bits still missing after a supervision period name the tasks
+ * that have stopped, and the caller forces failsafe.
+ *
+ * The kick goes to the tick hook, which trips if no kick arrives for the
+ * trip time - the supervisor itself has stalled, or something at a higher
+ * priority has taken the CPU. If the system has a watchdog timer
+ * (an interval timer built with the reset output, WATCHDOG_TIMER_BASE in
+ * system.h), each kick also reloads it, so a hang with interrupts off
+ * resets the board.
+ */
+
+#ifndef WATCHDOG_H
+#define WATCHDOG_H
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+
+/* Create the event group. required is every heartbeat bit that must arrive
+ * in each supervision period. Call before the scheduler starts; returns 0
+ * on success. */
+int xWatchdogInit(EventBits_t required, TickType_t xTripTicks);
+
+/* A supervised task is alive, from task context */
+void vWatchdogBeat(EventBits_t bit);
+
+/* Wait up to xPeriod for every heartbeat. Kicks and returns 0 if they all
+ * came, otherwise returns the bits that are missing and does not kick.
+ * Supervisor task only. */
+EventBits_t xWatchdogSupervise(TickType_t xPeriod);
+
+/* Tick hook: non-zero once when the supervisor has not kicked for the trip
+ * time. Rearms on the next kick. */
+int xWatchdogTickExpired(void);
+
+/* Stop watching while the application is stopped (the benchmarks). The
+ * first period after resuming is not checked. */
+void vWatchdogPause(int paused);
+
+#endif /* WATCHDOG_H */
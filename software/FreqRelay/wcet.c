@@ -0,0 +1,95 @@
+/**
+ * Execution time probes for the control path
+ *
+ * See wcet.h.
+ */
+
+/* Standard includes */
+#include <string.h>
+
+/* Hardware includes */
+#include "sys/alt_irq.h"
+
+/* Application includes */
+#include "wcet.h"
+#include "latency.h"
+#include "telemetry.h"
+
+static const char * const pcNames[WCET_PROBES] = {
+    "Analyzer", "Decision", "Actuator", "Feedback", "Monitor",
+    "FreqISR", "ButtonISR", "ResetISR", "FailISR", "Tick", "UiLock",
+    "Watchdog", "State"
+};
+
+uint32_t ulWcetStart[WCET_PROBES];
+
+/* Written and copied with interrupts masked */
+static WcetStats_t xStats[WCET_PROBES];
+
+static uint32_t ulWcetBin(uint32_t cycles) {
+    uint32_t top = cycles >> WCET_HIST_SHIFT;
+    uint32_t bin;
+
+    if (top == 0) {
+        return 0;
+    }
+    bin = 32 - (uint32_t)__builtin_clz(top);
+    return bin < WCET_HIST_BINS ? bin : WCET_HIST_BINS - 1;
+}
+
+void vWcetRecord(uint32_t probe, uint32_t cycles, uint32_t a, uint32_t b) {
+    alt_irq_context context;
+    WcetStats_t *pxStats;
+    uint32_t bin = ulWcetBin(cycles);
+    int worst = 0;
+
+    if (probe >= WCET_PROBES) {
+        return;
+    }
+    pxStats = &xStats[probe];
+
+    context = alt_irq_disable_all();
+    if (pxStats->runs == 0 || cycles < pxStats->min_cycles) {
+        pxStats->min_cycles = cycles;
+    }
+    if (pxStats->runs == 0 || cycles > pxStats->max_cycles) {
+        pxStats->max_cycles = cycles;
+        pxStats->worst_a = a;
+        pxStats->worst_b = b;
+        pxStats->worst_stamp = ulLatencyNow();
+        worst = 1;
+    }
+    pxStats->runs++;
+    pxStats->total_cycles += cycles;
+    pxStats->hist[bin]++;
+    alt_irq_enable_all(context);
+
+    /* Outside the masked section, the post masks on its own */
+    if (worst) {
+        vTelemetryPost(TELEMETRY_WCET, probe, cycles, a);
+    }
+}
+
+void vWcetGetStats(uint32_t probe, WcetStats_t *pxStats) {
+    alt_irq_context context;
+
+    if (probe >= WCET_PROBES) {
+        memset(pxStats, 0, sizeof(*pxStats));
+        return;
+    }
+    context = alt_irq_disable_all();
+    *pxStats = xStats[probe];
+    alt_irq_enable_all(context);
+}
+
+const char *pcWcetName(uint32_t probe) {
+    return probe < WCET_PROBES ? pcNames[probe] : "?";
+}
+
+void vWcetReset(void) {
+    alt_irq_context context;
+
+    context = alt_irq_disable_all();
+    memset(xStats, 0, sizeof(xStats));
+    alt_irq_enable_all(context);
+}
@@ -0,0 +1,92 @@
+/**
+ * Execution time probes for the control path
+ *
+ * A timing build ("make timing", FREQ_RELAY_TIMING) brackets the analyzer
+ * pass, the load decision, the actuator pass, both halves of the monitor,
+ * the watchdog and state jobs, the application's own interrupt handlers,
+ * the tick hook and the editor's scheduler-suspended section with
+ * WCET_BEGIN/WCET_END. Their maxima feed the response time analysis (rta.h)
+ * printed with the run statistics.
+ * Each probe keeps, in timestamp counts (CPU cycles on this board), the
+ * shortest and longest run, the mean, a histogram in powers of two and the
+ * two input words its caller gave for the longest run, so a worst case
+ * seen on the bench can be replayed on the host. A new longest run is also
+ * sent as a TELEMETRY_WCET record, and the run stats task prints the table.
+ * In every other build the macros are empty.
+ *
+ * A run is the time between the two marks, so a task probe includes any
+ * interrupt, and any higher priority task, that ran in between; compare
+ * with the ISR probes and the per-IRQ times of irq_defer.h. The analyzer
+ * is the highest priority application task, so only interrupts and the
+ * timer daemon land in its runs. A probe outer to another (the actuator
+ * around the decision) includes the inner probe's bookkeeping.
+ *
+ * The inputs are evaluated in every build, so they are kept to values the
+ * caller has at hand. The start is held in the probe, so one run of a probe is open at a time:
+ * either a single task or handlers that cannot nest. An update takes a few
+ * instructions with interrupts masked; readers copy the same way.
+ */
+
+#ifndef WCET_H
+#define WCET_H
+
+#include <stdint.h>
+
+#ifndef FREQ_RELAY_TIMING
+#define FREQ_RELAY_TIMING              0
+#endif
+
+/* Probes */
+#define WCET_ANALYZER                  0     // vAnalyzerStep      a: samples drained, b: channels updated
+#define WCET_DECISION                  1     // vMakeLoadDecision  a: newest frequency Q16, b: RoC Q16
+#define WCET_ACTUATOR                  2     // vActuatorStep      a: requested loads, b: driven loads
+#define WCET_FEEDBACK                  3     // vMonitorFeedback   a: events, b: faulty loads
+#define WCET_MONITOR                   4     // vMonitorPeriodic   a: deadline misses, b: stable feeders
+#define WCET_ISR_FREQ                  5     // Frequency ISR      a: feeder, b: counts read
+#define WCET_ISR_BUTTON                6     // Push button ISR    a: edges, b: 0
+#define WCET_ISR_RESET                 7     // Reset button       a: 0, b: 0
+#define WCET_ISR_FAILSAFE              8     // Failsafe button    a: 0, b: 0
+#define WCET_TICK                      9     // Tick hook          a: switches, b: 0
+#define WCET_UI_LOCK                   10    // Cursor move under vCursorLock, a: x, b: y
+#define WCET_WATCHDOG                  11    // Watchdog job       a: missing beats, b: 0
+#define WCET_STATE                     12    // vShowState         a: state flags, b: level
+#define WCET_PROBES                    13
+
+#define WCET_HIST_BINS                 10
+#define WCET_HIST_SHIFT                8     // Bin 0 is under 256 counts, bin n under 256 << n, the last open
+
+typedef struct {
+    uint32_t runs;
+    uint32_t min_cycles;
+    uint32_t max_cycles;
+    uint64_t total_cycles;
+    uint32_t hist[WCET_HIST_BINS];
+    uint32_t worst_a;                  // Inputs of the longest run
+    uint32_t worst_b;
+    uint32_t worst_stamp;              // Timestamp count at its end
+} WcetStats_t;
+
+#if FREQ_RELAY_TIMING
+#include "latency.h"
+
+/* Start of the probe's run in progress */
+extern uint32_t ulWcetStart[WCET_PROBES];
+
+#define WCET_BEGIN(probe)              (ulWcetStart[probe] = ulLatencyNow())
+#define WCET_END(probe, a, b)          vWcetRecord(probe, ulLatencyNow() - ulWcetStart[probe], (a), (b))
+#else
+#define WCET_BEGIN(probe)              ((void)0)
+#define WCET_END(probe, a, b)          ((void)(a), (void)(b))
+#endif
+
+/* Add one run, from a task or an ISR */
+void vWcetRecord(uint32_t probe, uint32_t cycles, uint32_t a, uint32_t b);
+
+/* Consistent copy of one probe, and its name */
+void vWcetGetStats(uint32_t probe, WcetStats_t *pxStats);
+const char *pcWcetName(uint32_t probe);
+
+/* Forget every run so far, e.g. after the start-up transient */
+void vWcetReset(void);
+
+#endif /* WCET_H */
@@ -0,0 +1,78 @@
+/**
+ * Sliding-window minimum and maximum
+ *
+ * See window_extrema.h.
+ */
+
+/* Application includes */
+#include "window_extrema.h"
+
+#define WINDOW_MASK                    (WINDOW_EXTREMA_SIZE - 1)
+
+#if WINDOW_EXTREMA_SIZE & WINDOW_MASK
+#error "WINDOW_EXTREMA_SIZE must be a power of two"
+#endif
+
+void vWindowExtremaInit(WindowExtrema_t *pxWindow, uint32_t window) {
+    if (window < 1) {
+        window = 1;
+    } else if (window > WINDOW_EXTREMA_SIZE) {
+        window = WINDOW_EXTREMA_SIZE;
+    }
+    pxWindow->window = window;
+    pxWindow->min_head = pxWindow->min_tail = 0;
+    pxWindow->max_head = pxWindow->max_tail = 0;
+}
+
+void vWindowExtremaExpire(WindowExtrema_t *pxWindow, uint32_t seq) {
+    while (pxWindow->min_tail != pxWindow->min_head &&
+           seq - pxWindow->min[pxWindow->min_tail & WINDOW_MASK].seq >= pxWindow->window) {
+        pxWindow->min_tail++;
+    }
+    while (pxWindow->max_tail != pxWindow->max_head &&
+           seq - pxWindow->max[pxWindow->max_tail & WINDOW_MASK].seq >= pxWindow->window) {
+        pxWindow->max_tail++;
+    }
+}
+
+void vWindowExtremaAdd(WindowExtrema_t *pxWindow, uint32_t seq, fix16_t lo, fix16_t hi) {
+    WindowEntry_t *pxEntry;
+
+    /* What is left spans fewer than window positions before seq, so with
+     * seq there is room */
+    vWindowExtremaExpire(pxWindow, seq);
+
+    while (pxWindow->min_head != pxWindow->min_tail &&
+           pxWindow->min[(pxWindow->min_head - 1) & WINDOW_MASK].value >= lo) {
+        pxWindow->min_head--;
+    }
+    pxEntry = &pxWindow->min[pxWindow->min_head++ & WINDOW_MASK];
+    pxEntry->seq = seq;
+    pxEntry->value = lo;
+
+    while (pxWindow->max_head != pxWindow->max_tail &&
+           pxWindow->max[(pxWindow->max_head - 1) & WINDOW_MASK].value <= hi) {
+        pxWindow->max_head--;
+    }
+    pxEntry = &pxWindow->max[pxWindow->max_head++ & WINDOW_MASK];
+    pxEntry->seq = seq;
+    pxEntry->value = hi;
+}
+
+int xWindowExtremaGet(const WindowExtrema_t *pxWindow, fix16_t *pxLo, fix16_t *pxHi) {
+    if (pxWindow->min_tail == pxWindow->min_head) {
+        return 0;
+    }
+    *pxLo = pxWindow->min[pxWindow->min_tail & WINDOW_MASK].value;
+    *pxHi = pxWindow->max[pxWindow->max_tail & WINDOW_MASK].value;
+    return 1;
+}
+
+fix16_t xWindowExtremaPeak(const WindowExtrema_t *pxWindow) {
+    fix16_t lo, hi;
+
+    if (!xWindowExtremaGet(pxWindow, &lo, &hi)) {
+        return 0;
+    }
+    return FIX16_ABS(hi) >= FIX16_ABS(lo) ? hi : lo;
+}
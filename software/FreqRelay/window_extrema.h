@@ -0,0 +1,57 @@
+/**
+ * Sliding-window minimum and maximum
+ *
+ * The smallest and largest values among the last window positions of a
+ * stream, in O(1) amortised per value: each of the two is a monotonic
+ * deque, so a value is pushed once and dropped at most once, either from
+ * the back by a newer value that beats it or from the front when it leaves
+ * the window. The front of each is the extreme.
+ *
+ * Positions are the caller's, any increasing sequence (sample numbers,
+ * history columns); a gap in them is a stretch of the window with no value
+ * in it. A position may carry a low and a high value, as a column of the
+ * history does, the minimum being taken over the low ones and the maximum
+ * over the high ones.
+ *
+ * Not locked: one writer, and readers under the writer's own lock.
+ */
+
+#ifndef WINDOW_EXTREMA_H
+#define WINDOW_EXTREMA_H
+
+#include <stdint.h>
+#include "fix16.h"
+
+#define WINDOW_EXTREMA_SIZE            128   // Longest window, a power of two
+
+typedef struct {
+    uint32_t seq;
+    fix16_t value;
+} WindowEntry_t;
+
+typedef struct {
+    uint32_t window;                   // Positions a value stays in
+    uint32_t min_head, min_tail;       // Free-running, the deque is [tail, head)
+    uint32_t max_head, max_tail;
+    WindowEntry_t min[WINDOW_EXTREMA_SIZE];  // Increasing from the front
+    WindowEntry_t max[WINDOW_EXTREMA_SIZE];  // Decreasing from the front
+} WindowExtrema_t;
+
+/* Empty, window positions long (1 to WINDOW_EXTREMA_SIZE) */
+void vWindowExtremaInit(WindowExtrema_t *pxWindow, uint32_t window);
+
+/* The values at seq, after every position added before it */
+void vWindowExtremaAdd(WindowExtrema_t *pxWindow, uint32_t seq, fix16_t lo, fix16_t hi);
+
+/* Drop what the window has left behind at seq, for a reader that moves on
+ * with no new value */
+void vWindowExtremaExpire(WindowExtrema_t *pxWindow, uint32_t seq);
+
+/* The minimum and maximum in the window. Returns 0, leaving them, if it
+ * is empty. */
+int xWindowExtremaGet(const WindowExtrema_t *pxWindow, fix16_t *pxLo, fix16_t *pxHi);
+
+/* The larger magnitude of the two extremes, with its sign, 0 if empty */
+fix16_t xWindowExtremaPeak(const WindowExtrema_t *pxWindow);
+
+#endif /* WINDOW_EXTREMA_H */
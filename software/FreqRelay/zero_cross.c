@@ -0,0 +1,76 @@
+/**
+ * Zero-crossing frequency meter for raw waveform samples
+ *
+ * See zero_cross.h.
+ */
+
+/* Application includes */
+#include "zero_cross.h"
+
+#define ZC_SIGNS                       0x80008000UL  // Sign bit of each half
+#define ZC_LOW_BITS                    0x7FFF7FFFUL
+
+void vZeroCrossInit(ZeroCross_t *pxZc, int16_t hysteresis) {
+    pxZc->position = 0;
+    pxZc->last = 0;
+    pxZc->previous = 0;
+    pxZc->hysteresis = hysteresis < 0 ? 0 : hysteresis;
+    pxZc->armed = 0;
+    pxZc->have_last = 0;
+    pxZc->dropped = 0;
+}
+
+/* Sign bits of each half of word + addend, the halves added separately */
+static inline uint32_t ulPackedAddSigns(uint32_t word, uint32_t addend) {
+    return (((word & ZC_LOW_BITS) + addend) ^ word) & ZC_SIGNS;
+}
+
+uint32_t ulZeroCrossBlock(ZeroCross_t *pxZc, const uint32_t *pulWords, uint32_t words,
+                          uint32_t *pulPeriods, uint32_t max) {
+    uint32_t hysteresis = (uint32_t)pxZc->hysteresis;
+    uint32_t addend = hysteresis | (hysteresis << 16);
+    uint32_t word, signs, n = 0, w, at, frac;
+    int32_t sample, previous = pxZc->previous;
+    int half;
+
+    for (w = 0; w < words; w++) {
+        word = pulWords[w];
+        signs = word & ZC_SIGNS;
+
+        /* Armed, both samples still negative: nothing to do. Not armed,
+         * both at or above -hysteresis: x + hysteresis keeps its sign
+         * bit clear in both halves (a sample past 32767 - hysteresis
+         * wraps and only costs the slow path). */
+        if (pxZc->armed ? signs == ZC_SIGNS : ulPackedAddSigns(word, addend) == 0) {
+            previous = (int16_t)(word >> 16);
+            continue;
+        }
+
+        for (half = 0; half < 2; half++) {
+            sample = (int16_t)(half ? word >> 16 : word);
+            if (!pxZc->armed) {
+                pxZc->armed = sample < -(int32_t)hysteresis;
+            } else if (sample >= 0) {
+                /* Between previous (< 0) and sample (>= 0), at
+                 * -previous / (sample - previous) of the way */
+                frac = ((uint32_t)-previous << ZC_FRAC_BITS) / (uint32_t)(sample - previous);
+                at = ((pxZc->position + 2 * w + half - 1) << ZC_FRAC_BITS) + frac;
+                if (pxZc->have_last) {
+                    if (n < max) {
+                        pulPeriods[n++] = at - pxZc->last;
+                    } else {
+                        pxZc->dropped++;
+                    }
+                }
+                pxZc->last = at;
+                pxZc->have_last = 1;
+                pxZc->armed = 0;
+            }
+            previous = sample;
+        }
+    }
+
+    pxZc->position += 2 * words;
+    pxZc->previous = (int16_t)previous;
+    return n;
+}
@@ -0,0 +1,59 @@
+/**
+ * Zero-crossing frequency meter for raw waveform samples
+ *
+ * For analysers that hand over the waveform itself, blocks of signed 16-bit
+ * ADC samples, instead of a period count. The meter finds each rising zero
+ * crossing and places it between the two samples either side of it by
+ * linear interpolation, to 1/2^ZC_FRAC_BITS of a sample. The period out is
+ * the distance between two crossings in those units: a count of a clock
+ * ZC_CLOCK_HZ(adc_hz), which goes into the frequency sample ring and the
+ * estimator (vFreqEstInit() with ZC_CLOCK_Q16(adc_hz)) like an analyser
+ * count. At 16 kHz and 50 Hz a period is 320 samples, so the count
+ * resolves 1/81920 of a period where the analyser's count resolves 1/320.
+ *
+ * Noise near zero is kept from counting twice by hysteresis: a crossing
+ * is only counted once the signal has been below -hysteresis since the
+ * last one.
+ *
+ * Samples are read two to a 32-bit word, the earlier one in the low half
+ * (an int16_t array on the little-endian core). Most words hold no
+ * crossing, and are passed over with one packed test of both sign bits
+ * (and, before arming, one packed add against the hysteresis); only the
+ * words around a crossing are looked at one sample at a time.
+ *
+ * One meter per waveform, used by its single producer.
+ */
+
+#ifndef ZERO_CROSS_H
+#define ZERO_CROSS_H
+
+#include <stdint.h>
+#include "fix16.h"
+
+#define ZC_FRAC_BITS                   8      // Period resolution, 1/256 sample
+
+/* Count rate of the periods, and its Q16.16 for the estimator */
+#define ZC_CLOCK_HZ(adc_hz)            ((uint32_t)(adc_hz) << ZC_FRAC_BITS)
+#define ZC_CLOCK_Q16(adc_hz)           ((uint64_t)ZC_CLOCK_HZ(adc_hz) << FIX16_SHIFT)
+
+typedef struct {
+    uint32_t position;                 // Sample count so far, wraps
+    uint32_t last;                     // Last crossing, ZC_FRAC_BITS, wraps with position
+    int16_t previous;                  // Last sample of the last block
+    int16_t hysteresis;
+    uint8_t armed;                     // Below -hysteresis since the last crossing
+    uint8_t have_last;                 // last is valid
+    uint32_t dropped;                  // Periods that did not fit a caller's buffer
+} ZeroCross_t;
+
+/* hysteresis in ADC codes, 0..32767. No crossing is counted until the
+ * signal has been below -hysteresis once. */
+void vZeroCrossInit(ZeroCross_t *pxZc, int16_t hysteresis);
+
+/* Meter words words (2 * words samples). Writes the period of each cycle
+ * completed in the block to pulPeriods, at most max of them, and returns
+ * how many it wrote. */
+uint32_t ulZeroCrossBlock(ZeroCross_t *pxZc, const uint32_t *pulWords, uint32_t words,
+                          uint32_t *pulPeriods, uint32_t max);
+
+#endif /* ZERO_CROSS_H */